@@ -32,6 +32,9 @@ extern const u32 sha256_ce_offsetof_finalize;
 
 asmlinkage int __sha256_ce_transform(struct sha256_ce_state *sst, u8 const *src,
 				     int blocks);
+asmlinkage void __sha256_ce_finup2x(const struct sha256_ce_state *sst,
+				    u8 const *data1, u8 const *data2, int len,
+				    u8 *out1, u8 *out2);
 
 static void sha256_ce_transform(struct sha256_state *sst, u8 const *src,
 				int blocks)
@@ -103,6 +106,37 @@ static int sha256_ce_finup(struct shash_desc *desc, const u8 *data,
 	return sha256_base_finish(desc, out);
 }
 
+static int sha256_ce_finup_mb(struct shash_desc *desc,
+			      const u8 * const data[], unsigned int len,
+			      u8 * const outs[], unsigned int num_msgs)
+{
+	struct sha256_ce_state *sctx = shash_desc_ctx(desc);
+	SHASH_DESC_ON_STACK(desc2, desc->tfm);
+
+	/*
+	 * The assembly only handles two messages of whole blocks, starting
+	 * from a state without partial data, which is what fs-verity and
+	 * dm-verity pass in. Hash anything else one message at a time.
+	 */
+	if (num_msgs == 2 && crypto_simd_usable() && len &&
+	    len <= INT_MAX && !(len % SHA256_BLOCK_SIZE) &&
+	    !(sctx->sst.count % SHA256_BLOCK_SIZE)) {
+		kernel_neon_begin();
+		__sha256_ce_finup2x(sctx, data[0], data[1], len, outs[0],
+				    outs[1]);
+		kernel_neon_end();
+		return 0;
+	}
+
+	for (; num_msgs > 1; num_msgs--, data++, outs++) {
+		desc2->tfm = desc->tfm;
+		memcpy(shash_desc_ctx(desc2), sctx, sizeof(*sctx));
+		sha256_ce_finup(desc2, data[0], len, outs[0]);
+	}
+
+	return sha256_ce_finup(desc, data[0], len, outs[0]);
+}
+
 static int sha256_ce_final(struct shash_desc *desc, u8 *out)
 {
 	struct sha256_ce_state *sctx = shash_desc_ctx(desc);
@@ -163,10 +197,12 @@ static struct shash_alg algs[] = { {
 	.update			= sha256_ce_update,
 	.final			= sha256_ce_final,
 	.finup			= sha256_ce_finup,
+	.finup_mb		= sha256_ce_finup_mb,
 	.digest			= sha256_ce_digest,
 	.export			= sha256_ce_export,
 	.import			= sha256_ce_import,
 	.descsize		= sizeof(struct sha256_ce_state),
+	.mb_max_msgs		= 2,
 	.statesize		= sizeof(struct sha256_state),
 	.digestsize		= SHA256_DIGEST_SIZE,
 	.base			= {
@@ -666,6 +666,8 @@ int vgic_v3_probe(const struct gic_kvm_info *info)
 		kvm_info("GICv4%s support %s\n",
 			 kvm_vgic_global_state.has_gicv4_1 ? ".1" : "",
 			 str_enabled_disabled(gicv4_enable));
+	} else {
+		kvm_info("GICv4 not available, device MSIs are injected by software\n");
 	}
 
 	kvm_vgic_global_state.vcpu_base = 0;
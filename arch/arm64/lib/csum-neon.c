@@ -0,0 +1,36 @@
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <linux/types.h>
+
+#include <asm/neon-intrinsics.h>
+
+/*
+ * Add up @len bytes at @buff, @len being a non-zero multiple of 64, as
+ * native-endian 32-bit words into a 64-bit result. Each pairwise
+ * add-accumulate widens into 64-bit lanes, so nothing can carry out
+ * before the caller folds the sum; that would take more than 2^31 loop
+ * iterations. Must be called between kernel_neon_begin() and
+ * kernel_neon_end().
+ */
+u64 csum_partial_neon(const u8 *buff, size_t len)
+{
+	const u32 *ptr = (const u32 *)buff;
+	uint64x2_t acc0 = vdupq_n_u64(0);
+	uint64x2_t acc1 = vdupq_n_u64(0);
+	uint64x2_t acc2 = vdupq_n_u64(0);
+	uint64x2_t acc3 = vdupq_n_u64(0);
+
+	do {
+		acc0 = vpadalq_u32(acc0, vld1q_u32(ptr +  0));
+		acc1 = vpadalq_u32(acc1, vld1q_u32(ptr +  4));
+		acc2 = vpadalq_u32(acc2, vld1q_u32(ptr +  8));
+		acc3 = vpadalq_u32(acc3, vld1q_u32(ptr + 12));
+
+		ptr += 16;
+		len -= 64;
+	} while (len);
+
+	acc0 = vaddq_u64(vaddq_u64(acc0, acc1), vaddq_u64(acc2, acc3));
+
+	return vgetq_lane_u64(acc0, 0) + vgetq_lane_u64(acc0, 1);
+}
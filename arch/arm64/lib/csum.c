@@ -7,6 +7,9 @@
 
 #include <net/checksum.h>
 
+#include <asm/neon.h>
+#include <asm/simd.h>
+
 /* Looks dumb, but generates nice-ish code */
 static u64 accumulate(u64 sum, u64 data)
 {
@@ -18,7 +21,8 @@ static u64 accumulate(u64 sum, u64 data)
  * We over-read the buffer and this makes KASAN unhappy. Instead, disable
  * instrumentation and call kasan explicitly.
  */
-unsigned int __no_sanitize_address do_csum(const unsigned char *buff, int len)
+static unsigned int __no_sanitize_address do_csum_scalar(const unsigned char *buff,
+							   int len)
 {
 	unsigned int offset, shift, sum;
 	const u64 *ptr;
@@ -129,6 +133,50 @@ unsigned int __no_sanitize_address do_csum(const unsigned char *buff, int len)
 	return sum >> 16;
 }
 
+#ifdef CONFIG_KERNEL_MODE_NEON
+/*
+ * Below this the cost of kernel_neon_begin()/kernel_neon_end() eats most of
+ * what the wider loads win over the scalar loop.
+ */
+#define CSUM_NEON_MIN_LEN	256
+
+u64 csum_partial_neon(const u8 *buff, size_t len);
+
+static unsigned int do_csum_neon(const unsigned char *buff, int len)
+{
+	int body = len & ~63;
+	unsigned int sum;
+	u64 sum64;
+
+	kasan_check_read(buff, body);
+
+	kernel_neon_begin();
+	sum64 = csum_partial_neon(buff, body);
+	kernel_neon_end();
+
+	/*
+	 * The body is a multiple of 64 bytes, so the tail starts at the same
+	 * odd/even position as @buff and its folded sum just adds up.
+	 */
+	sum64 = accumulate(sum64, do_csum_scalar(buff + body, len - body));
+
+	sum64 += (sum64 >> 32) | (sum64 << 32);
+	sum = sum64 >> 32;
+	sum += (sum >> 16) | (sum << 16);
+
+	return sum >> 16;
+}
+#endif
+
+unsigned int do_csum(const unsigned char *buff, int len)
+{
+#ifdef CONFIG_KERNEL_MODE_NEON
+	if (len >= CSUM_NEON_MIN_LEN && may_use_simd())
+		return do_csum_neon(buff, len);
+#endif
+	return do_csum_scalar(buff, len);
+}
+
 __sum16 csum_ipv6_magic(const struct in6_addr *saddr,
 			const struct in6_addr *daddr,
 			__u32 len, __u8 proto, __wsum csum)
@@ -265,12 +265,25 @@ void contpte_set_ptes(struct mm_struct *mm, unsigned long addr,
 		nr = (next - addr) >> PAGE_SHIFT;
 		pte = pfn_pte(pfn, prot);
 
-		if (((addr | next | (pfn << PAGE_SHIFT)) & ~CONT_PTE_MASK) == 0)
+		if (((addr | next | (pfn << PAGE_SHIFT)) & ~CONT_PTE_MASK) == 0) {
 			pte = pte_mkcont(pte);
-		else
+			__set_ptes(mm, addr, ptep, pte, nr);
+		} else {
 			pte = pte_mknoncont(pte);
-
-		__set_ptes(mm, addr, ptep, pte, nr);
+			__set_ptes(mm, addr, ptep, pte, nr);
+
+			/*
+			 * A batch that only partially covers a contpte block,
+			 * such as a fault-around window that is not aligned
+			 * to the folio, may still complete a block that was
+			 * partly mapped earlier. Folding only happens for
+			 * single ptes otherwise, so file-backed large folios
+			 * mapped this way would stay unfolded.
+			 */
+			if (((addr - (pfn << PAGE_SHIFT)) & ~CONT_PTE_MASK) == 0 &&
+			    pte_valid(pte) && !pte_special(pte))
+				__contpte_try_fold(mm, addr, ptep, pte);
+		}
 
 		addr = next;
 		ptep += nr;
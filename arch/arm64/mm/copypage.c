@@ -14,6 +14,21 @@
 #include <asm/cpufeature.h>
 #include <asm/mte.h>
 
+void copy_page_nt(void *to, const void *from);
+
+/*
+ * Pages of folios of at least this order are copied with non-temporal loads
+ * as well as stores, so that CoW of a large folio does not wipe out the
+ * caches. 0 disables it.
+ */
+static unsigned int copy_page_nt_order __ro_after_init = PMD_ORDER;
+
+static int __init parse_copy_page_nt_order(char *arg)
+{
+	return kstrtouint(arg, 0, &copy_page_nt_order);
+}
+early_param("arm64.copy_page_nt_order", parse_copy_page_nt_order);
+
 void copy_highpage(struct page *to, struct page *from)
 {
 	void *kto = page_address(to);
@@ -22,7 +37,10 @@ void copy_highpage(struct page *to, struct page *from)
 	struct folio *dst = page_folio(to);
 	unsigned int i, nr_pages;
 
-	copy_page(kto, kfrom);
+	if (copy_page_nt_order && folio_order(src) >= copy_page_nt_order)
+		copy_page_nt(kto, kfrom);
+	else
+		copy_page(kto, kfrom);
 
 	if (kasan_hw_tags_enabled())
 		page_kasan_tag_reset(to);
@@ -1478,6 +1478,7 @@ static int build_insn(const struct bpf_insn *insn, struct jit_ctx *ctx,
 		bool func_addr_fixed;
 		u64 func_addr;
 		u32 cpu_offset;
+		u32 pid_offset;
 
 		/* Implement helper call to bpf_get_smp_processor_id() inline */
 		if (insn->src_reg == 0 && insn->imm == BPF_FUNC_get_smp_processor_id) {
@@ -1500,6 +1501,26 @@ static int build_insn(const struct bpf_insn *insn, struct jit_ctx *ctx,
 			break;
 		}
 
+		/* Implement helper call to bpf_get_current_pid_tgid() inline */
+		if (insn->src_reg == 0 && insn->imm == BPF_FUNC_get_current_pid_tgid) {
+			BUILD_BUG_ON(offsetof(struct task_struct, tgid) !=
+				     offsetof(struct task_struct, pid) + sizeof(pid_t));
+			pid_offset = offsetof(struct task_struct, pid);
+
+			emit(A64_MRS_SP_EL0(tmp), ctx);
+			if (!is_lsi_offset(pid_offset + sizeof(pid_t), 2)) {
+				emit_a64_mov_i(1, tmp2, pid_offset, ctx);
+				emit(A64_ADD(1, tmp, tmp, tmp2), ctx);
+				pid_offset = 0;
+			}
+			/* r0 = (u64)current->tgid << 32 | current->pid */
+			emit(A64_LDR32I(r0, tmp, pid_offset + sizeof(pid_t)), ctx);
+			emit(A64_LDR32I(tmp2, tmp, pid_offset), ctx);
+			emit(A64_LSL(1, r0, r0, 32), ctx);
+			emit(A64_ORR(1, r0, r0, tmp2), ctx);
+			break;
+		}
+
 		ret = bpf_jit_get_func_addr(ctx->prog, insn, extra_pass,
 					    &func_addr, &func_addr_fixed);
 		if (ret < 0)
@@ -2817,6 +2838,7 @@ bool bpf_jit_inlines_helper_call(s32 imm)
 	case BPF_FUNC_get_smp_processor_id:
 	case BPF_FUNC_get_current_task:
 	case BPF_FUNC_get_current_task_btf:
+	case BPF_FUNC_get_current_pid_tgid:
 		return true;
 	default:
 		return false;
@@ -0,0 +1,194 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <drm/drm_drv.h>
+#include <drm/rocket_accel.h>
+#include <drm/rocket_client.h>
+#include <linux/dma-fence.h>
+#include <linux/export.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+
+#include "rocket_drv.h"
+#include "rocket_gem.h"
+#include "rocket_job.h"
+
+struct rocket_client {
+	struct rocket_device *rdev;
+	/* NULL once the NPU has been unbound */
+	struct rocket_file_priv *file_priv;
+	struct list_head node;
+};
+
+/* There is a single NPU per SoC, clients get whichever one is bound */
+static DEFINE_MUTEX(rocket_client_lock);
+static struct rocket_device *rocket_client_rdev;
+static LIST_HEAD(rocket_clients);
+
+void rocket_client_register(struct rocket_device *rdev)
+{
+	mutex_lock(&rocket_client_lock);
+	if (!rocket_client_rdev)
+		rocket_client_rdev = rdev;
+	mutex_unlock(&rocket_client_lock);
+}
+
+/*
+ * Called after drm_dev_unplug(), so no client is in the middle of a call
+ * any more, and all the later ones fail. The contexts of the clients that
+ * are still open are torn down while the cores and their schedulers are
+ * still around, the clients themselves are freed when they are closed.
+ */
+void rocket_client_unregister(struct rocket_device *rdev)
+{
+	struct rocket_client *client;
+
+	mutex_lock(&rocket_client_lock);
+
+	if (rocket_client_rdev == rdev)
+		rocket_client_rdev = NULL;
+
+	list_for_each_entry(client, &rocket_clients, node) {
+		if (client->rdev != rdev || !client->file_priv)
+			continue;
+
+		rocket_file_priv_destroy(client->file_priv);
+		client->file_priv = NULL;
+	}
+
+	mutex_unlock(&rocket_client_lock);
+}
+
+/**
+ * rocket_client_open() - Open a context on the NPU for an in-kernel client
+ *
+ * Return: The new client on success, ERR_PTR(-EPROBE_DEFER) if no NPU has
+ * been bound yet, another ERR_PTR() otherwise.
+ */
+struct rocket_client *rocket_client_open(void)
+{
+	struct rocket_file_priv *file_priv;
+	struct rocket_client *client;
+	int ret;
+
+	client = kzalloc(sizeof(*client), GFP_KERNEL);
+	if (!client)
+		return ERR_PTR(-ENOMEM);
+
+	mutex_lock(&rocket_client_lock);
+
+	if (!rocket_client_rdev) {
+		ret = -EPROBE_DEFER;
+		goto err_unlock;
+	}
+
+	file_priv = rocket_file_priv_create(rocket_client_rdev);
+	if (IS_ERR(file_priv)) {
+		ret = PTR_ERR(file_priv);
+		goto err_unlock;
+	}
+
+	client->rdev = rocket_client_rdev;
+	client->file_priv = file_priv;
+	drm_dev_get(&client->rdev->ddev);
+	list_add_tail(&client->node, &rocket_clients);
+
+	mutex_unlock(&rocket_client_lock);
+
+	return client;
+
+err_unlock:
+	mutex_unlock(&rocket_client_lock);
+	kfree(client);
+
+	return ERR_PTR(ret);
+}
+EXPORT_SYMBOL_GPL(rocket_client_open);
+
+/**
+ * rocket_client_close() - Close a context opened with rocket_client_open()
+ * @client: Client to close
+ *
+ * Jobs still queued keep running, the BOs they use are released when they
+ * complete.
+ */
+void rocket_client_close(struct rocket_client *client)
+{
+	struct drm_device *ddev = &client->rdev->ddev;
+
+	mutex_lock(&rocket_client_lock);
+	list_del(&client->node);
+	if (client->file_priv)
+		rocket_file_priv_destroy(client->file_priv);
+	mutex_unlock(&rocket_client_lock);
+
+	drm_dev_put(ddev);
+	kfree(client);
+}
+EXPORT_SYMBOL_GPL(rocket_client_close);
+
+/**
+ * rocket_client_create_bo() - Allocate a BO that jobs of a client can use
+ * @client: Client
+ * @size: Size in bytes of the BO
+ * @dma_address: Returns the NPU address of the BO, to be used in the
+ * register commands
+ *
+ * The BO can be shared with other devices through drm_gem_prime_export().
+ *
+ * Return: A reference to the new BO on success, ERR_PTR(-ENODEV) if the
+ * NPU has been unbound, another ERR_PTR() otherwise.
+ */
+struct drm_gem_object *rocket_client_create_bo(struct rocket_client *client, size_t size,
+					       dma_addr_t *dma_address)
+{
+	struct drm_gem_object *obj;
+	int idx;
+
+	if (!drm_dev_enter(&client->rdev->ddev, &idx))
+		return ERR_PTR(-ENODEV);
+
+	obj = rocket_gem_create_client_bo(client->rdev, size, dma_address);
+
+	drm_dev_exit(idx);
+
+	return obj;
+}
+EXPORT_SYMBOL_GPL(rocket_client_create_bo);
+
+/**
+ * rocket_client_submit() - Queue a job on the NPU
+ * @client: Client submitting the job
+ * @tasks: Tasks of the job
+ * @task_count: Number of tasks
+ * @in_bos: BOs read by the job
+ * @in_bo_count: Number of BOs in @in_bos
+ * @out_bos: BOs written by the job
+ * @out_bo_count: Number of BOs in @out_bos
+ *
+ * All the BOs must have been created with rocket_client_create_bo() on
+ * the same NPU. The caller keeps its references to them.
+ *
+ * Return: A reference to the fence signalled when the job is done on
+ * success, ERR_PTR(-ENODEV) if the NPU has been unbound, another ERR_PTR()
+ * otherwise.
+ */
+struct dma_fence *rocket_client_submit(struct rocket_client *client,
+				       const struct drm_rocket_task *tasks, u32 task_count,
+				       struct drm_gem_object **in_bos, u32 in_bo_count,
+				       struct drm_gem_object **out_bos, u32 out_bo_count)
+{
+	struct dma_fence *fence;
+	int idx;
+
+	if (!drm_dev_enter(&client->rdev->ddev, &idx))
+		return ERR_PTR(-ENODEV);
+
+	fence = rocket_job_submit_kernel(client->file_priv, tasks, task_count,
+					 in_bos, in_bo_count, out_bos, out_bo_count);
+
+	drm_dev_exit(idx);
+
+	return fence;
+}
+EXPORT_SYMBOL_GPL(rocket_client_submit);
@@ -9,23 +9,27 @@
 #include "rocket_job.h"
 #include "rocket_registers.h"
 
+static unsigned int rocket_autosuspend_delay_ms = 50; /* ~3 frames */
+module_param_named(autosuspend_delay_ms, rocket_autosuspend_delay_ms, uint, 0444);
+MODULE_PARM_DESC(autosuspend_delay_ms,
+		 "Idle time after which the clocks of a core are gated, in ms (default: 50)");
+
 static int rocket_clk_init(struct rocket_core *core)
 {
 	struct device *dev = core->dev;
 	int err;
 
-	core->a_clk = devm_clk_get(dev, "aclk");
+	core->a_clk = devm_clk_get_prepared(dev, "aclk");
 	if (IS_ERR(core->a_clk)) {
 		err = PTR_ERR(core->a_clk);
-		dev_err(dev, "devm_clk_get_enabled failed %d for core %d\n", err, core->index);
+		dev_err(dev, "devm_clk_get_prepared failed %d for core %d\n", err, core->index);
 		return err;
 	}
 
-	core->h_clk = devm_clk_get(dev, "hclk");
+	core->h_clk = devm_clk_get_prepared(dev, "hclk");
 	if (IS_ERR(core->h_clk)) {
 		err = PTR_ERR(core->h_clk);
-		dev_err(dev, "devm_clk_get_enabled failed %d for core %d\n", err, core->index);
-		clk_disable_unprepare(core->a_clk);
+		dev_err(dev, "devm_clk_get_prepared failed %d for core %d\n", err, core->index);
 		return err;
 	}
 
@@ -39,6 +43,8 @@ int rocket_core_init(struct rocket_core *core)
 	uint32_t version;
 	int err = 0;
 
+	mutex_init(&core->iommu_lock);
+
 	err = rocket_clk_init(core);
 	if (err) {
 		dev_err(dev, "clk init failed %d\n", err);
@@ -54,7 +60,7 @@ int rocket_core_init(struct rocket_core *core)
 		return err;
 
 	pm_runtime_use_autosuspend(dev);
-	pm_runtime_set_autosuspend_delay(dev, 50); /* ~3 frames */
+	pm_runtime_set_autosuspend_delay(dev, rocket_autosuspend_delay_ms);
 	pm_runtime_enable(dev);
 
 	err = pm_runtime_get_sync(dev);
@@ -74,4 +80,5 @@ void rocket_core_fini(struct rocket_core *core)
 {
 	pm_runtime_disable(core->dev);
 	rocket_job_fini(core);
+	mutex_destroy(&core->iommu_lock);
 }
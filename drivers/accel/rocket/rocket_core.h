@@ -23,9 +23,23 @@ struct rocket_core {
 	struct clk *h_clk;
 
 	struct rocket_job *in_flight_job;
+	/* Job waiting for the core, or preempted by in_flight_job */
+	struct rocket_job *queued_job;
+	u32 in_flight_first_task;
+	u32 in_flight_task_count;
+	u64 in_flight_start_ns;
+
+	/* Task descriptors for chained submissions, NULL if disabled */
+	struct rocket_gem_object *task_table;
 
 	spinlock_t job_lock;
 
+	/* Serializes changes to the mappings in this core's IOMMU domain */
+	struct mutex iommu_lock;
+
+	/* Jobs pushed to this core's scheduler and not freed yet */
+	atomic_t pending_jobs;
+
 	struct {
 		struct workqueue_struct *wq;
 		struct work_struct work;
@@ -33,8 +47,9 @@ struct rocket_core {
 	} reset;
 
 	struct drm_gpu_scheduler sched;
+	/* First of the DRM_SCHED_PRIORITY_COUNT fence contexts, one per priority */
 	u64 fence_context;
-	u64 emit_seqno;
+	u64 emit_seqno[DRM_SCHED_PRIORITY_COUNT];
 };
 
 int rocket_core_init(struct rocket_core *core);
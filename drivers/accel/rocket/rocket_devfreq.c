@@ -0,0 +1,228 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Copyright 2024 Tomeu Vizoso <tomeu@tomeuvizoso.net> */
+
+#include <linux/clk.h>
+#include <linux/devfreq.h>
+#include <linux/devfreq_cooling.h>
+#include <linux/pm_opp.h>
+
+#include "rocket_device.h"
+#include "rocket_devfreq.h"
+
+static void rocket_devfreq_update_utilization(struct rocket_devfreq *rdevfreq)
+{
+	ktime_t now, last;
+
+	now = ktime_get();
+	last = rdevfreq->time_last_update;
+
+	if (rdevfreq->busy_count > 0)
+		rdevfreq->busy_time += ktime_sub(now, last);
+	else
+		rdevfreq->idle_time += ktime_sub(now, last);
+
+	rdevfreq->time_last_update = now;
+}
+
+static void rocket_devfreq_reset(struct rocket_devfreq *rdevfreq)
+{
+	rdevfreq->busy_time = 0;
+	rdevfreq->idle_time = 0;
+	rdevfreq->time_last_update = ktime_get();
+}
+
+static int rocket_devfreq_target(struct device *dev, unsigned long *freq,
+				 u32 flags)
+{
+	struct dev_pm_opp *opp;
+
+	opp = devfreq_recommended_opp(dev, freq, flags);
+	if (IS_ERR(opp))
+		return PTR_ERR(opp);
+	dev_pm_opp_put(opp);
+
+	return dev_pm_opp_set_rate(dev, *freq);
+}
+
+/*
+ * The NPU clock is shared by all cores, so utilization is that of the whole
+ * device: it counts as busy while any of the cores has a job in flight.
+ */
+static int rocket_devfreq_get_dev_status(struct device *dev,
+					 struct devfreq_dev_status *status)
+{
+	struct rocket_device *rdev = dev_get_drvdata(dev);
+	struct rocket_devfreq *rdevfreq = &rdev->devfreq;
+	unsigned long irqflags;
+
+	status->current_frequency = clk_get_rate(rdev->clk_npu);
+
+	spin_lock_irqsave(&rdevfreq->lock, irqflags);
+
+	rocket_devfreq_update_utilization(rdevfreq);
+
+	status->total_time = ktime_to_ns(ktime_add(rdevfreq->busy_time,
+						   rdevfreq->idle_time));
+	status->busy_time = ktime_to_ns(rdevfreq->busy_time);
+
+	rocket_devfreq_reset(rdevfreq);
+
+	spin_unlock_irqrestore(&rdevfreq->lock, irqflags);
+
+	return 0;
+}
+
+static struct devfreq_dev_profile rocket_devfreq_profile = {
+	.timer = DEVFREQ_TIMER_DELAYED,
+	.polling_ms = 50,
+	.target = rocket_devfreq_target,
+	.get_dev_status = rocket_devfreq_get_dev_status,
+};
+
+int rocket_devfreq_init(struct rocket_device *rdev)
+{
+	struct rocket_devfreq *rdevfreq = &rdev->devfreq;
+	struct device *dev = rdev->cores[0].dev;
+	struct thermal_cooling_device *cooling;
+	struct devfreq *devfreq;
+	struct dev_pm_opp *opp;
+	unsigned long cur_freq;
+	int ret;
+
+	ret = devm_pm_opp_set_clkname(dev, "npu");
+	if (ret)
+		return ret;
+
+	ret = devm_pm_opp_set_regulators(dev, (const char *[]){ "npu", NULL });
+	if (ret && ret != -ENODEV) {
+		/* Continue if the optional regulator is missing */
+		if (ret != -EPROBE_DEFER)
+			dev_err(dev, "Couldn't set OPP regulators\n");
+		return ret;
+	}
+
+	/* OPPs restricted with opp-supported-hw are only used on matching chips */
+	ret = devm_pm_opp_set_supported_hw_nvmem(dev, "speed-bin");
+	if (ret)
+		return ret;
+
+	ret = devm_pm_opp_of_add_table(dev);
+	if (ret) {
+		/* Optional, continue without devfreq */
+		if (ret == -ENODEV)
+			ret = 0;
+		return ret;
+	}
+
+	spin_lock_init(&rdevfreq->lock);
+
+	rocket_devfreq_reset(rdevfreq);
+
+	cur_freq = clk_get_rate(rdev->clk_npu);
+
+	opp = devfreq_recommended_opp(dev, &cur_freq, 0);
+	if (IS_ERR(opp))
+		return PTR_ERR(opp);
+
+	rocket_devfreq_profile.initial_freq = cur_freq;
+
+	/*
+	 * Set the recommended OPP, this will enable and configure the
+	 * regulator if any and avoid a switch off by regulator_late_cleanup()
+	 */
+	ret = dev_pm_opp_set_opp(dev, opp);
+	dev_pm_opp_put(opp);
+	if (ret) {
+		dev_err(dev, "Couldn't set recommended OPP\n");
+		return ret;
+	}
+
+	rdevfreq->gov_data.upthreshold = 45;
+	rdevfreq->gov_data.downdifferential = 5;
+
+	devfreq = devm_devfreq_add_device(dev, &rocket_devfreq_profile,
+					  DEVFREQ_GOV_SIMPLE_ONDEMAND,
+					  &rdevfreq->gov_data);
+	if (IS_ERR(devfreq)) {
+		dev_err(dev, "Couldn't initialize NPU devfreq\n");
+		return PTR_ERR(devfreq);
+	}
+	rdevfreq->devfreq = devfreq;
+
+	/*
+	 * Registers a power actor for the power_allocator governor, using the
+	 * energy model built from the OPP table and the
+	 * dynamic-power-coefficient of the NPU node.
+	 */
+	cooling = devfreq_cooling_em_register(devfreq, NULL);
+	if (IS_ERR(cooling))
+		dev_info(dev, "Failed to register cooling device\n");
+	else
+		rdevfreq->cooling = cooling;
+
+	return 0;
+}
+
+void rocket_devfreq_fini(struct rocket_device *rdev)
+{
+	struct rocket_devfreq *rdevfreq = &rdev->devfreq;
+
+	if (rdevfreq->cooling) {
+		devfreq_cooling_unregister(rdevfreq->cooling);
+		rdevfreq->cooling = NULL;
+	}
+}
+
+void rocket_devfreq_resume(struct rocket_device *rdev)
+{
+	struct rocket_devfreq *rdevfreq = &rdev->devfreq;
+
+	if (!rdevfreq->devfreq)
+		return;
+
+	rocket_devfreq_reset(rdevfreq);
+
+	devfreq_resume_device(rdevfreq->devfreq);
+}
+
+void rocket_devfreq_suspend(struct rocket_device *rdev)
+{
+	struct rocket_devfreq *rdevfreq = &rdev->devfreq;
+
+	if (!rdevfreq->devfreq)
+		return;
+
+	devfreq_suspend_device(rdevfreq->devfreq);
+}
+
+void rocket_devfreq_record_busy(struct rocket_devfreq *rdevfreq)
+{
+	unsigned long irqflags;
+
+	if (!rdevfreq->devfreq)
+		return;
+
+	spin_lock_irqsave(&rdevfreq->lock, irqflags);
+
+	rocket_devfreq_update_utilization(rdevfreq);
+
+	rdevfreq->busy_count++;
+
+	spin_unlock_irqrestore(&rdevfreq->lock, irqflags);
+}
+
+void rocket_devfreq_record_idle(struct rocket_devfreq *rdevfreq)
+{
+	unsigned long irqflags;
+
+	if (!rdevfreq->devfreq)
+		return;
+
+	spin_lock_irqsave(&rdevfreq->lock, irqflags);
+
+	rocket_devfreq_update_utilization(rdevfreq);
+
+	WARN_ON(--rdevfreq->busy_count < 0);
+
+	spin_unlock_irqrestore(&rdevfreq->lock, irqflags);
+}
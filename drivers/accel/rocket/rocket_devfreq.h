@@ -0,0 +1,41 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright 2024 Tomeu Vizoso <tomeu@tomeuvizoso.net> */
+
+#ifndef __ROCKET_DEVFREQ_H__
+#define __ROCKET_DEVFREQ_H__
+
+#include <linux/devfreq.h>
+#include <linux/ktime.h>
+#include <linux/spinlock.h>
+
+struct thermal_cooling_device;
+
+struct rocket_device;
+
+struct rocket_devfreq {
+	struct devfreq *devfreq;
+	struct thermal_cooling_device *cooling;
+	struct devfreq_simple_ondemand_data gov_data;
+
+	ktime_t busy_time;
+	ktime_t idle_time;
+	ktime_t time_last_update;
+	/* Number of cores with a job in flight */
+	int busy_count;
+	/*
+	 * Protect busy_time, idle_time, time_last_update and busy_count
+	 * because these are updated from the job paths of all cores.
+	 */
+	spinlock_t lock;
+};
+
+int rocket_devfreq_init(struct rocket_device *rdev);
+void rocket_devfreq_fini(struct rocket_device *rdev);
+
+void rocket_devfreq_resume(struct rocket_device *rdev);
+void rocket_devfreq_suspend(struct rocket_device *rdev);
+
+void rocket_devfreq_record_busy(struct rocket_devfreq *rdevfreq);
+void rocket_devfreq_record_idle(struct rocket_devfreq *rdevfreq);
+
+#endif
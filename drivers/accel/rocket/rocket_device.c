@@ -11,11 +11,14 @@ int rocket_device_init(struct rocket_device *rdev)
 	struct device *dev = rdev->cores[0].dev;
 	int err;
 
-	mutex_init(&rdev->iommu_lock);
 	mutex_init(&rdev->sched_lock);
 
-	rdev->clk_npu = devm_clk_get(dev, "npu");
-	rdev->pclk = devm_clk_get(dev, "pclk");
+	/*
+	 * Clocks are prepared once here, so runtime PM only has to gate and
+	 * ungate them, which is cheap enough to do between bursts of jobs.
+	 */
+	rdev->clk_npu = devm_clk_get_prepared(dev, "npu");
+	rdev->pclk = devm_clk_get_prepared(dev, "pclk");
 
 	/* Initialize core 0 (top) */
 	err = rocket_core_init(&rdev->cores[0]);
@@ -24,12 +27,19 @@ int rocket_device_init(struct rocket_device *rdev)
 		return err;
 	}
 
+	err = rocket_devfreq_init(rdev);
+	if (err) {
+		dev_err_probe(dev, err, "Couldn't init NPU devfreq\n");
+		rocket_device_fini(rdev);
+		return err;
+	}
+
 	return 0;
 }
 
 void rocket_device_fini(struct rocket_device *rdev)
 {
+	rocket_devfreq_fini(rdev);
 	rocket_core_fini(&rdev->cores[0]);
 	mutex_destroy(&rdev->sched_lock);
-	mutex_destroy(&rdev->iommu_lock);
 }
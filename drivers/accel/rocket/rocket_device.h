@@ -7,6 +7,7 @@
 #include <drm/drm_device.h>
 
 #include "rocket_core.h"
+#include "rocket_devfreq.h"
 
 struct rocket_device {
 	struct drm_device ddev;
@@ -16,7 +17,7 @@ struct rocket_device {
 	struct clk *clk_npu;
 	struct clk *pclk;
 
-	struct mutex iommu_lock;
+	struct rocket_devfreq devfreq;
 
 	struct rocket_core *cores;
 	unsigned int num_cores;
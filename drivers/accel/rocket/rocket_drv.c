@@ -6,6 +6,7 @@
 #include <drm/drm_gem.h>
 #include <drm/drm_ioctl.h>
 #include <drm/drm_of.h>
+#include <drm/drm_print.h>
 #include <drm/rocket_accel.h>
 #include <linux/clk.h>
 #include <linux/component.h>
@@ -18,38 +19,72 @@
 #include "rocket_gem.h"
 #include "rocket_job.h"
 
-static int
-rocket_open(struct drm_device *dev, struct drm_file *file)
+struct rocket_file_priv *rocket_file_priv_create(struct rocket_device *rdev)
 {
-	struct rocket_device *rdev = to_rocket_device(dev);
 	struct rocket_file_priv *rocket_priv;
 	int ret;
 
 	rocket_priv = kzalloc(sizeof(*rocket_priv), GFP_KERNEL);
 	if (!rocket_priv)
-		return -ENOMEM;
+		return ERR_PTR(-ENOMEM);
 
 	rocket_priv->rdev = rdev;
-	file->driver_priv = rocket_priv;
+	kref_init(&rocket_priv->refcount);
 
 	ret = rocket_job_open(rocket_priv);
 	if (ret)
 		goto err_free;
 
-	return 0;
+	return rocket_priv;
 
 err_free:
 	kfree(rocket_priv);
-	return ret;
+	return ERR_PTR(ret);
+}
+
+void rocket_file_priv_destroy(struct rocket_file_priv *rocket_priv)
+{
+	rocket_job_close(rocket_priv);
+	rocket_file_priv_put(rocket_priv);
+}
+
+static int
+rocket_open(struct drm_device *dev, struct drm_file *file)
+{
+	struct rocket_file_priv *rocket_priv;
+
+	rocket_priv = rocket_file_priv_create(to_rocket_device(dev));
+	if (IS_ERR(rocket_priv))
+		return PTR_ERR(rocket_priv);
+
+	file->driver_priv = rocket_priv;
+
+	return 0;
+}
+
+void rocket_file_priv_release(struct kref *ref)
+{
+	struct rocket_file_priv *rocket_priv = container_of(ref, struct rocket_file_priv,
+							    refcount);
+
+	kfree(rocket_priv->busy_ns);
+	kfree(rocket_priv);
 }
 
 static void
 rocket_postclose(struct drm_device *dev, struct drm_file *file)
+{
+	rocket_file_priv_destroy(file->driver_priv);
+}
+
+static void rocket_show_fdinfo(struct drm_printer *p, struct drm_file *file)
 {
 	struct rocket_file_priv *rocket_priv = file->driver_priv;
+	struct rocket_device *rdev = rocket_priv->rdev;
 
-	rocket_job_close(rocket_priv);
-	kfree(rocket_priv);
+	for (unsigned int core = 0; core < rdev->num_cores; core++)
+		drm_printf(p, "drm-engine-core%u:\t%llu ns\n", core,
+			   atomic64_read(&rocket_priv->busy_ns[core]));
 }
 
 static const struct drm_ioctl_desc rocket_drm_driver_ioctls[] = {
@@ -60,19 +95,30 @@ static const struct drm_ioctl_desc rocket_drm_driver_ioctls[] = {
 	ROCKET_IOCTL(SUBMIT, submit),
 	ROCKET_IOCTL(PREP_BO, prep_bo),
 	ROCKET_IOCTL(FINI_BO, fini_bo),
+	ROCKET_IOCTL(SET_PRIORITY, set_priority),
+	ROCKET_IOCTL(GET_BO_INFO, get_bo_info),
 };
 
-DEFINE_DRM_ACCEL_FOPS(rocket_accel_driver_fops);
+static const struct file_operations rocket_accel_driver_fops = {
+	.owner = THIS_MODULE,
+	DRM_ACCEL_FOPS,
+	.show_fdinfo = drm_show_fdinfo,
+};
 
 /*
  * Rocket driver version:
  * - 1.0 - initial interface
+ * - 1.1 - adds the ROCKET_BO_WC creation flag
+ * - 1.2 - adds SET_PRIORITY
+ * - 1.3 - adds dma-buf import and export, and GET_BO_INFO
  */
 static const struct drm_driver rocket_drm_driver = {
 	.driver_features	= DRIVER_COMPUTE_ACCEL | DRIVER_GEM,
 	.open			= rocket_open,
 	.postclose		= rocket_postclose,
+	.show_fdinfo		= rocket_show_fdinfo,
 	.gem_create_object	= rocket_gem_create_object,
+	.gem_prime_import_sg_table = rocket_gem_prime_import_sg_table,
 	.ioctls			= rocket_drm_driver_ioctls,
 	.num_ioctls		= ARRAY_SIZE(rocket_drm_driver_ioctls),
 	.fops			= &rocket_accel_driver_fops,
@@ -127,12 +173,20 @@ static int rocket_drm_bind(struct device *dev)
 	if (err)
 		goto err_device_fini;
 
+	err = rocket_job_alloc_task_tables(rdev);
+	if (err)
+		goto err_unbind;
+
 	err = drm_dev_register(ddev, 0);
 	if (err < 0)
-		goto err_unbind;
+		goto err_free_task_tables;
+
+	rocket_client_register(rdev);
 
 	return 0;
 
+err_free_task_tables:
+	rocket_job_free_task_tables(rdev);
 err_unbind:
 	component_unbind_all(dev, rdev);
 err_device_fini:
@@ -145,7 +199,15 @@ static void rocket_drm_unbind(struct device *dev)
 	struct rocket_device *rdev = dev_get_drvdata(dev);
 	struct drm_device *ddev = &rdev->ddev;
 
-	drm_dev_unregister(ddev);
+	/*
+	 * New ioctls and client calls fail from now on, and the client calls
+	 * in progress are waited for.
+	 */
+	drm_dev_unplug(ddev);
+
+	rocket_client_unregister(rdev);
+
+	rocket_job_free_task_tables(rdev);
 
 	component_unbind_all(dev, rdev);
 
@@ -243,12 +305,13 @@ static int rocket_device_runtime_resume(struct device *dev)
 			continue;
 
 		if (core == 0) {
-			clk_prepare_enable(rdev->clk_npu);
-			clk_prepare_enable(rdev->pclk);
+			clk_enable(rdev->clk_npu);
+			clk_enable(rdev->pclk);
+			rocket_devfreq_resume(rdev);
 		}
 
-		clk_prepare_enable(rdev->cores[core].a_clk);
-		clk_prepare_enable(rdev->cores[core].h_clk);
+		clk_enable(rdev->cores[core].a_clk);
+		clk_enable(rdev->cores[core].h_clk);
 	}
 
 	return 0;
@@ -265,12 +328,13 @@ static int rocket_device_runtime_suspend(struct device *dev)
 		if (!rocket_job_is_idle(&rdev->cores[core]))
 			return -EBUSY;
 
-		clk_disable_unprepare(rdev->cores[core].a_clk);
-		clk_disable_unprepare(rdev->cores[core].h_clk);
+		clk_disable(rdev->cores[core].a_clk);
+		clk_disable(rdev->cores[core].h_clk);
 
 		if (core == 0) {
-			clk_disable_unprepare(rdev->pclk);
-			clk_disable_unprepare(rdev->clk_npu);
+			rocket_devfreq_suspend(rdev);
+			clk_disable(rdev->pclk);
+			clk_disable(rdev->clk_npu);
 		}
 	}
 
@@ -5,13 +5,50 @@
 #define __ROCKET_DRV_H__
 
 #include <drm/gpu_scheduler.h>
+#include <linux/kref.h>
+#include <linux/mutex.h>
 
 #include "rocket_device.h"
 
 struct rocket_file_priv {
 	struct rocket_device *rdev;
 
-	struct drm_sched_entity sched_entity;
+	/* Jobs hold a reference, as they can outlive the file */
+	struct kref refcount;
+
+	/* Time spent by each core running jobs from this file */
+	atomic64_t *busy_ns;
+
+	/* One entity per core, jobs are dispatched to the least loaded one */
+	struct drm_sched_entity *sched_entities;
+
+	/* Serializes job submission against changes to the entities */
+	struct mutex submit_lock;
+
+	/* Whether any job has been submitted yet, the priority is fixed afterwards */
+	bool submitted;
 };
 
+void rocket_file_priv_release(struct kref *ref);
+
+struct rocket_file_priv *rocket_file_priv_create(struct rocket_device *rdev);
+void rocket_file_priv_destroy(struct rocket_file_priv *rocket_priv);
+
+void rocket_client_register(struct rocket_device *rdev);
+void rocket_client_unregister(struct rocket_device *rdev);
+
+static inline struct rocket_file_priv *
+rocket_file_priv_get(struct rocket_file_priv *rocket_priv)
+{
+	kref_get(&rocket_priv->refcount);
+
+	return rocket_priv;
+}
+
+static inline void rocket_file_priv_put(struct rocket_file_priv *rocket_priv)
+{
+	if (rocket_priv)
+		kref_put(&rocket_priv->refcount, rocket_file_priv_release);
+}
+
 #endif
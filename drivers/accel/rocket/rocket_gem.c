@@ -6,6 +6,7 @@
 #include <drm/rocket_accel.h>
 #include <linux/dma-mapping.h>
 #include <linux/iommu.h>
+#include <linux/iosys-map.h>
 
 #include "rocket_device.h"
 #include "rocket_gem.h"
@@ -14,26 +15,31 @@ static void rocket_gem_bo_free(struct drm_gem_object *obj)
 {
 	struct rocket_device *rdev = to_rocket_device(obj->dev);
 	struct rocket_gem_object *bo = to_rocket_bo(obj);
-	struct sg_table *sgt;
+	struct sg_table *sgt = bo->base.sgt;
 
 	drm_WARN_ON(obj->dev, bo->base.pages_use_count > 1);
 
-	mutex_lock(&rdev->iommu_lock);
+	/* Unmap this object from the IOMMUs of the cores > 0 */
+	for (unsigned int core = 1; sgt && core < rdev->num_cores; core++) {
+		struct rocket_core *rcore = &rdev->cores[core];
+		struct iommu_domain *domain;
+		size_t unmapped;
 
-	sgt = drm_gem_shmem_get_pages_sgt(&bo->base);
+		if (!test_bit(core, &bo->mapped_cores))
+			continue;
 
-	/* Unmap this object from the IOMMUs for cores > 0 */
-	for (unsigned int core = 1; core < rdev->num_cores; core++) {
-		struct iommu_domain *domain = iommu_get_domain_for_dev(rdev->cores[core].dev);
-		size_t unmapped = iommu_unmap(domain, sgt->sgl->dma_address, bo->size);
+		mutex_lock(&rcore->iommu_lock);
+		domain = iommu_get_domain_for_dev(rcore->dev);
+		unmapped = iommu_unmap(domain, sgt->sgl->dma_address, bo->size);
+		mutex_unlock(&rcore->iommu_lock);
 
 		drm_WARN_ON(obj->dev, unmapped != bo->size);
 	}
 
+	mutex_destroy(&bo->mutex);
+
 	/* This will unmap the pages from the IOMMU linked to core 0 */
 	drm_gem_shmem_free(&bo->base);
-
-	mutex_unlock(&rdev->iommu_lock);
 }
 
 static const struct drm_gem_object_funcs rocket_gem_funcs = {
@@ -69,16 +75,240 @@ struct drm_gem_object *rocket_gem_create_object(struct drm_device *dev, size_t s
 	return &obj->base.base;
 }
 
+/*
+ * Give a core >0 the same mapping as core 0. iommu_map_sgtable() might align
+ * the size, so bo->size is updated with what got mapped. This only runs while
+ * the BO is created, before userspace or a job can see it, so bo->size is
+ * never written concurrently.
+ */
+static int rocket_gem_bo_map_core(struct rocket_gem_object *bo, struct rocket_core *core)
+{
+	struct sg_table *sgt = bo->base.sgt;
+	ssize_t ret;
+
+	mutex_lock(&core->iommu_lock);
+	ret = iommu_map_sgtable(iommu_get_domain_for_dev(core->dev),
+				sgt->sgl->dma_address,
+				sgt,
+				IOMMU_READ | IOMMU_WRITE);
+	mutex_unlock(&core->iommu_lock);
+
+	if (ret < 0 || ret < bo->size) {
+		DRM_ERROR("failed to map buffer on core %u: size=%zd request_size=%zu\n",
+			  core->index, ret, bo->size);
+		if (ret > 0) {
+			mutex_lock(&core->iommu_lock);
+			iommu_unmap(iommu_get_domain_for_dev(core->dev),
+				    sgt->sgl->dma_address, ret);
+			mutex_unlock(&core->iommu_lock);
+		}
+		return -ENOMEM;
+	}
+
+	bo->size = ret;
+	set_bit(core->index, &bo->mapped_cores);
+
+	return 0;
+}
+
+static int rocket_gem_bo_map_core0(struct rocket_gem_object *bo)
+{
+	struct sg_table *sgt;
+
+	/* This will map the pages to the IOMMU linked to core 0 */
+	sgt = drm_gem_shmem_get_pages_sgt(&bo->base);
+	if (IS_ERR(sgt))
+		return PTR_ERR(sgt);
+
+	set_bit(0, &bo->mapped_cores);
+
+	return 0;
+}
+
+/*
+ * Jobs can run on any core, and reach BOs they don't list, such as the ones
+ * holding their register commands. So BOs are mapped at the same address in
+ * the IOMMUs of all cores when created. Mappings done before a failure are
+ * undone when the BO is freed.
+ */
+static int rocket_gem_bo_map_cores(struct rocket_gem_object *bo)
+{
+	struct rocket_device *rdev = to_rocket_device(bo->base.base.dev);
+	int ret;
+
+	ret = rocket_gem_bo_map_core0(bo);
+	if (ret)
+		return ret;
+
+	for (unsigned int core = 1; core < rdev->num_cores; core++) {
+		ret = rocket_gem_bo_map_core(bo, &rdev->cores[core]);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/*
+ * The NPU addresses a BO through a single base address, so imported buffers
+ * must have been mapped contiguously in the IOMMU of core 0.
+ */
+static bool rocket_gem_sgt_is_contiguous(struct sg_table *sgt)
+{
+	dma_addr_t expected = sg_dma_address(sgt->sgl);
+	struct scatterlist *sg;
+	unsigned int i;
+
+	for_each_sgtable_dma_sg(sgt, sg, i) {
+		if (sg_dma_address(sg) != expected)
+			return false;
+		expected += sg_dma_len(sg);
+	}
+
+	return true;
+}
+
+/*
+ * Give a core >0 the same mapping of an imported BO as core 0. The pages
+ * behind the attachment's sg_table belong to the exporter, so the physical
+ * addresses are read back from the IOMMU of core 0 instead, and mapped at
+ * the same address, one physically contiguous run at a time.
+ */
+static int rocket_gem_bo_map_import_core(struct rocket_gem_object *bo,
+					 struct rocket_core *core)
+{
+	struct rocket_device *rdev = to_rocket_device(bo->base.base.dev);
+	struct iommu_domain *domain0 = iommu_get_domain_for_dev(rdev->cores[0].dev);
+	struct iommu_domain *domain = iommu_get_domain_for_dev(core->dev);
+	dma_addr_t iova = sg_dma_address(bo->base.sgt->sgl);
+	size_t mapped = 0;
+	int ret = 0;
+
+	mutex_lock(&core->iommu_lock);
+
+	while (mapped < bo->size) {
+		phys_addr_t phys = iommu_iova_to_phys(domain0, iova + mapped);
+		size_t len = PAGE_SIZE;
+
+		if (!phys) {
+			ret = -EINVAL;
+			break;
+		}
+
+		while (mapped + len < bo->size &&
+		       iommu_iova_to_phys(domain0, iova + mapped + len) == phys + len)
+			len += PAGE_SIZE;
+
+		ret = iommu_map(domain, iova + mapped, phys, len,
+				IOMMU_READ | IOMMU_WRITE, GFP_KERNEL);
+		if (ret)
+			break;
+
+		mapped += len;
+	}
+
+	if (ret && mapped)
+		iommu_unmap(domain, iova, mapped);
+
+	mutex_unlock(&core->iommu_lock);
+
+	if (ret) {
+		DRM_ERROR("failed to map imported buffer on core %u: %d\n",
+			  core->index, ret);
+		return ret;
+	}
+
+	set_bit(core->index, &bo->mapped_cores);
+
+	return 0;
+}
+
+static void rocket_gem_bo_unmap_import_cores(struct rocket_gem_object *bo)
+{
+	struct rocket_device *rdev = to_rocket_device(bo->base.base.dev);
+	dma_addr_t iova = sg_dma_address(bo->base.sgt->sgl);
+
+	for (unsigned int core = 1; core < rdev->num_cores; core++) {
+		struct rocket_core *rcore = &rdev->cores[core];
+
+		if (!test_and_clear_bit(core, &bo->mapped_cores))
+			continue;
+
+		mutex_lock(&rcore->iommu_lock);
+		iommu_unmap(iommu_get_domain_for_dev(rcore->dev), iova, bo->size);
+		mutex_unlock(&rcore->iommu_lock);
+	}
+}
+
+/**
+ * rocket_gem_prime_import_sg_table - Implementation of
+ * driver->gem_prime_import_sg_table.
+ * @dev: DRM device
+ * @attach: Attachment of the dma-buf to core 0
+ * @sgt: Mapping of the attachment
+ *
+ * The attachment is mapped in the IOMMU of core 0, which gives the DMA
+ * address of the BO. Another attachment would give the buffer a different
+ * address on each core, and the regcmds hold a single one, so the other
+ * cores get a copy of the mapping of core 0 instead. Like native BOs,
+ * imported BOs can then be used by jobs running on any core.
+ *
+ * Return: The new GEM object on success, an ERR_PTR() otherwise.
+ */
+struct drm_gem_object *
+rocket_gem_prime_import_sg_table(struct drm_device *dev,
+				 struct dma_buf_attachment *attach,
+				 struct sg_table *sgt)
+{
+	struct rocket_device *rdev = to_rocket_device(dev);
+	struct rocket_gem_object *rkt_obj;
+	struct drm_gem_object *obj;
+	int ret;
+
+	if (!rocket_gem_sgt_is_contiguous(sgt)) {
+		DRM_DEBUG("Imported dma-buf is not contiguous in the NPU address space\n");
+		return ERR_PTR(-EINVAL);
+	}
+
+	obj = drm_gem_shmem_prime_import_sg_table(dev, attach, sgt);
+	if (IS_ERR(obj))
+		return obj;
+
+	rkt_obj = to_rocket_bo(obj);
+	rkt_obj->size = obj->size;
+	mutex_init(&rkt_obj->mutex);
+
+	set_bit(0, &rkt_obj->mapped_cores);
+
+	for (unsigned int core = 1; core < rdev->num_cores; core++) {
+		ret = rocket_gem_bo_map_import_core(rkt_obj, &rdev->cores[core]);
+		if (ret) {
+			rocket_gem_bo_unmap_import_cores(rkt_obj);
+			/*
+			 * The object isn't marked as imported yet, and the
+			 * caller unmaps the attachment on error, so keep the
+			 * free path away from its sg_table.
+			 */
+			rkt_obj->base.sgt = NULL;
+			drm_gem_object_put(obj);
+			return ERR_PTR(ret);
+		}
+	}
+
+	return obj;
+}
+
 int rocket_ioctl_create_bo(struct drm_device *dev, void *data, struct drm_file *file)
 {
 	struct drm_rocket_create_bo *args = data;
-	struct rocket_device *rdev = to_rocket_device(dev);
 	struct drm_gem_shmem_object *shmem_obj;
 	struct rocket_gem_object *rkt_obj;
 	struct drm_gem_object *gem_obj;
-	struct sg_table *sgt;
 	int ret;
 
+	if (args->flags & ~ROCKET_BO_WC || args->pad)
+		return -EINVAL;
+
 	shmem_obj = drm_gem_shmem_create(dev, args->size);
 	if (IS_ERR(shmem_obj))
 		return PTR_ERR(shmem_obj);
@@ -86,58 +316,129 @@ int rocket_ioctl_create_bo(struct drm_device *dev, void *data, struct drm_file *
 	gem_obj = &shmem_obj->base;
 	rkt_obj = to_rocket_bo(gem_obj);
 
+	shmem_obj->map_wc = !!(args->flags & ROCKET_BO_WC);
+
+	rkt_obj->flags = args->flags;
 	rkt_obj->size = args->size;
 	rkt_obj->offset = 0;
 	mutex_init(&rkt_obj->mutex);
 
+	ret = rocket_gem_bo_map_cores(rkt_obj);
+	if (ret) {
+		drm_gem_object_put(gem_obj);
+		return ret;
+	}
+
 	ret = drm_gem_handle_create(file, gem_obj, &args->handle);
 	drm_gem_object_put(gem_obj);
 	if (ret)
-		goto err;
+		return ret;
 
-	mutex_lock(&rdev->iommu_lock);
+	args->offset = drm_vma_node_offset_addr(&gem_obj->vma_node);
+	args->dma_address = sg_dma_address(shmem_obj->sgt->sgl);
 
-	/* This will map the pages to the IOMMU linked to core 0 */
-	sgt = drm_gem_shmem_get_pages_sgt(shmem_obj);
-	if (IS_ERR(sgt)) {
-		ret = PTR_ERR(sgt);
-		goto err_unlock;
-	}
+	return 0;
+}
 
-	/* Map the pages to the IOMMUs linked to the other cores, so all cores can access this BO */
-	for (unsigned int core = 1; core < rdev->num_cores; core++) {
+/**
+ * rocket_gem_create_kernel_bo() - Allocate a BO for the driver's own use
+ * @rdev: Rocket device
+ * @size: Size in bytes of the BO
+ *
+ * Like all BOs, it is mapped in the IOMMUs of all cores. It is also mapped in
+ * the kernel address space. The CPU mapping is write-combined, so the driver can fill the BO
+ * from any context without doing cache maintenance afterwards.
+ *
+ * Return: The new BO on success, an ERR_PTR() otherwise.
+ */
+struct rocket_gem_object *rocket_gem_create_kernel_bo(struct rocket_device *rdev, size_t size)
+{
+	struct drm_gem_shmem_object *shmem_obj;
+	struct rocket_gem_object *rkt_obj;
+	struct iosys_map map;
+	int ret;
 
-		ret = iommu_map_sgtable(iommu_get_domain_for_dev(rdev->cores[core].dev),
-					sgt->sgl->dma_address,
-					sgt,
-					IOMMU_READ | IOMMU_WRITE);
-		if (ret < 0 || ret < args->size) {
-			DRM_ERROR("failed to map buffer: size=%d request_size=%u\n",
-				ret, args->size);
-			ret = -ENOMEM;
-			goto err_unlock;
-		}
+	shmem_obj = drm_gem_shmem_create(&rdev->ddev, size);
+	if (IS_ERR(shmem_obj))
+		return ERR_CAST(shmem_obj);
 
-		/* iommu_map_sgtable might have aligned the size */
-		rkt_obj->size = ret;
+	shmem_obj->map_wc = true;
 
-		dma_sync_sgtable_for_device(rdev->cores[core].dev, shmem_obj->sgt,
-					    DMA_BIDIRECTIONAL);
+	rkt_obj = to_rocket_bo(&shmem_obj->base);
+	rkt_obj->size = shmem_obj->base.size;
+	mutex_init(&rkt_obj->mutex);
+
+	ret = rocket_gem_bo_map_cores(rkt_obj);
+	if (ret)
+		goto err_put;
+
+	ret = drm_gem_vmap_unlocked(&shmem_obj->base, &map);
+	if (ret)
+		goto err_put;
+
+	rkt_obj->kvaddr = map.vaddr;
+	rkt_obj->dma_address = sg_dma_address(shmem_obj->sgt->sgl);
+
+	return rkt_obj;
+
+err_put:
+	drm_gem_object_put(&shmem_obj->base);
+
+	return ERR_PTR(ret);
+}
+
+/**
+ * rocket_gem_create_client_bo() - Allocate a BO for an in-kernel client
+ * @rdev: Rocket device
+ * @size: Size in bytes of the BO
+ * @dma_address: Returns the NPU address of the BO
+ *
+ * Like the BOs created with DRM_IOCTL_ROCKET_CREATE_BO, the BO is mapped in
+ * the IOMMUs of all cores. It is released by dropping the returned
+ * reference.
+ *
+ * Return: The new GEM object on success, an ERR_PTR() otherwise.
+ */
+struct drm_gem_object *rocket_gem_create_client_bo(struct rocket_device *rdev, size_t size,
+						   dma_addr_t *dma_address)
+{
+	struct drm_gem_shmem_object *shmem_obj;
+	struct rocket_gem_object *rkt_obj;
+	int ret;
+
+	shmem_obj = drm_gem_shmem_create(&rdev->ddev, size);
+	if (IS_ERR(shmem_obj))
+		return ERR_CAST(shmem_obj);
+
+	rkt_obj = to_rocket_bo(&shmem_obj->base);
+	rkt_obj->size = shmem_obj->base.size;
+	mutex_init(&rkt_obj->mutex);
+
+	ret = rocket_gem_bo_map_cores(rkt_obj);
+	if (ret) {
+		drm_gem_object_put(&shmem_obj->base);
+		return ERR_PTR(ret);
 	}
 
-	mutex_unlock(&rdev->iommu_lock);
+	*dma_address = sg_dma_address(shmem_obj->sgt->sgl);
 
-	args->offset = drm_vma_node_offset_addr(&gem_obj->vma_node);
-	args->dma_address = sg_dma_address(shmem_obj->sgt->sgl);
+	return &shmem_obj->base;
+}
 
-	return 0;
+/**
+ * rocket_gem_free_kernel_bo() - Release a BO allocated with
+ * rocket_gem_create_kernel_bo()
+ * @bo: BO to release, can be NULL
+ */
+void rocket_gem_free_kernel_bo(struct rocket_gem_object *bo)
+{
+	struct iosys_map map = IOSYS_MAP_INIT_VADDR(bo ? bo->kvaddr : NULL);
 
-err_unlock:
-	mutex_unlock(&rdev->iommu_lock);
-err:
-	drm_gem_shmem_object_free(gem_obj);
+	if (!bo)
+		return;
 
-	return ret;
+	drm_gem_vunmap_unlocked(&bo->base.base, &map);
+	drm_gem_object_put(&bo->base.base);
 }
 
 static inline enum dma_data_direction rocket_op_to_dma_dir(u32 op)
@@ -174,6 +475,14 @@ int rocket_ioctl_prep_bo(struct drm_device *dev, void *data, struct drm_file *fi
 
 	shmem_obj = &to_rocket_bo(gem_obj)->base;
 
+	/*
+	 * Write-combined BOs are never in the CPU caches, and CPU access to
+	 * imported BOs is synchronized by their exporter.
+	 */
+	if (to_rocket_bo(gem_obj)->flags & ROCKET_BO_WC ||
+	    gem_obj->import_attach)
+		goto out_put;
+
 	for (unsigned int core = 1; core < rdev->num_cores; core++) {
 		dma_sync_sgtable_for_cpu(rdev->cores[core].dev, shmem_obj->sgt,
 					 rocket_op_to_dma_dir(args->op));
@@ -181,6 +490,7 @@ int rocket_ioctl_prep_bo(struct drm_device *dev, void *data, struct drm_file *fi
 
 	to_rocket_bo(gem_obj)->last_cpu_prep_op = args->op;
 
+out_put:
 	drm_gem_object_put(gem_obj);
 
 	return ret;
@@ -201,6 +511,9 @@ int rocket_ioctl_fini_bo(struct drm_device *dev, void *data, struct drm_file *fi
 	rkt_obj = to_rocket_bo(gem_obj);
 	shmem_obj = &rkt_obj->base;
 
+	if (rkt_obj->flags & ROCKET_BO_WC || gem_obj->import_attach)
+		goto out_put;
+
 	WARN_ON(rkt_obj->last_cpu_prep_op == 0);
 
 	for (unsigned int core = 1; core < rdev->num_cores; core++) {
@@ -210,7 +523,34 @@ int rocket_ioctl_fini_bo(struct drm_device *dev, void *data, struct drm_file *fi
 
 	rkt_obj->last_cpu_prep_op = 0;
 
+out_put:
 	drm_gem_object_put(gem_obj);
 
 	return 0;
 }
+
+int rocket_ioctl_get_bo_info(struct drm_device *dev, void *data, struct drm_file *file)
+{
+	struct drm_rocket_get_bo_info *args = data;
+	struct drm_gem_object *gem_obj;
+	int ret;
+
+	if (args->pad)
+		return -EINVAL;
+
+	gem_obj = drm_gem_object_lookup(file, args->handle);
+	if (!gem_obj)
+		return -ENOENT;
+
+	ret = drm_gem_create_mmap_offset(gem_obj);
+	if (ret)
+		goto out_put;
+
+	args->offset = drm_vma_node_offset_addr(&gem_obj->vma_node);
+	args->dma_address = sg_dma_address(to_rocket_bo(gem_obj)->base.sgt->sgl);
+
+out_put:
+	drm_gem_object_put(gem_obj);
+
+	return ret;
+}
@@ -12,17 +12,42 @@ struct rocket_gem_object {
 	struct mutex mutex;
 	size_t size;
 	u32 offset;
+	/* Mask of ROCKET_BO_x flags the BO was created with */
+	u32 flags;
 	u32 last_cpu_prep_op;
+
+	/* Bitmask of the cores whose IOMMU this BO is mapped in */
+	unsigned long mapped_cores;
+
+	/* Only valid for BOs created with rocket_gem_create_kernel_bo() */
+	void *kvaddr;
+	dma_addr_t dma_address;
 };
 
+struct dma_buf_attachment;
+struct rocket_device;
+
 struct drm_gem_object *rocket_gem_create_object(struct drm_device *dev, size_t size);
 
+struct drm_gem_object *
+rocket_gem_prime_import_sg_table(struct drm_device *dev,
+				 struct dma_buf_attachment *attach,
+				 struct sg_table *sgt);
+
+struct rocket_gem_object *rocket_gem_create_kernel_bo(struct rocket_device *rdev, size_t size);
+void rocket_gem_free_kernel_bo(struct rocket_gem_object *bo);
+
+struct drm_gem_object *rocket_gem_create_client_bo(struct rocket_device *rdev, size_t size,
+						   dma_addr_t *dma_address);
+
 int rocket_ioctl_create_bo(struct drm_device *dev, void *data, struct drm_file *file);
 
 int rocket_ioctl_prep_bo(struct drm_device *dev, void *data, struct drm_file *file);
 
 int rocket_ioctl_fini_bo(struct drm_device *dev, void *data, struct drm_file *file);
 
+int rocket_ioctl_get_bo_info(struct drm_device *dev, void *data, struct drm_file *file);
+
 static inline
 struct  rocket_gem_object *to_rocket_bo(struct drm_gem_object *obj)
 {
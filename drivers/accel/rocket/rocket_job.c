@@ -3,9 +3,11 @@
 /* Copyright 2019 Collabora ltd. */
 /* Copyright 2024 Tomeu Vizoso <tomeu@tomeuvizoso.net> */
 
+#include <drm/drm_auth.h>
 #include <drm/drm_file.h>
 #include <drm/drm_gem.h>
 #include <drm/rocket_accel.h>
+#include <linux/capability.h>
 #include <linux/interrupt.h>
 #include <linux/platform_device.h>
 #include <linux/pm_runtime.h>
@@ -13,11 +15,47 @@
 #include "rocket_core.h"
 #include "rocket_device.h"
 #include "rocket_drv.h"
+#include "rocket_gem.h"
 #include "rocket_job.h"
 #include "rocket_registers.h"
+#include "rocket_trace.h"
 
 #define JOB_TIMEOUT_MS 500
 
+/* Maximum number of tasks handed to the PC in a single submission */
+#define ROCKET_MAX_CHAINED_TASKS 1024
+
+static bool rocket_chain_tasks;
+module_param_named(chain_tasks, rocket_chain_tasks, bool, 0444);
+MODULE_PARM_DESC(chain_tasks,
+		 "Submit all the tasks of a job to the PC in one go, with a single interrupt at the end, experimental (default: false)");
+
+static bool rocket_irq_resubmit = true;
+module_param_named(irq_resubmit, rocket_irq_resubmit, bool, 0644);
+MODULE_PARM_DESC(irq_resubmit,
+		 "Submit the next tasks of a job from the hard IRQ handler (default: true)");
+
+/*
+ * Task descriptor fetched by the PC from REG_PC_TASK_DMA_BASE_ADDR when more
+ * than one task is executed per submission.
+ *
+ * The TRM does not document this table. The layout mirrors struct rknpu_task
+ * of the vendor driver (include/uapi/drm/rknpu_ioctl.h in Rockchip's BSP),
+ * whose array is handed to the PC the same way, and has not been validated on
+ * hardware yet. This is why chaining stays disabled by default.
+ */
+struct rocket_hw_task {
+	u32 flags;
+	u32 op_idx;
+	u32 enable_mask;
+	u32 int_mask;
+	u32 int_clear;
+	u32 int_status;
+	u32 regcfg_amount;
+	u32 regcfg_offset;
+	u64 regcmd_addr;
+} __packed;
+
 #define job_write(dev, reg, data) writel(data, dev->iomem + (reg))
 #define job_read(dev, reg) readl(dev->iomem + (reg))
 
@@ -56,9 +94,17 @@ static const struct dma_fence_ops rocket_fence_ops = {
 	.get_timeline_name = rocket_fence_get_timeline_name,
 };
 
-static struct dma_fence *rocket_fence_create(struct rocket_core *core)
+/*
+ * A job only preempts jobs of a lower priority, so the jobs of one priority
+ * level complete in the order they were run, but not the jobs of a core as a
+ * whole. Each priority level gets its own fence context to keep the seqnos
+ * of a context signalling in order.
+ */
+static struct dma_fence *rocket_fence_create(struct rocket_core *core,
+					     struct rocket_job *job)
 {
 	struct rocket_device *rdev = core->rdev;
+	enum drm_sched_priority prio = job->base.s_priority;
 	struct rocket_fence *fence;
 
 	fence = kzalloc(sizeof(*fence), GFP_KERNEL);
@@ -66,9 +112,9 @@ static struct dma_fence *rocket_fence_create(struct rocket_core *core)
 		return ERR_PTR(-ENOMEM);
 
 	fence->dev = &rdev->ddev;
-	fence->seqno = ++core->emit_seqno;
+	fence->seqno = ++core->emit_seqno[prio];
 	dma_fence_init(&fence->base, &rocket_fence_ops, &core->job_lock,
-		       core->fence_context, fence->seqno);
+		       core->fence_context + prio, fence->seqno);
 
 	return &fence->base;
 }
@@ -124,11 +170,42 @@ rocket_copy_tasks(struct drm_device *dev,
 	return ret;
 }
 
+static u32 rocket_job_fill_task_table(struct rocket_core *core, struct rocket_job *job)
+{
+	struct rocket_hw_task *table = core->task_table->kvaddr;
+	u32 count = min_t(u32, job->task_count - job->next_task_idx, ROCKET_MAX_CHAINED_TASKS);
+	u32 i;
+
+	/*
+	 * Only one job is in flight per core and the PC is done with the
+	 * previous chunk by the time we get here, so the table can be reused.
+	 * It is mapped write-combined, and the barrier in the writel() that
+	 * kicks the PC orders these stores before it.
+	 */
+	for (i = 0; i < count; i++) {
+		struct rocket_task *task = &job->tasks[job->next_task_idx + i];
+		struct rocket_hw_task *hw_task = &table[i];
+
+		hw_task->flags = 0;
+		hw_task->op_idx = i;
+		hw_task->enable_mask = 0;
+		hw_task->int_mask = PC_INTERRUPT_MASK_DPU_0 | PC_INTERRUPT_MASK_DPU_1;
+		hw_task->int_clear = PC_INTERRUPT_CLEAR_DPU_0 | PC_INTERRUPT_CLEAR_DPU_1;
+		hw_task->int_status = 0;
+		hw_task->regcfg_amount = task->regcmd_count;
+		hw_task->regcfg_offset = 0;
+		hw_task->regcmd_addr = task->regcmd;
+	}
+
+	return count;
+}
+
 static void rocket_job_hw_submit(struct rocket_core *core, struct rocket_job *job)
 {
 	struct rocket_task *task;
+	dma_addr_t task_table = 0;
 	bool task_pp_en = 1;
-	bool task_count = 1;
+	u32 task_count = 1;
 
 	/* GO ! */
 
@@ -136,7 +213,15 @@ static void rocket_job_hw_submit(struct rocket_core *core, struct rocket_job *jo
 	if (!atomic_read(&core->reset.pending)) {
 
 		task = &job->tasks[job->next_task_idx];
-		job->next_task_idx++;   /* TODO: Do this only after a successful run? */
+
+		if (core->task_table) {
+			task_count = rocket_job_fill_task_table(core, job);
+			task_table = core->task_table->dma_address;
+		}
+
+		core->in_flight_first_task = job->next_task_idx;
+		core->in_flight_task_count = task_count;
+		job->next_task_idx += task_count;   /* TODO: Do this only after a successful run? */
 
 		rocket_write(core, REG_PC_BASE_ADDRESS, 0x1);
 
@@ -153,13 +238,14 @@ static void rocket_job_hw_submit(struct rocket_core *core, struct rocket_job *jo
 
 		rocket_write(core, REG_PC_TASK_CON, ((0x6 | task_pp_en) << 12) | task_count);
 
-		rocket_write(core, REG_PC_TASK_DMA_BASE_ADDR, 0x0);
+		rocket_write(core, REG_PC_TASK_DMA_BASE_ADDR, task_table);
 
+		core->in_flight_start_ns = ktime_get_ns();
 		rocket_write(core, REG_PC_OPERATION_ENABLE, 0x1);
 
 		dev_dbg(core->dev,
-			"Submitted regcmd at 0x%llx to core %d",
-			task->regcmd, core->index);
+			"Submitted %u task(s) starting at regcmd 0x%llx to core %d",
+			task_count, task->regcmd, core->index);
 	}
 }
 
@@ -186,12 +272,13 @@ static int rocket_acquire_object_fences(struct drm_gem_object **bos,
 
 static void rocket_attach_object_fences(struct drm_gem_object **bos,
 					  int bo_count,
-					  struct dma_fence *fence)
+					  struct dma_fence *fence,
+					  enum dma_resv_usage usage)
 {
 	int i;
 
 	for (i = 0; i < bo_count; i++)
-		dma_resv_add_fence(bos[i]->resv, fence, DMA_RESV_USAGE_WRITE);
+		dma_resv_add_fence(bos[i]->resv, fence, usage);
 }
 
 static int rocket_job_push(struct rocket_job *job)
@@ -228,12 +315,17 @@ static int rocket_job_push(struct rocket_job *job)
 	}
 
 	kref_get(&job->refcount); /* put by scheduler job completion */
+	atomic_inc(&job->core->pending_jobs);
 
+	trace_rocket_job_queue(job);
 	drm_sched_entity_push_job(&job->base);
 
 	mutex_unlock(&rdev->sched_lock);
 
-	rocket_attach_object_fences(job->out_bos, job->out_bo_count, job->inference_done_fence);
+	rocket_attach_object_fences(job->in_bos, job->in_bo_count, job->inference_done_fence,
+				    DMA_RESV_USAGE_READ);
+	rocket_attach_object_fences(job->out_bos, job->out_bo_count, job->inference_done_fence,
+				    DMA_RESV_USAGE_WRITE);
 
 err_unlock:
 	drm_gem_unlock_reservations(bos, job->in_bo_count + job->out_bo_count, &acquire_ctx);
@@ -266,7 +358,9 @@ static void rocket_job_cleanup(struct kref *ref)
 		kvfree(job->out_bos);
 	}
 
-	kfree(job->tasks);
+	kvfree(job->tasks);
+
+	rocket_file_priv_put(job->file_priv);
 
 	kfree(job);
 }
@@ -282,20 +376,22 @@ static void rocket_job_free(struct drm_sched_job *sched_job)
 
 	drm_sched_job_cleanup(sched_job);
 
+	atomic_dec(&job->core->pending_jobs);
+
 	rocket_job_put(job);
 }
 
 static struct rocket_core *sched_to_core(struct rocket_device *rdev,
 					 struct drm_gpu_scheduler *sched)
 {
-	unsigned int core;
-
-	for (core = 0; core < rdev->num_cores; core++) {
-		if (&rdev->cores[core].sched == sched)
-			return &rdev->cores[core];
-	}
+	return container_of(sched, struct rocket_core, sched);
+}
 
-	return NULL;
+static void rocket_job_start(struct rocket_core *core, struct rocket_job *job)
+{
+	core->in_flight_job = job;
+	trace_rocket_job_run(job);
+	rocket_job_hw_submit(core, job);
 }
 
 static struct dma_fence *rocket_job_run(struct drm_sched_job *sched_job)
@@ -316,7 +412,7 @@ static struct dma_fence *rocket_job_run(struct drm_sched_job *sched_job)
 	if (job->next_task_idx == job->task_count)
 		return NULL;
 
-	fence = rocket_fence_create(core);
+	fence = rocket_fence_create(core, job);
 	if (IS_ERR(fence))
 		return fence;
 
@@ -328,52 +424,134 @@ static struct dma_fence *rocket_job_run(struct drm_sched_job *sched_job)
 	if (ret < 0)
 		return fence;
 
-	spin_lock(&core->job_lock);
+	spin_lock_irq(&core->job_lock);
 
-	core->in_flight_job = job;
-	rocket_job_hw_submit(core, job);
+	/*
+	 * The scheduler lets us have a second job while one is executing. It
+	 * waits for the current one to finish, unless it has a higher priority,
+	 * in which case it takes over the core at the next task boundary.
+	 */
+	if (!core->in_flight_job) {
+		rocket_devfreq_record_busy(&rdev->devfreq);
+		rocket_job_start(core, job);
+	} else {
+		core->queued_job = job;
+	}
 
-	spin_unlock(&core->job_lock);
+	spin_unlock_irq(&core->job_lock);
 
 	return fence;
 }
 
-static void rocket_job_handle_done(struct rocket_core *core,
+static bool rocket_job_should_preempt(struct rocket_core *core,
+				      struct rocket_job *job)
+{
+	struct rocket_job *next = core->queued_job;
+
+	/* Lower values mean higher priorities */
+	return next && next->base.s_priority < job->base.s_priority;
+}
+
+/*
+ * Returns whether another job took over the core, in which case the timeout
+ * of the scheduler has to be restarted for it.
+ */
+static bool rocket_job_handle_done(struct rocket_core *core,
 				   struct rocket_job *job)
 {
+	u64 duration_ns = ktime_get_ns() - core->in_flight_start_ns;
+	struct rocket_job *next;
+
+	atomic64_add(duration_ns, &job->file_priv->busy_ns[core->index]);
+	trace_rocket_task_done(job, core->in_flight_first_task,
+			       core->in_flight_task_count, duration_ns);
+
 	if (job->next_task_idx < job->task_count) {
+		if (rocket_job_should_preempt(core, job)) {
+			next = core->queued_job;
+			core->queued_job = job;
+			rocket_job_start(core, next);
+			return true;
+		}
+
 		rocket_job_hw_submit(core, job);
-		return;
+		return false;
 	}
 
+	next = core->queued_job;
+	core->queued_job = NULL;
 	core->in_flight_job = NULL;
+
+	trace_rocket_job_done(job);
 	dma_fence_signal_locked(job->done_fence);
 	pm_runtime_put_autosuspend(core->dev);
+
+	if (!next) {
+		rocket_devfreq_record_idle(&core->rdev->devfreq);
+		return false;
+	}
+
+	rocket_job_start(core, next);
+	return true;
 }
 
-static void rocket_job_handle_irq(struct rocket_core *core)
+static void rocket_job_ack_irq(struct rocket_core *core)
 {
-	uint32_t status, raw_status;
-
 	pm_runtime_mark_last_busy(core->dev);
 
-	status = rocket_read(core, REG_PC_INTERRUPT_STATUS);
-	raw_status = rocket_read(core, REG_PC_INTERRUPT_RAW_STATUS);
-
 	rocket_write(core, REG_PC_OPERATION_ENABLE, 0x0);
 	rocket_write(core, REG_PC_INTERRUPT_CLEAR, 0x1ffff);
+}
 
-	spin_lock(&core->job_lock);
+static bool rocket_job_handle_irq(struct rocket_core *core)
+{
+	unsigned long flags;
+	bool switched = false;
+
+	rocket_job_ack_irq(core);
+
+	spin_lock_irqsave(&core->job_lock, flags);
 
 	if (core->in_flight_job)
-		rocket_job_handle_done(core, core->in_flight_job);
+		switched = rocket_job_handle_done(core, core->in_flight_job);
+
+	spin_unlock_irqrestore(&core->job_lock, flags);
+
+	return switched;
+}
+
+/*
+ * Called from the hard IRQ handler. If the in-flight job still has tasks
+ * left, submit the next ones right away instead of waiting for the threaded
+ * handler to be scheduled, which keeps the NPU busy on loaded systems. Only
+ * the completion of the job, with its fence signalling, and the switches to
+ * another job, which restart the scheduler timeout, are left to the thread.
+ */
+static bool rocket_job_try_resubmit(struct rocket_core *core)
+{
+	struct rocket_job *job;
+	bool resubmitted = false;
+
+	spin_lock(&core->job_lock);
+
+	job = core->in_flight_job;
+	if (job && job->next_task_idx < job->task_count &&
+	    !rocket_job_should_preempt(core, job) &&
+	    !atomic_read(&core->reset.pending)) {
+		rocket_job_ack_irq(core);
+		rocket_job_handle_done(core, job);
+		resubmitted = true;
+	}
 
 	spin_unlock(&core->job_lock);
+
+	return resubmitted;
 }
 
 static void
 rocket_reset(struct rocket_core *core, struct drm_sched_job *bad)
 {
+	struct drm_sched_job *guilty = bad;
 	bool cookie;
 
 	if (!atomic_read(&core->reset.pending))
@@ -397,9 +575,6 @@ rocket_reset(struct rocket_core *core, struct drm_sched_job *bad)
 
 	cookie = dma_fence_begin_signalling();
 
-	if (bad)
-		drm_sched_increase_karma(bad);
-
 	/*
 	 * Mask job interrupts and synchronize to make sure we won't be
 	 * interrupted during our reset.
@@ -418,12 +593,27 @@ rocket_reset(struct rocket_core *core, struct drm_sched_job *bad)
 	 * Let's also make sure the cycle counting register's refcnt is
 	 * kept balanced to prevent it from running forever
 	 */
-	spin_lock(&core->job_lock);
-	if (core->in_flight_job)
+	spin_lock_irq(&core->job_lock);
+	if (core->in_flight_job) {
+		/*
+		 * The timeout is reported for the oldest job of the core, which
+		 * may have been preempted by the one actually stuck.
+		 */
+		if (bad)
+			guilty = &core->in_flight_job->base;
+		pm_runtime_put_noidle(core->dev);
+		rocket_devfreq_record_idle(&core->rdev->devfreq);
+	}
+	if (core->queued_job)
 		pm_runtime_put_noidle(core->dev);
 
 	core->in_flight_job = NULL;
-	spin_unlock(&core->job_lock);
+	core->queued_job = NULL;
+	spin_unlock_irq(&core->job_lock);
+
+	/* The scheduler is stopped, the jobs can't be freed under us */
+	if (guilty)
+		drm_sched_increase_karma(guilty);
 
 	/* Proceed with reset now. */
 	pm_runtime_force_suspend(core->dev);
@@ -505,7 +695,13 @@ static irqreturn_t rocket_job_irq_handler_thread(int irq, void *data)
 {
 	struct rocket_core *core = data;
 
-	rocket_job_handle_irq(core);
+	/*
+	 * The scheduler times the oldest job of the core only, give the full
+	 * timeout to the one that just started instead of counting the time it
+	 * waited for, or was preempted by, another job.
+	 */
+	if (rocket_job_handle_irq(core))
+		drm_sched_resume_timeout(&core->sched, core->sched.timeout);
 
 	return IRQ_HANDLED;
 }
@@ -524,6 +720,9 @@ static irqreturn_t rocket_job_irq_handler(int irq, void *data)
 
 	rocket_write(core, REG_PC_INTERRUPT_MASK, 0x0);
 
+	if (rocket_irq_resubmit && rocket_job_try_resubmit(core))
+		return IRQ_HANDLED;
+
 	return IRQ_WAKE_THREAD;
 }
 
@@ -553,11 +752,11 @@ int rocket_job_init(struct rocket_core *core)
 	if (!core->reset.wq)
 		return -ENOMEM;
 
-	core->fence_context = dma_fence_context_alloc(1);
+	core->fence_context = dma_fence_context_alloc(DRM_SCHED_PRIORITY_COUNT);
 
 	args.ops = &rocket_sched_ops;
 	args.num_rqs = DRM_SCHED_PRIORITY_COUNT;
-	args.credit_limit = 1;
+	args.credit_limit = 2;
 	args.hang_limit = 0;
 	args.timeout = msecs_to_jiffies(JOB_TIMEOUT_MS);
 	args.timeout_wq = core->reset.wq;
@@ -588,33 +787,138 @@ void rocket_job_fini(struct rocket_core *core)
 	destroy_workqueue(core->reset.wq);
 }
 
-int rocket_job_open(struct rocket_file_priv *rocket_priv)
+/**
+ * rocket_job_alloc_task_tables() - Allocate the per-core task descriptor tables
+ * @rdev: Rocket device
+ *
+ * Must be called once all cores are bound, as the tables are mapped in the
+ * IOMMUs of all of them. Does nothing unless task chaining is enabled.
+ *
+ * Return: 0 on success, a negative error code otherwise.
+ */
+int rocket_job_alloc_task_tables(struct rocket_device *rdev)
+{
+	size_t size = ROCKET_MAX_CHAINED_TASKS * sizeof(struct rocket_hw_task);
+	unsigned int core;
+
+	if (!rocket_chain_tasks)
+		return 0;
+
+	for (core = 0; core < rdev->num_cores; core++) {
+		struct rocket_gem_object *table = rocket_gem_create_kernel_bo(rdev, size);
+
+		if (IS_ERR(table)) {
+			rocket_job_free_task_tables(rdev);
+			return PTR_ERR(table);
+		}
+
+		rdev->cores[core].task_table = table;
+	}
+
+	return 0;
+}
+
+void rocket_job_free_task_tables(struct rocket_device *rdev)
+{
+	unsigned int core;
+
+	for (core = 0; core < rdev->num_cores; core++) {
+		rocket_gem_free_kernel_bo(rdev->cores[core].task_table);
+		rdev->cores[core].task_table = NULL;
+	}
+}
+
+static int rocket_job_init_entities(struct rocket_device *rdev,
+				    struct drm_sched_entity *entities,
+				    enum drm_sched_priority priority)
 {
-	struct rocket_device *rdev = rocket_priv->rdev;
-	struct drm_gpu_scheduler **scheds = kmalloc_array(rdev->num_cores, sizeof(scheds),
-							  GFP_KERNEL);
 	unsigned int core;
 	int ret;
 
-	for (core = 0; core < rdev->num_cores; core++)
-		scheds[core] = &rdev->cores[core].sched;
+	for (core = 0; core < rdev->num_cores; core++) {
+		struct drm_gpu_scheduler *sched = &rdev->cores[core].sched;
 
-	ret = drm_sched_entity_init(&rocket_priv->sched_entity,
-				    DRM_SCHED_PRIORITY_NORMAL,
-				    scheds,
-				    rdev->num_cores, NULL);
-	if (WARN_ON(ret))
-		return ret;
+		ret = drm_sched_entity_init(&entities[core], priority, &sched, 1,
+					    NULL);
+		if (WARN_ON(ret))
+			goto err_destroy;
+	}
 
 	return 0;
+
+err_destroy:
+	while (core--)
+		drm_sched_entity_destroy(&entities[core]);
+
+	return ret;
+}
+
+static void rocket_job_destroy_entities(struct rocket_device *rdev,
+					struct drm_sched_entity *entities)
+{
+	unsigned int core;
+
+	for (core = 0; core < rdev->num_cores; core++)
+		drm_sched_entity_destroy(&entities[core]);
+}
+
+int rocket_job_open(struct rocket_file_priv *rocket_priv)
+{
+	struct rocket_device *rdev = rocket_priv->rdev;
+	int ret;
+
+	mutex_init(&rocket_priv->submit_lock);
+
+	rocket_priv->sched_entities = kcalloc(rdev->num_cores,
+					      sizeof(*rocket_priv->sched_entities),
+					      GFP_KERNEL);
+	if (!rocket_priv->sched_entities)
+		return -ENOMEM;
+
+	rocket_priv->busy_ns = kcalloc(rdev->num_cores, sizeof(*rocket_priv->busy_ns),
+				       GFP_KERNEL);
+	if (!rocket_priv->busy_ns) {
+		kfree(rocket_priv->sched_entities);
+		return -ENOMEM;
+	}
+
+	ret = rocket_job_init_entities(rdev, rocket_priv->sched_entities,
+				       DRM_SCHED_PRIORITY_NORMAL);
+	if (ret) {
+		kfree(rocket_priv->busy_ns);
+		kfree(rocket_priv->sched_entities);
+	}
+
+	return ret;
 }
 
 void rocket_job_close(struct rocket_file_priv *rocket_priv)
 {
-	struct drm_sched_entity *entity = &rocket_priv->sched_entity;
+	rocket_job_destroy_entities(rocket_priv->rdev, rocket_priv->sched_entities);
+
+	kfree(rocket_priv->sched_entities);
+	rocket_priv->sched_entities = NULL;
+	mutex_destroy(&rocket_priv->submit_lock);
+}
+
+/*
+ * Jobs don't depend on each other beyond what is expressed through the
+ * implicit fences of their BOs, so each one can go to whichever core has
+ * the least work queued, with idle cores being picked first.
+ */
+static struct rocket_core *rocket_job_pick_core(struct rocket_device *rdev)
+{
+	struct rocket_core *best = &rdev->cores[0];
+	unsigned int core;
+
+	for (core = 1; core < rdev->num_cores; core++) {
+		struct rocket_core *candidate = &rdev->cores[core];
+
+		if (atomic_read(&candidate->pending_jobs) < atomic_read(&best->pending_jobs))
+			best = candidate;
+	}
 
-	kfree(entity->sched_list);
-	drm_sched_entity_destroy(entity);
+	return best;
 }
 
 int rocket_job_is_idle(struct rocket_core *core)
@@ -644,9 +948,11 @@ static int rocket_ioctl_submit_job(struct drm_device *dev, struct drm_file *file
 	kref_init(&rjob->refcount);
 
 	rjob->rdev = rdev;
+	rjob->core = rocket_job_pick_core(rdev);
+	rjob->file_priv = rocket_file_priv_get(file_priv);
 
 	ret = drm_sched_job_init(&rjob->base,
-				 &file_priv->sched_entity,
+				 &file_priv->sched_entities[rjob->core->index],
 				 1, NULL);
 	if (ret)
 		goto out_put_job;
@@ -675,6 +981,9 @@ static int rocket_ioctl_submit_job(struct drm_device *dev, struct drm_file *file
 	if (ret)
 		goto out_cleanup_job;
 
+	/* The entities are in use from now on, the priority is fixed */
+	file_priv->submitted = true;
+
 out_cleanup_job:
 	if (ret)
 		drm_sched_job_cleanup(&rjob->base);
@@ -684,9 +993,105 @@ static int rocket_ioctl_submit_job(struct drm_device *dev, struct drm_file *file
 	return ret;
 }
 
+/**
+ * rocket_job_submit_kernel() - Queue a job built by an in-kernel client
+ * @file_priv: Context the job is accounted to
+ * @tasks: Tasks of the job
+ * @task_count: Number of tasks
+ * @in_bos: BOs read by the job
+ * @in_bo_count: Number of BOs in @in_bos
+ * @out_bos: BOs written by the job
+ * @out_bo_count: Number of BOs in @out_bos
+ *
+ * Same as DRM_IOCTL_ROCKET_SUBMIT for a single job, except that everything
+ * is passed by the kernel. The job takes its own references to the BOs.
+ *
+ * Return: The fence signalled when the job is done, an ERR_PTR() otherwise.
+ */
+struct dma_fence *rocket_job_submit_kernel(struct rocket_file_priv *file_priv,
+					   const struct drm_rocket_task *tasks, u32 task_count,
+					   struct drm_gem_object **in_bos, u32 in_bo_count,
+					   struct drm_gem_object **out_bos, u32 out_bo_count)
+{
+	struct rocket_device *rdev = file_priv->rdev;
+	struct dma_fence *fence = NULL;
+	struct rocket_job *rjob;
+	unsigned int i;
+	int ret;
+
+	if (!task_count)
+		return ERR_PTR(-EINVAL);
+
+	for (i = 0; i < task_count; i++) {
+		if (!tasks[i].regcmd_count)
+			return ERR_PTR(-EINVAL);
+	}
+
+	rjob = kzalloc(sizeof(*rjob), GFP_KERNEL);
+	if (!rjob)
+		return ERR_PTR(-ENOMEM);
+
+	kref_init(&rjob->refcount);
+
+	rjob->rdev = rdev;
+	rjob->core = rocket_job_pick_core(rdev);
+	rjob->file_priv = rocket_file_priv_get(file_priv);
+
+	mutex_lock(&file_priv->submit_lock);
+
+	ret = drm_sched_job_init(&rjob->base,
+				 &file_priv->sched_entities[rjob->core->index],
+				 1, NULL);
+	if (ret)
+		goto out_unlock;
+
+	rjob->tasks = kvmalloc_array(task_count, sizeof(*rjob->tasks), GFP_KERNEL);
+	rjob->in_bos = kvmalloc_array(in_bo_count, sizeof(*rjob->in_bos), GFP_KERNEL);
+	rjob->out_bos = kvmalloc_array(out_bo_count, sizeof(*rjob->out_bos), GFP_KERNEL);
+	if (!rjob->tasks || !rjob->in_bos || !rjob->out_bos) {
+		ret = -ENOMEM;
+		goto out_cleanup_job;
+	}
+
+	rjob->task_count = task_count;
+	for (i = 0; i < task_count; i++) {
+		rjob->tasks[i].regcmd = tasks[i].regcmd;
+		rjob->tasks[i].regcmd_count = tasks[i].regcmd_count;
+	}
+
+	for (i = 0; i < in_bo_count; i++) {
+		drm_gem_object_get(in_bos[i]);
+		rjob->in_bos[i] = in_bos[i];
+	}
+	rjob->in_bo_count = in_bo_count;
+
+	for (i = 0; i < out_bo_count; i++) {
+		drm_gem_object_get(out_bos[i]);
+		rjob->out_bos[i] = out_bos[i];
+	}
+	rjob->out_bo_count = out_bo_count;
+
+	ret = rocket_job_push(rjob);
+	if (ret)
+		goto out_cleanup_job;
+
+	file_priv->submitted = true;
+	fence = dma_fence_get(rjob->inference_done_fence);
+
+out_cleanup_job:
+	if (ret)
+		drm_sched_job_cleanup(&rjob->base);
+out_unlock:
+	mutex_unlock(&file_priv->submit_lock);
+	rocket_job_put(rjob);
+
+	return ret ? ERR_PTR(ret) : fence;
+}
+
 int rocket_ioctl_submit(struct drm_device *dev, void *data, struct drm_file *file)
 {
 	struct drm_rocket_submit *args = data;
+	struct rocket_file_priv *file_priv = file->driver_priv;
 	struct drm_rocket_job *jobs;
 	int ret = 0;
 	unsigned int i = 0;
@@ -705,11 +1110,79 @@ int rocket_ioctl_submit(struct drm_device *dev, void *data, struct drm_file *fil
 		goto exit;
 	}
 
+	mutex_lock(&file_priv->submit_lock);
+
 	for (i = 0; i < args->job_count; i++)
 		rocket_ioctl_submit_job(dev, file, &jobs[i]);
 
+	mutex_unlock(&file_priv->submit_lock);
+
 exit:
 	kfree(jobs);
 
 	return ret;
 }
+
+int rocket_ioctl_set_priority(struct drm_device *dev, void *data, struct drm_file *file)
+{
+	struct drm_rocket_set_priority *args = data;
+	struct rocket_file_priv *file_priv = file->driver_priv;
+	struct rocket_device *rdev = file_priv->rdev;
+	struct drm_sched_entity *entities;
+	enum drm_sched_priority priority;
+	int ret;
+
+	if (args->pad)
+		return -EINVAL;
+
+	switch (args->priority) {
+	case ROCKET_PRIORITY_LOW:
+		priority = DRM_SCHED_PRIORITY_LOW;
+		break;
+	case ROCKET_PRIORITY_MEDIUM:
+		priority = DRM_SCHED_PRIORITY_NORMAL;
+		break;
+	case ROCKET_PRIORITY_HIGH:
+		/* Higher priorities require CAP_SYS_NICE or DRM_MASTER */
+		if (!capable(CAP_SYS_NICE) && !drm_is_current_master(file))
+			return -EACCES;
+		priority = DRM_SCHED_PRIORITY_HIGH;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	mutex_lock(&file_priv->submit_lock);
+
+	/*
+	 * The entities are bound to a single scheduler each, so the scheduler
+	 * never moves them to the run queue of another priority. Since nothing
+	 * has been queued on them yet, they can simply be replaced. The new ones
+	 * are set up first, so that a failure leaves the current ones in place.
+	 */
+	if (file_priv->submitted) {
+		ret = -EBUSY;
+		goto out_unlock;
+	}
+
+	entities = kcalloc(rdev->num_cores, sizeof(*entities), GFP_KERNEL);
+	if (!entities) {
+		ret = -ENOMEM;
+		goto out_unlock;
+	}
+
+	ret = rocket_job_init_entities(rdev, entities, priority);
+	if (ret) {
+		kfree(entities);
+		goto out_unlock;
+	}
+
+	rocket_job_destroy_entities(rdev, file_priv->sched_entities);
+	kfree(file_priv->sched_entities);
+	file_priv->sched_entities = entities;
+
+out_unlock:
+	mutex_unlock(&file_priv->submit_lock);
+
+	return ret;
+}
@@ -20,6 +20,12 @@ struct rocket_job {
 
 	struct rocket_device *rdev;
 
+	/* Core the job has been dispatched to */
+	struct rocket_core *core;
+
+	/* File that submitted the job, accounted for the time spent on the NPU */
+	struct rocket_file_priv *file_priv;
+
 	struct drm_gem_object **in_bos;
 	struct drm_gem_object **out_bos;
 
@@ -40,11 +46,21 @@ struct rocket_job {
 };
 
 int rocket_ioctl_submit(struct drm_device *dev, void *data, struct drm_file *file);
+int rocket_ioctl_set_priority(struct drm_device *dev, void *data, struct drm_file *file);
 
 int rocket_job_init(struct rocket_core *core);
 void rocket_job_fini(struct rocket_core *core);
+int rocket_job_alloc_task_tables(struct rocket_device *rdev);
+void rocket_job_free_task_tables(struct rocket_device *rdev);
 int rocket_job_open(struct rocket_file_priv *rocket_priv);
 void rocket_job_close(struct rocket_file_priv *rocket_priv);
 int rocket_job_is_idle(struct rocket_core *core);
 
+struct drm_rocket_task;
+
+struct dma_fence *rocket_job_submit_kernel(struct rocket_file_priv *file_priv,
+					   const struct drm_rocket_task *tasks, u32 task_count,
+					   struct drm_gem_object **in_bos, u32 in_bo_count,
+					   struct drm_gem_object **out_bos, u32 out_bo_count);
+
 #endif
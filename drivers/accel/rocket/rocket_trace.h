@@ -0,0 +1,85 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright 2024 Tomeu Vizoso <tomeu@tomeuvizoso.net> */
+
+#if !defined(_ROCKET_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define _ROCKET_TRACE_H_
+
+#include <linux/tracepoint.h>
+
+#include "rocket_core.h"
+#include "rocket_job.h"
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM rocket
+#define TRACE_INCLUDE_FILE rocket_trace
+
+DECLARE_EVENT_CLASS(rocket_job,
+	TP_PROTO(struct rocket_job *job),
+	TP_ARGS(job),
+	TP_STRUCT__entry(
+		__field(u64, context)
+		__field(u64, seqno)
+		__field(unsigned int, core)
+		__field(u32, task_count)
+		),
+
+	TP_fast_assign(
+		__entry->context = job->base.s_fence->finished.context;
+		__entry->seqno = job->base.s_fence->finished.seqno;
+		__entry->core = job->core->index;
+		__entry->task_count = job->task_count;
+		),
+
+	TP_printk("context=%llu seqno=%llu core=%u tasks=%u",
+		  __entry->context, __entry->seqno, __entry->core,
+		  __entry->task_count)
+);
+
+DEFINE_EVENT(rocket_job, rocket_job_queue,
+	     TP_PROTO(struct rocket_job *job),
+	     TP_ARGS(job)
+);
+
+DEFINE_EVENT(rocket_job, rocket_job_run,
+	     TP_PROTO(struct rocket_job *job),
+	     TP_ARGS(job)
+);
+
+DEFINE_EVENT(rocket_job, rocket_job_done,
+	     TP_PROTO(struct rocket_job *job),
+	     TP_ARGS(job)
+);
+
+TRACE_EVENT(rocket_task_done,
+	TP_PROTO(struct rocket_job *job, u32 first_task, u32 task_count, u64 duration_ns),
+	TP_ARGS(job, first_task, task_count, duration_ns),
+	TP_STRUCT__entry(
+		__field(u64, context)
+		__field(u64, seqno)
+		__field(unsigned int, core)
+		__field(u32, first_task)
+		__field(u32, task_count)
+		__field(u64, duration_ns)
+		),
+
+	TP_fast_assign(
+		__entry->context = job->base.s_fence->finished.context;
+		__entry->seqno = job->base.s_fence->finished.seqno;
+		__entry->core = job->core->index;
+		__entry->first_task = first_task;
+		__entry->task_count = task_count;
+		__entry->duration_ns = duration_ns;
+		),
+
+	TP_printk("context=%llu seqno=%llu core=%u tasks=%u-%u duration=%llu ns",
+		  __entry->context, __entry->seqno, __entry->core,
+		  __entry->first_task, __entry->first_task + __entry->task_count - 1,
+		  __entry->duration_ns)
+);
+
+#endif
+
+/* This part must be outside protection */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH ../../drivers/accel/rocket
+#include <trace/define_trace.h>
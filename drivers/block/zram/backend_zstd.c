@@ -11,7 +11,7 @@ struct zstd_ctx {
 	zstd_cctx *cctx;
 	zstd_dctx *dctx;
 	void *cctx_mem;
-	void *dctx_mem;
+	bool shared_dctx;
 };
 
 struct zstd_params {
@@ -97,9 +97,9 @@ static void zstd_destroy(struct zcomp_ctx *ctx)
 		return;
 
 	/*
-	 * If ->cctx_mem and ->dctx_mem were allocated then we didn't use
-	 * C/D dictionary and ->cctx / ->dctx were "embedded" into these
-	 * buffers.
+	 * If ->cctx_mem was allocated then we didn't use C/D dictionary,
+	 * ->cctx was "embedded" into this buffer and decompression uses
+	 * the shared zstd dctx pool.
 	 *
 	 * If otherwise then we need to explicitly release ->cctx / ->dctx.
 	 */
@@ -108,8 +108,8 @@ static void zstd_destroy(struct zcomp_ctx *ctx)
 	else
 		zstd_free_cctx(zctx->cctx);
 
-	if (zctx->dctx_mem)
-		vfree(zctx->dctx_mem);
+	if (zctx->shared_dctx)
+		zstd_release_shared_dctx();
 	else
 		zstd_free_dctx(zctx->dctx);
 
@@ -138,14 +138,9 @@ static int zstd_create(struct zcomp_params *params, struct zcomp_ctx *ctx)
 		if (!zctx->cctx)
 			goto error;
 
-		sz = zstd_dctx_workspace_bound();
-		zctx->dctx_mem = vzalloc(sz);
-		if (!zctx->dctx_mem)
-			goto error;
-
-		zctx->dctx = zstd_init_dctx(zctx->dctx_mem, sz);
-		if (!zctx->dctx)
+		if (zstd_reserve_shared_dctx())
 			goto error;
+		zctx->shared_dctx = true;
 	} else {
 		struct zstd_params *zp = params->drv_data;
 
@@ -195,8 +190,8 @@ static int zstd_decompress(struct zcomp_params *params, struct zcomp_ctx *ctx,
 	size_t ret;
 
 	if (params->dict_sz == 0)
-		ret = zstd_decompress_dctx(zctx->dctx, req->dst, req->dst_len,
-					   req->src, req->src_len);
+		ret = zstd_decompress_shared_dctx(req->dst, req->dst_len,
+						  req->src, req->src_len);
 	else
 		ret = zstd_decompress_using_ddict(zctx->dctx, req->dst,
 						  req->dst_len, req->src,
@@ -15,18 +15,28 @@
 #include <linux/io.h>
 #include <linux/iopoll.h>
 #include <linux/kernel.h>
+#include <linux/kfifo.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
 #include <linux/pm_runtime.h>
 #include <linux/reset.h>
 #include <linux/slab.h>
+#include <linux/workqueue.h>
 
 #define RK_RNG_AUTOSUSPEND_DELAY	100
 #define RK_RNG_MAX_BYTE			32
 #define RK_RNG_POLL_PERIOD_US		100
 #define RK_RNG_POLL_TIMEOUT_US		10000
 
+/*
+ * Random data is generated ahead of time into a pool, in the background, so
+ * that reads do not have to wake up the TRNG and wait for it. The pool is
+ * refilled once it is half empty.
+ */
+#define RK_RNG_POOL_SIZE		4096
+
 /*
  * TRNG collects osc ring output bit every RK_RNG_SAMPLE_CNT time. The value is
  * a tradeoff between speed and quality and has been adjusted to get a quality
@@ -93,7 +103,7 @@
 #define TRNG_v1_VERSION_CODE			0x46bc
 /* end of TRNG_V1 register definitions */
 
-/* Before removing this assert, give rk3588_rng_read an upper bound of 32 */
+/* Before removing this assert, give rk3588_rng_generate an upper bound of 32 */
 static_assert(RK_RNG_MAX_BYTE <= (TRNG_V1_RAND7 + 4 - TRNG_V1_RAND0),
 	      "You raised RK_RNG_MAX_BYTE and broke rk3588-rng, congrats.");
 
@@ -104,11 +114,16 @@ struct rk_rng {
 	struct clk_bulk_data *clk_bulks;
 	const struct rk_rng_soc_data *soc_data;
 	struct device *dev;
+	/* serializes the pool refill with direct reads of the TRNG */
+	struct mutex lock;
+	struct work_struct refill_work;
+	DECLARE_KFIFO(pool, u8, RK_RNG_POOL_SIZE);
 };
 
 struct rk_rng_soc_data {
 	int (*rk_rng_init)(struct hwrng *rng);
-	int (*rk_rng_read)(struct hwrng *rng, void *buf, size_t max, bool wait);
+	/* generate RK_RNG_MAX_BYTE bytes, the device must be resumed */
+	int (*rk_rng_generate)(struct rk_rng *rk_rng, void *buf);
 	void (*rk_rng_cleanup)(struct hwrng *rng);
 	unsigned short quality;
 	bool reset_optional;
@@ -175,16 +190,10 @@ static void rk3568_rng_cleanup(struct hwrng *rng)
 	clk_bulk_disable_unprepare(rk_rng->clk_num, rk_rng->clk_bulks);
 }
 
-static int rk3568_rng_read(struct hwrng *rng, void *buf, size_t max, bool wait)
+static int rk3568_rng_generate(struct rk_rng *rk_rng, void *buf)
 {
-	struct rk_rng *rk_rng = container_of(rng, struct rk_rng, rng);
-	size_t to_read = min_t(size_t, max, RK_RNG_MAX_BYTE);
 	u32 reg;
-	int ret = 0;
-
-	ret = pm_runtime_resume_and_get(rk_rng->dev);
-	if (ret < 0)
-		return ret;
+	int ret;
 
 	/* Start collecting random data */
 	rk_rng_write_ctl(rk_rng, TRNG_RNG_CTL_START, TRNG_RNG_CTL_START);
@@ -194,15 +203,12 @@ static int rk3568_rng_read(struct hwrng *rng, void *buf, size_t max, bool wait)
 				 RK_RNG_POLL_PERIOD_US,
 				 RK_RNG_POLL_TIMEOUT_US);
 	if (ret < 0)
-		goto out;
+		return ret;
 
 	/* Read random data stored in the registers */
-	memcpy_fromio(buf, rk_rng->base + TRNG_RNG_DOUT, to_read);
-out:
-	pm_runtime_mark_last_busy(rk_rng->dev);
-	pm_runtime_put_sync_autosuspend(rk_rng->dev);
+	memcpy_fromio(buf, rk_rng->base + TRNG_RNG_DOUT, RK_RNG_MAX_BYTE);
 
-	return (ret < 0) ? ret : to_read;
+	return RK_RNG_MAX_BYTE;
 }
 
 static int rk3588_rng_init(struct hwrng *rng)
@@ -257,17 +263,11 @@ static void rk3588_rng_cleanup(struct hwrng *rng)
 	clk_bulk_disable_unprepare(rk_rng->clk_num, rk_rng->clk_bulks);
 }
 
-static int rk3588_rng_read(struct hwrng *rng, void *buf, size_t max, bool wait)
+static int rk3588_rng_generate(struct rk_rng *rk_rng, void *buf)
 {
-	struct rk_rng *rk_rng = container_of(rng, struct rk_rng, rng);
-	size_t to_read = min_t(size_t, max, RK_RNG_MAX_BYTE);
 	int ret = 0;
 	u32 reg;
 
-	ret = pm_runtime_resume_and_get(rk_rng->dev);
-	if (ret < 0)
-		return ret;
-
 	/* Clear ISTAT, even without interrupts enabled, this will be updated */
 	reg = rk_rng_readl(rk_rng, TRNG_V1_ISTAT);
 	rk_rng_writel(rk_rng, reg, TRNG_V1_ISTAT);
@@ -283,7 +283,7 @@ static int rk3588_rng_read(struct hwrng *rng, void *buf, size_t max, bool wait)
 		goto out;
 
 	/* Read random data that's in registers TRNG_V1_RAND0 through RAND7 */
-	memcpy_fromio(buf, rk_rng->base + TRNG_V1_RAND0, to_read);
+	memcpy_fromio(buf, rk_rng->base + TRNG_V1_RAND0, RK_RNG_MAX_BYTE);
 
 out:
 	/* Clear ISTAT */
@@ -291,15 +291,84 @@ static int rk3588_rng_read(struct hwrng *rng, void *buf, size_t max, bool wait)
 	/* close the TRNG */
 	rk_rng_writel(rk_rng, TRNG_V1_CTRL_NOP, TRNG_V1_CTRL);
 
+	return (ret < 0) ? ret : RK_RNG_MAX_BYTE;
+}
+
+/*
+ * Fill the pool at the full rate of the TRNG, the device is only kept resumed
+ * for the duration of the refill.
+ */
+static void rk_rng_refill(struct work_struct *work)
+{
+	struct rk_rng *rk_rng = container_of(work, struct rk_rng, refill_work);
+	u8 buf[RK_RNG_MAX_BYTE];
+	int ret;
+
+	ret = pm_runtime_resume_and_get(rk_rng->dev);
+	if (ret < 0)
+		return;
+
+	mutex_lock(&rk_rng->lock);
+	while (kfifo_avail(&rk_rng->pool) >= RK_RNG_MAX_BYTE) {
+		ret = rk_rng->soc_data->rk_rng_generate(rk_rng, buf);
+		if (ret < 0) {
+			dev_dbg(rk_rng->dev, "pool refill failed: %d\n", ret);
+			break;
+		}
+		kfifo_in(&rk_rng->pool, buf, ret);
+	}
+	mutex_unlock(&rk_rng->lock);
+	memzero_explicit(buf, sizeof(buf));
+
 	pm_runtime_mark_last_busy(rk_rng->dev);
 	pm_runtime_put_sync_autosuspend(rk_rng->dev);
+}
+
+static int rk_rng_read(struct hwrng *rng, void *buf, size_t max, bool wait)
+{
+	struct rk_rng *rk_rng = container_of(rng, struct rk_rng, rng);
+	u8 tmp[RK_RNG_MAX_BYTE];
+	int ret;
+
+	/* the pool has a single reader, the hwrng core, and a single writer */
+	ret = kfifo_out(&rk_rng->pool, buf, max);
+	if (kfifo_len(&rk_rng->pool) < RK_RNG_POOL_SIZE / 2)
+		queue_work(system_unbound_wq, &rk_rng->refill_work);
+	if (ret || !wait)
+		return ret;
 
-	return (ret < 0) ? ret : to_read;
+	/* the pool is empty, go to the TRNG instead of waiting for the refill */
+	ret = pm_runtime_resume_and_get(rk_rng->dev);
+	if (ret < 0)
+		return ret;
+
+	mutex_lock(&rk_rng->lock);
+	ret = rk_rng->soc_data->rk_rng_generate(rk_rng, tmp);
+	mutex_unlock(&rk_rng->lock);
+
+	pm_runtime_mark_last_busy(rk_rng->dev);
+	pm_runtime_put_sync_autosuspend(rk_rng->dev);
+
+	if (ret < 0)
+		return ret;
+
+	ret = min_t(size_t, max, ret);
+	memcpy(buf, tmp, ret);
+	memzero_explicit(tmp, sizeof(tmp));
+
+	return ret;
+}
+
+static void rk_rng_cancel_refill(void *data)
+{
+	struct rk_rng *rk_rng = data;
+
+	cancel_work_sync(&rk_rng->refill_work);
 }
 
 static const struct rk_rng_soc_data rk3568_soc_data = {
 	.rk_rng_init = rk3568_rng_init,
-	.rk_rng_read = rk3568_rng_read,
+	.rk_rng_generate = rk3568_rng_generate,
 	.rk_rng_cleanup = rk3568_rng_cleanup,
 	.quality = 900,
 	.reset_optional = false,
@@ -307,7 +376,7 @@ static const struct rk_rng_soc_data rk3568_soc_data = {
 
 static const struct rk_rng_soc_data rk3588_soc_data = {
 	.rk_rng_init = rk3588_rng_init,
-	.rk_rng_read = rk3588_rng_read,
+	.rk_rng_generate = rk3588_rng_generate,
 	.rk_rng_cleanup = rk3588_rng_cleanup,
 	.quality = 999,		/* as determined by actual testing */
 	.reset_optional = true,
@@ -355,7 +424,7 @@ static int rk_rng_probe(struct platform_device *pdev)
 		rk_rng->rng.init = rk_rng->soc_data->rk_rng_init;
 		rk_rng->rng.cleanup = rk_rng->soc_data->rk_rng_cleanup;
 	}
-	rk_rng->rng.read = rk_rng->soc_data->rk_rng_read;
+	rk_rng->rng.read = rk_rng_read;
 	rk_rng->dev = dev;
 	rk_rng->rng.quality = rk_rng->soc_data->quality;
 
@@ -365,10 +434,19 @@ static int rk_rng_probe(struct platform_device *pdev)
 	if (ret)
 		return dev_err_probe(dev, ret, "Runtime pm activation failed.\n");
 
+	mutex_init(&rk_rng->lock);
+	INIT_KFIFO(rk_rng->pool);
+	INIT_WORK(&rk_rng->refill_work, rk_rng_refill);
+	ret = devm_add_action_or_reset(dev, rk_rng_cancel_refill, rk_rng);
+	if (ret)
+		return ret;
+
 	ret = devm_hwrng_register(dev, &rk_rng->rng);
 	if (ret)
 		return dev_err_probe(dev, ret, "Failed to register Rockchip hwrng\n");
 
+	queue_work(system_unbound_wq, &rk_rng->refill_work);
+
 	return 0;
 }
 
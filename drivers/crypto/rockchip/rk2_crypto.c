@@ -6,20 +6,62 @@
  */
 
 #include "rk2_crypto.h"
+#include "rk2_crypto_trace.h"
 #include <linux/clk.h>
 #include <linux/crypto.h>
 #include <linux/dma-mapping.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
 #include <linux/of.h>
 #include <linux/of_device.h>
 #include <linux/reset.h>
+#include <linux/sched/topology.h>
 
 static struct rockchip_ip rocklist = {
 	.dev_list = LIST_HEAD_INIT(rocklist.dev_list),
 	.lock = __SPIN_LOCK_UNLOCKED(rocklist.lock),
 };
 
+/*
+ * For small requests, setting up the DMA costs more than doing the work on
+ * the CPU, so they are given to the fallback.
+ */
+unsigned int rk2_crypto_fallback_len = 256;
+module_param_named(fallback_len, rk2_crypto_fallback_len, uint, 0644);
+MODULE_PARM_DESC(fallback_len, "Cipher and AEAD requests smaller than this are done by the CPU");
+
+/*
+ * fallback_len is tuned for the big cores. A little core is much slower at
+ * software crypto while the DMA setup cost stays the same, so scale the
+ * threshold by the capacity of the submitting CPU: requests from little
+ * cores are offloaded from a smaller size on.
+ */
+unsigned int rk2_crypto_fallback_threshold(void)
+{
+	unsigned long cap = arch_scale_cpu_capacity(raw_smp_processor_id());
+
+	return (rk2_crypto_fallback_len * cap) >> SCHED_CAPACITY_SHIFT;
+}
+
+static atomic_t rk2_key_id = ATOMIC_INIT(0);
+
+/*
+ * Each key gets an unique ID so that the key registers are only written when
+ * the key differs from the last one loaded. 0 means no key is loaded.
+ */
+u32 rk2_crypto_new_key_id(void)
+{
+	u32 id;
+
+	do {
+		id = atomic_inc_return(&rk2_key_id);
+	} while (!id);
+
+	return id;
+}
+
 struct rk2_crypto_dev *get_rk2_crypto(void)
 {
 	struct rk2_crypto_dev *first;
@@ -32,6 +74,45 @@ struct rk2_crypto_dev *get_rk2_crypto(void)
 	return first;
 }
 
+/*
+ * Account a request done by the engine, queue_ns is the time spent waiting
+ * in the queue and hw_ns the time the hardware took.
+ */
+void rk2_crypto_stat(struct rk2_crypto_template *algt, const char *name,
+		     unsigned int len, u64 queue_ns, u64 hw_ns, int err)
+{
+	unsigned int i = 0;
+
+	if (len > 512)
+		i = min_t(unsigned int, ilog2(len - 1) - 8, RK2_STAT_SIZES - 1);
+
+	algt->stat_bytes += len;
+	algt->stat_queue_ns += queue_ns;
+	algt->stat_hw_ns += hw_ns;
+	algt->stat_size[i]++;
+
+	trace_rk2_crypto_done(name, len, queue_ns, hw_ns, err);
+}
+
+static int rk2_crypto_do_batch(struct crypto_engine *engine)
+{
+	struct rk2_crypto_dev *rkc, *found = NULL;
+
+	spin_lock(&rocklist.lock);
+	list_for_each_entry(rkc, &rocklist.dev_list, list) {
+		if (rkc->engine == engine) {
+			found = rkc;
+			break;
+		}
+	}
+	spin_unlock(&rocklist.lock);
+
+	if (found)
+		rk2_cipher_flush(found);
+
+	return 0;
+}
+
 static const struct rk2_variant rk3568_variant = {
 	.num_clks = 3,
 };
@@ -102,6 +183,7 @@ static int rk2_crypto_pm_suspend(struct device *dev)
 
 	rk2_crypto_disable_clk(rkdev);
 	reset_control_assert(rkdev->rst);
+	rkdev->key_id = 0;
 
 	return 0;
 }
@@ -239,6 +321,31 @@ static struct rk2_crypto_template rk2_crypto_algs[] = {
 			.do_one_request = rk2_cipher_run,
 		},
 	},
+	{
+		.type = CRYPTO_ALG_TYPE_AEAD,
+		.rk2_mode = RK2_CRYPTO_AES_GCM,
+		.alg.aead.base = {
+			.base.cra_name		= "gcm(aes)",
+			.base.cra_driver_name	= "gcm-aes-rk2",
+			.base.cra_priority	= 300,
+			.base.cra_flags		= CRYPTO_ALG_ASYNC | CRYPTO_ALG_NEED_FALLBACK,
+			.base.cra_blocksize	= 1,
+			.base.cra_ctxsize	= sizeof(struct rk2_aead_ctx),
+			.base.cra_module	= THIS_MODULE,
+
+			.init			= rk2_aead_tfm_init,
+			.exit			= rk2_aead_tfm_exit,
+			.ivsize			= GCM_AES_IV_SIZE,
+			.maxauthsize		= AES_BLOCK_SIZE,
+			.setkey			= rk2_aead_setkey,
+			.setauthsize		= rk2_aead_gcm_setauthsize,
+			.encrypt		= rk2_aead_encrypt,
+			.decrypt		= rk2_aead_decrypt,
+		},
+		.alg.aead.op = {
+			.do_one_request = rk2_aead_run,
+		},
+	},
 	{
 		.type = CRYPTO_ALG_TYPE_AHASH,
 		.rk2_mode = RK2_CRYPTO_MD5,
@@ -254,7 +361,7 @@ static struct rk2_crypto_template rk2_crypto_algs[] = {
 			.exit_tfm = rk2_hash_exit_tfm,
 			.halg = {
 				.digestsize = MD5_DIGEST_SIZE,
-				.statesize = sizeof(struct md5_state),
+				.statesize = sizeof(struct rk2_ahash_state),
 				.base = {
 					.cra_name = "md5",
 					.cra_driver_name = "rk2-md5",
@@ -287,7 +394,7 @@ static struct rk2_crypto_template rk2_crypto_algs[] = {
 			.exit_tfm = rk2_hash_exit_tfm,
 			.halg = {
 				.digestsize = SHA1_DIGEST_SIZE,
-				.statesize = sizeof(struct sha1_state),
+				.statesize = sizeof(struct rk2_ahash_state),
 				.base = {
 					.cra_name = "sha1",
 					.cra_driver_name = "rk2-sha1",
@@ -319,7 +426,7 @@ static struct rk2_crypto_template rk2_crypto_algs[] = {
 			.exit_tfm = rk2_hash_exit_tfm,
 			.halg = {
 				.digestsize = SHA256_DIGEST_SIZE,
-				.statesize = sizeof(struct sha256_state),
+				.statesize = sizeof(struct rk2_ahash_state),
 				.base = {
 					.cra_name = "sha256",
 					.cra_driver_name = "rk2-sha256",
@@ -351,7 +458,7 @@ static struct rk2_crypto_template rk2_crypto_algs[] = {
 			.exit_tfm = rk2_hash_exit_tfm,
 			.halg = {
 				.digestsize = SHA384_DIGEST_SIZE,
-				.statesize = sizeof(struct sha512_state),
+				.statesize = sizeof(struct rk2_ahash_state),
 				.base = {
 					.cra_name = "sha384",
 					.cra_driver_name = "rk2-sha384",
@@ -383,7 +490,7 @@ static struct rk2_crypto_template rk2_crypto_algs[] = {
 			.exit_tfm = rk2_hash_exit_tfm,
 			.halg = {
 				.digestsize = SHA512_DIGEST_SIZE,
-				.statesize = sizeof(struct sha512_state),
+				.statesize = sizeof(struct rk2_ahash_state),
 				.base = {
 					.cra_name = "sha512",
 					.cra_driver_name = "rk2-sha512",
@@ -415,7 +522,7 @@ static struct rk2_crypto_template rk2_crypto_algs[] = {
 			.exit_tfm = rk2_hash_exit_tfm,
 			.halg = {
 				.digestsize = SM3_DIGEST_SIZE,
-				.statesize = sizeof(struct sm3_state),
+				.statesize = sizeof(struct rk2_ahash_state),
 				.base = {
 					.cra_name = "sm3",
 					.cra_driver_name = "rk2-sm3",
@@ -435,6 +542,26 @@ static struct rk2_crypto_template rk2_crypto_algs[] = {
 };
 
 #ifdef CONFIG_CRYPTO_DEV_ROCKCHIP2_DEBUG
+static void rk2_crypto_debugfs_perf_show(struct seq_file *seq,
+					 struct rk2_crypto_template *algt)
+{
+	unsigned int i;
+
+	seq_printf(seq, "\tbytes: %lu\n", algt->stat_bytes);
+	seq_printf(seq, "\ttime in hardware: %llu us\n",
+		   div_u64(algt->stat_hw_ns, NSEC_PER_USEC));
+	if (algt->stat_hw_ns)
+		seq_printf(seq, "\tthroughput: %llu MB/s\n",
+			   div64_u64((u64)algt->stat_bytes * 1000, algt->stat_hw_ns));
+	if (algt->stat_req)
+		seq_printf(seq, "\taverage queueing delay: %llu us\n",
+			   div64_u64(algt->stat_queue_ns,
+				     (u64)algt->stat_req * NSEC_PER_USEC));
+	for (i = 0; i < RK2_STAT_SIZES - 1; i++)
+		seq_printf(seq, "\tsize <= %u: %lu\n", 512 << i, algt->stat_size[i]);
+	seq_printf(seq, "\tsize > %u: %lu\n", 512 << (i - 1), algt->stat_size[i]);
+}
+
 static int rk2_crypto_debugfs_stats_show(struct seq_file *seq, void *v)
 {
 	struct rk2_crypto_dev *rkc;
@@ -459,16 +586,35 @@ static int rk2_crypto_debugfs_stats_show(struct seq_file *seq, void *v)
 				   rk2_crypto_algs[i].stat_req, rk2_crypto_algs[i].stat_fb);
 			seq_printf(seq, "\tfallback due to length: %lu\n",
 				   rk2_crypto_algs[i].stat_fb_len);
+			seq_printf(seq, "\tfallback below fallback_len: %lu\n",
+				   rk2_crypto_algs[i].stat_fb_small);
+			seq_printf(seq, "\tfallback due to alignment: %lu\n",
+				   rk2_crypto_algs[i].stat_fb_align);
+			seq_printf(seq, "\tfallback due to SGs: %lu\n",
+				   rk2_crypto_algs[i].stat_fb_sgdiff);
+			rk2_crypto_debugfs_perf_show(seq, &rk2_crypto_algs[i]);
+			break;
+		case CRYPTO_ALG_TYPE_AEAD:
+			seq_printf(seq, "%s %s reqs=%lu fallback=%lu\n",
+				   rk2_crypto_algs[i].alg.aead.base.base.cra_driver_name,
+				   rk2_crypto_algs[i].alg.aead.base.base.cra_name,
+				   rk2_crypto_algs[i].stat_req, rk2_crypto_algs[i].stat_fb);
+			seq_printf(seq, "\tfallback due to length: %lu\n",
+				   rk2_crypto_algs[i].stat_fb_len);
+			seq_printf(seq, "\tfallback below fallback_len: %lu\n",
+				   rk2_crypto_algs[i].stat_fb_small);
 			seq_printf(seq, "\tfallback due to alignment: %lu\n",
 				   rk2_crypto_algs[i].stat_fb_align);
 			seq_printf(seq, "\tfallback due to SGs: %lu\n",
 				   rk2_crypto_algs[i].stat_fb_sgdiff);
+			rk2_crypto_debugfs_perf_show(seq, &rk2_crypto_algs[i]);
 			break;
 		case CRYPTO_ALG_TYPE_AHASH:
 			seq_printf(seq, "%s %s reqs=%lu fallback=%lu\n",
 				   rk2_crypto_algs[i].alg.hash.base.halg.base.cra_driver_name,
 				   rk2_crypto_algs[i].alg.hash.base.halg.base.cra_name,
 				   rk2_crypto_algs[i].stat_req, rk2_crypto_algs[i].stat_fb);
+			rk2_crypto_debugfs_perf_show(seq, &rk2_crypto_algs[i]);
 			break;
 		}
 	}
@@ -533,6 +679,21 @@ static void register_debugfs(struct rk2_crypto_dev *crypto_dev)
 #endif
 }
 
+static void rk2_crypto_unregister_alg(struct rk2_crypto_template *algt)
+{
+	switch (algt->type) {
+	case CRYPTO_ALG_TYPE_SKCIPHER:
+		crypto_engine_unregister_skcipher(&algt->alg.skcipher);
+		break;
+	case CRYPTO_ALG_TYPE_AEAD:
+		crypto_engine_unregister_aead(&algt->alg.aead);
+		break;
+	case CRYPTO_ALG_TYPE_AHASH:
+		crypto_engine_unregister_ahash(&algt->alg.hash);
+		break;
+	}
+}
+
 static int rk2_crypto_register(struct rk2_crypto_dev *rkc)
 {
 	unsigned int i, k;
@@ -547,6 +708,12 @@ static int rk2_crypto_register(struct rk2_crypto_dev *rkc)
 				 rk2_crypto_algs[i].alg.skcipher.base.base.cra_driver_name);
 			err = crypto_engine_register_skcipher(&rk2_crypto_algs[i].alg.skcipher);
 			break;
+		case CRYPTO_ALG_TYPE_AEAD:
+			dev_info(rkc->dev, "Register %s as %s\n",
+				 rk2_crypto_algs[i].alg.aead.base.base.cra_name,
+				 rk2_crypto_algs[i].alg.aead.base.base.cra_driver_name);
+			err = crypto_engine_register_aead(&rk2_crypto_algs[i].alg.aead);
+			break;
 		case CRYPTO_ALG_TYPE_AHASH:
 			dev_info(rkc->dev, "Register %s as %s %d\n",
 				 rk2_crypto_algs[i].alg.hash.base.halg.base.cra_name,
@@ -562,12 +729,8 @@ static int rk2_crypto_register(struct rk2_crypto_dev *rkc)
 	return 0;
 
 err_cipher_algs:
-	for (k = 0; k < i; k++) {
-		if (rk2_crypto_algs[k].type == CRYPTO_ALG_TYPE_SKCIPHER)
-			crypto_engine_unregister_skcipher(&rk2_crypto_algs[k].alg.skcipher);
-		else
-			crypto_engine_unregister_ahash(&rk2_crypto_algs[k].alg.hash);
-	}
+	for (k = 0; k < i; k++)
+		rk2_crypto_unregister_alg(&rk2_crypto_algs[k]);
 	return err;
 }
 
@@ -575,12 +738,8 @@ static void rk2_crypto_unregister(void)
 {
 	unsigned int i;
 
-	for (i = 0; i < ARRAY_SIZE(rk2_crypto_algs); i++) {
-		if (rk2_crypto_algs[i].type == CRYPTO_ALG_TYPE_SKCIPHER)
-			crypto_engine_unregister_skcipher(&rk2_crypto_algs[i].alg.skcipher);
-		else
-			crypto_engine_unregister_ahash(&rk2_crypto_algs[i].alg.hash);
-	}
+	for (i = 0; i < ARRAY_SIZE(rk2_crypto_algs); i++)
+		rk2_crypto_unregister_alg(&rk2_crypto_algs[i]);
 }
 
 static const struct of_device_id crypto_of_id_table[] = {
@@ -631,6 +790,14 @@ static int rk2_crypto_probe(struct platform_device *pdev)
 		goto err_crypto;
 	}
 
+	rkc->hbuf = dmam_alloc_coherent(rkc->dev, RK2_HASH_BOUNCE_SIZE,
+					&rkc->h_phy, GFP_KERNEL);
+	if (!rkc->hbuf) {
+		dev_err(rkc->dev, "Cannot get DMA memory for hash\n");
+		err = -ENOMEM;
+		goto err_crypto;
+	}
+
 	reset_control_assert(rkc->rst);
 	usleep_range(10, 20);
 	reset_control_deassert(rkc->rst);
@@ -662,7 +829,13 @@ static int rk2_crypto_probe(struct platform_device *pdev)
 		goto err_crypto;
 	}
 
-	rkc->engine = crypto_engine_alloc_init(&pdev->dev, true);
+	rkc->engine = crypto_engine_alloc_init_and_set(&pdev->dev, true,
+						       rk2_crypto_do_batch, true,
+						       RK2_CRYPTO_QLEN);
+	if (!rkc->engine) {
+		err = -ENOMEM;
+		goto err_crypto;
+	}
 	crypto_engine_start(rkc->engine);
 	init_completion(&rkc->complete);
 
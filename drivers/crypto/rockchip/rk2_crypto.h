@@ -3,6 +3,8 @@
 #include <crypto/aes.h>
 #include <crypto/xts.h>
 #include <crypto/engine.h>
+#include <crypto/gcm.h>
+#include <crypto/internal/aead.h>
 #include <crypto/internal/des.h>
 #include <crypto/internal/hash.h>
 #include <crypto/internal/skcipher.h>
@@ -17,6 +19,7 @@
 #include <linux/delay.h>
 #include <linux/pm_runtime.h>
 #include <linux/scatterlist.h>
+#include <linux/sizes.h>
 #include <linux/hw_random.h>
 
 #define RK2_CRYPTO_CLK_CTL	0x0000
@@ -42,11 +45,15 @@
 
 #define RK2_CRYPTO_FIFO_CTL	0x0040
 
+#define RK2_CRYPTO_MID_VALID_SWITCH	0x0060
+#define RK2_CRYPTO_MID_VALID_ENABLE	BIT(0)
+
 #define RK2_CRYPTO_BC_CTL	0x0044
 #define RK2_CRYPTO_AES		(0 << 8)
 #define RK2_CRYPTO_MODE_ECB	(0 << 4)
 #define RK2_CRYPTO_MODE_CBC	(1 << 4)
 #define RK2_CRYPTO_XTS		(6 << 4)
+#define RK2_CRYPTO_MODE_GCM	(8 << 4)
 
 #define RK2_CRYPTO_HASH_CTL	0x0048
 #define RK2_CRYPTO_HW_PAD	BIT(2)
@@ -61,6 +68,7 @@
 #define RK2_CRYPTO_AES_ECB		(RK2_CRYPTO_AES | RK2_CRYPTO_MODE_ECB)
 #define RK2_CRYPTO_AES_CBC		(RK2_CRYPTO_AES | RK2_CRYPTO_MODE_CBC)
 #define RK2_CRYPTO_AES_XTS		(RK2_CRYPTO_AES | RK2_CRYPTO_XTS)
+#define RK2_CRYPTO_AES_GCM		(RK2_CRYPTO_AES | RK2_CRYPTO_MODE_GCM)
 #define RK2_CRYPTO_AES_CTR_MODE		3
 #define RK2_CRYPTO_AES_128BIT_key	(0 << 2)
 #define RK2_CRYPTO_AES_192BIT_key	(1 << 2)
@@ -85,11 +93,19 @@
 #define RK2_CRYPTO_CH4_KEY0		0x01c0
 
 #define RK2_CRYPTO_CH0_PC_LEN_0		0x0280
+#define RK2_CRYPTO_CH0_PC_LEN_1		0x0284
+#define RK2_CRYPTO_CH0_AAD_LEN_0	0x02C0
+#define RK2_CRYPTO_CH0_AAD_LEN_1	0x02C4
 
 #define RK2_CRYPTO_CH0_IV_LEN		0x0300
+#define RK2_CRYPTO_CH0_TAG_0		0x0320
 
 #define RK2_CRYPTO_HASH_DOUT_0	0x03A0
+#define RK2_CRYPTO_TAG_VALID	0x03E0
+#define RK2_CRYPTO_CH0_TAG_VALID	BIT(0)
 #define RK2_CRYPTO_HASH_VALID	0x03E4
+#define RK2_CRYPTO_MID_VALID	0x03E8
+#define RK2_CRYPTO_HASH_MID_IS_VALID	BIT(0)
 
 #define RK2_CRYPTO_TRNG_CTL	0x0400
 #define RK2_CRYPTO_TRNG_START	BIT(0)
@@ -98,6 +114,10 @@
 #define RK2_CRYPTO_TRNG_SAMPLE_CNT	0x0404
 #define RK2_CRYPTO_TRNG_DOUT	0x0410
 
+#define RK2_CRYPTO_HASH_MID_DATA_0	0x0600
+/* the intermediate state of the hash engine, including the length counters */
+#define RK2_CRYPTO_HASH_MID_WORDS	26
+
 #define CRYPTO_AES_VERSION	0x0680
 #define CRYPTO_DES_VERSION	0x0684
 #define CRYPTO_SM4_VERSION	0x0688
@@ -112,6 +132,7 @@
 #define RK2_LLI_DMA_CTRL_LIST_INT	BIT(8)
 #define RK2_LLI_DMA_CTRL_LAST		BIT(0)
 
+#define RK2_LLI_STRING_AAD		BIT(3)
 #define RK2_LLI_STRING_LAST		BIT(2)
 #define RK2_LLI_STRING_FIRST		BIT(1)
 #define RK2_LLI_CIPHER_START		BIT(0)
@@ -120,6 +141,14 @@
 
 #define MAX_LLI 20
 
+/* maximum number of ECB requests run back to back */
+#define RK2_CRYPTO_BATCH	16
+/* depth of the crypto_engine queue */
+#define RK2_CRYPTO_QLEN		64
+
+/* bounce buffer used for hashing data the DMA cannot read in place */
+#define RK2_HASH_BOUNCE_SIZE	SZ_4K
+
 struct rk2_crypto_lli {
 	__le32 src_addr;
 	__le32 src_len;
@@ -170,6 +199,12 @@ struct rk2_crypto_dev {
 	int status;
 	struct rk2_crypto_lli *tl;
 	dma_addr_t t_phy;
+	u8 *hbuf;
+	dma_addr_t h_phy;
+	u32 key_id;
+	struct skcipher_request *batch[RK2_CRYPTO_BATCH];
+	unsigned int nbatch;
+	unsigned int nbatch_lli;
 };
 
 /* the private variable of hash */
@@ -178,12 +213,38 @@ struct rk2_ahash_ctx {
 	struct crypto_ahash		*fallback_tfm;
 };
 
-/* the private variable of hash for fallback */
+enum rk2_hash_op {
+	RK2_HASH_OP_UPDATE,
+	RK2_HASH_OP_FINAL,
+	RK2_HASH_OP_FINUP,
+};
+
+/*
+ * struct rk2_ahash_state - state of a partial hash, this is what is exported
+ * @mid:	Intermediate state saved from the engine between requests
+ * @buf:	Data not yet given to the engine
+ * @buflen:	Number of bytes in @buf, the engine only accepts whole blocks
+ *		until the final request, and at least one byte is always kept
+ *		back so that the final request never is empty
+ * @started:	The engine already has processed some blocks, @mid is valid
+ */
+struct rk2_ahash_state {
+	u32				mid[RK2_CRYPTO_HASH_MID_WORDS];
+	u8				buf[SHA512_BLOCK_SIZE];
+	unsigned int			buflen;
+	bool				started;
+};
+
+/* the private variable of hash */
 struct rk2_ahash_rctx {
 	struct rk2_crypto_dev		*dev;
-	struct ahash_request		fallback_req;
+	struct rk2_ahash_state		state;
+	enum rk2_hash_op		op;
 	u32				mode;
 	int nrsgs;
+	u64				queued;
+	u64				hw_ns;
+	struct ahash_request		fallback_req;   // keep at the end
 };
 
 /* the private variable of cipher */
@@ -191,6 +252,7 @@ struct rk2_cipher_ctx {
 	unsigned int			keylen;
 	u8				key[AES_MAX_KEY_SIZE * 2];
 	u8				iv[AES_BLOCK_SIZE];
+	u32				key_id;
 	struct crypto_skcipher *fallback_tfm;
 };
 
@@ -198,9 +260,33 @@ struct rk2_cipher_rctx {
 	struct rk2_crypto_dev		*dev;
 	u8 backup_iv[AES_BLOCK_SIZE];
 	u32				mode;
+	int				nsrc;
+	int				ndst;
+	u64				queued;
 	struct skcipher_request fallback_req;   // keep at the end
 };
 
+/* the private variable of AEAD */
+struct rk2_aead_ctx {
+	unsigned int			keylen;
+	u8				key[AES_MAX_KEY_SIZE];
+	u32				key_id;
+	struct crypto_aead		*fallback_tfm;
+};
+
+struct rk2_aead_rctx {
+	struct rk2_crypto_dev		*dev;
+	u32				mode;
+	struct scatterlist		src[2];
+	struct scatterlist		dst[2];
+	u8				tag[AES_BLOCK_SIZE];
+	u64				queued;
+	struct aead_request		fallback_req;   // keep at the end
+};
+
+/* request size histogram: <= 512, <= 1K, ..., <= 64K, > 64K bytes */
+#define RK2_STAT_SIZES		9
+
 struct rk2_crypto_template {
 	u32 type;
 	u32 rk2_mode;
@@ -209,17 +295,34 @@ struct rk2_crypto_template {
 	union {
 		struct skcipher_engine_alg	skcipher;
 		struct ahash_engine_alg	hash;
+		struct aead_engine_alg	aead;
 	} alg;
 	unsigned long stat_req;
 	unsigned long stat_fb;
 	unsigned long stat_fb_len;
+	/* requests under the capacity scaled fallback_len */
+	unsigned long stat_fb_small;
 	unsigned long stat_fb_sglen;
 	unsigned long stat_fb_align;
 	unsigned long stat_fb_sgdiff;
+	unsigned long stat_bytes;
+	u64 stat_hw_ns;
+	u64 stat_queue_ns;
+	unsigned long stat_size[RK2_STAT_SIZES];
 };
 
+extern unsigned int rk2_crypto_fallback_len;
+unsigned int rk2_crypto_fallback_threshold(void);
+
 struct rk2_crypto_dev *get_rk2_crypto(void);
+u32 rk2_crypto_new_key_id(void);
+void rk2_crypto_stat(struct rk2_crypto_template *algt, const char *name,
+		     unsigned int len, u64 queue_ns, u64 hw_ns, int err);
 int rk2_cipher_run(struct crypto_engine *engine, void *async_req);
+void rk2_cipher_flush(struct rk2_crypto_dev *rkc);
+int rk2_cipher_build_lli(struct rk2_crypto_dev *rkc, int ddi,
+			 struct scatterlist *sgs, struct scatterlist *sgd,
+			 unsigned int len);
 int rk2_hash_run(struct crypto_engine *engine, void *breq);
 
 int rk2_cipher_tfm_init(struct crypto_skcipher *tfm);
@@ -235,6 +338,15 @@ int rk2_aes_ecb_decrypt(struct skcipher_request *req);
 int rk2_aes_cbc_encrypt(struct skcipher_request *req);
 int rk2_aes_cbc_decrypt(struct skcipher_request *req);
 
+int rk2_aead_run(struct crypto_engine *engine, void *async_req);
+int rk2_aead_tfm_init(struct crypto_aead *tfm);
+void rk2_aead_tfm_exit(struct crypto_aead *tfm);
+int rk2_aead_setkey(struct crypto_aead *tfm, const u8 *key,
+		    unsigned int keylen);
+int rk2_aead_gcm_setauthsize(struct crypto_aead *tfm, unsigned int authsize);
+int rk2_aead_encrypt(struct aead_request *req);
+int rk2_aead_decrypt(struct aead_request *req);
+
 int rk2_ahash_init(struct ahash_request *req);
 int rk2_ahash_update(struct ahash_request *req);
 int rk2_ahash_final(struct ahash_request *req);
@@ -0,0 +1,386 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * hardware cryptographic offloader for RK3568/RK3588 SoC
+ *
+ * AEAD support, the engine does both the encryption and the authentication
+ * of GCM in a single pass.
+ */
+#include <crypto/scatterwalk.h>
+#include <linux/iopoll.h>
+#include <linux/unaligned.h>
+#include "rk2_crypto.h"
+#include "rk2_crypto_trace.h"
+
+static bool rk2_aead_need_fallback(struct aead_request *req, unsigned int len)
+{
+	struct crypto_aead *tfm = crypto_aead_reqtfm(req);
+	struct aead_alg *alg = crypto_aead_alg(tfm);
+	struct rk2_crypto_template *algt = container_of(alg, struct rk2_crypto_template, alg.aead.base);
+	struct rk2_aead_rctx *rctx = aead_request_ctx(req);
+	struct scatterlist *sgl[2], *sg;
+	unsigned int todo, left;
+	int nents[2];
+	int i;
+
+	if (!len || req->assoclen > RK2_HASH_BOUNCE_SIZE) {
+		algt->stat_fb_len++;
+		return true;
+	}
+
+	if (req->assoclen + len < rk2_crypto_fallback_threshold()) {
+		algt->stat_fb_small++;
+		return true;
+	}
+
+	sgl[0] = scatterwalk_ffwd(rctx->src, req->src, req->assoclen);
+	sgl[1] = scatterwalk_ffwd(rctx->dst, req->dst, req->assoclen);
+
+	for (i = 0; i < 2; i++) {
+		nents[i] = sg_nents_for_len(sgl[i], len);
+		if (nents[i] < 0)
+			return true;
+	}
+
+	/* one descriptor is used by the associated data */
+	if (nents[0] + nents[1] - 1 > MAX_LLI - 1) {
+		algt->stat_fb_sgdiff++;
+		return true;
+	}
+
+	/* only the last segment can end in the middle of a block */
+	for (i = 0; i < 2; i++) {
+		left = len;
+		for (sg = sgl[i]; sg && left; sg = sg_next(sg)) {
+			if (!IS_ALIGNED(sg->offset, sizeof(u32))) {
+				algt->stat_fb_align++;
+				return true;
+			}
+			todo = min(left, sg->length);
+			left -= todo;
+			if (left && todo % AES_BLOCK_SIZE) {
+				algt->stat_fb_len++;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+static int rk2_aead_fallback(struct aead_request *areq)
+{
+	struct crypto_aead *tfm = crypto_aead_reqtfm(areq);
+	struct rk2_aead_ctx *ctx = crypto_aead_ctx(tfm);
+	struct rk2_aead_rctx *rctx = aead_request_ctx(areq);
+	struct aead_alg *alg = crypto_aead_alg(tfm);
+	struct rk2_crypto_template *algt = container_of(alg, struct rk2_crypto_template, alg.aead.base);
+
+	algt->stat_fb++;
+	trace_rk2_crypto_fallback(crypto_tfm_alg_driver_name(areq->base.tfm),
+				  areq->cryptlen);
+
+	aead_request_set_tfm(&rctx->fallback_req, ctx->fallback_tfm);
+	aead_request_set_callback(&rctx->fallback_req, areq->base.flags,
+				  areq->base.complete, areq->base.data);
+	aead_request_set_crypt(&rctx->fallback_req, areq->src, areq->dst,
+			       areq->cryptlen, areq->iv);
+	aead_request_set_ad(&rctx->fallback_req, areq->assoclen);
+
+	if (rctx->mode & RK2_CRYPTO_DEC)
+		return crypto_aead_decrypt(&rctx->fallback_req);
+	return crypto_aead_encrypt(&rctx->fallback_req);
+}
+
+static int rk2_aead_handle_req(struct aead_request *req)
+{
+	struct crypto_aead *tfm = crypto_aead_reqtfm(req);
+	struct rk2_aead_rctx *rctx = aead_request_ctx(req);
+	unsigned int len = req->cryptlen;
+	struct rk2_crypto_dev *rkc;
+
+	if (rctx->mode & RK2_CRYPTO_DEC)
+		len -= crypto_aead_authsize(tfm);
+
+	if (rk2_aead_need_fallback(req, len))
+		return rk2_aead_fallback(req);
+
+	rkc = get_rk2_crypto();
+	rctx->dev = rkc;
+	rctx->queued = ktime_get_ns();
+
+	return crypto_transfer_aead_request_to_engine(rkc->engine, req);
+}
+
+int rk2_aead_encrypt(struct aead_request *req)
+{
+	struct rk2_aead_rctx *rctx = aead_request_ctx(req);
+	struct crypto_aead *tfm = crypto_aead_reqtfm(req);
+	struct aead_alg *alg = crypto_aead_alg(tfm);
+	struct rk2_crypto_template *algt = container_of(alg, struct rk2_crypto_template, alg.aead.base);
+
+	rctx->mode = algt->rk2_mode;
+	return rk2_aead_handle_req(req);
+}
+
+int rk2_aead_decrypt(struct aead_request *req)
+{
+	struct rk2_aead_rctx *rctx = aead_request_ctx(req);
+	struct crypto_aead *tfm = crypto_aead_reqtfm(req);
+	struct aead_alg *alg = crypto_aead_alg(tfm);
+	struct rk2_crypto_template *algt = container_of(alg, struct rk2_crypto_template, alg.aead.base);
+
+	rctx->mode = algt->rk2_mode | RK2_CRYPTO_DEC;
+	return rk2_aead_handle_req(req);
+}
+
+int rk2_aead_setkey(struct crypto_aead *tfm, const u8 *key,
+		    unsigned int keylen)
+{
+	struct rk2_aead_ctx *ctx = crypto_aead_ctx(tfm);
+
+	if (keylen != AES_KEYSIZE_128 && keylen != AES_KEYSIZE_192 &&
+	    keylen != AES_KEYSIZE_256)
+		return -EINVAL;
+	ctx->keylen = keylen;
+	memcpy(ctx->key, key, keylen);
+	ctx->key_id = rk2_crypto_new_key_id();
+
+	return crypto_aead_setkey(ctx->fallback_tfm, key, keylen);
+}
+
+int rk2_aead_gcm_setauthsize(struct crypto_aead *tfm, unsigned int authsize)
+{
+	struct rk2_aead_ctx *ctx = crypto_aead_ctx(tfm);
+	int err;
+
+	err = crypto_gcm_check_authsize(authsize);
+	if (err)
+		return err;
+
+	return crypto_aead_setauthsize(ctx->fallback_tfm, authsize);
+}
+
+int rk2_aead_run(struct crypto_engine *engine, void *async_req)
+{
+	struct aead_request *areq = container_of(async_req, struct aead_request, base);
+	struct crypto_aead *tfm = crypto_aead_reqtfm(areq);
+	struct rk2_aead_rctx *rctx = aead_request_ctx(areq);
+	struct rk2_aead_ctx *ctx = crypto_aead_ctx(tfm);
+	struct aead_alg *alg = crypto_aead_alg(tfm);
+	struct rk2_crypto_template *algt = container_of(alg, struct rk2_crypto_template, alg.aead.base);
+	unsigned int authsize = crypto_aead_authsize(tfm);
+	unsigned int ivsize = crypto_aead_ivsize(tfm);
+	struct rk2_crypto_dev *rkc = rctx->dev;
+	struct scatterlist *src, *dst;
+	unsigned int len = areq->cryptlen;
+	u8 tag[AES_BLOCK_SIZE];
+	u32 *rkey = (u32 *)ctx->key;
+	u8 iv[AES_BLOCK_SIZE];
+	u64 start, hw_ns = 0;
+	int nsrc, ndst;
+	int ddi = 0;
+	int err = 0;
+	u32 m, v;
+	int i;
+
+	if (rctx->mode & RK2_CRYPTO_DEC)
+		len -= authsize;
+
+	rk2_cipher_flush(rkc);
+	start = ktime_get_ns();
+
+	algt->stat_req++;
+	rkc->nreq++;
+
+	m = rctx->mode | RK2_CRYPTO_ENABLE;
+	switch (ctx->keylen) {
+	case AES_KEYSIZE_128:
+		m |= RK2_CRYPTO_AES_128BIT_key;
+		break;
+	case AES_KEYSIZE_192:
+		m |= RK2_CRYPTO_AES_192BIT_key;
+		break;
+	case AES_KEYSIZE_256:
+		m |= RK2_CRYPTO_AES_256BIT_key;
+		break;
+	default:
+		dev_err(rkc->dev, "Invalid key length %u\n", ctx->keylen);
+		err = -EINVAL;
+		goto theend_finalize;
+	}
+	m |= 0xffff0000;
+
+	err = pm_runtime_resume_and_get(rkc->dev);
+	if (err)
+		goto theend_finalize;
+
+	dev_dbg(rkc->dev, "%s %s assoclen=%u len=%u mode=%x\n", __func__,
+		crypto_tfm_alg_name(areq->base.tfm), areq->assoclen, len, m);
+
+	src = scatterwalk_ffwd(rctx->src, areq->src, areq->assoclen);
+	dst = src;
+	if (areq->src != areq->dst)
+		dst = scatterwalk_ffwd(rctx->dst, areq->dst, areq->assoclen);
+
+	if (rctx->mode & RK2_CRYPTO_DEC)
+		scatterwalk_map_and_copy(rctx->tag, areq->src,
+					 areq->assoclen + len, authsize, 0);
+
+	/* the associated data is small, it goes through the bounce buffer */
+	if (areq->assoclen) {
+		scatterwalk_map_and_copy(rkc->hbuf, areq->src, 0, areq->assoclen, 0);
+		if (areq->src != areq->dst)
+			scatterwalk_map_and_copy(rkc->hbuf, areq->dst, 0,
+						 areq->assoclen, 1);
+
+		rkc->tl[0].src_addr = rkc->h_phy;
+		rkc->tl[0].src_len = areq->assoclen;
+		rkc->tl[0].dst_addr = 0;
+		rkc->tl[0].dst_len = 0;
+		rkc->tl[0].iv = 0;
+		rkc->tl[0].user = RK2_LLI_STRING_AAD;
+		rkc->tl[0].dma_ctrl = 0;
+		rkc->tl[0].next = rkc->t_phy + sizeof(struct rk2_crypto_lli);
+		ddi++;
+	}
+
+	nsrc = sg_nents_for_len(src, len);
+	ndst = sg_nents_for_len(dst, len);
+
+	if (src == dst) {
+		err = dma_map_sg(rkc->dev, src, nsrc, DMA_BIDIRECTIONAL);
+		if (err <= 0) {
+			err = -EINVAL;
+			goto theend;
+		}
+	} else {
+		err = dma_map_sg(rkc->dev, src, nsrc, DMA_TO_DEVICE);
+		if (err <= 0) {
+			err = -EINVAL;
+			goto theend;
+		}
+		err = dma_map_sg(rkc->dev, dst, ndst, DMA_FROM_DEVICE);
+		if (err <= 0) {
+			dma_unmap_sg(rkc->dev, src, nsrc, DMA_TO_DEVICE);
+			err = -EINVAL;
+			goto theend;
+		}
+	}
+
+	err = rk2_cipher_build_lli(rkc, ddi, src, dst, len);
+	if (err < 0) {
+		dev_err(rkc->dev, "Cannot build the descriptor list\n");
+		goto theend_unmap;
+	}
+	rkc->tl[0].user |= RK2_LLI_CIPHER_START | RK2_LLI_STRING_FIRST;
+	err = 0;
+
+	writel(m, rkc->reg + RK2_CRYPTO_BC_CTL);
+
+	if (rkc->key_id != ctx->key_id) {
+		for (i = 0; i < ctx->keylen / 4; i++) {
+			v = cpu_to_be32(rkey[i]);
+			writel(v, rkc->reg + RK2_CRYPTO_KEY0 + i * 4);
+		}
+		rkc->key_id = ctx->key_id;
+	}
+
+	memset(iv, 0, sizeof(iv));
+	memcpy(iv, areq->iv, ivsize);
+	for (i = 0; i < DIV_ROUND_UP(ivsize, 4); i++)
+		writel(get_unaligned_be32(iv + i * 4),
+		       rkc->reg + RK2_CRYPTO_CH0_IV_0 + i * 4);
+	writel(ivsize, rkc->reg + RK2_CRYPTO_CH0_IV_LEN);
+
+	writel(areq->assoclen, rkc->reg + RK2_CRYPTO_CH0_AAD_LEN_0);
+	writel(0, rkc->reg + RK2_CRYPTO_CH0_AAD_LEN_1);
+	writel(len, rkc->reg + RK2_CRYPTO_CH0_PC_LEN_0);
+	writel(0, rkc->reg + RK2_CRYPTO_CH0_PC_LEN_1);
+
+	writel(RK2_CRYPTO_DMA_INT_LISTDONE | 0x7F, rkc->reg + RK2_CRYPTO_DMA_INT_EN);
+	writel(rkc->t_phy, rkc->reg + RK2_CRYPTO_DMA_LLI_ADDR);
+
+	reinit_completion(&rkc->complete);
+	rkc->status = 0;
+
+	start = ktime_get_ns();
+	writel(RK2_CRYPTO_DMA_CTL_START | 1 << 16, rkc->reg + RK2_CRYPTO_DMA_CTL);
+
+	wait_for_completion_interruptible_timeout(&rkc->complete,
+						  msecs_to_jiffies(10000));
+	hw_ns = ktime_get_ns() - start;
+	if (!rkc->status) {
+		dev_err(rkc->dev, "DMA timeout\n");
+		err = -EFAULT;
+		goto theend_unmap;
+	}
+
+	err = readl_poll_timeout_atomic(rkc->reg + RK2_CRYPTO_TAG_VALID, v,
+					v & RK2_CRYPTO_CH0_TAG_VALID, 10, 1000);
+	if (err) {
+		dev_err(rkc->dev, "Tag not valid\n");
+		goto theend_unmap;
+	}
+
+	for (i = 0; i < AES_BLOCK_SIZE / 4; i++) {
+		v = readl(rkc->reg + RK2_CRYPTO_CH0_TAG_0 + i * 4);
+		put_unaligned_le32(be32_to_cpu(v), tag + i * 4);
+	}
+
+theend_unmap:
+	if (src == dst) {
+		dma_unmap_sg(rkc->dev, src, nsrc, DMA_BIDIRECTIONAL);
+	} else {
+		dma_unmap_sg(rkc->dev, src, nsrc, DMA_TO_DEVICE);
+		dma_unmap_sg(rkc->dev, dst, ndst, DMA_FROM_DEVICE);
+	}
+
+	if (!err) {
+		if (rctx->mode & RK2_CRYPTO_DEC) {
+			if (crypto_memneq(tag, rctx->tag, authsize))
+				err = -EBADMSG;
+		} else {
+			scatterwalk_map_and_copy(tag, areq->dst,
+						 areq->assoclen + len, authsize, 1);
+		}
+	}
+	memzero_explicit(tag, sizeof(tag));
+	rk2_crypto_stat(algt, crypto_tfm_alg_driver_name(areq->base.tfm),
+			areq->assoclen + len, start - rctx->queued, hw_ns, err);
+theend:
+	writel(0xffff0000, rkc->reg + RK2_CRYPTO_BC_CTL);
+	pm_runtime_put_autosuspend(rkc->dev);
+theend_finalize:
+	local_bh_disable();
+	crypto_finalize_aead_request(engine, areq, err);
+	local_bh_enable();
+	return 0;
+}
+
+int rk2_aead_tfm_init(struct crypto_aead *tfm)
+{
+	struct rk2_aead_ctx *ctx = crypto_aead_ctx(tfm);
+	const char *name = crypto_tfm_alg_name(&tfm->base);
+	struct aead_alg *alg = crypto_aead_alg(tfm);
+	struct rk2_crypto_template *algt = container_of(alg, struct rk2_crypto_template, alg.aead.base);
+
+	ctx->fallback_tfm = crypto_alloc_aead(name, 0, CRYPTO_ALG_NEED_FALLBACK);
+	if (IS_ERR(ctx->fallback_tfm)) {
+		dev_err(algt->dev->dev, "ERROR: Cannot allocate fallback for %s %ld\n",
+			name, PTR_ERR(ctx->fallback_tfm));
+		return PTR_ERR(ctx->fallback_tfm);
+	}
+
+	crypto_aead_set_reqsize(tfm, sizeof(struct rk2_aead_rctx) +
+				crypto_aead_reqsize(ctx->fallback_tfm));
+
+	return 0;
+}
+
+void rk2_aead_tfm_exit(struct crypto_aead *tfm)
+{
+	struct rk2_aead_ctx *ctx = crypto_aead_ctx(tfm);
+
+	memzero_explicit(ctx->key, ctx->keylen);
+	crypto_free_aead(ctx->fallback_tfm);
+}
@@ -7,6 +7,7 @@
 #include <linux/unaligned.h>
 #include <linux/iopoll.h>
 #include "rk2_crypto.h"
+#include "rk2_crypto_trace.h"
 
 static bool rk2_ahash_need_fallback(struct ahash_request *areq)
 {
@@ -39,6 +40,8 @@ static int rk2_ahash_digest_fb(struct ahash_request *areq)
 	struct rk2_crypto_template *algt = container_of(alg, struct rk2_crypto_template, alg.hash.base);
 
 	algt->stat_fb++;
+	trace_rk2_crypto_fallback(crypto_tfm_alg_driver_name(areq->base.tfm),
+				  areq->nbytes);
 
 	ahash_request_set_tfm(&rctx->fallback_req, tfmctx->fallback_tfm);
 	rctx->fallback_req.base.flags = areq->base.flags &
@@ -84,134 +87,304 @@ static int zero_message_process(struct ahash_request *req)
 	return 0;
 }
 
+static int rk2_ahash_enqueue(struct ahash_request *req, enum rk2_hash_op op)
+{
+	struct rk2_ahash_rctx *rctx = ahash_request_ctx(req);
+	struct rk2_crypto_dev *dev;
+
+	dev = get_rk2_crypto();
+
+	rctx->dev = dev;
+	rctx->op = op;
+	rctx->queued = ktime_get_ns();
+
+	return crypto_transfer_hash_request_to_engine(dev->engine, req);
+}
+
 int rk2_ahash_init(struct ahash_request *req)
 {
 	struct rk2_ahash_rctx *rctx = ahash_request_ctx(req);
-	struct crypto_ahash *tfm = crypto_ahash_reqtfm(req);
-	struct rk2_ahash_ctx *ctx = crypto_ahash_ctx(tfm);
 
-	ahash_request_set_tfm(&rctx->fallback_req, ctx->fallback_tfm);
-	rctx->fallback_req.base.flags = req->base.flags &
-					CRYPTO_TFM_REQ_MAY_SLEEP;
+	memset(&rctx->state, 0, sizeof(rctx->state));
 
-	return crypto_ahash_init(&rctx->fallback_req);
+	return 0;
 }
 
 int rk2_ahash_update(struct ahash_request *req)
 {
 	struct rk2_ahash_rctx *rctx = ahash_request_ctx(req);
 	struct crypto_ahash *tfm = crypto_ahash_reqtfm(req);
-	struct rk2_ahash_ctx *ctx = crypto_ahash_ctx(tfm);
+	unsigned int bs = crypto_ahash_blocksize(tfm);
+	struct rk2_ahash_state *state = &rctx->state;
 
-	ahash_request_set_tfm(&rctx->fallback_req, ctx->fallback_tfm);
-	rctx->fallback_req.base.flags = req->base.flags &
-					CRYPTO_TFM_REQ_MAY_SLEEP;
-	rctx->fallback_req.nbytes = req->nbytes;
-	rctx->fallback_req.src = req->src;
+	if (!req->nbytes)
+		return 0;
+
+	/* not even a block to give to the engine, just keep the data */
+	if (state->buflen + req->nbytes <= bs) {
+		sg_pcopy_to_buffer(req->src, sg_nents(req->src),
+				   state->buf + state->buflen, req->nbytes, 0);
+		state->buflen += req->nbytes;
+		return 0;
+	}
 
-	return crypto_ahash_update(&rctx->fallback_req);
+	return rk2_ahash_enqueue(req, RK2_HASH_OP_UPDATE);
 }
 
 int rk2_ahash_final(struct ahash_request *req)
 {
 	struct rk2_ahash_rctx *rctx = ahash_request_ctx(req);
-	struct crypto_ahash *tfm = crypto_ahash_reqtfm(req);
-	struct rk2_ahash_ctx *ctx = crypto_ahash_ctx(tfm);
 
-	ahash_request_set_tfm(&rctx->fallback_req, ctx->fallback_tfm);
-	rctx->fallback_req.base.flags = req->base.flags &
-					CRYPTO_TFM_REQ_MAY_SLEEP;
-	rctx->fallback_req.result = req->result;
+	if (!rctx->state.started && !rctx->state.buflen)
+		return zero_message_process(req);
 
-	return crypto_ahash_final(&rctx->fallback_req);
+	return rk2_ahash_enqueue(req, RK2_HASH_OP_FINAL);
 }
 
 int rk2_ahash_finup(struct ahash_request *req)
 {
 	struct rk2_ahash_rctx *rctx = ahash_request_ctx(req);
-	struct crypto_ahash *tfm = crypto_ahash_reqtfm(req);
-	struct rk2_ahash_ctx *ctx = crypto_ahash_ctx(tfm);
-
-	ahash_request_set_tfm(&rctx->fallback_req, ctx->fallback_tfm);
-	rctx->fallback_req.base.flags = req->base.flags &
-					CRYPTO_TFM_REQ_MAY_SLEEP;
 
-	rctx->fallback_req.nbytes = req->nbytes;
-	rctx->fallback_req.src = req->src;
-	rctx->fallback_req.result = req->result;
+	if (!rctx->state.started && !rctx->state.buflen && !req->nbytes)
+		return zero_message_process(req);
 
-	return crypto_ahash_finup(&rctx->fallback_req);
+	return rk2_ahash_enqueue(req, RK2_HASH_OP_FINUP);
 }
 
 int rk2_ahash_import(struct ahash_request *req, const void *in)
 {
 	struct rk2_ahash_rctx *rctx = ahash_request_ctx(req);
-	struct crypto_ahash *tfm = crypto_ahash_reqtfm(req);
-	struct rk2_ahash_ctx *ctx = crypto_ahash_ctx(tfm);
 
-	ahash_request_set_tfm(&rctx->fallback_req, ctx->fallback_tfm);
-	rctx->fallback_req.base.flags = req->base.flags &
-					CRYPTO_TFM_REQ_MAY_SLEEP;
+	memcpy(&rctx->state, in, sizeof(rctx->state));
 
-	return crypto_ahash_import(&rctx->fallback_req, in);
+	return 0;
 }
 
 int rk2_ahash_export(struct ahash_request *req, void *out)
 {
 	struct rk2_ahash_rctx *rctx = ahash_request_ctx(req);
-	struct crypto_ahash *tfm = crypto_ahash_reqtfm(req);
-	struct rk2_ahash_ctx *ctx = crypto_ahash_ctx(tfm);
 
-	ahash_request_set_tfm(&rctx->fallback_req, ctx->fallback_tfm);
-	rctx->fallback_req.base.flags = req->base.flags &
-					CRYPTO_TFM_REQ_MAY_SLEEP;
+	memcpy(out, &rctx->state, sizeof(rctx->state));
 
-	return crypto_ahash_export(&rctx->fallback_req, out);
+	return 0;
 }
 
 int rk2_ahash_digest(struct ahash_request *req)
 {
-	struct rk2_ahash_rctx *rctx = ahash_request_ctx(req);
-	struct rk2_crypto_dev *dev;
-	struct crypto_engine *engine;
-
 	if (rk2_ahash_need_fallback(req))
 		return rk2_ahash_digest_fb(req);
 
 	if (!req->nbytes)
 		return zero_message_process(req);
 
-	dev = get_rk2_crypto();
+	rk2_ahash_init(req);
 
-	rctx->dev = dev;
-	engine = dev->engine;
+	return rk2_ahash_enqueue(req, RK2_HASH_OP_FINUP);
+}
+
+/*
+ * The engine loses its state when another request uses it or when it is
+ * suspended, so the intermediate state is saved after each partial request
+ * and given back before the next one.
+ */
+static void rk2_hash_restore_state(struct rk2_crypto_dev *rkc,
+				   struct rk2_ahash_state *state)
+{
+	int i;
+
+	writel(RK2_CRYPTO_MID_VALID_ENABLE | RK2_CRYPTO_MID_VALID_ENABLE << 16,
+	       rkc->reg + RK2_CRYPTO_MID_VALID_SWITCH);
+	writel(RK2_CRYPTO_HASH_MID_IS_VALID | RK2_CRYPTO_HASH_MID_IS_VALID << 16,
+	       rkc->reg + RK2_CRYPTO_MID_VALID);
 
-	return crypto_transfer_hash_request_to_engine(engine, req);
+	if (!state->started)
+		return;
+
+	for (i = 0; i < RK2_CRYPTO_HASH_MID_WORDS; i++)
+		writel(state->mid[i], rkc->reg + RK2_CRYPTO_HASH_MID_DATA_0 + i * 4);
 }
 
-static int rk2_hash_prepare(struct crypto_engine *engine, void *breq)
+static int rk2_hash_save_state(struct rk2_crypto_dev *rkc,
+			       struct rk2_ahash_state *state)
 {
-	struct ahash_request *areq = container_of(breq, struct ahash_request, base);
-	struct rk2_ahash_rctx *rctx = ahash_request_ctx(areq);
-	struct rk2_crypto_dev *rkc = rctx->dev;
-	int ret;
+	int err, i;
+	u32 v;
 
-	ret = dma_map_sg(rkc->dev, areq->src, sg_nents(areq->src), DMA_TO_DEVICE);
-	if (ret <= 0)
-		return -EINVAL;
+	err = readl_poll_timeout_atomic(rkc->reg + RK2_CRYPTO_MID_VALID, v,
+					v & RK2_CRYPTO_HASH_MID_IS_VALID,
+					10, 1000);
+	if (err) {
+		dev_err(rkc->dev, "Hash intermediate state not valid\n");
+		return err;
+	}
+
+	for (i = 0; i < RK2_CRYPTO_HASH_MID_WORDS; i++)
+		state->mid[i] = readl(rkc->reg + RK2_CRYPTO_HASH_MID_DATA_0 + i * 4);
 
-	rctx->nrsgs = ret;
+	writel(RK2_CRYPTO_HASH_MID_IS_VALID | RK2_CRYPTO_HASH_MID_IS_VALID << 16,
+	       rkc->reg + RK2_CRYPTO_MID_VALID);
 
 	return 0;
 }
 
-static void rk2_hash_unprepare(struct crypto_engine *engine, void *breq)
+/*
+ * Run the first nr descriptors of the task list, the caller has filled their
+ * source address and length.
+ */
+static int rk2_hash_pass(struct rk2_crypto_dev *rkc, struct rk2_ahash_rctx *rctx,
+			 int nr, bool last)
 {
-	struct ahash_request *areq = container_of(breq, struct ahash_request, base);
-	struct rk2_ahash_rctx *rctx = ahash_request_ctx(areq);
-	struct rk2_crypto_dev *rkc = rctx->dev;
+	struct rk2_crypto_lli *dd;
+	u64 start;
+	int i;
+
+	for (i = 0; i < nr; i++) {
+		dd = &rkc->tl[i];
+		dd->dst_addr = 0;
+		dd->dst_len = 0;
+		dd->iv = 0;
+		dd->user = 0;
+		dd->dma_ctrl = i << 24 | RK2_LLI_DMA_CTRL_SRC_INT;
+		dd->next = rkc->t_phy + sizeof(struct rk2_crypto_lli) * (i + 1);
+	}
+
+	rkc->tl[0].user = RK2_LLI_CIPHER_START;
+	if (!rctx->state.started)
+		rkc->tl[0].user |= RK2_LLI_STRING_FIRST;
+
+	dd = &rkc->tl[nr - 1];
+	dd->dma_ctrl |= RK2_LLI_DMA_CTRL_LAST;
+	if (last)
+		dd->user |= RK2_LLI_STRING_LAST;
+	dd->next = 1;
+
+	writel(RK2_CRYPTO_DMA_INT_LISTDONE | 0x7F, rkc->reg + RK2_CRYPTO_DMA_INT_EN);
+
+	writel(rkc->t_phy, rkc->reg + RK2_CRYPTO_DMA_LLI_ADDR);
+
+	reinit_completion(&rkc->complete);
+	rkc->status = 0;
+
+	start = ktime_get_ns();
+	writel(RK2_CRYPTO_DMA_CTL_START | RK2_CRYPTO_DMA_CTL_START << 16, rkc->reg + RK2_CRYPTO_DMA_CTL);
+
+	wait_for_completion_interruptible_timeout(&rkc->complete,
+						  msecs_to_jiffies(2000));
+	rctx->hw_ns += ktime_get_ns() - start;
+	if (!rkc->status) {
+		dev_err(rkc->dev, "DMA timeout\n");
+		return -EFAULT;
+	}
+
+	rctx->state.started = true;
+
+	return 0;
+}
+
+static bool rk2_hash_can_dma(struct rk2_ahash_state *state,
+			     struct scatterlist *sg, unsigned int len)
+{
+	if (state->buflen % 4)
+		return false;
+
+	while (sg && len) {
+		if (!IS_ALIGNED(sg->offset, sizeof(u32)))
+			return false;
+		if (min(sg->length, len) % 4)
+			return false;
+		len -= min(sg->length, len);
+		sg = sg_next(sg);
+	}
+	return true;
+}
+
+/*
+ * Hash the buffered data followed by the first len bytes of src, the source
+ * is read in place, only the buffered data goes through the bounce buffer.
+ */
+static int rk2_hash_feed_dma(struct rk2_crypto_dev *rkc, struct rk2_ahash_rctx *rctx,
+			     struct scatterlist *src, unsigned int len, bool last)
+{
+	struct rk2_ahash_state *state = &rctx->state;
+	struct scatterlist *sg;
+	int nents = 0;
+	int ddi = 0;
+	int err = 0;
+	int i;
+
+	if (state->buflen) {
+		memcpy(rkc->hbuf, state->buf, state->buflen);
+		rkc->tl[0].src_addr = rkc->h_phy;
+		rkc->tl[0].src_len = state->buflen;
+		ddi++;
+	}
+
+	if (len) {
+		nents = sg_nents_for_len(src, len);
+		rctx->nrsgs = dma_map_sg(rkc->dev, src, nents, DMA_TO_DEVICE);
+		if (rctx->nrsgs <= 0)
+			return -EINVAL;
+	}
+
+	for_each_sg(src, sg, len ? rctx->nrsgs : 0, i) {
+		if (ddi == MAX_LLI) {
+			err = rk2_hash_pass(rkc, rctx, ddi, false);
+			if (err)
+				goto theend;
+			ddi = 0;
+		}
+		rkc->tl[ddi].src_addr = sg_dma_address(sg);
+		rkc->tl[ddi].src_len = min(sg_dma_len(sg), len);
+		len -= rkc->tl[ddi].src_len;
+		ddi++;
+		if (!len)
+			break;
+	}
+
+	err = rk2_hash_pass(rkc, rctx, ddi, last);
+
+theend:
+	if (nents)
+		dma_unmap_sg(rkc->dev, src, nents, DMA_TO_DEVICE);
+	return err;
+}
+
+/*
+ * Same as rk2_hash_feed_dma() for sources the DMA cannot read, everything is
+ * copied through the bounce buffer.
+ */
+static int rk2_hash_feed_bounce(struct rk2_crypto_dev *rkc, struct rk2_ahash_rctx *rctx,
+				struct scatterlist *src, unsigned int len, bool last)
+{
+	struct rk2_ahash_state *state = &rctx->state;
+	unsigned int total = state->buflen + len;
+	unsigned int done = 0;
+	unsigned int skip = 0;
+	unsigned int todo, n;
+	int err;
+
+	do {
+		todo = min_t(unsigned int, total - done, RK2_HASH_BOUNCE_SIZE);
+		n = 0;
+		if (done < state->buflen) {
+			n = min(todo, state->buflen - done);
+			memcpy(rkc->hbuf, state->buf + done, n);
+		}
+		if (todo > n) {
+			sg_pcopy_to_buffer(src, sg_nents(src), rkc->hbuf + n,
+					   todo - n, skip);
+			skip += todo - n;
+		}
+		done += todo;
+
+		rkc->tl[0].src_addr = rkc->h_phy;
+		rkc->tl[0].src_len = todo;
+		err = rk2_hash_pass(rkc, rctx, 1, last && done == total);
+		if (err)
+			return err;
+	} while (done < total);
 
-	dma_unmap_sg(rkc->dev, areq->src, rctx->nrsgs, DMA_TO_DEVICE);
+	return 0;
 }
 
 int rk2_hash_run(struct crypto_engine *engine, void *breq)
@@ -221,78 +394,68 @@ int rk2_hash_run(struct crypto_engine *engine, void *breq)
 	struct rk2_ahash_rctx *rctx = ahash_request_ctx(areq);
 	struct ahash_alg *alg = crypto_ahash_alg(tfm);
 	struct rk2_crypto_template *algt = container_of(alg, struct rk2_crypto_template, alg.hash.base);
-	struct scatterlist *sgs = areq->src;
+	unsigned int bs = crypto_ahash_blocksize(tfm);
+	struct rk2_ahash_state *state = &rctx->state;
 	struct rk2_crypto_dev *rkc = rctx->dev;
-	struct rk2_crypto_lli *dd = &rkc->tl[0];
-	int ddi = 0;
+	bool last = rctx->op != RK2_HASH_OP_UPDATE;
+	unsigned int nbytes = rctx->op == RK2_HASH_OP_FINAL ? 0 : areq->nbytes;
+	unsigned int len = nbytes;
+	unsigned int keep = 0;
+	unsigned int hashed;
+	u64 start;
 	int err = 0;
-	unsigned int len = areq->nbytes;
-	unsigned int todo;
 	u32 v;
 	int i;
 
-	err = rk2_hash_prepare(engine, breq);
+	/*
+	 * Only whole blocks are given to the engine before the final request,
+	 * and at least one byte is kept so that the final request has data.
+	 */
+	if (!last) {
+		keep = (state->buflen + nbytes) % bs;
+		if (!keep)
+			keep = bs;
+		len = nbytes - keep;
+	}
+
+	hashed = state->buflen + len;
+
+	rk2_cipher_flush(rkc);
+	start = ktime_get_ns();
+	rctx->hw_ns = 0;
 
 	err = pm_runtime_resume_and_get(rkc->dev);
 	if (err)
-		return err;
+		goto theend;
 
-	dev_dbg(rkc->dev, "%s %s len=%d\n", __func__,
-		crypto_tfm_alg_name(areq->base.tfm), areq->nbytes);
+	dev_dbg(rkc->dev, "%s %s op=%d len=%u buffered=%u\n", __func__,
+		crypto_tfm_alg_name(areq->base.tfm), rctx->op, len, state->buflen);
 
 	algt->stat_req++;
 	rkc->nreq++;
 
+	rk2_hash_restore_state(rkc, state);
+
 	rctx->mode = algt->rk2_mode;
 	rctx->mode |= 0xffff0000;
 	rctx->mode |= RK2_CRYPTO_ENABLE | RK2_CRYPTO_HW_PAD;
 	writel(rctx->mode, rkc->reg + RK2_CRYPTO_HASH_CTL);
 
-	while (sgs && len > 0) {
-		dd = &rkc->tl[ddi];
-
-		todo = min(sg_dma_len(sgs), len);
-		dd->src_addr = sg_dma_address(sgs);
-		dd->src_len = todo;
-		dd->dst_addr = 0;
-		dd->dst_len = 0;
-		dd->dma_ctrl = ddi << 24;
-		dd->iv = 0;
-		dd->next = rkc->t_phy + sizeof(struct rk2_crypto_lli) * (ddi + 1);
-
-		if (ddi == 0)
-			dd->user = RK2_LLI_CIPHER_START | RK2_LLI_STRING_FIRST;
-		else
-			dd->user = 0;
-
-		len -= todo;
-		dd->dma_ctrl |= RK2_LLI_DMA_CTRL_SRC_INT;
-		if (len == 0) {
-			dd->user |= RK2_LLI_STRING_LAST;
-			dd->dma_ctrl |= RK2_LLI_DMA_CTRL_LAST;
-		}
-		dev_dbg(rkc->dev, "HASH SG %d sglen=%d user=%x dma=%x mode=%x len=%d todo=%d phy=%llx\n",
-			ddi, sgs->length, dd->user, dd->dma_ctrl, rctx->mode, len, todo, rkc->t_phy);
-
-		sgs = sg_next(sgs);
-		ddi++;
-	}
-	dd->next = 1;
-	writel(RK2_CRYPTO_DMA_INT_LISTDONE | 0x7F, rkc->reg + RK2_CRYPTO_DMA_INT_EN);
-
-	writel(rkc->t_phy, rkc->reg + RK2_CRYPTO_DMA_LLI_ADDR);
-
-	reinit_completion(&rkc->complete);
-	rkc->status = 0;
-
-	writel(RK2_CRYPTO_DMA_CTL_START | RK2_CRYPTO_DMA_CTL_START << 16, rkc->reg + RK2_CRYPTO_DMA_CTL);
-
-	wait_for_completion_interruptible_timeout(&rkc->complete,
-						  msecs_to_jiffies(2000));
-	if (!rkc->status) {
-		dev_err(rkc->dev, "DMA timeout\n");
-		err = -EFAULT;
-		goto theend;
+	if (rk2_hash_can_dma(state, areq->src, len))
+		err = rk2_hash_feed_dma(rkc, rctx, areq->src, len, last);
+	else
+		err = rk2_hash_feed_bounce(rkc, rctx, areq->src, len, last);
+	if (err)
+		goto theend_pm;
+
+	if (!last) {
+		err = rk2_hash_save_state(rkc, state);
+		if (err)
+			goto theend_pm;
+		sg_pcopy_to_buffer(areq->src, sg_nents(areq->src), state->buf,
+				   keep, len);
+		state->buflen = keep;
+		goto theend_pm;
 	}
 
 	readl_poll_timeout_atomic(rkc->reg + RK2_CRYPTO_HASH_VALID, v, v == 1,
@@ -302,12 +465,15 @@ int rk2_hash_run(struct crypto_engine *engine, void *breq)
 		v = readl(rkc->reg + RK2_CRYPTO_HASH_DOUT_0 + i * 4);
 		put_unaligned_le32(be32_to_cpu(v), areq->result + i * 4);
 	}
+	memzero_explicit(state, sizeof(*state));
 
-theend:
+theend_pm:
+	writel(0xffff0000, rkc->reg + RK2_CRYPTO_HASH_CTL);
+	writel(RK2_CRYPTO_MID_VALID_ENABLE << 16, rkc->reg + RK2_CRYPTO_MID_VALID_SWITCH);
 	pm_runtime_put_autosuspend(rkc->dev);
-
-	rk2_hash_unprepare(engine, breq);
-
+	rk2_crypto_stat(algt, crypto_tfm_alg_driver_name(areq->base.tfm), hashed,
+			start - rctx->queued, rctx->hw_ns, err);
+theend:
 	local_bh_disable();
 	crypto_finalize_hash_request(engine, breq, err);
 	local_bh_enable();
@@ -6,6 +6,7 @@
  */
 #include <crypto/scatterwalk.h>
 #include "rk2_crypto.h"
+#include "rk2_crypto_trace.h"
 
 static void rk2_print(struct rk2_crypto_dev *rkc)
 {
@@ -191,54 +192,97 @@ static void rk2_print(struct rk2_crypto_dev *rkc)
 	dev_info(rkc->dev, "RK2_CRYPTO_DMA_INT_ST %x\n", v);
 }
 
+/*
+ * Decryption runs each segment on its own, see rk2_cipher_run_segments(), so
+ * the source and destination segments must match.
+ */
+static bool rk2_cipher_sg_differ(struct skcipher_request *req)
+{
+	struct scatterlist *sgs = req->src, *sgd = req->dst;
+	unsigned int len = req->cryptlen;
+	unsigned int stodo, dtodo;
+
+	while (sgs && sgd && len) {
+		stodo = min(len, sgs->length);
+		dtodo = min(len, sgd->length);
+		if (stodo != dtodo)
+			return true;
+		len -= stodo;
+		sgs = sg_next(sgs);
+		sgd = sg_next(sgd);
+	}
+	return false;
+}
+
 static int rk2_cipher_need_fallback(struct skcipher_request *req)
 {
+	struct rk2_cipher_rctx *rctx = skcipher_request_ctx(req);
 	struct crypto_skcipher *tfm = crypto_skcipher_reqtfm(req);
 	struct skcipher_alg *alg = crypto_skcipher_alg(tfm);
 	struct rk2_crypto_template *algt = container_of(alg, struct rk2_crypto_template, alg.skcipher.base);
-	struct scatterlist *sgs, *sgd;
-	unsigned int stodo, dtodo, len;
+	struct scatterlist *sg;
+	unsigned int todo, len;
 	unsigned int bs = crypto_skcipher_blocksize(tfm);
+	int nsrc, ndst;
 
 	if (!req->cryptlen)
 		return true;
 
+	if (req->cryptlen < rk2_crypto_fallback_threshold()) {
+		algt->stat_fb_small++;
+		return true;
+	}
+
+	nsrc = sg_nents_for_len(req->src, req->cryptlen);
+	ndst = sg_nents_for_len(req->dst, req->cryptlen);
+	if (nsrc < 0 || ndst < 0)
+		return true;
+
 	if (algt->is_xts) {
-		if (sg_nents_for_len(req->src, req->cryptlen) > 1)
-			return true;
-		if (sg_nents_for_len(req->dst, req->cryptlen) > 1)
+		if (nsrc > 1 || ndst > 1)
 			return true;
 	}
 
+	if ((rctx->mode & RK2_CRYPTO_DEC) && rk2_cipher_sg_differ(req)) {
+		algt->stat_fb_sgdiff++;
+		return true;
+	}
+
+	/*
+	 * Each descriptor covers the overlap between a source and a
+	 * destination segment, so there is at most nsrc + ndst - 1 of them.
+	 */
+	if (nsrc + ndst - 1 > MAX_LLI) {
+		algt->stat_fb_sgdiff++;
+		return true;
+	}
+
 	len = req->cryptlen;
-	sgs = req->src;
-	sgd = req->dst;
-	while (sgs && sgd) {
-		if (!IS_ALIGNED(sgs->offset, sizeof(u32))) {
+	for (sg = req->src; sg && len; sg = sg_next(sg)) {
+		if (!IS_ALIGNED(sg->offset, sizeof(u32))) {
 			algt->stat_fb_align++;
 			return true;
 		}
-		if (!IS_ALIGNED(sgd->offset, sizeof(u32))) {
-			algt->stat_fb_align++;
-			return true;
-		}
-		stodo = min(len, sgs->length);
-		if (stodo % bs) {
+		todo = min(len, sg->length);
+		if (todo % bs) {
 			algt->stat_fb_len++;
 			return true;
 		}
-		dtodo = min(len, sgd->length);
-		if (dtodo % bs) {
-			algt->stat_fb_len++;
+		len -= todo;
+	}
+
+	len = req->cryptlen;
+	for (sg = req->dst; sg && len; sg = sg_next(sg)) {
+		if (!IS_ALIGNED(sg->offset, sizeof(u32))) {
+			algt->stat_fb_align++;
 			return true;
 		}
-		if (stodo != dtodo) {
-			algt->stat_fb_sgdiff++;
+		todo = min(len, sg->length);
+		if (todo % bs) {
+			algt->stat_fb_len++;
 			return true;
 		}
-		len -= stodo;
-		sgs = sg_next(sgs);
-		sgd = sg_next(sgd);
+		len -= todo;
 	}
 	return false;
 }
@@ -253,6 +297,8 @@ static int rk2_cipher_fallback(struct skcipher_request *areq)
 	int err;
 
 	algt->stat_fb++;
+	trace_rk2_crypto_fallback(crypto_tfm_alg_driver_name(areq->base.tfm),
+				  areq->cryptlen);
 
 	skcipher_request_set_tfm(&rctx->fallback_req, op->fallback_tfm);
 	skcipher_request_set_callback(&rctx->fallback_req, areq->base.flags,
@@ -284,6 +330,7 @@ static int rk2_cipher_handle_req(struct skcipher_request *req)
 
 	engine = rkc->engine;
 	rctx->dev = rkc;
+	rctx->queued = ktime_get_ns();
 
 	return crypto_transfer_skcipher_request_to_engine(engine, req);
 }
@@ -301,6 +348,7 @@ int rk2_aes_xts_setkey(struct crypto_skcipher *cipher, const u8 *key,
 
 	ctx->keylen = keylen;
 	memcpy(ctx->key, key, keylen);
+	ctx->key_id = rk2_crypto_new_key_id();
 
 	return crypto_skcipher_setkey(ctx->fallback_tfm, key, keylen);
 }
@@ -316,6 +364,7 @@ int rk2_aes_setkey(struct crypto_skcipher *cipher, const u8 *key,
 		return -EINVAL;
 	ctx->keylen = keylen;
 	memcpy(ctx->key, key, keylen);
+	ctx->key_id = rk2_crypto_new_key_id();
 
 	return crypto_skcipher_setkey(ctx->fallback_tfm, key, keylen);
 }
@@ -342,38 +391,71 @@ int rk2_skcipher_decrypt(struct skcipher_request *req)
 	return rk2_cipher_handle_req(req);
 }
 
-int rk2_cipher_run(struct crypto_engine *engine, void *async_req)
+/*
+ * Build one descriptor for each piece where a source and a destination
+ * segment overlap, starting at descriptor ddi. The whole list is then a single
+ * string for the engine, the caller marks the first descriptor.
+ * Return the number of descriptors used.
+ */
+int rk2_cipher_build_lli(struct rk2_crypto_dev *rkc, int ddi,
+			 struct scatterlist *sgs, struct scatterlist *sgd,
+			 unsigned int len)
 {
-	struct skcipher_request *areq = container_of(async_req, struct skcipher_request, base);
-	struct crypto_skcipher *tfm = crypto_skcipher_reqtfm(areq);
-	struct rk2_cipher_rctx *rctx = skcipher_request_ctx(areq);
-	struct rk2_cipher_ctx *ctx = crypto_skcipher_ctx(tfm);
-	struct scatterlist *sgs, *sgd;
-	int err = 0;
-	int ivsize = crypto_skcipher_ivsize(tfm);
-	unsigned int len = areq->cryptlen;
+	struct rk2_crypto_lli *dd = NULL;
+	unsigned int soff = 0, doff = 0;
 	unsigned int todo;
-	struct skcipher_alg *alg = crypto_skcipher_alg(tfm);
-	struct rk2_crypto_template *algt = container_of(alg, struct rk2_crypto_template, alg.skcipher.base);
-	struct rk2_crypto_dev *rkc = rctx->dev;
-	struct rk2_crypto_lli *dd = &rkc->tl[0];
-	u32 m, v;
-	u32 *rkey = (u32 *)ctx->key;
-	u32 *riv = (u32 *)areq->iv;
-	int i;
-	unsigned int offset;
 
-	algt->stat_req++;
-	rkc->nreq++;
+	while (len) {
+		if (!sgs || !sgd || ddi == MAX_LLI)
+			return -EINVAL;
+
+		todo = min3(sg_dma_len(sgs) - soff, sg_dma_len(sgd) - doff, len);
+
+		dd = &rkc->tl[ddi];
+		dd->src_addr = sg_dma_address(sgs) + soff;
+		dd->src_len = todo;
+		dd->dst_addr = sg_dma_address(sgd) + doff;
+		dd->dst_len = todo;
+		dd->iv = 0;
+		dd->user = 0;
+		dd->dma_ctrl = ddi << 24;
+		dd->next = rkc->t_phy + sizeof(struct rk2_crypto_lli) * (ddi + 1);
+
+		len -= todo;
+		soff += todo;
+		doff += todo;
+		if (soff == sg_dma_len(sgs)) {
+			sgs = sg_next(sgs);
+			soff = 0;
+		}
+		if (doff == sg_dma_len(sgd)) {
+			sgd = sg_next(sgd);
+			doff = 0;
+		}
+		ddi++;
+	}
+
+	if (!dd)
+		return -EINVAL;
 
-	m = rctx->mode | RK2_CRYPTO_ENABLE;
+	dd->user |= RK2_LLI_STRING_LAST;
+	dd->dma_ctrl |= RK2_LLI_DMA_CTRL_DST_INT | RK2_LLI_DMA_CTRL_LAST;
+	dd->next = 1;
+
+	return ddi;
+}
+
+static int rk2_cipher_mode(struct rk2_crypto_dev *rkc, struct rk2_cipher_ctx *ctx,
+			   struct rk2_crypto_template *algt, u32 mode, u32 *m)
+{
+	*m = mode | RK2_CRYPTO_ENABLE;
 	if (algt->is_xts) {
 		switch (ctx->keylen) {
 		case AES_KEYSIZE_128 * 2:
-			m |= RK2_CRYPTO_AES_128BIT_key;
+			*m |= RK2_CRYPTO_AES_128BIT_key;
 			break;
 		case AES_KEYSIZE_256 * 2:
-			m |= RK2_CRYPTO_AES_256BIT_key;
+			*m |= RK2_CRYPTO_AES_256BIT_key;
 			break;
 		default:
 			dev_err(rkc->dev, "Invalid key length %u\n", ctx->keylen);
@@ -382,13 +464,13 @@ int rk2_cipher_run(struct crypto_engine *engine, void *async_req)
 	} else {
 		switch (ctx->keylen) {
 		case AES_KEYSIZE_128:
-			m |= RK2_CRYPTO_AES_128BIT_key;
+			*m |= RK2_CRYPTO_AES_128BIT_key;
 			break;
 		case AES_KEYSIZE_192:
-			m |= RK2_CRYPTO_AES_192BIT_key;
+			*m |= RK2_CRYPTO_AES_192BIT_key;
 			break;
 		case AES_KEYSIZE_256:
-			m |= RK2_CRYPTO_AES_256BIT_key;
+			*m |= RK2_CRYPTO_AES_256BIT_key;
 			break;
 		default:
 			dev_err(rkc->dev, "Invalid key length %u\n", ctx->keylen);
@@ -396,73 +478,269 @@ int rk2_cipher_run(struct crypto_engine *engine, void *async_req)
 		}
 	}
 
-	err = pm_runtime_resume_and_get(rkc->dev);
-	if (err)
-		return err;
-
 	/* the upper bits are a write enable mask, so we need to write 1 to all
 	 * upper 16 bits to allow write to the 16 lower bits
 	 */
-	m |= 0xffff0000;
+	*m |= 0xffff0000;
+
+	return 0;
+}
+
+/* The key registers keep their content until the engine is reset */
+static void rk2_cipher_load_key(struct rk2_crypto_dev *rkc, struct rk2_cipher_ctx *ctx,
+				struct rk2_crypto_template *algt)
+{
+	u32 *rkey = (u32 *)ctx->key;
+	int i;
+
+	if (rkc->key_id == ctx->key_id)
+		return;
+
+	if (algt->is_xts) {
+		for (i = 0; i < ctx->keylen / 8; i++)
+			writel(cpu_to_be32(rkey[i]), rkc->reg + RK2_CRYPTO_KEY0 + i * 4);
+		for (i = 0; i < (ctx->keylen / 8); i++)
+			writel(cpu_to_be32(rkey[i + ctx->keylen / 8]),
+			       rkc->reg + RK2_CRYPTO_CH4_KEY0 + i * 4);
+	} else {
+		for (i = 0; i < ctx->keylen / 4; i++)
+			writel(cpu_to_be32(rkey[i]), rkc->reg + RK2_CRYPTO_KEY0 + i * 4);
+	}
+	rkc->key_id = ctx->key_id;
+}
+
+static void rk2_cipher_unmap(struct rk2_crypto_dev *rkc, struct skcipher_request *areq)
+{
+	struct rk2_cipher_rctx *rctx = skcipher_request_ctx(areq);
+
+	if (areq->src == areq->dst) {
+		dma_unmap_sg(rkc->dev, areq->src, rctx->nsrc, DMA_BIDIRECTIONAL);
+	} else {
+		dma_unmap_sg(rkc->dev, areq->src, rctx->nsrc, DMA_TO_DEVICE);
+		dma_unmap_sg(rkc->dev, areq->dst, rctx->ndst, DMA_FROM_DEVICE);
+	}
+}
+
+static int rk2_cipher_map(struct rk2_crypto_dev *rkc, struct skcipher_request *areq)
+{
+	struct rk2_cipher_rctx *rctx = skcipher_request_ctx(areq);
+	int err;
+
+	if (areq->src == areq->dst) {
+		err = dma_map_sg(rkc->dev, areq->src, rctx->nsrc, DMA_BIDIRECTIONAL);
+		if (err <= 0)
+			goto err_sg;
+	} else {
+		err = dma_map_sg(rkc->dev, areq->src, rctx->nsrc, DMA_TO_DEVICE);
+		if (err <= 0)
+			goto err_sg;
+		err = dma_map_sg(rkc->dev, areq->dst, rctx->ndst, DMA_FROM_DEVICE);
+		if (err <= 0) {
+			dma_unmap_sg(rkc->dev, areq->src, rctx->nsrc, DMA_TO_DEVICE);
+			goto err_sg;
+		}
+	}
+	return 0;
+
+err_sg:
+	dev_err(rkc->dev, "Invalid sg number %d\n", err);
+	return -EINVAL;
+}
+
+/*
+ * Run n requests sharing the same key and mode as a single descriptor list.
+ * Only ECB requests are batched, the other modes always come alone.
+ */
+static int rk2_cipher_run_list(struct rk2_crypto_dev *rkc,
+			       struct skcipher_request **reqs, unsigned int n)
+{
+	struct crypto_skcipher *tfm = crypto_skcipher_reqtfm(reqs[0]);
+	struct rk2_cipher_rctx *rctx = skcipher_request_ctx(reqs[0]);
+	struct rk2_cipher_ctx *ctx = crypto_skcipher_ctx(tfm);
+	struct skcipher_alg *alg = crypto_skcipher_alg(tfm);
+	struct rk2_crypto_template *algt = container_of(alg, struct rk2_crypto_template, alg.skcipher.base);
+	unsigned int ivsize = crypto_skcipher_ivsize(tfm);
+	struct skcipher_request *areq = reqs[0];
+	u32 *riv = (u32 *)areq->iv;
+	struct rk2_crypto_lli *dd;
+	unsigned int i, mapped = 0;
+	u64 start = ktime_get_ns();
+	u64 hw_ns = 0;
+	int ddi = 0;
+	int err;
+	u32 m;
+
+	err = rk2_cipher_mode(rkc, ctx, algt, rctx->mode, &m);
+	if (err)
+		return err;
+
+	/* the last ciphertext block is the next IV, save it before in place decryption */
+	if (areq->iv && ivsize > 0 && (rctx->mode & RK2_CRYPTO_DEC))
+		scatterwalk_map_and_copy(rctx->backup_iv, areq->src,
+					 areq->cryptlen - ivsize, ivsize, 0);
+
+	for (mapped = 0; mapped < n; mapped++) {
+		err = rk2_cipher_map(rkc, reqs[mapped]);
+		if (err)
+			goto theend_unmap;
+	}
+
+	for (i = 0; i < n; i++) {
+		dev_dbg(rkc->dev, "%s %s len=%u keylen=%u mode=%x\n", __func__,
+			crypto_tfm_alg_name(reqs[i]->base.tfm),
+			reqs[i]->cryptlen, ctx->keylen, m);
+		algt->stat_req++;
+		rkc->nreq++;
+
+		/* chain the previous request to this one, in the same string */
+		if (ddi) {
+			dd = &rkc->tl[ddi - 1];
+			dd->user &= ~RK2_LLI_STRING_LAST;
+			dd->dma_ctrl &= ~(RK2_LLI_DMA_CTRL_DST_INT | RK2_LLI_DMA_CTRL_LAST);
+			dd->next = rkc->t_phy + sizeof(struct rk2_crypto_lli) * ddi;
+		}
+
+		err = rk2_cipher_build_lli(rkc, ddi, reqs[i]->src, reqs[i]->dst,
+					   reqs[i]->cryptlen);
+		if (err < 0) {
+			dev_err(rkc->dev, "Cannot build the descriptor list\n");
+			goto theend_unmap;
+		}
+		ddi = err;
+	}
+	rkc->tl[0].user |= RK2_LLI_CIPHER_START | RK2_LLI_STRING_FIRST;
+	err = 0;
+
+	writel(m, rkc->reg + RK2_CRYPTO_BC_CTL);
+	rk2_cipher_load_key(rkc, ctx, algt);
+
+	if (ivsize) {
+		for (i = 0; i < ivsize / 4; i++)
+			writel(cpu_to_be32(riv[i]),
+			       rkc->reg + RK2_CRYPTO_CH0_IV_0 + i * 4);
+		writel(ivsize, rkc->reg + RK2_CRYPTO_CH0_IV_LEN);
+	}
+
+	writel(RK2_CRYPTO_DMA_INT_LISTDONE | 0x7F, rkc->reg + RK2_CRYPTO_DMA_INT_EN);
+
+	/*writel(0x00030000, rkc->reg + RK2_CRYPTO_FIFO_CTL);*/
+	writel(rkc->t_phy, rkc->reg + RK2_CRYPTO_DMA_LLI_ADDR);
+
+	reinit_completion(&rkc->complete);
+	rkc->status = 0;
+
+	start = ktime_get_ns();
+	writel(RK2_CRYPTO_DMA_CTL_START | 1 << 16, rkc->reg + RK2_CRYPTO_DMA_CTL);
+
+	wait_for_completion_interruptible_timeout(&rkc->complete,
+						  msecs_to_jiffies(10000));
+	hw_ns = ktime_get_ns() - start;
+	if (!rkc->status) {
+		dev_err(rkc->dev, "DMA timeout\n");
+		rk2_print(rkc);
+		err = -EFAULT;
+	}
+
+theend_unmap:
+	for (i = 0; i < mapped; i++)
+		rk2_cipher_unmap(rkc, reqs[i]);
+
+	/* the requests of a list share the time spent in hardware */
+	for (i = 0; i < n; i++) {
+		struct rk2_cipher_rctx *r = skcipher_request_ctx(reqs[i]);
+
+		rk2_crypto_stat(algt, crypto_tfm_alg_driver_name(reqs[i]->base.tfm),
+				reqs[i]->cryptlen, start - r->queued,
+				div_u64(hw_ns, n), err);
+	}
+
+	if (!err && areq->iv && ivsize > 0) {
+		if (rctx->mode & RK2_CRYPTO_DEC)
+			memcpy(areq->iv, rctx->backup_iv, ivsize);
+		else
+			scatterwalk_map_and_copy(areq->iv, areq->dst,
+						 areq->cryptlen - ivsize,
+						 ivsize, 0);
+	}
+	memzero_explicit(rctx->backup_iv, sizeof(rctx->backup_iv));
+	writel(0xffff0000, rkc->reg + RK2_CRYPTO_BC_CTL);
+
+	return err;
+}
+
+/*
+ * Run a decryption one segment at a time, with a single descriptor each and
+ * the IV reloaded in between.
+ * Using one descriptor per SG in a single string works for encryption, but
+ * decryption always fails from the second descriptor on, the hardware
+ * probably does not chain the IV itself when decrypting.
+ */
+static int rk2_cipher_run_segments(struct rk2_crypto_dev *rkc,
+				   struct skcipher_request *areq)
+{
+	struct crypto_skcipher *tfm = crypto_skcipher_reqtfm(areq);
+	struct rk2_cipher_rctx *rctx = skcipher_request_ctx(areq);
+	struct rk2_cipher_ctx *ctx = crypto_skcipher_ctx(tfm);
+	struct skcipher_alg *alg = crypto_skcipher_alg(tfm);
+	struct rk2_crypto_template *algt = container_of(alg, struct rk2_crypto_template, alg.skcipher.base);
+	unsigned int ivsize = crypto_skcipher_ivsize(tfm);
+	struct rk2_crypto_lli *dd = &rkc->tl[0];
+	unsigned int len = areq->cryptlen;
+	struct scatterlist *sgs, *sgd;
+	u32 *riv = (u32 *)areq->iv;
+	u64 start = ktime_get_ns();
+	u64 hw_ns = 0, t;
+	unsigned int todo, i;
+	int err;
+	u32 m;
+
+	err = rk2_cipher_mode(rkc, ctx, algt, rctx->mode, &m);
+	if (err)
+		return err;
 
 	dev_dbg(rkc->dev, "%s %s len=%u keylen=%u mode=%x\n", __func__,
 		crypto_tfm_alg_name(areq->base.tfm),
 		areq->cryptlen, ctx->keylen, m);
-	sgs = areq->src;
-	sgd = areq->dst;
+	algt->stat_req++;
+	rkc->nreq++;
 
-	while (sgs && sgd && len) {
-		ivsize = crypto_skcipher_ivsize(tfm);
-		if (areq->iv && crypto_skcipher_ivsize(tfm) > 0) {
-			if (rctx->mode & RK2_CRYPTO_DEC) {
-				offset = sgs->length - ivsize;
-				scatterwalk_map_and_copy(rctx->backup_iv, sgs,
-							 offset, ivsize, 0);
-			}
-		}
+	for (sgs = areq->src, sgd = areq->dst; sgs && sgd && len;
+	     sgs = sg_next(sgs), sgd = sg_next(sgd)) {
+		todo = min(sgs->length, len);
+		if (!todo)
+			continue;
 
-		dev_dbg(rkc->dev, "SG len=%u mode=%x ivsize=%u\n", sgs->length, m, ivsize);
+		/* the last ciphertext block is the next IV, save it before in place decryption */
+		if (areq->iv && ivsize > 0)
+			scatterwalk_map_and_copy(rctx->backup_iv, sgs,
+						 todo - ivsize, ivsize, 0);
 
 		if (sgs == sgd) {
 			err = dma_map_sg(rkc->dev, sgs, 1, DMA_BIDIRECTIONAL);
 			if (err != 1) {
 				dev_err(rkc->dev, "Invalid sg number %d\n", err);
 				err = -EINVAL;
-				goto theend;
+				break;
 			}
 		} else {
 			err = dma_map_sg(rkc->dev, sgs, 1, DMA_TO_DEVICE);
 			if (err != 1) {
 				dev_err(rkc->dev, "Invalid sg number %d\n", err);
 				err = -EINVAL;
-				goto theend;
+				break;
 			}
 			err = dma_map_sg(rkc->dev, sgd, 1, DMA_FROM_DEVICE);
 			if (err != 1) {
 				dev_err(rkc->dev, "Invalid sg number %d\n", err);
 				err = -EINVAL;
 				dma_unmap_sg(rkc->dev, sgs, 1, DMA_TO_DEVICE);
-				goto theend;
+				break;
 			}
 		}
 		err = 0;
-		writel(m, rkc->reg + RK2_CRYPTO_BC_CTL);
 
-		if (algt->is_xts) {
-			for (i = 0; i < ctx->keylen / 8; i++) {
-				v = cpu_to_be32(rkey[i]);
-				writel(v, rkc->reg + RK2_CRYPTO_KEY0 + i * 4);
-			}
-			for (i = 0; i < (ctx->keylen / 8); i++) {
-				v = cpu_to_be32(rkey[i + ctx->keylen / 8]);
-				writel(v, rkc->reg + RK2_CRYPTO_CH4_KEY0 + i * 4);
-			}
-		} else {
-			for (i = 0; i < ctx->keylen / 4; i++) {
-				v = cpu_to_be32(rkey[i]);
-				writel(v, rkc->reg + RK2_CRYPTO_KEY0 + i * 4);
-			}
-		}
+		writel(m, rkc->reg + RK2_CRYPTO_BC_CTL);
+		rk2_cipher_load_key(rkc, ctx, algt);
 
 		if (ivsize) {
 			for (i = 0; i < ivsize / 4; i++)
@@ -470,43 +748,29 @@ int rk2_cipher_run(struct crypto_engine *engine, void *async_req)
 				       rkc->reg + RK2_CRYPTO_CH0_IV_0 + i * 4);
 			writel(ivsize, rkc->reg + RK2_CRYPTO_CH0_IV_LEN);
 		}
-		if (!sgs->length) {
-			sgs = sg_next(sgs);
-			sgd = sg_next(sgd);
-			continue;
-		}
 
-		/* The hw support multiple descriptor, so why this driver use
-		 * only one descriptor ?
-		 * Using one descriptor per SG seems the way to do and it works
-		 * but only when doing encryption.
-		 * With decryption it always fail on second descriptor.
-		 * Probably the HW dont know how to use IV.
-		 */
-		todo = min(sg_dma_len(sgs), len);
-		len -= todo;
 		dd->src_addr = sg_dma_address(sgs);
 		dd->src_len = todo;
 		dd->dst_addr = sg_dma_address(sgd);
 		dd->dst_len = todo;
 		dd->iv = 0;
 		dd->next = 1;
-
 		dd->user = RK2_LLI_CIPHER_START | RK2_LLI_STRING_FIRST | RK2_LLI_STRING_LAST;
-		dd->dma_ctrl |= RK2_LLI_DMA_CTRL_DST_INT | RK2_LLI_DMA_CTRL_LAST;
+		dd->dma_ctrl = RK2_LLI_DMA_CTRL_DST_INT | RK2_LLI_DMA_CTRL_LAST;
 
 		writel(RK2_CRYPTO_DMA_INT_LISTDONE | 0x7F, rkc->reg + RK2_CRYPTO_DMA_INT_EN);
-
-		/*writel(0x00030000, rkc->reg + RK2_CRYPTO_FIFO_CTL);*/
 		writel(rkc->t_phy, rkc->reg + RK2_CRYPTO_DMA_LLI_ADDR);
 
 		reinit_completion(&rkc->complete);
 		rkc->status = 0;
 
+		t = ktime_get_ns();
 		writel(RK2_CRYPTO_DMA_CTL_START | 1 << 16, rkc->reg + RK2_CRYPTO_DMA_CTL);
 
 		wait_for_completion_interruptible_timeout(&rkc->complete,
 							  msecs_to_jiffies(10000));
+		hw_ns += ktime_get_ns() - t;
+
 		if (sgs == sgd) {
 			dma_unmap_sg(rkc->dev, sgs, 1, DMA_BIDIRECTIONAL);
 		} else {
@@ -518,28 +782,109 @@ int rk2_cipher_run(struct crypto_engine *engine, void *async_req)
 			dev_err(rkc->dev, "DMA timeout\n");
 			rk2_print(rkc);
 			err = -EFAULT;
-			goto theend;
-		}
-		if (areq->iv && ivsize > 0) {
-			offset = sgd->length - ivsize;
-			if (rctx->mode & RK2_CRYPTO_DEC) {
-				memcpy(areq->iv, rctx->backup_iv, ivsize);
-				memzero_explicit(rctx->backup_iv, ivsize);
-			} else {
-				scatterwalk_map_and_copy(areq->iv, sgd, offset,
-							 ivsize, 0);
-			}
+			break;
 		}
-		sgs = sg_next(sgs);
-		sgd = sg_next(sgd);
+		if (areq->iv && ivsize > 0)
+			memcpy(areq->iv, rctx->backup_iv, ivsize);
+		len -= todo;
 	}
-theend:
+
+	rk2_crypto_stat(algt, crypto_tfm_alg_driver_name(areq->base.tfm),
+			areq->cryptlen, start - rctx->queued, hw_ns, err);
+
+	memzero_explicit(rctx->backup_iv, sizeof(rctx->backup_iv));
 	writel(0xffff0000, rkc->reg + RK2_CRYPTO_BC_CTL);
+
+	return err;
+}
+
+/*
+ * Run all the requests queued by rk2_cipher_run(). This is called by the
+ * engine once its queue is empty, or before another kind of request needs
+ * the hardware.
+ */
+void rk2_cipher_flush(struct rk2_crypto_dev *rkc)
+{
+	struct skcipher_request **reqs = rkc->batch;
+	struct rk2_cipher_rctx *rctx;
+	unsigned int i, n = rkc->nbatch;
+	int err;
+
+	if (!n)
+		return;
+	rctx = skcipher_request_ctx(reqs[0]);
+	rkc->nbatch = 0;
+	rkc->nbatch_lli = 0;
+
+	err = pm_runtime_resume_and_get(rkc->dev);
+	if (err) {
+		local_bh_disable();
+		for (i = 0; i < n; i++)
+			crypto_finalize_skcipher_request(rkc->engine, reqs[i], err);
+		local_bh_enable();
+		return;
+	}
+
+	if (rctx->mode & RK2_CRYPTO_DEC) {
+		for (i = 0; i < n; i++) {
+			err = rk2_cipher_run_segments(rkc, reqs[i]);
+			local_bh_disable();
+			crypto_finalize_skcipher_request(rkc->engine, reqs[i], err);
+			local_bh_enable();
+		}
+	} else {
+		err = rk2_cipher_run_list(rkc, reqs, n);
+		local_bh_disable();
+		for (i = 0; i < n; i++)
+			crypto_finalize_skcipher_request(rkc->engine, reqs[i], err);
+		local_bh_enable();
+	}
+
 	pm_runtime_put_autosuspend(rkc->dev);
+}
+
+static bool rk2_cipher_can_batch(struct rk2_crypto_dev *rkc,
+				 struct skcipher_request *areq)
+{
+	struct rk2_cipher_rctx *rctx = skcipher_request_ctx(areq);
+	struct skcipher_request *first = rkc->batch[0];
+	struct rk2_cipher_rctx *frctx = skcipher_request_ctx(first);
+
+	if (rkc->nbatch == RK2_CRYPTO_BATCH)
+		return false;
+	if (crypto_skcipher_reqtfm(first) != crypto_skcipher_reqtfm(areq))
+		return false;
+	if (frctx->mode != rctx->mode)
+		return false;
+	return rkc->nbatch_lli + rctx->nsrc + rctx->ndst - 1 <= MAX_LLI;
+}
+
+/*
+ * ECB requests are not run here but queued until the engine has no more
+ * requests for us or until one of them cannot be batched with the previous
+ * ones, so that consecutive requests for the same key share the key setup
+ * and a single descriptor list.
+ * The other modes chain the IV from one request to the next, so they gain
+ * nothing from waiting and are run at once.
+ */
+int rk2_cipher_run(struct crypto_engine *engine, void *async_req)
+{
+	struct skcipher_request *areq = container_of(async_req, struct skcipher_request, base);
+	struct rk2_cipher_rctx *rctx = skcipher_request_ctx(areq);
+	struct rk2_crypto_dev *rkc = rctx->dev;
+
+	rctx->nsrc = sg_nents_for_len(areq->src, areq->cryptlen);
+	rctx->ndst = sg_nents_for_len(areq->dst, areq->cryptlen);
+
+	if (rkc->nbatch && !rk2_cipher_can_batch(rkc, areq))
+		rk2_cipher_flush(rkc);
+
+	rkc->batch[rkc->nbatch++] = areq;
+	rkc->nbatch_lli += rctx->nsrc + rctx->ndst - 1;
+
+	if (crypto_skcipher_ivsize(crypto_skcipher_reqtfm(areq)))
+		rk2_cipher_flush(rkc);
 
-	local_bh_disable();
-	crypto_finalize_skcipher_request(engine, areq, err);
-	local_bh_enable();
 	return 0;
 }
 
@@ -0,0 +1,61 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Rockchip RK3568/RK3588 crypto offloader tracepoints
+ */
+
+#if !defined(_RK2_CRYPTO_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define _RK2_CRYPTO_TRACE_H_
+
+#include <linux/tracepoint.h>
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM rk2_crypto
+#define TRACE_INCLUDE_FILE rk2_crypto_trace
+
+TRACE_EVENT(rk2_crypto_done,
+	TP_PROTO(const char *alg, unsigned int len, u64 queue_ns, u64 hw_ns,
+		 int err),
+	TP_ARGS(alg, len, queue_ns, hw_ns, err),
+	TP_STRUCT__entry(
+		__string(alg, alg)
+		__field(unsigned int, len)
+		__field(u64, queue_ns)
+		__field(u64, hw_ns)
+		__field(int, err)
+		),
+
+	TP_fast_assign(
+		__assign_str(alg);
+		__entry->len = len;
+		__entry->queue_ns = queue_ns;
+		__entry->hw_ns = hw_ns;
+		__entry->err = err;
+		),
+
+	TP_printk("alg=%s len=%u queue_ns=%llu hw_ns=%llu err=%d",
+		  __get_str(alg), __entry->len, __entry->queue_ns,
+		  __entry->hw_ns, __entry->err)
+);
+
+TRACE_EVENT(rk2_crypto_fallback,
+	TP_PROTO(const char *alg, unsigned int len),
+	TP_ARGS(alg, len),
+	TP_STRUCT__entry(
+		__string(alg, alg)
+		__field(unsigned int, len)
+		),
+
+	TP_fast_assign(
+		__assign_str(alg);
+		__entry->len = len;
+		),
+
+	TP_printk("alg=%s len=%u", __get_str(alg), __entry->len)
+);
+
+#endif /* _RK2_CRYPTO_TRACE_H_ */
+
+/* This part must be outside protection */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH ../../drivers/crypto/rockchip
+#include <trace/define_trace.h>
@@ -21,7 +21,9 @@
 #include <linux/of_device.h>
 #include <linux/bitfield.h>
 #include <linux/bits.h>
+#include <linux/math64.h>
 #include <linux/perf_event.h>
+#include <linux/sizes.h>
 
 #include <soc/rockchip/rockchip_grf.h>
 #include <soc/rockchip/rk3399_grf.h>
@@ -63,7 +65,16 @@
 #define PERF_EVENT_READ_BYTES3		0x9
 #define PERF_EVENT_WRITE_BYTES3		0xa
 #define PERF_EVENT_BYTES		0xb
-#define PERF_ACCESS_TYPE_MAX		0xc
+#define PERF_EVENT_BURST_WINDOWS	0xc
+#define PERF_EVENT_BURST_BYTES		0xd
+#define PERF_ACCESS_TYPE_MAX		0xe
+
+/*
+ * The counters are only 32-bit wide, sampling them once a second is enough
+ * to not miss a wrap-around. Burst events need a much finer granularity.
+ */
+#define DFI_SAMPLE_PERIOD_NS		NSEC_PER_SEC
+#define DFI_BURST_SAMPLE_PERIOD_NS	(10 * NSEC_PER_MSEC)
 
 /**
  * struct dmc_count_channel - structure to hold counter values from the DDR controller
@@ -79,8 +90,17 @@ struct dmc_count_channel {
 	u64 write_access;
 };
 
+/**
+ * struct dmc_count - structure to hold counter values for all channels
+ * @c:             Per-channel counters
+ * @burst_windows: Number of sampling windows where the DDR bandwidth was
+ *                 above the burst threshold
+ * @burst_bytes:   Number of bytes transferred during those windows
+ */
 struct dmc_count {
 	struct dmc_count_channel c[DMC_MAX_CHANNELS];
+	u64 burst_windows;
+	u64 burst_bytes;
 };
 
 /*
@@ -110,12 +130,17 @@ struct rockchip_dfi {
 	struct hlist_node node;
 	struct pmu pmu;
 	struct hrtimer timer;
+	ktime_t timer_period;
+	ktime_t last_sample_time;
 	unsigned int cpu;
 	int active_events;
+	int burst_events;
+	u64 burst_threshold;
 	int burst_len;
 	int buswidth[DMC_MAX_CHANNELS];
 	int ddrmon_stride;
 	bool ddrmon_ctrl_single;
+	const char *pmu_identifier;
 };
 
 static int rockchip_dfi_enable(struct rockchip_dfi *dfi)
@@ -307,6 +332,10 @@ static void rockchip_ddr_perf_counters_add(struct rockchip_dfi *dfi,
 		res->c[i].clock_cycles = dfi->total_count.c[i].clock_cycles +
 			(u32)(now->c[i].clock_cycles - last->c[i].clock_cycles);
 	}
+
+	/* Burst counters are only updated by the sampling timer. */
+	res->burst_windows = dfi->total_count.burst_windows;
+	res->burst_bytes = dfi->total_count.burst_bytes;
 }
 
 static ssize_t ddr_perf_cpumask_show(struct device *dev,
@@ -330,6 +359,28 @@ static const struct attribute_group ddr_perf_cpumask_attr_group = {
 	.attrs = ddr_perf_cpumask_attrs,
 };
 
+/* Matched against the "Compat" field of the perf JSON events and metrics */
+static ssize_t ddr_perf_identifier_show(struct device *dev,
+					struct device_attribute *attr, char *buf)
+{
+	struct pmu *pmu = dev_get_drvdata(dev);
+	struct rockchip_dfi *dfi = container_of(pmu, struct rockchip_dfi, pmu);
+
+	return sysfs_emit(buf, "%s\n", dfi->pmu_identifier);
+}
+
+static struct device_attribute ddr_perf_identifier_attr =
+	__ATTR(identifier, 0444, ddr_perf_identifier_show, NULL);
+
+static struct attribute *ddr_perf_identifier_attrs[] = {
+	&ddr_perf_identifier_attr.attr,
+	NULL,
+};
+
+static const struct attribute_group ddr_perf_identifier_attr_group = {
+	.attrs = ddr_perf_identifier_attrs,
+};
+
 PMU_EVENT_ATTR_STRING(cycles, ddr_pmu_cycles, "event="__stringify(PERF_EVENT_CYCLES))
 
 #define DFI_PMU_EVENT_ATTR(_name, _var, _str) \
@@ -354,6 +405,11 @@ DFI_PMU_EVENT_ATTR(write-bytes, ddr_pmu_write_bytes, "event="__stringify(PERF_EV
 
 DFI_PMU_EVENT_ATTR(bytes, ddr_pmu_bytes, "event="__stringify(PERF_EVENT_BYTES));
 
+PMU_EVENT_ATTR_STRING(burst-windows, ddr_pmu_burst_windows,
+		      "event="__stringify(PERF_EVENT_BURST_WINDOWS)",threshold=?")
+DFI_PMU_EVENT_ATTR(burst-bytes, ddr_pmu_burst_bytes,
+		   "event="__stringify(PERF_EVENT_BURST_BYTES)",threshold=?");
+
 #define DFI_ATTR_MB(_name) 		\
 	&_name.attr.attr,		\
 	&_name##_unit.attr.attr,	\
@@ -372,6 +428,8 @@ static struct attribute *ddr_perf_events_attrs[] = {
 	DFI_ATTR_MB(ddr_pmu_read_bytes3),
 	DFI_ATTR_MB(ddr_pmu_write_bytes3),
 	DFI_ATTR_MB(ddr_pmu_bytes),
+	&ddr_pmu_burst_windows.attr.attr,
+	DFI_ATTR_MB(ddr_pmu_burst_bytes),
 	NULL,
 };
 
@@ -381,9 +439,12 @@ static const struct attribute_group ddr_perf_events_attr_group = {
 };
 
 PMU_FORMAT_ATTR(event, "config:0-7");
+/* Burst threshold, in MB/s */
+PMU_FORMAT_ATTR(threshold, "config1:0-31");
 
 static struct attribute *ddr_perf_format_attrs[] = {
 	&format_attr_event.attr,
+	&format_attr_threshold.attr,
 	NULL,
 };
 
@@ -395,10 +456,17 @@ static const struct attribute_group ddr_perf_format_attr_group = {
 static const struct attribute_group *attr_groups[] = {
 	&ddr_perf_events_attr_group,
 	&ddr_perf_cpumask_attr_group,
+	&ddr_perf_identifier_attr_group,
 	&ddr_perf_format_attr_group,
 	NULL,
 };
 
+static bool rockchip_ddr_perf_event_is_burst(struct perf_event *event)
+{
+	return event->attr.config == PERF_EVENT_BURST_WINDOWS ||
+	       event->attr.config == PERF_EVENT_BURST_BYTES;
+}
+
 static int rockchip_ddr_perf_event_init(struct perf_event *event)
 {
 	struct rockchip_dfi *dfi = container_of(event->pmu, struct rockchip_dfi, pmu);
@@ -414,6 +482,11 @@ static int rockchip_ddr_perf_event_init(struct perf_event *event)
 		return -EINVAL;
 	}
 
+	if (rockchip_ddr_perf_event_is_burst(event) && !event->attr.config1) {
+		dev_dbg(dfi->dev, "Burst events need a threshold\n");
+		return -EINVAL;
+	}
+
 	return 0;
 }
 
@@ -473,6 +546,12 @@ static u64 rockchip_ddr_perf_event_get_count(struct perf_event *event)
 		for (i = 0; i < dfi->max_channels; i++)
 			count += total.c[i].access * blen * dfi->buswidth[i];
 		break;
+	case PERF_EVENT_BURST_WINDOWS:
+		count = total.burst_windows;
+		break;
+	case PERF_EVENT_BURST_BYTES:
+		count = total.burst_bytes;
+		break;
 	}
 
 	return count;
@@ -502,12 +581,32 @@ static int rockchip_ddr_perf_event_add(struct perf_event *event, int flags)
 {
 	struct rockchip_dfi *dfi = container_of(event->pmu, struct rockchip_dfi, pmu);
 
+	if (rockchip_ddr_perf_event_is_burst(event)) {
+		/* Thresholds are in MB/s, and we sample at most one at a time. */
+		u64 threshold = event->attr.config1 * SZ_1M;
+
+		if (dfi->burst_events && threshold != dfi->burst_threshold)
+			return -EBUSY;
+
+		dfi->burst_threshold = threshold;
+		dfi->burst_events++;
+	}
+
 	dfi->active_events++;
 
 	if (dfi->active_events == 1) {
 		dfi->total_count = (struct dmc_count){};
 		rockchip_dfi_read_counters(dfi, &dfi->last_perf_count);
-		hrtimer_start(&dfi->timer, ns_to_ktime(NSEC_PER_SEC), HRTIMER_MODE_REL);
+		dfi->last_sample_time = ktime_get();
+	}
+
+	/* (Re)start the timer if the sampling period changed. */
+	if (dfi->active_events == 1 ||
+	    (rockchip_ddr_perf_event_is_burst(event) && dfi->burst_events == 1)) {
+		dfi->timer_period = ns_to_ktime(dfi->burst_events ?
+						DFI_BURST_SAMPLE_PERIOD_NS :
+						DFI_SAMPLE_PERIOD_NS);
+		hrtimer_start(&dfi->timer, dfi->timer_period, HRTIMER_MODE_REL);
 	}
 
 	if (flags & PERF_EF_START)
@@ -527,12 +626,44 @@ static void rockchip_ddr_perf_event_del(struct perf_event *event, int flags)
 
 	rockchip_ddr_perf_event_stop(event, PERF_EF_UPDATE);
 
+	if (rockchip_ddr_perf_event_is_burst(event)) {
+		dfi->burst_events--;
+		if (!dfi->burst_events)
+			dfi->timer_period = ns_to_ktime(DFI_SAMPLE_PERIOD_NS);
+	}
+
 	dfi->active_events--;
 
 	if (dfi->active_events == 0)
 		hrtimer_cancel(&dfi->timer);
 }
 
+static void rockchip_dfi_update_burst(struct rockchip_dfi *dfi,
+				      const struct dmc_count *now,
+				      struct dmc_count *total)
+{
+	const struct dmc_count *last = &dfi->last_perf_count;
+	ktime_t sample_time = ktime_get();
+	u64 bytes = 0, window_ns;
+	int i;
+
+	window_ns = ktime_to_ns(ktime_sub(sample_time, dfi->last_sample_time));
+	dfi->last_sample_time = sample_time;
+
+	if (!dfi->burst_events || !window_ns)
+		return;
+
+	for (i = 0; i < dfi->max_channels; i++)
+		bytes += (u64)(u32)(now->c[i].access - last->c[i].access) *
+			 dfi->burst_len * dfi->buswidth[i];
+
+	/* bytes / window >= threshold, in bytes per second */
+	if (mul_u64_u64_div_u64(bytes, NSEC_PER_SEC, window_ns) >= dfi->burst_threshold) {
+		total->burst_windows++;
+		total->burst_bytes += bytes;
+	}
+}
+
 static enum hrtimer_restart rockchip_dfi_timer(struct hrtimer *timer)
 {
 	struct rockchip_dfi *dfi = container_of(timer, struct rockchip_dfi, timer);
@@ -543,12 +674,13 @@ static enum hrtimer_restart rockchip_dfi_timer(struct hrtimer *timer)
 	write_seqlock(&dfi->count_seqlock);
 
 	rockchip_ddr_perf_counters_add(dfi, &now, &total);
+	rockchip_dfi_update_burst(dfi, &now, &total);
 	dfi->total_count = total;
 	dfi->last_perf_count = now;
 
 	write_sequnlock(&dfi->count_seqlock);
 
-	hrtimer_forward_now(&dfi->timer, ns_to_ktime(NSEC_PER_SEC));
+	hrtimer_forward_now(&dfi->timer, dfi->timer_period);
 
 	return HRTIMER_RESTART;
 };
@@ -690,6 +822,7 @@ static int rk3399_dfi_init(struct rockchip_dfi *dfi)
 
 	dfi->ddrmon_stride = 0x14;
 	dfi->ddrmon_ctrl_single = true;
+	dfi->pmu_identifier = "rk3399";
 
 	return 0;
 };
@@ -719,6 +852,7 @@ static int rk3568_dfi_init(struct rockchip_dfi *dfi)
 
 	dfi->ddrmon_stride = 0x0; /* not relevant, we only have a single channel on this SoC */
 	dfi->ddrmon_ctrl_single = true;
+	dfi->pmu_identifier = "rk3568";
 
 	return 0;
 };
@@ -751,6 +885,7 @@ static int rk3588_dfi_init(struct rockchip_dfi *dfi)
 	dfi->max_channels = 4;
 
 	dfi->ddrmon_stride = 0x4000;
+	dfi->pmu_identifier = "rk3588";
 
 	return 0;
 };
@@ -0,0 +1,407 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * RK3588 DMC (Dynamic Memory Controller) frequency scaling.
+ *
+ * The DDR frequency change sequence runs in TF-A: the driver picks an OPP
+ * based on the DFI load counters, and hands the rate over to the firmware
+ * through the DDR clock.
+ */
+
+#include <linux/arm-smccc.h>
+#include <linux/clk.h>
+#include <linux/devfreq.h>
+#include <linux/devfreq-event.h>
+#include <linux/interconnect-provider.h>
+#include <linux/module.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+#include <linux/pm_opp.h>
+#include <linux/pm_qos.h>
+
+#include <dt-bindings/interconnect/rockchip,rk3588.h>
+
+#include <soc/rockchip/rockchip_sip.h>
+
+/*
+ * The RK3588 DMC has 4 16-bit channels, and transfers data on both edges of
+ * the DDR clock.
+ */
+#define RK3588_DMC_BUS_WIDTH_BYTES	8
+#define RK3588_DMC_BYTES_PER_CYCLE	(RK3588_DMC_BUS_WIDTH_BYTES * 2)
+
+/*
+ * Bandwidth requests are turned into a minimum DDR frequency assuming the
+ * DMC reaches this efficiency. Refresh, bank conflicts and read/write
+ * turnarounds make 100% unreachable.
+ */
+#define RK3588_DMC_BW_EFFICIENCY	70
+
+#define RK3588_DMC_ICC_NUM_NODES	2
+
+struct rk3588_dmcfreq {
+	struct device *dev;
+	struct devfreq *devfreq;
+	struct devfreq_dev_profile profile;
+	struct devfreq_simple_ondemand_data ondemand_data;
+	struct clk *dmc_clk;
+	struct devfreq_event_dev *edev;
+	struct mutex lock;
+	unsigned long rate;
+
+	struct icc_provider provider;
+	struct icc_onecell_data *icc_data;
+	struct dev_pm_qos_request icc_qos_req;
+};
+
+static int rk3588_dmcfreq_target(struct device *dev, unsigned long *freq,
+				 u32 flags)
+{
+	struct rk3588_dmcfreq *dmcfreq = dev_get_drvdata(dev);
+	unsigned long target_rate;
+	struct dev_pm_opp *opp;
+	int err;
+
+	opp = devfreq_recommended_opp(dev, freq, flags);
+	if (IS_ERR(opp))
+		return PTR_ERR(opp);
+
+	target_rate = dev_pm_opp_get_freq(opp);
+	dev_pm_opp_put(opp);
+
+	if (dmcfreq->rate == target_rate)
+		return 0;
+
+	mutex_lock(&dmcfreq->lock);
+
+	/*
+	 * The DDR clock is owned by TF-A, which takes care of the DDR rail
+	 * voltage and of the PHY retraining as part of the rate change.
+	 */
+	err = clk_set_rate(dmcfreq->dmc_clk, target_rate);
+	if (err) {
+		dev_err(dev, "Cannot set frequency %lu (%d)\n", target_rate,
+			err);
+		goto out_unlock;
+	}
+
+	dmcfreq->rate = clk_get_rate(dmcfreq->dmc_clk);
+	if (dmcfreq->rate != target_rate) {
+		dev_err(dev, "Got wrong frequency, Request %lu, Current %lu\n",
+			target_rate, dmcfreq->rate);
+		err = -EIO;
+	}
+
+out_unlock:
+	mutex_unlock(&dmcfreq->lock);
+	return err;
+}
+
+static int rk3588_dmcfreq_get_dev_status(struct device *dev,
+					 struct devfreq_dev_status *stat)
+{
+	struct rk3588_dmcfreq *dmcfreq = dev_get_drvdata(dev);
+	struct devfreq_event_data edata;
+	int ret;
+
+	ret = devfreq_event_get_event(dmcfreq->edev, &edata);
+	if (ret < 0)
+		return ret;
+
+	stat->current_frequency = dmcfreq->rate;
+	stat->busy_time = edata.load_count;
+	stat->total_time = edata.total_count;
+
+	return 0;
+}
+
+static int rk3588_dmcfreq_get_cur_freq(struct device *dev, unsigned long *freq)
+{
+	struct rk3588_dmcfreq *dmcfreq = dev_get_drvdata(dev);
+
+	*freq = dmcfreq->rate;
+
+	return 0;
+}
+
+static int rk3588_dmc_icc_set(struct icc_node *src, struct icc_node *dst)
+{
+	struct rk3588_dmcfreq *dmcfreq = dst->data;
+	u64 freq_khz;
+
+	if (dst->id != RK3588_ICC_DMC_DDR)
+		return 0;
+
+	/* Bandwidth values are in kBps, PM QoS frequencies in kHz. */
+	freq_khz = (u64)max(dst->avg_bw, dst->peak_bw) * 100;
+	do_div(freq_khz, RK3588_DMC_BYTES_PER_CYCLE * RK3588_DMC_BW_EFFICIENCY);
+
+	dev_dbg(dmcfreq->dev, "avg_bw %ukBps peak_bw %ukBps min_freq %llukHz\n",
+		dst->avg_bw, dst->peak_bw, freq_khz);
+
+	return dev_pm_qos_update_request(&dmcfreq->icc_qos_req,
+					 min_t(u64, freq_khz, S32_MAX));
+}
+
+/*
+ * The initial bandwidth is unknown, report none rather than letting the
+ * framework pin the DDR to its maximum frequency until sync_state.
+ */
+static int rk3588_dmc_icc_get_bw(struct icc_node *node, u32 *avg, u32 *peak)
+{
+	*avg = 0;
+	*peak = 0;
+
+	return 0;
+}
+
+static void rk3588_dmc_icc_remove(struct rk3588_dmcfreq *dmcfreq)
+{
+	icc_provider_deregister(&dmcfreq->provider);
+	icc_nodes_remove(&dmcfreq->provider);
+	dev_pm_qos_remove_request(&dmcfreq->icc_qos_req);
+}
+
+/*
+ * Expose the DDR as an interconnect, so bandwidth-sensitive devices (display
+ * controller, video decoders, ...) can request a bandwidth floor, which
+ * translates to a minimum DDR frequency the governor can't go below.
+ */
+static int rk3588_dmc_icc_register(struct rk3588_dmcfreq *dmcfreq)
+{
+	static const char * const node_names[] = {
+		[RK3588_ICC_DMC_MASTER] = "dmc-master",
+		[RK3588_ICC_DMC_DDR] = "ddr",
+	};
+	struct icc_provider *provider = &dmcfreq->provider;
+	struct device *dev = dmcfreq->dev;
+	struct icc_node *node;
+	int i, ret;
+
+	if (!IS_ENABLED(CONFIG_INTERCONNECT))
+		return 0;
+
+	dmcfreq->icc_data = devm_kzalloc(dev,
+					 struct_size(dmcfreq->icc_data, nodes,
+						     RK3588_DMC_ICC_NUM_NODES),
+					 GFP_KERNEL);
+	if (!dmcfreq->icc_data)
+		return -ENOMEM;
+
+	dmcfreq->icc_data->num_nodes = RK3588_DMC_ICC_NUM_NODES;
+
+	ret = dev_pm_qos_add_request(dev, &dmcfreq->icc_qos_req,
+				     DEV_PM_QOS_MIN_FREQUENCY, 0);
+	if (ret < 0)
+		return ret;
+
+	provider->dev = dev;
+	provider->set = rk3588_dmc_icc_set;
+	provider->aggregate = icc_std_aggregate;
+	provider->get_bw = rk3588_dmc_icc_get_bw;
+	provider->xlate = of_icc_xlate_onecell;
+	provider->data = dmcfreq->icc_data;
+	icc_provider_init(provider);
+
+	for (i = 0; i < RK3588_DMC_ICC_NUM_NODES; i++) {
+		node = icc_node_create(i);
+		if (IS_ERR(node)) {
+			ret = PTR_ERR(node);
+			goto err_remove_nodes;
+		}
+
+		node->name = node_names[i];
+		node->data = dmcfreq;
+		icc_node_add(node, provider);
+		dmcfreq->icc_data->nodes[i] = node;
+	}
+
+	ret = icc_link_create(dmcfreq->icc_data->nodes[RK3588_ICC_DMC_MASTER],
+			      RK3588_ICC_DMC_DDR);
+	if (ret)
+		goto err_remove_nodes;
+
+	ret = icc_provider_register(provider);
+	if (ret)
+		goto err_remove_nodes;
+
+	return 0;
+
+err_remove_nodes:
+	icc_nodes_remove(provider);
+	dev_pm_qos_remove_request(&dmcfreq->icc_qos_req);
+	return ret;
+}
+
+static __maybe_unused int rk3588_dmcfreq_suspend(struct device *dev)
+{
+	struct rk3588_dmcfreq *dmcfreq = dev_get_drvdata(dev);
+	int ret;
+
+	ret = devfreq_event_disable_edev(dmcfreq->edev);
+	if (ret < 0) {
+		dev_err(dev, "failed to disable the devfreq-event devices\n");
+		return ret;
+	}
+
+	ret = devfreq_suspend_device(dmcfreq->devfreq);
+	if (ret < 0) {
+		dev_err(dev, "failed to suspend the devfreq devices\n");
+		return ret;
+	}
+
+	return 0;
+}
+
+static __maybe_unused int rk3588_dmcfreq_resume(struct device *dev)
+{
+	struct rk3588_dmcfreq *dmcfreq = dev_get_drvdata(dev);
+	int ret;
+
+	ret = devfreq_event_enable_edev(dmcfreq->edev);
+	if (ret < 0) {
+		dev_err(dev, "failed to enable the devfreq-event devices\n");
+		return ret;
+	}
+
+	ret = devfreq_resume_device(dmcfreq->devfreq);
+	if (ret < 0) {
+		dev_err(dev, "failed to resume the devfreq devices\n");
+		return ret;
+	}
+
+	return 0;
+}
+
+static SIMPLE_DEV_PM_OPS(rk3588_dmcfreq_pm, rk3588_dmcfreq_suspend,
+			 rk3588_dmcfreq_resume);
+
+static int rk3588_dmcfreq_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct rk3588_dmcfreq *data;
+	struct arm_smccc_res res;
+	struct dev_pm_opp *opp;
+	int ret;
+
+	data = devm_kzalloc(dev, sizeof(*data), GFP_KERNEL);
+	if (!data)
+		return -ENOMEM;
+
+	mutex_init(&data->lock);
+	data->dev = dev;
+
+	data->dmc_clk = devm_clk_get(dev, "dmc_clk");
+	if (IS_ERR(data->dmc_clk))
+		return dev_err_probe(dev, PTR_ERR(data->dmc_clk),
+				     "Cannot get the clk dmc_clk\n");
+
+	/* Older TF-A releases don't implement DDR DVFS, don't go further. */
+	arm_smccc_smc(ROCKCHIP_SIP_DRAM_FREQ, 0, 0,
+		      ROCKCHIP_SIP_CONFIG_DRAM_INIT,
+		      0, 0, 0, 0, &res);
+	if (res.a0) {
+		dev_info(dev, "DDR frequency scaling not supported by the firmware (%lu)\n",
+			 res.a0);
+		return -ENODEV;
+	}
+
+	data->edev = devfreq_event_get_edev_by_phandle(dev, "devfreq-events", 0);
+	if (IS_ERR(data->edev))
+		return -EPROBE_DEFER;
+
+	ret = devfreq_event_enable_edev(data->edev);
+	if (ret < 0) {
+		dev_err(dev, "failed to enable devfreq-event devices\n");
+		return ret;
+	}
+
+	if (devm_pm_opp_of_add_table(dev)) {
+		dev_err(dev, "Invalid operating-points in device tree.\n");
+		ret = -EINVAL;
+		goto err_edev;
+	}
+
+	/*
+	 * LPDDR4X/5 need a lot of headroom: we'd rather go up early than
+	 * starving the display controller while waiting for the next
+	 * evaluation.
+	 */
+	data->ondemand_data.upthreshold = 25;
+	data->ondemand_data.downdifferential = 15;
+
+	data->rate = clk_get_rate(data->dmc_clk);
+
+	opp = devfreq_recommended_opp(dev, &data->rate, 0);
+	if (IS_ERR(opp)) {
+		ret = PTR_ERR(opp);
+		goto err_edev;
+	}
+
+	data->rate = dev_pm_opp_get_freq(opp);
+	dev_pm_opp_put(opp);
+
+	data->profile = (struct devfreq_dev_profile) {
+		.polling_ms	= 50,
+		.target		= rk3588_dmcfreq_target,
+		.get_dev_status	= rk3588_dmcfreq_get_dev_status,
+		.get_cur_freq	= rk3588_dmcfreq_get_cur_freq,
+		.initial_freq	= data->rate,
+	};
+
+	platform_set_drvdata(pdev, data);
+
+	data->devfreq = devm_devfreq_add_device(dev,
+						&data->profile,
+						DEVFREQ_GOV_SIMPLE_ONDEMAND,
+						&data->ondemand_data);
+	if (IS_ERR(data->devfreq)) {
+		ret = PTR_ERR(data->devfreq);
+		goto err_edev;
+	}
+
+	devm_devfreq_register_opp_notifier(dev, data->devfreq);
+
+	ret = rk3588_dmc_icc_register(data);
+	if (ret) {
+		dev_err(dev, "failed to register the interconnect provider\n");
+		goto err_edev;
+	}
+
+	return 0;
+
+err_edev:
+	devfreq_event_disable_edev(data->edev);
+
+	return ret;
+}
+
+static void rk3588_dmcfreq_remove(struct platform_device *pdev)
+{
+	struct rk3588_dmcfreq *dmcfreq = dev_get_drvdata(&pdev->dev);
+
+	if (dmcfreq->icc_data)
+		rk3588_dmc_icc_remove(dmcfreq);
+
+	devfreq_event_disable_edev(dmcfreq->edev);
+}
+
+static const struct of_device_id rk3588dmc_devfreq_of_match[] = {
+	{ .compatible = "rockchip,rk3588-dmc" },
+	{ },
+};
+MODULE_DEVICE_TABLE(of, rk3588dmc_devfreq_of_match);
+
+static struct platform_driver rk3588_dmcfreq_driver = {
+	.probe	= rk3588_dmcfreq_probe,
+	.remove = rk3588_dmcfreq_remove,
+	.driver = {
+		.name	= "rk3588-dmc-freq",
+		.pm	= &rk3588_dmcfreq_pm,
+		.of_match_table = rk3588dmc_devfreq_of_match,
+		.sync_state = icc_sync_state,
+	},
+};
+module_platform_driver(rk3588_dmcfreq_driver);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("RK3588 dmcfreq driver with devfreq framework");
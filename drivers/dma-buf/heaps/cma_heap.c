@@ -44,6 +44,7 @@ struct dma_heap_attachment {
 	struct device *dev;
 	struct sg_table table;
 	struct list_head list;
+	enum dma_data_direction dir;
 	bool mapped;
 };
 
@@ -90,6 +91,10 @@ static void cma_heap_detach(struct dma_buf *dmabuf,
 	list_del(&a->list);
 	mutex_unlock(&buffer->lock);
 
+	/* the last unmap already handed the buffer back to the CPU */
+	if (a->mapped)
+		dma_unmap_sgtable(attachment->dev, &a->table, a->dir,
+				  DMA_ATTR_SKIP_CPU_SYNC);
 	sg_free_table(&a->table);
 	kfree(a);
 }
@@ -101,9 +106,26 @@ static struct sg_table *cma_heap_map_dma_buf(struct dma_buf_attachment *attachme
 	struct sg_table *table = &a->table;
 	int ret;
 
+	/*
+	 * The mapping is kept until detach, so that importers mapping the buffer
+	 * around each use don't pay for the IOMMU setup every time. A later map
+	 * in the same direction only does the cache maintenance, a map in
+	 * another direction replaces the mapping.
+	 */
+	if (a->mapped && a->dir == direction) {
+		dma_sync_sgtable_for_device(attachment->dev, table, direction);
+		return table;
+	}
+
+	if (a->mapped) {
+		a->mapped = false;
+		dma_unmap_sgtable(attachment->dev, table, a->dir, 0);
+	}
+
 	ret = dma_map_sgtable(attachment->dev, table, direction, 0);
 	if (ret)
 		return ERR_PTR(-ENOMEM);
+	a->dir = direction;
 	a->mapped = true;
 	return table;
 }
@@ -112,10 +134,8 @@ static void cma_heap_unmap_dma_buf(struct dma_buf_attachment *attachment,
 				   struct sg_table *table,
 				   enum dma_data_direction direction)
 {
-	struct dma_heap_attachment *a = attachment->priv;
-
-	a->mapped = false;
-	dma_unmap_sgtable(attachment->dev, table, direction, 0);
+	/* the mapping stays until detach, only hand the buffer to the CPU */
+	dma_sync_sgtable_for_cpu(attachment->dev, table, direction);
 }
 
 static int cma_heap_dma_buf_begin_cpu_access(struct dma_buf *dmabuf,
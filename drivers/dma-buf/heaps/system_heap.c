@@ -18,10 +18,14 @@
 #include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/scatterlist.h>
+#include <linux/shrinker.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/vmalloc.h>
+#include <linux/workqueue.h>
 
 static struct dma_heap *sys_heap;
+static struct dma_heap *sys_uncached_heap;
 
 struct system_heap_buffer {
 	struct dma_heap *heap;
@@ -31,12 +35,14 @@ struct system_heap_buffer {
 	struct sg_table sg_table;
 	int vmap_cnt;
 	void *vaddr;
+	bool uncached;
 };
 
 struct dma_heap_attachment {
 	struct device *dev;
 	struct sg_table *table;
 	struct list_head list;
+	enum dma_data_direction dir;
 	bool mapped;
 };
 
@@ -54,6 +60,166 @@ static gfp_t order_flags[] = {HIGH_ORDER_GFP, HIGH_ORDER_GFP, LOW_ORDER_GFP};
 static const unsigned int orders[] = {8, 4, 0};
 #define NUM_ORDERS ARRAY_SIZE(orders)
 
+/*
+ * Pages of released buffers are kept in per-order pools and handed out
+ * again to later allocations, which avoids going back to the buddy
+ * allocator for every page of a new buffer. Released pages are first put
+ * on the dirty list and zeroed by a worker before they move to the clean
+ * list, so that allocations usually do not need to clear them either.
+ * A shrinker gives the pooled pages back under memory pressure.
+ *
+ * Cached and uncached buffers have separate pools. Uncached buffers are
+ * mapped non-cacheable while the linear map keeps a cacheable alias of their
+ * pages, so a page only moves between buffers using the same attributes and
+ * the cache maintenance done when allocating an uncached buffer stays enough.
+ */
+struct system_heap_pool {
+	spinlock_t lock;
+	struct list_head clean;
+	struct list_head dirty;
+};
+
+/* Indexed by whether the buffers are uncached, then by order */
+static struct system_heap_pool pools[2][NUM_ORDERS];
+/* Number of PAGE_SIZE pages held by all pools */
+static atomic_long_t pool_pages;
+static struct shrinker *pool_shrinker;
+
+static unsigned int pool_size_mb = 64;
+module_param(pool_size_mb, uint, 0444);
+MODULE_PARM_DESC(pool_size_mb, "Maximum size of the page pool in MiB, 0 disables the pool");
+
+static void system_heap_pool_zero_fn(struct work_struct *work);
+static DECLARE_WORK(pool_zero_work, system_heap_pool_zero_fn);
+
+static int order_to_index(unsigned int order)
+{
+	int i;
+
+	for (i = 0; i < NUM_ORDERS; i++)
+		if (orders[i] == order)
+			return i;
+	return -1;
+}
+
+static void system_heap_zero_page(struct page *page)
+{
+	unsigned int i, nr = 1 << compound_order(page);
+
+	for (i = 0; i < nr; i++)
+		clear_highpage(page + i);
+}
+
+static struct page *system_heap_pool_remove(bool uncached, int index,
+					    bool *dirty)
+{
+	struct system_heap_pool *pool = &pools[uncached][index];
+	struct page *page;
+
+	spin_lock(&pool->lock);
+	page = list_first_entry_or_null(&pool->clean, struct page, lru);
+	*dirty = !page;
+	if (!page)
+		page = list_first_entry_or_null(&pool->dirty, struct page, lru);
+	if (page)
+		list_del(&page->lru);
+	spin_unlock(&pool->lock);
+
+	if (page)
+		atomic_long_sub(1 << orders[index], &pool_pages);
+
+	return page;
+}
+
+static struct page *system_heap_pool_get(bool uncached, int index)
+{
+	struct page *page;
+	bool dirty;
+
+	page = system_heap_pool_remove(uncached, index, &dirty);
+	/* The zeroing worker has not got to this page yet */
+	if (page && dirty)
+		system_heap_zero_page(page);
+
+	return page;
+}
+
+static bool system_heap_pool_put(struct page *page, bool uncached)
+{
+	unsigned int order = compound_order(page);
+	unsigned long max_pages = (unsigned long)pool_size_mb << (20 - PAGE_SHIFT);
+	int index = order_to_index(order);
+	struct system_heap_pool *pool;
+
+	if (index < 0 ||
+	    atomic_long_read(&pool_pages) + (1 << order) > max_pages)
+		return false;
+
+	pool = &pools[uncached][index];
+	spin_lock(&pool->lock);
+	list_add_tail(&page->lru, &pool->dirty);
+	spin_unlock(&pool->lock);
+	atomic_long_add(1 << order, &pool_pages);
+
+	return true;
+}
+
+static void system_heap_pool_zero_fn(struct work_struct *work)
+{
+	struct system_heap_pool *pool;
+	struct page *page;
+	int i;
+
+	for (i = 0; i < 2 * NUM_ORDERS; i++) {
+		pool = &pools[i / NUM_ORDERS][i % NUM_ORDERS];
+
+		spin_lock(&pool->lock);
+		while ((page = list_first_entry_or_null(&pool->dirty,
+							struct page, lru))) {
+			list_del(&page->lru);
+			spin_unlock(&pool->lock);
+
+			system_heap_zero_page(page);
+			cond_resched();
+
+			spin_lock(&pool->lock);
+			list_add_tail(&page->lru, &pool->clean);
+		}
+		spin_unlock(&pool->lock);
+	}
+}
+
+static unsigned long system_heap_pool_count(struct shrinker *shrinker,
+					    struct shrink_control *sc)
+{
+	return atomic_long_read(&pool_pages) ? : SHRINK_EMPTY;
+}
+
+static unsigned long system_heap_pool_scan(struct shrinker *shrinker,
+					   struct shrink_control *sc)
+{
+	unsigned long freed = 0;
+	struct page *page;
+	bool dirty;
+	int i, uncached;
+
+	/* Free the smallest pages first, high orders are the costly ones */
+	for (i = NUM_ORDERS - 1; i >= 0 && freed < sc->nr_to_scan; i--) {
+		for (uncached = 0; uncached < 2; uncached++) {
+			while (freed < sc->nr_to_scan) {
+				page = system_heap_pool_remove(uncached, i,
+							       &dirty);
+				if (!page)
+					break;
+				freed += 1 << orders[i];
+				__free_pages(page, orders[i]);
+			}
+		}
+	}
+
+	return freed ? : SHRINK_STOP;
+}
+
 static struct sg_table *dup_sg_table(struct sg_table *table)
 {
 	struct sg_table *new_table;
@@ -120,6 +286,10 @@ static void system_heap_detach(struct dma_buf *dmabuf,
 	list_del(&a->list);
 	mutex_unlock(&buffer->lock);
 
+	/* the last unmap already handed the buffer back to the CPU */
+	if (a->mapped)
+		dma_unmap_sgtable(attachment->dev, a->table, a->dir,
+				  DMA_ATTR_SKIP_CPU_SYNC);
 	sg_free_table(a->table);
 	kfree(a->table);
 	kfree(a);
@@ -128,14 +298,35 @@ static void system_heap_detach(struct dma_buf *dmabuf,
 static struct sg_table *system_heap_map_dma_buf(struct dma_buf_attachment *attachment,
 						enum dma_data_direction direction)
 {
+	struct system_heap_buffer *buffer = attachment->dmabuf->priv;
 	struct dma_heap_attachment *a = attachment->priv;
 	struct sg_table *table = a->table;
+	unsigned long attrs = buffer->uncached ? DMA_ATTR_SKIP_CPU_SYNC : 0;
 	int ret;
 
-	ret = dma_map_sgtable(attachment->dev, table, direction, 0);
+	/*
+	 * The mapping is kept until detach, so that importers mapping the buffer
+	 * around each use don't pay for the IOMMU setup every time. A later map
+	 * in the same direction only does the cache maintenance, a map in
+	 * another direction replaces the mapping.
+	 */
+	if (a->mapped && a->dir == direction) {
+		if (!buffer->uncached)
+			dma_sync_sgtable_for_device(attachment->dev, table,
+						    direction);
+		return table;
+	}
+
+	if (a->mapped) {
+		a->mapped = false;
+		dma_unmap_sgtable(attachment->dev, table, a->dir, attrs);
+	}
+
+	ret = dma_map_sgtable(attachment->dev, table, direction, attrs);
 	if (ret)
 		return ERR_PTR(ret);
 
+	a->dir = direction;
 	a->mapped = true;
 	return table;
 }
@@ -144,10 +335,11 @@ static void system_heap_unmap_dma_buf(struct dma_buf_attachment *attachment,
 				      struct sg_table *table,
 				      enum dma_data_direction direction)
 {
-	struct dma_heap_attachment *a = attachment->priv;
+	struct system_heap_buffer *buffer = attachment->dmabuf->priv;
 
-	a->mapped = false;
-	dma_unmap_sgtable(attachment->dev, table, direction, 0);
+	/* the mapping stays until detach, only hand the buffer to the CPU */
+	if (!buffer->uncached)
+		dma_sync_sgtable_for_cpu(attachment->dev, table, direction);
 }
 
 static int system_heap_dma_buf_begin_cpu_access(struct dma_buf *dmabuf,
@@ -156,6 +348,10 @@ static int system_heap_dma_buf_begin_cpu_access(struct dma_buf *dmabuf,
 	struct system_heap_buffer *buffer = dmabuf->priv;
 	struct dma_heap_attachment *a;
 
+	/* CPU mappings of uncached buffers need no cache maintenance */
+	if (buffer->uncached)
+		return 0;
+
 	mutex_lock(&buffer->lock);
 
 	if (buffer->vmap_cnt)
@@ -177,6 +373,9 @@ static int system_heap_dma_buf_end_cpu_access(struct dma_buf *dmabuf,
 	struct system_heap_buffer *buffer = dmabuf->priv;
 	struct dma_heap_attachment *a;
 
+	if (buffer->uncached)
+		return 0;
+
 	mutex_lock(&buffer->lock);
 
 	if (buffer->vmap_cnt)
@@ -200,6 +399,9 @@ static int system_heap_mmap(struct dma_buf *dmabuf, struct vm_area_struct *vma)
 	struct sg_page_iter piter;
 	int ret;
 
+	if (buffer->uncached)
+		vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
+
 	for_each_sgtable_page(table, &piter, vma->vm_pgoff) {
 		struct page *page = sg_page_iter_page(&piter);
 
@@ -221,6 +423,7 @@ static void *system_heap_do_vmap(struct system_heap_buffer *buffer)
 	struct page **pages = vmalloc(sizeof(struct page *) * npages);
 	struct page **tmp = pages;
 	struct sg_page_iter piter;
+	pgprot_t pgprot = PAGE_KERNEL;
 	void *vaddr;
 
 	if (!pages)
@@ -231,7 +434,10 @@ static void *system_heap_do_vmap(struct system_heap_buffer *buffer)
 		*tmp++ = sg_page_iter_page(&piter);
 	}
 
-	vaddr = vmap(pages, npages, VM_MAP, PAGE_KERNEL);
+	if (buffer->uncached)
+		pgprot = pgprot_writecombine(PAGE_KERNEL);
+
+	vaddr = vmap(pages, npages, VM_MAP, pgprot);
 	vfree(pages);
 
 	if (!vaddr)
@@ -286,16 +492,23 @@ static void system_heap_dma_buf_release(struct dma_buf *dmabuf)
 	struct system_heap_buffer *buffer = dmabuf->priv;
 	struct sg_table *table;
 	struct scatterlist *sg;
+	bool pooled = false;
 	int i;
 
 	table = &buffer->sg_table;
 	for_each_sgtable_sg(table, sg, i) {
 		struct page *page = sg_page(sg);
 
-		__free_pages(page, compound_order(page));
+		if (system_heap_pool_put(page, buffer->uncached))
+			pooled = true;
+		else
+			__free_pages(page, compound_order(page));
 	}
 	sg_free_table(table);
 	kfree(buffer);
+
+	if (pooled)
+		queue_work(system_unbound_wq, &pool_zero_work);
 }
 
 static const struct dma_buf_ops system_heap_buf_ops = {
@@ -312,7 +525,8 @@ static const struct dma_buf_ops system_heap_buf_ops = {
 };
 
 static struct page *alloc_largest_available(unsigned long size,
-					    unsigned int max_order)
+					    unsigned int max_order,
+					    bool uncached)
 {
 	struct page *page;
 	int i;
@@ -323,6 +537,10 @@ static struct page *alloc_largest_available(unsigned long size,
 		if (max_order < orders[i])
 			continue;
 
+		page = system_heap_pool_get(uncached, i);
+		if (page)
+			return page;
+
 		page = alloc_pages(order_flags[i], orders[i]);
 		if (!page)
 			continue;
@@ -331,10 +549,11 @@ static struct page *alloc_largest_available(unsigned long size,
 	return NULL;
 }
 
-static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
-					    unsigned long len,
-					    u32 fd_flags,
-					    u64 heap_flags)
+static struct dma_buf *system_heap_do_allocate(struct dma_heap *heap,
+					       unsigned long len,
+					       u32 fd_flags,
+					       u64 heap_flags,
+					       bool uncached)
 {
 	struct system_heap_buffer *buffer;
 	DEFINE_DMA_BUF_EXPORT_INFO(exp_info);
@@ -355,6 +574,7 @@ static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
 	mutex_init(&buffer->lock);
 	buffer->heap = heap;
 	buffer->len = len;
+	buffer->uncached = uncached;
 
 	INIT_LIST_HEAD(&pages);
 	i = 0;
@@ -368,7 +588,8 @@ static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
 			goto free_buffer;
 		}
 
-		page = alloc_largest_available(size_remaining, max_order);
+		page = alloc_largest_available(size_remaining, max_order,
+					       uncached);
 		if (!page)
 			goto free_buffer;
 
@@ -389,6 +610,19 @@ static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
 		list_del(&page->lru);
 	}
 
+	/*
+	 * The pages were zeroed through the cached linear mapping. Write that
+	 * back before they are accessed through uncached mappings only.
+	 */
+	if (uncached) {
+		struct device *dev = dma_heap_get_dev(heap);
+
+		ret = dma_map_sgtable(dev, table, DMA_BIDIRECTIONAL, 0);
+		if (ret)
+			goto free_pages;
+		dma_unmap_sgtable(dev, table, DMA_BIDIRECTIONAL, 0);
+	}
+
 	/* create the dmabuf */
 	exp_info.exp_name = dma_heap_get_name(heap);
 	exp_info.ops = &system_heap_buf_ops;
@@ -417,13 +651,52 @@ static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
 	return ERR_PTR(ret);
 }
 
+static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
+					    unsigned long len,
+					    u32 fd_flags,
+					    u64 heap_flags)
+{
+	return system_heap_do_allocate(heap, len, fd_flags, heap_flags, false);
+}
+
+static struct dma_buf *system_uncached_heap_allocate(struct dma_heap *heap,
+						     unsigned long len,
+						     u32 fd_flags,
+						     u64 heap_flags)
+{
+	return system_heap_do_allocate(heap, len, fd_flags, heap_flags, true);
+}
+
 static const struct dma_heap_ops system_heap_ops = {
 	.allocate = system_heap_allocate,
 };
 
+static const struct dma_heap_ops system_uncached_heap_ops = {
+	.allocate = system_uncached_heap_allocate,
+};
+
 static int __init system_heap_create(void)
 {
 	struct dma_heap_export_info exp_info;
+	int i;
+
+	for (i = 0; i < 2 * NUM_ORDERS; i++) {
+		struct system_heap_pool *pool = &pools[i / NUM_ORDERS][i % NUM_ORDERS];
+
+		spin_lock_init(&pool->lock);
+		INIT_LIST_HEAD(&pool->clean);
+		INIT_LIST_HEAD(&pool->dirty);
+	}
+
+	pool_shrinker = shrinker_alloc(0, "dmabuf-system-heap-pool");
+	if (pool_shrinker) {
+		pool_shrinker->count_objects = system_heap_pool_count;
+		pool_shrinker->scan_objects = system_heap_pool_scan;
+		shrinker_register(pool_shrinker);
+	} else {
+		/* Without a shrinker the pool could not be reclaimed */
+		pool_size_mb = 0;
+	}
 
 	exp_info.name = "system";
 	exp_info.ops = &system_heap_ops;
@@ -433,6 +706,17 @@ static int __init system_heap_create(void)
 	if (IS_ERR(sys_heap))
 		return PTR_ERR(sys_heap);
 
+	exp_info.name = "system-uncached";
+	exp_info.ops = &system_uncached_heap_ops;
+	exp_info.priv = NULL;
+
+	sys_uncached_heap = dma_heap_add(&exp_info);
+	if (IS_ERR(sys_uncached_heap))
+		return PTR_ERR(sys_uncached_heap);
+
+	dma_coerce_mask_and_coherent(dma_heap_get_dev(sys_uncached_heap),
+				     DMA_BIT_MASK(64));
+
 	return 0;
 }
 module_init(system_heap_create);
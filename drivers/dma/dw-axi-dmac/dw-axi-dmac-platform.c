@@ -293,15 +293,11 @@ static struct axi_dma_desc *axi_desc_alloc(u32 num)
 {
 	struct axi_dma_desc *desc;
 
-	desc = kzalloc(sizeof(*desc), GFP_NOWAIT);
+	/* The hw_desc array is allocated together with the descriptor */
+	desc = kzalloc(struct_size(desc, hw_desc, num), GFP_NOWAIT);
 	if (!desc)
 		return NULL;
 
-	desc->hw_desc = kcalloc(num, sizeof(*desc->hw_desc), GFP_NOWAIT);
-	if (!desc->hw_desc) {
-		kfree(desc);
-		return NULL;
-	}
 	desc->nr_hw_descs = num;
 
 	return desc;
@@ -338,7 +334,8 @@ static void axi_desc_put(struct axi_dma_desc *desc)
 		dma_pool_free(chan->desc_pool, hw_desc->lli, hw_desc->llp);
 	}
 
-	kfree(desc->hw_desc);
+	if (desc->fill)
+		dma_pool_free(chan->desc_pool, desc->fill, desc->fill_phys);
 	kfree(desc);
 	atomic_sub(descs_put, &chan->descs_allocated);
 	dev_vdbg(chan2dev(chan), "%s: %d descs put, %d still allocated\n",
@@ -468,6 +465,18 @@ static void axi_chan_block_xfer_start(struct axi_dma_chan *chan,
 	}
 	axi_chan_config_write(chan, &config);
 
+	/*
+	 * A client reusing the descriptor (DMA_CTRL_REUSE) submits the same
+	 * LLIs again, re-arm all of them.
+	 */
+	if (dmaengine_desc_test_reuse(&first->vd.tx)) {
+		u32 i;
+
+		for (i = 0; i < first->nr_hw_descs; i++)
+			first->hw_desc[i].lli->ctl_hi |= cpu_to_le32(CH_CTL_H_LLI_VALID);
+		first->completed_blocks = 0;
+	}
+
 	write_chan_llp(chan, first->hw_desc[0].llp | lms);
 
 	irq_mask = DWAXIDMAC_IRQ_DMA_TRF | DWAXIDMAC_IRQ_ALL_ERR;
@@ -917,21 +926,22 @@ dw_axi_dma_chan_prep_slave_sg(struct dma_chan *dchan, struct scatterlist *sgl,
 	return NULL;
 }
 
-static struct dma_async_tx_descriptor *
-dma_chan_prep_dma_memcpy(struct dma_chan *dchan, dma_addr_t dst_adr,
-			 dma_addr_t src_adr, size_t len, unsigned long flags)
+/*
+ * Build the LLIs for a memory to memory transfer. With src_fixed the source
+ * address is not incremented, which is used to replicate a fill pattern.
+ */
+static struct axi_dma_desc *
+dw_axi_dma_prep_mem(struct axi_dma_chan *chan, dma_addr_t dst_adr,
+		    dma_addr_t src_adr, size_t len, bool src_fixed)
 {
-	struct axi_dma_chan *chan = dchan_to_axi_dma_chan(dchan);
 	size_t block_ts, max_block_ts, xfer_len;
 	struct axi_dma_hw_desc *hw_desc = NULL;
 	struct axi_dma_desc *desc = NULL;
 	u32 xfer_width, reg, num;
+	u32 src_inc = src_fixed ? DWAXIDMAC_CH_CTL_L_NOINC : DWAXIDMAC_CH_CTL_L_INC;
 	u64 llp = 0;
 	u8 lms = 0; /* Select AXI0 master for LLI fetching */
 
-	dev_dbg(chan2dev(chan), "%s: memcpy: src: %pad dst: %pad length: %zd flags: %#lx",
-		axi_chan_name(chan), &src_adr, &dst_adr, len, flags);
-
 	max_block_ts = chan->chip->dw->hdata->block_size[chan->id];
 	xfer_width = axi_chan_get_xfer_width(chan, src_adr, dst_adr, len);
 	num = DIV_ROUND_UP(len, max_block_ts << xfer_width);
@@ -988,7 +998,7 @@ dma_chan_prep_dma_memcpy(struct dma_chan *dchan, dma_addr_t dst_adr,
 		       xfer_width << CH_CTL_L_DST_WIDTH_POS |
 		       xfer_width << CH_CTL_L_SRC_WIDTH_POS |
 		       DWAXIDMAC_CH_CTL_L_INC << CH_CTL_L_DST_INC_POS |
-		       DWAXIDMAC_CH_CTL_L_INC << CH_CTL_L_SRC_INC_POS);
+		       src_inc << CH_CTL_L_SRC_INC_POS);
 		hw_desc->lli->ctl_lo = cpu_to_le32(reg);
 
 		set_desc_src_master(hw_desc);
@@ -999,7 +1009,8 @@ dma_chan_prep_dma_memcpy(struct dma_chan *dchan, dma_addr_t dst_adr,
 		/* update the length and addresses for the next loop cycle */
 		len -= xfer_len;
 		dst_adr += xfer_len;
-		src_adr += xfer_len;
+		if (!src_fixed)
+			src_adr += xfer_len;
 		num++;
 	}
 
@@ -1012,7 +1023,7 @@ dma_chan_prep_dma_memcpy(struct dma_chan *dchan, dma_addr_t dst_adr,
 		llp = hw_desc->llp;
 	} while (num);
 
-	return vchan_tx_prep(&chan->vc, &desc->vd, flags);
+	return desc;
 
 err_desc_get:
 	if (desc)
@@ -1020,6 +1031,57 @@ dma_chan_prep_dma_memcpy(struct dma_chan *dchan, dma_addr_t dst_adr,
 	return NULL;
 }
 
+static struct dma_async_tx_descriptor *
+dma_chan_prep_dma_memcpy(struct dma_chan *dchan, dma_addr_t dst_adr,
+			 dma_addr_t src_adr, size_t len, unsigned long flags)
+{
+	struct axi_dma_chan *chan = dchan_to_axi_dma_chan(dchan);
+	struct axi_dma_desc *desc;
+
+	dev_dbg(chan2dev(chan), "%s: memcpy: src: %pad dst: %pad length: %zd flags: %#lx",
+		axi_chan_name(chan), &src_adr, &dst_adr, len, flags);
+
+	desc = dw_axi_dma_prep_mem(chan, dst_adr, src_adr, len, false);
+	if (unlikely(!desc))
+		return NULL;
+
+	return vchan_tx_prep(&chan->vc, &desc->vd, flags);
+}
+
+static struct dma_async_tx_descriptor *
+dma_chan_prep_dma_memset(struct dma_chan *dchan, dma_addr_t dst_adr,
+			 int value, size_t len, unsigned long flags)
+{
+	struct axi_dma_chan *chan = dchan_to_axi_dma_chan(dchan);
+	struct axi_dma_desc *desc;
+	dma_addr_t fill_phys;
+	void *fill;
+
+	dev_dbg(chan2dev(chan), "%s: memset: dst: %pad value: %#x length: %zd flags: %#lx",
+		axi_chan_name(chan), &dst_adr, value & 0xff, len, flags);
+
+	/*
+	 * The controller has no fill mode, so read the pattern over and over
+	 * from a fixed address. A descriptor pool element is 64-byte aligned
+	 * and as wide as the widest AXI data bus, whatever transfer width is
+	 * picked below.
+	 */
+	fill = dma_pool_alloc(chan->desc_pool, GFP_NOWAIT, &fill_phys);
+	if (unlikely(!fill))
+		return NULL;
+	memset(fill, value, sizeof(struct axi_dma_lli));
+
+	desc = dw_axi_dma_prep_mem(chan, dst_adr, fill_phys, len, true);
+	if (unlikely(!desc)) {
+		dma_pool_free(chan->desc_pool, fill, fill_phys);
+		return NULL;
+	}
+	desc->fill = fill;
+	desc->fill_phys = fill_phys;
+
+	return vchan_tx_prep(&chan->vc, &desc->vd, flags);
+}
+
 static int dw_axi_dma_chan_slave_config(struct dma_chan *dchan,
 					struct dma_slave_config *config)
 {
@@ -1546,6 +1608,7 @@ static int dw_probe(struct platform_device *pdev)
 
 	/* Set capabilities */
 	dma_cap_set(DMA_MEMCPY, dw->dma.cap_mask);
+	dma_cap_set(DMA_MEMSET, dw->dma.cap_mask);
 	dma_cap_set(DMA_SLAVE, dw->dma.cap_mask);
 	dma_cap_set(DMA_CYCLIC, dw->dma.cap_mask);
 
@@ -1556,6 +1619,7 @@ static int dw_probe(struct platform_device *pdev)
 	dw->dma.directions = BIT(DMA_MEM_TO_MEM);
 	dw->dma.directions |= BIT(DMA_MEM_TO_DEV) | BIT(DMA_DEV_TO_MEM);
 	dw->dma.residue_granularity = DMA_RESIDUE_GRANULARITY_BURST;
+	dw->dma.descriptor_reuse = true;
 
 	dw->dma.dev = chip->dev;
 	dw->dma.device_tx_status = dma_chan_tx_status;
@@ -1568,6 +1632,7 @@ static int dw_probe(struct platform_device *pdev)
 	dw->dma.device_free_chan_resources = dma_chan_free_chan_resources;
 
 	dw->dma.device_prep_dma_memcpy = dma_chan_prep_dma_memcpy;
+	dw->dma.device_prep_dma_memset = dma_chan_prep_dma_memset;
 	dw->dma.device_synchronize = dw_axi_dma_synchronize;
 	dw->dma.device_config = dw_axi_dma_chan_slave_config;
 	dw->dma.device_prep_slave_sg = dw_axi_dma_chan_prep_slave_sg;
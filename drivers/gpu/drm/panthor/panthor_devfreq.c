@@ -6,12 +6,42 @@
 #include <linux/devfreq_cooling.h>
 #include <linux/platform_device.h>
 #include <linux/pm_opp.h>
-
+#include <linux/pm_qos.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/units.h>
+#include <linux/workqueue.h>
+
+#include <drm/drm_debugfs.h>
+#include <drm/drm_file.h>
 #include <drm/drm_managed.h>
 
 #include "panthor_devfreq.h"
 #include "panthor_device.h"
 
+/*
+ * Frequency boosts only last for one polling period. After that, the
+ * simple_ondemand governor is back in charge.
+ */
+#define PANTHOR_DEVFREQ_POLLING_MS	50
+
+/* Idle period after which we boost the frequency when the GPU becomes busy again. */
+#define PANTHOR_DEVFREQ_BOOST_IDLE_NS	(PANTHOR_DEVFREQ_POLLING_MS * NSEC_PER_MSEC)
+
+/* Margin we keep between the frequency boost and the fence deadline. */
+#define PANTHOR_DEVFREQ_DEADLINE_MARGIN_NS	(3 * NSEC_PER_MSEC)
+
+/**
+ * struct panthor_devfreq_state_stats - Per-OPP statistics
+ */
+struct panthor_devfreq_state_stats {
+	/** @busy_time: Time spent busy at this OPP. */
+	ktime_t busy_time;
+
+	/** @idle_time: Time spent idle at this OPP. */
+	ktime_t idle_time;
+};
+
 /**
  * struct panthor_devfreq - Device frequency management
  */
@@ -35,30 +65,93 @@ struct panthor_devfreq {
 	bool last_busy_state;
 
 	/**
-	 * @lock: Lock used to protect busy_time, idle_time, time_last_update and
-	 * last_busy_state.
+	 * @idle_start: Time at which the GPU last became idle.
+	 *
+	 * Unlike @time_last_update, it's not moved by the devfreq polling.
+	 */
+	ktime_t idle_start;
+
+	/**
+	 * @stats: Per-OPP busy/idle time, indexed like devfreq->freq_table.
+	 *
+	 * NULL until the devfreq device has been created.
+	 */
+	struct panthor_devfreq_state_stats *stats;
+
+	/** @cur_state: Index of the current OPP in devfreq->freq_table, or -1. */
+	int cur_state;
+
+	/**
+	 * @next_deadline: Closest fence deadline we've been told about.
+	 *
+	 * KTIME_MAX if there's no pending deadline.
+	 */
+	ktime_t next_deadline;
+
+	/**
+	 * @lock: Lock used to protect busy_time, idle_time, time_last_update,
+	 * last_busy_state, idle_start, stats, cur_state and next_deadline.
 	 *
 	 * These fields can be accessed concurrently by panthor_devfreq_get_dev_status()
 	 * and panthor_devfreq_record_{busy,idle}().
 	 */
 	spinlock_t lock;
+
+	/** @boost_freq: PM QoS request used to boost the GPU frequency. */
+	struct dev_pm_qos_request boost_freq;
+
+	/** @boost_work: Work raising the minimum frequency. */
+	struct work_struct boost_work;
+
+	/** @unboost_work: Work dropping the minimum frequency request. */
+	struct delayed_work unboost_work;
+
+	/** @deadline_work: Work boosting the frequency ahead of a fence deadline. */
+	struct delayed_work deadline_work;
 };
 
 static void panthor_devfreq_update_utilization(struct panthor_devfreq *pdevfreq)
 {
-	ktime_t now, last;
+	ktime_t now, last, delta;
 
 	now = ktime_get();
 	last = pdevfreq->time_last_update;
+	delta = ktime_sub(now, last);
 
 	if (pdevfreq->last_busy_state)
-		pdevfreq->busy_time += ktime_sub(now, last);
+		pdevfreq->busy_time += delta;
 	else
-		pdevfreq->idle_time += ktime_sub(now, last);
+		pdevfreq->idle_time += delta;
+
+	if (pdevfreq->stats && pdevfreq->cur_state >= 0) {
+		struct panthor_devfreq_state_stats *stats = &pdevfreq->stats[pdevfreq->cur_state];
+
+		if (pdevfreq->last_busy_state)
+			stats->busy_time += delta;
+		else
+			stats->idle_time += delta;
+	}
 
 	pdevfreq->time_last_update = now;
 }
 
+static int panthor_devfreq_get_state(struct panthor_devfreq *pdevfreq,
+				     unsigned long freq)
+{
+	struct devfreq *devfreq = pdevfreq->devfreq;
+	unsigned int i;
+
+	if (!devfreq)
+		return -1;
+
+	for (i = 0; i < devfreq->max_state; i++) {
+		if (devfreq->freq_table[i] == freq)
+			return i;
+	}
+
+	return -1;
+}
+
 static int panthor_devfreq_target(struct device *dev, unsigned long *freq,
 				  u32 flags)
 {
@@ -72,8 +165,17 @@ static int panthor_devfreq_target(struct device *dev, unsigned long *freq,
 	dev_pm_opp_put(opp);
 
 	err = dev_pm_opp_set_rate(dev, *freq);
-	if (!err)
+	if (!err) {
+		struct panthor_devfreq *pdevfreq = ptdev->devfreq;
+		unsigned long irqflags;
+
+		spin_lock_irqsave(&pdevfreq->lock, irqflags);
+		panthor_devfreq_update_utilization(pdevfreq);
+		pdevfreq->cur_state = panthor_devfreq_get_state(pdevfreq, *freq);
+		spin_unlock_irqrestore(&pdevfreq->lock, irqflags);
+
 		ptdev->current_frequency = *freq;
+	}
 
 	return err;
 }
@@ -117,11 +219,61 @@ static int panthor_devfreq_get_dev_status(struct device *dev,
 
 static struct devfreq_dev_profile panthor_devfreq_profile = {
 	.timer = DEVFREQ_TIMER_DELAYED,
-	.polling_ms = 50, /* ~3 frames */
+	.polling_ms = PANTHOR_DEVFREQ_POLLING_MS, /* ~3 frames */
 	.target = panthor_devfreq_target,
 	.get_dev_status = panthor_devfreq_get_dev_status,
 };
 
+static void panthor_devfreq_boost_work(struct work_struct *work)
+{
+	struct panthor_devfreq *pdevfreq = container_of(work, struct panthor_devfreq,
+							boost_work);
+	struct panthor_device *ptdev = dev_get_drvdata(pdevfreq->devfreq->dev.parent);
+	unsigned long freq;
+
+	/* Double the current frequency. If that's not enough, the governor will
+	 * keep raising it on the next evaluation.
+	 */
+	freq = min(ptdev->current_frequency * 2, ptdev->fast_rate);
+
+	/* PM QoS frequency requests are expressed in kHz. */
+	dev_pm_qos_update_request(&pdevfreq->boost_freq, freq / HZ_PER_KHZ);
+
+	mod_delayed_work(system_wq, &pdevfreq->unboost_work,
+			 msecs_to_jiffies(PANTHOR_DEVFREQ_POLLING_MS));
+}
+
+static void panthor_devfreq_unboost_work(struct work_struct *work)
+{
+	struct panthor_devfreq *pdevfreq = container_of(work, struct panthor_devfreq,
+							unboost_work.work);
+
+	dev_pm_qos_update_request(&pdevfreq->boost_freq, 0);
+}
+
+static void panthor_devfreq_deadline_work(struct work_struct *work)
+{
+	struct panthor_devfreq *pdevfreq = container_of(work, struct panthor_devfreq,
+							deadline_work.work);
+	unsigned long irqflags;
+
+	spin_lock_irqsave(&pdevfreq->lock, irqflags);
+	pdevfreq->next_deadline = KTIME_MAX;
+	spin_unlock_irqrestore(&pdevfreq->lock, irqflags);
+
+	queue_work(system_highpri_wq, &pdevfreq->boost_work);
+}
+
+static void panthor_devfreq_fini(void *data)
+{
+	struct panthor_devfreq *pdevfreq = data;
+
+	cancel_delayed_work_sync(&pdevfreq->deadline_work);
+	cancel_work_sync(&pdevfreq->boost_work);
+	cancel_delayed_work_sync(&pdevfreq->unboost_work);
+	dev_pm_qos_remove_request(&pdevfreq->boost_freq);
+}
+
 int panthor_devfreq_init(struct panthor_device *ptdev)
 {
 	/* There's actually 2 regulators (mali and sram), but the OPP core only
@@ -153,11 +305,21 @@ int panthor_devfreq_init(struct panthor_device *ptdev)
 		return ret;
 	}
 
+	/* OPPs restricted with opp-supported-hw are only used on matching chips */
+	ret = devm_pm_opp_set_supported_hw_nvmem(dev, "speed-bin");
+	if (ret)
+		return ret;
+
 	ret = devm_pm_opp_of_add_table(dev);
 	if (ret)
 		return ret;
 
 	spin_lock_init(&pdevfreq->lock);
+	pdevfreq->cur_state = -1;
+	pdevfreq->next_deadline = KTIME_MAX;
+	INIT_WORK(&pdevfreq->boost_work, panthor_devfreq_boost_work);
+	INIT_DELAYED_WORK(&pdevfreq->unboost_work, panthor_devfreq_unboost_work);
+	INIT_DELAYED_WORK(&pdevfreq->deadline_work, panthor_devfreq_deadline_work);
 
 	panthor_devfreq_reset(pdevfreq);
 
@@ -236,6 +398,25 @@ int panthor_devfreq_init(struct panthor_device *ptdev)
 		return ret;
 	}
 
+	pdevfreq->stats = drmm_kcalloc(&ptdev->base, pdevfreq->devfreq->max_state,
+				       sizeof(*pdevfreq->stats), GFP_KERNEL);
+	if (!pdevfreq->stats)
+		return -ENOMEM;
+
+	spin_lock_irq(&pdevfreq->lock);
+	panthor_devfreq_update_utilization(pdevfreq);
+	pdevfreq->cur_state = panthor_devfreq_get_state(pdevfreq, ptdev->current_frequency);
+	spin_unlock_irq(&pdevfreq->lock);
+
+	ret = dev_pm_qos_add_request(dev, &pdevfreq->boost_freq,
+				     DEV_PM_QOS_MIN_FREQUENCY, 0);
+	if (ret < 0)
+		return ret;
+
+	ret = devm_add_action_or_reset(dev, panthor_devfreq_fini, pdevfreq);
+	if (ret)
+		return ret;
+
 	cooling = devfreq_cooling_em_register(pdevfreq->devfreq, NULL);
 	if (IS_ERR(cooling))
 		DRM_DEV_INFO(dev, "Failed to register cooling device\n");
@@ -262,6 +443,12 @@ void panthor_devfreq_suspend(struct panthor_device *ptdev)
 	if (!pdevfreq->devfreq)
 		return;
 
+	/* No point boosting the frequency of a suspended GPU. */
+	cancel_delayed_work(&pdevfreq->deadline_work);
+	spin_lock_irq(&pdevfreq->lock);
+	pdevfreq->next_deadline = KTIME_MAX;
+	spin_unlock_irq(&pdevfreq->lock);
+
 	drm_WARN_ON(&ptdev->base, devfreq_suspend_device(pdevfreq->devfreq));
 }
 
@@ -275,6 +462,16 @@ void panthor_devfreq_record_busy(struct panthor_device *ptdev)
 
 	spin_lock_irqsave(&pdevfreq->lock, irqflags);
 
+	/* If the GPU has been idle for a while, the governor has most likely
+	 * lowered the frequency, and it will take a full polling period before
+	 * it reacts to the new load. Boost the frequency right away, so the
+	 * first frame after an idle period doesn't pay the price.
+	 */
+	if (!pdevfreq->last_busy_state &&
+	    ktime_to_ns(ktime_sub(ktime_get(), pdevfreq->idle_start)) >
+	    PANTHOR_DEVFREQ_BOOST_IDLE_NS)
+		queue_work(system_highpri_wq, &pdevfreq->boost_work);
+
 	panthor_devfreq_update_utilization(pdevfreq);
 	pdevfreq->last_busy_state = true;
 
@@ -292,7 +489,96 @@ void panthor_devfreq_record_idle(struct panthor_device *ptdev)
 	spin_lock_irqsave(&pdevfreq->lock, irqflags);
 
 	panthor_devfreq_update_utilization(pdevfreq);
+	if (pdevfreq->last_busy_state)
+		pdevfreq->idle_start = pdevfreq->time_last_update;
 	pdevfreq->last_busy_state = false;
 
 	spin_unlock_irqrestore(&pdevfreq->lock, irqflags);
 }
+
+/**
+ * panthor_devfreq_set_deadline() - Boost the frequency ahead of a deadline
+ * @ptdev: Device.
+ * @deadline: Time at which the waiter wants the work to be done.
+ *
+ * Called when someone waiting on one of our job fences gives us a hint about
+ * when it needs the fence to be signaled. If the deadline is close or already
+ * passed, the frequency is boosted immediately, otherwise the boost is
+ * scheduled to happen just before the deadline.
+ */
+void panthor_devfreq_set_deadline(struct panthor_device *ptdev, ktime_t deadline)
+{
+	struct panthor_devfreq *pdevfreq = ptdev->devfreq;
+	unsigned long irqflags;
+	s64 delay_ns;
+
+	if (!pdevfreq->devfreq)
+		return;
+
+	spin_lock_irqsave(&pdevfreq->lock, irqflags);
+
+	/* A boost is already scheduled before this deadline. */
+	if (ktime_after(deadline, pdevfreq->next_deadline))
+		goto out_unlock;
+
+	delay_ns = ktime_to_ns(ktime_sub(deadline, ktime_get())) -
+		   PANTHOR_DEVFREQ_DEADLINE_MARGIN_NS;
+	if (delay_ns <= 0) {
+		queue_work(system_highpri_wq, &pdevfreq->boost_work);
+		goto out_unlock;
+	}
+
+	pdevfreq->next_deadline = deadline;
+	mod_delayed_work(system_highpri_wq, &pdevfreq->deadline_work,
+			 nsecs_to_jiffies(delay_ns));
+
+out_unlock:
+	spin_unlock_irqrestore(&pdevfreq->lock, irqflags);
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int panthor_devfreq_show_time_in_state(struct seq_file *m, void *data)
+{
+	struct drm_info_node *node = m->private;
+	struct drm_device *ddev = node->minor->dev;
+	struct panthor_device *ptdev = container_of(ddev, struct panthor_device, base);
+	struct panthor_devfreq *pdevfreq = ptdev->devfreq;
+	struct panthor_devfreq_state_stats *stats;
+	unsigned int i, count;
+
+	if (!pdevfreq->devfreq || !pdevfreq->stats)
+		return 0;
+
+	count = pdevfreq->devfreq->max_state;
+	stats = kcalloc(count, sizeof(*stats), GFP_KERNEL);
+	if (!stats)
+		return -ENOMEM;
+
+	spin_lock_irq(&pdevfreq->lock);
+	panthor_devfreq_update_utilization(pdevfreq);
+	memcpy(stats, pdevfreq->stats, count * sizeof(*stats));
+	spin_unlock_irq(&pdevfreq->lock);
+
+	seq_printf(m, "%12s %12s %12s\n", "freq (kHz)", "busy (ms)", "idle (ms)");
+	for (i = 0; i < count; i++) {
+		seq_printf(m, "%12lu %12lld %12lld\n",
+			   pdevfreq->devfreq->freq_table[i] / HZ_PER_KHZ,
+			   ktime_to_ms(stats[i].busy_time),
+			   ktime_to_ms(stats[i].idle_time));
+	}
+
+	kfree(stats);
+	return 0;
+}
+
+static struct drm_info_list panthor_devfreq_debugfs_list[] = {
+	{"devfreq_time_in_state", panthor_devfreq_show_time_in_state, 0, NULL},
+};
+
+void panthor_devfreq_debugfs_init(struct drm_minor *minor)
+{
+	drm_debugfs_create_files(panthor_devfreq_debugfs_list,
+				 ARRAY_SIZE(panthor_devfreq_debugfs_list),
+				 minor->debugfs_root, minor);
+}
+#endif /* CONFIG_DEBUG_FS */
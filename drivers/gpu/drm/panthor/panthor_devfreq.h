@@ -4,7 +4,10 @@
 #ifndef __PANTHOR_DEVFREQ_H__
 #define __PANTHOR_DEVFREQ_H__
 
+#include <linux/ktime.h>
+
 struct devfreq;
+struct drm_minor;
 struct thermal_cooling_device;
 
 struct panthor_device;
@@ -18,4 +21,10 @@ void panthor_devfreq_suspend(struct panthor_device *ptdev);
 void panthor_devfreq_record_busy(struct panthor_device *ptdev);
 void panthor_devfreq_record_idle(struct panthor_device *ptdev);
 
+void panthor_devfreq_set_deadline(struct panthor_device *ptdev, ktime_t deadline);
+
+#ifdef CONFIG_DEBUG_FS
+void panthor_devfreq_debugfs_init(struct drm_minor *minor);
+#endif
+
 #endif /* __PANTHOR_DEVFREQ_H__ */
@@ -11,14 +11,17 @@
 #include <linux/regulator/consumer.h>
 #include <linux/reset.h>
 
+#include <drm/drm_debugfs.h>
 #include <drm/drm_drv.h>
 #include <drm/drm_managed.h>
 
 #include "panthor_devfreq.h"
 #include "panthor_device.h"
 #include "panthor_fw.h"
+#include "panthor_gem.h"
 #include "panthor_gpu.h"
 #include "panthor_mmu.h"
+#include "panthor_perfcnt.h"
 #include "panthor_regs.h"
 #include "panthor_sched.h"
 
@@ -184,6 +187,16 @@ int panthor_device_init(struct panthor_device *ptdev)
 	if (ret)
 		return ret;
 
+	spin_lock_init(&ptdev->pm.resume_stats.lock);
+
+	ret = panthor_gem_shrinker_init(ptdev);
+	if (ret)
+		return ret;
+
+	ret = panthor_gemfs_init(ptdev);
+	if (ret)
+		return ret;
+
 	atomic_set(&ptdev->pm.state, PANTHOR_DEVICE_PM_STATE_SUSPENDED);
 	p = alloc_page(GFP_KERNEL | __GFP_ZERO);
 	if (!p)
@@ -259,6 +272,10 @@ int panthor_device_init(struct panthor_device *ptdev)
 	if (ret)
 		goto err_unplug_fw;
 
+	ret = panthor_perfcnt_init(ptdev);
+	if (ret)
+		goto err_unplug_sched;
+
 	/* ~3 frames */
 	pm_runtime_set_autosuspend_delay(ptdev->base.dev, 50);
 	pm_runtime_use_autosuspend(ptdev->base.dev);
@@ -272,6 +289,8 @@ int panthor_device_init(struct panthor_device *ptdev)
 
 err_disable_autosuspend:
 	pm_runtime_dont_use_autosuspend(ptdev->base.dev);
+
+err_unplug_sched:
 	panthor_sched_unplug(ptdev);
 
 err_unplug_fw:
@@ -448,9 +467,29 @@ static int panthor_device_resume_hw_components(struct panthor_device *ptdev)
 	return ret;
 }
 
+static void panthor_device_record_resume(struct panthor_device *ptdev,
+					 ktime_t start, bool fast)
+{
+	ktime_t duration = ktime_sub(ktime_get(), start);
+
+	spin_lock(&ptdev->pm.resume_stats.lock);
+	if (fast)
+		ptdev->pm.resume_stats.fast_count++;
+	else
+		ptdev->pm.resume_stats.slow_count++;
+
+	ptdev->pm.resume_stats.last = duration;
+	ptdev->pm.resume_stats.total = ktime_add(ptdev->pm.resume_stats.total, duration);
+	if (ktime_after(duration, ptdev->pm.resume_stats.max))
+		ptdev->pm.resume_stats.max = duration;
+	spin_unlock(&ptdev->pm.resume_stats.lock);
+}
+
 int panthor_device_resume(struct device *dev)
 {
 	struct panthor_device *ptdev = dev_get_drvdata(dev);
+	bool record_stats = false;
+	ktime_t start = ktime_get();
 	int ret, cookie;
 
 	if (atomic_read(&ptdev->pm.state) != PANTHOR_DEVICE_PM_STATE_SUSPENDED)
@@ -496,6 +535,8 @@ int panthor_device_resume(struct device *dev)
 
 		if (ret)
 			goto err_suspend_devfreq;
+
+		record_stats = true;
 	}
 
 	/* Clear all IOMEM mappings pointing to this device after we've
@@ -508,6 +549,10 @@ int panthor_device_resume(struct device *dev)
 			    DRM_PANTHOR_USER_MMIO_OFFSET, 0, 1);
 	atomic_set(&ptdev->pm.state, PANTHOR_DEVICE_PM_STATE_ACTIVE);
 	mutex_unlock(&ptdev->pm.mmio_lock);
+
+	if (record_stats)
+		panthor_device_record_resume(ptdev, start, ptdev->reset.fast);
+
 	return 0;
 
 err_suspend_devfreq:
@@ -569,3 +614,46 @@ int panthor_device_suspend(struct device *dev)
 	atomic_set(&ptdev->pm.state, PANTHOR_DEVICE_PM_STATE_SUSPENDED);
 	return 0;
 }
+
+#ifdef CONFIG_DEBUG_FS
+static int panthor_device_show_resume_stats(struct seq_file *m, void *data)
+{
+	struct drm_info_node *node = m->private;
+	struct drm_device *ddev = node->minor->dev;
+	struct panthor_device *ptdev = container_of(ddev, struct panthor_device, base);
+	u64 fast_count, slow_count;
+	ktime_t last, max, total;
+
+	spin_lock(&ptdev->pm.resume_stats.lock);
+	fast_count = ptdev->pm.resume_stats.fast_count;
+	slow_count = ptdev->pm.resume_stats.slow_count;
+	last = ptdev->pm.resume_stats.last;
+	max = ptdev->pm.resume_stats.max;
+	total = ptdev->pm.resume_stats.total;
+	spin_unlock(&ptdev->pm.resume_stats.lock);
+
+	seq_printf(m, "fast resumes: %llu\n", fast_count);
+	seq_printf(m, "slow resumes: %llu\n", slow_count);
+	seq_printf(m, "last (us): %lld\n", ktime_to_us(last));
+	seq_printf(m, "max (us): %lld\n", ktime_to_us(max));
+	seq_printf(m, "avg (us): %llu\n",
+		   fast_count + slow_count ?
+		   div64_u64(ktime_to_us(total), fast_count + slow_count) : 0);
+	return 0;
+}
+
+static struct drm_info_list panthor_device_debugfs_list[] = {
+	{"pm_resume_stats", panthor_device_show_resume_stats, 0, NULL},
+};
+
+/**
+ * panthor_device_debugfs_init() - Initialize device debugfs entries
+ * @minor: Minor.
+ */
+void panthor_device_debugfs_init(struct drm_minor *minor)
+{
+	drm_debugfs_create_files(panthor_device_debugfs_list,
+				 ARRAY_SIZE(panthor_device_debugfs_list),
+				 minor->debugfs_root, minor);
+}
+#endif /* CONFIG_DEBUG_FS */
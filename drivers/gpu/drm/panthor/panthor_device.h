@@ -111,6 +111,14 @@ struct panthor_device {
 		struct clk *coregroup;
 	} clks;
 
+	/**
+	 * @gemfs: Mountpoint used to back BOs with huge pages.
+	 *
+	 * NULL if THP is not available, in which case BOs are allocated from
+	 * the default shmem mountpoint.
+	 */
+	struct vfsmount *gemfs;
+
 	/** @coherent: True if the CPU/GPU are memory coherent. */
 	bool coherent;
 
@@ -135,6 +143,9 @@ struct panthor_device {
 	/** @devfreq: Device frequency scaling management data. */
 	struct panthor_devfreq *devfreq;
 
+	/** @perfcnt: Performance counter management data. */
+	struct panthor_perfcnt *perfcnt;
+
 	/** @unplug: Device unplug related fields. */
 	struct {
 		/** @lock: Lock used to serialize unplug operations. */
@@ -195,8 +206,57 @@ struct panthor_device {
 
 		/** @recovery_needed: True when a resume attempt failed. */
 		atomic_t recovery_needed;
+
+		/** @resume_stats: Resume latency statistics. */
+		struct {
+			/** @lock: Lock protecting the resume statistics. */
+			spinlock_t lock;
+
+			/**
+			 * @fast_count: Number of resumes that restarted the MCU
+			 * without reloading the FW sections.
+			 */
+			u64 fast_count;
+
+			/** @slow_count: Number of resumes that reloaded all FW sections. */
+			u64 slow_count;
+
+			/** @last: Duration of the last resume. */
+			ktime_t last;
+
+			/** @max: Duration of the slowest resume. */
+			ktime_t max;
+
+			/** @total: Accumulated resume duration. */
+			ktime_t total;
+		} resume_stats;
 	} pm;
 
+	/** @reclaim: GEM reclaim related fields. */
+	struct {
+		/**
+		 * @lock: Lock protecting the reclaim list.
+		 *
+		 * Must be taken before the VM op_lock and the BO reservation lock.
+		 */
+		struct mutex lock;
+
+		/** @list: List of BOs marked DRM_PANTHOR_BO_MADV_DONTNEED. */
+		struct list_head list;
+
+		/** @shrinker: Shrinker purging the BOs in @list. */
+		struct shrinker *shrinker;
+
+		/**
+		 * @evict_work: Work unmapping idle DONTNEED BOs from their VMs.
+		 *
+		 * BOs mapped to a VM are pinned, so they have to be unmapped
+		 * before the shrinker can purge them. This can't be done from
+		 * the shrinker itself, because VM operations allocate memory.
+		 */
+		struct work_struct evict_work;
+	} reclaim;
+
 	/** @profile_mask: User-set profiling flags for job accounting. */
 	u32 profile_mask;
 
@@ -258,6 +318,10 @@ int panthor_device_mmap_io(struct panthor_device *ptdev,
 int panthor_device_resume(struct device *dev);
 int panthor_device_suspend(struct device *dev);
 
+#ifdef CONFIG_DEBUG_FS
+void panthor_device_debugfs_init(struct drm_minor *minor);
+#endif
+
 static inline int panthor_device_resume_and_get(struct panthor_device *ptdev)
 {
 	int ret = pm_runtime_resume_and_get(ptdev->base.dev);
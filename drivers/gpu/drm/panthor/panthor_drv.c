@@ -7,6 +7,7 @@
 #include <asm/arch_timer.h>
 #endif
 
+#include <linux/capability.h>
 #include <linux/list.h>
 #include <linux/module.h>
 #include <linux/of_platform.h>
@@ -25,12 +26,14 @@
 #include <drm/gpu_scheduler.h>
 #include <drm/panthor_drm.h>
 
+#include "panthor_devfreq.h"
 #include "panthor_device.h"
 #include "panthor_fw.h"
 #include "panthor_gem.h"
 #include "panthor_gpu.h"
 #include "panthor_heap.h"
 #include "panthor_mmu.h"
+#include "panthor_perfcnt.h"
 #include "panthor_regs.h"
 #include "panthor_sched.h"
 
@@ -961,6 +964,100 @@ static int panthor_ioctl_bo_mmap_offset(struct drm_device *ddev, void *data,
 	return ret;
 }
 
+static int panthor_ioctl_bo_madvise(struct drm_device *ddev, void *data,
+				    struct drm_file *file)
+{
+	struct panthor_device *ptdev = container_of(ddev, struct panthor_device, base);
+	struct drm_panthor_bo_madvise *args = data;
+	struct drm_gem_shmem_object *shmem;
+	struct drm_gem_object *obj;
+	int ret;
+
+	if (args->pad)
+		return -EINVAL;
+
+	if (args->madv != DRM_PANTHOR_BO_MADV_WILLNEED &&
+	    args->madv != DRM_PANTHOR_BO_MADV_DONTNEED)
+		return -EINVAL;
+
+	obj = drm_gem_object_lookup(file, args->handle);
+	if (!obj)
+		return -ENOENT;
+
+	shmem = to_drm_gem_shmem_obj(obj);
+
+	/* The reclaim lock must be taken before the resv lock, and it also
+	 * guarantees the eviction work is not tearing down the GPU mappings
+	 * of this BO while we're flagging it WILLNEED.
+	 */
+	ret = mutex_lock_interruptible(&ptdev->reclaim.lock);
+	if (ret)
+		goto out_put_obj;
+
+	ret = dma_resv_lock_interruptible(obj->resv, NULL);
+	if (ret)
+		goto out_unlock_reclaim;
+
+	args->retained = drm_gem_shmem_madvise_locked(shmem, args->madv);
+	if (args->retained) {
+		if (args->madv == DRM_PANTHOR_BO_MADV_DONTNEED)
+			list_move_tail(&shmem->madv_list, &ptdev->reclaim.list);
+		else
+			list_del_init(&shmem->madv_list);
+	}
+
+	dma_resv_unlock(obj->resv);
+
+out_unlock_reclaim:
+	mutex_unlock(&ptdev->reclaim.lock);
+
+out_put_obj:
+	drm_gem_object_put(obj);
+	return ret;
+}
+
+static int panthor_ioctl_perfcnt_enable(struct drm_device *ddev, void *data,
+					struct drm_file *file)
+{
+	struct panthor_file *pfile = file->driver_priv;
+	struct drm_panthor_perfcnt_enable *args = data;
+	int ret, cookie;
+
+	if (args->enable > 1)
+		return -EINVAL;
+
+	/* Counters are global, and can be used to spy on other users of the GPU. */
+	if (args->enable && !perfmon_capable())
+		return -EACCES;
+
+	if (!drm_dev_enter(ddev, &cookie))
+		return -ENODEV;
+
+	ret = panthor_perfcnt_enable(pfile, args);
+
+	drm_dev_exit(cookie);
+	return ret;
+}
+
+static int panthor_ioctl_perfcnt_dump(struct drm_device *ddev, void *data,
+				      struct drm_file *file)
+{
+	struct panthor_file *pfile = file->driver_priv;
+	struct drm_panthor_perfcnt_dump *args = data;
+	int ret, cookie;
+
+	if (args->flags & ~DRM_PANTHOR_PERFCNT_DUMP_NO_SAMPLE)
+		return -EINVAL;
+
+	if (!drm_dev_enter(ddev, &cookie))
+		return -ENODEV;
+
+	ret = panthor_perfcnt_dump(pfile, args);
+
+	drm_dev_exit(cookie);
+	return ret;
+}
+
 static int panthor_ioctl_group_submit(struct drm_device *ddev, void *data,
 				      struct drm_file *file)
 {
@@ -1376,6 +1473,7 @@ panthor_postclose(struct drm_device *ddev, struct drm_file *file)
 {
 	struct panthor_file *pfile = file->driver_priv;
 
+	panthor_perfcnt_close(pfile);
 	panthor_group_pool_destroy(pfile);
 	panthor_vm_pool_destroy(pfile);
 
@@ -1400,6 +1498,9 @@ static const struct drm_ioctl_desc panthor_drm_driver_ioctls[] = {
 	PANTHOR_IOCTL(TILER_HEAP_CREATE, tiler_heap_create, DRM_RENDER_ALLOW),
 	PANTHOR_IOCTL(TILER_HEAP_DESTROY, tiler_heap_destroy, DRM_RENDER_ALLOW),
 	PANTHOR_IOCTL(GROUP_SUBMIT, group_submit, DRM_RENDER_ALLOW),
+	PANTHOR_IOCTL(BO_MADVISE, bo_madvise, DRM_RENDER_ALLOW),
+	PANTHOR_IOCTL(PERFCNT_ENABLE, perfcnt_enable, DRM_RENDER_ALLOW),
+	PANTHOR_IOCTL(PERFCNT_DUMP, perfcnt_dump, DRM_RENDER_ALLOW),
 };
 
 static int panthor_mmap(struct file *filp, struct vm_area_struct *vma)
@@ -1463,12 +1564,16 @@ static void panthor_show_internal_memory_stats(struct drm_printer *p, struct drm
 	char *drv_name = file->minor->dev->driver->name;
 	struct panthor_file *pfile = file->driver_priv;
 	struct drm_memory_stats stats = {0};
+	u64 mapped_4k, mapped_2m;
 
 	panthor_fdinfo_gather_group_mem_info(pfile, &stats);
 	panthor_vm_heaps_sizes(pfile, &stats);
+	panthor_vm_mapped_sizes(pfile, &mapped_4k, &mapped_2m);
 
 	drm_fdinfo_print_size(p, drv_name, "resident", "memory", stats.resident);
 	drm_fdinfo_print_size(p, drv_name, "active", "memory", stats.active);
+	drm_fdinfo_print_size(p, drv_name, "mapped-4k", "memory", mapped_4k);
+	drm_fdinfo_print_size(p, drv_name, "mapped-2m", "memory", mapped_2m);
 }
 
 static void panthor_show_fdinfo(struct drm_printer *p, struct drm_file *file)
@@ -1477,6 +1582,7 @@ static void panthor_show_fdinfo(struct drm_printer *p, struct drm_file *file)
 	struct panthor_device *ptdev = container_of(dev, struct panthor_device, base);
 
 	panthor_gpu_show_fdinfo(ptdev, file->driver_priv, p);
+	panthor_perfcnt_show_fdinfo(file->driver_priv, p);
 	panthor_show_internal_memory_stats(p, file);
 
 	drm_show_memory_stats(p, file);
@@ -1498,7 +1604,10 @@ static const struct file_operations panthor_drm_driver_fops = {
 #ifdef CONFIG_DEBUG_FS
 static void panthor_debugfs_init(struct drm_minor *minor)
 {
+	panthor_device_debugfs_init(minor);
 	panthor_mmu_debugfs_init(minor);
+	panthor_devfreq_debugfs_init(minor);
+	panthor_sched_debugfs_init(minor);
 }
 #endif
 
@@ -1509,6 +1618,8 @@ static void panthor_debugfs_init(struct drm_minor *minor)
  * - 1.2 - adds DEV_QUERY_GROUP_PRIORITIES_INFO query
  *       - adds PANTHOR_GROUP_PRIORITY_REALTIME priority
  * - 1.3 - adds DRM_PANTHOR_GROUP_STATE_INNOCENT flag
+ * - 1.4 - adds DRM_IOCTL_PANTHOR_BO_MADVISE
+ * - 1.5 - adds DRM_IOCTL_PANTHOR_PERFCNT_ENABLE and DRM_IOCTL_PANTHOR_PERFCNT_DUMP
  */
 static const struct drm_driver panthor_drm_driver = {
 	.driver_features = DRIVER_RENDER | DRIVER_GEM | DRIVER_SYNCOBJ |
@@ -1522,7 +1633,7 @@ static const struct drm_driver panthor_drm_driver = {
 	.name = "panthor",
 	.desc = "Panthor DRM driver",
 	.major = 1,
-	.minor = 3,
+	.minor = 5,
 
 	.gem_create_object = panthor_gem_create_object,
 	.gem_prime_import_sg_table = drm_gem_shmem_prime_import_sg_table,
@@ -197,6 +197,9 @@ struct panthor_fw_global_control_iface {
 	u32 output_va;
 	u32 group_num;
 	u32 group_stride;
+
+#define GLB_PERFCNT_HW_SIZE(x)			(((x) & GENMASK(15, 0)) << 8)
+#define GLB_PERFCNT_FW_SIZE(x)			((((x) >> 16) & GENMASK(15, 0)) << 8)
 	u32 perfcnt_size;
 	u32 instr_features;
 };
@@ -240,6 +243,9 @@ struct panthor_fw_global_input_iface {
 	u64 perfcnt_base;
 	u32 perfcnt_extract;
 	u32 reserved3[3];
+
+#define GLB_PERFCNT_CONFIG_SIZE(x)		((x) & GENMASK(7, 0))
+#define GLB_PERFCNT_CONFIG_SET(x)		(((x) << 8) & GENMASK(9, 8))
 	u32 perfcnt_config;
 	u32 perfcnt_csg_select;
 	u32 perfcnt_fw_enable;
@@ -5,18 +5,39 @@
 #include <linux/dma-buf.h>
 #include <linux/dma-mapping.h>
 #include <linux/err.h>
+#include <linux/fs.h>
+#include <linux/module.h>
+#include <linux/mount.h>
 #include <linux/slab.h>
 
+#include <drm/drm_managed.h>
 #include <drm/panthor_drm.h>
 
 #include "panthor_device.h"
 #include "panthor_gem.h"
 #include "panthor_mmu.h"
 
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+static bool transparent_hugepage = true;
+module_param(transparent_hugepage, bool, 0400);
+MODULE_PARM_DESC(transparent_hugepage, "Use a dedicated mountpoint with THP enabled to back BOs (default = true)");
+#endif
+
 static void panthor_gem_free_object(struct drm_gem_object *obj)
 {
 	struct panthor_gem_object *bo = to_panthor_bo(obj);
 	struct drm_gem_object *vm_root_gem = bo->exclusive_vm_root_gem;
+	struct panthor_device *ptdev = container_of(obj->dev, struct panthor_device, base);
+
+	/* Only the reclaim logic can remove the BO from the reclaim list
+	 * behind our back, so it's safe to test for emptiness without the
+	 * lock held.
+	 */
+	if (!list_empty(&bo->base.madv_list)) {
+		mutex_lock(&ptdev->reclaim.lock);
+		list_del(&bo->base.madv_list);
+		mutex_unlock(&ptdev->reclaim.lock);
+	}
 
 	drm_gem_free_mmap_offset(&bo->base.base);
 	mutex_destroy(&bo->gpuva_list_lock);
@@ -87,7 +108,7 @@ panthor_kernel_bo_create(struct panthor_device *ptdev, struct panthor_vm *vm,
 	if (!kbo)
 		return ERR_PTR(-ENOMEM);
 
-	obj = drm_gem_shmem_create(&ptdev->base, size);
+	obj = drm_gem_shmem_create_with_mnt(&ptdev->base, size, ptdev->gemfs);
 	if (IS_ERR(obj)) {
 		ret = PTR_ERR(obj);
 		goto err_free_bo;
@@ -217,11 +238,12 @@ panthor_gem_create_with_handle(struct drm_file *file,
 			       struct panthor_vm *exclusive_vm,
 			       u64 *size, u32 flags, u32 *handle)
 {
+	struct panthor_device *ptdev = container_of(ddev, struct panthor_device, base);
 	int ret;
 	struct drm_gem_shmem_object *shmem;
 	struct panthor_gem_object *bo;
 
-	shmem = drm_gem_shmem_create(ddev, *size);
+	shmem = drm_gem_shmem_create_with_mnt(ddev, *size, ptdev->gemfs);
 	if (IS_ERR(shmem))
 		return PTR_ERR(shmem);
 
@@ -247,3 +269,51 @@ panthor_gem_create_with_handle(struct drm_file *file,
 
 	return ret;
 }
+
+static void panthor_gemfs_fini(struct drm_device *ddev, void *res)
+{
+	struct panthor_device *ptdev = container_of(ddev, struct panthor_device, base);
+
+	kern_unmount(ptdev->gemfs);
+}
+
+/**
+ * panthor_gemfs_init() - Create the shmem mountpoint backing BOs
+ * @ptdev: Device.
+ *
+ * Large BOs backed by huge pages can be mapped with 2M blocks in the GPU page
+ * tables, which greatly reduces the TLB pressure. The default shmem mountpoint
+ * doesn't allocate huge pages unless the system admin asked for it, so we
+ * create our own mountpoint with huge=within_size. The within_size policy
+ * makes sure small BOs keep being backed by regular pages.
+ *
+ * If THP is not available, BOs are allocated from the default mountpoint.
+ *
+ * Return: 0 on success, a negative error code otherwise.
+ */
+int panthor_gemfs_init(struct panthor_device *ptdev)
+{
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+	char huge_opt[] = "huge=within_size";
+	struct file_system_type *type;
+	struct vfsmount *gemfs;
+
+	if (!transparent_hugepage)
+		return 0;
+
+	type = get_fs_type("tmpfs");
+	if (!type)
+		return 0;
+
+	gemfs = vfs_kern_mount(type, SB_KERNMOUNT, type->name, huge_opt);
+	if (IS_ERR(gemfs)) {
+		drm_warn(&ptdev->base, "Failed to create THP mountpoint (%ld)", PTR_ERR(gemfs));
+		return 0;
+	}
+
+	ptdev->gemfs = gemfs;
+	return drmm_add_action_or_reset(&ptdev->base, panthor_gemfs_fini, NULL);
+#else
+	return 0;
+#endif
+}
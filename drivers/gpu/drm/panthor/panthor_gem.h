@@ -11,6 +11,7 @@
 #include <linux/iosys-map.h>
 #include <linux/rwsem.h>
 
+struct panthor_device;
 struct panthor_vm;
 
 /**
@@ -138,4 +139,7 @@ panthor_kernel_bo_create(struct panthor_device *ptdev, struct panthor_vm *vm,
 
 void panthor_kernel_bo_destroy(struct panthor_kernel_bo *bo);
 
+int panthor_gem_shrinker_init(struct panthor_device *ptdev);
+int panthor_gemfs_init(struct panthor_device *ptdev);
+
 #endif /* __PANTHOR_GEM_H__ */
@@ -0,0 +1,251 @@
+// SPDX-License-Identifier: GPL-2.0 or MIT
+/* Copyright 2019 Arm Ltd. */
+/* Copyright 2023 Collabora ltd. */
+
+#include <linux/list.h>
+#include <linux/shrinker.h>
+#include <linux/workqueue.h>
+
+#include <drm/drm_managed.h>
+
+#include "panthor_device.h"
+#include "panthor_gem.h"
+#include "panthor_mmu.h"
+
+static bool panthor_gem_is_gpu_mapped(struct drm_gem_shmem_object *shmem)
+{
+	/* Racy, but the vm_bo list only matters as a hint here: the purge
+	 * logic relies on drm_gem_shmem_is_purgeable() to make the final
+	 * decision, and the vm_bo objects hold a pin reference on the pages.
+	 */
+	return !list_empty(&shmem->base.gpuva.list);
+}
+
+static unsigned long
+panthor_gem_shrinker_count(struct shrinker *shrinker, struct shrink_control *sc)
+{
+	struct panthor_device *ptdev = shrinker->private_data;
+	struct drm_gem_shmem_object *shmem;
+	unsigned long count = 0;
+
+	if (!mutex_trylock(&ptdev->reclaim.lock))
+		return 0;
+
+	/* BOs that are still GPU mapped are accounted too, because they will
+	 * become purgeable once the eviction work has unmapped them.
+	 */
+	list_for_each_entry(shmem, &ptdev->reclaim.list, madv_list) {
+		if (panthor_gem_is_gpu_mapped(shmem) ||
+		    drm_gem_shmem_is_purgeable(shmem))
+			count += shmem->base.size >> PAGE_SHIFT;
+	}
+
+	mutex_unlock(&ptdev->reclaim.lock);
+
+	return count;
+}
+
+static bool panthor_gem_purge(struct drm_gem_shmem_object *shmem)
+{
+	if (!dma_resv_trylock(shmem->base.resv))
+		return false;
+
+	if (!drm_gem_shmem_is_purgeable(shmem)) {
+		dma_resv_unlock(shmem->base.resv);
+		return false;
+	}
+
+	drm_gem_shmem_purge_locked(shmem);
+	dma_resv_unlock(shmem->base.resv);
+	return true;
+}
+
+static unsigned long
+panthor_gem_shrinker_scan(struct shrinker *shrinker, struct shrink_control *sc)
+{
+	struct panthor_device *ptdev = shrinker->private_data;
+	struct drm_gem_shmem_object *shmem, *tmp;
+	unsigned long freed = 0;
+	bool evict = false;
+
+	if (!mutex_trylock(&ptdev->reclaim.lock))
+		return SHRINK_STOP;
+
+	list_for_each_entry_safe(shmem, tmp, &ptdev->reclaim.list, madv_list) {
+		if (freed >= sc->nr_to_scan)
+			break;
+
+		if (panthor_gem_is_gpu_mapped(shmem)) {
+			evict = true;
+			continue;
+		}
+
+		if (panthor_gem_purge(shmem)) {
+			freed += shmem->base.size >> PAGE_SHIFT;
+			list_del_init(&shmem->madv_list);
+		}
+	}
+
+	mutex_unlock(&ptdev->reclaim.lock);
+
+	/* VM operations allocate memory, so we can't unmap BOs from here. Let
+	 * the eviction work do that for us, and purge the BOs afterwards.
+	 */
+	if (evict)
+		queue_work(system_unbound_wq, &ptdev->reclaim.evict_work);
+
+	if (freed > 0)
+		drm_dbg_driver(&ptdev->base, "Purging %lu bytes\n", freed << PAGE_SHIFT);
+
+	return freed;
+}
+
+/* Check that nothing but its GPU mappings prevents the BO from being purged,
+ * so we don't tear down mappings for nothing. Called with the resv held.
+ */
+static bool panthor_gem_is_evictable_locked(struct drm_gem_shmem_object *shmem)
+{
+	struct panthor_gem_object *bo = to_panthor_bo(&shmem->base);
+	struct drm_gpuvm_bo *vm_bo;
+	unsigned int vm_bo_count = 0;
+
+	dma_resv_assert_held(shmem->base.resv);
+
+	/* Imported and exported BOs can't be purged. */
+	if (shmem->madv <= 0 || !shmem->sgt || shmem->vmap_use_count ||
+	    shmem->base.import_attach || shmem->base.dma_buf)
+		return false;
+
+	/* Unmapping a BO that's still in use would cause GPU faults. */
+	if (!dma_resv_test_signaled(shmem->base.resv, DMA_RESV_USAGE_BOOKKEEP))
+		return false;
+
+	/* Each vm_bo holds one pin reference on the pages, any other pin would
+	 * keep the BO from being purged after the eviction.
+	 */
+	mutex_lock(&bo->gpuva_list_lock);
+	drm_gem_for_each_gpuvm_bo(vm_bo, &shmem->base)
+		vm_bo_count++;
+	mutex_unlock(&bo->gpuva_list_lock);
+
+	return refcount_read(&shmem->pages_pin_count) == vm_bo_count;
+}
+
+static struct drm_gem_object *panthor_gem_evict_one(struct panthor_device *ptdev)
+{
+	struct drm_gem_shmem_object *shmem;
+
+	list_for_each_entry(shmem, &ptdev->reclaim.list, madv_list) {
+		bool evictable;
+
+		if (!panthor_gem_is_gpu_mapped(shmem))
+			continue;
+
+		/* The resv can't be held across the eviction, because the
+		 * unmap path takes it to release the pin references. The
+		 * purge below checks the BO again.
+		 */
+		if (!dma_resv_trylock(shmem->base.resv))
+			continue;
+
+		evictable = panthor_gem_is_evictable_locked(shmem);
+		dma_resv_unlock(shmem->base.resv);
+
+		if (!evictable)
+			continue;
+
+		/* The BO is being destroyed, and will be removed from the
+		 * list by panthor_gem_free_object().
+		 */
+		if (!kref_get_unless_zero(&shmem->base.refcount))
+			continue;
+
+		/* Move the BO to the tail, so we don't retry the same BO over
+		 * and over again if the eviction fails.
+		 */
+		list_move_tail(&shmem->madv_list, &ptdev->reclaim.list);
+
+		if (!panthor_vm_evict_bo(to_panthor_bo(&shmem->base)) &&
+		    panthor_gem_purge(shmem))
+			list_del_init(&shmem->madv_list);
+
+		return &shmem->base;
+	}
+
+	return NULL;
+}
+
+static void panthor_gem_evict_work(struct work_struct *work)
+{
+	struct panthor_device *ptdev = container_of(work, struct panthor_device,
+						    reclaim.evict_work);
+	size_t count;
+
+	mutex_lock(&ptdev->reclaim.lock);
+	count = list_count_nodes(&ptdev->reclaim.list);
+	mutex_unlock(&ptdev->reclaim.lock);
+
+	/* Process one BO per iteration, so we don't block madvise requests
+	 * and the shrinker for too long.
+	 */
+	while (count--) {
+		struct drm_gem_object *obj;
+
+		/* The BO stays DONTNEED while the reclaim lock is held, which
+		 * guarantees we never tear down the mappings of a BO userspace
+		 * has just asked to keep.
+		 */
+		mutex_lock(&ptdev->reclaim.lock);
+		obj = panthor_gem_evict_one(ptdev);
+		mutex_unlock(&ptdev->reclaim.lock);
+
+		if (!obj)
+			break;
+
+		/* Drop the reference after releasing the reclaim lock, since
+		 * panthor_gem_free_object() takes it.
+		 */
+		drm_gem_object_put(obj);
+	}
+}
+
+static void panthor_gem_shrinker_release(struct drm_device *ddev, void *res)
+{
+	struct panthor_device *ptdev = container_of(ddev, struct panthor_device, base);
+
+	shrinker_free(ptdev->reclaim.shrinker);
+	cancel_work_sync(&ptdev->reclaim.evict_work);
+}
+
+/**
+ * panthor_gem_shrinker_init() - Initialize the panthor GEM shrinker
+ * @ptdev: Device.
+ *
+ * The shrinker is automatically unregistered when the DRM device is released.
+ *
+ * Return: 0 on success, a negative error code otherwise.
+ */
+int panthor_gem_shrinker_init(struct panthor_device *ptdev)
+{
+	struct shrinker *shrinker;
+	int ret;
+
+	ret = drmm_mutex_init(&ptdev->base, &ptdev->reclaim.lock);
+	if (ret)
+		return ret;
+
+	INIT_LIST_HEAD(&ptdev->reclaim.list);
+	INIT_WORK(&ptdev->reclaim.evict_work, panthor_gem_evict_work);
+
+	shrinker = shrinker_alloc(0, "drm-panthor");
+	if (!shrinker)
+		return -ENOMEM;
+
+	shrinker->count_objects = panthor_gem_shrinker_count;
+	shrinker->scan_objects = panthor_gem_shrinker_scan;
+	shrinker->private_data = ptdev;
+	ptdev->reclaim.shrinker = shrinker;
+	shrinker_register(shrinker);
+
+	return drmm_add_action_or_reset(&ptdev->base, panthor_gem_shrinker_release, NULL);
+}
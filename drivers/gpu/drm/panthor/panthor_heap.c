@@ -3,6 +3,7 @@
 
 #include <linux/iosys-map.h>
 #include <linux/rwsem.h>
+#include <linux/workqueue.h>
 
 #include <drm/panthor_drm.h>
 
@@ -20,6 +21,12 @@
  */
 #define HEAP_CONTEXT_SIZE	32
 
+/*
+ * Number of spare chunks we try to keep around for each heap, so tiler OOM
+ * events can be served without allocating memory.
+ */
+#define HEAP_SPARE_CHUNKS	2
+
 /**
  * struct panthor_heap_chunk_header - Heap chunk header
  */
@@ -50,12 +57,26 @@ struct panthor_heap_chunk {
  * struct panthor_heap - Structure used to manage tiler heap contexts.
  */
 struct panthor_heap {
+	/** @pool: Pool this heap belongs to. */
+	struct panthor_heap_pool *pool;
+
 	/** @chunks: List containing all heap chunks allocated so far. */
 	struct list_head chunks;
 
-	/** @lock: Lock protecting insertion in the chunks list. */
+	/**
+	 * @spare_chunks: List of chunks that are not linked to the heap yet.
+	 *
+	 * These chunks are handed over to the FW on tiler OOM events, instead
+	 * of allocating new chunks when the GPU is waiting for memory.
+	 */
+	struct list_head spare_chunks;
+
+	/** @lock: Lock protecting insertion in the chunks and spare_chunks lists. */
 	struct mutex lock;
 
+	/** @refill_work: Work used to refill the spare_chunks list. */
+	struct work_struct refill_work;
+
 	/** @chunk_size: Size of each chunk. */
 	u32 chunk_size;
 
@@ -70,6 +91,9 @@ struct panthor_heap {
 
 	/** @chunk_count: Number of heap chunks currently allocated. */
 	u32 chunk_count;
+
+	/** @spare_count: Number of chunks in the spare_chunks list. */
+	u32 spare_count;
 };
 
 #define MAX_HEAPS_PER_POOL    128
@@ -121,6 +145,16 @@ static void *panthor_get_heap_ctx(struct panthor_heap_pool *pool, int id)
 	       panthor_get_heap_ctx_offset(pool, id);
 }
 
+static void panthor_destroy_heap_chunk(struct panthor_heap_pool *pool,
+				       struct panthor_heap *heap,
+				       struct panthor_heap_chunk *chunk)
+{
+	atomic_sub(heap->chunk_size, &pool->size);
+
+	panthor_kernel_bo_destroy(chunk->bo);
+	kfree(chunk);
+}
+
 static void panthor_free_heap_chunk(struct panthor_heap_pool *pool,
 				    struct panthor_heap *heap,
 				    struct panthor_heap_chunk *chunk)
@@ -130,23 +164,36 @@ static void panthor_free_heap_chunk(struct panthor_heap_pool *pool,
 	heap->chunk_count--;
 	mutex_unlock(&heap->lock);
 
-	atomic_sub(heap->chunk_size, &pool->size);
+	panthor_destroy_heap_chunk(pool, heap, chunk);
+}
 
-	panthor_kernel_bo_destroy(chunk->bo);
-	kfree(chunk);
+static int panthor_reset_heap_chunk(struct panthor_heap_chunk *chunk, u64 next)
+{
+	struct panthor_heap_chunk_header *hdr;
+	int ret;
+
+	ret = panthor_kernel_bo_vmap(chunk->bo);
+	if (ret)
+		return ret;
+
+	hdr = chunk->bo->kmap;
+	memset(hdr, 0, sizeof(*hdr));
+	hdr->next = next;
+
+	panthor_kernel_bo_vunmap(chunk->bo);
+	return 0;
 }
 
-static int panthor_alloc_heap_chunk(struct panthor_heap_pool *pool,
-				    struct panthor_heap *heap,
-				    bool initial_chunk)
+static struct panthor_heap_chunk *
+panthor_create_heap_chunk(struct panthor_heap_pool *pool,
+			  struct panthor_heap *heap, u64 next)
 {
 	struct panthor_heap_chunk *chunk;
-	struct panthor_heap_chunk_header *hdr;
 	int ret;
 
 	chunk = kmalloc(sizeof(*chunk), GFP_KERNEL);
 	if (!chunk)
-		return -ENOMEM;
+		return ERR_PTR(-ENOMEM);
 
 	chunk->bo = panthor_kernel_bo_create(pool->ptdev, pool->vm, heap->chunk_size,
 					     DRM_PANTHOR_BO_NO_MMAP,
@@ -157,12 +204,28 @@ static int panthor_alloc_heap_chunk(struct panthor_heap_pool *pool,
 		goto err_free_chunk;
 	}
 
-	ret = panthor_kernel_bo_vmap(chunk->bo);
+	ret = panthor_reset_heap_chunk(chunk, next);
 	if (ret)
 		goto err_destroy_bo;
 
-	hdr = chunk->bo->kmap;
-	memset(hdr, 0, sizeof(*hdr));
+	atomic_add(heap->chunk_size, &pool->size);
+	return chunk;
+
+err_destroy_bo:
+	panthor_kernel_bo_destroy(chunk->bo);
+
+err_free_chunk:
+	kfree(chunk);
+
+	return ERR_PTR(ret);
+}
+
+static int panthor_alloc_heap_chunk(struct panthor_heap_pool *pool,
+				    struct panthor_heap *heap,
+				    bool initial_chunk)
+{
+	struct panthor_heap_chunk *chunk;
+	u64 next = 0;
 
 	if (initial_chunk && !list_empty(&heap->chunks)) {
 		struct panthor_heap_chunk *prev_chunk;
@@ -173,28 +236,58 @@ static int panthor_alloc_heap_chunk(struct panthor_heap_pool *pool,
 					      node);
 
 		prev_gpuva = panthor_kernel_bo_gpuva(prev_chunk->bo);
-		hdr->next = (prev_gpuva & GENMASK_ULL(63, 12)) |
-			    (heap->chunk_size >> 12);
+		next = (prev_gpuva & GENMASK_ULL(63, 12)) |
+		       (heap->chunk_size >> 12);
 	}
 
-	panthor_kernel_bo_vunmap(chunk->bo);
+	chunk = panthor_create_heap_chunk(pool, heap, next);
+	if (IS_ERR(chunk))
+		return PTR_ERR(chunk);
 
 	mutex_lock(&heap->lock);
 	list_add(&chunk->node, &heap->chunks);
 	heap->chunk_count++;
 	mutex_unlock(&heap->lock);
 
-	atomic_add(heap->chunk_size, &pool->size);
-
 	return 0;
+}
 
-err_destroy_bo:
-	panthor_kernel_bo_destroy(chunk->bo);
+static bool panthor_heap_needs_spare_chunk(struct panthor_heap *heap)
+{
+	lockdep_assert_held(&heap->lock);
 
-err_free_chunk:
-	kfree(chunk);
+	return heap->spare_count < HEAP_SPARE_CHUNKS &&
+	       heap->chunk_count + heap->spare_count < heap->max_chunks;
+}
 
-	return ret;
+static void panthor_heap_refill_work(struct work_struct *work)
+{
+	struct panthor_heap *heap = container_of(work, struct panthor_heap, refill_work);
+	struct panthor_heap_pool *pool = heap->pool;
+
+	for (;;) {
+		struct panthor_heap_chunk *chunk;
+		bool needed;
+
+		mutex_lock(&heap->lock);
+		needed = panthor_heap_needs_spare_chunk(heap);
+		mutex_unlock(&heap->lock);
+
+		if (!needed)
+			break;
+
+		/* If the allocation fails, we'll retry on the next tiler OOM
+		 * event, which will go through the slow path anyway.
+		 */
+		chunk = panthor_create_heap_chunk(pool, heap, 0);
+		if (IS_ERR(chunk))
+			break;
+
+		mutex_lock(&heap->lock);
+		list_add(&chunk->node, &heap->spare_chunks);
+		heap->spare_count++;
+		mutex_unlock(&heap->lock);
+	}
 }
 
 static void panthor_free_heap_chunks(struct panthor_heap_pool *pool,
@@ -204,6 +297,12 @@ static void panthor_free_heap_chunks(struct panthor_heap_pool *pool,
 
 	list_for_each_entry_safe(chunk, tmp, &heap->chunks, node)
 		panthor_free_heap_chunk(pool, heap, chunk);
+
+	list_for_each_entry_safe(chunk, tmp, &heap->spare_chunks, node) {
+		list_del(&chunk->node);
+		heap->spare_count--;
+		panthor_destroy_heap_chunk(pool, heap, chunk);
+	}
 }
 
 static int panthor_alloc_heap_chunks(struct panthor_heap_pool *pool,
@@ -231,6 +330,7 @@ panthor_heap_destroy_locked(struct panthor_heap_pool *pool, u32 handle)
 	if (!heap)
 		return -EINVAL;
 
+	cancel_work_sync(&heap->refill_work);
 	panthor_free_heap_chunks(pool, heap);
 	mutex_destroy(&heap->lock);
 	kfree(heap);
@@ -309,6 +409,9 @@ int panthor_heap_create(struct panthor_heap_pool *pool,
 
 	mutex_init(&heap->lock);
 	INIT_LIST_HEAD(&heap->chunks);
+	INIT_LIST_HEAD(&heap->spare_chunks);
+	INIT_WORK(&heap->refill_work, panthor_heap_refill_work);
+	heap->pool = pool;
 	heap->chunk_size = chunk_size;
 	heap->max_chunks = max_chunks;
 	heap->target_in_flight = target_in_flight;
@@ -342,6 +445,11 @@ int panthor_heap_create(struct panthor_heap_pool *pool,
 	if (ret)
 		goto err_free_heap;
 
+	/* Pre-allocate spare chunks so the first tiler OOM events don't have
+	 * to wait for an allocation.
+	 */
+	queue_work(system_unbound_wq, &heap->refill_work);
+
 	panthor_vm_put(vm);
 	return id;
 
@@ -393,19 +501,33 @@ int panthor_heap_return_chunk(struct panthor_heap_pool *pool,
 			removed = chunk;
 			list_del(&chunk->node);
 			heap->chunk_count--;
-			atomic_sub(heap->chunk_size, &pool->size);
 			break;
 		}
 	}
 	mutex_unlock(&heap->lock);
 
-	if (removed) {
-		panthor_kernel_bo_destroy(chunk->bo);
-		kfree(chunk);
-		ret = 0;
-	} else {
+	if (!removed) {
 		ret = -EINVAL;
+		goto out_unlock;
+	}
+
+	/* The chunk was never linked to the heap context, so the GPU never
+	 * used it. Put it back in the spare list instead of freeing it, so
+	 * the next tiler OOM event can be served without allocating memory.
+	 */
+	ret = panthor_reset_heap_chunk(removed, 0);
+	mutex_lock(&heap->lock);
+	if (!ret && heap->spare_count < HEAP_SPARE_CHUNKS) {
+		list_add(&removed->node, &heap->spare_chunks);
+		heap->spare_count++;
+		removed = NULL;
 	}
+	mutex_unlock(&heap->lock);
+
+	if (removed)
+		panthor_destroy_heap_chunk(pool, heap, removed);
+
+	ret = 0;
 
 out_unlock:
 	up_read(&pool->lock);
@@ -460,24 +582,43 @@ int panthor_heap_grow(struct panthor_heap_pool *pool,
 		goto out_unlock;
 	}
 
-	/* FIXME: panthor_alloc_heap_chunk() triggers a kernel BO creation,
-	 * which goes through the blocking allocation path. Ultimately, we
-	 * want a non-blocking allocation, so we can immediately report to the
-	 * FW when the system is running out of memory. In that case, the FW
-	 * can call a user-provided exception handler, which might try to free
-	 * some tiler memory by issuing an intermediate fragment job. If the
-	 * exception handler can't do anything, it will flag the queue as
-	 * faulty so the job that triggered this tiler chunk allocation and all
-	 * further jobs in this queue fail immediately instead of having to
-	 * wait for the job timeout.
+	/* Fast path: hand over one of the spare chunks, and let the refill
+	 * work replace it.
 	 */
-	ret = panthor_alloc_heap_chunk(pool, heap, false);
-	if (ret)
-		goto out_unlock;
+	mutex_lock(&heap->lock);
+	chunk = list_first_entry_or_null(&heap->spare_chunks,
+					 struct panthor_heap_chunk,
+					 node);
+	if (chunk) {
+		list_move(&chunk->node, &heap->chunks);
+		heap->spare_count--;
+		heap->chunk_count++;
+	}
+	mutex_unlock(&heap->lock);
+
+	if (!chunk) {
+		/* FIXME: panthor_alloc_heap_chunk() triggers a kernel BO
+		 * creation, which goes through the blocking allocation path.
+		 * Ultimately, we want a non-blocking allocation, so we can
+		 * immediately report to the FW when the system is running out
+		 * of memory. In that case, the FW can call a user-provided
+		 * exception handler, which might try to free some tiler memory
+		 * by issuing an intermediate fragment job. If the exception
+		 * handler can't do anything, it will flag the queue as faulty
+		 * so the job that triggered this tiler chunk allocation and all
+		 * further jobs in this queue fail immediately instead of having
+		 * to wait for the job timeout.
+		 */
+		ret = panthor_alloc_heap_chunk(pool, heap, false);
+		if (ret)
+			goto out_unlock;
+
+		chunk = list_first_entry(&heap->chunks,
+					 struct panthor_heap_chunk,
+					 node);
+	}
 
-	chunk = list_first_entry(&heap->chunks,
-				 struct panthor_heap_chunk,
-				 node);
+	queue_work(system_unbound_wq, &heap->refill_work);
 	*new_chunk_gpu_va = (panthor_kernel_bo_gpuva(chunk->bo) & GENMASK_ULL(63, 12)) |
 			    (heap->chunk_size >> 12);
 	ret = 0;
@@ -347,6 +347,21 @@ struct panthor_vm {
 		struct mutex lock;
 	} heaps;
 
+	/**
+	 * @mapped: Amount of memory mapped to this VM, split by page size.
+	 *
+	 * Updated when pages are mapped/unmapped, and reported through
+	 * fdinfo so userspace can check how much of its memory ends up
+	 * mapped with 2M blocks.
+	 */
+	struct {
+		/** @mapped.small: Memory mapped with 4k pages. */
+		atomic64_t small;
+
+		/** @mapped.huge: Memory mapped with 2M blocks. */
+		atomic64_t huge;
+	} mapped;
+
 	/** @node: Used to insert the VM in the panthor_mmu::vm::list. */
 	struct list_head node;
 
@@ -906,7 +921,61 @@ int panthor_vm_flush_all(struct panthor_vm *vm)
 	return panthor_vm_flush_range(vm, vm->base.mm_start, vm->base.mm_range);
 }
 
-static int panthor_vm_unmap_pages(struct panthor_vm *vm, u64 iova, u64 size)
+static bool panthor_vm_is_block_mapped(struct panthor_vm *vm, u64 iova)
+{
+	struct io_pgtable_ops *ops = vm->pgtbl_ops;
+	struct arm_lpae_io_pgtable_walk_data wd = {};
+
+	if (!ops->pgtable_walk || ops->pgtable_walk(ops, iova, &wd))
+		return false;
+
+	/* A leaf at level 2 is a 2M block, a leaf at level 3 a 4k page. */
+	return wd.ptes[2] && !wd.ptes[3];
+}
+
+/* Number of bytes mapped with 4k pages in the level 3 table covering @iova */
+static u64 panthor_vm_small_mapped_in_block(struct panthor_vm *vm, u64 iova)
+{
+	struct io_pgtable_ops *ops = vm->pgtbl_ops;
+	u64 mapped = 0;
+
+	for (u64 offset = 0; offset < SZ_2M; offset += SZ_4K) {
+		if (ops->iova_to_phys(ops, iova + offset))
+			mapped += SZ_4K;
+	}
+
+	return mapped;
+}
+
+static void panthor_vm_account_unmap(struct panthor_vm *vm, u64 iova,
+				     size_t pgsize, size_t pgcount)
+{
+	size_t size = pgsize * pgcount;
+
+	/* Unmapping with a 2M granularity a region that was mapped with 4k
+	 * pages is fine, io-pgtable drops the whole level 3 table. The table
+	 * isn't necessarily full though, so only count the pages actually
+	 * released.
+	 */
+	if (pgsize == SZ_2M) {
+		for (size_t i = 0; i < pgcount; i++, iova += SZ_2M) {
+			if (panthor_vm_is_block_mapped(vm, iova))
+				atomic64_sub(SZ_2M, &vm->mapped.huge);
+			else
+				atomic64_sub(panthor_vm_small_mapped_in_block(vm, iova),
+					     &vm->mapped.small);
+		}
+		return;
+	}
+
+	/* Blocks are never unmapped partially, see
+	 * panthor_gpuva_sm_step_remap().
+	 */
+	atomic64_sub(size, &vm->mapped.small);
+}
+
+/* Unmap a range without flushing the MMU, the caller has to do it. */
+static int __panthor_vm_unmap_pages(struct panthor_vm *vm, u64 iova, u64 size)
 {
 	struct panthor_device *ptdev = vm->ptdev;
 	struct io_pgtable_ops *ops = vm->pgtbl_ops;
@@ -918,6 +987,10 @@ static int panthor_vm_unmap_pages(struct panthor_vm *vm, u64 iova, u64 size)
 		size_t unmapped_sz = 0, pgcount;
 		size_t pgsize = get_pgsize(iova + offset, size - offset, &pgcount);
 
+		/* This must be done before the pages are unmapped, since we
+		 * walk the page table to find the current mapping granularity.
+		 */
+		panthor_vm_account_unmap(vm, iova + offset, pgsize, pgcount);
 		unmapped_sz = ops->unmap_pages(ops, iova + offset, pgsize, pgcount, NULL);
 
 		if (drm_WARN_ON(&ptdev->base, unmapped_sz != pgsize * pgcount)) {
@@ -925,18 +998,28 @@ static int panthor_vm_unmap_pages(struct panthor_vm *vm, u64 iova, u64 size)
 				iova + offset + unmapped_sz,
 				iova + offset + pgsize * pgcount,
 				iova, iova + size);
-			panthor_vm_flush_range(vm, iova, offset + unmapped_sz);
 			return  -EINVAL;
 		}
 		offset += unmapped_sz;
 	}
 
-	return panthor_vm_flush_range(vm, iova, size);
+	return 0;
 }
 
+static int panthor_vm_unmap_pages(struct panthor_vm *vm, u64 iova, u64 size)
+{
+	int ret = __panthor_vm_unmap_pages(vm, iova, size);
+	int flush_ret;
+
+	/* Flush what was unmapped, even if only part of the range was */
+	flush_ret = panthor_vm_flush_range(vm, iova, size);
+	return ret ?: flush_ret;
+}
+
+/* Map a range without flushing the MMU, the caller has to do it. */
 static int
-panthor_vm_map_pages(struct panthor_vm *vm, u64 iova, int prot,
-		     struct sg_table *sgt, u64 offset, u64 size)
+__panthor_vm_map_pages(struct panthor_vm *vm, u64 iova, int prot,
+		       struct sg_table *sgt, u64 offset, u64 size)
 {
 	struct panthor_device *ptdev = vm->ptdev;
 	unsigned int count;
@@ -971,6 +1054,8 @@ panthor_vm_map_pages(struct panthor_vm *vm, u64 iova, int prot,
 
 			ret = ops->map_pages(ops, iova, paddr, pgsize, pgcount, prot,
 					     GFP_KERNEL, &mapped);
+			atomic64_add(mapped, pgsize == SZ_2M ? &vm->mapped.huge :
+							       &vm->mapped.small);
 			iova += mapped;
 			paddr += mapped;
 			len -= mapped;
@@ -983,8 +1068,8 @@ panthor_vm_map_pages(struct panthor_vm *vm, u64 iova, int prot,
 				 * returning. The unmap call is not supposed to fail.
 				 */
 				drm_WARN_ON(&ptdev->base,
-					    panthor_vm_unmap_pages(vm, start_iova,
-								   iova - start_iova));
+					    __panthor_vm_unmap_pages(vm, start_iova,
+								     iova - start_iova));
 				return ret;
 			}
 		}
@@ -995,7 +1080,77 @@ panthor_vm_map_pages(struct panthor_vm *vm, u64 iova, int prot,
 		offset = 0;
 	}
 
-	return panthor_vm_flush_range(vm, start_iova, iova - start_iova);
+	return 0;
+}
+
+static int
+panthor_vm_map_pages(struct panthor_vm *vm, u64 iova, int prot,
+		     struct sg_table *sgt, u64 offset, u64 size)
+{
+	int ret;
+
+	if (!size)
+		return 0;
+
+	ret = __panthor_vm_map_pages(vm, iova, prot, sgt, offset, size);
+	if (ret) {
+		/* Flush the unmapping of what had been mapped */
+		panthor_vm_flush_range(vm, iova, size);
+		return ret;
+	}
+
+	return panthor_vm_flush_range(vm, iova, size);
+}
+
+/*
+ * Replace the 2M blocks of [start, end) by the 4k pages of its parts outside
+ * [unmap_start, unmap_end). The region is locked in the MMU across the
+ * update, so that the GPU waits for the pages that stay instead of faulting
+ * on them while they are unmapped. The page tables needed for the 4k pages
+ * are preallocated, no allocation happens with the AS slots lock held.
+ */
+static int panthor_vm_split_blocks(struct panthor_vm *vm, struct drm_gpuva *va,
+				   int prot, u64 start, u64 end,
+				   u64 unmap_start, u64 unmap_end)
+{
+	struct panthor_gem_object *bo = to_panthor_bo(va->gem.obj);
+	struct panthor_device *ptdev = vm->ptdev;
+	int ret, flush_ret, cookie;
+	bool hw;
+
+	if (drm_WARN_ON(&ptdev->base, !bo->base.sgt))
+		return -EINVAL;
+
+	mutex_lock(&ptdev->mmu->as.slots_lock);
+
+	/* If the device is unplugged, the page tables are updated alone. */
+	hw = vm->as.id >= 0 && drm_dev_enter(&ptdev->base, &cookie);
+	if (hw)
+		lock_region(ptdev, vm->as.id, start, end - start);
+
+	ret = __panthor_vm_unmap_pages(vm, start, end - start);
+	if (!ret && unmap_start != start)
+		ret = __panthor_vm_map_pages(vm, start, prot, bo->base.sgt,
+					     va->gem.offset + start - va->va.addr,
+					     unmap_start - start);
+	if (!ret && unmap_end != end)
+		ret = __panthor_vm_map_pages(vm, unmap_end, prot, bo->base.sgt,
+					     va->gem.offset + unmap_end - va->va.addr,
+					     end - unmap_end);
+
+	if (hw) {
+		/* Flushing the page tables also unlocks the region */
+		flush_ret = mmu_hw_do_operation_locked(ptdev, vm->as.id, start,
+						       end - start,
+						       AS_COMMAND_FLUSH_PT);
+		drm_dev_exit(cookie);
+		if (!ret)
+			ret = flush_ret;
+	}
+
+	mutex_unlock(&ptdev->mmu->as.slots_lock);
+
+	return ret;
 }
 
 static int flags_to_prot(u32 flags)
@@ -1971,6 +2126,32 @@ void panthor_vm_heaps_sizes(struct panthor_file *pfile, struct drm_memory_stats
 	xa_unlock(&pfile->vms->xa);
 }
 
+/**
+ * panthor_vm_mapped_sizes() - Calculate the amount of memory mapped with each
+ * page size over all the VMs of a file
+ * @pfile: File.
+ * @small: Memory mapped with 4k pages.
+ * @huge: Memory mapped with 2M blocks.
+ */
+void panthor_vm_mapped_sizes(struct panthor_file *pfile, u64 *small, u64 *huge)
+{
+	struct panthor_vm *vm;
+	unsigned long i;
+
+	*small = 0;
+	*huge = 0;
+
+	if (!pfile->vms)
+		return;
+
+	xa_lock(&pfile->vms->xa);
+	xa_for_each(&pfile->vms->xa, i, vm) {
+		*small += atomic64_read(&vm->mapped.small);
+		*huge += atomic64_read(&vm->mapped.huge);
+	}
+	xa_unlock(&pfile->vms->xa);
+}
+
 static u64 mair_to_memattr(u64 mair, bool coherent)
 {
 	u64 memattr = 0;
@@ -2088,11 +2269,33 @@ static int panthor_gpuva_sm_step_remap(struct drm_gpuva_op *op,
 	struct panthor_vm *vm = priv;
 	struct panthor_vm_op_ctx *op_ctx = vm->op_ctx;
 	struct panthor_vma *prev_vma = NULL, *next_vma = NULL;
-	u64 unmap_start, unmap_range;
+	struct drm_gpuva *va = op->remap.unmap->va;
+	u64 unmap_start, unmap_range, unmap_end, start, end;
 	int ret;
 
 	drm_gpuva_op_remap_to_unmap_range(&op->remap, &unmap_start, &unmap_range);
-	ret = panthor_vm_unmap_pages(vm, unmap_start, unmap_range);
+	unmap_end = unmap_start + unmap_range;
+
+	/* io-pgtable can't split a 2M block. If the range boundaries fall in
+	 * the middle of one, unmap the whole block, and map back the part
+	 * that stays with 4k pages. A block is only used when the VMA covers
+	 * it entirely, so the extended range never leaves the VMA.
+	 */
+	start = unmap_start;
+	if (op->remap.prev && !IS_ALIGNED(unmap_start, SZ_2M) &&
+	    panthor_vm_is_block_mapped(vm, unmap_start))
+		start = ALIGN_DOWN(unmap_start, SZ_2M);
+
+	end = unmap_end;
+	if (op->remap.next && !IS_ALIGNED(unmap_end, SZ_2M) &&
+	    panthor_vm_is_block_mapped(vm, unmap_end))
+		end = ALIGN(unmap_end, SZ_2M);
+
+	if (start != unmap_start || end != unmap_end)
+		ret = panthor_vm_split_blocks(vm, va, flags_to_prot(unmap_vma->flags),
+					      start, end, unmap_start, unmap_end);
+	else
+		ret = panthor_vm_unmap_pages(vm, start, end - start);
 	if (ret)
 		return ret;
 
@@ -2673,6 +2876,82 @@ int panthor_vm_unmap_range(struct panthor_vm *vm, u64 va, u64 size)
 	return ret;
 }
 
+static int panthor_vm_evict_range(struct panthor_vm *vm, struct drm_gem_object *obj,
+				  u64 va, u64 size)
+{
+	struct panthor_vm_op_ctx op_ctx;
+	struct drm_gpuva *gpuva;
+	int ret;
+
+	ret = panthor_vm_prepare_unmap_op_ctx(&op_ctx, vm, va, size);
+	if (ret)
+		return ret;
+
+	/* The mapping might have been replaced between the time we looked it
+	 * up and the time we acquired the op_lock. Only unmap it if it's still
+	 * pointing to our BO.
+	 */
+	mutex_lock(&vm->op_lock);
+	gpuva = drm_gpuva_find(&vm->base, va, size);
+	if (gpuva && gpuva->gem.obj == obj) {
+		vm->op_ctx = &op_ctx;
+		ret = drm_gpuvm_sm_unmap(&vm->base, vm, va, size);
+		vm->op_ctx = NULL;
+	}
+	mutex_unlock(&vm->op_lock);
+
+	panthor_vm_cleanup_op_ctx(&op_ctx, vm);
+	return ret;
+}
+
+/**
+ * panthor_vm_evict_bo() - Unmap a BO from all the VMs it's mapped to
+ * @bo: BO to evict.
+ *
+ * GPU mappings hold a pin reference on the BO pages. This is used by the
+ * reclaim logic to drop those references on BOs that were marked
+ * DRM_PANTHOR_BO_MADV_DONTNEED, so they can be purged.
+ *
+ * The caller must hold a reference to the BO, and make sure it's idle.
+ *
+ * Return: 0 on success, a negative error code otherwise.
+ */
+int panthor_vm_evict_bo(struct panthor_gem_object *bo)
+{
+	struct drm_gem_object *obj = &bo->base.base;
+	int ret = 0;
+
+	while (!ret) {
+		struct panthor_vm *vm = NULL;
+		struct drm_gpuvm_bo *vm_bo;
+		u64 va = 0, size = 0;
+
+		mutex_lock(&bo->gpuva_list_lock);
+		drm_gem_for_each_gpuvm_bo(vm_bo, obj) {
+			struct drm_gpuva *gpuva;
+
+			gpuva = list_first_entry_or_null(&vm_bo->list.gpuva,
+							 struct drm_gpuva, gem.entry);
+			if (gpuva) {
+				vm = container_of(vm_bo->vm, struct panthor_vm, base);
+				panthor_vm_get(vm);
+				va = gpuva->va.addr;
+				size = gpuva->va.range;
+				break;
+			}
+		}
+		mutex_unlock(&bo->gpuva_list_lock);
+
+		if (!vm)
+			break;
+
+		ret = panthor_vm_evict_range(vm, obj, va, size);
+		panthor_vm_put(vm);
+	}
+
+	return ret;
+}
+
 /**
  * panthor_vm_prepare_mapped_bos_resvs() - Prepare resvs on VM BOs.
  * @exec: Locking/preparation context.
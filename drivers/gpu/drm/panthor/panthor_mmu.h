@@ -26,6 +26,7 @@ void panthor_mmu_resume(struct panthor_device *ptdev);
 int panthor_vm_map_bo_range(struct panthor_vm *vm, struct panthor_gem_object *bo,
 			    u64 offset, u64 size, u64 va, u32 flags);
 int panthor_vm_unmap_range(struct panthor_vm *vm, u64 va, u64 size);
+int panthor_vm_evict_bo(struct panthor_gem_object *bo);
 struct panthor_gem_object *
 panthor_vm_get_bo_for_va(struct panthor_vm *vm, u64 va, u64 *bo_offset);
 
@@ -39,6 +40,7 @@ struct panthor_heap_pool *
 panthor_vm_get_heap_pool(struct panthor_vm *vm, bool create);
 
 void panthor_vm_heaps_sizes(struct panthor_file *pfile, struct drm_memory_stats *stats);
+void panthor_vm_mapped_sizes(struct panthor_file *pfile, u64 *small, u64 *huge);
 
 struct panthor_vm *panthor_vm_get(struct panthor_vm *vm);
 void panthor_vm_put(struct panthor_vm *vm);
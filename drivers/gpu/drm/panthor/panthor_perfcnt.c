@@ -0,0 +1,406 @@
+// SPDX-License-Identifier: GPL-2.0 or MIT
+
+#include <linux/atomic.h>
+#include <linux/log2.h>
+#include <linux/mutex.h>
+#include <linux/pm_runtime.h>
+#include <linux/uaccess.h>
+
+#include <drm/drm_drv.h>
+#include <drm/drm_managed.h>
+#include <drm/drm_print.h>
+#include <drm/panthor_drm.h>
+
+#include "panthor_device.h"
+#include "panthor_fw.h"
+#include "panthor_gem.h"
+#include "panthor_mmu.h"
+#include "panthor_perfcnt.h"
+#include "panthor_regs.h"
+
+/**
+ * DOC: Performance counters
+ *
+ * The CSF FW samples the GPU hardware counters into a ring buffer mapped in
+ * the MCU VM. A sample is taken each time GLB_PERFCNT_SAMPLE is toggled, and
+ * the FW advances perfcnt_insert once the sample has landed. We advance
+ * perfcnt_extract when samples have been copied to userspace.
+ *
+ * Sampling is global: all front-end, tiler, memory system and shader core
+ * blocks are enabled, and only one file can own the counters at a time.
+ * Samples are passed to userspace raw. Their block layout depends on the GPU
+ * configuration reported by DRM_PANTHOR_DEV_QUERY_GPU_INFO, and decoding it
+ * is left to userspace.
+ */
+
+#define PERFCNT_DEFAULT_RING_SIZE	32
+#define PERFCNT_MAX_RING_SIZE		128
+#define PERFCNT_MAX_COUNTER_SET		2
+#define PERFCNT_SAMPLE_TIMEOUT_MS	100
+
+/* The MCU VM is always bound to AS 0. */
+#define PERFCNT_MCU_AS			0
+
+/**
+ * struct panthor_perfcnt - Performance counter management data
+ */
+struct panthor_perfcnt {
+	/** @lock: Lock protecting all fields except @fw_reset. */
+	struct mutex lock;
+
+	/** @user: File owning the counters. NULL if counters are disabled. */
+	struct panthor_file *user;
+
+	/** @ringbuf: Ring buffer the FW writes samples to. */
+	struct panthor_kernel_bo *ringbuf;
+
+	/** @ring_size: Number of samples @ringbuf can hold. Power of two. */
+	u32 ring_size;
+
+	/** @sample_size: Size of a sample, in bytes. */
+	u32 sample_size;
+
+	/** @counter_set: Counter set selected at enable time. */
+	u32 counter_set;
+
+	/** @extract: Index of the next sample to pass to userspace. */
+	u32 extract;
+
+	/** @status: DRM_PANTHOR_PERFCNT_STATUS_xxx flags to report on the next dump. */
+	u32 status;
+
+	/** @samples: Number of samples passed to userspace since counters were enabled. */
+	u64 samples;
+
+	/**
+	 * @fw_reset: Set when the FW was re-initialized and the sampler must be
+	 * re-armed.
+	 *
+	 * Set from the reset/resume path, which can't take @lock.
+	 */
+	atomic_t fw_reset;
+};
+
+static u32 panthor_perfcnt_sample_size(struct panthor_device *ptdev)
+{
+	struct panthor_fw_global_iface *glb_iface = panthor_fw_get_glb_iface(ptdev);
+	u32 size = glb_iface->control->perfcnt_size;
+
+	return GLB_PERFCNT_HW_SIZE(size) + GLB_PERFCNT_FW_SIZE(size);
+}
+
+static void panthor_perfcnt_arm_locked(struct panthor_device *ptdev)
+{
+	struct panthor_fw_global_iface *glb_iface = panthor_fw_get_glb_iface(ptdev);
+	struct panthor_perfcnt *perfcnt = ptdev->perfcnt;
+
+	lockdep_assert_held(&perfcnt->lock);
+
+	perfcnt->extract = 0;
+
+	glb_iface->input->perfcnt_as = PERFCNT_MCU_AS;
+	glb_iface->input->perfcnt_base = panthor_kernel_bo_gpuva(perfcnt->ringbuf);
+	glb_iface->input->perfcnt_extract = 0;
+	glb_iface->input->perfcnt_config = GLB_PERFCNT_CONFIG_SIZE(perfcnt->ring_size) |
+					   GLB_PERFCNT_CONFIG_SET(perfcnt->counter_set);
+	glb_iface->input->perfcnt_csg_select = 0;
+	glb_iface->input->perfcnt_fw_enable = 0;
+	glb_iface->input->perfcnt_csg_enable = 0;
+	glb_iface->input->perfcnt_csf_enable = ~0;
+	glb_iface->input->perfcnt_shader_enable = ~0;
+	glb_iface->input->perfcnt_tiler_enable = ~0;
+	glb_iface->input->perfcnt_mmu_l2_enable = ~0;
+
+	panthor_fw_update_reqs(glb_iface, req, GLB_PERFCNT_EN, GLB_PERFCNT_EN);
+	gpu_write(ptdev, CSF_DOORBELL(CSF_GLB_DOORBELL_ID), 1);
+}
+
+static void panthor_perfcnt_stop_locked(struct panthor_device *ptdev)
+{
+	struct panthor_fw_global_iface *glb_iface = panthor_fw_get_glb_iface(ptdev);
+	struct panthor_perfcnt *perfcnt = ptdev->perfcnt;
+	int cookie;
+
+	lockdep_assert_held(&perfcnt->lock);
+
+	/* No sample can be in flight at this point: samples are only
+	 * requested from panthor_perfcnt_dump(), which waits for the FW
+	 * to acknowledge them before dropping the lock.
+	 */
+	if (drm_dev_enter(&ptdev->base, &cookie)) {
+		panthor_fw_update_reqs(glb_iface, req, 0, GLB_PERFCNT_EN);
+		gpu_write(ptdev, CSF_DOORBELL(CSF_GLB_DOORBELL_ID), 1);
+		drm_dev_exit(cookie);
+	}
+
+	panthor_kernel_bo_destroy(perfcnt->ringbuf);
+	perfcnt->ringbuf = NULL;
+	perfcnt->user = NULL;
+
+	pm_runtime_mark_last_busy(ptdev->base.dev);
+	pm_runtime_put_autosuspend(ptdev->base.dev);
+}
+
+static int panthor_perfcnt_start_locked(struct panthor_file *pfile,
+					struct drm_panthor_perfcnt_enable *args)
+{
+	struct panthor_device *ptdev = pfile->ptdev;
+	struct panthor_perfcnt *perfcnt = ptdev->perfcnt;
+	u32 ring_size = args->ring_size ?: PERFCNT_DEFAULT_RING_SIZE;
+	struct panthor_kernel_bo *ringbuf;
+	u32 sample_size;
+	int ret;
+
+	lockdep_assert_held(&perfcnt->lock);
+
+	if (!is_power_of_2(ring_size) || ring_size > PERFCNT_MAX_RING_SIZE ||
+	    args->counter_set > PERFCNT_MAX_COUNTER_SET)
+		return -EINVAL;
+
+	if (perfcnt->user)
+		return -EBUSY;
+
+	sample_size = panthor_perfcnt_sample_size(ptdev);
+	if (!sample_size)
+		return -EOPNOTSUPP;
+
+	/* Keep the GPU powered while counters are enabled, so samples don't
+	 * miss the activity that happened before an autosuspend.
+	 */
+	ret = pm_runtime_resume_and_get(ptdev->base.dev);
+	if (ret)
+		return ret;
+
+	ringbuf = panthor_kernel_bo_create(ptdev, panthor_fw_vm(ptdev),
+					   sample_size * ring_size,
+					   DRM_PANTHOR_BO_NO_MMAP,
+					   DRM_PANTHOR_VM_BIND_OP_MAP_NOEXEC |
+					   DRM_PANTHOR_VM_BIND_OP_MAP_UNCACHED,
+					   PANTHOR_VM_KERNEL_AUTO_VA);
+	if (IS_ERR(ringbuf)) {
+		ret = PTR_ERR(ringbuf);
+		goto err_put_pm;
+	}
+
+	ret = panthor_kernel_bo_vmap(ringbuf);
+	if (ret)
+		goto err_destroy_ringbuf;
+
+	perfcnt->ringbuf = ringbuf;
+	perfcnt->ring_size = ring_size;
+	perfcnt->sample_size = sample_size;
+	perfcnt->counter_set = args->counter_set;
+	perfcnt->status = 0;
+	perfcnt->samples = 0;
+	perfcnt->user = pfile;
+	atomic_set(&perfcnt->fw_reset, 0);
+
+	panthor_perfcnt_arm_locked(ptdev);
+
+	args->sample_size = sample_size;
+	return 0;
+
+err_destroy_ringbuf:
+	panthor_kernel_bo_destroy(ringbuf);
+
+err_put_pm:
+	pm_runtime_put_autosuspend(ptdev->base.dev);
+	return ret;
+}
+
+/**
+ * panthor_perfcnt_enable() - Enable or disable performance counters
+ * @pfile: File requesting the change.
+ * @args: Arguments passed to DRM_IOCTL_PANTHOR_PERFCNT_ENABLE.
+ *
+ * Return: 0 on success, a negative error code otherwise.
+ */
+int panthor_perfcnt_enable(struct panthor_file *pfile,
+			   struct drm_panthor_perfcnt_enable *args)
+{
+	struct panthor_device *ptdev = pfile->ptdev;
+	struct panthor_perfcnt *perfcnt = ptdev->perfcnt;
+	int ret = 0;
+
+	mutex_lock(&perfcnt->lock);
+	if (args->enable) {
+		ret = panthor_perfcnt_start_locked(pfile, args);
+	} else if (perfcnt->user == pfile) {
+		panthor_perfcnt_stop_locked(ptdev);
+	} else {
+		ret = -EINVAL;
+	}
+	mutex_unlock(&perfcnt->lock);
+
+	return ret;
+}
+
+static int panthor_perfcnt_dump_locked(struct panthor_device *ptdev,
+				       struct drm_panthor_perfcnt_dump *args)
+{
+	struct panthor_fw_global_iface *glb_iface = panthor_fw_get_glb_iface(ptdev);
+	struct panthor_perfcnt *perfcnt = ptdev->perfcnt;
+	void __user *ubuf = u64_to_user_ptr(args->buf_ptr);
+	u32 insert, avail, count, i;
+	int ret;
+
+	lockdep_assert_held(&perfcnt->lock);
+
+	if (panthor_device_reset_is_pending(ptdev))
+		return -EAGAIN;
+
+	/* The FW was re-initialized, everything in the ring buffer is lost. */
+	if (atomic_xchg(&perfcnt->fw_reset, 0)) {
+		perfcnt->status |= DRM_PANTHOR_PERFCNT_STATUS_LOST;
+		panthor_perfcnt_arm_locked(ptdev);
+	}
+
+	if (!(args->flags & DRM_PANTHOR_PERFCNT_DUMP_NO_SAMPLE)) {
+		u32 acked;
+
+		panthor_fw_toggle_reqs(glb_iface, req, ack, GLB_PERFCNT_SAMPLE);
+		gpu_write(ptdev, CSF_DOORBELL(CSF_GLB_DOORBELL_ID), 1);
+
+		ret = panthor_fw_glb_wait_acks(ptdev, GLB_PERFCNT_SAMPLE, &acked,
+					       PERFCNT_SAMPLE_TIMEOUT_MS);
+		if (ret)
+			return ret;
+	}
+
+	/* Acknowledge the overflow event, if any. */
+	if ((READ_ONCE(glb_iface->input->req) ^ READ_ONCE(glb_iface->output->ack)) &
+	    GLB_PERFCNT_OVERFLOW) {
+		panthor_fw_update_reqs(glb_iface, req, glb_iface->output->ack,
+				       GLB_PERFCNT_OVERFLOW);
+		perfcnt->status |= DRM_PANTHOR_PERFCNT_STATUS_LOST;
+	}
+
+	insert = READ_ONCE(glb_iface->output->perfcnt_insert);
+	avail = insert - perfcnt->extract;
+	if (avail > perfcnt->ring_size) {
+		perfcnt->extract = insert - perfcnt->ring_size;
+		perfcnt->status |= DRM_PANTHOR_PERFCNT_STATUS_LOST;
+		avail = perfcnt->ring_size;
+	}
+
+	count = min(avail, args->buf_size / perfcnt->sample_size);
+	for (i = 0; i < count; i++) {
+		u32 slot = (perfcnt->extract + i) & (perfcnt->ring_size - 1);
+
+		if (copy_to_user(ubuf + (size_t)i * perfcnt->sample_size,
+				 perfcnt->ringbuf->kmap + (size_t)slot * perfcnt->sample_size,
+				 perfcnt->sample_size))
+			return -EFAULT;
+	}
+
+	perfcnt->extract += count;
+	WRITE_ONCE(glb_iface->input->perfcnt_extract, perfcnt->extract);
+	perfcnt->samples += count;
+
+	args->sample_count = count;
+	args->status = perfcnt->status;
+	perfcnt->status = 0;
+	return 0;
+}
+
+/**
+ * panthor_perfcnt_dump() - Sample the counters and copy pending samples
+ * @pfile: File owning the counters.
+ * @args: Arguments passed to DRM_IOCTL_PANTHOR_PERFCNT_DUMP.
+ *
+ * Return: 0 on success, a negative error code otherwise.
+ */
+int panthor_perfcnt_dump(struct panthor_file *pfile,
+			 struct drm_panthor_perfcnt_dump *args)
+{
+	struct panthor_device *ptdev = pfile->ptdev;
+	struct panthor_perfcnt *perfcnt = ptdev->perfcnt;
+	int ret;
+
+	mutex_lock(&perfcnt->lock);
+	if (perfcnt->user != pfile)
+		ret = -EINVAL;
+	else if (args->buf_size < perfcnt->sample_size)
+		ret = -EINVAL;
+	else
+		ret = panthor_perfcnt_dump_locked(ptdev, args);
+	mutex_unlock(&perfcnt->lock);
+
+	return ret;
+}
+
+/**
+ * panthor_perfcnt_close() - Release the counters when their owner goes away
+ * @pfile: File being closed.
+ */
+void panthor_perfcnt_close(struct panthor_file *pfile)
+{
+	struct panthor_perfcnt *perfcnt = pfile->ptdev->perfcnt;
+
+	mutex_lock(&perfcnt->lock);
+	if (perfcnt->user == pfile)
+		panthor_perfcnt_stop_locked(pfile->ptdev);
+	mutex_unlock(&perfcnt->lock);
+}
+
+/**
+ * panthor_perfcnt_show_fdinfo() - Print the counter summary of a file
+ * @pfile: File.
+ * @p: Printer to print to.
+ */
+void panthor_perfcnt_show_fdinfo(struct panthor_file *pfile,
+				 struct drm_printer *p)
+{
+	struct panthor_perfcnt *perfcnt = pfile->ptdev->perfcnt;
+
+	mutex_lock(&perfcnt->lock);
+	if (perfcnt->user == pfile) {
+		drm_printf(p, "panthor-perfcnt-counter-set:\t%u\n", perfcnt->counter_set);
+		drm_printf(p, "panthor-perfcnt-samples:\t%llu\n", perfcnt->samples);
+	}
+	mutex_unlock(&perfcnt->lock);
+}
+
+/**
+ * panthor_perfcnt_post_reset() - Flag the sampler for re-arming after a FW reboot
+ * @ptdev: Device.
+ *
+ * Called when the global interface is re-initialized. The ring buffer indices
+ * restart from zero, so the next dump re-arms the sampler and reports the
+ * samples taken before the reboot as lost.
+ */
+void panthor_perfcnt_post_reset(struct panthor_device *ptdev)
+{
+	struct panthor_fw_global_iface *glb_iface = panthor_fw_get_glb_iface(ptdev);
+	struct panthor_perfcnt *perfcnt = ptdev->perfcnt;
+
+	if (!perfcnt)
+		return;
+
+	/* Make sure the FW sees a 0 -> 1 transition when we re-arm. */
+	panthor_fw_update_reqs(glb_iface, req, 0, GLB_PERFCNT_EN);
+	atomic_set(&perfcnt->fw_reset, 1);
+}
+
+/**
+ * panthor_perfcnt_init() - Initialize performance counter management data
+ * @ptdev: Device.
+ *
+ * Return: 0 on success, a negative error code otherwise.
+ */
+int panthor_perfcnt_init(struct panthor_device *ptdev)
+{
+	struct panthor_perfcnt *perfcnt;
+	int ret;
+
+	perfcnt = drmm_kzalloc(&ptdev->base, sizeof(*perfcnt), GFP_KERNEL);
+	if (!perfcnt)
+		return -ENOMEM;
+
+	ret = drmm_mutex_init(&ptdev->base, &perfcnt->lock);
+	if (ret)
+		return ret;
+
+	ptdev->perfcnt = perfcnt;
+	return 0;
+}
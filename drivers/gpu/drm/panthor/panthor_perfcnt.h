@@ -0,0 +1,25 @@
+/* SPDX-License-Identifier: GPL-2.0 or MIT */
+
+#ifndef __PANTHOR_PERFCNT_H__
+#define __PANTHOR_PERFCNT_H__
+
+struct drm_panthor_perfcnt_dump;
+struct drm_panthor_perfcnt_enable;
+struct drm_printer;
+
+struct panthor_device;
+struct panthor_file;
+
+int panthor_perfcnt_init(struct panthor_device *ptdev);
+void panthor_perfcnt_post_reset(struct panthor_device *ptdev);
+
+int panthor_perfcnt_enable(struct panthor_file *pfile,
+			   struct drm_panthor_perfcnt_enable *args);
+int panthor_perfcnt_dump(struct panthor_file *pfile,
+			 struct drm_panthor_perfcnt_dump *args);
+void panthor_perfcnt_close(struct panthor_file *pfile);
+
+void panthor_perfcnt_show_fdinfo(struct panthor_file *pfile,
+				 struct drm_printer *p);
+
+#endif /* __PANTHOR_PERFCNT_H__ */
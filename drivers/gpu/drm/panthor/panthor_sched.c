@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-2.0 or MIT
 /* Copyright 2023 Collabora ltd. */
 
+#include <drm/drm_debugfs.h>
 #include <drm/drm_drv.h>
 #include <drm/drm_exec.h>
 #include <drm/drm_gem_shmem_helper.h>
@@ -22,6 +23,7 @@
 #include <linux/module.h>
 #include <linux/platform_device.h>
 #include <linux/pm_runtime.h>
+#include <linux/seq_file.h>
 
 #include "panthor_devfreq.h"
 #include "panthor_device.h"
@@ -214,8 +216,16 @@ struct panthor_scheduler {
 	 */
 	u64 last_tick;
 
-	/** @tick_period: Tick period in jiffies. */
-	u64 tick_period;
+	/**
+	 * @tick_period: Tick period in jiffies, per group priority.
+	 *
+	 * When CSG slots are oversubscribed, groups of the lowest scheduled
+	 * priority are rotated every @tick_period[priority] jiffies. Higher
+	 * priority groups get shorter timeslices, to keep latency low, and
+	 * lower priority ones get longer timeslices, to limit the rotation
+	 * overhead.
+	 */
+	u64 tick_period[PANTHOR_CSG_PRIORITY_COUNT];
 
 	/**
 	 * @lock: Lock protecting access to all the scheduler fields.
@@ -391,6 +401,15 @@ struct panthor_queue {
 	u8 priority;
 #define CSF_MAX_QUEUE_PRIO	GENMASK(3, 0)
 
+	/**
+	 * @deadline_pending: True if a fence deadline was set on one of the jobs
+	 * of this queue, and the group hasn't been scheduled since then.
+	 *
+	 * Used by the scheduler to give the group precedence over other groups
+	 * of the same priority waiting for a CSG slot.
+	 */
+	atomic_t deadline_pending;
+
 	/** @ringbuf: Command stream ring-buffer. */
 	struct panthor_kernel_bo *ringbuf;
 
@@ -641,6 +660,24 @@ struct panthor_group {
 		size_t kbo_sizes;
 	} fdinfo;
 
+	/** @sched_stats: Scheduling statistics, protected by the scheduler lock. */
+	struct {
+		/** @sched_stats.run_time: Time spent bound to a CSG slot. */
+		ktime_t run_time;
+
+		/**
+		 * @sched_stats.wait_time: Time spent waiting for a CSG slot
+		 * while having work to execute.
+		 */
+		ktime_t wait_time;
+
+		/** @sched_stats.run_start: When the group got its CSG slot, zero if unbound. */
+		ktime_t run_start;
+
+		/** @sched_stats.wait_start: When the group started waiting, zero if not waiting. */
+		ktime_t wait_start;
+	} sched_stats;
+
 	/** @state: Group state. */
 	enum panthor_group_state state;
 
@@ -979,6 +1016,13 @@ group_bind_locked(struct panthor_group *group, u32 csg_id)
 	group_get(group);
 	group->csg_id = csg_id;
 
+	group->sched_stats.run_start = ktime_get();
+	if (group->sched_stats.wait_start) {
+		group->sched_stats.wait_time += ktime_sub(group->sched_stats.run_start,
+							  group->sched_stats.wait_start);
+		group->sched_stats.wait_start = 0;
+	}
+
 	/* Dummy doorbell allocation: doorbell is assigned to the group and
 	 * all queues use the same doorbell.
 	 *
@@ -986,8 +1030,10 @@ group_bind_locked(struct panthor_group *group, u32 csg_id)
 	 * updated queues get their own doorbell, thus avoiding useless checks
 	 * on queues belonging to the same group that are rarely updated.
 	 */
-	for (u32 i = 0; i < group->queue_count; i++)
+	for (u32 i = 0; i < group->queue_count; i++) {
 		group->queues[i]->doorbell_id = csg_id + 1;
+		atomic_set(&group->queues[i]->deadline_pending, 0);
+	}
 
 	csg_slot->group = group;
 
@@ -1018,6 +1064,9 @@ group_unbind_locked(struct panthor_group *group)
 	panthor_vm_idle(group->vm);
 	group->csg_id = -1;
 
+	group->sched_stats.run_time += ktime_sub(ktime_get(), group->sched_stats.run_start);
+	group->sched_stats.run_start = 0;
+
 	/* Tiler OOM events will be re-issued next time the group is scheduled. */
 	atomic_set(&group->tiler_oom, 0);
 	cancel_work(&group->tiler_oom_work);
@@ -1777,9 +1826,35 @@ static const char *queue_fence_get_timeline_name(struct dma_fence *fence)
 	return "queue-fence";
 }
 
+static void queue_fence_set_deadline(struct dma_fence *fence, ktime_t deadline)
+{
+	/* All queue fences are initialized with the queue fence_ctx lock. */
+	struct panthor_queue *queue = container_of(fence->lock, struct panthor_queue,
+						   fence_ctx.lock);
+	struct panthor_device *ptdev = dev_get_drvdata(queue->scheduler.dev);
+	struct panthor_scheduler *sched = ptdev->scheduler;
+
+	panthor_devfreq_set_deadline(ptdev, deadline);
+
+	/* If the group is already scheduled, or if there are free CSG slots,
+	 * the job will reach the FW without our help.
+	 */
+	if (READ_ONCE(queue->doorbell_id) != (u8)-1 ||
+	    READ_ONCE(sched->used_csg_slot_count) < sched->csg_slot_count)
+		return;
+
+	/* Otherwise, ask the scheduler to rotate groups now, so the group
+	 * owning this queue gets a slot without waiting for the end of
+	 * the current timeslice.
+	 */
+	if (!atomic_xchg(&queue->deadline_pending, 1))
+		sched_queue_delayed_work(sched, tick, 0);
+}
+
 static const struct dma_fence_ops panthor_queue_fence_ops = {
 	.get_driver_name = fence_get_driver_name,
 	.get_timeline_name = queue_fence_get_timeline_name,
+	.set_deadline = queue_fence_set_deadline,
 };
 
 struct panthor_csg_slots_upd_ctx {
@@ -2314,6 +2389,71 @@ tick_ctx_apply(struct panthor_scheduler *sched, struct panthor_sched_tick_ctx *c
 	sched->might_have_idle_groups = ctx->idle_group_count > 0;
 }
 
+static void
+tick_ctx_update_wait_stats(struct panthor_scheduler *sched)
+{
+	struct panthor_group *group;
+	ktime_t now = ktime_get();
+	int prio;
+
+	/* Groups left in the runnable lists have work to do but didn't get a
+	 * slot, start accounting their wait time. The accounting stops when
+	 * the group gets bound to a slot, or when it becomes idle.
+	 */
+	for (prio = PANTHOR_CSG_PRIORITY_COUNT - 1; prio >= 0; prio--) {
+		list_for_each_entry(group, &sched->groups.runnable[prio], run_node) {
+			if (!group->sched_stats.wait_start)
+				group->sched_stats.wait_start = now;
+		}
+
+		list_for_each_entry(group, &sched->groups.idle[prio], run_node) {
+			if (group->sched_stats.wait_start) {
+				group->sched_stats.wait_time +=
+					ktime_sub(now, group->sched_stats.wait_start);
+				group->sched_stats.wait_start = 0;
+			}
+		}
+	}
+}
+
+static bool group_has_deadline_pending(struct panthor_group *group)
+{
+	for (u32 i = 0; i < group->queue_count; i++) {
+		if (atomic_read(&group->queues[i]->deadline_pending))
+			return true;
+	}
+
+	return false;
+}
+
+static bool
+tick_promote_deadline_groups(struct panthor_scheduler *sched)
+{
+	struct panthor_group *group, *tmp;
+	bool promoted = false;
+	int prio;
+
+	/* Move groups that have jobs with a deadline to the head of their
+	 * runnable list, so they get picked first.
+	 */
+	for (prio = PANTHOR_CSG_PRIORITY_COUNT - 1; prio >= 0; prio--) {
+		struct list_head *runnable = &sched->groups.runnable[prio];
+		LIST_HEAD(deadline_groups);
+
+		list_for_each_entry_safe(group, tmp, runnable, run_node) {
+			if (group_has_deadline_pending(group))
+				list_move_tail(&group->run_node, &deadline_groups);
+		}
+
+		if (!list_empty(&deadline_groups)) {
+			list_splice(&deadline_groups, runnable);
+			promoted = true;
+		}
+	}
+
+	return promoted;
+}
+
 static u64
 tick_ctx_update_resched_target(struct panthor_scheduler *sched,
 			       const struct panthor_sched_tick_ctx *ctx)
@@ -2336,7 +2476,7 @@ tick_ctx_update_resched_target(struct panthor_scheduler *sched,
 	 * new groups with higher priority to be queued.
 	 */
 	if (!list_empty(&sched->groups.runnable[ctx->min_priority])) {
-		u64 resched_target = sched->last_tick + sched->tick_period;
+		u64 resched_target = sched->last_tick + sched->tick_period[ctx->min_priority];
 
 		if (time_before64(sched->resched_target, sched->last_tick) ||
 		    time_before64(resched_target, sched->resched_target))
@@ -2367,13 +2507,17 @@ static void tick_work(struct work_struct *work)
 	if (drm_WARN_ON(&ptdev->base, ret))
 		goto out_dev_exit;
 
-	if (time_before64(now, sched->resched_target))
-		remaining_jiffies = sched->resched_target - now;
-
 	mutex_lock(&sched->lock);
 	if (panthor_device_reset_is_pending(sched->ptdev))
 		goto out_unlock;
 
+	/* Groups with a pending fence deadline can't wait for the end of the
+	 * timeslice, force a full rotation if there are some.
+	 */
+	if (!tick_promote_deadline_groups(sched) &&
+	    time_before64(now, sched->resched_target))
+		remaining_jiffies = sched->resched_target - now;
+
 	tick_ctx_init(sched, &ctx, remaining_jiffies != 0);
 	if (ctx.csg_upd_failed_mask)
 		goto out_cleanup_ctx;
@@ -2433,6 +2577,8 @@ static void tick_work(struct work_struct *work)
 		}
 	}
 
+	tick_ctx_update_wait_stats(sched);
+
 	sched->last_tick = now;
 	resched_delay = tick_ctx_update_resched_target(sched, &ctx);
 	if (ctx.immediate_tick)
@@ -2580,7 +2726,7 @@ static void group_schedule_locked(struct panthor_group *group, u32 queue_mask)
 	 * last tick event, and queue the scheduler work.
 	 */
 	now = get_jiffies_64();
-	sched->resched_target = sched->last_tick + sched->tick_period;
+	sched->resched_target = sched->last_tick + sched->tick_period[group->priority];
 	if (sched->used_csg_slot_count == sched->csg_slot_count &&
 	    time_before64(now, sched->resched_target))
 		delay_jiffies = min_t(unsigned long, sched->resched_target - now, ULONG_MAX);
@@ -2901,6 +3047,8 @@ static void group_sync_upd_work(struct work_struct *work)
 	for (queue_idx = 0; queue_idx < group->queue_count; queue_idx++) {
 		struct panthor_queue *queue = group->queues[queue_idx];
 		struct panthor_syncobj_64b *syncobj;
+		ktime_t now = 0;
+		u64 seqno;
 
 		if (!queue)
 			continue;
@@ -2908,12 +3056,20 @@ static void group_sync_upd_work(struct work_struct *work)
 		syncobj = group->syncobjs->kmap + (queue_idx * sizeof(*syncobj));
 
 		spin_lock(&queue->fence_ctx.lock);
+		/*
+		 * All jobs up to this seqno were done when it was read, so they
+		 * can share one signalling timestamp taken right after that,
+		 * instead of reading the clock once per fence.
+		 */
+		seqno = syncobj->seqno;
 		list_for_each_entry_safe(job, job_tmp, &queue->fence_ctx.in_flight_jobs, node) {
-			if (syncobj->seqno < job->done_fence->seqno)
+			if (seqno < job->done_fence->seqno)
 				break;
 
+			if (!now)
+				now = ktime_get();
 			list_move_tail(&job->node, &done_jobs);
-			dma_fence_signal_locked(job->done_fence);
+			dma_fence_signal_timestamp_locked(job->done_fence, now);
 		}
 		spin_unlock(&queue->fence_ctx.lock);
 	}
@@ -3325,6 +3481,8 @@ group_create_queue(struct panthor_group *group,
 	spin_lock_init(&queue->fence_ctx.lock);
 	INIT_LIST_HEAD(&queue->fence_ctx.in_flight_jobs);
 
+	/* Queues get a doorbell when their group is bound to a CSG slot. */
+	queue->doorbell_id = -1;
 	queue->priority = args->priority;
 
 	queue->ringbuf = panthor_kernel_bo_create(group->ptdev, group->vm,
@@ -3907,7 +4065,10 @@ int panthor_sched_init(struct panthor_device *ptdev)
 
 	sched->last_tick = 0;
 	sched->resched_target = U64_MAX;
-	sched->tick_period = msecs_to_jiffies(10);
+	sched->tick_period[PANTHOR_CSG_PRIORITY_LOW] = msecs_to_jiffies(20);
+	sched->tick_period[PANTHOR_CSG_PRIORITY_MEDIUM] = msecs_to_jiffies(10);
+	sched->tick_period[PANTHOR_CSG_PRIORITY_HIGH] = msecs_to_jiffies(5);
+	sched->tick_period[PANTHOR_CSG_PRIORITY_RT] = msecs_to_jiffies(5);
 	INIT_DELAYED_WORK(&sched->tick_work, tick_work);
 	INIT_WORK(&sched->sync_upd_work, sync_upd_work);
 	INIT_WORK(&sched->fw_events_work, process_fw_events_work);
@@ -3958,3 +4119,70 @@ int panthor_sched_init(struct panthor_device *ptdev)
 	ptdev->scheduler = sched;
 	return 0;
 }
+
+#ifdef CONFIG_DEBUG_FS
+static void show_group_sched_stats(struct panthor_group *group, struct seq_file *m,
+				   ktime_t now)
+{
+	ktime_t run_time = group->sched_stats.run_time;
+	ktime_t wait_time = group->sched_stats.wait_time;
+
+	if (group->sched_stats.run_start)
+		run_time = ktime_add(run_time, ktime_sub(now, group->sched_stats.run_start));
+
+	if (group->sched_stats.wait_start)
+		wait_time = ktime_add(wait_time, ktime_sub(now, group->sched_stats.wait_start));
+
+	seq_printf(m, "%4u %6d %5s %12lld %12lld\n",
+		   group->priority, group->csg_id,
+		   group_is_idle(group) ? "yes" : "no",
+		   ktime_to_ms(run_time), ktime_to_ms(wait_time));
+}
+
+static int show_sched_groups(struct seq_file *m, void *arg)
+{
+	struct drm_info_node *node = (struct drm_info_node *)m->private;
+	struct drm_device *ddev = node->minor->dev;
+	struct panthor_device *ptdev = container_of(ddev, struct panthor_device, base);
+	struct panthor_scheduler *sched = ptdev->scheduler;
+	struct panthor_group *group;
+	ktime_t now = ktime_get();
+	int prio;
+
+	seq_printf(m, "%4s %6s %5s %12s %12s\n",
+		   "prio", "csg_id", "idle", "run (ms)", "wait (ms)");
+
+	mutex_lock(&sched->lock);
+	for (u32 i = 0; i < sched->csg_slot_count; i++) {
+		group = sched->csg_slots[i].group;
+		if (group)
+			show_group_sched_stats(group, m, now);
+	}
+
+	for (prio = PANTHOR_CSG_PRIORITY_COUNT - 1; prio >= 0; prio--) {
+		list_for_each_entry(group, &sched->groups.runnable[prio], run_node)
+			show_group_sched_stats(group, m, now);
+
+		list_for_each_entry(group, &sched->groups.idle[prio], run_node)
+			show_group_sched_stats(group, m, now);
+	}
+	mutex_unlock(&sched->lock);
+
+	return 0;
+}
+
+static struct drm_info_list panthor_sched_debugfs_list[] = {
+	{"sched_groups", show_sched_groups, 0, NULL},
+};
+
+/**
+ * panthor_sched_debugfs_init() - Initialize scheduler debugfs entries
+ * @minor: Minor.
+ */
+void panthor_sched_debugfs_init(struct drm_minor *minor)
+{
+	drm_debugfs_create_files(panthor_sched_debugfs_list,
+				 ARRAY_SIZE(panthor_sched_debugfs_list),
+				 minor->debugfs_root, minor);
+}
+#endif /* CONFIG_DEBUG_FS */
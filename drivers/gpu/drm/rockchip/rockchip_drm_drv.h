@@ -20,6 +20,7 @@
 #define ROCKCHIP_MAX_FB_BUFFER	3
 #define ROCKCHIP_MAX_CONNECTOR	2
 #define ROCKCHIP_MAX_CRTC	4
+#define ROCKCHIP_MAX_PLANES	32
 
 /*
  * display output interface supported by rockchip lcdc
@@ -53,6 +54,10 @@ struct rockchip_crtc_state {
 	u32 bus_format;
 	u32 bus_flags;
 	int color_space;
+	/* Memory bandwidth read by the planes from each AXI bus, in MB/s */
+	u32 axi_bw[2];
+	/* Blending layer of each plane, indexed by drm_plane_index() */
+	u8 plane_layer[ROCKCHIP_MAX_PLANES];
 };
 #define to_rockchip_crtc_state(s) \
 		container_of(s, struct rockchip_crtc_state, base)
@@ -6,8 +6,10 @@
 #include <linux/bitfield.h>
 #include <linux/clk.h>
 #include <linux/component.h>
+#include <linux/crc32.h>
 #include <linux/delay.h>
 #include <linux/iopoll.h>
+#include <linux/interconnect.h>
 #include <linux/kernel.h>
 #include <linux/media-bus-format.h>
 #include <linux/mfd/syscon.h>
@@ -26,6 +28,7 @@
 #include <drm/drm_crtc.h>
 #include <linux/debugfs.h>
 #include <drm/drm_debugfs.h>
+#include <drm/drm_edid.h>
 #include <drm/drm_flip_work.h>
 #include <drm/drm_framebuffer.h>
 #include <drm/drm_gem_framebuffer_helper.h>
@@ -33,6 +36,7 @@
 #include <drm/drm_vblank.h>
 
 #include <uapi/linux/videodev2.h>
+#include <dt-bindings/interconnect/rockchip,rk3588.h>
 
 #include "rockchip_drm_gem.h"
 #include "rockchip_drm_vop2.h"
@@ -136,6 +140,16 @@ static DRM_ENUM_NAME_FN(drm_get_bus_format_name, drm_bus_format_enum_list)
 
 static const struct regmap_config vop2_regmap_config;
 
+static bool m2m_compositor;
+module_param(m2m_compositor, bool, 0444);
+MODULE_PARM_DESC(m2m_compositor,
+		 "Register a video port without output as a memory-to-memory compositor");
+
+static unsigned int bw_efficiency = 70;
+module_param(bw_efficiency, uint, 0644);
+MODULE_PARM_DESC(bw_efficiency,
+		 "Usable share of the VOP AXI bandwidth in percent, 0 disables the check (default: 70)");
+
 static void vop2_lock(struct vop2 *vop2)
 {
 	mutex_lock(&vop2->vop2_lock);
@@ -819,6 +833,7 @@ static void vop2_enable(struct vop2 *vop2)
 {
 	int ret;
 	u32 version;
+	u32 sys0_irqs;
 
 	ret = pm_runtime_resume_and_get(vop2->dev);
 	if (ret < 0) {
@@ -863,10 +878,12 @@ static void vop2_enable(struct vop2 *vop2)
 	regmap_clear_bits(vop2->map, RK3568_SYS_AUTO_GATING_CTRL,
 			  RK3568_SYS_AUTO_GATING_CTRL__AUTO_GATING_EN);
 
-	vop2_writel(vop2, RK3568_SYS0_INT_CLR,
-		    VOP2_INT_BUS_ERRPR << 16 | VOP2_INT_BUS_ERRPR);
-	vop2_writel(vop2, RK3568_SYS0_INT_EN,
-		    VOP2_INT_BUS_ERRPR << 16 | VOP2_INT_BUS_ERRPR);
+	sys0_irqs = VOP2_INT_BUS_ERRPR;
+	if (vop2->data->wb_max_output.width)
+		sys0_irqs |= VOP2_INT_WB_YRGB_FIFO_FULL | VOP2_INT_WB_UV_FIFO_FULL;
+
+	vop2_writel(vop2, RK3568_SYS0_INT_CLR, sys0_irqs << 16 | sys0_irqs);
+	vop2_writel(vop2, RK3568_SYS0_INT_EN, sys0_irqs << 16 | sys0_irqs);
 	vop2_writel(vop2, RK3568_SYS1_INT_CLR,
 		    VOP2_INT_BUS_ERRPR << 16 | VOP2_INT_BUS_ERRPR);
 	vop2_writel(vop2, RK3568_SYS1_INT_EN,
@@ -947,6 +964,583 @@ static bool vop2_gamma_lut_in_use(struct vop2 *vop2, struct vop2_video_port *vp)
 	return gamma_en_vp_id != nr_vps && gamma_en_vp_id != vp->id;
 }
 
+static const u32 vop2_wb_formats[] = {
+	DRM_FORMAT_XRGB8888,
+	DRM_FORMAT_ARGB8888,
+	DRM_FORMAT_BGR888,
+	DRM_FORMAT_RGB565,
+	DRM_FORMAT_NV12,
+};
+
+static int vop2_convert_wb_format(u32 format)
+{
+	switch (format) {
+	case DRM_FORMAT_XRGB8888:
+	case DRM_FORMAT_ARGB8888:
+		return 0;
+	case DRM_FORMAT_BGR888:
+		return 1;
+	case DRM_FORMAT_RGB565:
+		return 2;
+	case DRM_FORMAT_NV12:
+		return 4;
+	default:
+		return -EINVAL;
+	}
+}
+
+static inline struct vop2_wb *to_vop2_wb(struct drm_connector *connector)
+{
+	return container_of(drm_connector_to_writeback(connector), struct vop2_wb, conn);
+}
+
+/*
+ * Program the writeback engine for the job attached to the new connector
+ * state of this video port. The registers are latched by the next
+ * cfg_done, the job is queued by vop2_wb_arm() once that has been done.
+ */
+static struct drm_connector_state *vop2_wb_commit(struct vop2_video_port *vp,
+						  struct drm_atomic_state *state)
+{
+	struct vop2 *vop2 = vp->vop2;
+	struct vop2_wb *wb = &vop2->wb;
+	struct drm_connector_state *conn_state;
+	struct drm_framebuffer *fb;
+	struct rockchip_gem_object *rk_obj;
+	u32 fifo_throd, val;
+
+	if (!vop2->data->wb_max_output.width)
+		return NULL;
+
+	conn_state = drm_atomic_get_new_connector_state(state, &wb->conn.base);
+	if (!conn_state || conn_state->crtc != &vp->crtc ||
+	    !conn_state->writeback_job || !conn_state->writeback_job->fb)
+		return NULL;
+
+	fb = conn_state->writeback_job->fb;
+
+	drm_dbg(vop2->drm, "vp%d writeback %dx%d fmt[%p4cc]\n",
+		vp->id, fb->width, fb->height, &fb->format->format);
+
+	rk_obj = to_rockchip_obj(fb->obj[0]);
+	vop2_writel(vop2, RK3568_WB_YRGB_MST, rk_obj->dma_addr + fb->offsets[0]);
+	if (fb->format->is_yuv) {
+		rk_obj = to_rockchip_obj(fb->obj[1]);
+		vop2_writel(vop2, RK3568_WB_CBR_MST, rk_obj->dma_addr + fb->offsets[1]);
+	}
+
+	fifo_throd = min(fb->pitches[0] >> 4, vop2->data->wb_max_output.width * 4 / 16);
+	regmap_update_bits(vop2->map, RK3568_WB_XSCAL_FACTOR,
+			   RK3568_WB_XSCAL_FACTOR__FIFO_THROD,
+			   FIELD_PREP(RK3568_WB_XSCAL_FACTOR__FIFO_THROD, fifo_throd));
+
+	regmap_update_bits(vop2->map, RK3568_LUT_PORT_SEL,
+			   RK3568_LUT_PORT_SEL__WB_PORT_SEL,
+			   FIELD_PREP(RK3568_LUT_PORT_SEL__WB_PORT_SEL, vp->id));
+
+	val = RK3568_WB_CTRL__ENABLE;
+	val |= FIELD_PREP(RK3568_WB_CTRL__FORMAT,
+			  vop2_convert_wb_format(fb->format->format));
+	if (fb->format->is_yuv)
+		val |= RK3568_WB_CTRL__R2Y_EN;
+	regmap_update_bits(vop2->map, RK3568_WB_CTRL,
+			   RK3568_WB_CTRL__SCALE_Y_EN | RK3568_WB_CTRL__SCALE_X_EN |
+			   RK3568_WB_CTRL__R2Y_EN | RK3568_WB_CTRL__DITHER_EN |
+			   RK3568_WB_CTRL__FORMAT | RK3568_WB_CTRL__ENABLE, val);
+
+	WARN_ON(drm_crtc_vblank_get(&vp->crtc));
+
+	return conn_state;
+}
+
+/* Called with wb->lock held, right after the cfg_done of the commit */
+static void vop2_wb_arm(struct vop2_video_port *vp,
+			struct drm_connector_state *conn_state)
+{
+	struct vop2_wb *wb = &vp->vop2->wb;
+
+	/*
+	 * The previous job was overwritten before it got latched, its
+	 * buffer will never be filled.
+	 */
+	if (wb->armed) {
+		drm_writeback_signal_completion(&wb->conn, -EBUSY);
+		drm_crtc_vblank_put(&wb->vp->crtc);
+	}
+
+	drm_writeback_queue_job(&wb->conn, conn_state);
+	wb->vp = vp;
+	wb->armed = true;
+}
+
+static void vop2_wb_disable(struct vop2 *vop2)
+{
+	regmap_clear_bits(vop2->map, RK3568_WB_CTRL, RK3568_WB_CTRL__ENABLE);
+}
+
+/*
+ * Called at frame start: the frame that has just ended completes the
+ * active job, and a job armed before this frame start becomes the
+ * active one.
+ *
+ * The engine is stopped after that one frame. A cfg_done issued from here
+ * would latch the registers of a commit being programmed halfway, so while
+ * a commit is programming the video port stopping the engine is left to
+ * its flush.
+ */
+static void vop2_wb_handler(struct vop2_video_port *vp)
+{
+	struct vop2 *vop2 = vp->vop2;
+	struct vop2_wb *wb = &vop2->wb;
+
+	spin_lock(&wb->lock);
+
+	if (wb->vp != vp)
+		goto out;
+
+	if (wb->active) {
+		drm_writeback_signal_completion(&wb->conn, 0);
+		drm_crtc_vblank_put(&vp->crtc);
+		wb->active = false;
+	}
+
+	if (wb->armed && !(vop2_readl(vop2, RK3568_REG_CFG_DONE) & BIT(vp->id))) {
+		wb->armed = false;
+		wb->active = true;
+
+		/* Only write back this one frame, unless a new job is armed */
+		if (wb->committing) {
+			wb->stop = true;
+		} else {
+			vop2_wb_disable(vop2);
+			vop2_cfg_done(vp);
+		}
+	}
+
+	if (!wb->armed && !wb->active) {
+		wb->committing = false;
+		wb->stop = false;
+		wb->vp = NULL;
+	}
+out:
+	spin_unlock(&wb->lock);
+}
+
+static void vop2_wb_cancel(struct vop2_video_port *vp)
+{
+	struct vop2 *vop2 = vp->vop2;
+	struct vop2_wb *wb = &vop2->wb;
+
+	spin_lock_irq(&wb->lock);
+
+	if (wb->vp == vp) {
+		vop2_wb_disable(vop2);
+
+		if (wb->active) {
+			drm_writeback_signal_completion(&wb->conn, -ECANCELED);
+			drm_crtc_vblank_put(&vp->crtc);
+		}
+
+		if (wb->armed) {
+			drm_writeback_signal_completion(&wb->conn, -ECANCELED);
+			drm_crtc_vblank_put(&vp->crtc);
+		}
+
+		wb->armed = false;
+		wb->active = false;
+		wb->committing = false;
+		wb->stop = false;
+		wb->vp = NULL;
+	}
+
+	if (wb->crc.vp == vp && wb->crc.running) {
+		vop2_wb_disable(vop2);
+		wb->crc.running = false;
+	}
+
+	spin_unlock_irq(&wb->lock);
+}
+
+static const char * const vop2_crc_sources[] = { "auto" };
+
+/*
+ * Start capturing to the buffers from this commit on, called with
+ * wb->lock held right before cfg_done. The capture is stopped while the
+ * mode doesn't fit in the buffers allocated when the source was set.
+ */
+static void vop2_crc_commit(struct vop2_video_port *vp,
+			    struct drm_crtc_state *crtc_state)
+{
+	struct vop2 *vop2 = vp->vop2;
+	struct vop2_wb_crc *crc = &vop2->wb.crc;
+	struct drm_display_mode *mode = &crtc_state->adjusted_mode;
+	size_t len = mode->hdisplay * mode->vdisplay * 4;
+	unsigned int i;
+
+	if (crc->vp != vp)
+		return;
+
+	crc->committing = false;
+
+	if (!crtc_state->active || len > crc->buf[0]->base.size) {
+		if (crc->running) {
+			drm_dbg(vop2->drm, "vp%d stopping crc capture\n", vp->id);
+			vop2_wb_disable(vop2);
+			crc->running = false;
+		}
+		return;
+	}
+
+	if (!crc->running) {
+		regmap_update_bits(vop2->map, RK3568_WB_XSCAL_FACTOR,
+				   RK3568_WB_XSCAL_FACTOR__FIFO_THROD,
+				   FIELD_PREP(RK3568_WB_XSCAL_FACTOR__FIFO_THROD,
+					      mode->hdisplay * 4 / 16));
+		regmap_update_bits(vop2->map, RK3568_LUT_PORT_SEL,
+				   RK3568_LUT_PORT_SEL__WB_PORT_SEL,
+				   FIELD_PREP(RK3568_LUT_PORT_SEL__WB_PORT_SEL, vp->id));
+		regmap_update_bits(vop2->map, RK3568_WB_CTRL,
+				   RK3568_WB_CTRL__SCALE_Y_EN | RK3568_WB_CTRL__SCALE_X_EN |
+				   RK3568_WB_CTRL__R2Y_EN | RK3568_WB_CTRL__DITHER_EN |
+				   RK3568_WB_CTRL__FORMAT | RK3568_WB_CTRL__ENABLE,
+				   RK3568_WB_CTRL__ENABLE |
+				   FIELD_PREP(RK3568_WB_CTRL__FORMAT,
+					      vop2_convert_wb_format(DRM_FORMAT_XRGB8888)));
+		crc->hw = ARRAY_SIZE(crc->buf);
+		crc->valid = false;
+		crc->running = true;
+	}
+
+	/* A new mode makes the frame being written meaningless */
+	if (len != crc->len)
+		crc->valid = false;
+	crc->len = len;
+
+	for (i = 0; i < ARRAY_SIZE(crc->buf); i++) {
+		if (i != crc->hw && i != crc->busy)
+			break;
+	}
+	crc->reg = i;
+	vop2_writel(vop2, RK3568_WB_YRGB_MST, crc->buf[i]->dma_addr);
+}
+
+/*
+ * Called at frame start, after the vblank event has been sent: the buffer
+ * that was written by the frame that has just ended is handed over to
+ * the work item, and a free buffer is programmed for the next frame
+ * unless a commit is programming the video port.
+ */
+static void vop2_crc_handler(struct vop2_video_port *vp)
+{
+	struct vop2 *vop2 = vp->vop2;
+	struct vop2_wb_crc *crc = &vop2->wb.crc;
+	unsigned int done, i;
+
+	spin_lock(&vop2->wb.lock);
+
+	if (crc->vp != vp || !crc->running)
+		goto out;
+
+	done = crc->hw;
+	if (!(vop2_readl(vop2, RK3568_REG_CFG_DONE) & BIT(vp->id)))
+		crc->hw = crc->reg;
+
+	/*
+	 * If the buffer didn't change the frame that has just ended is
+	 * being overwritten, there is no CRC for it.
+	 */
+	if (crc->hw != done) {
+		if (crc->valid && crc->busy < 0) {
+			crc->busy = done;
+			crc->frame = drm_crtc_vblank_count(&vp->crtc) - 1;
+			queue_work(system_unbound_wq, &crc->work);
+		}
+		crc->valid = true;
+	}
+
+	if (crc->committing)
+		goto out;
+
+	for (i = 0; i < ARRAY_SIZE(crc->buf); i++) {
+		if (i != crc->hw && i != crc->busy)
+			break;
+	}
+
+	if (i != crc->reg) {
+		crc->reg = i;
+		vop2_writel(vop2, RK3568_WB_YRGB_MST, crc->buf[i]->dma_addr);
+		vop2_cfg_done(vp);
+	}
+out:
+	spin_unlock(&vop2->wb.lock);
+}
+
+static void vop2_crc_work(struct work_struct *work)
+{
+	struct vop2_wb_crc *crc = container_of(work, struct vop2_wb_crc, work);
+	struct vop2 *vop2 = container_of(crc, struct vop2, wb.crc);
+	struct vop2_video_port *vp;
+	size_t len;
+	u32 frame;
+	u32 value;
+	int busy;
+
+	spin_lock_irq(&vop2->wb.lock);
+	vp = crc->vp;
+	busy = crc->busy;
+	frame = crc->frame;
+	len = crc->len;
+	spin_unlock_irq(&vop2->wb.lock);
+
+	if (!vp || busy < 0)
+		return;
+
+	value = crc32_le(~0, crc->buf[busy]->kvaddr, len) ^ ~0;
+	drm_crtc_add_crc_entry(&vp->crtc, true, frame, &value);
+
+	spin_lock_irq(&vop2->wb.lock);
+	crc->busy = -1;
+	spin_unlock_irq(&vop2->wb.lock);
+}
+
+static void vop2_crc_free_buffers(struct vop2_wb_crc *crc)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(crc->buf); i++) {
+		if (crc->buf[i])
+			drm_gem_object_put(&crc->buf[i]->base);
+		crc->buf[i] = NULL;
+	}
+}
+
+static int vop2_crc_start(struct vop2_video_port *vp)
+{
+	struct vop2 *vop2 = vp->vop2;
+	struct vop2_wb *wb = &vop2->wb;
+	struct vop2_wb_crc *crc = &wb->crc;
+	struct drm_display_mode *mode = &vp->crtc.state->adjusted_mode;
+	unsigned int i;
+
+	if (!vop2->data->wb_max_output.width)
+		return -ENODEV;
+
+	if (mode->hdisplay > vop2->data->wb_max_output.width ||
+	    mode->vdisplay > vop2->data->wb_max_output.height) {
+		drm_dbg(vop2->drm, "vp%d mode too large for crc capture\n", vp->id);
+		return -EINVAL;
+	}
+
+	if (crc->vp || wb->vp)
+		return -EBUSY;
+
+	for (i = 0; i < ARRAY_SIZE(crc->buf); i++) {
+		crc->buf[i] = rockchip_gem_create_object(vop2->drm,
+							 mode->hdisplay * mode->vdisplay * 4,
+							 true);
+		if (IS_ERR(crc->buf[i])) {
+			crc->buf[i] = NULL;
+			vop2_crc_free_buffers(crc);
+			return -ENOMEM;
+		}
+	}
+
+	spin_lock_irq(&wb->lock);
+	crc->busy = -1;
+	crc->len = 0;
+	crc->running = false;
+	crc->committing = false;
+	crc->vp = vp;
+	spin_unlock_irq(&wb->lock);
+
+	return 0;
+}
+
+static void vop2_crc_stop(struct vop2_video_port *vp)
+{
+	struct vop2 *vop2 = vp->vop2;
+	struct vop2_wb *wb = &vop2->wb;
+	struct vop2_wb_crc *crc = &wb->crc;
+	bool running;
+
+	if (crc->vp != vp)
+		return;
+
+	spin_lock_irq(&wb->lock);
+	running = crc->running;
+	if (running) {
+		vop2_wb_disable(vop2);
+		if (!crc->committing)
+			vop2_cfg_done(vp);
+	}
+	crc->running = false;
+	crc->vp = NULL;
+	spin_unlock_irq(&wb->lock);
+
+	cancel_work_sync(&crc->work);
+
+	/* The engine keeps writing until the disable has been latched */
+	if (running)
+		drm_crtc_wait_one_vblank(&vp->crtc);
+
+	vop2_crc_free_buffers(crc);
+}
+
+static int vop2_wb_encoder_atomic_check(struct drm_encoder *encoder,
+					struct drm_crtc_state *crtc_state,
+					struct drm_connector_state *conn_state)
+{
+	struct vop2_wb *wb = to_vop2_wb(conn_state->connector);
+	struct vop2 *vop2 = container_of(wb, struct vop2, wb);
+	struct drm_display_mode *mode = &crtc_state->mode;
+	struct drm_framebuffer *fb;
+	int i;
+
+	if (!conn_state->writeback_job || !conn_state->writeback_job->fb)
+		return 0;
+
+	if (wb->crc.vp) {
+		drm_dbg_kms(vop2->drm, "writeback engine in use for crc capture\n");
+		return -EBUSY;
+	}
+
+	fb = conn_state->writeback_job->fb;
+
+	/*
+	 * The writeback engine taps the output of a running video port,
+	 * only the compositor port runs without any other output.
+	 */
+	if (vop2->m2m_vp && crtc_state->crtc == &vop2->m2m_vp->crtc) {
+		struct rockchip_crtc_state *vcstate = to_rockchip_crtc_state(crtc_state);
+
+		vcstate->output_mode = ROCKCHIP_OUT_MODE_P888;
+		vcstate->output_type = DRM_MODE_CONNECTOR_WRITEBACK;
+		vcstate->bus_format = MEDIA_BUS_FMT_RGB888_1X24;
+	} else if (!(crtc_state->encoder_mask & ~drm_encoder_mask(encoder))) {
+		drm_dbg_kms(vop2->drm, "writeback needs an active output\n");
+		return -EINVAL;
+	}
+
+	if (fb->width != mode->hdisplay || fb->height != mode->vdisplay) {
+		drm_dbg_kms(vop2->drm, "Invalid writeback size %dx%d, mode is %dx%d\n",
+			    fb->width, fb->height, mode->hdisplay, mode->vdisplay);
+		return -EINVAL;
+	}
+
+	if (fb->width > vop2->data->wb_max_output.width ||
+	    fb->height > vop2->data->wb_max_output.height) {
+		drm_dbg_kms(vop2->drm, "Invalid writeback size %dx%d, max is %dx%d\n",
+			    fb->width, fb->height, vop2->data->wb_max_output.width,
+			    vop2->data->wb_max_output.height);
+		return -EINVAL;
+	}
+
+	if (fb->modifier != DRM_FORMAT_MOD_LINEAR)
+		return -EINVAL;
+
+	/* There is no stride register, the lines must be packed */
+	for (i = 0; i < fb->format->num_planes; i++) {
+		if (fb->pitches[i] != drm_format_info_min_pitch(fb->format, i, fb->width)) {
+			drm_dbg_kms(vop2->drm, "Invalid writeback pitch %d\n",
+				    fb->pitches[i]);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+static const struct drm_encoder_helper_funcs vop2_wb_encoder_helper_funcs = {
+	.atomic_check = vop2_wb_encoder_atomic_check,
+};
+
+static int vop2_wb_connector_get_modes(struct drm_connector *connector)
+{
+	struct vop2 *vop2 = container_of(to_vop2_wb(connector), struct vop2, wb);
+
+	return drm_add_modes_noedid(connector, vop2->data->wb_max_output.width,
+				    vop2->data->wb_max_output.height);
+}
+
+static const struct drm_connector_helper_funcs vop2_wb_connector_helper_funcs = {
+	.get_modes = vop2_wb_connector_get_modes,
+};
+
+static const struct drm_connector_funcs vop2_wb_connector_funcs = {
+	.fill_modes = drm_helper_probe_single_connector_modes,
+	.destroy = drm_connector_cleanup,
+	.reset = drm_atomic_helper_connector_reset,
+	.atomic_duplicate_state = drm_atomic_helper_connector_duplicate_state,
+	.atomic_destroy_state = drm_atomic_helper_connector_destroy_state,
+};
+
+static int vop2_wb_init(struct vop2 *vop2)
+{
+	struct vop2_wb *wb = &vop2->wb;
+	struct drm_crtc *crtc;
+	u32 possible_crtcs = 0;
+	int ret;
+
+	spin_lock_init(&wb->lock);
+	INIT_WORK(&wb->crc.work, vop2_crc_work);
+
+	if (!vop2->data->wb_max_output.width)
+		return 0;
+
+	drm_for_each_crtc(crtc, vop2->drm)
+		possible_crtcs |= drm_crtc_mask(crtc);
+
+	drm_connector_helper_add(&wb->conn.base, &vop2_wb_connector_helper_funcs);
+
+	ret = drm_writeback_connector_init(vop2->drm, &wb->conn,
+					   &vop2_wb_connector_funcs,
+					   &vop2_wb_encoder_helper_funcs,
+					   vop2_wb_formats,
+					   ARRAY_SIZE(vop2_wb_formats),
+					   possible_crtcs);
+	if (ret)
+		drm_err(vop2->drm, "failed to init writeback connector: %d\n", ret);
+
+	return ret;
+}
+
+static inline struct vop2_bw_state *to_vop2_bw_state(struct drm_private_state *state)
+{
+	return container_of(state, struct vop2_bw_state, base);
+}
+
+/*
+ * Vote for the bandwidth all the video ports read, on the path from the VOP
+ * to the DDR, once a commit that changed it has been applied. On RK3588 the
+ * NoC then serves that much of the VOP traffic at a high priority, so the
+ * display doesn't underflow when the GPU or NPU saturate the DDR.
+ */
+static void vop2_update_icc_bw(struct vop2 *vop2, struct drm_atomic_state *state)
+{
+	struct drm_private_state *priv_state;
+	struct vop2_bw_state *bw_state;
+	u32 total = 0;
+	int i, j, ret;
+
+	if (!vop2->icc_path)
+		return;
+
+	priv_state = drm_atomic_get_new_private_obj_state(state, &vop2->bw_obj);
+	if (!priv_state)
+		return;
+
+	bw_state = to_vop2_bw_state(priv_state);
+
+	for (i = 0; i < vop2->data->nr_vps; i++)
+		for (j = 0; j < VOP2_SYS_AXI_BUS_NUM; j++)
+			total += bw_state->bw[i][j];
+
+	/* The interconnect framework counts in kB/s */
+	ret = icc_set_bw(vop2->icc_path, MBps_to_icc(total), MBps_to_icc(total));
+	if (ret)
+		drm_warn(vop2->drm, "failed to vote for %u MB/s: %d\n", total, ret);
+}
+
 static void vop2_crtc_atomic_disable(struct drm_crtc *crtc,
 				     struct drm_atomic_state *state)
 {
@@ -960,6 +1554,8 @@ static void vop2_crtc_atomic_disable(struct drm_crtc *crtc,
 	old_crtc_state = drm_atomic_get_old_crtc_state(state, crtc);
 	drm_atomic_helper_disable_planes_on_crtc(old_crtc_state, false);
 
+	vop2_wb_cancel(vp);
+
 	drm_crtc_vblank_off(crtc);
 
 	/*
@@ -994,6 +1590,8 @@ static void vop2_crtc_atomic_disable(struct drm_crtc *crtc,
 
 	vop2_unlock(vop2);
 
+	vop2_update_icc_bw(vop2, state);
+
 	if (crtc->state->event && !crtc->state->active) {
 		spin_lock_irq(&crtc->dev->event_lock);
 		drm_crtc_send_vblank_event(crtc, crtc->state->event);
@@ -1009,6 +1607,7 @@ static int vop2_plane_atomic_check(struct drm_plane *plane,
 	struct drm_plane_state *pstate = drm_atomic_get_new_plane_state(astate, plane);
 	struct drm_framebuffer *fb = pstate->fb;
 	struct drm_crtc *crtc = pstate->crtc;
+	struct vop2_win *win = to_vop2_win(plane);
 	struct drm_crtc_state *cstate;
 	struct vop2_video_port *vp;
 	struct vop2 *vop2;
@@ -1023,6 +1622,12 @@ static int vop2_plane_atomic_check(struct drm_plane *plane,
 	if (!crtc)
 		return 0;
 
+	/* Only region 0 has a scaler wired up */
+	if (vop2_area_window(win)) {
+		min_scale = DRM_PLANE_NO_SCALING;
+		max_scale = DRM_PLANE_NO_SCALING;
+	}
+
 	vp = to_vop2_video_port(crtc);
 	vop2 = vp->vop2;
 	vop2_data = vop2->data;
@@ -1143,20 +1748,73 @@ static void vop2_plane_setup_color_key(struct drm_plane *plane, u32 color_key)
 	vop2_win_write(win, VOP2_WIN_COLOR_KEY, (r << 20) | (g << 10) | b);
 }
 
-static void vop2_plane_atomic_update(struct drm_plane *plane,
-				     struct drm_atomic_state *state)
+/*
+ * An area only has the region registers of its own: the format, stride,
+ * addresses and position. Everything else is shared with the window and
+ * programmed by the update of its parent plane.
+ */
+static void vop2_area_atomic_update(struct drm_plane *plane)
 {
 	struct drm_plane_state *pstate = plane->state;
-	struct drm_crtc *crtc = pstate->crtc;
+	struct vop2_video_port *vp = to_vop2_video_port(pstate->crtc);
 	struct vop2_win *win = to_vop2_win(plane);
-	struct vop2_video_port *vp = to_vop2_video_port(crtc);
-	struct drm_display_mode *adjusted_mode = &crtc->state->adjusted_mode;
 	struct vop2 *vop2 = win->vop2;
 	struct drm_framebuffer *fb = pstate->fb;
-	u32 bpp = vop2_get_bpp(fb->format);
-	u32 actual_w, actual_h, dsp_w, dsp_h;
-	u32 act_info, dsp_info;
-	u32 format;
+	struct drm_rect *src = &pstate->src;
+	struct drm_rect *dest = &pstate->dst;
+	struct rockchip_gem_object *rk_obj = to_rockchip_obj(fb->obj[0]);
+	u32 dsp_w = drm_rect_width(dest);
+	u32 dsp_h = drm_rect_height(dest);
+	u32 dsp_info = (dsp_h - 1) << 16 | ((dsp_w - 1) & 0xffff);
+	unsigned long offset;
+	dma_addr_t yrgb_mst;
+
+	offset = (src->x1 >> 16) * fb->format->cpp[0];
+	offset += (src->y1 >> 16) * fb->pitches[0];
+	yrgb_mst = rk_obj->dma_addr + offset + fb->offsets[0];
+
+	drm_dbg(vop2->drm, "vp%d update %s area%d[%dx%d@%dx%d] addr[%pad]\n",
+		vp->id, win->data->name, win->area_id, dsp_w, dsp_h,
+		dest->x1, dest->y1, &yrgb_mst);
+
+	if (fb->format->is_yuv) {
+		int hsub = fb->format->hsub;
+		int vsub = fb->format->vsub;
+		dma_addr_t uv_mst;
+
+		offset = (src->x1 >> 16) * fb->format->cpp[1] / hsub;
+		offset += (src->y1 >> 16) * fb->pitches[1] / vsub;
+		uv_mst = rk_obj->dma_addr + offset + fb->offsets[1];
+
+		vop2_win_write(win, VOP2_WIN_UV_VIR, DIV_ROUND_UP(fb->pitches[1], 4));
+		vop2_win_write(win, VOP2_WIN_UV_MST, uv_mst);
+	}
+
+	vop2_win_write(win, VOP2_WIN_FORMAT, vop2_convert_format(fb->format->format));
+	vop2_win_write(win, VOP2_WIN_RB_SWAP, vop2_win_rb_swap(fb->format->format));
+	vop2_win_write(win, VOP2_WIN_UV_SWAP, vop2_win_uv_swap(fb->format->format));
+	vop2_win_write(win, VOP2_WIN_YRGB_VIR, DIV_ROUND_UP(fb->pitches[0], 4));
+	vop2_win_write(win, VOP2_WIN_YRGB_MST, yrgb_mst);
+	vop2_win_write(win, VOP2_WIN_ACT_INFO, dsp_info);
+	vop2_win_write(win, VOP2_WIN_DSP_INFO, dsp_info);
+	vop2_win_write(win, VOP2_WIN_DSP_ST, dest->y1 << 16 | (dest->x1 & 0xffff));
+	vop2_win_write(win, VOP2_WIN_ENABLE, 1);
+}
+
+static void vop2_plane_atomic_update(struct drm_plane *plane,
+				     struct drm_atomic_state *state)
+{
+	struct drm_plane_state *pstate = plane->state;
+	struct drm_crtc *crtc = pstate->crtc;
+	struct vop2_win *win = to_vop2_win(plane);
+	struct vop2_video_port *vp = to_vop2_video_port(crtc);
+	struct drm_display_mode *adjusted_mode = &crtc->state->adjusted_mode;
+	struct vop2 *vop2 = win->vop2;
+	struct drm_framebuffer *fb = pstate->fb;
+	u32 bpp = vop2_get_bpp(fb->format);
+	u32 actual_w, actual_h, dsp_w, dsp_h;
+	u32 act_info, dsp_info;
+	u32 format;
 	u32 afbc_format;
 	u32 rb_swap;
 	u32 uv_swap;
@@ -1187,6 +1845,11 @@ static void vop2_plane_atomic_update(struct drm_plane *plane,
 		return;
 	}
 
+	if (vop2_area_window(win)) {
+		vop2_area_atomic_update(plane);
+		return;
+	}
+
 	afbc_en = rockchip_afbc(plane, fb->modifier);
 
 	offset = (src->x1 >> 16) * fb->format->cpp[0];
@@ -1415,10 +2078,60 @@ static void vop2_plane_atomic_update(struct drm_plane *plane,
 	}
 }
 
+/*
+ * An asynchronous flip only swaps the scanout address: the window must
+ * already be scanning out a framebuffer of the same layout, and only
+ * cluster and esmart windows are allowed to take part.
+ */
+static bool vop2_plane_can_async_flip(struct drm_plane *plane,
+				      struct drm_plane_state *old_pstate,
+				      struct drm_plane_state *new_pstate)
+{
+	struct vop2_win *win = to_vop2_win(plane);
+	struct drm_framebuffer *old_fb = old_pstate->fb;
+	struct drm_framebuffer *new_fb = new_pstate->fb;
+
+	switch (win->data->phys_id) {
+	case ROCKCHIP_VOP2_SMART0:
+	case ROCKCHIP_VOP2_SMART1:
+		return false;
+	default:
+		break;
+	}
+
+	if (!old_pstate->visible || !new_pstate->visible || !new_fb || !old_fb)
+		return false;
+
+	if (old_pstate->crtc != new_pstate->crtc)
+		return false;
+
+	return old_fb->format == new_fb->format &&
+	       old_fb->modifier == new_fb->modifier &&
+	       old_fb->pitches[0] == new_fb->pitches[0] &&
+	       old_fb->pitches[1] == new_fb->pitches[1];
+}
+
+static int vop2_plane_atomic_async_check(struct drm_plane *plane,
+					 struct drm_atomic_state *state, bool flip)
+{
+	struct drm_plane_state *old_pstate = drm_atomic_get_old_plane_state(state, plane);
+	struct drm_plane_state *new_pstate = drm_atomic_get_new_plane_state(state, plane);
+
+	/* There is no cursor plane, async updates are only used for flips */
+	if (!flip)
+		return -EINVAL;
+
+	if (!vop2_plane_can_async_flip(plane, old_pstate, new_pstate))
+		return -EINVAL;
+
+	return 0;
+}
+
 static const struct drm_plane_helper_funcs vop2_plane_helper_funcs = {
 	.atomic_check = vop2_plane_atomic_check,
 	.atomic_update = vop2_plane_atomic_update,
 	.atomic_disable = vop2_plane_atomic_disable,
+	.atomic_async_check = vop2_plane_atomic_async_check,
 };
 
 static const struct drm_plane_funcs vop2_plane_funcs = {
@@ -1675,7 +2388,13 @@ static void vop2_crtc_atomic_enable(struct drm_crtc *crtc,
 		polflags |= BIT(VSYNC_POSITIVE);
 
 	drm_for_each_encoder_mask(encoder, crtc->dev, crtc_state->encoder_mask) {
-		struct rockchip_encoder *rkencoder = to_rockchip_encoder(encoder);
+		struct rockchip_encoder *rkencoder;
+
+		/* The writeback encoder has no output interface */
+		if (encoder->encoder_type == DRM_MODE_ENCODER_VIRTUAL)
+			continue;
+
+		rkencoder = to_rockchip_encoder(encoder);
 
 		/*
 		 * for drive a high resolution(4KP120, 8K), vop on rk3588/rk3576 need
@@ -1753,7 +2472,12 @@ static void vop2_crtc_atomic_enable(struct drm_crtc *crtc,
 	 */
 	if ((vop2->pll_hdmiphy0 || vop2->pll_hdmiphy1) && clock <= VOP2_MAX_DCLK_RATE) {
 		drm_for_each_encoder_mask(encoder, crtc->dev, crtc_state->encoder_mask) {
-			struct rockchip_encoder *rkencoder = to_rockchip_encoder(encoder);
+			struct rockchip_encoder *rkencoder;
+
+			if (encoder->encoder_type == DRM_MODE_ENCODER_VIRTUAL)
+				continue;
+
+			rkencoder = to_rockchip_encoder(encoder);
 
 			if (rkencoder->crtc_endpoint_id == ROCKCHIP_VOP2_EP_HDMI0) {
 				if (!vop2->pll_hdmiphy0)
@@ -1827,6 +2551,316 @@ static int vop2_crtc_atomic_check_gamma(struct vop2_video_port *vp,
 	return 0;
 }
 
+static int vop2_crtc_atomic_check_async_flip(struct vop2_video_port *vp,
+					     struct drm_atomic_state *state,
+					     struct drm_crtc_state *crtc_state)
+{
+	struct drm_plane_state *old_pstate, *new_pstate;
+	struct vop2 *vop2 = vp->vop2;
+	struct drm_plane *plane;
+	int i;
+
+	if (drm_atomic_crtc_needs_modeset(crtc_state) ||
+	    crtc_state->color_mgmt_changed) {
+		drm_dbg_kms(vop2->drm, "vp%d: async flip with a modeset\n", vp->id);
+		return -EINVAL;
+	}
+
+	for_each_oldnew_plane_in_state(state, plane, old_pstate, new_pstate, i) {
+		if (new_pstate->crtc != &vp->crtc && old_pstate->crtc != &vp->crtc)
+			continue;
+
+		if (!vop2_plane_can_async_flip(plane, old_pstate, new_pstate)) {
+			drm_dbg_kms(vop2->drm, "vp%d: %s can't do async flips\n",
+				    vp->id, to_vop2_win(plane)->data->name);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+static struct drm_private_state *
+vop2_bw_duplicate_state(struct drm_private_obj *obj)
+{
+	struct vop2_bw_state *state;
+
+	state = kmemdup(obj->state, sizeof(*state), GFP_KERNEL);
+	if (!state)
+		return NULL;
+
+	__drm_atomic_helper_private_obj_duplicate_state(obj, &state->base);
+
+	return &state->base;
+}
+
+static void vop2_bw_destroy_state(struct drm_private_obj *obj,
+				  struct drm_private_state *state)
+{
+	kfree(to_vop2_bw_state(state));
+}
+
+static const struct drm_private_state_funcs vop2_bw_state_funcs = {
+	.atomic_duplicate_state = vop2_bw_duplicate_state,
+	.atomic_destroy_state = vop2_bw_destroy_state,
+};
+
+/*
+ * Memory bandwidth that the window needs while it is being scanned out,
+ * in MB/s. The window fetches src_h / dst_h source lines for every line
+ * of the output, at the line rate of the mode. AFBC buffers are counted
+ * as uncompressed since the compression ratio depends on the content.
+ */
+static u32 vop2_plane_bandwidth(const struct drm_plane_state *pstate,
+				const struct drm_display_mode *mode)
+{
+	struct drm_framebuffer *fb = pstate->fb;
+	u32 src_w, src_h, dst_h;
+	u64 bw;
+
+	if (!pstate->visible || !fb)
+		return 0;
+
+	src_w = drm_rect_width(&pstate->src) >> 16;
+	src_h = drm_rect_height(&pstate->src) >> 16;
+	dst_h = drm_rect_height(&pstate->dst);
+
+	if (!dst_h || !mode->crtc_htotal)
+		return 0;
+
+	bw = (u64)src_w * vop2_get_bpp(fb->format) * src_h;
+	bw = div_u64(bw * mode->crtc_clock, 8 * dst_h);
+	bw = div_u64(bw, mode->crtc_htotal);
+
+	/* crtc_clock is in kHz */
+	return DIV_ROUND_UP_ULL(bw, 1000);
+}
+
+/* Read bandwidth available on one AXI bus of the VOP, in MB/s */
+static u32 vop2_axi_bw_budget(struct vop2 *vop2)
+{
+	u64 budget = clk_get_rate(vop2->aclk);
+
+	budget *= VOP2_AXI_BYTES_PER_CYCLE * bw_efficiency;
+
+	return div_u64(budget, 100 * 1000000);
+}
+
+static int vop2_crtc_atomic_check_bandwidth(struct vop2_video_port *vp,
+					    struct drm_atomic_state *state,
+					    struct drm_crtc_state *crtc_state)
+{
+	struct rockchip_crtc_state *vcstate = to_rockchip_crtc_state(crtc_state);
+	const struct drm_display_mode *mode = &crtc_state->adjusted_mode;
+	u32 bw[VOP2_SYS_AXI_BUS_NUM] = { 0 };
+	struct vop2 *vop2 = vp->vop2;
+	const struct drm_plane_state *cpstate;
+	struct drm_private_state *priv_state;
+	struct vop2_bw_state *bw_state;
+	struct drm_plane *plane;
+	u32 budget, total;
+	int i, j;
+
+	if (crtc_state->active) {
+		drm_atomic_crtc_state_for_each_plane_state(plane, cpstate, crtc_state) {
+			struct vop2_win *win = to_vop2_win(plane);
+
+			bw[win->data->axi_bus_id] += vop2_plane_bandwidth(cpstate, mode);
+		}
+	}
+
+	BUILD_BUG_ON(sizeof(bw) != sizeof(vcstate->axi_bw));
+
+	/* Only take the global state lock when the usage has changed */
+	if (!memcmp(vcstate->axi_bw, bw, sizeof(bw)))
+		return 0;
+
+	memcpy(vcstate->axi_bw, bw, sizeof(bw));
+
+	priv_state = drm_atomic_get_private_obj_state(state, &vop2->bw_obj);
+	if (IS_ERR(priv_state))
+		return PTR_ERR(priv_state);
+
+	bw_state = to_vop2_bw_state(priv_state);
+	memcpy(bw_state->bw[vp->id], bw, sizeof(bw));
+
+	if (!bw_efficiency)
+		return 0;
+
+	budget = vop2_axi_bw_budget(vop2);
+
+	for (i = 0; i < VOP2_SYS_AXI_BUS_NUM; i++) {
+		total = 0;
+		for (j = 0; j < vop2->data->nr_vps; j++)
+			total += bw_state->bw[j][i];
+
+		if (total > budget) {
+			drm_dbg_kms(vop2->drm,
+				    "vp%d: AXI%d bandwidth %u MB/s exceeds budget %u MB/s\n",
+				    vp->id, i, total, budget);
+			return -ENOSPC;
+		}
+	}
+
+	return 0;
+}
+
+static bool vop2_lines_overlap(const struct drm_rect *a, const struct drm_rect *b)
+{
+	return a->y1 < b->y2 && b->y1 < a->y2;
+}
+
+/*
+ * Areas don't take a layer of their own, they are blended together with
+ * their window. Number the layers of the other planes as if the areas were
+ * not there and give each area the layer of its window, which only keeps the
+ * stacking order as long as no other plane sits between them, see
+ * vop2_crtc_atomic_check_areas().
+ *
+ * The normalized zpos is left alone: the DRM core only recomputes it when
+ * the planes or their zpos change, so the layers are derived from it again
+ * on every check.
+ */
+static void vop2_crtc_assign_layers(struct drm_crtc_state *crtc_state)
+{
+	struct rockchip_crtc_state *vcstate = to_rockchip_crtc_state(crtc_state);
+	const struct drm_plane_state *pstate, *opstate;
+	struct drm_plane *plane, *other;
+
+	drm_atomic_crtc_state_for_each_plane_state(plane, pstate, crtc_state) {
+		unsigned int layer = pstate->normalized_zpos;
+
+		if (vop2_area_window(to_vop2_win(plane)))
+			continue;
+
+		drm_atomic_crtc_state_for_each_plane_state(other, opstate, crtc_state) {
+			if (vop2_area_window(to_vop2_win(other)) &&
+			    opstate->normalized_zpos < pstate->normalized_zpos)
+				layer--;
+		}
+
+		vcstate->plane_layer[drm_plane_index(plane)] = layer;
+	}
+
+	drm_atomic_crtc_state_for_each_plane(plane, crtc_state) {
+		struct vop2_win *win = to_vop2_win(plane);
+
+		if (!vop2_area_window(win))
+			continue;
+
+		if (!(crtc_state->plane_mask & drm_plane_mask(&win->parent->base)))
+			continue;
+
+		vcstate->plane_layer[drm_plane_index(plane)] =
+			vcstate->plane_layer[drm_plane_index(&win->parent->base)];
+	}
+}
+
+/*
+ * All the regions of a window are fetched by the window itself: a visible
+ * area needs its window visible on the same video port with the same
+ * format, alpha and blend mode, no other transform than the area offsets,
+ * and no two regions of a window may share a scan line. As the area is
+ * blended at the level of its window, no other plane may be stacked between
+ * them either.
+ */
+static int vop2_crtc_atomic_check_areas(struct vop2_video_port *vp,
+					struct drm_atomic_state *state,
+					struct drm_crtc_state *crtc_state)
+{
+	struct vop2 *vop2 = vp->vop2;
+	struct drm_plane *plane, *other;
+	bool has_areas = false;
+	int ret;
+
+	drm_atomic_crtc_state_for_each_plane(plane, crtc_state) {
+		if (vop2_area_window(to_vop2_win(plane)))
+			has_areas = true;
+	}
+
+	if (!has_areas)
+		return 0;
+
+	ret = drm_atomic_add_affected_planes(state, &vp->crtc);
+	if (ret)
+		return ret;
+
+	drm_atomic_crtc_state_for_each_plane(plane, crtc_state) {
+		struct vop2_win *win = to_vop2_win(plane);
+		struct drm_plane_state *pstate, *ppstate;
+		unsigned int zmin, zmax;
+
+		if (!vop2_area_window(win))
+			continue;
+
+		pstate = drm_atomic_get_new_plane_state(state, plane);
+		if (!pstate->visible)
+			continue;
+
+		ppstate = NULL;
+		if (crtc_state->plane_mask & drm_plane_mask(&win->parent->base))
+			ppstate = drm_atomic_get_new_plane_state(state, &win->parent->base);
+
+		if (!ppstate || !ppstate->visible) {
+			drm_dbg_kms(vop2->drm, "vp%d: %s area%d without its window\n",
+				    vp->id, win->data->name, win->area_id);
+			return -EINVAL;
+		}
+
+		if (ppstate->fb->format != pstate->fb->format ||
+		    ppstate->fb->modifier != DRM_FORMAT_MOD_LINEAR ||
+		    ppstate->rotation != DRM_MODE_ROTATE_0 ||
+		    ppstate->alpha != pstate->alpha ||
+		    ppstate->pixel_blend_mode != pstate->pixel_blend_mode) {
+			drm_dbg_kms(vop2->drm, "vp%d: %s area%d doesn't match its window\n",
+				    vp->id, win->data->name, win->area_id);
+			return -EINVAL;
+		}
+
+		if (vop2_lines_overlap(&pstate->dst, &ppstate->dst)) {
+			drm_dbg_kms(vop2->drm, "vp%d: %s area%d overlaps its window\n",
+				    vp->id, win->data->name, win->area_id);
+			return -EINVAL;
+		}
+
+		zmin = min(pstate->normalized_zpos, ppstate->normalized_zpos);
+		zmax = max(pstate->normalized_zpos, ppstate->normalized_zpos);
+
+		drm_atomic_crtc_state_for_each_plane(other, crtc_state) {
+			struct vop2_win *owin = to_vop2_win(other);
+			const struct drm_plane_state *opstate;
+
+			if (other == plane || owin == win->parent || owin->parent == win->parent)
+				continue;
+
+			opstate = drm_atomic_get_new_plane_state(state, other);
+			if (opstate->visible && opstate->normalized_zpos > zmin &&
+			    opstate->normalized_zpos < zmax) {
+				drm_dbg_kms(vop2->drm, "vp%d: %s area%d isn't stacked next to its window\n",
+					    vp->id, win->data->name, win->area_id);
+				return -EINVAL;
+			}
+		}
+
+		drm_atomic_crtc_state_for_each_plane(other, crtc_state) {
+			const struct drm_plane_state *opstate;
+
+			if (other == plane || to_vop2_win(other)->parent != win->parent)
+				continue;
+
+			opstate = drm_atomic_get_new_plane_state(state, other);
+			if (opstate->visible &&
+			    vop2_lines_overlap(&pstate->dst, &opstate->dst)) {
+				drm_dbg_kms(vop2->drm, "vp%d: %s area%d overlaps another area\n",
+					    vp->id, win->data->name, win->area_id);
+				return -EINVAL;
+			}
+		}
+	}
+
+	return 0;
+}
+
 static int vop2_crtc_atomic_check(struct drm_crtc *crtc,
 				  struct drm_atomic_state *state)
 {
@@ -1840,13 +2874,27 @@ static int vop2_crtc_atomic_check(struct drm_crtc *crtc,
 	if (ret)
 		return ret;
 
-	drm_atomic_crtc_state_for_each_plane(plane, crtc_state)
-		nplanes++;
+	drm_atomic_crtc_state_for_each_plane(plane, crtc_state) {
+		if (!vop2_area_window(to_vop2_win(plane)))
+			nplanes++;
+	}
 
 	if (nplanes > vp->nlayers)
 		return -EINVAL;
 
-	return 0;
+	ret = vop2_crtc_atomic_check_areas(vp, state, crtc_state);
+	if (ret)
+		return ret;
+
+	vop2_crtc_assign_layers(crtc_state);
+
+	if (crtc_state->async_flip) {
+		ret = vop2_crtc_atomic_check_async_flip(vp, state, crtc_state);
+		if (ret)
+			return ret;
+	}
+
+	return vop2_crtc_atomic_check_bandwidth(vp, state, crtc_state);
 }
 
 static void vop2_crtc_atomic_begin(struct drm_crtc *crtc,
@@ -1855,6 +2903,13 @@ static void vop2_crtc_atomic_begin(struct drm_crtc *crtc,
 	struct vop2_video_port *vp = to_vop2_video_port(crtc);
 	struct vop2 *vop2 = vp->vop2;
 
+	spin_lock_irq(&vop2->wb.lock);
+	if (vop2->wb.vp == vp)
+		vop2->wb.committing = true;
+	if (vop2->wb.crc.vp == vp)
+		vop2->wb.crc.committing = true;
+	spin_unlock_irq(&vop2->wb.lock);
+
 	vop2->ops->setup_overlay(vp);
 }
 
@@ -1864,6 +2919,7 @@ static void vop2_crtc_atomic_flush(struct drm_crtc *crtc,
 	struct drm_crtc_state *crtc_state = drm_atomic_get_new_crtc_state(state, crtc);
 	struct vop2_video_port *vp = to_vop2_video_port(crtc);
 	struct vop2 *vop2 = vp->vop2;
+	struct drm_connector_state *wb_state;
 
 	/* In case of modeset, gamma lut update already happened in atomic enable */
 	if (!drm_atomic_crtc_needs_modeset(crtc_state) && crtc_state->color_mgmt_changed)
@@ -1871,11 +2927,38 @@ static void vop2_crtc_atomic_flush(struct drm_crtc *crtc,
 
 	vop2_post_config(crtc);
 
+	wb_state = vop2_wb_commit(vp, state);
+
+	spin_lock_irq(&vop2->wb.lock);
+	vop2_crc_commit(vp, crtc_state);
+	if (vop2->wb.vp == vp) {
+		/* A job latched during the commit, and not followed by a new one */
+		if (vop2->wb.stop && !wb_state)
+			vop2_wb_disable(vop2);
+		vop2->wb.stop = false;
+		vop2->wb.committing = false;
+	}
 	vop2_cfg_done(vp);
+	if (wb_state)
+		vop2_wb_arm(vp, wb_state);
+	spin_unlock_irq(&vop2->wb.lock);
+
+	vop2_update_icc_bw(vop2, state);
 
 	spin_lock_irq(&crtc->dev->event_lock);
 
+	vp->stats.commits++;
+	vp->stats.flush_time = ktime_get();
+	vp->stats.pending = true;
+	vp->stats.late = false;
+
 	if (crtc->state->event) {
+		/*
+		 * The windows latch their new address at the next frame start,
+		 * async flips included. Until then the old framebuffers are
+		 * still scanned out, so the event is sent from the frame start
+		 * interrupt once cfg_done has been consumed.
+		 */
 		WARN_ON(drm_crtc_vblank_get(crtc));
 		vp->event = crtc->state->event;
 		crtc->state->event = NULL;
@@ -2082,8 +3165,73 @@ static int vop2_active_regs_show(struct seq_file *s, void *data)
 	return 0;
 }
 
+static int vop2_bandwidth_show(struct seq_file *s, void *data)
+{
+	struct drm_info_node *node = s->private;
+	struct vop2 *vop2 = node->info_ent->data;
+	struct drm_device *drm_dev = node->minor->dev;
+	struct vop2_bw_state *bw_state;
+	u32 total[VOP2_SYS_AXI_BUS_NUM] = { 0 };
+	int i, j;
+
+	drm_modeset_lock_all(drm_dev);
+
+	bw_state = to_vop2_bw_state(vop2->bw_obj.state);
+
+	for (i = 0; i < vop2->data->nr_vps; i++) {
+		seq_printf(s, "vp%d:", i);
+		for (j = 0; j < VOP2_SYS_AXI_BUS_NUM; j++) {
+			seq_printf(s, " axi%d %u MB/s", j, bw_state->bw[i][j]);
+			total[j] += bw_state->bw[i][j];
+		}
+		seq_puts(s, "\n");
+	}
+
+	seq_puts(s, "total:");
+	for (j = 0; j < VOP2_SYS_AXI_BUS_NUM; j++)
+		seq_printf(s, " axi%d %u MB/s", j, total[j]);
+	seq_printf(s, "\nbudget: %u MB/s per bus (%u%% of aclk %lu Hz)\n",
+		   vop2_axi_bw_budget(vop2), bw_efficiency, clk_get_rate(vop2->aclk));
+
+	drm_modeset_unlock_all(drm_dev);
+
+	return 0;
+}
+
+static int vop2_timing_show(struct seq_file *s, void *data)
+{
+	struct drm_info_node *node = s->private;
+	struct vop2 *vop2 = node->info_ent->data;
+	struct vop2_vp_stats stats;
+	int i;
+
+	for (i = 0; i < vop2->data->nr_vps; i++) {
+		struct vop2_video_port *vp = &vop2->vps[i];
+
+		if (!vop2_vp_is_used(vp))
+			continue;
+
+		spin_lock_irq(&vop2->drm->event_lock);
+		stats = vp->stats;
+		spin_unlock_irq(&vop2->drm->event_lock);
+
+		seq_printf(s, "vp%d: frames %llu commits %llu late %llu underruns %llu\n",
+			   i, stats.frames, stats.commits, stats.late_commits,
+			   stats.underruns);
+		if (stats.latched)
+			seq_printf(s, "\tflush to frame start: min %u us avg %llu us max %u us\n",
+				   stats.latency_min_us,
+				   div64_u64(stats.latency_sum_us, stats.latched),
+				   stats.latency_max_us);
+	}
+
+	return 0;
+}
+
 static struct drm_info_list vop2_debugfs_list[] = {
 	{ "summary", vop2_summary_show, 0, NULL },
+	{ "bandwidth", vop2_bandwidth_show, 0, NULL },
+	{ "timing", vop2_timing_show, 0, NULL },
 	{ "active_regs", vop2_active_regs_show,   0, NULL },
 	{ "regs", vop2_regs_show,   0, NULL },
 };
@@ -2155,6 +3303,55 @@ static void vop2_crtc_reset(struct drm_crtc *crtc)
 		__drm_atomic_helper_crtc_reset(crtc, NULL);
 }
 
+static int vop2_crtc_set_crc_source(struct drm_crtc *crtc, const char *source_name)
+{
+	struct vop2_video_port *vp = to_vop2_video_port(crtc);
+	int ret = 0;
+
+	if (source_name && strcmp(source_name, "auto"))
+		return -EINVAL;
+
+	ret = drm_modeset_lock_single_interruptible(&crtc->mutex);
+	if (ret)
+		return ret;
+
+	if (!source_name)
+		vop2_crc_stop(vp);
+	else if (!crtc->state->active)
+		ret = -EINVAL;
+	else
+		ret = vop2_crc_start(vp);
+
+	drm_modeset_unlock(&crtc->mutex);
+
+	return ret;
+}
+
+static int vop2_crtc_verify_crc_source(struct drm_crtc *crtc,
+				       const char *source_name,
+				       size_t *values_cnt)
+{
+	struct vop2_video_port *vp = to_vop2_video_port(crtc);
+
+	if (!vp->vop2->data->wb_max_output.width)
+		return -EINVAL;
+
+	if (source_name && strcmp(source_name, "auto"))
+		return -EINVAL;
+
+	*values_cnt = 1;
+
+	return 0;
+}
+
+static const char * const *vop2_crtc_get_crc_sources(struct drm_crtc *crtc,
+						     size_t *count)
+{
+	*count = ARRAY_SIZE(vop2_crc_sources);
+
+	return vop2_crc_sources;
+}
+
 static const struct drm_crtc_funcs vop2_crtc_funcs = {
 	.set_config = drm_atomic_helper_set_config,
 	.page_flip = drm_atomic_helper_page_flip,
@@ -2165,8 +3362,48 @@ static const struct drm_crtc_funcs vop2_crtc_funcs = {
 	.enable_vblank = vop2_crtc_enable_vblank,
 	.disable_vblank = vop2_crtc_disable_vblank,
 	.late_register = vop2_crtc_late_register,
+	.set_crc_source = vop2_crtc_set_crc_source,
+	.verify_crc_source = vop2_crtc_verify_crc_source,
+	.get_crc_sources = vop2_crtc_get_crc_sources,
 };
 
+/*
+ * Called at frame start with the event_lock held. @latched tells whether
+ * the configuration of the last commit has been taken by this frame.
+ */
+static void vop2_vp_stats_frame_start(struct vop2_video_port *vp, bool latched)
+{
+	struct vop2_vp_stats *stats = &vp->stats;
+	u32 latency;
+
+	stats->frames++;
+
+	if (!stats->pending)
+		return;
+
+	if (!latched) {
+		if (!stats->late)
+			stats->late_commits++;
+		stats->late = true;
+		return;
+	}
+
+	latency = ktime_us_delta(ktime_get(), stats->flush_time);
+	if (!stats->latched || latency < stats->latency_min_us)
+		stats->latency_min_us = latency;
+	stats->latency_max_us = max(stats->latency_max_us, latency);
+	stats->latency_sum_us += latency;
+	stats->latched++;
+	stats->pending = false;
+}
+
+static void vop2_vp_stats_underrun(struct vop2_video_port *vp)
+{
+	spin_lock(&vp->vop2->drm->event_lock);
+	vp->stats.underruns++;
+	spin_unlock(&vp->vop2->drm->event_lock);
+}
+
 static irqreturn_t rk3576_vp_isr(int irq, void *data)
 {
 	struct vop2_video_port *vp = data;
@@ -2187,11 +3424,12 @@ static irqreturn_t rk3576_vp_isr(int irq, void *data)
 	}
 
 	if (irqs & VP_INT_FS_FIELD) {
+		u32 val = vop2_readl(vop2, RK3568_REG_CFG_DONE);
+
 		drm_crtc_handle_vblank(crtc);
 		spin_lock(&crtc->dev->event_lock);
+		vop2_vp_stats_frame_start(vp, !(val & BIT(vp->id)));
 		if (vp->event) {
-			u32 val = vop2_readl(vop2, RK3568_REG_CFG_DONE);
-
 			if (!(val & BIT(vp->id))) {
 				drm_crtc_send_vblank_event(crtc, vp->event);
 				vp->event = NULL;
@@ -2204,6 +3442,7 @@ static irqreturn_t rk3576_vp_isr(int irq, void *data)
 	}
 
 	if (irqs & VP_INT_POST_BUF_EMPTY) {
+		vop2_vp_stats_underrun(vp);
 		drm_err_ratelimited(vop2->drm, "POST_BUF_EMPTY irq err at vp%d\n", vp->id);
 		ret = IRQ_HANDLED;
 	}
@@ -2243,10 +3482,14 @@ static irqreturn_t vop2_isr(int irq, void *data)
 			}
 
 			if (irqs & VP_INT_FS_FIELD) {
+				u32 val = vop2_readl(vop2, RK3568_REG_CFG_DONE);
+
+				vop2_wb_handler(vp);
 				drm_crtc_handle_vblank(crtc);
 				spin_lock(&crtc->dev->event_lock);
+				vop2_vp_stats_frame_start(vp, !(val & BIT(vp->id)));
 				if (vp->event) {
-					u32 val = vop2_readl(vop2, RK3568_REG_CFG_DONE);
+					val = vop2_readl(vop2, RK3568_REG_CFG_DONE);
 
 					if (!(val & BIT(vp->id))) {
 						drm_crtc_send_vblank_event(crtc, vp->event);
@@ -2256,10 +3499,14 @@ static irqreturn_t vop2_isr(int irq, void *data)
 				}
 				spin_unlock(&crtc->dev->event_lock);
 
+				/* Must not delay the event with its cfg_done */
+				vop2_crc_handler(vp);
+
 				ret = IRQ_HANDLED;
 			}
 
 			if (irqs & VP_INT_POST_BUF_EMPTY) {
+				vop2_vp_stats_underrun(vp);
 				drm_err_ratelimited(vop2->drm,
 						    "POST_BUF_EMPTY irq err at vp%d\n",
 						    vp->id);
@@ -2280,11 +3527,22 @@ static irqreturn_t vop2_isr(int irq, void *data)
 		}
 	}
 
+	if (axi_irqs[0] & (VOP2_INT_WB_YRGB_FIFO_FULL | VOP2_INT_WB_UV_FIFO_FULL)) {
+		drm_err_ratelimited(vop2->drm, "WB_FIFO_FULL irq err\n");
+		ret = IRQ_HANDLED;
+	}
+
 	pm_runtime_put(vop2->dev);
 
 	return ret;
 }
 
+/* Areas have no AFBC decoder of their own */
+static const uint64_t vop2_area_format_modifiers[] = {
+	DRM_FORMAT_MOD_LINEAR,
+	DRM_FORMAT_MOD_INVALID,
+};
+
 static int vop2_plane_init(struct vop2 *vop2, struct vop2_win *win,
 			   unsigned long possible_crtcs)
 {
@@ -2294,11 +3552,19 @@ static int vop2_plane_init(struct vop2 *vop2, struct vop2_win *win,
 				  BIT(DRM_MODE_BLEND_COVERAGE);
 	int ret;
 
-	ret = drm_universal_plane_init(vop2->drm, &win->base, possible_crtcs,
-				       &vop2_plane_funcs, win_data->formats,
-				       win_data->nformats,
-				       win_data->format_modifiers,
-				       win->type, win_data->name);
+	if (vop2_area_window(win))
+		ret = drm_universal_plane_init(vop2->drm, &win->base, possible_crtcs,
+					       &vop2_plane_funcs, win_data->formats,
+					       win_data->nformats,
+					       vop2_area_format_modifiers,
+					       win->type, "%s-area%d",
+					       win_data->name, win->area_id);
+	else
+		ret = drm_universal_plane_init(vop2->drm, &win->base, possible_crtcs,
+					       &vop2_plane_funcs, win_data->formats,
+					       win_data->nformats,
+					       win_data->format_modifiers,
+					       win->type, win_data->name);
 	if (ret) {
 		drm_err(vop2->drm, "failed to initialize plane %d\n", ret);
 		return ret;
@@ -2306,7 +3572,7 @@ static int vop2_plane_init(struct vop2 *vop2, struct vop2_win *win,
 
 	drm_plane_helper_add(&win->base, &vop2_plane_helper_funcs);
 
-	if (win->data->supported_rotations)
+	if (win->data->supported_rotations && !vop2_area_window(win))
 		drm_plane_create_rotation_property(&win->base, DRM_MODE_ROTATE_0,
 						   DRM_MODE_ROTATE_0 |
 						   win->data->supported_rotations);
@@ -2376,6 +3642,16 @@ static int vop2_create_crtcs(struct vop2 *vop2)
 		np = of_graph_get_remote_node(dev->of_node, i, -1);
 		if (!np) {
 			drm_dbg(vop2->drm, "%s: No remote for vp%d\n", __func__, i);
+
+			/*
+			 * The first unconnected video port can compose planes
+			 * into memory through the writeback connector.
+			 */
+			if (m2m_compositor && vop2_data->wb_max_output.width &&
+			    !vop2->m2m_vp) {
+				vop2->m2m_vp = vp;
+				nvps++;
+			}
 			continue;
 		}
 		of_node_put(np);
@@ -2393,7 +3669,7 @@ static int vop2_create_crtcs(struct vop2 *vop2)
 	for (i = 0; i < vop2_data->nr_vps; i++) {
 		vp = &vop2->vps[i];
 
-		if (!vp->crtc.port)
+		if (!vop2_vp_is_used(vp))
 			continue;
 
 		for (j = 0; j < vop2->registered_num_wins; j++) {
@@ -2422,6 +3698,13 @@ static int vop2_create_crtcs(struct vop2 *vop2)
 				break;
 			}
 		}
+
+		if (vp == vop2->m2m_vp && !vp->primary_plane) {
+			drm_info(vop2->drm, "no window left for the compositor on vp%d\n",
+				 vp->id);
+			vop2->m2m_vp = NULL;
+			nvps--;
+		}
 	}
 
 	/* Register all unused window as overlay plane */
@@ -2442,7 +3725,7 @@ static int vop2_create_crtcs(struct vop2 *vop2)
 		for (j = 0; j < vop2_data->nr_vps; j++) {
 			vp = &vop2->vps[j];
 
-			if (!vp->crtc.port)
+			if (!vop2_vp_is_used(vp))
 				continue;
 
 			if (win->data->possible_vp_mask & BIT(vp->id))
@@ -2459,7 +3742,7 @@ static int vop2_create_crtcs(struct vop2 *vop2)
 	for (i = 0; i < vop2_data->nr_vps; i++) {
 		vp = &vop2->vps[i];
 
-		if (!vp->crtc.port)
+		if (!vop2_vp_is_used(vp))
 			continue;
 
 		plane = &vp->primary_plane->base;
@@ -2489,7 +3772,7 @@ static int vop2_create_crtcs(struct vop2 *vop2)
 	for (i = 0; i < vop2->data->nr_vps; i++) {
 		struct vop2_video_port *vp = &vop2->vps[i];
 
-		if (vp->crtc.port)
+		if (vop2_vp_is_used(vp))
 			vp->nlayers = vop2_data->win_size / nvps;
 	}
 
@@ -2558,11 +3841,53 @@ static int vop2_regmap_init(struct vop2_win *win, const struct reg_field *regs,
 	return 0;
 };
 
+/*
+ * An area uses the region 0 fields of the window shifted to its own
+ * region, all the registers outside of the region block are left to the
+ * window. Only region 0 has a scaler, so the scaler fields are left out
+ * too.
+ */
+static int vop2_area_regmap_init(struct vop2_win *area)
+{
+	const struct reg_field *regs = area->vop2->data->smart_reg;
+	struct vop2 *vop2 = area->vop2;
+	int i;
+
+	for (i = 0; i < vop2->data->nr_smart_regs; i++) {
+		const struct reg_field field = {
+			.reg = (regs[i].reg >= RK3568_SMART_REGION0_CTRL &&
+				regs[i].reg < RK3568_SMART_REGION0_SCL_CTRL) ?
+				regs[i].reg + area->offset : 0xffffffff,
+			.lsb = regs[i].lsb,
+			.msb = regs[i].msb
+		};
+
+		area->reg[i] = devm_regmap_field_alloc(vop2->dev, vop2->map, field);
+		if (IS_ERR(area->reg[i]))
+			return PTR_ERR(area->reg[i]);
+	}
+
+	return 0;
+}
+
+static unsigned int vop2_nr_areas(const struct vop2_data *vop2_data)
+{
+	unsigned int i, nr_areas = 0;
+
+	for (i = 0; i < vop2_data->win_size; i++) {
+		if (vop2_data->win[i].feature & WIN_FEATURE_MULTI_AREA)
+			nr_areas += VOP2_WIN_MAX_AREAS;
+	}
+
+	return nr_areas;
+}
+
 static int vop2_win_init(struct vop2 *vop2)
 {
 	const struct vop2_data *vop2_data = vop2->data;
-	struct vop2_win *win;
-	int i, ret;
+	struct vop2_win *win, *area;
+	int i, j, ret;
+	int nr_wins;
 
 	for (i = 0; i < vop2_data->win_size; i++) {
 		const struct vop2_win_data *win_data = &vop2_data->win[i];
@@ -2583,7 +3908,30 @@ static int vop2_win_init(struct vop2 *vop2)
 			return ret;
 	}
 
-	vop2->registered_num_wins = vop2_data->win_size;
+	/* The extra areas are registered after all the windows */
+	nr_wins = vop2_data->win_size;
+	for (i = 0; i < vop2_data->win_size; i++) {
+		win = &vop2->win[i];
+
+		if (!(win->data->feature & WIN_FEATURE_MULTI_AREA))
+			continue;
+
+		for (j = 1; j <= VOP2_WIN_MAX_AREAS; j++) {
+			area = &vop2->win[nr_wins];
+			area->data = win->data;
+			area->type = DRM_PLANE_TYPE_OVERLAY;
+			area->parent = win;
+			area->area_id = j;
+			area->offset = win->offset + j * VOP2_WIN_AREA_STRIDE;
+			area->win_id = nr_wins++;
+			area->vop2 = vop2;
+			ret = vop2_area_regmap_init(area);
+			if (ret)
+				return ret;
+		}
+	}
+
+	vop2->registered_num_wins = nr_wins;
 
 	return 0;
 }
@@ -2616,6 +3964,7 @@ static const struct regmap_config vop2_regmap_config = {
 static int vop2_bind(struct device *dev, struct device *master, void *data)
 {
 	struct platform_device *pdev = to_platform_device(dev);
+	struct vop2_bw_state *bw_state;
 	const struct vop2_data *vop2_data;
 	struct drm_device *drm = data;
 	struct vop2 *vop2;
@@ -2628,7 +3977,7 @@ static int vop2_bind(struct device *dev, struct device *master, void *data)
 		return -ENODEV;
 
 	/* Allocate vop2 struct and its vop2_win array */
-	alloc_size = struct_size(vop2, win, vop2_data->win_size);
+	alloc_size = struct_size(vop2, win, vop2_data->win_size + vop2_nr_areas(vop2_data));
 	vop2 = devm_kzalloc(dev, alloc_size, GFP_KERNEL);
 	if (!vop2)
 		return -ENOMEM;
@@ -2709,6 +4058,15 @@ static int vop2_bind(struct device *dev, struct device *master, void *data)
 		return dev_err_probe(drm->dev, PTR_ERR(vop2->pclk),
 				     "failed to get pclk source\n");
 
+	/* NULL if the DT has no path to the DDR for the VOP */
+	vop2->icc_path = devm_of_icc_get(vop2->dev, "dma-mem");
+	if (IS_ERR(vop2->icc_path))
+		return dev_err_probe(drm->dev, PTR_ERR(vop2->icc_path),
+				     "failed to get the interconnect path\n");
+
+	if (vop2->version == VOP_VERSION_RK3588)
+		icc_set_tag(vop2->icc_path, RK3588_ICC_TAG_PRIO_HIGH);
+
 	vop2->pll_hdmiphy0 = devm_clk_get_optional(vop2->dev, "pll_hdmiphy0");
 	if (IS_ERR(vop2->pll_hdmiphy0))
 		return dev_err_probe(drm->dev, PTR_ERR(vop2->pll_hdmiphy0),
@@ -2733,6 +4091,12 @@ static int vop2_bind(struct device *dev, struct device *master, void *data)
 	if (ret)
 		return ret;
 
+	ret = vop2_wb_init(vop2);
+	if (ret)
+		return ret;
+
+	drm->mode_config.async_page_flip = true;
+
 	if (vop2->version >= VOP_VERSION_RK3576) {
 		struct drm_crtc *crtc;
 
@@ -2770,12 +4134,24 @@ static int vop2_bind(struct device *dev, struct device *master, void *data)
 		}
 	}
 
+	bw_state = kzalloc(sizeof(*bw_state), GFP_KERNEL);
+	if (!bw_state) {
+		ret = -ENOMEM;
+		goto err_rgb;
+	}
+
+	drm_atomic_private_obj_init(drm, &vop2->bw_obj, &bw_state->base,
+				    &vop2_bw_state_funcs);
+
 	rockchip_drm_dma_init_device(vop2->drm, vop2->dev);
 
 	pm_runtime_enable(&pdev->dev);
 
 	return 0;
 
+err_rgb:
+	if (vop2->rgb)
+		rockchip_rgb_fini(vop2->rgb);
 err_crtcs:
 	vop2_destroy_crtcs(vop2);
 
@@ -2788,6 +4164,8 @@ static void vop2_unbind(struct device *dev, struct device *master, void *data)
 
 	pm_runtime_disable(dev);
 
+	drm_atomic_private_obj_fini(&vop2->bw_obj);
+
 	if (vop2->rgb)
 		rockchip_rgb_fini(vop2->rgb);
 
@@ -8,7 +8,9 @@
 #define _ROCKCHIP_DRM_VOP2_H
 
 #include <linux/regmap.h>
+#include <linux/workqueue.h>
 #include <drm/drm_modes.h>
+#include <drm/drm_writeback.h>
 #include <dt-bindings/soc/rockchip,vop2.h>
 #include "rockchip_drm_drv.h"
 #include "rockchip_drm_vop.h"
@@ -32,6 +34,16 @@
 
 #define WIN_FEATURE_AFBDC		BIT(0)
 #define WIN_FEATURE_CLUSTER		BIT(1)
+/* Fetches extra areas through its REGION1..3 registers */
+#define WIN_FEATURE_MULTI_AREA		BIT(2)
+
+/* Areas of a multi-area window besides region 0 */
+#define VOP2_WIN_MAX_AREAS		3
+#define VOP2_WIN_AREA_STRIDE		(RK3568_SMART_REGION1_CTRL - RK3568_SMART_REGION0_CTRL)
+
+#define VOP2_SYS_AXI_BUS_NUM		2
+/* Width of each AXI master port of the VOP */
+#define VOP2_AXI_BYTES_PER_CYCLE	16
 
 #define HIWORD_UPDATE(v, h, l)  ((GENMASK(h, l) << 16) | ((v) << (l)))
 /*
@@ -217,6 +229,14 @@ struct vop2_win {
 	u8 delay;
 	u32 offset;
 
+	/**
+	 * @parent: window whose region 0 this area belongs to, NULL unless
+	 * this is an extra area of a multi-area window.
+	 */
+	struct vop2_win *parent;
+	/** @area_id: region index of an area, 0 for a whole window */
+	u8 area_id;
+
 	enum drm_plane_type type;
 };
 
@@ -234,6 +254,47 @@ struct vop2_video_port_data {
 	u8 pixel_rate;
 };
 
+/**
+ * struct vop2_vp_stats - frame timing statistics of a video port
+ *
+ * A commit is latched at the first frame start after its cfg_done, the
+ * latency is measured from the atomic flush to that frame start.
+ */
+struct vop2_vp_stats {
+	/** @frames: number of frame start interrupts */
+	u64 frames;
+
+	/** @commits: number of atomic flushes */
+	u64 commits;
+
+	/** @late_commits: commits that missed the first frame start after the flush */
+	u64 late_commits;
+
+	/** @underruns: number of post buffer empty interrupts */
+	u64 underruns;
+
+	/** @latency_min_us: shortest flush to frame start latency */
+	u32 latency_min_us;
+
+	/** @latency_max_us: longest flush to frame start latency */
+	u32 latency_max_us;
+
+	/** @latency_sum_us: sum of the latencies of all latched commits */
+	u64 latency_sum_us;
+
+	/** @latched: number of commits the latency has been measured for */
+	u64 latched;
+
+	/** @flush_time: time of the flush of the commit waiting to be latched */
+	ktime_t flush_time;
+
+	/** @pending: a commit is waiting to be latched */
+	bool pending;
+
+	/** @late: the pending commit already missed a frame start */
+	bool late;
+};
+
 struct vop2_video_port {
 	struct drm_crtc crtc;
 	struct vop2 *vop2;
@@ -253,6 +314,9 @@ struct vop2_video_port {
 	struct drm_pending_vblank_event *event;
 
 	unsigned int nlayers;
+
+	/** @stats: frame timing statistics, protected by the drm event_lock */
+	struct vop2_vp_stats stats;
 };
 
 /**
@@ -267,6 +331,93 @@ struct vop2_ops {
 	void (*setup_overlay)(struct vop2_video_port *vp);
 };
 
+/**
+ * struct vop2_wb_crc - CRC capture through the writeback engine
+ *
+ * The composed output is written back continuously, rotating through
+ * three buffers, and the CRC of each complete frame is computed by a work
+ * item while the next two frames are written. The fields are protected
+ * by &vop2_wb.lock.
+ */
+struct vop2_wb_crc {
+	/** @vp: video port the CRCs are captured from, NULL if disabled */
+	struct vop2_video_port *vp;
+
+	/** @buf: capture buffers, sized for the mode of @vp at enable time */
+	struct rockchip_gem_object *buf[3];
+
+	/** @len: size of a frame in the capture buffers */
+	size_t len;
+
+	/** @running: the writeback engine is capturing to the buffers */
+	bool running;
+
+	/** @valid: the buffer written by the current frame started at a frame start */
+	bool valid;
+
+	/** @committing: a commit is programming @vp, don't issue cfg_done */
+	bool committing;
+
+	/** @hw: buffer being written by the current frame */
+	unsigned int hw;
+
+	/** @reg: buffer programmed for the next frame */
+	unsigned int reg;
+
+	/** @busy: buffer being checksummed by @work, -1 if none */
+	int busy;
+
+	/** @frame: vblank count of the frame stored in the busy buffer */
+	u32 frame;
+
+	/** @work: computes the CRC of the busy buffer */
+	struct work_struct work;
+};
+
+/**
+ * struct vop2_wb - writeback state
+ *
+ * A single writeback engine can be attached to any of the video ports,
+ * it stores the composed output of that port to memory.
+ */
+struct vop2_wb {
+	struct drm_writeback_connector conn;
+
+	/** @lock: protects the fields below against the interrupt handler */
+	spinlock_t lock;
+
+	/** @vp: video port the queued jobs are written back from */
+	struct vop2_video_port *vp;
+
+	/** @armed: a job has been programmed but not latched yet */
+	bool armed;
+
+	/** @active: the job latched at the last frame start is being written */
+	bool active;
+
+	/** @committing: a commit is programming @vp, don't issue cfg_done */
+	bool committing;
+
+	/** @stop: the commit programming @vp has to stop the engine */
+	bool stop;
+
+	/** @crc: CRC capture state, see vop2_crc_handler() */
+	struct vop2_wb_crc crc;
+};
+
+/**
+ * struct vop2_bw_state - global memory bandwidth state
+ *
+ * Only acquired by commits that change the bandwidth used by a video
+ * port, see vop2_crtc_atomic_check_bandwidth().
+ */
+struct vop2_bw_state {
+	struct drm_private_state base;
+
+	/** @bw: MB/s read by each video port from each AXI bus */
+	u32 bw[ROCKCHIP_MAX_CRTC][VOP2_SYS_AXI_BUS_NUM];
+};
+
 struct vop2_data {
 	u8 nr_vps;
 	u64 feature;
@@ -279,6 +430,8 @@ struct vop2_data {
 	const struct vop2_regs_dump *regs_dump;
 	struct vop_rect max_input;
 	struct vop_rect max_output;
+	/* Largest writeback frame, zero if there is no writeback engine */
+	struct vop_rect wb_max_output;
 
 	unsigned int nr_cluster_regs;
 	unsigned int nr_smart_regs;
@@ -334,6 +487,18 @@ struct vop2 {
 	/* optional internal rgb encoder */
 	struct rockchip_rgb *rgb;
 
+	struct vop2_wb wb;
+
+	struct drm_private_obj bw_obj;
+	/* Path from the VOP to the DDR, NULL if the DT doesn't describe it */
+	struct icc_path *icc_path;
+
+	/*
+	 * Video port without output, registered to compose planes into
+	 * memory through the writeback connector.
+	 */
+	struct vop2_video_port *m2m_vp;
+
 	/* must be put at the end of the struct */
 	struct vop2_win win[];
 };
@@ -696,6 +861,16 @@ enum dst_factor_mode {
 #define RK3588_DSP_IF_POL__DP0_PIN_POL			GENMASK(10, 8)
 
 #define RK3588_LUT_PORT_SEL__GAMMA_AHB_WRITE_SEL	GENMASK(13, 12)
+#define RK3568_LUT_PORT_SEL__WB_PORT_SEL		GENMASK(9, 8)
+
+#define RK3568_WB_CTRL__SCALE_Y_EN			BIT(8)
+#define RK3568_WB_CTRL__SCALE_X_EN			BIT(7)
+#define RK3568_WB_CTRL__R2Y_EN				BIT(5)
+#define RK3568_WB_CTRL__DITHER_EN			BIT(4)
+#define RK3568_WB_CTRL__FORMAT				GENMASK(3, 1)
+#define RK3568_WB_CTRL__ENABLE				BIT(0)
+
+#define RK3568_WB_XSCAL_FACTOR__FIFO_THROD		GENMASK(9, 0)
 
 #define RK3568_VP0_MIPI_CTRL__DCLK_DIV2_PHASE_LOCK	BIT(5)
 #define RK3568_VP0_MIPI_CTRL__DCLK_DIV2			BIT(4)
@@ -704,8 +879,6 @@ enum dst_factor_mode {
 
 #define RK3568_DSP_IF_POL__CFG_DONE_IMD			BIT(28)
 
-#define VOP2_SYS_AXI_BUS_NUM				2
-
 #define VOP2_CLUSTER_YUV444_10				0x12
 
 #define VOP2_COLOR_KEY_MASK				BIT(31)
@@ -751,6 +924,10 @@ enum dst_factor_mode {
 #define VP_INT_LINE_FLAG1	BIT(3)
 #define VP_INT_LINE_FLAG0	BIT(2)
 #define VOP2_INT_BUS_ERRPR	BIT(1)
+
+#define VOP2_INT_WB_COMPLETE		BIT(5)
+#define VOP2_INT_WB_YRGB_FIFO_FULL	BIT(4)
+#define VOP2_INT_WB_UV_FIFO_FULL	BIT(3)
 #define VP_INT_FS		BIT(0)
 
 #define POLFLAG_DCLK_INV	BIT(3)
@@ -820,6 +997,28 @@ static inline bool vop2_cluster_window(const struct vop2_win *win)
 	return win->data->feature & WIN_FEATURE_CLUSTER;
 }
 
+static inline bool vop2_area_window(const struct vop2_win *win)
+{
+	return win->parent;
+}
+
+/*
+ * Layer of the overlay the plane is blended on. This is its normalized zpos,
+ * without the areas, which share the layer of their window.
+ */
+static inline unsigned int vop2_plane_layer(struct vop2_video_port *vp,
+					    struct drm_plane *plane)
+{
+	struct rockchip_crtc_state *vcstate = to_rockchip_crtc_state(vp->crtc.state);
+
+	return vcstate->plane_layer[drm_plane_index(plane)];
+}
+
+static inline bool vop2_vp_is_used(const struct vop2_video_port *vp)
+{
+	return vp->crtc.port || vp == vp->vop2->m2m_vp;
+}
+
 static inline struct vop2_video_port *to_vop2_video_port(struct drm_crtc *crtc)
 {
 	return container_of(crtc, struct vop2_video_port, crtc);
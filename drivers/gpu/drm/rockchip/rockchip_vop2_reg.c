@@ -1205,6 +1205,7 @@ static const struct vop2_win_data rk3588_vop_win_data[] = {
 		.layer_sel_id = { 2, 2, 2, 2 },
 		.supported_rotations = DRM_MODE_REFLECT_Y,
 		.type = DRM_PLANE_TYPE_OVERLAY,
+		.feature = WIN_FEATURE_MULTI_AREA,
 		.axi_bus_id = 0,
 		.axi_yrgb_r_id = 0x0a,
 		.axi_uv_r_id = 0x0b,
@@ -1222,6 +1223,7 @@ static const struct vop2_win_data rk3588_vop_win_data[] = {
 		.layer_sel_id = { 3, 3, 3, 3 },
 		.supported_rotations = DRM_MODE_REFLECT_Y,
 		.type = DRM_PLANE_TYPE_OVERLAY,
+		.feature = WIN_FEATURE_MULTI_AREA,
 		.axi_bus_id = 0,
 		.axi_yrgb_r_id = 0x0c,
 		.axi_uv_r_id = 0x01,
@@ -1239,6 +1241,7 @@ static const struct vop2_win_data rk3588_vop_win_data[] = {
 		.layer_sel_id =  { 6, 6, 6, 6 },
 		.supported_rotations = DRM_MODE_REFLECT_Y,
 		.type = DRM_PLANE_TYPE_OVERLAY,
+		.feature = WIN_FEATURE_MULTI_AREA,
 		.axi_bus_id = 1,
 		.axi_yrgb_r_id = 0x0a,
 		.axi_uv_r_id = 0x0b,
@@ -1256,6 +1259,7 @@ static const struct vop2_win_data rk3588_vop_win_data[] = {
 		.layer_sel_id =  { 7, 7, 7, 7 },
 		.supported_rotations = DRM_MODE_REFLECT_Y,
 		.type = DRM_PLANE_TYPE_OVERLAY,
+		.feature = WIN_FEATURE_MULTI_AREA,
 		.axi_bus_id = 1,
 		.axi_yrgb_r_id = 0x0c,
 		.axi_uv_r_id = 0x0d,
@@ -1941,7 +1945,11 @@ static void vop2_setup_alpha(struct vop2_video_port *vp)
 	drm_atomic_crtc_for_each_plane(plane, &vp->crtc) {
 		struct vop2_win *win = to_vop2_win(plane);
 
-		if (plane->state->normalized_zpos == 0 &&
+		/* Areas are blended on the layer of their window */
+		if (vop2_area_window(win))
+			continue;
+
+		if (vop2_plane_layer(vp, plane) == 0 &&
 		    !is_opaque(plane->state->alpha) &&
 		    !vop2_cluster_window(win)) {
 			/*
@@ -1968,12 +1976,12 @@ static void vop2_setup_alpha(struct vop2_video_port *vp)
 
 	drm_atomic_crtc_for_each_plane(plane, &vp->crtc) {
 		struct vop2_win *win = to_vop2_win(plane);
-		int zpos = plane->state->normalized_zpos;
+		int zpos = vop2_plane_layer(vp, plane);
 
 		/*
 		 * Need to configure alpha from second layer.
 		 */
-		if (zpos == 0)
+		if (zpos == 0 || vop2_area_window(win))
 			continue;
 
 		if (plane->state->pixel_blend_mode == DRM_MODE_BLEND_PREMULTI)
@@ -2109,7 +2117,10 @@ static void rk3568_vop2_setup_layer_mixer(struct vop2_video_port *vp)
 		struct vop2_win *win = to_vop2_win(plane);
 		struct vop2_win *old_win;
 
-		layer_id = (u8)(plane->state->normalized_zpos + ofs);
+		if (vop2_area_window(win))
+			continue;
+
+		layer_id = (u8)(vop2_plane_layer(vp, plane) + ofs);
 		/*
 		 * Find the layer this win bind in old state.
 		 */
@@ -2241,6 +2252,9 @@ static void rk3568_vop2_setup_overlay(struct vop2_video_port *vp)
 	drm_atomic_crtc_for_each_plane(plane, crtc) {
 		struct vop2_win *win = to_vop2_win(plane);
 
+		if (vop2_area_window(win))
+			continue;
+
 		win->delay = win->data->dly[VOP2_DLY_MODE_DEFAULT];
 
 		vp->win_mask |= BIT(win->data->phys_id);
@@ -2275,10 +2289,14 @@ static void rk3576_vop2_setup_layer_mixer(struct vop2_video_port *vp)
 
 	drm_atomic_crtc_for_each_plane(plane, &vp->crtc) {
 		struct vop2_win *win = to_vop2_win(plane);
+		unsigned int layer = vop2_plane_layer(vp, plane);
+
+		/* Areas are blended on the layer of their window */
+		if (vop2_area_window(win))
+			continue;
 
-		layer_sel &= ~RK3568_OVL_LAYER_SEL__LAYER(plane->state->normalized_zpos,
-							  0xf);
-		layer_sel |= RK3568_OVL_LAYER_SEL__LAYER(plane->state->normalized_zpos,
+		layer_sel &= ~RK3568_OVL_LAYER_SEL__LAYER(layer, 0xf);
+		layer_sel |= RK3568_OVL_LAYER_SEL__LAYER(layer,
 							 win->data->layer_sel_id[vp->id]);
 	}
 
@@ -2383,6 +2401,7 @@ static const struct vop2_data rk3566_vop = {
 	.nr_vps = 3,
 	.max_input = { 4096, 2304 },
 	.max_output = { 4096, 2304 },
+	.wb_max_output = { 1920, 1080 },
 	.vp = rk3568_vop_video_ports,
 	.win = rk3568_vop_win_data,
 	.win_size = ARRAY_SIZE(rk3568_vop_win_data),
@@ -2402,6 +2421,7 @@ static const struct vop2_data rk3568_vop = {
 	.nr_vps = 3,
 	.max_input = { 4096, 2304 },
 	.max_output = { 4096, 2304 },
+	.wb_max_output = { 1920, 1080 },
 	.vp = rk3568_vop_video_ports,
 	.win = rk3568_vop_win_data,
 	.win_size = ARRAY_SIZE(rk3568_vop_win_data),
@@ -2441,6 +2461,7 @@ static const struct vop2_data rk3588_vop = {
 	.nr_vps = 4,
 	.max_input = { 4096, 4320 },
 	.max_output = { 4096, 4320 },
+	.wb_max_output = { 2560, 1600 },
 	.vp = rk3588_vop_video_ports,
 	.win = rk3588_vop_win_data,
 	.win_size = ARRAY_SIZE(rk3588_vop_win_data),
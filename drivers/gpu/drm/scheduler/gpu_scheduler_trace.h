@@ -106,6 +106,49 @@ TRACE_EVENT(drm_sched_job_wait_dep,
 		      __entry->seqno)
 );
 
+/*
+ * Emitted when a finished job is freed, with the time the job spent
+ * waiting for its dependencies and for the hardware (submit to run, where
+ * run is when the previous job on the ring finished if that was later),
+ * running on the hardware (run to hardware fence), until the scheduler
+ * signalled its finished fence, and until it got freed. Meant to be fed to
+ * hist triggers, e.g. "hist:keys=name:vals=hw_ns".
+ */
+TRACE_EVENT(drm_sched_job_latency,
+	    TP_PROTO(struct drm_sched_job *sched_job),
+	    TP_ARGS(sched_job),
+	    TP_STRUCT__entry(
+			     __string(name, sched_job->sched->name)
+			     __field(uint64_t, id)
+			     __field(s64, wait_ns)
+			     __field(s64, hw_ns)
+			     __field(s64, signal_ns)
+			     __field(s64, free_ns)
+			     ),
+
+	    TP_fast_assign(
+			   struct drm_sched_fence *s_fence = sched_job->s_fence;
+			   struct dma_fence *parent = s_fence->parent;
+			   ktime_t run = s_fence->scheduled.timestamp;
+			   ktime_t done = dma_fence_timestamp(&s_fence->finished);
+			   /* Jobs that failed to run have no hardware fence */
+			   ktime_t hw = parent && test_bit(DMA_FENCE_FLAG_TIMESTAMP_BIT,
+							   &parent->flags) ?
+					parent->timestamp : done;
+
+			   __assign_str(name);
+			   __entry->id = sched_job->id;
+			   __entry->wait_ns = ktime_to_ns(ktime_sub(run,
+							sched_job->submit_ts));
+			   __entry->hw_ns = ktime_to_ns(ktime_sub(hw, run));
+			   __entry->signal_ns = ktime_to_ns(ktime_sub(done, hw));
+			   __entry->free_ns = ktime_to_ns(ktime_sub(ktime_get(), done));
+			   ),
+	    TP_printk("ring=%s, id=%llu, wait=%lldns, hw=%lldns, signal=%lldns, free=%lldns",
+		      __get_str(name), __entry->id, __entry->wait_ns,
+		      __entry->hw_ns, __entry->signal_ns, __entry->free_ns)
+);
+
 #endif /* _GPU_SCHED_TRACE_H_ */
 
 /* This part must be outside protection */
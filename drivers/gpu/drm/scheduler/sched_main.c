@@ -1180,8 +1180,10 @@ static void drm_sched_free_job_work(struct work_struct *w)
 	struct drm_sched_job *job;
 
 	job = drm_sched_get_finished_job(sched);
-	if (job)
+	if (job) {
+		trace_drm_sched_job_latency(job);
 		sched->ops->free_job(job);
+	}
 
 	drm_sched_run_free_queue(sched);
 	drm_sched_run_job_queue(sched);
@@ -0,0 +1,508 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Rockchip RK3588 NoC QoS interconnect provider
+ *
+ * Each bus master of the RK3588 reaches the DDR through one or more NoC QoS
+ * generators. Those can regulate the traffic of the master: while the master
+ * stays below its bandwidth budget, its requests use the high priority level,
+ * and fall back to the low priority level once the budget is exhausted.
+ *
+ * Bandwidth votes on a master are turned into such a budget, which lets
+ * latency-sensitive masters (display, camera) get the bandwidth they need when
+ * the GPU or NPU saturate the DDR. Masters without votes keep the QoS
+ * configuration set by the firmware.
+ *
+ * The QoS generators live in the power domain of their master, listed under
+ * the name of the master in the power domains of the NoC. The provider keeps
+ * that domain on while it accesses the generators, and the power domain driver
+ * saves and restores their configuration across power cycles.
+ */
+
+#include <linux/bitfield.h>
+#include <linux/clk.h>
+#include <linux/device.h>
+#include <linux/interconnect-provider.h>
+#include <linux/mfd/syscon.h>
+#include <linux/module.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+#include <linux/pm_domain.h>
+#include <linux/pm_runtime.h>
+#include <linux/regmap.h>
+#include <linux/slab.h>
+
+#include <dt-bindings/interconnect/rockchip,rk3588.h>
+
+#define QOS_PRIORITY			0x08
+#define QOS_PRIORITY_P1			GENMASK(9, 8)
+#define QOS_PRIORITY_P0			GENMASK(1, 0)
+#define QOS_MODE			0x0c
+#define QOS_MODE_FIXED			0
+#define QOS_MODE_LIMITER		1
+#define QOS_MODE_BYPASS			2
+#define QOS_MODE_REGULATOR		3
+#define QOS_BANDWIDTH			0x10
+#define QOS_BANDWIDTH_MAX		GENMASK(12, 0)
+#define QOS_SATURATION			0x14
+#define QOS_SATURATION_MAX		GENMASK(9, 0)
+
+/* Bandwidth is expressed in 1/256th of a byte per NoC cycle. */
+#define QOS_BANDWIDTH_FRAC		256
+
+/* Saturation is expressed in units of 16 bytes. */
+#define QOS_SATURATION_UNIT		16
+
+/* Let masters burst over their budget for about this long. */
+#define QOS_SATURATION_WINDOW_US	1
+
+#define RK3588_NOC_MAX_QOS_PORTS	8
+
+struct rk3588_noc_qos {
+	struct regmap *regmap;
+	bool saved;
+	u32 priority;
+	u32 mode;
+	u32 bandwidth;
+	u32 saturation;
+};
+
+struct rk3588_noc_master {
+	struct rk3588_noc *noc;
+	const char *name;
+	unsigned int id;
+
+	struct rk3588_noc_qos qos[RK3588_NOC_MAX_QOS_PORTS];
+	unsigned int num_qos;
+
+	/* Power domain of the QoS generators, NULL if always on. */
+	struct device *pd_dev;
+
+	/* Highest priority requested through the path tags. */
+	u32 prio;
+};
+
+struct rk3588_noc {
+	struct device *dev;
+	struct icc_provider provider;
+	struct icc_onecell_data *data;
+	struct clk *clk;
+	struct dev_pm_domain_list *pd_list;
+	struct rk3588_noc_master masters[];
+};
+
+static const struct {
+	unsigned int id;
+	const char *name;
+} rk3588_noc_masters[] = {
+	{ RK3588_ICC_MASTER_VOP, "vop" },
+	{ RK3588_ICC_MASTER_GPU, "gpu" },
+	{ RK3588_ICC_MASTER_NPU, "npu" },
+	{ RK3588_ICC_MASTER_VDEC, "vdec" },
+	{ RK3588_ICC_MASTER_VENC, "venc" },
+	{ RK3588_ICC_MASTER_ISP, "isp" },
+	{ RK3588_ICC_MASTER_VICAP, "vicap" },
+	{ RK3588_ICC_MASTER_RGA, "rga" },
+	{ RK3588_ICC_MASTER_JPEG, "jpeg" },
+	{ RK3588_ICC_MASTER_HDMIRX, "hdmirx" },
+};
+
+#define RK3588_NOC_NUM_MASTERS		ARRAY_SIZE(rk3588_noc_masters)
+
+/* The DDR node comes first, then the masters. */
+#define RK3588_NOC_FIRST_ID		RK3588_ICC_NOC_DDR
+#define RK3588_NOC_NUM_NODES		(RK3588_NOC_NUM_MASTERS + 1)
+
+static void rk3588_noc_qos_restore(struct rk3588_noc_qos *qos)
+{
+	if (!qos->saved)
+		return;
+
+	regmap_write(qos->regmap, QOS_PRIORITY, qos->priority);
+	regmap_write(qos->regmap, QOS_MODE, qos->mode);
+	regmap_write(qos->regmap, QOS_BANDWIDTH, qos->bandwidth);
+	regmap_write(qos->regmap, QOS_SATURATION, qos->saturation);
+
+	/* Back to the firmware configuration, the next vote saves it again. */
+	qos->saved = false;
+}
+
+static void rk3588_noc_qos_regulate(struct rk3588_noc_qos *qos, u32 prio,
+				    u32 bandwidth, u32 saturation)
+{
+	/*
+	 * Save the firmware configuration, to restore it when votes go away.
+	 * This can't be done at probe time, because the power domain of the
+	 * master might be off.
+	 */
+	if (!qos->saved) {
+		regmap_read(qos->regmap, QOS_PRIORITY, &qos->priority);
+		regmap_read(qos->regmap, QOS_MODE, &qos->mode);
+		regmap_read(qos->regmap, QOS_BANDWIDTH, &qos->bandwidth);
+		regmap_read(qos->regmap, QOS_SATURATION, &qos->saturation);
+		qos->saved = true;
+	}
+
+	regmap_write(qos->regmap, QOS_PRIORITY,
+		     FIELD_PREP(QOS_PRIORITY_P1, prio) |
+		     FIELD_PREP(QOS_PRIORITY_P0, RK3588_ICC_TAG_PRIO_LOW));
+	regmap_write(qos->regmap, QOS_BANDWIDTH, bandwidth);
+	regmap_write(qos->regmap, QOS_SATURATION, saturation);
+	regmap_write(qos->regmap, QOS_MODE, QOS_MODE_REGULATOR);
+}
+
+static int rk3588_noc_master_power_get(struct rk3588_noc_master *master)
+{
+	int ret;
+
+	if (!master->pd_dev)
+		return 0;
+
+	ret = pm_runtime_resume_and_get(master->pd_dev);
+	if (ret)
+		dev_err(master->noc->dev, "failed to power %s on: %d\n",
+			master->name, ret);
+
+	return ret;
+}
+
+static void rk3588_noc_master_power_put(struct rk3588_noc_master *master)
+{
+	if (master->pd_dev)
+		pm_runtime_put(master->pd_dev);
+}
+
+static int rk3588_noc_master_set(struct rk3588_noc_master *master,
+				 struct icc_node *node)
+{
+	struct rk3588_noc *noc = master->noc;
+	u64 bw_bps, bandwidth, saturation;
+	unsigned long noc_rate;
+	unsigned int i;
+	int ret;
+
+	if (!master->num_qos)
+		return 0;
+
+	/*
+	 * No vote, give the master back its firmware configuration. Masters
+	 * that never had a vote are left alone, their power domain might be
+	 * off.
+	 */
+	if (!node->avg_bw && !node->peak_bw) {
+		if (!master->qos[0].saved)
+			return 0;
+
+		ret = rk3588_noc_master_power_get(master);
+		if (ret)
+			return ret;
+
+		for (i = 0; i < master->num_qos; i++)
+			rk3588_noc_qos_restore(&master->qos[i]);
+
+		rk3588_noc_master_power_put(master);
+
+		return 0;
+	}
+
+	noc_rate = clk_get_rate(noc->clk);
+	if (!noc_rate)
+		return -EINVAL;
+
+	/* Split the budget between the master ports. */
+	bw_bps = (u64)max(node->avg_bw, node->peak_bw) * 1000 / master->num_qos;
+
+	bandwidth = DIV_ROUND_UP_ULL(bw_bps * QOS_BANDWIDTH_FRAC, noc_rate);
+	bandwidth = min_t(u64, bandwidth, QOS_BANDWIDTH_MAX);
+
+	saturation = DIV_ROUND_UP_ULL(bw_bps * QOS_SATURATION_WINDOW_US,
+				      USEC_PER_SEC * QOS_SATURATION_UNIT);
+	saturation = clamp_t(u64, saturation, 1, QOS_SATURATION_MAX);
+
+	dev_dbg(noc->dev, "%s: bw %lluB/s prio %u -> bandwidth %llu saturation %llu\n",
+		master->name, bw_bps * master->num_qos, master->prio,
+		bandwidth, saturation);
+
+	ret = rk3588_noc_master_power_get(master);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < master->num_qos; i++)
+		rk3588_noc_qos_regulate(&master->qos[i], master->prio,
+					bandwidth, saturation);
+
+	rk3588_noc_master_power_put(master);
+
+	return 0;
+}
+
+static int rk3588_noc_set(struct icc_node *src, struct icc_node *dst)
+{
+	struct rk3588_noc_master *master;
+
+	if (src->id == RK3588_ICC_NOC_DDR)
+		return 0;
+
+	master = src->data;
+	return rk3588_noc_master_set(master, src);
+}
+
+/*
+ * The initial bandwidth is unknown, report none so that the QoS generators
+ * are not touched until a consumer votes.
+ */
+static int rk3588_noc_get_bw(struct icc_node *node, u32 *avg, u32 *peak)
+{
+	*avg = 0;
+	*peak = 0;
+
+	return 0;
+}
+
+static void rk3588_noc_pre_aggregate(struct icc_node *node)
+{
+	struct rk3588_noc_master *master = node->data;
+
+	if (node->id != RK3588_ICC_NOC_DDR)
+		master->prio = RK3588_ICC_TAG_PRIO_LOW;
+}
+
+static int rk3588_noc_aggregate(struct icc_node *node, u32 tag, u32 avg_bw,
+				u32 peak_bw, u32 *agg_avg, u32 *agg_peak)
+{
+	struct rk3588_noc_master *master = node->data;
+
+	if (node->id != RK3588_ICC_NOC_DDR && (avg_bw || peak_bw))
+		master->prio = max(master->prio,
+				   min_t(u32, tag, RK3588_ICC_TAG_PRIO_URGENT));
+
+	return icc_std_aggregate(node, tag, avg_bw, peak_bw, agg_avg, agg_peak);
+}
+
+static int rk3588_noc_init_master(struct rk3588_noc *noc,
+				  struct rk3588_noc_master *master)
+{
+	struct device_node *np = noc->dev->of_node;
+	struct device_node *qos_np;
+	int count, i;
+
+	i = of_property_match_string(np, "power-domain-names", master->name);
+	if (i >= 0 && noc->pd_list && i < noc->pd_list->num_pds)
+		master->pd_dev = noc->pd_list->pd_devs[i];
+
+	count = of_property_count_strings(np, "rockchip,qos-names");
+	if (count < 0)
+		return 0;
+
+	for (i = 0; i < count; i++) {
+		struct rk3588_noc_qos *qos;
+		const char *name;
+
+		of_property_read_string_index(np, "rockchip,qos-names", i, &name);
+		if (strcmp(name, master->name))
+			continue;
+
+		if (master->num_qos == RK3588_NOC_MAX_QOS_PORTS) {
+			dev_warn(noc->dev, "too many QoS ports for %s\n", master->name);
+			break;
+		}
+
+		qos_np = of_parse_phandle(np, "rockchip,qos", i);
+		if (!qos_np)
+			return -EINVAL;
+
+		qos = &master->qos[master->num_qos];
+		qos->regmap = syscon_node_to_regmap(qos_np);
+		of_node_put(qos_np);
+		if (IS_ERR(qos->regmap))
+			return PTR_ERR(qos->regmap);
+
+		master->num_qos++;
+	}
+
+	return 0;
+}
+
+static struct icc_node *rk3588_noc_get_parent(struct device_node *np)
+{
+	struct icc_node_data *icc_node_data;
+	struct of_phandle_args args;
+	struct icc_node *icc_node;
+	int ret;
+
+	/* The link to the DMC is optional. */
+	if (of_count_phandle_with_args(np, "interconnects", "#interconnect-cells") < 1)
+		return NULL;
+
+	ret = of_parse_phandle_with_args(np, "interconnects",
+					 "#interconnect-cells", 0, &args);
+	if (ret < 0)
+		return ERR_PTR(ret);
+
+	icc_node_data = of_icc_get_from_provider(&args);
+	of_node_put(args.np);
+
+	if (IS_ERR(icc_node_data))
+		return ERR_CAST(icc_node_data);
+
+	icc_node = icc_node_data->node;
+	kfree(icc_node_data);
+
+	return icc_node;
+}
+
+static struct icc_node *rk3588_noc_xlate(const struct of_phandle_args *spec,
+					 void *data)
+{
+	struct rk3588_noc *noc = data;
+	unsigned int idx;
+
+	if (spec->args_count != 1)
+		return ERR_PTR(-EINVAL);
+
+	idx = spec->args[0] - RK3588_NOC_FIRST_ID;
+	if (spec->args[0] < RK3588_NOC_FIRST_ID || idx >= noc->data->num_nodes)
+		return ERR_PTR(-EINVAL);
+
+	return noc->data->nodes[idx];
+}
+
+/* The domains are only powered on while the QoS generators are programmed. */
+static const struct dev_pm_domain_attach_data rk3588_noc_pd_data = {
+	.pd_flags = PD_FLAG_NO_DEV_LINK,
+};
+
+static int rk3588_noc_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct icc_node *ddr, *node, *parent;
+	struct icc_provider *provider;
+	struct rk3588_noc *noc;
+	unsigned int i;
+	int ret;
+
+	noc = devm_kzalloc(dev, struct_size(noc, masters, RK3588_NOC_NUM_MASTERS),
+			   GFP_KERNEL);
+	if (!noc)
+		return -ENOMEM;
+
+	noc->data = devm_kzalloc(dev, struct_size(noc->data, nodes, RK3588_NOC_NUM_NODES),
+				 GFP_KERNEL);
+	if (!noc->data)
+		return -ENOMEM;
+
+	noc->dev = dev;
+	noc->data->num_nodes = RK3588_NOC_NUM_NODES;
+
+	noc->clk = devm_clk_get_enabled(dev, NULL);
+	if (IS_ERR(noc->clk))
+		return dev_err_probe(dev, PTR_ERR(noc->clk), "failed to get the NoC clock\n");
+
+	ret = devm_pm_domain_attach_list(dev, &rk3588_noc_pd_data, &noc->pd_list);
+	if (ret < 0)
+		return dev_err_probe(dev, ret, "failed to attach the power domains\n");
+
+	for (i = 0; i < RK3588_NOC_NUM_MASTERS; i++) {
+		struct rk3588_noc_master *master = &noc->masters[i];
+
+		master->noc = noc;
+		master->id = rk3588_noc_masters[i].id;
+		master->name = rk3588_noc_masters[i].name;
+
+		ret = rk3588_noc_init_master(noc, master);
+		if (ret)
+			return dev_err_probe(dev, ret, "failed to get %s QoS ports\n",
+					     master->name);
+	}
+
+	provider = &noc->provider;
+	provider->dev = dev;
+	provider->set = rk3588_noc_set;
+	provider->pre_aggregate = rk3588_noc_pre_aggregate;
+	provider->aggregate = rk3588_noc_aggregate;
+	provider->get_bw = rk3588_noc_get_bw;
+	provider->xlate = rk3588_noc_xlate;
+	provider->data = noc;
+	icc_provider_init(provider);
+
+	ddr = icc_node_create(RK3588_ICC_NOC_DDR);
+	if (IS_ERR(ddr))
+		return PTR_ERR(ddr);
+
+	ddr->name = "noc-ddr";
+	ddr->data = noc;
+	icc_node_add(ddr, provider);
+	noc->data->nodes[0] = ddr;
+
+	for (i = 0; i < RK3588_NOC_NUM_MASTERS; i++) {
+		struct rk3588_noc_master *master = &noc->masters[i];
+
+		node = icc_node_create(master->id);
+		if (IS_ERR(node)) {
+			ret = PTR_ERR(node);
+			goto err_remove_nodes;
+		}
+
+		node->name = master->name;
+		node->data = master;
+		icc_node_add(node, provider);
+		noc->data->nodes[master->id - RK3588_NOC_FIRST_ID] = node;
+
+		ret = icc_link_create(node, RK3588_ICC_NOC_DDR);
+		if (ret)
+			goto err_remove_nodes;
+	}
+
+	/* Forward the DDR bandwidth votes to the DMC, if there's one. */
+	parent = rk3588_noc_get_parent(dev->of_node);
+	if (IS_ERR(parent)) {
+		ret = PTR_ERR(parent);
+		goto err_remove_nodes;
+	}
+
+	if (parent) {
+		ret = icc_link_create(ddr, parent->id);
+		if (ret)
+			goto err_remove_nodes;
+	}
+
+	ret = icc_provider_register(provider);
+	if (ret)
+		goto err_remove_nodes;
+
+	platform_set_drvdata(pdev, noc);
+
+	return 0;
+
+err_remove_nodes:
+	icc_nodes_remove(provider);
+
+	return ret;
+}
+
+static void rk3588_noc_remove(struct platform_device *pdev)
+{
+	struct rk3588_noc *noc = platform_get_drvdata(pdev);
+
+	icc_provider_deregister(&noc->provider);
+	icc_nodes_remove(&noc->provider);
+}
+
+static const struct of_device_id rk3588_noc_of_match[] = {
+	{ .compatible = "rockchip,rk3588-noc" },
+	{ }
+};
+MODULE_DEVICE_TABLE(of, rk3588_noc_of_match);
+
+static struct platform_driver rk3588_noc_driver = {
+	.probe = rk3588_noc_probe,
+	.remove = rk3588_noc_remove,
+	.driver = {
+		.name = "rk3588-noc",
+		.of_match_table = rk3588_noc_of_match,
+		.sync_state = icc_sync_state,
+	},
+};
+module_platform_driver(rk3588_noc_driver);
+
+MODULE_DESCRIPTION("Rockchip RK3588 NoC QoS interconnect driver");
+MODULE_LICENSE("GPL");
@@ -4,13 +4,18 @@
  */
 
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
+#include <linux/iopoll.h>
 #include <linux/kernel.h>
 #include <linux/mailbox_controller.h>
 #include <linux/of.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/timekeeping.h>
 
 #define MAILBOX_A2B_INTEN		0x00
 #define MAILBOX_A2B_STATUS		0x04
@@ -36,6 +41,16 @@ struct rockchip_mbox_chan {
 	int irq;
 	struct rockchip_mbox_msg *msg;
 	struct rockchip_mbox *mb;
+
+	/* Round trip statistics, from send_data() to the B2A response */
+	spinlock_t stats_lock;
+	u64 tx_time;
+	u64 tx_count;
+	u64 rx_count;
+	u64 rx_polled;
+	u64 lat_last;
+	u64 lat_max;
+	u64 lat_total;
 };
 
 struct rockchip_mbox {
@@ -47,13 +62,16 @@ struct rockchip_mbox {
 	u32 buf_size;
 
 	struct rockchip_mbox_chan *chans;
+
+	struct dentry *debugfs;
 };
 
 static int rockchip_mbox_send_data(struct mbox_chan *chan, void *data)
 {
 	struct rockchip_mbox *mb = dev_get_drvdata(chan->mbox->dev);
 	struct rockchip_mbox_msg *msg = data;
-	struct rockchip_mbox_chan *chans = mb->chans;
+	struct rockchip_mbox_chan *chans = chan->con_priv;
+	unsigned long flags;
 
 	if (!msg)
 		return -EINVAL;
@@ -67,7 +85,11 @@ static int rockchip_mbox_send_data(struct mbox_chan *chan, void *data)
 	dev_dbg(mb->mbox.dev, "Chan[%d]: A2B message, cmd 0x%08x\n",
 		chans->idx, msg->cmd);
 
-	mb->chans[chans->idx].msg = msg;
+	spin_lock_irqsave(&chans->stats_lock, flags);
+	chans->tx_time = ktime_get_ns();
+	chans->tx_count++;
+	spin_unlock_irqrestore(&chans->stats_lock, flags);
+	WRITE_ONCE(chans->msg, msg);
 
 	writel_relaxed(msg->cmd, mb->mbox_base + MAILBOX_A2B_CMD(chans->idx));
 	writel_relaxed(msg->rx_size, mb->mbox_base +
@@ -90,18 +112,107 @@ static int rockchip_mbox_startup(struct mbox_chan *chan)
 static void rockchip_mbox_shutdown(struct mbox_chan *chan)
 {
 	struct rockchip_mbox *mb = dev_get_drvdata(chan->mbox->dev);
-	struct rockchip_mbox_chan *chans = mb->chans;
+	struct rockchip_mbox_chan *chans = chan->con_priv;
 
 	/* Disable all B2A interrupts */
 	writel_relaxed(0, mb->mbox_base + MAILBOX_B2A_INTEN);
 
-	mb->chans[chans->idx].msg = NULL;
+	WRITE_ONCE(chans->msg, NULL);
+}
+
+/*
+ * Hand the B2A response to the client and complete the TX, so the core
+ * sends the next queued message right away. The IRQ thread and the polled
+ * paths may race for the same response, only the one claiming the message
+ * delivers it.
+ */
+static bool rockchip_mbox_rx(struct rockchip_mbox_chan *chans, bool polled)
+{
+	struct mbox_chan *chan = &chans->mb->mbox.chans[chans->idx];
+	struct rockchip_mbox_msg *msg = xchg(&chans->msg, NULL);
+	unsigned long flags;
+	u64 lat;
+
+	if (!msg)
+		return false;
+
+	spin_lock_irqsave(&chans->stats_lock, flags);
+	lat = ktime_get_ns() - chans->tx_time;
+	chans->lat_last = lat;
+	chans->lat_max = max(chans->lat_max, lat);
+	chans->lat_total += lat;
+	chans->rx_count++;
+	if (polled)
+		chans->rx_polled++;
+	spin_unlock_irqrestore(&chans->stats_lock, flags);
+
+	dev_dbg(chans->mb->mbox.dev, "Chan[%d]: B2A message, cmd 0x%08x\n",
+		chans->idx, msg->cmd);
+
+	mbox_chan_received_data(chan, msg);
+	mbox_chan_txdone(chan, 0);
+
+	return true;
+}
+
+/*
+ * Polled completion, for clients that wait for short firmware responses
+ * in atomic context and can't afford the threaded IRQ round trip.
+ */
+static bool rockchip_mbox_peek_data(struct mbox_chan *chan)
+{
+	struct rockchip_mbox *mb = dev_get_drvdata(chan->mbox->dev);
+	struct rockchip_mbox_chan *chans = chan->con_priv;
+	u32 status = readl_relaxed(mb->mbox_base + MAILBOX_B2A_STATUS);
+
+	if (!(status & BIT(chans->idx)))
+		return false;
+
+	writel_relaxed(BIT(chans->idx), mb->mbox_base + MAILBOX_B2A_STATUS);
+
+	return rockchip_mbox_rx(chans, true);
+}
+
+/*
+ * The B2A interrupt stays enabled while flushing, and its hard handler
+ * clears the status bit as soon as the response arrives, so the status bit
+ * alone can't tell whether the response came. The message is delivered by
+ * whichever of the IRQ thread and this poll claims it first.
+ */
+static bool rockchip_mbox_tx_done(struct mbox_chan *chan)
+{
+	struct rockchip_mbox_chan *chans = chan->con_priv;
+
+	return !READ_ONCE(chans->msg) || rockchip_mbox_peek_data(chan);
+}
+
+static int rockchip_mbox_flush(struct mbox_chan *chan, unsigned long timeout)
+{
+	struct rockchip_mbox_chan *chans = chan->con_priv;
+	bool done;
+	int ret;
+
+	ret = read_poll_timeout_atomic(rockchip_mbox_tx_done, done, done, 1,
+				       timeout * USEC_PER_MSEC, false, chan);
+	if (!ret)
+		return 0;
+
+	/*
+	 * The core completes the TX with an error on timeout. Claim the
+	 * message so that a late response doesn't complete the next one.
+	 */
+	if (!xchg(&chans->msg, NULL))
+		return 0;
+
+	return ret;
 }
 
 static const struct mbox_chan_ops rockchip_mbox_chan_ops = {
 	.send_data	= rockchip_mbox_send_data,
+	.flush		= rockchip_mbox_flush,
 	.startup	= rockchip_mbox_startup,
 	.shutdown	= rockchip_mbox_shutdown,
+	.peek_data	= rockchip_mbox_peek_data,
 };
 
 static irqreturn_t rockchip_mbox_irq(int irq, void *dev_id)
@@ -125,25 +236,16 @@ static irqreturn_t rockchip_mbox_irq(int irq, void *dev_id)
 static irqreturn_t rockchip_mbox_isr(int irq, void *dev_id)
 {
 	int idx;
-	struct rockchip_mbox_msg *msg = NULL;
 	struct rockchip_mbox *mb = (struct rockchip_mbox *)dev_id;
 
 	for (idx = 0; idx < mb->mbox.num_chans; idx++) {
 		if (irq != mb->chans[idx].irq)
 			continue;
 
-		msg = mb->chans[idx].msg;
-		if (!msg) {
-			dev_err(mb->mbox.dev,
-				"Chan[%d]: B2A message is NULL\n", idx);
-			break; /* spurious */
-		}
-
-		mbox_chan_received_data(&mb->mbox.chans[idx], msg);
-		mb->chans[idx].msg = NULL;
-
-		dev_dbg(mb->mbox.dev, "Chan[%d]: B2A message, cmd 0x%08x\n",
-			idx, msg->cmd);
+		/* Nothing to do if peek_data() got the response first */
+		if (!rockchip_mbox_rx(&mb->chans[idx], false))
+			dev_dbg(mb->mbox.dev,
+				"Chan[%d]: no B2A message pending\n", idx);
 
 		break;
 	}
@@ -151,6 +253,40 @@ static irqreturn_t rockchip_mbox_isr(int irq, void *dev_id)
 	return IRQ_HANDLED;
 }
 
+static int rockchip_mbox_stats_show(struct seq_file *s, void *data)
+{
+	struct rockchip_mbox *mb = dev_get_drvdata(s->private);
+	int idx;
+
+	seq_puts(s, "chan       tx       rx   polled    last_ns     max_ns     avg_ns\n");
+	for (idx = 0; idx < mb->mbox.num_chans; idx++) {
+		struct rockchip_mbox_chan *chans = &mb->chans[idx];
+		u64 tx_count, rx_count, rx_polled, lat_last, lat_max, lat_total;
+
+		spin_lock_irq(&chans->stats_lock);
+		tx_count = chans->tx_count;
+		rx_count = chans->rx_count;
+		rx_polled = chans->rx_polled;
+		lat_last = chans->lat_last;
+		lat_max = chans->lat_max;
+		lat_total = chans->lat_total;
+		spin_unlock_irq(&chans->stats_lock);
+
+		seq_printf(s, "%4d %8llu %8llu %8llu %10llu %10llu %10llu\n",
+			   idx, tx_count, rx_count, rx_polled, lat_last, lat_max,
+			   rx_count ? div64_u64(lat_total, rx_count) : 0);
+	}
+
+	return 0;
+}
+
+static void rockchip_mbox_debugfs_remove(void *data)
+{
+	struct rockchip_mbox *mb = data;
+
+	debugfs_remove_recursive(mb->debugfs);
+}
+
 static const struct rockchip_mbox_data rk3368_drv_data = {
 	.num_chans = 4,
 };
@@ -220,6 +356,8 @@ static int rockchip_mbox_probe(struct platform_device *pdev)
 		if (irq < 0)
 			return irq;
 
+		spin_lock_init(&mb->chans[i].stats_lock);
+
 		ret = devm_request_threaded_irq(&pdev->dev, irq,
 						rockchip_mbox_irq,
 						rockchip_mbox_isr, IRQF_ONESHOT,
@@ -231,13 +369,21 @@ static int rockchip_mbox_probe(struct platform_device *pdev)
 		mb->chans[i].irq = irq;
 		mb->chans[i].mb = mb;
 		mb->chans[i].msg = NULL;
+		mb->mbox.chans[i].con_priv = &mb->chans[i];
 	}
 
 	ret = devm_mbox_controller_register(&pdev->dev, &mb->mbox);
-	if (ret < 0)
+	if (ret < 0) {
 		dev_err(&pdev->dev, "Failed to register mailbox: %d\n", ret);
+		return ret;
+	}
 
-	return ret;
+	mb->debugfs = debugfs_create_dir(dev_name(&pdev->dev), NULL);
+	debugfs_create_devm_seqfile(&pdev->dev, "stats", mb->debugfs,
+				    rockchip_mbox_stats_show);
+
+	return devm_add_action_or_reset(&pdev->dev,
+					rockchip_mbox_debugfs_remove, mb);
 }
 
 static struct platform_driver rockchip_mbox_driver = {
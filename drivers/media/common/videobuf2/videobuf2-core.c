@@ -321,6 +321,122 @@ static void __vb2_plane_dmabuf_put(struct vb2_buffer *vb, struct vb2_plane *p)
 	p->dbuf_duplicated = false;
 }
 
+/*
+ * Maximum number of dma-buf attachments a queue keeps mapped for buffers
+ * that switched to a different dma-buf.
+ */
+#define VB2_DMABUF_CACHE_SIZE	16
+
+/*
+ * struct vb2_dmabuf_cache_entry - a mapped dma-buf attachment no longer
+ * used by its buffer
+ *
+ * The attachment was made by @vb for @plane and is only ever handed back
+ * to that same plane, as allocators keep a pointer to the buffer in their
+ * private data. The entry holds a reference to @dbuf.
+ */
+struct vb2_dmabuf_cache_entry {
+	struct list_head	list;
+	struct vb2_buffer	*vb;
+	unsigned int		plane;
+	struct dma_buf		*dbuf;
+	unsigned int		length;
+	void			*mem_priv;
+};
+
+static void __vb2_dmabuf_cache_release(struct vb2_queue *q,
+				       struct vb2_dmabuf_cache_entry *entry)
+{
+	list_del(&entry->list);
+	q->dmabuf_cache_len--;
+	call_void_memop(entry->vb, unmap_dmabuf, entry->mem_priv);
+	call_void_memop(entry->vb, detach_dmabuf, entry->mem_priv);
+	dma_buf_put(entry->dbuf);
+	kfree(entry);
+}
+
+/*
+ * __vb2_dmabuf_cache_put() - keep the attachment of a plane mapped instead
+ * of releasing it, in case userspace queues the same dma-buf for this
+ * buffer again later. Falls back to releasing it right away.
+ */
+static void __vb2_dmabuf_cache_put(struct vb2_buffer *vb, unsigned int plane)
+{
+	struct vb2_queue *q = vb->vb2_queue;
+	struct vb2_plane *p = &vb->planes[plane];
+	struct vb2_dmabuf_cache_entry *entry;
+
+	if (!p->mem_priv || p->dbuf_duplicated || !p->dbuf_mapped)
+		goto put;
+
+	entry = kmalloc(sizeof(*entry), GFP_KERNEL);
+	if (!entry)
+		goto put;
+
+	entry->vb = vb;
+	entry->plane = plane;
+	entry->dbuf = p->dbuf;
+	entry->length = p->length;
+	entry->mem_priv = p->mem_priv;
+	list_add(&entry->list, &q->dmabuf_cache);
+	if (++q->dmabuf_cache_len > VB2_DMABUF_CACHE_SIZE)
+		__vb2_dmabuf_cache_release(q, list_last_entry(&q->dmabuf_cache,
+				struct vb2_dmabuf_cache_entry, list));
+
+	/* The entry took over the attachment and the dma-buf reference */
+	p->mem_priv = NULL;
+	p->dbuf = NULL;
+	p->dbuf_mapped = 0;
+	p->bytesused = 0;
+	p->length = 0;
+	p->m.fd = 0;
+	p->data_offset = 0;
+	return;
+put:
+	__vb2_plane_dmabuf_put(vb, p);
+}
+
+/*
+ * __vb2_dmabuf_cache_get() - look up a mapped attachment of @dbuf made by
+ * this plane before, returns its mem_priv or NULL
+ */
+static void *__vb2_dmabuf_cache_get(struct vb2_buffer *vb, unsigned int plane,
+				    struct dma_buf *dbuf, unsigned int length)
+{
+	struct vb2_queue *q = vb->vb2_queue;
+	struct vb2_dmabuf_cache_entry *entry;
+	void *mem_priv;
+
+	list_for_each_entry(entry, &q->dmabuf_cache, list) {
+		if (entry->vb != vb || entry->plane != plane ||
+		    entry->dbuf != dbuf || entry->length != length)
+			continue;
+
+		mem_priv = entry->mem_priv;
+		list_del(&entry->list);
+		q->dmabuf_cache_len--;
+		/* The caller already holds its own reference to dbuf */
+		dma_buf_put(entry->dbuf);
+		kfree(entry);
+		return mem_priv;
+	}
+
+	return NULL;
+}
+
+/*
+ * __vb2_dmabuf_cache_drop() - release all cached attachments of a buffer
+ */
+static void __vb2_dmabuf_cache_drop(struct vb2_buffer *vb)
+{
+	struct vb2_queue *q = vb->vb2_queue;
+	struct vb2_dmabuf_cache_entry *entry, *tmp;
+
+	list_for_each_entry_safe(entry, tmp, &q->dmabuf_cache, list)
+		if (entry->vb == vb)
+			__vb2_dmabuf_cache_release(q, entry);
+}
+
 /*
  * __vb2_buf_dmabuf_put() - release memory associated with
  * a DMABUF shared buffer
@@ -567,11 +683,12 @@ static void __vb2_free_mem(struct vb2_queue *q, unsigned int start, unsigned int
 			continue;
 
 		/* Free MMAP buffers or release USERPTR buffers */
-		if (q->memory == VB2_MEMORY_MMAP)
+		if (q->memory == VB2_MEMORY_MMAP) {
 			__vb2_buf_mem_free(vb);
-		else if (q->memory == VB2_MEMORY_DMABUF)
+		} else if (q->memory == VB2_MEMORY_DMABUF) {
 			__vb2_buf_dmabuf_put(vb);
-		else
+			__vb2_dmabuf_cache_drop(vb);
+		} else
 			__vb2_buf_userptr_put(vb);
 	}
 }
@@ -1432,7 +1549,15 @@ static int __prepare_dmabuf(struct vb2_buffer *vb)
 		if (vb->planes[0].mem_priv) {
 			vb->copied_timestamp = 0;
 			call_void_vb_qop(vb, buf_cleanup, vb);
-			__vb2_buf_dmabuf_put(vb);
+			/*
+			 * Userspace often cycles a set of dma-bufs through the
+			 * buffers in no fixed order. Keep the old attachments
+			 * mapped so that they need not be set up again when
+			 * their dma-buf comes back to this buffer. Planes are
+			 * put in reverse order, see __vb2_buf_dmabuf_put().
+			 */
+			for (i = vb->num_planes; i-- > 0;)
+				__vb2_dmabuf_cache_put(vb, i);
 		}
 
 		for (plane = 0; plane < vb->num_planes; ++plane) {
@@ -1454,6 +1579,18 @@ static int __prepare_dmabuf(struct vb2_buffer *vb)
 			if (vb->planes[plane].dbuf_duplicated)
 				continue;
 
+			mem_priv = __vb2_dmabuf_cache_get(vb, plane,
+							  planes[plane].dbuf,
+							  planes[plane].length);
+			if (mem_priv) {
+				dprintk(q, 3, "reusing mapped dmabuf for plane %d\n",
+					plane);
+				vb->planes[plane].dbuf = planes[plane].dbuf;
+				vb->planes[plane].mem_priv = mem_priv;
+				vb->planes[plane].dbuf_mapped = 1;
+				continue;
+			}
+
 			/* Acquire each plane's memory */
 			mem_priv = call_ptr_memop(attach_dmabuf,
 						  vb,
@@ -2663,6 +2800,7 @@ int vb2_core_queue_init(struct vb2_queue *q)
 
 	INIT_LIST_HEAD(&q->queued_list);
 	INIT_LIST_HEAD(&q->done_list);
+	INIT_LIST_HEAD(&q->dmabuf_cache);
 	spin_lock_init(&q->done_lock);
 	mutex_init(&q->mmap_lock);
 	init_waitqueue_head(&q->done_wq);
@@ -11,30 +11,38 @@
 #include <media/v4l2-device.h>
 #include <media/v4l2-ioctl.h>
 #include <media/v4l2-mem2mem.h>
+#include <media/videobuf2-dma-contig.h>
 #include <media/videobuf2-dma-sg.h>
 #include <media/videobuf2-v4l2.h>
 
 #include "rga-hw.h"
 #include "rga.h"
 
-static ssize_t fill_descriptors(struct rga_dma_desc *desc, size_t max_desc,
-				struct sg_table *sgt)
+/*
+ * Fill @n_desc page descriptors from the start of @sgt. Imported buffers
+ * are often larger than the frame, the pages past the frame aren't mapped.
+ */
+static int fill_descriptors(struct rga_dma_desc *desc, size_t n_desc,
+			    struct sg_table *sgt)
 {
 	struct sg_dma_page_iter iter;
 	struct rga_dma_desc *tmp = desc;
-	size_t n_desc = 0;
+	size_t i = 0;
 	dma_addr_t addr;
 
 	for_each_sgtable_dma_page(sgt, &iter, 0) {
-		if (n_desc > max_desc)
-			return -EINVAL;
+		if (i == n_desc)
+			break;
 		addr = sg_page_iter_dma_address(&iter);
-		tmp->addr = lower_32_bits(addr);
+		/* The RGA2 MMU only has 32-bit page descriptors */
+		if (upper_32_bits(addr))
+			return -EINVAL;
+		tmp->addr = addr;
 		tmp++;
-		n_desc++;
+		i++;
 	}
 
-	return n_desc;
+	return i == n_desc ? 0 : -EINVAL;
 }
 
 static int
@@ -71,27 +79,6 @@ rga_queue_setup(struct vb2_queue *vq,
 	return 0;
 }
 
-static int rga_buf_init(struct vb2_buffer *vb)
-{
-	struct vb2_v4l2_buffer *vbuf = to_vb2_v4l2_buffer(vb);
-	struct rga_vb_buffer *rbuf = vb_to_rga(vbuf);
-	struct rga_ctx *ctx = vb2_get_drv_priv(vb->vb2_queue);
-	struct rockchip_rga *rga = ctx->rga;
-	struct rga_frame *f = rga_get_frame(ctx, vb->vb2_queue->type);
-	size_t n_desc = 0;
-
-	n_desc = DIV_ROUND_UP(f->size, PAGE_SIZE);
-
-	rbuf->n_desc = n_desc;
-	rbuf->dma_desc = dma_alloc_coherent(rga->dev,
-					    rbuf->n_desc * sizeof(*rbuf->dma_desc),
-					    &rbuf->dma_desc_pa, GFP_KERNEL);
-	if (!rbuf->dma_desc)
-		return -ENOMEM;
-
-	return 0;
-}
-
 static int get_plane_offset(struct rga_frame *f, int plane)
 {
 	if (plane == 0)
@@ -104,48 +91,71 @@ static int get_plane_offset(struct rga_frame *f, int plane)
 	return -EINVAL;
 }
 
-static int rga_buf_prepare(struct vb2_buffer *vb)
+/*
+ * The memory of a buffer can only change between buf_cleanup() and
+ * buf_init(), vb2 keeps imported dma-bufs attached and mapped as long as
+ * the same one is queued again on the same index. Build the RGA MMU
+ * table here so it is reused across queue cycles instead of being
+ * rebuilt on every buf_prepare().
+ */
+static int rga_buf_init(struct vb2_buffer *vb)
 {
 	struct vb2_v4l2_buffer *vbuf = to_vb2_v4l2_buffer(vb);
 	struct rga_vb_buffer *rbuf = vb_to_rga(vbuf);
 	struct rga_ctx *ctx = vb2_get_drv_priv(vb->vb2_queue);
+	struct rockchip_rga *rga = ctx->rga;
 	struct rga_frame *f = rga_get_frame(ctx, vb->vb2_queue->type);
-	ssize_t n_desc = 0;
-	size_t curr_desc = 0;
-	int i;
 	const struct v4l2_format_info *info;
-	unsigned int offsets[VIDEO_MAX_PLANES];
+	unsigned int offsets[VIDEO_MAX_PLANES] = { 0 };
+	size_t plane_desc[VIDEO_MAX_PLANES];
+	size_t n_desc = 0;
+	size_t curr_desc = 0;
+	int i, ret;
 
 	if (IS_ERR(f))
 		return PTR_ERR(f);
 
-	if (V4L2_TYPE_IS_OUTPUT(vb->vb2_queue->type)) {
-		if (vbuf->field == V4L2_FIELD_ANY)
-			vbuf->field = V4L2_FIELD_NONE;
-		if (vbuf->field != V4L2_FIELD_NONE)
-			return -EINVAL;
+	if (rga->hw->has_iommu) {
+		for (i = 0; i < vb->num_planes; i++)
+			offsets[i] = vb2_dma_contig_plane_dma_addr(vb, i);
+		goto fill_offsets;
 	}
 
 	for (i = 0; i < vb->num_planes; i++) {
-		vb2_set_plane_payload(vb, i, f->pix.plane_fmt[i].sizeimage);
+		plane_desc[i] = DIV_ROUND_UP(f->pix.plane_fmt[i].sizeimage,
+					     PAGE_SIZE);
+		n_desc += plane_desc[i];
+	}
 
+	rbuf->n_desc = n_desc;
+	rbuf->dma_desc = dma_alloc_coherent(rga->dev,
+					    rbuf->n_desc * sizeof(*rbuf->dma_desc),
+					    &rbuf->dma_desc_pa, GFP_KERNEL);
+	if (!rbuf->dma_desc)
+		return -ENOMEM;
+
+	for (i = 0; i < vb->num_planes; i++) {
 		/* Create local MMU table for RGA */
-		n_desc = fill_descriptors(&rbuf->dma_desc[curr_desc],
-					  rbuf->n_desc - curr_desc,
-					  vb2_dma_sg_plane_desc(vb, i));
-		if (n_desc < 0) {
-			v4l2_err(&ctx->rga->v4l2_dev,
+		ret = fill_descriptors(&rbuf->dma_desc[curr_desc], plane_desc[i],
+				       vb2_dma_sg_plane_desc(vb, i));
+		if (ret) {
+			v4l2_err(&rga->main_core->v4l2_dev,
 				 "Failed to map video buffer to RGA\n");
-			return n_desc;
+			dma_free_coherent(rga->dev,
+					  rbuf->n_desc * sizeof(*rbuf->dma_desc),
+					  rbuf->dma_desc, rbuf->dma_desc_pa);
+			rbuf->dma_desc = NULL;
+			return ret;
 		}
 		offsets[i] = curr_desc << PAGE_SHIFT;
-		curr_desc += n_desc;
+		curr_desc += plane_desc[i];
 	}
 
+fill_offsets:
 	/* Fill the remaining planes */
 	info = v4l2_format_info(f->fmt->fourcc);
 	for (i = info->mem_planes; i < info->comp_planes; i++)
-		offsets[i] = get_plane_offset(f, i);
+		offsets[i] = offsets[0] + get_plane_offset(f, i);
 
 	rbuf->offset.y_off = offsets[0];
 	rbuf->offset.u_off = offsets[1];
@@ -154,6 +164,29 @@ static int rga_buf_prepare(struct vb2_buffer *vb)
 	return 0;
 }
 
+static int rga_buf_prepare(struct vb2_buffer *vb)
+{
+	struct vb2_v4l2_buffer *vbuf = to_vb2_v4l2_buffer(vb);
+	struct rga_ctx *ctx = vb2_get_drv_priv(vb->vb2_queue);
+	struct rga_frame *f = rga_get_frame(ctx, vb->vb2_queue->type);
+	int i;
+
+	if (IS_ERR(f))
+		return PTR_ERR(f);
+
+	if (V4L2_TYPE_IS_OUTPUT(vb->vb2_queue->type)) {
+		if (vbuf->field == V4L2_FIELD_ANY)
+			vbuf->field = V4L2_FIELD_NONE;
+		if (vbuf->field != V4L2_FIELD_NONE)
+			return -EINVAL;
+	}
+
+	for (i = 0; i < vb->num_planes; i++)
+		vb2_set_plane_payload(vb, i, f->pix.plane_fmt[i].sizeimage);
+
+	return 0;
+}
+
 static void rga_buf_queue(struct vb2_buffer *vb)
 {
 	struct vb2_v4l2_buffer *vbuf = to_vb2_v4l2_buffer(vb);
@@ -169,8 +202,12 @@ static void rga_buf_cleanup(struct vb2_buffer *vb)
 	struct rga_ctx *ctx = vb2_get_drv_priv(vb->vb2_queue);
 	struct rockchip_rga *rga = ctx->rga;
 
+	if (!rbuf->dma_desc)
+		return;
+
 	dma_free_coherent(rga->dev, rbuf->n_desc * sizeof(*rbuf->dma_desc),
 			  rbuf->dma_desc, rbuf->dma_desc_pa);
+	rbuf->dma_desc = NULL;
 }
 
 static void rga_buf_return_buffers(struct vb2_queue *q,
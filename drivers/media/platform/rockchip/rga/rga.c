@@ -11,6 +11,7 @@
 #include <linux/interrupt.h>
 #include <linux/module.h>
 #include <linux/of.h>
+#include <linux/of_platform.h>
 #include <linux/pm_runtime.h>
 #include <linux/reset.h>
 #include <linux/sched.h>
@@ -22,6 +23,7 @@
 #include <media/v4l2-event.h>
 #include <media/v4l2-ioctl.h>
 #include <media/v4l2-mem2mem.h>
+#include <media/videobuf2-dma-contig.h>
 #include <media/videobuf2-dma-sg.h>
 #include <media/videobuf2-v4l2.h>
 
@@ -47,7 +49,7 @@ static void device_run(void *prv)
 
 	dst = v4l2_m2m_next_dst_buf(ctx->fh.m2m_ctx);
 
-	rga_hw_start(rga, vb_to_rga(src), vb_to_rga(dst));
+	rga->hw->start(rga, vb_to_rga(src), vb_to_rga(dst));
 
 	spin_unlock_irqrestore(&rga->ctrl_lock, flags);
 }
@@ -55,13 +57,14 @@ static void device_run(void *prv)
 static irqreturn_t rga_isr(int irq, void *prv)
 {
 	struct rockchip_rga *rga = prv;
-	int intr;
+	enum rga_irq_result result;
 
-	intr = rga_read(rga, RGA_INT) & 0xf;
+	result = rga->hw->handle_irq(rga);
 
-	rga_mod(rga, RGA_INT, intr << 4, 0xf << 4);
-
-	if (intr & 0x04) {
+	if (result != RGA_IRQ_IGNORE) {
+		enum vb2_buffer_state state = result == RGA_IRQ_DONE ?
+					      VB2_BUF_STATE_DONE :
+					      VB2_BUF_STATE_ERROR;
 		struct vb2_v4l2_buffer *src, *dst;
 		struct rga_ctx *ctx = rga->curr;
 
@@ -79,8 +82,8 @@ static irqreturn_t rga_isr(int irq, void *prv)
 
 		dst->sequence = ctx->csequence++;
 
-		v4l2_m2m_buf_done(src, VB2_BUF_STATE_DONE);
-		v4l2_m2m_buf_done(dst, VB2_BUF_STATE_DONE);
+		v4l2_m2m_buf_done(src, state);
+		v4l2_m2m_buf_done(dst, state);
 		v4l2_m2m_job_finish(rga->m2m_dev, ctx->fh.m2m_ctx);
 	}
 
@@ -95,18 +98,29 @@ static int
 queue_init(void *priv, struct vb2_queue *src_vq, struct vb2_queue *dst_vq)
 {
 	struct rga_ctx *ctx = priv;
+	const struct vb2_mem_ops *mem_ops = &vb2_dma_sg_memops;
+	gfp_t gfp_flags = __GFP_DMA32;
 	int ret;
 
+	/*
+	 * The RGA2 MMU only takes 32-bit page addresses, while cores behind an
+	 * IOMMU see a contiguous IOVA range for any buffer.
+	 */
+	if (ctx->rga->hw->has_iommu) {
+		mem_ops = &vb2_dma_contig_memops;
+		gfp_flags = 0;
+	}
+
 	src_vq->type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
 	src_vq->io_modes = VB2_MMAP | VB2_DMABUF;
 	src_vq->drv_priv = ctx;
 	src_vq->ops = &rga_qops;
-	src_vq->mem_ops = &vb2_dma_sg_memops;
-	src_vq->gfp_flags = __GFP_DMA32;
+	src_vq->mem_ops = mem_ops;
+	src_vq->gfp_flags = gfp_flags;
 	src_vq->buf_struct_size = sizeof(struct rga_vb_buffer);
 	src_vq->timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_COPY;
-	src_vq->lock = &ctx->rga->mutex;
-	src_vq->dev = ctx->rga->v4l2_dev.dev;
+	src_vq->lock = &ctx->rga->main_core->mutex;
+	src_vq->dev = ctx->rga->dev;
 
 	ret = vb2_queue_init(src_vq);
 	if (ret)
@@ -116,12 +130,12 @@ queue_init(void *priv, struct vb2_queue *src_vq, struct vb2_queue *dst_vq)
 	dst_vq->io_modes = VB2_MMAP | VB2_DMABUF;
 	dst_vq->drv_priv = ctx;
 	dst_vq->ops = &rga_qops;
-	dst_vq->mem_ops = &vb2_dma_sg_memops;
-	dst_vq->gfp_flags = __GFP_DMA32;
+	dst_vq->mem_ops = mem_ops;
+	dst_vq->gfp_flags = gfp_flags;
 	dst_vq->buf_struct_size = sizeof(struct rga_vb_buffer);
 	dst_vq->timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_COPY;
-	dst_vq->lock = &ctx->rga->mutex;
-	dst_vq->dev = ctx->rga->v4l2_dev.dev;
+	dst_vq->lock = &ctx->rga->main_core->mutex;
+	dst_vq->dev = ctx->rga->dev;
 
 	return vb2_queue_init(dst_vq);
 }
@@ -157,7 +171,7 @@ static const struct v4l2_ctrl_ops rga_ctrl_ops = {
 
 static int rga_setup_ctrls(struct rga_ctx *ctx)
 {
-	struct rockchip_rga *rga = ctx->rga;
+	struct rockchip_rga *rga = ctx->rga->main_core;
 
 	v4l2_ctrl_handler_init(&ctx->ctrl_handler, 4);
 
@@ -184,167 +198,18 @@ static int rga_setup_ctrls(struct rga_ctx *ctx)
 	return 0;
 }
 
-static struct rga_fmt formats[] = {
-	{
-		.fourcc = V4L2_PIX_FMT_ARGB32,
-		.color_swap = RGA_COLOR_ALPHA_SWAP,
-		.hw_format = RGA_COLOR_FMT_ABGR8888,
-		.depth = 32,
-		.uv_factor = 1,
-		.y_div = 1,
-		.x_div = 1,
-	},
-	{
-		.fourcc = V4L2_PIX_FMT_ABGR32,
-		.color_swap = RGA_COLOR_RB_SWAP,
-		.hw_format = RGA_COLOR_FMT_ABGR8888,
-		.depth = 32,
-		.uv_factor = 1,
-		.y_div = 1,
-		.x_div = 1,
-	},
-	{
-		.fourcc = V4L2_PIX_FMT_XBGR32,
-		.color_swap = RGA_COLOR_RB_SWAP,
-		.hw_format = RGA_COLOR_FMT_XBGR8888,
-		.depth = 32,
-		.uv_factor = 1,
-		.y_div = 1,
-		.x_div = 1,
-	},
-	{
-		.fourcc = V4L2_PIX_FMT_RGB24,
-		.color_swap = RGA_COLOR_NONE_SWAP,
-		.hw_format = RGA_COLOR_FMT_RGB888,
-		.depth = 24,
-		.uv_factor = 1,
-		.y_div = 1,
-		.x_div = 1,
-	},
-	{
-		.fourcc = V4L2_PIX_FMT_BGR24,
-		.color_swap = RGA_COLOR_RB_SWAP,
-		.hw_format = RGA_COLOR_FMT_RGB888,
-		.depth = 24,
-		.uv_factor = 1,
-		.y_div = 1,
-		.x_div = 1,
-	},
-	{
-		.fourcc = V4L2_PIX_FMT_ARGB444,
-		.color_swap = RGA_COLOR_RB_SWAP,
-		.hw_format = RGA_COLOR_FMT_ABGR4444,
-		.depth = 16,
-		.uv_factor = 1,
-		.y_div = 1,
-		.x_div = 1,
-	},
-	{
-		.fourcc = V4L2_PIX_FMT_ARGB555,
-		.color_swap = RGA_COLOR_RB_SWAP,
-		.hw_format = RGA_COLOR_FMT_ABGR1555,
-		.depth = 16,
-		.uv_factor = 1,
-		.y_div = 1,
-		.x_div = 1,
-	},
-	{
-		.fourcc = V4L2_PIX_FMT_RGB565,
-		.color_swap = RGA_COLOR_RB_SWAP,
-		.hw_format = RGA_COLOR_FMT_BGR565,
-		.depth = 16,
-		.uv_factor = 1,
-		.y_div = 1,
-		.x_div = 1,
-	},
-	{
-		.fourcc = V4L2_PIX_FMT_NV21,
-		.color_swap = RGA_COLOR_UV_SWAP,
-		.hw_format = RGA_COLOR_FMT_YUV420SP,
-		.depth = 12,
-		.uv_factor = 4,
-		.y_div = 2,
-		.x_div = 1,
-	},
-	{
-		.fourcc = V4L2_PIX_FMT_NV61,
-		.color_swap = RGA_COLOR_UV_SWAP,
-		.hw_format = RGA_COLOR_FMT_YUV422SP,
-		.depth = 16,
-		.uv_factor = 2,
-		.y_div = 1,
-		.x_div = 1,
-	},
-	{
-		.fourcc = V4L2_PIX_FMT_NV12,
-		.color_swap = RGA_COLOR_NONE_SWAP,
-		.hw_format = RGA_COLOR_FMT_YUV420SP,
-		.depth = 12,
-		.uv_factor = 4,
-		.y_div = 2,
-		.x_div = 1,
-	},
-	{
-		.fourcc = V4L2_PIX_FMT_NV12M,
-		.color_swap = RGA_COLOR_NONE_SWAP,
-		.hw_format = RGA_COLOR_FMT_YUV420SP,
-		.depth = 12,
-		.uv_factor = 4,
-		.y_div = 2,
-		.x_div = 1,
-	},
-	{
-		.fourcc = V4L2_PIX_FMT_NV16,
-		.color_swap = RGA_COLOR_NONE_SWAP,
-		.hw_format = RGA_COLOR_FMT_YUV422SP,
-		.depth = 16,
-		.uv_factor = 2,
-		.y_div = 1,
-		.x_div = 1,
-	},
-	{
-		.fourcc = V4L2_PIX_FMT_YUV420,
-		.color_swap = RGA_COLOR_NONE_SWAP,
-		.hw_format = RGA_COLOR_FMT_YUV420P,
-		.depth = 12,
-		.uv_factor = 4,
-		.y_div = 2,
-		.x_div = 2,
-	},
-	{
-		.fourcc = V4L2_PIX_FMT_YUV422P,
-		.color_swap = RGA_COLOR_NONE_SWAP,
-		.hw_format = RGA_COLOR_FMT_YUV422P,
-		.depth = 16,
-		.uv_factor = 2,
-		.y_div = 1,
-		.x_div = 2,
-	},
-	{
-		.fourcc = V4L2_PIX_FMT_YVU420,
-		.color_swap = RGA_COLOR_UV_SWAP,
-		.hw_format = RGA_COLOR_FMT_YUV420P,
-		.depth = 12,
-		.uv_factor = 4,
-		.y_div = 2,
-		.x_div = 2,
-	},
-};
-
-#define NUM_FORMATS ARRAY_SIZE(formats)
-
-static struct rga_fmt *rga_fmt_find(u32 pixelformat)
+static struct rga_fmt *rga_fmt_find(struct rockchip_rga *rga, u32 pixelformat)
 {
 	unsigned int i;
 
-	for (i = 0; i < NUM_FORMATS; i++) {
-		if (formats[i].fourcc == pixelformat)
-			return &formats[i];
+	for (i = 0; i < rga->hw->num_formats; i++) {
+		if (rga->hw->formats[i].fourcc == pixelformat)
+			return &rga->hw->formats[i];
 	}
 	return NULL;
 }
 
-static struct rga_frame def_frame = {
+static const struct rga_frame def_frame = {
 	.width = DEFAULT_WIDTH,
 	.height = DEFAULT_HEIGHT,
 	.colorspace = V4L2_COLORSPACE_DEFAULT,
@@ -352,7 +217,6 @@ static struct rga_frame def_frame = {
 	.crop.top = 0,
 	.crop.width = DEFAULT_WIDTH,
 	.crop.height = DEFAULT_HEIGHT,
-	.fmt = &formats[0],
 };
 
 struct rga_frame *rga_get_frame(struct rga_ctx *ctx, enum v4l2_buf_type type)
@@ -364,6 +228,33 @@ struct rga_frame *rga_get_frame(struct rga_ctx *ctx, enum v4l2_buf_type type)
 	return ERR_PTR(-EINVAL);
 }
 
+/*
+ * A context stays on the same core for its whole lifetime: the buffers of
+ * an RGA3 core are only mapped in its own IOMMU. Contexts are spread over
+ * the cores when they are opened, so that independent streams run in
+ * parallel.
+ */
+static struct rockchip_rga *rga_get_core(struct rockchip_rga *rga)
+{
+	struct rockchip_rga *core = rga->cores[0];
+	unsigned int i;
+
+	for (i = 1; i < rga->num_cores; i++) {
+		if (atomic_read(&rga->cores[i]->num_ctxs) <
+		    atomic_read(&core->num_ctxs))
+			core = rga->cores[i];
+	}
+
+	atomic_inc(&core->num_ctxs);
+
+	return core;
+}
+
+static void rga_put_core(struct rockchip_rga *core)
+{
+	atomic_dec(&core->num_ctxs);
+}
+
 static int rga_open(struct file *file)
 {
 	struct rockchip_rga *rga = video_drvdata(file);
@@ -373,10 +264,13 @@ static int rga_open(struct file *file)
 	ctx = kzalloc(sizeof(*ctx), GFP_KERNEL);
 	if (!ctx)
 		return -ENOMEM;
-	ctx->rga = rga;
+	ctx->rga = rga_get_core(rga);
 	/* Set default formats */
 	ctx->in = def_frame;
-	ctx->out = def_frame;
+	ctx->in.fmt = &rga->hw->formats[0];
+	ctx->in.stride = (ctx->in.width * ctx->in.fmt->depth) >> 3;
+	ctx->in.size = ctx->in.stride * ctx->in.height;
+	ctx->out = ctx->in;
 
 	v4l2_fill_pixfmt_mp(&ctx->in.pix,
 			    ctx->in.fmt->fourcc, ctx->out.width, ctx->out.height);
@@ -384,13 +278,15 @@ static int rga_open(struct file *file)
 			    ctx->out.fmt->fourcc, ctx->out.width, ctx->out.height);
 
 	if (mutex_lock_interruptible(&rga->mutex)) {
+		rga_put_core(ctx->rga);
 		kfree(ctx);
 		return -ERESTARTSYS;
 	}
-	ctx->fh.m2m_ctx = v4l2_m2m_ctx_init(rga->m2m_dev, ctx, &queue_init);
+	ctx->fh.m2m_ctx = v4l2_m2m_ctx_init(ctx->rga->m2m_dev, ctx, &queue_init);
 	if (IS_ERR(ctx->fh.m2m_ctx)) {
 		ret = PTR_ERR(ctx->fh.m2m_ctx);
 		mutex_unlock(&rga->mutex);
+		rga_put_core(ctx->rga);
 		kfree(ctx);
 		return ret;
 	}
@@ -413,7 +309,7 @@ static int rga_release(struct file *file)
 {
 	struct rga_ctx *ctx =
 		container_of(file->private_data, struct rga_ctx, fh);
-	struct rockchip_rga *rga = ctx->rga;
+	struct rockchip_rga *rga = ctx->rga->main_core;
 
 	mutex_lock(&rga->mutex);
 
@@ -422,6 +318,7 @@ static int rga_release(struct file *file)
 	v4l2_ctrl_handler_free(&ctx->ctrl_handler);
 	v4l2_fh_del(&ctx->fh);
 	v4l2_fh_exit(&ctx->fh);
+	rga_put_core(ctx->rga);
 	kfree(ctx);
 
 	mutex_unlock(&rga->mutex);
@@ -450,12 +347,14 @@ vidioc_querycap(struct file *file, void *priv, struct v4l2_capability *cap)
 
 static int vidioc_enum_fmt(struct file *file, void *prv, struct v4l2_fmtdesc *f)
 {
+	struct rga_ctx *ctx = prv;
+	const struct rga_hw *hw = ctx->rga->hw;
 	struct rga_fmt *fmt;
 
-	if (f->index >= NUM_FORMATS)
+	if (f->index >= hw->num_formats)
 		return -EINVAL;
 
-	fmt = &formats[f->index];
+	fmt = &hw->formats[f->index];
 	f->pixelformat = fmt->fourcc;
 
 	return 0;
@@ -486,16 +385,18 @@ static int vidioc_g_fmt(struct file *file, void *prv, struct v4l2_format *f)
 static int vidioc_try_fmt(struct file *file, void *prv, struct v4l2_format *f)
 {
 	struct v4l2_pix_format_mplane *pix_fmt = &f->fmt.pix_mp;
+	struct rga_ctx *ctx = prv;
+	const struct rga_hw *hw = ctx->rga->hw;
 	struct rga_fmt *fmt;
 
-	fmt = rga_fmt_find(pix_fmt->pixelformat);
+	fmt = rga_fmt_find(ctx->rga, pix_fmt->pixelformat);
 	if (!fmt)
-		fmt = &formats[0];
+		fmt = &hw->formats[0];
 
 	pix_fmt->width = clamp(pix_fmt->width,
-			       (u32)MIN_WIDTH, (u32)MAX_WIDTH);
+			       hw->min_width, hw->max_width);
 	pix_fmt->height = clamp(pix_fmt->height,
-				(u32)MIN_HEIGHT, (u32)MAX_HEIGHT);
+				hw->min_height, hw->max_height);
 
 	v4l2_fill_pixfmt_mp(pix_fmt, fmt->fourcc, pix_fmt->width, pix_fmt->height);
 	pix_fmt->field = V4L2_FIELD_NONE;
@@ -507,7 +408,7 @@ static int vidioc_s_fmt(struct file *file, void *prv, struct v4l2_format *f)
 {
 	struct v4l2_pix_format_mplane *pix_fmt = &f->fmt.pix_mp;
 	struct rga_ctx *ctx = prv;
-	struct rockchip_rga *rga = ctx->rga;
+	struct rockchip_rga *rga = ctx->rga->main_core;
 	struct vb2_queue *vq;
 	struct rga_frame *frm;
 	int ret = 0;
@@ -532,7 +433,7 @@ static int vidioc_s_fmt(struct file *file, void *prv, struct v4l2_format *f)
 	frm->size = 0;
 	for (i = 0; i < pix_fmt->num_planes; i++)
 		frm->size += pix_fmt->plane_fmt[i].sizeimage;
-	frm->fmt = rga_fmt_find(pix_fmt->pixelformat);
+	frm->fmt = rga_fmt_find(ctx->rga, pix_fmt->pixelformat);
 	frm->stride = pix_fmt->plane_fmt[0].bytesperline;
 	frm->colorspace = pix_fmt->colorspace;
 
@@ -612,7 +513,7 @@ static int vidioc_s_selection(struct file *file, void *prv,
 			      struct v4l2_selection *s)
 {
 	struct rga_ctx *ctx = prv;
-	struct rockchip_rga *rga = ctx->rga;
+	struct rockchip_rga *rga = ctx->rga->main_core;
 	struct rga_frame *f;
 	int ret = 0;
 
@@ -653,7 +554,8 @@ static int vidioc_s_selection(struct file *file, void *prv,
 
 	if (s->r.left + s->r.width > f->width ||
 	    s->r.top + s->r.height > f->height ||
-	    s->r.width < MIN_WIDTH || s->r.height < MIN_HEIGHT) {
+	    s->r.width < rga->hw->min_width ||
+	    s->r.height < rga->hw->min_height) {
 		v4l2_dbg(debug, 1, &rga->v4l2_dev, "unsupported crop value.\n");
 		return -EINVAL;
 	}
@@ -798,10 +700,110 @@ static int rga_parse_dt(struct rockchip_rga *rga)
 	return 0;
 }
 
+/*
+ * RK3588 has two identical RGA3 cores, each with its own IOMMU. Rather than
+ * exposing a video device per core and leaving the scheduling to userspace,
+ * every core probes its own hardware resources and m2m device, and the
+ * first compatible and available node found, the main core, clusters all
+ * of them behind its video device.
+ */
+static int rga_is_main_core(struct rockchip_rga *rga, const char **compatible)
+{
+	struct device_node *node = NULL;
+	bool is_main_core;
+	int ret;
+
+	/* Intentionally ignores the fallback strings */
+	ret = of_property_read_string(rga->dev->of_node, "compatible", compatible);
+	if (ret)
+		return ret;
+
+	/* The first compatible and available node found is considered the main core */
+	do {
+		node = of_find_compatible_node(node, NULL, *compatible);
+		if (of_device_is_available(node))
+			break;
+	} while (node);
+
+	if (!node)
+		return -EINVAL;
+
+	is_main_core = (rga->dev->of_node == node);
+
+	of_node_put(node);
+
+	return is_main_core;
+}
+
+static int rga_add_core(struct rockchip_rga *rga, struct device_node *node)
+{
+	struct platform_device *pdev;
+	struct rockchip_rga *core;
+	struct device_link *link;
+
+	if (rga->num_cores == RGA_MAX_CORES) {
+		dev_warn(rga->dev, "too many cores, ignoring %pOF\n", node);
+		return 0;
+	}
+
+	pdev = of_find_device_by_node(node);
+	if (!pdev)
+		return -EPROBE_DEFER;
+
+	/* The drvdata is already set while the core is still probing */
+	core = platform_get_drvdata(pdev);
+	if (!core || !device_is_bound(&pdev->dev)) {
+		put_device(&pdev->dev);
+		return -EPROBE_DEFER;
+	}
+
+	/* Make sure the main core goes away before any of the other cores */
+	link = device_link_add(rga->dev, &pdev->dev,
+			       DL_FLAG_AUTOREMOVE_CONSUMER);
+	put_device(&pdev->dev);
+	if (!link) {
+		dev_err(rga->dev, "Could not link to %pOF\n", node);
+		return -EINVAL;
+	}
+
+	core->main_core = rga;
+	rga->cores[rga->num_cores++] = core;
+
+	return 0;
+}
+
+static int rga_add_cores(struct rockchip_rga *rga, const char *compatible)
+{
+	struct device_node *node;
+	int ret;
+
+	rga->main_core = rga;
+	rga->cores[0] = rga;
+	rga->num_cores = 1;
+
+	for_each_compatible_node(node, NULL, compatible) {
+		if (node == rga->dev->of_node || !of_device_is_available(node))
+			continue;
+
+		ret = rga_add_core(rga, node);
+		if (ret) {
+			of_node_put(node);
+			return ret;
+		}
+	}
+
+	if (rga->num_cores > 1)
+		dev_info(rga->dev, "clustering %u cores\n", rga->num_cores);
+
+	return 0;
+}
+
 static int rga_probe(struct platform_device *pdev)
 {
 	struct rockchip_rga *rga;
 	struct video_device *vfd;
+	const char *compatible;
+	bool is_main_core;
 	int ret = 0;
 	int irq;
 
@@ -813,9 +815,15 @@ static int rga_probe(struct platform_device *pdev)
 		return -ENOMEM;
 
 	rga->dev = &pdev->dev;
+	rga->hw = of_device_get_match_data(&pdev->dev);
 	spin_lock_init(&rga->ctrl_lock);
 	mutex_init(&rga->mutex);
 
+	ret = rga_is_main_core(rga, &compatible);
+	if (ret < 0)
+		return ret;
+	is_main_core = ret;
+
 	ret = rga_parse_dt(rga);
 	if (ret)
 		return dev_err_probe(&pdev->dev, ret, "Unable to parse OF data\n");
@@ -847,44 +855,27 @@ static int rga_probe(struct platform_device *pdev)
 		goto err_put_clk;
 	}
 
-	ret = v4l2_device_register(&pdev->dev, &rga->v4l2_dev);
-	if (ret)
-		goto err_put_clk;
-	vfd = video_device_alloc();
-	if (!vfd) {
-		v4l2_err(&rga->v4l2_dev, "Failed to allocate video device\n");
-		ret = -ENOMEM;
-		goto unreg_v4l2_dev;
-	}
-	*vfd = rga_videodev;
-	vfd->lock = &rga->mutex;
-	vfd->v4l2_dev = &rga->v4l2_dev;
-
-	video_set_drvdata(vfd, rga);
-	rga->vfd = vfd;
-
 	platform_set_drvdata(pdev, rga);
 	rga->m2m_dev = v4l2_m2m_init(&rga_m2m_ops);
 	if (IS_ERR(rga->m2m_dev)) {
-		v4l2_err(&rga->v4l2_dev, "Failed to init mem2mem device\n");
+		dev_err(rga->dev, "Failed to init mem2mem device\n");
 		ret = PTR_ERR(rga->m2m_dev);
-		goto rel_vdev;
+		goto err_put_clk;
 	}
 
 	ret = pm_runtime_resume_and_get(rga->dev);
 	if (ret < 0)
 		goto rel_m2m;
 
-	rga->version.major = (rga_read(rga, RGA_VERSION_INFO) >> 24) & 0xFF;
-	rga->version.minor = (rga_read(rga, RGA_VERSION_INFO) >> 20) & 0x0F;
+	rga->hw->get_version(rga);
 
-	v4l2_info(&rga->v4l2_dev, "HW Version: 0x%02x.%02x\n",
-		  rga->version.major, rga->version.minor);
+	dev_info(rga->dev, "HW Version: 0x%02x.%02x\n",
+		 rga->version.major, rga->version.minor);
 
 	pm_runtime_put(rga->dev);
 
 	/* Create CMD buffer */
-	rga->cmdbuf_virt = dma_alloc_attrs(rga->dev, RGA_CMDBUF_SIZE,
+	rga->cmdbuf_virt = dma_alloc_attrs(rga->dev, rga->hw->cmdbuf_size,
 					   &rga->cmdbuf_phy, GFP_KERNEL,
 					   DMA_ATTR_WRITE_COMBINE);
 	if (!rga->cmdbuf_virt) {
@@ -892,13 +883,34 @@ static int rga_probe(struct platform_device *pdev)
 		goto rel_m2m;
 	}
 
-	def_frame.stride = (def_frame.width * def_frame.fmt->depth) >> 3;
-	def_frame.size = def_frame.stride * def_frame.height;
+	/* The other cores only run the jobs handed to them by the main core */
+	if (!is_main_core)
+		return 0;
+
+	ret = rga_add_cores(rga, compatible);
+	if (ret)
+		goto free_dma;
+
+	ret = v4l2_device_register(&pdev->dev, &rga->v4l2_dev);
+	if (ret)
+		goto free_dma;
+	vfd = video_device_alloc();
+	if (!vfd) {
+		v4l2_err(&rga->v4l2_dev, "Failed to allocate video device\n");
+		ret = -ENOMEM;
+		goto unreg_v4l2_dev;
+	}
+	*vfd = rga_videodev;
+	vfd->lock = &rga->mutex;
+	vfd->v4l2_dev = &rga->v4l2_dev;
+
+	video_set_drvdata(vfd, rga);
+	rga->vfd = vfd;
 
 	ret = video_register_device(vfd, VFL_TYPE_VIDEO, -1);
 	if (ret) {
 		v4l2_err(&rga->v4l2_dev, "Failed to register video device\n");
-		goto free_dma;
+		goto rel_vdev;
 	}
 
 	v4l2_info(&rga->v4l2_dev, "Registered %s as /dev/%s\n",
@@ -906,15 +918,15 @@ static int rga_probe(struct platform_device *pdev)
 
 	return 0;
 
-free_dma:
-	dma_free_attrs(rga->dev, RGA_CMDBUF_SIZE, rga->cmdbuf_virt,
-		       rga->cmdbuf_phy, DMA_ATTR_WRITE_COMBINE);
-rel_m2m:
-	v4l2_m2m_release(rga->m2m_dev);
 rel_vdev:
 	video_device_release(vfd);
 unreg_v4l2_dev:
 	v4l2_device_unregister(&rga->v4l2_dev);
+free_dma:
+	dma_free_attrs(rga->dev, rga->hw->cmdbuf_size, rga->cmdbuf_virt,
+		       rga->cmdbuf_phy, DMA_ATTR_WRITE_COMBINE);
+rel_m2m:
+	v4l2_m2m_release(rga->m2m_dev);
 err_put_clk:
 	pm_runtime_disable(rga->dev);
 
@@ -925,14 +937,17 @@ static void rga_remove(struct platform_device *pdev)
 {
 	struct rockchip_rga *rga = platform_get_drvdata(pdev);
 
-	dma_free_attrs(rga->dev, RGA_CMDBUF_SIZE, rga->cmdbuf_virt,
+	dma_free_attrs(rga->dev, rga->hw->cmdbuf_size, rga->cmdbuf_virt,
 		       rga->cmdbuf_phy, DMA_ATTR_WRITE_COMBINE);
 
-	v4l2_info(&rga->v4l2_dev, "Removing\n");
+	if (rga->main_core == rga) {
+		v4l2_info(&rga->v4l2_dev, "Removing\n");
+
+		video_unregister_device(rga->vfd);
+		v4l2_device_unregister(&rga->v4l2_dev);
+	}
 
 	v4l2_m2m_release(rga->m2m_dev);
-	video_unregister_device(rga->vfd);
-	v4l2_device_unregister(&rga->v4l2_dev);
 
 	pm_runtime_disable(rga->dev);
 }
@@ -961,9 +976,15 @@ static const struct dev_pm_ops rga_pm = {
 static const struct of_device_id rockchip_rga_match[] = {
 	{
 		.compatible = "rockchip,rk3288-rga",
+		.data = &rga2_hw,
 	},
 	{
 		.compatible = "rockchip,rk3399-rga",
+		.data = &rga2_hw,
+	},
+	{
+		.compatible = "rockchip,rk3588-rga3",
+		.data = &rga3_hw,
 	},
 	{},
 };
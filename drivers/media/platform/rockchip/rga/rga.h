@@ -50,6 +50,53 @@ struct rockchip_rga_version {
 	u32 minor;
 };
 
+struct rockchip_rga;
+struct rga_vb_buffer;
+
+enum rga_irq_result {
+	RGA_IRQ_IGNORE,
+	RGA_IRQ_DONE,
+	RGA_IRQ_ERROR,
+};
+
+/**
+ * struct rga_hw - Description of an RGA hardware generation
+ * @formats:		Pixel formats supported for both queues.
+ * @num_formats:	Number of entries in @formats.
+ * @cmdbuf_size:	Size in bytes of the command buffer.
+ * @min_width:		Minimum width of a frame or crop rectangle.
+ * @min_height:		Minimum height of a frame or crop rectangle.
+ * @max_width:		Maximum width of a frame.
+ * @max_height:		Maximum height of a frame.
+ * @has_iommu:		The core sits behind a system IOMMU and gets
+ *			contiguous DMA addresses instead of building its own
+ *			page tables.
+ * @get_version:	Read the version of the core into rga->version.
+ * @start:		Program the job of rga->curr and start the core.
+ * @handle_irq:		Acknowledge the interrupt and tell whether the
+ *			current job completed.
+ */
+struct rga_hw {
+	struct rga_fmt *formats;
+	unsigned int num_formats;
+	size_t cmdbuf_size;
+	u32 min_width;
+	u32 min_height;
+	u32 max_width;
+	u32 max_height;
+	bool has_iommu;
+
+	void (*get_version)(struct rockchip_rga *rga);
+	void (*start)(struct rockchip_rga *rga,
+		      struct rga_vb_buffer *src, struct rga_vb_buffer *dst);
+	enum rga_irq_result (*handle_irq)(struct rockchip_rga *rga);
+};
+
+extern const struct rga_hw rga2_hw;
+extern const struct rga_hw rga3_hw;
+
+#define RGA_MAX_CORES 2
+
 struct rga_ctx {
 	struct v4l2_fh fh;
 	struct rockchip_rga *rga;
@@ -89,6 +136,18 @@ struct rockchip_rga {
 	struct rga_ctx *curr;
 	dma_addr_t cmdbuf_phy;
 	void *cmdbuf_virt;
+
+	const struct rga_hw *hw;
+
+	/*
+	 * Identical cores are clustered behind the video device of the
+	 * main core, @cores and @num_cores are only valid on the main core.
+	 */
+	struct rockchip_rga *main_core;
+	struct rockchip_rga *cores[RGA_MAX_CORES];
+	unsigned int num_cores;
+	/* Number of contexts running their jobs on this core */
+	atomic_t num_ctxs;
 };
 
 struct rga_addr_offset {
@@ -101,12 +160,15 @@ struct rga_vb_buffer {
 	struct vb2_v4l2_buffer vb_buf;
 	struct list_head queue;
 
-	/* RGA MMU mapping for this buffer */
+	/* RGA MMU mapping for this buffer, unused on cores with an IOMMU */
 	struct rga_dma_desc *dma_desc;
 	dma_addr_t dma_desc_pa;
 	size_t n_desc;
 
-	/* Plane offsets of this buffer into the mapping */
+	/*
+	 * Plane offsets of this buffer into the RGA MMU mapping, or the plane
+	 * DMA addresses on cores with an IOMMU.
+	 */
 	struct rga_addr_offset offset;
 };
 
@@ -139,7 +201,4 @@ static inline void rga_mod(struct rockchip_rga *rga, u32 reg, u32 val, u32 mask)
 	rga_write(rga, reg, temp);
 };
 
-void rga_hw_start(struct rockchip_rga *rga,
-		  struct rga_vb_buffer *src, struct rga_vb_buffer *dst);
-
 #endif
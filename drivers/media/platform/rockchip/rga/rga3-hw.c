@@ -0,0 +1,369 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (C) Rockchip Electronics Co., Ltd.
+ */
+
+#include <linux/bits.h>
+#include <linux/dma-mapping.h>
+
+#include "rga3-hw.h"
+#include "rga.h"
+
+static unsigned int rga3_get_scl_mode(unsigned int src, unsigned int dst)
+{
+	if (src == dst)
+		return RGA3_SCL_MODE_NO;
+
+	return (src > dst) ? RGA3_SCL_MODE_DOWN : RGA3_SCL_MODE_UP;
+}
+
+static unsigned int rga3_get_scaling(unsigned int src, unsigned int dst)
+{
+	/*
+	 * Like on RGA2, the factor is a normalized inverse of the scaling
+	 * factor, with a normalization factor of 2^16.
+	 */
+	if (src == dst)
+		return 0;
+	if (src > dst)
+		return (dst << 16) / src;
+
+	return ((src - 1) << 16) / (dst - 1);
+}
+
+static unsigned int rga3_get_csc_mode(u32 colorspace)
+{
+	switch (colorspace) {
+	case V4L2_COLORSPACE_REC709:
+		return RGA3_CSC_MODE_BT709_R0;
+	default:
+		return RGA3_CSC_MODE_BT601_R0;
+	}
+}
+
+static void rga3_cmd_set_win0(struct rga_ctx *ctx, struct rga_vb_buffer *src)
+{
+	struct rockchip_rga *rga = ctx->rga;
+	u32 *dest = rga->cmdbuf_virt;
+	unsigned int scale_dst_w, scale_dst_h;
+	unsigned int src_h, src_w, dst_h, dst_w;
+	union rga3_rd_ctrl rd_ctrl;
+	union rga3_size src_size, act_size, dst_size;
+	union rga3_scl_fac scl_fac;
+
+	src_h = ctx->in.crop.height;
+	src_w = ctx->in.crop.width;
+	dst_h = ctx->out.crop.height;
+	dst_w = ctx->out.crop.width;
+
+	rd_ctrl.val = 0;
+	rd_ctrl.data.enable = 1;
+	rd_ctrl.data.rd_mode = RGA3_RD_MODE_RASTER;
+	rd_ctrl.data.format = ctx->in.fmt->hw_format;
+	rd_ctrl.data.swap = ctx->in.fmt->color_swap;
+
+	if (RGA3_COLOR_FMT_IS_YUV(ctx->in.fmt->hw_format) &&
+	    RGA3_COLOR_FMT_IS_RGB(ctx->out.fmt->hw_format))
+		rd_ctrl.data.y2r_mode = rga3_get_csc_mode(ctx->in.colorspace);
+
+	/* 180 and 270 degrees are built from the 90 degrees rotation and mirrors */
+	switch (ctx->rotate) {
+	case 90:
+		rd_ctrl.data.rot = 1;
+		break;
+	case 180:
+		rd_ctrl.data.xmirror = 1;
+		rd_ctrl.data.ymirror = 1;
+		break;
+	case 270:
+		rd_ctrl.data.rot = 1;
+		rd_ctrl.data.xmirror = 1;
+		rd_ctrl.data.ymirror = 1;
+		break;
+	}
+
+	if (ctx->hflip)
+		rd_ctrl.data.xmirror ^= 1;
+	if (ctx->vflip)
+		rd_ctrl.data.ymirror ^= 1;
+
+	/* The window scales first and rotates second */
+	if (rd_ctrl.data.rot) {
+		scale_dst_w = dst_h;
+		scale_dst_h = dst_w;
+	} else {
+		scale_dst_w = dst_w;
+		scale_dst_h = dst_h;
+	}
+
+	rd_ctrl.data.hscl_mode = rga3_get_scl_mode(src_w, scale_dst_w);
+	rd_ctrl.data.vscl_mode = rga3_get_scl_mode(src_h, scale_dst_h);
+
+	scl_fac.val = 0;
+	scl_fac.data.hor = rga3_get_scaling(src_w, scale_dst_w);
+	scl_fac.data.ver = rga3_get_scaling(src_h, scale_dst_h);
+
+	src_size.val = 0;
+	src_size.data.width = ctx->in.width - 1;
+	src_size.data.height = ctx->in.height - 1;
+
+	act_size.val = 0;
+	act_size.data.width = src_w - 1;
+	act_size.data.height = src_h - 1;
+
+	dst_size.val = 0;
+	dst_size.data.width = scale_dst_w - 1;
+	dst_size.data.height = scale_dst_h - 1;
+
+	dest[(RGA3_WIN0_RD_CTRL - RGA3_MODE_BASE_REG) >> 2] = rd_ctrl.val;
+	dest[(RGA3_WIN0_Y_BASE - RGA3_MODE_BASE_REG) >> 2] = src->offset.y_off;
+	dest[(RGA3_WIN0_U_BASE - RGA3_MODE_BASE_REG) >> 2] = src->offset.u_off;
+	dest[(RGA3_WIN0_V_BASE - RGA3_MODE_BASE_REG) >> 2] = src->offset.v_off;
+
+	/* The step of the strides is 4 byte words */
+	dest[(RGA3_WIN0_VIR_STRIDE - RGA3_MODE_BASE_REG) >> 2] =
+		ctx->in.stride >> 2;
+	dest[(RGA3_WIN0_UV_VIR_STRIDE - RGA3_MODE_BASE_REG) >> 2] =
+		(ctx->in.stride / ctx->in.fmt->x_div) >> 2;
+
+	dest[(RGA3_WIN0_SRC_SIZE - RGA3_MODE_BASE_REG) >> 2] = src_size.val;
+	dest[(RGA3_WIN0_ACT_OFF - RGA3_MODE_BASE_REG) >> 2] =
+		(ctx->in.crop.top << 16) | ctx->in.crop.left;
+	dest[(RGA3_WIN0_ACT_SIZE - RGA3_MODE_BASE_REG) >> 2] = act_size.val;
+	dest[(RGA3_WIN0_DST_SIZE - RGA3_MODE_BASE_REG) >> 2] = dst_size.val;
+	dest[(RGA3_WIN0_SCL_FAC - RGA3_MODE_BASE_REG) >> 2] = scl_fac.val;
+}
+
+static void rga3_cmd_set_wr(struct rga_ctx *ctx, struct rga_vb_buffer *dst)
+{
+	struct rockchip_rga *rga = ctx->rga;
+	struct rga_frame *frm = &ctx->out;
+	u32 *dest = rga->cmdbuf_virt;
+	unsigned int uv_stride, pixel_width;
+	union rga3_wr_ctrl wr_ctrl;
+	u32 y_base, uv_off;
+
+	wr_ctrl.val = 0;
+	wr_ctrl.data.wr_mode = RGA3_RD_MODE_RASTER;
+	wr_ctrl.data.format = frm->fmt->hw_format;
+	wr_ctrl.data.swap = frm->fmt->color_swap;
+
+	if (RGA3_COLOR_FMT_IS_RGB(ctx->in.fmt->hw_format) &&
+	    RGA3_COLOR_FMT_IS_YUV(frm->fmt->hw_format))
+		wr_ctrl.data.r2y_mode = rga3_get_csc_mode(frm->colorspace);
+
+	/*
+	 * The write channel has no offset of its own, point it at the top
+	 * left corner of the compose rectangle. Unlike RGA2, the rotation is
+	 * done before the write channel, which always writes the lines top
+	 * to bottom.
+	 */
+	uv_stride = frm->stride / frm->fmt->x_div;
+	pixel_width = frm->stride / frm->width;
+
+	y_base = dst->offset.y_off + frm->crop.top * frm->stride +
+		 frm->crop.left * pixel_width;
+	uv_off = (frm->crop.top / frm->fmt->y_div) * uv_stride +
+		 frm->crop.left / frm->fmt->x_div;
+
+	dest[(RGA3_WR_CTRL - RGA3_MODE_BASE_REG) >> 2] = wr_ctrl.val;
+	dest[(RGA3_WR_VIR_STRIDE - RGA3_MODE_BASE_REG) >> 2] = frm->stride >> 2;
+	dest[(RGA3_WR_PL_VIR_STRIDE - RGA3_MODE_BASE_REG) >> 2] = uv_stride >> 2;
+	dest[(RGA3_WR_Y_BASE - RGA3_MODE_BASE_REG) >> 2] = y_base;
+	dest[(RGA3_WR_U_BASE - RGA3_MODE_BASE_REG) >> 2] =
+		dst->offset.u_off + uv_off;
+	dest[(RGA3_WR_V_BASE - RGA3_MODE_BASE_REG) >> 2] =
+		dst->offset.v_off + uv_off;
+}
+
+static void rga3_hw_start(struct rockchip_rga *rga,
+			  struct rga_vb_buffer *src, struct rga_vb_buffer *dst)
+{
+	struct rga_ctx *ctx = rga->curr;
+
+	memset(rga->cmdbuf_virt, 0, rga->hw->cmdbuf_size);
+
+	/* Only window 0 is used, the overlap block passes it through */
+	rga3_cmd_set_win0(ctx, src);
+	rga3_cmd_set_wr(ctx, dst);
+
+	/* sync CMD buf for RGA */
+	dma_sync_single_for_device(rga->dev, rga->cmdbuf_phy,
+				   rga->hw->cmdbuf_size, DMA_BIDIRECTIONAL);
+
+	rga_write(rga, RGA3_CMD_ADDR, rga->cmdbuf_phy);
+	rga_write(rga, RGA3_SYS_CTRL, RGA3_SYS_CTRL_CMD_MODE);
+
+	rga_write(rga, RGA3_INT_CLR, RGA3_INT_FRM_DONE | RGA3_INT_CMD_DONE |
+		  RGA3_INT_ERROR_MASK);
+	rga_write(rga, RGA3_INT_EN, RGA3_INT_FRM_DONE | RGA3_INT_ERROR_MASK);
+
+	rga_write(rga, RGA3_CMD_CTRL, RGA3_CMD_CTRL_START);
+}
+
+static void rga3_hw_reset(struct rockchip_rga *rga)
+{
+	rga_write(rga, RGA3_SYS_CTRL, RGA3_SYS_CTRL_ACLK_SRESET |
+		  RGA3_SYS_CTRL_CCLK_SRESET);
+	rga_write(rga, RGA3_SYS_CTRL, 0);
+}
+
+static enum rga_irq_result rga3_hw_handle_irq(struct rockchip_rga *rga)
+{
+	u32 status;
+
+	status = rga_read(rga, RGA3_INT_RAW);
+
+	rga_write(rga, RGA3_INT_CLR, status);
+
+	if (status & RGA3_INT_ERROR_MASK) {
+		dev_err_ratelimited(rga->dev, "job failed, status 0x%08x\n",
+				    status);
+		rga3_hw_reset(rga);
+		return RGA_IRQ_ERROR;
+	}
+
+	return (status & RGA3_INT_FRM_DONE) ? RGA_IRQ_DONE : RGA_IRQ_IGNORE;
+}
+
+static void rga3_hw_get_version(struct rockchip_rga *rga)
+{
+	u32 version = rga_read(rga, RGA3_VERSION_NUM);
+
+	rga->version.major = (version >> 28) & 0x0F;
+	rga->version.minor = (version >> 20) & 0xFF;
+}
+
+static struct rga_fmt rga3_formats[] = {
+	{
+		.fourcc = V4L2_PIX_FMT_ARGB32,
+		.color_swap = RGA3_COLOR_ALPHA_SWAP,
+		.hw_format = RGA3_COLOR_FMT_ABGR8888,
+		.depth = 32,
+		.uv_factor = 1,
+		.y_div = 1,
+		.x_div = 1,
+	},
+	{
+		.fourcc = V4L2_PIX_FMT_ABGR32,
+		.color_swap = RGA3_COLOR_RB_SWAP,
+		.hw_format = RGA3_COLOR_FMT_ABGR8888,
+		.depth = 32,
+		.uv_factor = 1,
+		.y_div = 1,
+		.x_div = 1,
+	},
+	{
+		.fourcc = V4L2_PIX_FMT_XBGR32,
+		.color_swap = RGA3_COLOR_RB_SWAP,
+		.hw_format = RGA3_COLOR_FMT_XBGR8888,
+		.depth = 32,
+		.uv_factor = 1,
+		.y_div = 1,
+		.x_div = 1,
+	},
+	{
+		.fourcc = V4L2_PIX_FMT_RGB24,
+		.color_swap = RGA3_COLOR_NONE_SWAP,
+		.hw_format = RGA3_COLOR_FMT_RGB888,
+		.depth = 24,
+		.uv_factor = 1,
+		.y_div = 1,
+		.x_div = 1,
+	},
+	{
+		.fourcc = V4L2_PIX_FMT_BGR24,
+		.color_swap = RGA3_COLOR_RB_SWAP,
+		.hw_format = RGA3_COLOR_FMT_RGB888,
+		.depth = 24,
+		.uv_factor = 1,
+		.y_div = 1,
+		.x_div = 1,
+	},
+	{
+		.fourcc = V4L2_PIX_FMT_RGB565,
+		.color_swap = RGA3_COLOR_RB_SWAP,
+		.hw_format = RGA3_COLOR_FMT_BGR565,
+		.depth = 16,
+		.uv_factor = 1,
+		.y_div = 1,
+		.x_div = 1,
+	},
+	{
+		.fourcc = V4L2_PIX_FMT_NV21,
+		.color_swap = RGA3_COLOR_UV_SWAP,
+		.hw_format = RGA3_COLOR_FMT_YUV420SP,
+		.depth = 12,
+		.uv_factor = 4,
+		.y_div = 2,
+		.x_div = 1,
+	},
+	{
+		.fourcc = V4L2_PIX_FMT_NV61,
+		.color_swap = RGA3_COLOR_UV_SWAP,
+		.hw_format = RGA3_COLOR_FMT_YUV422SP,
+		.depth = 16,
+		.uv_factor = 2,
+		.y_div = 1,
+		.x_div = 1,
+	},
+	{
+		.fourcc = V4L2_PIX_FMT_NV12,
+		.color_swap = RGA3_COLOR_NONE_SWAP,
+		.hw_format = RGA3_COLOR_FMT_YUV420SP,
+		.depth = 12,
+		.uv_factor = 4,
+		.y_div = 2,
+		.x_div = 1,
+	},
+	{
+		.fourcc = V4L2_PIX_FMT_NV12M,
+		.color_swap = RGA3_COLOR_NONE_SWAP,
+		.hw_format = RGA3_COLOR_FMT_YUV420SP,
+		.depth = 12,
+		.uv_factor = 4,
+		.y_div = 2,
+		.x_div = 1,
+	},
+	{
+		.fourcc = V4L2_PIX_FMT_NV16,
+		.color_swap = RGA3_COLOR_NONE_SWAP,
+		.hw_format = RGA3_COLOR_FMT_YUV422SP,
+		.depth = 16,
+		.uv_factor = 2,
+		.y_div = 1,
+		.x_div = 1,
+	},
+	{
+		.fourcc = V4L2_PIX_FMT_YUYV,
+		.color_swap = RGA3_COLOR_NONE_SWAP,
+		.hw_format = RGA3_COLOR_FMT_YUV422_PACKED,
+		.depth = 16,
+		.uv_factor = 1,
+		.y_div = 1,
+		.x_div = 1,
+	},
+	{
+		.fourcc = V4L2_PIX_FMT_UYVY,
+		.color_swap = RGA3_COLOR_YC_SWAP,
+		.hw_format = RGA3_COLOR_FMT_YUV422_PACKED,
+		.depth = 16,
+		.uv_factor = 1,
+		.y_div = 1,
+		.x_div = 1,
+	},
+};
+
+const struct rga_hw rga3_hw = {
+	.formats = rga3_formats,
+	.num_formats = ARRAY_SIZE(rga3_formats),
+	.cmdbuf_size = RGA3_CMDBUF_SIZE,
+	.min_width = RGA3_MIN_WIDTH,
+	.min_height = RGA3_MIN_HEIGHT,
+	.max_width = RGA3_MAX_WIDTH,
+	.max_height = RGA3_MAX_HEIGHT,
+	.has_iommu = true,
+	.get_version = rga3_hw_get_version,
+	.start = rga3_hw_start,
+	.handle_irq = rga3_hw_handle_irq,
+};
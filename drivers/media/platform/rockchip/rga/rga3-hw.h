@@ -0,0 +1,190 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Copyright (C) Rockchip Electronics Co., Ltd.
+ */
+#ifndef __RGA3_HW_H__
+#define __RGA3_HW_H__
+
+/* Hardware limits */
+#define RGA3_MAX_WIDTH 8176
+#define RGA3_MAX_HEIGHT 8176
+
+#define RGA3_MIN_WIDTH 68
+#define RGA3_MIN_HEIGHT 2
+
+/* Registers address */
+#define RGA3_SYS_CTRL 0x0000
+#define RGA3_CMD_CTRL 0x0004
+#define RGA3_CMD_ADDR 0x0008
+#define RGA3_MI_GROUP_CTRL 0x000c
+#define RGA3_ARQOS_CTRL 0x0010
+#define RGA3_VERSION_NUM 0x0018
+#define RGA3_VERSION_TIM 0x001c
+#define RGA3_INT_EN 0x0020
+#define RGA3_INT_RAW 0x0024
+#define RGA3_INT_MSK 0x0028
+#define RGA3_INT_CLR 0x002c
+#define RGA3_RO_SRST 0x0030
+#define RGA3_STATUS0 0x0034
+
+/* The command buffer mirrors the registers from 0x100 to 0x1bc */
+#define RGA3_MODE_BASE_REG 0x0100
+#define RGA3_MODE_MAX_REG 0x01bc
+
+#define RGA3_CMDBUF_SIZE (RGA3_MODE_MAX_REG - RGA3_MODE_BASE_REG + 4)
+
+#define RGA3_OVLP_CTRL 0x0100
+#define RGA3_OVLP_OFF 0x0104
+#define RGA3_OVLP_TOP_CTRL 0x0108
+#define RGA3_OVLP_BOT_CTRL 0x010c
+#define RGA3_OVLP_TOP_ALPHA 0x0110
+#define RGA3_OVLP_BOT_ALPHA 0x0114
+
+#define RGA3_WIN0_RD_CTRL 0x0120
+#define RGA3_WIN0_Y_BASE 0x0124
+#define RGA3_WIN0_U_BASE 0x0128
+#define RGA3_WIN0_V_BASE 0x012c
+#define RGA3_WIN0_VIR_STRIDE 0x0130
+#define RGA3_WIN0_FBC_OFF 0x0134
+#define RGA3_WIN0_SRC_SIZE 0x0138
+#define RGA3_WIN0_ACT_OFF 0x013c
+#define RGA3_WIN0_ACT_SIZE 0x0140
+#define RGA3_WIN0_DST_SIZE 0x0144
+#define RGA3_WIN0_SCL_FAC 0x0148
+#define RGA3_WIN0_UV_VIR_STRIDE 0x014c
+
+#define RGA3_WIN1_RD_CTRL 0x0160
+#define RGA3_WIN1_Y_BASE 0x0164
+#define RGA3_WIN1_U_BASE 0x0168
+#define RGA3_WIN1_V_BASE 0x016c
+#define RGA3_WIN1_VIR_STRIDE 0x0170
+#define RGA3_WIN1_FBC_OFF 0x0174
+#define RGA3_WIN1_SRC_SIZE 0x0178
+#define RGA3_WIN1_ACT_OFF 0x017c
+#define RGA3_WIN1_ACT_SIZE 0x0180
+#define RGA3_WIN1_DST_SIZE 0x0184
+#define RGA3_WIN1_SCL_FAC 0x0188
+#define RGA3_WIN1_UV_VIR_STRIDE 0x018c
+
+#define RGA3_WR_CTRL 0x01a0
+#define RGA3_WR_FBCE_CTRL 0x01a4
+#define RGA3_WR_VIR_STRIDE 0x01a8
+#define RGA3_WR_PL_VIR_STRIDE 0x01ac
+#define RGA3_WR_Y_BASE 0x01b0
+#define RGA3_WR_U_BASE 0x01b4
+#define RGA3_WR_V_BASE 0x01b8
+
+/* Registers value */
+#define RGA3_SYS_CTRL_START BIT(0)
+#define RGA3_SYS_CTRL_CMD_MODE BIT(1)
+#define RGA3_SYS_CTRL_ACLK_SRESET BIT(4)
+#define RGA3_SYS_CTRL_CCLK_SRESET BIT(5)
+
+#define RGA3_CMD_CTRL_START BIT(0)
+
+#define RGA3_INT_FRM_DONE BIT(0)
+#define RGA3_INT_CMD_DONE BIT(1)
+/* Bus, decompression and command errors */
+#define RGA3_INT_ERROR_MASK GENMASK(10, 2)
+
+#define RGA3_COLOR_FMT_YUV420SP 0
+#define RGA3_COLOR_FMT_YUV422SP 1
+#define RGA3_COLOR_FMT_YUV422_PACKED 2
+#define RGA3_COLOR_FMT_BGR565 4
+#define RGA3_COLOR_FMT_RGB888 5
+#define RGA3_COLOR_FMT_ABGR8888 6
+#define RGA3_COLOR_FMT_XBGR8888 7
+
+#define RGA3_COLOR_FMT_IS_YUV(fmt) \
+	(((fmt) >= RGA3_COLOR_FMT_YUV420SP) && \
+	 ((fmt) <= RGA3_COLOR_FMT_YUV422_PACKED))
+#define RGA3_COLOR_FMT_IS_RGB(fmt) \
+	((fmt) >= RGA3_COLOR_FMT_BGR565)
+
+#define RGA3_COLOR_NONE_SWAP 0
+#define RGA3_COLOR_RB_SWAP 1
+#define RGA3_COLOR_ALPHA_SWAP 2
+#define RGA3_COLOR_UV_SWAP 1
+#define RGA3_COLOR_YC_SWAP 4
+
+#define RGA3_RD_MODE_RASTER 0
+#define RGA3_RD_MODE_FBC 1
+
+#define RGA3_SCL_MODE_NO 0
+#define RGA3_SCL_MODE_UP 1
+#define RGA3_SCL_MODE_DOWN 2
+
+#define RGA3_CSC_MODE_BYPASS 0
+#define RGA3_CSC_MODE_BT601_R0 1
+#define RGA3_CSC_MODE_BT601_R1 2
+#define RGA3_CSC_MODE_BT709_R0 3
+
+/* Registers union */
+union rga3_rd_ctrl {
+	unsigned int val;
+	struct {
+		/* [0:3] */
+		unsigned int enable:1;
+		unsigned int rd_mode:2;
+		unsigned int reserved:1;
+		/* [4:11] */
+		unsigned int format:4;
+		unsigned int swap:3;
+		unsigned int reserved1:1;
+		/* [12:19] */
+		unsigned int y2r_mode:2;
+		unsigned int r2y_mode:2;
+		unsigned int hscl_mode:2;
+		unsigned int vscl_mode:2;
+		/* [20:23] */
+		unsigned int reserved2:4;
+		/* [24:26] */
+		unsigned int rot:1;
+		unsigned int xmirror:1;
+		unsigned int ymirror:1;
+		/* [27:31] */
+		unsigned int reserved3:5;
+	} data;
+};
+
+union rga3_wr_ctrl {
+	unsigned int val;
+	struct {
+		/* [0:3] */
+		unsigned int wr_mode:2;
+		unsigned int reserved:2;
+		/* [4:11] */
+		unsigned int format:4;
+		unsigned int swap:3;
+		unsigned int reserved1:1;
+		/* [12:15] */
+		unsigned int r2y_mode:2;
+		unsigned int reserved2:2;
+		/* [16:31] */
+		unsigned int reserved3:16;
+	} data;
+};
+
+union rga3_size {
+	unsigned int val;
+	struct {
+		/* [0:15] */
+		unsigned int width:13;
+		unsigned int reserved:3;
+		/* [16:31] */
+		unsigned int height:13;
+		unsigned int reserved1:3;
+	} data;
+};
+
+union rga3_scl_fac {
+	unsigned int val;
+	struct {
+		/* [0:15] */
+		unsigned int hor:16;
+		/* [16:31] */
+		unsigned int ver:16;
+	} data;
+};
+
+#endif
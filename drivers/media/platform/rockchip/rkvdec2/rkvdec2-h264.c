@@ -401,22 +401,22 @@ static inline void rkvdec2_memcpy_toio(void __iomem *dst, void *src, size_t len)
 
 static void rkvdec2_write_regs(struct rkvdec2_ctx *ctx)
 {
-	struct rkvdec2_dev *rkvdec = ctx->dev;
+	struct rkvdec2_core *core = ctx->core;
 	struct rkvdec2_h264_ctx *h264_ctx = ctx->priv;
 
-	rkvdec2_memcpy_toio(rkvdec->regs + OFFSET_COMMON_REGS,
+	rkvdec2_memcpy_toio(core->regs + OFFSET_COMMON_REGS,
 			    &h264_ctx->regs.common,
 			    sizeof(h264_ctx->regs.common));
-	rkvdec2_memcpy_toio(rkvdec->regs + OFFSET_CODEC_PARAMS_REGS,
+	rkvdec2_memcpy_toio(core->regs + OFFSET_CODEC_PARAMS_REGS,
 			    &h264_ctx->regs.h264_param,
 			    sizeof(h264_ctx->regs.h264_param));
-	rkvdec2_memcpy_toio(rkvdec->regs + OFFSET_COMMON_ADDR_REGS,
+	rkvdec2_memcpy_toio(core->regs + OFFSET_COMMON_ADDR_REGS,
 			    &h264_ctx->regs.common_addr,
 			    sizeof(h264_ctx->regs.common_addr));
-	rkvdec2_memcpy_toio(rkvdec->regs + OFFSET_CODEC_ADDR_REGS,
+	rkvdec2_memcpy_toio(core->regs + OFFSET_CODEC_ADDR_REGS,
 			    &h264_ctx->regs.h264_addr,
 			    sizeof(h264_ctx->regs.h264_addr));
-	rkvdec2_memcpy_toio(rkvdec->regs + OFFSET_POC_HIGHBIT_REGS,
+	rkvdec2_memcpy_toio(core->regs + OFFSET_POC_HIGHBIT_REGS,
 			    &h264_ctx->regs.h264_highpoc,
 			    sizeof(h264_ctx->regs.h264_highpoc));
 }
@@ -432,12 +432,8 @@ static void config_registers(struct rkvdec2_ctx *ctx,
 	struct vb2_v4l2_buffer *src_buf = run->base.bufs.src;
 	struct vb2_v4l2_buffer *dst_buf = run->base.bufs.dst;
 	struct rkvdec2_regs_h264 *regs = &h264_ctx->regs;
-	const struct v4l2_format *f;
 	dma_addr_t rlc_addr;
 	dma_addr_t dst_addr;
-	u32 hor_virstride;
-	u32 ver_virstride;
-	u32 y_virstride;
 	u32 offset;
 	u32 pixels;
 	u32 i;
@@ -469,19 +465,12 @@ static void config_registers(struct rkvdec2_ctx *ctx,
 	/* Set max slice number */
 	regs->common.reg017.slice_num = MAX_SLICE_NUMBER;
 
-	/* Set strides */
-	f = &ctx->decoded_fmt;
-	dst_fmt = &f->fmt.pix_mp;
-	hor_virstride = dst_fmt->plane_fmt[0].bytesperline;
-	ver_virstride = dst_fmt->height;
-	y_virstride = hor_virstride * ver_virstride;
+	/* Set strides and output layout */
+	rkvdec2_config_output(ctx, &regs->common);
 
+	dst_fmt = &ctx->decoded_fmt.fmt.pix_mp;
 	pixels = dst_fmt->height * dst_fmt->width;
 
-	regs->common.reg018.y_hor_virstride = hor_virstride / 16;
-	regs->common.reg019.uv_hor_virstride = hor_virstride / 16;
-	regs->common.reg020.y_virstride = y_virstride / 16;
-
 	/* Activate block gating */
 	regs->common.reg026.swreg_block_gating_e = 0xfffef;
 	regs->common.reg026.reg_cfg_gating_en = 1;
@@ -647,7 +636,7 @@ static int rkvdec2_h264_validate_sps(struct rkvdec2_ctx *ctx,
 
 static int rkvdec2_h264_start(struct rkvdec2_ctx *ctx)
 {
-	struct rkvdec2_dev *rkvdec = ctx->dev;
+	struct rkvdec2_core *core = ctx->core;
 	struct rkvdec2_h264_priv_tbl *priv_tbl;
 	struct rkvdec2_h264_ctx *h264_ctx;
 	struct v4l2_ctrl *ctrl;
@@ -666,7 +655,7 @@ static int rkvdec2_h264_start(struct rkvdec2_ctx *ctx)
 	if (!h264_ctx)
 		return -ENOMEM;
 
-	priv_tbl = dma_alloc_coherent(rkvdec->dev, sizeof(*priv_tbl),
+	priv_tbl = dma_alloc_coherent(core->dev, sizeof(*priv_tbl),
 				      &h264_ctx->priv_tbl.dma, GFP_KERNEL);
 	if (!priv_tbl) {
 		ret = -ENOMEM;
@@ -689,9 +678,9 @@ static int rkvdec2_h264_start(struct rkvdec2_ctx *ctx)
 static void rkvdec2_h264_stop(struct rkvdec2_ctx *ctx)
 {
 	struct rkvdec2_h264_ctx *h264_ctx = ctx->priv;
-	struct rkvdec2_dev *rkvdec = ctx->dev;
+	struct rkvdec2_core *core = ctx->core;
 
-	dma_free_coherent(rkvdec->dev, h264_ctx->priv_tbl.size,
+	dma_free_coherent(core->dev, h264_ctx->priv_tbl.size,
 			  h264_ctx->priv_tbl.cpu, h264_ctx->priv_tbl.dma);
 	kfree(h264_ctx);
 }
@@ -720,7 +709,7 @@ static void rkvdec2_h264_run_preamble(struct rkvdec2_ctx *ctx,
 static int rkvdec2_h264_run(struct rkvdec2_ctx *ctx)
 {
 	struct v4l2_h264_reflist_builder reflist_builder;
-	struct rkvdec2_dev *rkvdec = ctx->dev;
+	struct rkvdec2_core *core = ctx->core;
 	struct rkvdec2_h264_ctx *h264_ctx = ctx->priv;
 	struct rkvdec2_h264_run run;
 	uint32_t watchdog_time;
@@ -745,17 +734,17 @@ static int rkvdec2_h264_run(struct rkvdec2_ctx *ctx)
 
 	/* Set watchdog at 2 times the hardware timeout threshold */
 	u64 timeout_threshold = h264_ctx->regs.common.timeout_threshold;
-	unsigned long axi_rate = clk_get_rate(rkvdec->axi_clk);
+	unsigned long axi_rate = clk_get_rate(core->axi_clk);
 
 	if (axi_rate)
 		watchdog_time = 2 * (1000 * timeout_threshold) / axi_rate;
 	else
 		watchdog_time = 2000;
-	schedule_delayed_work(&rkvdec->watchdog_work,
+	schedule_delayed_work(&core->watchdog_work,
 			      msecs_to_jiffies(watchdog_time));
 
 	/* Start decoding! */
-	writel(RKVDEC2_REG_DEC_E_BIT, rkvdec->regs + RKVDEC2_REG_DEC_E);
+	writel(RKVDEC2_REG_DEC_E_BIT, core->regs + RKVDEC2_REG_DEC_E);
 
 	return 0;
 }
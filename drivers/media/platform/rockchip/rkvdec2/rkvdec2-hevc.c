@@ -0,0 +1,737 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Rockchip Video Decoder 2 HEVC backend
+ *
+ * Copyright (C) 2024 Collabora, Ltd.
+ *  Detlev Casanova <detlev.casanova@collabora.com>
+ *
+ * Based on rkvdec driver by Boris Brezillon <boris.brezillon@collabora.com>
+ */
+
+#include <linux/firmware.h>
+#include <linux/module.h>
+#include <media/v4l2-mem2mem.h>
+
+#include "rkvdec2.h"
+#include "rkvdec2-regs.h"
+
+#define RKVDEC2_HEVC_CABAC_FW		"rockchip/rkvdec2-hevc-cabac.bin"
+#define RKVDEC2_HEVC_CABAC_TABLE_SIZE	27456
+#define RKVDEC2_HEVC_MAX_SLICES		600
+#define RKVDEC2_HEVC_MAX_PPS		64
+#define RKVDEC2_HEVC_MAX_REFS		15
+#define RKVDEC2_HEVC_MAX_TILE_COLS	20
+#define RKVDEC2_HEVC_MAX_TILE_ROWS	22
+
+struct rkvdec2_hevc_scaling_list {
+	u8 scaling_list_4x4[6][16];
+	u8 scaling_list_8x8[6][64];
+	u8 scaling_list_16x16[6][64];
+	u8 scaling_list_32x32[2][64];
+	u8 scaling_list_dc_coef_16x16[6];
+	u8 scaling_list_dc_coef_32x32[2];
+	u8 padding[360];
+};
+
+/* SPS and PPS, packed as a bitstream, one packet per PPS id */
+struct rkvdec2_hevc_sps_pps {
+	u32 info[28];
+};
+
+/* Reference picture lists of one slice, packed as a bitstream */
+struct rkvdec2_hevc_rps {
+	u32 info[8];
+};
+
+/* Data structure describing auxiliary buffer format. */
+struct rkvdec2_hevc_priv_tbl {
+	u8 cabac_table[RKVDEC2_HEVC_CABAC_TABLE_SIZE];
+	struct rkvdec2_hevc_scaling_list scaling_list;
+	struct rkvdec2_hevc_sps_pps param_set[RKVDEC2_HEVC_MAX_PPS];
+	struct rkvdec2_hevc_rps rps[RKVDEC2_HEVC_MAX_SLICES];
+};
+
+struct rkvdec2_hevc_run {
+	struct rkvdec2_run base;
+	const struct v4l2_ctrl_hevc_decode_params *decode_params;
+	const struct v4l2_ctrl_hevc_sps *sps;
+	const struct v4l2_ctrl_hevc_pps *pps;
+	const struct v4l2_ctrl_hevc_slice_params *slices_params;
+	const struct v4l2_ctrl_hevc_scaling_matrix *scaling_matrix;
+	unsigned int num_slices;
+	struct vb2_buffer *ref_buf[V4L2_HEVC_DPB_ENTRIES_NUM_MAX];
+};
+
+struct rkvdec2_hevc_ctx {
+	struct rkvdec2_aux_buf priv_tbl;
+	struct rkvdec2_regs_hevc regs;
+};
+
+struct rkvdec2_hevc_bits {
+	u32 *buf;
+	unsigned int pos;
+};
+
+/*
+ * Append the len least significant bits of val to the packet. The hardware
+ * reads the packets as a little-endian bitstream, LSB first.
+ */
+static void rkvdec2_hevc_put_bits(struct rkvdec2_hevc_bits *bits, u32 val,
+				  unsigned int len)
+{
+	while (len) {
+		unsigned int word = bits->pos / 32;
+		unsigned int shift = bits->pos % 32;
+		unsigned int n = min(len, 32 - shift);
+
+		bits->buf[word] |= (val & GENMASK(n - 1, 0)) << shift;
+		val = n < 32 ? val >> n : 0;
+		bits->pos += n;
+		len -= n;
+	}
+}
+
+static void rkvdec2_hevc_put_align(struct rkvdec2_hevc_bits *bits,
+				   unsigned int align)
+{
+	bits->pos = ALIGN(bits->pos, align);
+}
+
+/*
+ * Size in CTBs of tile i out of num_tiles along an axis of size_in_ctbs,
+ * following (6-3) and (6-4) in the specification.
+ */
+static unsigned int rkvdec2_hevc_tile_size(const struct v4l2_ctrl_hevc_pps *pps,
+					   const u8 *size_minus1,
+					   unsigned int num_tiles,
+					   unsigned int size_in_ctbs,
+					   unsigned int i)
+{
+	unsigned int j, size;
+
+	if (i >= num_tiles)
+		return 0;
+
+	if (pps->flags & V4L2_HEVC_PPS_FLAG_UNIFORM_SPACING)
+		return ((i + 1) * size_in_ctbs) / num_tiles -
+		       (i * size_in_ctbs) / num_tiles;
+
+	if (i < num_tiles - 1)
+		return size_minus1[i] + 1;
+
+	/* The last tile takes whatever is left */
+	size = size_in_ctbs;
+	for (j = 0; j < num_tiles - 1; j++)
+		size -= size_minus1[j] + 1;
+
+	return size;
+}
+
+static void assemble_hw_tiles(struct rkvdec2_hevc_bits *bits,
+			      const struct v4l2_ctrl_hevc_sps *sps,
+			      const struct v4l2_ctrl_hevc_pps *pps)
+{
+	unsigned int log2_ctb_size = sps->log2_min_luma_coding_block_size_minus3 + 3 +
+				     sps->log2_diff_max_min_luma_coding_block_size;
+	unsigned int width_in_ctbs = DIV_ROUND_UP(sps->pic_width_in_luma_samples,
+						  1 << log2_ctb_size);
+	unsigned int height_in_ctbs = DIV_ROUND_UP(sps->pic_height_in_luma_samples,
+						   1 << log2_ctb_size);
+	unsigned int cols = 1, rows = 1;
+	unsigned int i;
+
+	if (pps->flags & V4L2_HEVC_PPS_FLAG_TILES_ENABLED) {
+		cols = pps->num_tile_columns_minus1 + 1;
+		rows = pps->num_tile_rows_minus1 + 1;
+	}
+
+	for (i = 0; i < RKVDEC2_HEVC_MAX_TILE_COLS; i++)
+		rkvdec2_hevc_put_bits(bits,
+				      rkvdec2_hevc_tile_size(pps, pps->column_width_minus1,
+							     cols, width_in_ctbs, i),
+				      12);
+
+	for (i = 0; i < RKVDEC2_HEVC_MAX_TILE_ROWS; i++)
+		rkvdec2_hevc_put_bits(bits,
+				      rkvdec2_hevc_tile_size(pps, pps->row_height_minus1,
+							     rows, height_in_ctbs, i),
+				      12);
+}
+
+static void assemble_hw_pps(struct rkvdec2_ctx *ctx,
+			    struct rkvdec2_hevc_run *run)
+{
+	struct rkvdec2_hevc_ctx *hevc_ctx = ctx->priv;
+	const struct v4l2_ctrl_hevc_sps *sps = run->sps;
+	const struct v4l2_ctrl_hevc_pps *pps = run->pps;
+	struct rkvdec2_hevc_priv_tbl *priv_tbl = hevc_ctx->priv_tbl.cpu;
+	struct rkvdec2_hevc_sps_pps *hw_ps;
+	struct rkvdec2_hevc_bits bits;
+	bool pcm = sps->flags & V4L2_HEVC_SPS_FLAG_PCM_ENABLED;
+	u32 scaling_distance;
+
+	/*
+	 * HW read the SPS/PPS information from PPS packet index by PPS id.
+	 * so the driver copy SPS/PPS information to the exact PPS packet unit
+	 * for HW accessing.
+	 */
+	hw_ps = &priv_tbl->param_set[pps->pic_parameter_set_id];
+	memset(hw_ps, 0, sizeof(*hw_ps));
+
+	bits.buf = hw_ps->info;
+	bits.pos = 0;
+
+	/* write sps */
+	rkvdec2_hevc_put_bits(&bits, sps->video_parameter_set_id, 4);
+	rkvdec2_hevc_put_bits(&bits, sps->seq_parameter_set_id, 4);
+	rkvdec2_hevc_put_bits(&bits, sps->chroma_format_idc, 2);
+	rkvdec2_hevc_put_bits(&bits, sps->pic_width_in_luma_samples, 16);
+	rkvdec2_hevc_put_bits(&bits, sps->pic_height_in_luma_samples, 16);
+	rkvdec2_hevc_put_bits(&bits, sps->bit_depth_luma_minus8 + 8, 4);
+	rkvdec2_hevc_put_bits(&bits, sps->bit_depth_chroma_minus8 + 8, 4);
+	rkvdec2_hevc_put_bits(&bits, sps->log2_max_pic_order_cnt_lsb_minus4 + 4, 5);
+	rkvdec2_hevc_put_bits(&bits, sps->log2_diff_max_min_luma_coding_block_size, 2);
+	rkvdec2_hevc_put_bits(&bits, sps->log2_min_luma_coding_block_size_minus3 + 3, 3);
+	rkvdec2_hevc_put_bits(&bits, sps->log2_min_luma_transform_block_size_minus2 + 2, 3);
+	rkvdec2_hevc_put_bits(&bits, sps->log2_diff_max_min_luma_transform_block_size, 2);
+	rkvdec2_hevc_put_bits(&bits, sps->max_transform_hierarchy_depth_inter, 3);
+	rkvdec2_hevc_put_bits(&bits, sps->max_transform_hierarchy_depth_intra, 3);
+	rkvdec2_hevc_put_bits(&bits, !!(sps->flags & V4L2_HEVC_SPS_FLAG_SCALING_LIST_ENABLED), 1);
+	rkvdec2_hevc_put_bits(&bits, !!(sps->flags & V4L2_HEVC_SPS_FLAG_AMP_ENABLED), 1);
+	rkvdec2_hevc_put_bits(&bits, !!(sps->flags & V4L2_HEVC_SPS_FLAG_SAMPLE_ADAPTIVE_OFFSET), 1);
+	rkvdec2_hevc_put_bits(&bits, pcm, 1);
+	rkvdec2_hevc_put_bits(&bits, pcm ? sps->pcm_sample_bit_depth_luma_minus1 + 1 : 0, 4);
+	rkvdec2_hevc_put_bits(&bits, pcm ? sps->pcm_sample_bit_depth_chroma_minus1 + 1 : 0, 4);
+	rkvdec2_hevc_put_bits(&bits, !!(sps->flags & V4L2_HEVC_SPS_FLAG_PCM_LOOP_FILTER_DISABLED), 1);
+	rkvdec2_hevc_put_bits(&bits, sps->log2_diff_max_min_pcm_luma_coding_block_size, 3);
+	rkvdec2_hevc_put_bits(&bits, pcm ? sps->log2_min_pcm_luma_coding_block_size_minus3 + 3 : 0, 3);
+	rkvdec2_hevc_put_bits(&bits, sps->num_short_term_ref_pic_sets, 7);
+	rkvdec2_hevc_put_bits(&bits, !!(sps->flags & V4L2_HEVC_SPS_FLAG_LONG_TERM_REF_PICS_PRESENT), 1);
+	rkvdec2_hevc_put_bits(&bits, sps->num_long_term_ref_pics_sps, 6);
+	rkvdec2_hevc_put_bits(&bits, !!(sps->flags & V4L2_HEVC_SPS_FLAG_SPS_TEMPORAL_MVP_ENABLED), 1);
+	rkvdec2_hevc_put_bits(&bits, !!(sps->flags & V4L2_HEVC_SPS_FLAG_STRONG_INTRA_SMOOTHING_ENABLED), 1);
+	rkvdec2_hevc_put_align(&bits, 32);
+
+	/* write pps */
+	rkvdec2_hevc_put_bits(&bits, pps->pic_parameter_set_id, 6);
+	rkvdec2_hevc_put_bits(&bits, sps->seq_parameter_set_id, 4);
+	rkvdec2_hevc_put_bits(&bits, !!(pps->flags & V4L2_HEVC_PPS_FLAG_DEPENDENT_SLICE_SEGMENT_ENABLED), 1);
+	rkvdec2_hevc_put_bits(&bits, !!(pps->flags & V4L2_HEVC_PPS_FLAG_OUTPUT_FLAG_PRESENT), 1);
+	rkvdec2_hevc_put_bits(&bits, pps->num_extra_slice_header_bits, 13);
+	rkvdec2_hevc_put_bits(&bits, !!(pps->flags & V4L2_HEVC_PPS_FLAG_SIGN_DATA_HIDING_ENABLED), 1);
+	rkvdec2_hevc_put_bits(&bits, !!(pps->flags & V4L2_HEVC_PPS_FLAG_CABAC_INIT_PRESENT), 1);
+	rkvdec2_hevc_put_bits(&bits, pps->num_ref_idx_l0_default_active_minus1 + 1, 4);
+	rkvdec2_hevc_put_bits(&bits, pps->num_ref_idx_l1_default_active_minus1 + 1, 4);
+	rkvdec2_hevc_put_bits(&bits, pps->init_qp_minus26, 7);
+	rkvdec2_hevc_put_bits(&bits, !!(pps->flags & V4L2_HEVC_PPS_FLAG_CONSTRAINED_INTRA_PRED), 1);
+	rkvdec2_hevc_put_bits(&bits, !!(pps->flags & V4L2_HEVC_PPS_FLAG_TRANSFORM_SKIP_ENABLED), 1);
+	rkvdec2_hevc_put_bits(&bits, !!(pps->flags & V4L2_HEVC_PPS_FLAG_CU_QP_DELTA_ENABLED), 1);
+	rkvdec2_hevc_put_bits(&bits, sps->log2_min_luma_coding_block_size_minus3 + 3 +
+				     sps->log2_diff_max_min_luma_coding_block_size -
+				     pps->diff_cu_qp_delta_depth, 3);
+	rkvdec2_hevc_put_bits(&bits, pps->pps_cb_qp_offset, 5);
+	rkvdec2_hevc_put_bits(&bits, pps->pps_cr_qp_offset, 5);
+	rkvdec2_hevc_put_bits(&bits, !!(pps->flags & V4L2_HEVC_PPS_FLAG_PPS_SLICE_CHROMA_QP_OFFSETS_PRESENT), 1);
+	rkvdec2_hevc_put_bits(&bits, !!(pps->flags & V4L2_HEVC_PPS_FLAG_WEIGHTED_PRED), 1);
+	rkvdec2_hevc_put_bits(&bits, !!(pps->flags & V4L2_HEVC_PPS_FLAG_WEIGHTED_BIPRED), 1);
+	rkvdec2_hevc_put_bits(&bits, !!(pps->flags & V4L2_HEVC_PPS_FLAG_TRANSQUANT_BYPASS_ENABLED), 1);
+	rkvdec2_hevc_put_bits(&bits, !!(pps->flags & V4L2_HEVC_PPS_FLAG_TILES_ENABLED), 1);
+	rkvdec2_hevc_put_bits(&bits, !!(pps->flags & V4L2_HEVC_PPS_FLAG_ENTROPY_CODING_SYNC_ENABLED), 1);
+	rkvdec2_hevc_put_bits(&bits, !!(pps->flags & V4L2_HEVC_PPS_FLAG_PPS_LOOP_FILTER_ACROSS_SLICES_ENABLED), 1);
+	rkvdec2_hevc_put_bits(&bits, !!(pps->flags & V4L2_HEVC_PPS_FLAG_LOOP_FILTER_ACROSS_TILES_ENABLED), 1);
+	rkvdec2_hevc_put_bits(&bits, !!(pps->flags & V4L2_HEVC_PPS_FLAG_DEBLOCKING_FILTER_OVERRIDE_ENABLED), 1);
+	rkvdec2_hevc_put_bits(&bits, !!(pps->flags & V4L2_HEVC_PPS_FLAG_PPS_DISABLE_DEBLOCKING_FILTER), 1);
+	rkvdec2_hevc_put_bits(&bits, pps->pps_beta_offset_div2, 4);
+	rkvdec2_hevc_put_bits(&bits, pps->pps_tc_offset_div2, 4);
+	rkvdec2_hevc_put_bits(&bits, !!(pps->flags & V4L2_HEVC_PPS_FLAG_LISTS_MODIFICATION_PRESENT), 1);
+	rkvdec2_hevc_put_bits(&bits, pps->log2_parallel_merge_level_minus2 + 2, 3);
+	rkvdec2_hevc_put_bits(&bits, !!(pps->flags & V4L2_HEVC_PPS_FLAG_SLICE_SEGMENT_HEADER_EXTENSION_PRESENT), 1);
+	rkvdec2_hevc_put_align(&bits, 32);
+
+	assemble_hw_tiles(&bits, sps, pps);
+	rkvdec2_hevc_put_align(&bits, 32);
+
+	/*
+	 * To be on the safe side, program the scaling matrix address
+	 */
+	scaling_distance = offsetof(struct rkvdec2_hevc_priv_tbl, scaling_list);
+	rkvdec2_hevc_put_bits(&bits, hevc_ctx->priv_tbl.dma + scaling_distance, 32);
+
+	WARN_ON(bits.pos > sizeof(hw_ps->info) * BITS_PER_BYTE);
+}
+
+static void assemble_hw_rps(struct rkvdec2_ctx *ctx,
+			    struct rkvdec2_hevc_run *run)
+{
+	const struct v4l2_ctrl_hevc_decode_params *dec_params = run->decode_params;
+	struct rkvdec2_hevc_ctx *hevc_ctx = ctx->priv;
+	struct rkvdec2_hevc_priv_tbl *priv_tbl = hevc_ctx->priv_tbl.cpu;
+	unsigned int i, j;
+
+	for (i = 0; i < run->num_slices; i++) {
+		const struct v4l2_ctrl_hevc_slice_params *sl = &run->slices_params[i];
+		struct rkvdec2_hevc_bits bits;
+		unsigned int num_l0 = 0, num_l1 = 0;
+		bool low_delay = true;
+
+		memset(&priv_tbl->rps[i], 0, sizeof(priv_tbl->rps[i]));
+		bits.buf = priv_tbl->rps[i].info;
+		bits.pos = 0;
+
+		if (sl->slice_type != V4L2_HEVC_SLICE_TYPE_I)
+			num_l0 = sl->num_ref_idx_l0_active_minus1 + 1;
+		if (sl->slice_type == V4L2_HEVC_SLICE_TYPE_B)
+			num_l1 = sl->num_ref_idx_l1_active_minus1 + 1;
+
+		/*
+		 * The slice is low delay when none of its references come
+		 * after the current picture in output order.
+		 */
+		for (j = 0; j < num_l0; j++) {
+			const struct v4l2_hevc_dpb_entry *ref =
+				&dec_params->dpb[sl->ref_idx_l0[j]];
+
+			if (ref->pic_order_cnt_val > dec_params->pic_order_cnt_val)
+				low_delay = false;
+		}
+
+		for (j = 0; j < num_l1; j++) {
+			const struct v4l2_hevc_dpb_entry *ref =
+				&dec_params->dpb[sl->ref_idx_l1[j]];
+
+			if (ref->pic_order_cnt_val > dec_params->pic_order_cnt_val)
+				low_delay = false;
+		}
+
+		rkvdec2_hevc_put_bits(&bits, num_l0, 4);
+		rkvdec2_hevc_put_bits(&bits, num_l1, 4);
+		rkvdec2_hevc_put_bits(&bits, low_delay, 1);
+
+		for (j = 0; j < RKVDEC2_HEVC_MAX_REFS; j++) {
+			u8 idx = j < num_l0 ? sl->ref_idx_l0[j] : 0;
+			bool lt = j < num_l0 &&
+				  (dec_params->dpb[idx].flags &
+				   V4L2_HEVC_DPB_ENTRY_LONG_TERM_REFERENCE);
+
+			rkvdec2_hevc_put_bits(&bits, idx, 4);
+			rkvdec2_hevc_put_bits(&bits, lt, 1);
+		}
+
+		for (j = 0; j < RKVDEC2_HEVC_MAX_REFS; j++) {
+			u8 idx = j < num_l1 ? sl->ref_idx_l1[j] : 0;
+			bool lt = j < num_l1 &&
+				  (dec_params->dpb[idx].flags &
+				   V4L2_HEVC_DPB_ENTRY_LONG_TERM_REFERENCE);
+
+			rkvdec2_hevc_put_bits(&bits, idx, 4);
+			rkvdec2_hevc_put_bits(&bits, lt, 1);
+		}
+	}
+}
+
+static void assemble_hw_scaling_list(struct rkvdec2_ctx *ctx,
+				     struct rkvdec2_hevc_run *run)
+{
+	const struct v4l2_ctrl_hevc_scaling_matrix *scaling = run->scaling_matrix;
+	const struct v4l2_ctrl_hevc_sps *sps = run->sps;
+	struct rkvdec2_hevc_ctx *hevc_ctx = ctx->priv;
+	struct rkvdec2_hevc_priv_tbl *tbl = hevc_ctx->priv_tbl.cpu;
+
+	if (!(sps->flags & V4L2_HEVC_SPS_FLAG_SCALING_LIST_ENABLED))
+		return;
+
+	BUILD_BUG_ON(offsetof(struct rkvdec2_hevc_scaling_list, padding) !=
+		     sizeof(*scaling));
+
+	memcpy(&tbl->scaling_list, scaling, sizeof(*scaling));
+}
+
+static void lookup_ref_buf_idx(struct rkvdec2_ctx *ctx,
+			       struct rkvdec2_hevc_run *run)
+{
+	const struct v4l2_ctrl_hevc_decode_params *dec_params = run->decode_params;
+	u32 i;
+
+	for (i = 0; i < ARRAY_SIZE(dec_params->dpb); i++) {
+		struct v4l2_m2m_ctx *m2m_ctx = ctx->fh.m2m_ctx;
+		const struct v4l2_hevc_dpb_entry *dpb = dec_params->dpb;
+		struct vb2_queue *cap_q = &m2m_ctx->cap_q_ctx.q;
+		struct vb2_buffer *buf = NULL;
+
+		if (i < dec_params->num_active_dpb_entries) {
+			buf = vb2_find_buffer(cap_q, dpb[i].timestamp);
+			if (!buf) {
+				dev_dbg(ctx->dev->dev, "No buffer for timestamp %llu",
+					dpb[i].timestamp);
+			}
+		}
+
+		run->ref_buf[i] = buf;
+	}
+}
+
+static inline void rkvdec2_memcpy_toio(void __iomem *dst, void *src, size_t len)
+{
+#ifdef CONFIG_ARM64
+	__iowrite32_copy(dst, src, len);
+#else
+	memcpy_toio(dst, src, len);
+#endif
+}
+
+static void rkvdec2_write_regs(struct rkvdec2_ctx *ctx)
+{
+	struct rkvdec2_core *core = ctx->core;
+	struct rkvdec2_hevc_ctx *hevc_ctx = ctx->priv;
+
+	rkvdec2_memcpy_toio(core->regs + OFFSET_COMMON_REGS,
+			    &hevc_ctx->regs.common,
+			    sizeof(hevc_ctx->regs.common));
+	rkvdec2_memcpy_toio(core->regs + OFFSET_CODEC_PARAMS_REGS,
+			    &hevc_ctx->regs.hevc_param,
+			    sizeof(hevc_ctx->regs.hevc_param));
+	rkvdec2_memcpy_toio(core->regs + OFFSET_COMMON_ADDR_REGS,
+			    &hevc_ctx->regs.common_addr,
+			    sizeof(hevc_ctx->regs.common_addr));
+	rkvdec2_memcpy_toio(core->regs + OFFSET_CODEC_ADDR_REGS,
+			    &hevc_ctx->regs.hevc_addr,
+			    sizeof(hevc_ctx->regs.hevc_addr));
+}
+
+static void config_registers(struct rkvdec2_ctx *ctx,
+			     struct rkvdec2_hevc_run *run)
+{
+	const struct v4l2_ctrl_hevc_decode_params *dec_params = run->decode_params;
+	const struct v4l2_hevc_dpb_entry *dpb = dec_params->dpb;
+	struct rkvdec2_hevc_ctx *hevc_ctx = ctx->priv;
+	dma_addr_t priv_start_addr = hevc_ctx->priv_tbl.dma;
+	const struct v4l2_pix_format_mplane *dst_fmt;
+	struct vb2_v4l2_buffer *src_buf = run->base.bufs.src;
+	struct vb2_v4l2_buffer *dst_buf = run->base.bufs.dst;
+	struct rkvdec2_regs_hevc *regs = &hevc_ctx->regs;
+	dma_addr_t rlc_addr;
+	dma_addr_t dst_addr;
+	u32 offset;
+	u32 pixels;
+	u32 i;
+
+	memset(regs, 0, sizeof(*regs));
+
+	/* Set HEVC mode */
+	regs->common.reg009.dec_mode = RKVDEC2_MODE_HEVC;
+
+	/* Set config */
+	regs->common.reg011.buf_empty_en = 1;
+	regs->common.reg011.dec_clkgate_e = 1;
+	regs->common.reg011.dec_timeout_e = 1;
+	regs->common.reg011.pix_range_detection_e = 1;
+
+	regs->common.reg012.scanlist_addr_valid_en = 1;
+
+	/* Set IDR flag */
+	regs->common.reg013.cur_pic_is_idr =
+		!!(dec_params->flags & V4L2_HEVC_DECODE_PARAM_FLAG_IDR_PIC);
+
+	/* Set input stream length */
+	regs->common.stream_len = vb2_get_plane_payload(&src_buf->vb2_buf, 0);
+
+	/* Set max slice number */
+	regs->common.reg017.slice_num = MAX_SLICE_NUMBER;
+
+	/* Set strides and output layout */
+	rkvdec2_config_output(ctx, &regs->common);
+
+	dst_fmt = &ctx->decoded_fmt.fmt.pix_mp;
+	pixels = dst_fmt->height * dst_fmt->width;
+
+	/* Activate block gating */
+	regs->common.reg026.swreg_block_gating_e = 0xfffef;
+	regs->common.reg026.reg_cfg_gating_en = 1;
+
+	/* Set timeout threshold */
+	if (pixels < RKVDEC2_1080P_PIXELS)
+		regs->common.timeout_threshold = RKVDEC2_TIMEOUT_1080p;
+	else if (pixels < RKVDEC2_4K_PIXELS)
+		regs->common.timeout_threshold = RKVDEC2_TIMEOUT_4K;
+	else if (pixels < RKVDEC2_8K_PIXELS)
+		regs->common.timeout_threshold = RKVDEC2_TIMEOUT_8K;
+	else
+		regs->common.timeout_threshold = RKVDEC2_TIMEOUT_MAX;
+
+	/* Set current POC */
+	regs->hevc_param.cur_top_poc = dec_params->pic_order_cnt_val;
+
+	/* Set ref pic address & poc */
+	for (i = 0; i < RKVDEC2_HEVC_MAX_REFS; i++) {
+		struct vb2_buffer *vb_buf = run->ref_buf[i];
+		dma_addr_t buf_dma;
+
+		/*
+		 * If a DPB entry is unused or invalid, address of current destination
+		 * buffer is returned.
+		 */
+		if (!vb_buf)
+			vb_buf = &dst_buf->vb2_buf;
+		else
+			regs->hevc_param.reg099.hevc_ref_valid |= BIT(i);
+
+		buf_dma = vb2_dma_contig_plane_dma_addr(vb_buf, 0);
+
+		/* Set reference addresses */
+		regs->hevc_addr.ref_base[i] = buf_dma;
+
+		/* Set COLMV addresses */
+		regs->hevc_addr.colmv_base[i] = buf_dma + ctx->colmv_offset;
+
+		regs->hevc_param.ref_pocs[i] = dpb[i].pic_order_cnt_val;
+	}
+
+	/* No multi-layer support, all references are in the current layer */
+	regs->hevc_param.reg103.ref_pic_layer_same_with_cur =
+		regs->hevc_param.reg099.hevc_ref_valid;
+
+	/* Set rlc base address (input stream) */
+	rlc_addr = vb2_dma_contig_plane_dma_addr(&src_buf->vb2_buf, 0);
+	regs->common_addr.rlc_base = rlc_addr;
+	regs->common_addr.rlcwrite_base = rlc_addr;
+
+	/* Set output base address */
+	dst_addr = vb2_dma_contig_plane_dma_addr(&dst_buf->vb2_buf, 0);
+	regs->common_addr.decout_base = dst_addr;
+	regs->common_addr.error_ref_base = dst_addr;
+
+	/* Set colmv address */
+	regs->common_addr.colmv_cur_base = dst_addr + ctx->colmv_offset;
+
+	/* Set RCB addresses */
+	for (i = 0; i < RKVDEC2_RCB_COUNT; i++)
+		regs->common_addr.rcb_base[i] = ctx->rcb_bufs[i].dma;
+
+	/* Set hw pps address */
+	offset = offsetof(struct rkvdec2_hevc_priv_tbl, param_set);
+	regs->hevc_addr.pps_base = priv_start_addr + offset;
+
+	/* Set hw rps address */
+	offset = offsetof(struct rkvdec2_hevc_priv_tbl, rps);
+	regs->hevc_addr.rps_base = priv_start_addr + offset;
+
+	/* Set cabac table */
+	offset = offsetof(struct rkvdec2_hevc_priv_tbl, cabac_table);
+	regs->hevc_addr.cabactbl_base = priv_start_addr + offset;
+
+	offset = offsetof(struct rkvdec2_hevc_priv_tbl, scaling_list);
+	regs->hevc_addr.scanlist_addr = priv_start_addr + offset;
+
+	rkvdec2_write_regs(ctx);
+}
+
+#define RKVDEC_HEVC_MAX_DEPTH_IN_BYTES		2
+
+static int rkvdec2_hevc_adjust_fmt(struct rkvdec2_ctx *ctx,
+				   struct v4l2_format *f)
+{
+	struct v4l2_pix_format_mplane *fmt = &f->fmt.pix_mp;
+
+	fmt->num_planes = 1;
+	if (!fmt->plane_fmt[0].sizeimage)
+		fmt->plane_fmt[0].sizeimage = fmt->width * fmt->height *
+					      RKVDEC_HEVC_MAX_DEPTH_IN_BYTES;
+	return 0;
+}
+
+static enum rkvdec2_image_fmt rkvdec2_hevc_get_image_fmt(struct rkvdec2_ctx *ctx,
+							 struct v4l2_ctrl *ctrl)
+{
+	const struct v4l2_ctrl_hevc_sps *sps = ctrl->p_new.p_hevc_sps;
+
+	if (ctrl->id != V4L2_CID_STATELESS_HEVC_SPS)
+		return RKVDEC2_IMG_FMT_ANY;
+
+	if (sps->bit_depth_luma_minus8 == 0)
+		return RKVDEC2_IMG_FMT_420_8BIT;
+	else if (sps->bit_depth_luma_minus8 == 2)
+		return RKVDEC2_IMG_FMT_420_10BIT;
+
+	return RKVDEC2_IMG_FMT_ANY;
+}
+
+static int rkvdec2_hevc_validate_sps(struct rkvdec2_ctx *ctx,
+				     const struct v4l2_ctrl_hevc_sps *sps)
+{
+	/* Only 4:2:0 is supported */
+	if (sps->chroma_format_idc != 1)
+		return -EINVAL;
+
+	/* Luma and chroma bit depth mismatch */
+	if (sps->bit_depth_luma_minus8 != sps->bit_depth_chroma_minus8)
+		return -EINVAL;
+
+	/* Only 8-bit and 10-bit are supported */
+	if (sps->bit_depth_luma_minus8 != 0 && sps->bit_depth_luma_minus8 != 2)
+		return -EINVAL;
+
+	if (sps->pic_width_in_luma_samples > ctx->coded_fmt.fmt.pix_mp.width ||
+	    sps->pic_height_in_luma_samples > ctx->coded_fmt.fmt.pix_mp.height)
+		return -EINVAL;
+
+	return 0;
+}
+
+static int rkvdec2_hevc_start(struct rkvdec2_ctx *ctx)
+{
+	struct rkvdec2_core *core = ctx->core;
+	struct rkvdec2_hevc_priv_tbl *priv_tbl;
+	struct rkvdec2_hevc_ctx *hevc_ctx;
+	const struct firmware *fw;
+	struct v4l2_ctrl *ctrl;
+	int ret;
+
+	ctrl = v4l2_ctrl_find(&ctx->ctrl_hdl,
+			      V4L2_CID_STATELESS_HEVC_SPS);
+	if (!ctrl)
+		return -EINVAL;
+
+	ret = rkvdec2_hevc_validate_sps(ctx, ctrl->p_new.p_hevc_sps);
+	if (ret)
+		return ret;
+
+	hevc_ctx = kzalloc(sizeof(*hevc_ctx), GFP_KERNEL);
+	if (!hevc_ctx)
+		return -ENOMEM;
+
+	priv_tbl = dma_alloc_coherent(core->dev, sizeof(*priv_tbl),
+				      &hevc_ctx->priv_tbl.dma, GFP_KERNEL);
+	if (!priv_tbl) {
+		ret = -ENOMEM;
+		goto err_free_ctx;
+	}
+
+	hevc_ctx->priv_tbl.size = sizeof(*priv_tbl);
+	hevc_ctx->priv_tbl.cpu = priv_tbl;
+
+	/*
+	 * Unlike the H264 one, the HEVC CABAC table holds the context states
+	 * already initialized for every QP and slice type in the layout the
+	 * hardware expects, and is provided by the vendor as a firmware blob.
+	 * The blob is the cabac_table[] array of the HEVC HAL of Rockchip's
+	 * MPP library (mpp/hal/rkdec/h265d/hal_h265d_com.c), whose layout is
+	 * not documented.
+	 */
+	ret = request_firmware(&fw, RKVDEC2_HEVC_CABAC_FW, core->dev);
+	if (ret) {
+		dev_err(core->dev, "Failed to load %s: %d\n",
+			RKVDEC2_HEVC_CABAC_FW, ret);
+		goto err_free_tbl;
+	}
+
+	if (fw->size != sizeof(priv_tbl->cabac_table)) {
+		dev_err(core->dev, "Invalid %s size %zu\n",
+			RKVDEC2_HEVC_CABAC_FW, fw->size);
+		release_firmware(fw);
+		ret = -EINVAL;
+		goto err_free_tbl;
+	}
+
+	memcpy(priv_tbl->cabac_table, fw->data, fw->size);
+	release_firmware(fw);
+
+	ctx->priv = hevc_ctx;
+	return 0;
+
+err_free_tbl:
+	dma_free_coherent(core->dev, hevc_ctx->priv_tbl.size,
+			  hevc_ctx->priv_tbl.cpu, hevc_ctx->priv_tbl.dma);
+
+err_free_ctx:
+	kfree(hevc_ctx);
+	return ret;
+}
+
+static void rkvdec2_hevc_stop(struct rkvdec2_ctx *ctx)
+{
+	struct rkvdec2_hevc_ctx *hevc_ctx = ctx->priv;
+	struct rkvdec2_core *core = ctx->core;
+
+	dma_free_coherent(core->dev, hevc_ctx->priv_tbl.size,
+			  hevc_ctx->priv_tbl.cpu, hevc_ctx->priv_tbl.dma);
+	kfree(hevc_ctx);
+}
+
+static void rkvdec2_hevc_run_preamble(struct rkvdec2_ctx *ctx,
+				      struct rkvdec2_hevc_run *run)
+{
+	struct v4l2_ctrl *ctrl;
+
+	ctrl = v4l2_ctrl_find(&ctx->ctrl_hdl,
+			      V4L2_CID_STATELESS_HEVC_DECODE_PARAMS);
+	run->decode_params = ctrl ? ctrl->p_cur.p : NULL;
+	ctrl = v4l2_ctrl_find(&ctx->ctrl_hdl,
+			      V4L2_CID_STATELESS_HEVC_SLICE_PARAMS);
+	run->slices_params = ctrl ? ctrl->p_cur.p : NULL;
+	run->num_slices = ctrl ? ctrl->elems : 0;
+	ctrl = v4l2_ctrl_find(&ctx->ctrl_hdl,
+			      V4L2_CID_STATELESS_HEVC_SPS);
+	run->sps = ctrl ? ctrl->p_cur.p : NULL;
+	ctrl = v4l2_ctrl_find(&ctx->ctrl_hdl,
+			      V4L2_CID_STATELESS_HEVC_PPS);
+	run->pps = ctrl ? ctrl->p_cur.p : NULL;
+	ctrl = v4l2_ctrl_find(&ctx->ctrl_hdl,
+			      V4L2_CID_STATELESS_HEVC_SCALING_MATRIX);
+	run->scaling_matrix = ctrl ? ctrl->p_cur.p : NULL;
+
+	rkvdec2_run_preamble(ctx, &run->base);
+}
+
+static int rkvdec2_hevc_run(struct rkvdec2_ctx *ctx)
+{
+	struct rkvdec2_core *core = ctx->core;
+	struct rkvdec2_hevc_ctx *hevc_ctx = ctx->priv;
+	struct rkvdec2_hevc_run run;
+	uint32_t watchdog_time;
+
+	rkvdec2_hevc_run_preamble(ctx, &run);
+
+	assemble_hw_scaling_list(ctx, &run);
+	assemble_hw_pps(ctx, &run);
+	lookup_ref_buf_idx(ctx, &run);
+	assemble_hw_rps(ctx, &run);
+
+	config_registers(ctx, &run);
+
+	rkvdec2_run_postamble(ctx, &run.base);
+
+	/* Set watchdog at 2 times the hardware timeout threshold */
+	u64 timeout_threshold = hevc_ctx->regs.common.timeout_threshold;
+	unsigned long axi_rate = clk_get_rate(core->axi_clk);
+
+	if (axi_rate)
+		watchdog_time = 2 * (1000 * timeout_threshold) / axi_rate;
+	else
+		watchdog_time = 2000;
+	schedule_delayed_work(&core->watchdog_work,
+			      msecs_to_jiffies(watchdog_time));
+
+	/* Start decoding! */
+	writel(RKVDEC2_REG_DEC_E_BIT, core->regs + RKVDEC2_REG_DEC_E);
+
+	return 0;
+}
+
+static int rkvdec2_hevc_try_ctrl(struct rkvdec2_ctx *ctx, struct v4l2_ctrl *ctrl)
+{
+	if (ctrl->id == V4L2_CID_STATELESS_HEVC_SPS)
+		return rkvdec2_hevc_validate_sps(ctx, ctrl->p_new.p_hevc_sps);
+
+	return 0;
+}
+
+const struct rkvdec2_coded_fmt_ops rkvdec2_hevc_fmt_ops = {
+	.adjust_fmt = rkvdec2_hevc_adjust_fmt,
+	.get_image_fmt = rkvdec2_hevc_get_image_fmt,
+	.start = rkvdec2_hevc_start,
+	.stop = rkvdec2_hevc_stop,
+	.run = rkvdec2_hevc_run,
+	.try_ctrl = rkvdec2_hevc_try_ctrl,
+};
+
+MODULE_FIRMWARE(RKVDEC2_HEVC_CABAC_FW);
@@ -344,4 +344,47 @@ struct rkvdec2_regs_h264 {
 	struct rkvdec2_regs_h264_highpoc	h264_highpoc;
 } __packed;
 
+/* base: OFFSET_CODEC_PARAMS_REGS */
+struct rkvdec2_regs_hevc_params {
+	struct rkvdec2_h26x_set reg064;
+
+	u32 cur_top_poc;
+	u32 reserved_066;
+	u32 ref_pocs[15];
+	u32 reserved_082_098[17];
+
+	struct rkvdec2_hevc_ref_valid {
+		u32 hevc_ref_valid	: 15;
+		u32 reserved		: 17;
+	} reg099;
+
+	u32 reserved_100_102[3];
+
+	struct rkvdec2_hevc_ref_layer {
+		u32 ref_pic_layer_same_with_cur	: 15;
+		u32 reserved			: 17;
+	} reg103;
+} __packed;
+
+/* base: OFFSET_CODEC_ADDR_REGS */
+struct rkvdec2_regs_hevc_addr {
+	u32 reserved_160;
+	u32 pps_base;
+	u32 reserved_162;
+	u32 rps_base;
+	u32 ref_base[15];
+	u32 reserved_179;
+	u32 scanlist_addr;
+	u32 colmv_base[15];
+	u32 reserved_196;
+	u32 cabactbl_base;
+} __packed;
+
+struct rkvdec2_regs_hevc {
+	struct rkvdec2_regs_common		common;
+	struct rkvdec2_regs_hevc_params		hevc_param;
+	struct rkvdec2_regs_common_addr		common_addr;
+	struct rkvdec2_regs_hevc_addr		hevc_addr;
+} __packed;
+
 #endif /* __RKVDEC_REGS_H__ */
@@ -0,0 +1,7 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright (C) 2024 Collabora, Ltd.
+ */
+
+#define CREATE_TRACE_POINTS
+#include "rkvdec2-trace.h"
@@ -0,0 +1,51 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Rockchip Video Decoder 2 driver tracepoints
+ *
+ * Copyright (C) 2024 Collabora, Ltd.
+ */
+
+#if !defined(_RKVDEC2_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define _RKVDEC2_TRACE_H_
+
+#include <linux/tracepoint.h>
+
+#include "rkvdec2.h"
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM rkvdec2
+#define TRACE_INCLUDE_FILE rkvdec2-trace
+
+TRACE_EVENT(rkvdec2_frame_done,
+	TP_PROTO(struct rkvdec2_ctx *ctx, u64 duration_ns, bool error),
+	TP_ARGS(ctx, duration_ns, error),
+	TP_STRUCT__entry(
+		__string(dev, dev_name(ctx->core->dev))
+		__field(u32, fourcc)
+		__field(u32, width)
+		__field(u32, height)
+		__field(u64, duration_ns)
+		__field(bool, error)
+		),
+
+	TP_fast_assign(
+		__assign_str(dev);
+		__entry->fourcc = ctx->coded_fmt.fmt.pix_mp.pixelformat;
+		__entry->width = ctx->decoded_fmt.fmt.pix_mp.width;
+		__entry->height = ctx->decoded_fmt.fmt.pix_mp.height;
+		__entry->duration_ns = duration_ns;
+		__entry->error = error;
+		),
+
+	TP_printk("dev=%s fourcc=%.4s %ux%u duration_ns=%llu error=%d",
+		  __get_str(dev), (char *)&__entry->fourcc,
+		  __entry->width, __entry->height,
+		  __entry->duration_ns, __entry->error)
+);
+
+#endif /* _RKVDEC2_TRACE_H_ */
+
+/* This part must be outside protection */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH ../../drivers/media/platform/rockchip/rkvdec2
+#include <trace/define_trace.h>
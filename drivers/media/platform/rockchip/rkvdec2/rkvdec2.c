@@ -12,12 +12,14 @@
 #include <linux/genalloc.h>
 #include <linux/interrupt.h>
 #include <linux/iommu.h>
+#include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/of_platform.h>
 #include <linux/platform_device.h>
 #include <linux/pm.h>
 #include <linux/pm_runtime.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
 #include <linux/videodev2.h>
 #include <linux/workqueue.h>
@@ -27,6 +29,12 @@
 #include <media/videobuf2-vmalloc.h>
 
 #include "rkvdec2.h"
+#include "rkvdec2-trace.h"
+
+static unsigned int max_batch = 4;
+module_param(max_batch, uint, 0644);
+MODULE_PARM_DESC(max_batch,
+		 "Maximum number of frames of a context decoded back-to-back in one m2m job (default: 4)");
 
 static inline bool rkvdec2_image_fmt_match(enum rkvdec2_image_fmt fmt1,
 					   enum rkvdec2_image_fmt fmt2)
@@ -73,13 +81,69 @@ static bool rkvdec2_is_valid_fmt(struct rkvdec2_ctx *ctx, u32 fourcc,
 	return false;
 }
 
+static bool rkvdec2_is_afbc_fmt(u32 fourcc)
+{
+	return fourcc == V4L2_PIX_FMT_RA08 || fourcc == V4L2_PIX_FMT_RA10;
+}
+
+/*
+ * AFBC frames start with a header made of one 16 bytes entry per 16x16
+ * superblock, followed by the superblocks payload. The payload is sized
+ * for the worst case of uncompressible superblocks.
+ */
+static u32 rkvdec2_afbc_hdr_size(u32 width, u32 height)
+{
+	return ALIGN(ALIGN(width, 64) * ALIGN(height, 64) / 16, SZ_4K);
+}
+
+static void rkvdec2_fill_afbc_pixfmt(struct v4l2_pix_format_mplane *pix_mp)
+{
+	u32 blocks = (ALIGN(pix_mp->width, 64) / 16) *
+		     (ALIGN(pix_mp->height, 64) / 16);
+	u32 block_size = pix_mp->pixelformat == V4L2_PIX_FMT_RA10 ? 480 : 384;
+
+	pix_mp->num_planes = 1;
+	pix_mp->plane_fmt[0].bytesperline = 0;
+	pix_mp->plane_fmt[0].sizeimage =
+		rkvdec2_afbc_hdr_size(pix_mp->width, pix_mp->height) +
+		blocks * block_size;
+}
+
+void rkvdec2_config_output(struct rkvdec2_ctx *ctx,
+			   struct rkvdec2_regs_common *common)
+{
+	const struct v4l2_pix_format_mplane *dst_fmt = &ctx->decoded_fmt.fmt.pix_mp;
+	u32 hor_virstride;
+
+	if (rkvdec2_is_afbc_fmt(dst_fmt->pixelformat)) {
+		hor_virstride = ALIGN(dst_fmt->width, 64);
+
+		common->reg012.fbc_e = 1;
+		common->reg018.y_hor_virstride = hor_virstride / 16;
+		common->reg019.uv_hor_virstride = hor_virstride / 16;
+		/* With FBC enabled, this is the offset of the payload */
+		common->reg020.y_virstride =
+			rkvdec2_afbc_hdr_size(dst_fmt->width, dst_fmt->height) / 16;
+		return;
+	}
+
+	hor_virstride = dst_fmt->plane_fmt[0].bytesperline;
+
+	common->reg018.y_hor_virstride = hor_virstride / 16;
+	common->reg019.uv_hor_virstride = hor_virstride / 16;
+	common->reg020.y_virstride = hor_virstride * dst_fmt->height / 16;
+}
+
 static u32 rkvdec2_fill_decoded_pixfmt(struct rkvdec2_ctx *ctx,
 				       struct v4l2_pix_format_mplane *pix_mp)
 {
 	u32 colmv_offset;
 
-	v4l2_fill_pixfmt_mp(pix_mp, pix_mp->pixelformat,
-			    pix_mp->width, pix_mp->height);
+	if (rkvdec2_is_afbc_fmt(pix_mp->pixelformat))
+		rkvdec2_fill_afbc_pixfmt(pix_mp);
+	else
+		v4l2_fill_pixfmt_mp(pix_mp, pix_mp->pixelformat,
+				    pix_mp->width, pix_mp->height);
 
 	colmv_offset = pix_mp->plane_fmt[0].sizeimage;
 
@@ -240,6 +304,83 @@ static const struct rkvdec2_decoded_fmt_desc rkvdec2_h264_decoded_fmts[] = {
 		.fourcc = V4L2_PIX_FMT_NV20,
 		.image_fmt = RKVDEC2_IMG_FMT_422_10BIT,
 	},
+	{
+		.fourcc = V4L2_PIX_FMT_RA08,
+		.image_fmt = RKVDEC2_IMG_FMT_420_8BIT,
+	},
+	{
+		.fourcc = V4L2_PIX_FMT_RA10,
+		.image_fmt = RKVDEC2_IMG_FMT_420_10BIT,
+	},
+};
+
+static const struct rkvdec2_ctrl_desc rkvdec2_hevc_ctrl_descs[] = {
+	{
+		.cfg.id = V4L2_CID_STATELESS_HEVC_DECODE_PARAMS,
+	},
+	{
+		.cfg.id = V4L2_CID_STATELESS_HEVC_SPS,
+		.cfg.ops = &rkvdec2_ctrl_ops,
+	},
+	{
+		.cfg.id = V4L2_CID_STATELESS_HEVC_PPS,
+	},
+	{
+		.cfg.id = V4L2_CID_STATELESS_HEVC_SLICE_PARAMS,
+		.cfg.flags = V4L2_CTRL_FLAG_DYNAMIC_ARRAY,
+		.cfg.type = V4L2_CTRL_TYPE_HEVC_SLICE_PARAMS,
+		.cfg.dims = { 600 },
+	},
+	{
+		.cfg.id = V4L2_CID_STATELESS_HEVC_SCALING_MATRIX,
+	},
+	{
+		.cfg.id = V4L2_CID_STATELESS_HEVC_DECODE_MODE,
+		.cfg.min = V4L2_STATELESS_HEVC_DECODE_MODE_FRAME_BASED,
+		.cfg.max = V4L2_STATELESS_HEVC_DECODE_MODE_FRAME_BASED,
+		.cfg.def = V4L2_STATELESS_HEVC_DECODE_MODE_FRAME_BASED,
+	},
+	{
+		.cfg.id = V4L2_CID_STATELESS_HEVC_START_CODE,
+		.cfg.min = V4L2_STATELESS_HEVC_START_CODE_ANNEX_B,
+		.cfg.def = V4L2_STATELESS_HEVC_START_CODE_ANNEX_B,
+		.cfg.max = V4L2_STATELESS_HEVC_START_CODE_ANNEX_B,
+	},
+	{
+		.cfg.id = V4L2_CID_MPEG_VIDEO_HEVC_PROFILE,
+		.cfg.min = V4L2_MPEG_VIDEO_HEVC_PROFILE_MAIN,
+		.cfg.max = V4L2_MPEG_VIDEO_HEVC_PROFILE_MAIN_10,
+		.cfg.def = V4L2_MPEG_VIDEO_HEVC_PROFILE_MAIN,
+	},
+	{
+		.cfg.id = V4L2_CID_MPEG_VIDEO_HEVC_LEVEL,
+		.cfg.min = V4L2_MPEG_VIDEO_HEVC_LEVEL_1,
+		.cfg.max = V4L2_MPEG_VIDEO_HEVC_LEVEL_6_1,
+	},
+};
+
+static const struct rkvdec2_ctrls rkvdec2_hevc_ctrls = {
+	.ctrls = rkvdec2_hevc_ctrl_descs,
+	.num_ctrls = ARRAY_SIZE(rkvdec2_hevc_ctrl_descs),
+};
+
+static const struct rkvdec2_decoded_fmt_desc rkvdec2_hevc_decoded_fmts[] = {
+	{
+		.fourcc = V4L2_PIX_FMT_NV12,
+		.image_fmt = RKVDEC2_IMG_FMT_420_8BIT,
+	},
+	{
+		.fourcc = V4L2_PIX_FMT_NV15,
+		.image_fmt = RKVDEC2_IMG_FMT_420_10BIT,
+	},
+	{
+		.fourcc = V4L2_PIX_FMT_RA08,
+		.image_fmt = RKVDEC2_IMG_FMT_420_8BIT,
+	},
+	{
+		.fourcc = V4L2_PIX_FMT_RA10,
+		.image_fmt = RKVDEC2_IMG_FMT_420_10BIT,
+	},
 };
 
 static const struct rkvdec2_coded_fmt_desc rkvdec2_coded_fmts[] = {
@@ -259,6 +400,22 @@ static const struct rkvdec2_coded_fmt_desc rkvdec2_coded_fmts[] = {
 		.decoded_fmts = rkvdec2_h264_decoded_fmts,
 		.subsystem_flags = VB2_V4L2_FL_SUPPORTS_M2M_HOLD_CAPTURE_BUF,
 	},
+	{
+		.fourcc = V4L2_PIX_FMT_HEVC_SLICE,
+		.frmsize = {
+			.min_width = 64,
+			.max_width = 65472,
+			.step_width = 64,
+			.min_height = 64,
+			.max_height = 65472,
+			.step_height = 16,
+		},
+		.ctrls = &rkvdec2_hevc_ctrls,
+		.ops = &rkvdec2_hevc_fmt_ops,
+		.num_decoded_fmts = ARRAY_SIZE(rkvdec2_hevc_decoded_fmts),
+		.decoded_fmts = rkvdec2_hevc_decoded_fmts,
+		.subsystem_flags = VB2_V4L2_FL_SUPPORTS_M2M_HOLD_CAPTURE_BUF,
+	},
 };
 
 static const struct rkvdec2_coded_fmt_desc *rkvdec2_find_coded_fmt_desc(struct rkvdec2_ctx *ctx,
@@ -664,13 +821,12 @@ static struct rcb_size_info rcb_sizes[] = {
 
 static void rkvdec2_free_rcb(struct rkvdec2_ctx *ctx)
 {
-	struct rkvdec2_dev *rkvdec = ctx->dev;
-	u32 width, height;
+	struct rkvdec2_core *core = ctx->core;
 	unsigned long virt_addr;
 	int i;
 
-	width = ctx->decoded_fmt.fmt.pix_mp.width;
-	height = ctx->decoded_fmt.fmt.pix_mp.height;
+	if (!ctx->rcb_width)
+		return;
 
 	for (i = 0; i < RKVDEC2_RCB_COUNT; i++) {
 		size_t rcb_size = ctx->rcb_bufs[i].size;
@@ -682,29 +838,77 @@ static void rkvdec2_free_rcb(struct rkvdec2_ctx *ctx)
 		case RKVDEC2_ALLOC_SRAM:
 			virt_addr = (unsigned long)ctx->rcb_bufs[i].cpu;
 
-			iommu_unmap(rkvdec->iommu_domain, virt_addr, rcb_size);
-			gen_pool_free(ctx->dev->sram_pool, virt_addr, rcb_size);
+			iommu_unmap(core->iommu_domain, virt_addr, rcb_size);
+			gen_pool_free(core->sram_pool, virt_addr, rcb_size);
 			break;
 		case RKVDEC2_ALLOC_DMA:
-			dma_free_coherent(ctx->dev->dev,
+			dma_free_coherent(core->dev,
 					  rcb_size,
 					  ctx->rcb_bufs[i].cpu,
 					  ctx->rcb_bufs[i].dma);
 			break;
 		}
 	}
+
+	memset(ctx->rcb_bufs, 0, sizeof(ctx->rcb_bufs));
+
+	mutex_lock(&core->rcb_lock);
+	core->rcb_pixels -= ctx->rcb_width * ctx->rcb_height;
+	mutex_unlock(&core->rcb_lock);
+
+	ctx->rcb_width = 0;
+	ctx->rcb_height = 0;
+	ctx->rcb_sram_size = 0;
 }
 
-static int rkvdec2_allocate_rcb(struct rkvdec2_ctx *ctx)
+/*
+ * The SRAM is shared by all the contexts holding RCB buffers on a core,
+ * in proportion of their resolution, so that a first low resolution
+ * stream can't push the next ones out of it.
+ */
+static size_t rkvdec2_rcb_sram_share(struct rkvdec2_core *core, u32 pixels)
+{
+	lockdep_assert_held(&core->rcb_lock);
+
+	if (!core->sram_pool || !core->rcb_pixels)
+		return 0;
+
+	return div64_u64((u64)gen_pool_size(core->sram_pool) * pixels,
+			 core->rcb_pixels);
+}
+
+static bool rkvdec2_rcb_reusable(struct rkvdec2_ctx *ctx, u32 width, u32 height)
+{
+	struct rkvdec2_core *core = ctx->core;
+	size_t share;
+
+	if (width > ctx->rcb_width || height > ctx->rcb_height)
+		return false;
+
+	/* Give back the SRAM the other contexts are now entitled to */
+	mutex_lock(&core->rcb_lock);
+	share = rkvdec2_rcb_sram_share(core, ctx->rcb_width * ctx->rcb_height);
+	mutex_unlock(&core->rcb_lock);
+
+	return ctx->rcb_sram_size <= share;
+}
+
+static int rkvdec2_allocate_rcb(struct rkvdec2_ctx *ctx, u32 width, u32 height)
 {
 	int ret, i;
-	u32 width, height;
-	struct rkvdec2_dev *rkvdec = ctx->dev;
+	struct rkvdec2_core *core = ctx->core;
+	size_t sram_share;
 
-	memset(ctx->rcb_bufs, 0, sizeof(*ctx->rcb_bufs));
+	memset(ctx->rcb_bufs, 0, sizeof(ctx->rcb_bufs));
 
-	width = ctx->decoded_fmt.fmt.pix_mp.width;
-	height = ctx->decoded_fmt.fmt.pix_mp.height;
+	mutex_lock(&core->rcb_lock);
+	core->rcb_pixels += width * height;
+	sram_share = rkvdec2_rcb_sram_share(core, width * height);
+	mutex_unlock(&core->rcb_lock);
+
+	ctx->rcb_width = width;
+	ctx->rcb_height = height;
+	ctx->rcb_sram_size = 0;
 
 	for (i = 0; i < RKVDEC2_RCB_COUNT; i++) {
 		void *cpu = NULL;
@@ -712,26 +916,27 @@ static int rkvdec2_allocate_rcb(struct rkvdec2_ctx *ctx)
 		size_t rcb_size = RCB_SIZE(i, width, height);
 		enum rkvdec2_alloc_type alloc_type = RKVDEC2_ALLOC_SRAM;
 
-		/* Try allocating an SRAM buffer */
-		if (ctx->dev->sram_pool) {
-			if (rkvdec->iommu_domain)
-				rcb_size = ALIGN(rcb_size, 0x1000);
+		if (core->iommu_domain)
+			rcb_size = ALIGN(rcb_size, 0x1000);
 
-			cpu = gen_pool_dma_zalloc_align(ctx->dev->sram_pool,
+		/* Try allocating an SRAM buffer, within our share of it */
+		if (core->sram_pool &&
+		    ctx->rcb_sram_size + rcb_size <= sram_share) {
+			cpu = gen_pool_dma_zalloc_align(core->sram_pool,
 						rcb_size,
 						&dma,
 						0x1000);
 		}
 
 		/* If an IOMMU is used, map the SRAM address through it */
-		if (cpu && rkvdec->iommu_domain) {
+		if (cpu && core->iommu_domain) {
 			unsigned long virt_addr = (unsigned long)cpu;
 			phys_addr_t phys_addr = dma;
 
-			ret = iommu_map(rkvdec->iommu_domain, virt_addr, phys_addr,
+			ret = iommu_map(core->iommu_domain, virt_addr, phys_addr,
 					rcb_size, IOMMU_READ | IOMMU_WRITE, 0);
 			if (ret) {
-				gen_pool_free(ctx->dev->sram_pool,
+				gen_pool_free(core->sram_pool,
 				      (unsigned long)cpu,
 				      rcb_size);
 				cpu = NULL;
@@ -745,11 +950,14 @@ static int rkvdec2_allocate_rcb(struct rkvdec2_ctx *ctx)
 			dma = virt_addr;
 		}
 
+		if (cpu)
+			ctx->rcb_sram_size += rcb_size;
+
 ram_fallback:
 		/* Fallback to RAM */
 		if (!cpu) {
 			rcb_size = RCB_SIZE(i, width, height);
-			cpu = dma_alloc_coherent(ctx->dev->dev,
+			cpu = dma_alloc_coherent(core->dev,
 						 rcb_size,
 						 &dma,
 						 GFP_KERNEL);
@@ -775,6 +983,27 @@ static int rkvdec2_allocate_rcb(struct rkvdec2_ctx *ctx)
 	return ret;
 }
 
+/*
+ * RCB buffers are kept around when streaming stops, so that seeking or
+ * switching to a smaller resolution doesn't reallocate them. They are only
+ * reallocated to grow, or to give back SRAM to other contexts.
+ */
+static int rkvdec2_get_rcb(struct rkvdec2_ctx *ctx)
+{
+	u32 width = ctx->decoded_fmt.fmt.pix_mp.width;
+	u32 height = ctx->decoded_fmt.fmt.pix_mp.height;
+
+	if (ctx->rcb_width && rkvdec2_rcb_reusable(ctx, width, height))
+		return 0;
+
+	width = max(width, ctx->rcb_width);
+	height = max(height, ctx->rcb_height);
+
+	rkvdec2_free_rcb(ctx);
+
+	return rkvdec2_allocate_rcb(ctx, width, height);
+}
+
 static int rkvdec2_start_streaming(struct vb2_queue *q, unsigned int count)
 {
 	struct rkvdec2_ctx *ctx = vb2_get_drv_priv(q);
@@ -788,22 +1017,17 @@ static int rkvdec2_start_streaming(struct vb2_queue *q, unsigned int count)
 	if (WARN_ON(!desc))
 		return -EINVAL;
 
-	ret = rkvdec2_allocate_rcb(ctx);
+	ret = rkvdec2_get_rcb(ctx);
 	if (ret)
 		return ret;
 
 	if (desc->ops->start) {
 		ret = desc->ops->start(ctx);
 		if (ret)
-			goto err_ops_start;
+			return ret;
 	}
 
 	return 0;
-
-err_ops_start:
-	rkvdec2_free_rcb(ctx);
-
-	return ret;
 }
 
 static void rkvdec2_queue_cleanup(struct vb2_queue *vq, u32 state)
@@ -839,8 +1063,6 @@ static void rkvdec2_stop_streaming(struct vb2_queue *q)
 
 		if (desc->ops->stop)
 			desc->ops->stop(ctx);
-
-		rkvdec2_free_rcb(ctx);
 	}
 
 	rkvdec2_queue_cleanup(q, VB2_BUF_STATE_ERROR);
@@ -887,21 +1109,63 @@ static void rkvdec2_job_finish_no_pm(struct rkvdec2_ctx *ctx,
 		ctx->coded_fmt_desc->ops->done(ctx, src_buf, dst_buf, result);
 	}
 
-	v4l2_m2m_buf_done_and_job_finish(ctx->dev->m2m_dev, ctx->fh.m2m_ctx,
+	v4l2_m2m_buf_done_and_job_finish(ctx->core->m2m_dev, ctx->fh.m2m_ctx,
 					 result);
 }
 
 static void rkvdec2_job_finish(struct rkvdec2_ctx *ctx,
 			       enum vb2_buffer_state result)
 {
-	struct rkvdec2_dev *rkvdec = ctx->dev;
+	struct rkvdec2_core *core = ctx->core;
 
-	pm_runtime_mark_last_busy(rkvdec->dev);
-	pm_runtime_put_autosuspend(rkvdec->dev);
+	pm_runtime_mark_last_busy(core->dev);
+	pm_runtime_put_autosuspend(core->dev);
 
 	rkvdec2_job_finish_no_pm(ctx, result);
 }
 
+/*
+ * Decode the next frame of the context straight from the interrupt thread
+ * when it already has buffers queued, instead of going through the m2m
+ * scheduler and runtime PM for every frame. The m2m job ends after
+ * max_batch frames, to give other contexts a chance to run.
+ */
+static bool rkvdec2_job_continue(struct rkvdec2_ctx *ctx,
+				 enum vb2_buffer_state result)
+{
+	const struct rkvdec2_coded_fmt_desc *desc = ctx->coded_fmt_desc;
+	struct v4l2_m2m_ctx *m2m_ctx = ctx->fh.m2m_ctx;
+	struct rkvdec2_core *core = ctx->core;
+	struct vb2_v4l2_buffer *src_buf, *dst_buf;
+
+	if (result != VB2_BUF_STATE_DONE || ++ctx->batch_count >= max_batch)
+		return false;
+
+	if (v4l2_m2m_num_src_bufs_ready(m2m_ctx) < 2 ||
+	    v4l2_m2m_num_dst_bufs_ready(m2m_ctx) < 2)
+		return false;
+
+	/* Let the m2m core deal with capture buffers held across slices */
+	src_buf = v4l2_m2m_next_src_buf(m2m_ctx);
+	if (src_buf->flags & V4L2_BUF_FLAG_M2M_HOLD_CAPTURE_BUF)
+		return false;
+
+	dst_buf = v4l2_m2m_next_dst_buf(m2m_ctx);
+	if (desc->ops->done)
+		desc->ops->done(ctx, src_buf, dst_buf, result);
+
+	v4l2_m2m_buf_done(v4l2_m2m_src_buf_remove(m2m_ctx), result);
+	v4l2_m2m_buf_done(v4l2_m2m_dst_buf_remove(m2m_ctx), result);
+
+	core->frame_start_ns = ktime_get_ns();
+	if (desc->ops->run(ctx)) {
+		cancel_delayed_work(&core->watchdog_work);
+		rkvdec2_job_finish(ctx, VB2_BUF_STATE_ERROR);
+	}
+
+	return true;
+}
+
 void rkvdec2_run_preamble(struct rkvdec2_ctx *ctx, struct rkvdec2_run *run)
 {
 	struct media_request *src_req;
@@ -930,22 +1194,24 @@ void rkvdec2_run_postamble(struct rkvdec2_ctx *ctx, struct rkvdec2_run *run)
 static void rkvdec2_device_run(void *priv)
 {
 	struct rkvdec2_ctx *ctx = priv;
-	struct rkvdec2_dev *rkvdec = ctx->dev;
+	struct rkvdec2_core *core = ctx->core;
 	const struct rkvdec2_coded_fmt_desc *desc = ctx->coded_fmt_desc;
 	int ret;
 
 	if (WARN_ON(!desc))
 		return;
 
-	ret = pm_runtime_resume_and_get(rkvdec->dev);
+	ret = pm_runtime_resume_and_get(core->dev);
 	if (ret < 0) {
 		rkvdec2_job_finish_no_pm(ctx, VB2_BUF_STATE_ERROR);
 		return;
 	}
 
+	ctx->batch_count = 0;
+	core->frame_start_ns = ktime_get_ns();
 	ret = desc->ops->run(ctx);
 	if (ret) {
-		cancel_delayed_work(&rkvdec->watchdog_work);
+		cancel_delayed_work(&core->watchdog_work);
 		rkvdec2_job_finish(ctx, VB2_BUF_STATE_ERROR);
 	}
 }
@@ -975,7 +1241,7 @@ static int rkvdec2_queue_init(void *priv,
 	src_vq->buf_struct_size = sizeof(struct v4l2_m2m_buffer);
 	src_vq->timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_COPY;
 	src_vq->lock = &rkvdec->vdev_lock;
-	src_vq->dev = rkvdec->v4l2_dev.dev;
+	src_vq->dev = ctx->core->dev;
 	src_vq->supports_requests = true;
 	src_vq->requires_requests = true;
 
@@ -993,7 +1259,7 @@ static int rkvdec2_queue_init(void *priv,
 	dst_vq->buf_struct_size = sizeof(struct rkvdec2_decoded_buffer);
 	dst_vq->timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_COPY;
 	dst_vq->lock = &rkvdec->vdev_lock;
-	dst_vq->dev = rkvdec->v4l2_dev.dev;
+	dst_vq->dev = ctx->core->dev;
 
 	return vb2_queue_init(dst_vq);
 }
@@ -1042,6 +1308,33 @@ static int rkvdec2_init_ctrls(struct rkvdec2_ctx *ctx)
 	return ret;
 }
 
+/*
+ * A context stays on the same core for its whole lifetime: its buffers are
+ * only mapped in the IOMMU of that core, and the RCB buffers live in the
+ * SRAM of that core. Contexts are spread over the cores when they are
+ * opened, so that independent streams are decoded in parallel.
+ */
+static struct rkvdec2_core *rkvdec2_get_core(struct rkvdec2_dev *rkvdec)
+{
+	struct rkvdec2_core *core = rkvdec->cores[0];
+	unsigned int i;
+
+	for (i = 1; i < rkvdec->num_cores; i++) {
+		if (atomic_read(&rkvdec->cores[i]->num_ctxs) <
+		    atomic_read(&core->num_ctxs))
+			core = rkvdec->cores[i];
+	}
+
+	atomic_inc(&core->num_ctxs);
+
+	return core;
+}
+
+static void rkvdec2_put_core(struct rkvdec2_core *core)
+{
+	atomic_dec(&core->num_ctxs);
+}
+
 static int rkvdec2_open(struct file *filp)
 {
 	struct rkvdec2_dev *rkvdec = video_drvdata(filp);
@@ -1053,6 +1346,7 @@ static int rkvdec2_open(struct file *filp)
 		return -ENOMEM;
 
 	ctx->dev = rkvdec;
+	ctx->core = rkvdec2_get_core(rkvdec);
 	rkvdec2_reset_coded_fmt(ctx);
 	rkvdec2_reset_decoded_fmt(ctx);
 	v4l2_fh_init(&ctx->fh, video_devdata(filp));
@@ -1061,7 +1355,7 @@ static int rkvdec2_open(struct file *filp)
 	if (ret)
 		goto err_free_ctx;
 
-	ctx->fh.m2m_ctx = v4l2_m2m_ctx_init(rkvdec->m2m_dev, ctx,
+	ctx->fh.m2m_ctx = v4l2_m2m_ctx_init(ctx->core->m2m_dev, ctx,
 					    rkvdec2_queue_init);
 	if (IS_ERR(ctx->fh.m2m_ctx)) {
 		ret = PTR_ERR(ctx->fh.m2m_ctx);
@@ -1077,6 +1371,7 @@ static int rkvdec2_open(struct file *filp)
 	v4l2_ctrl_handler_free(&ctx->ctrl_hdl);
 
 err_free_ctx:
+	rkvdec2_put_core(ctx->core);
 	kfree(ctx);
 	return ret;
 }
@@ -1087,8 +1382,10 @@ static int rkvdec2_release(struct file *filp)
 
 	v4l2_fh_del(&ctx->fh);
 	v4l2_m2m_ctx_release(ctx->fh.m2m_ctx);
+	rkvdec2_free_rcb(ctx);
 	v4l2_ctrl_handler_free(&ctx->ctrl_hdl);
 	v4l2_fh_exit(&ctx->fh);
+	rkvdec2_put_core(ctx->core);
 	kfree(ctx);
 
 	return 0;
@@ -1113,13 +1410,6 @@ static int rkvdec2_v4l2_init(struct rkvdec2_dev *rkvdec)
 		return ret;
 	}
 
-	rkvdec->m2m_dev = v4l2_m2m_init(&rkvdec2_m2m_ops);
-	if (IS_ERR(rkvdec->m2m_dev)) {
-		v4l2_err(&rkvdec->v4l2_dev, "Failed to init mem2mem device\n");
-		ret = PTR_ERR(rkvdec->m2m_dev);
-		goto err_unregister_v4l2;
-	}
-
 	rkvdec->mdev.dev = rkvdec->dev;
 	strscpy(rkvdec->mdev.model, "rkvdec2", sizeof(rkvdec->mdev.model));
 	strscpy(rkvdec->mdev.bus_info, "platform:rkvdec2",
@@ -1145,7 +1435,12 @@ static int rkvdec2_v4l2_init(struct rkvdec2_dev *rkvdec)
 		goto err_cleanup_mc;
 	}
 
-	ret = v4l2_m2m_register_media_controller(rkvdec->m2m_dev, &rkvdec->vdev,
+	/*
+	 * All cores are behind the same video device, only expose the
+	 * processing entity of the first one.
+	 */
+	ret = v4l2_m2m_register_media_controller(rkvdec->cores[0]->m2m_dev,
+						 &rkvdec->vdev,
 						 MEDIA_ENT_F_PROC_VIDEO_DECODER);
 	if (ret) {
 		v4l2_err(&rkvdec->v4l2_dev,
@@ -1162,16 +1457,13 @@ static int rkvdec2_v4l2_init(struct rkvdec2_dev *rkvdec)
 	return 0;
 
 err_unregister_mc:
-	v4l2_m2m_unregister_media_controller(rkvdec->m2m_dev);
+	v4l2_m2m_unregister_media_controller(rkvdec->cores[0]->m2m_dev);
 
 err_unregister_vdev:
 	video_unregister_device(&rkvdec->vdev);
 
 err_cleanup_mc:
 	media_device_cleanup(&rkvdec->mdev);
-	v4l2_m2m_release(rkvdec->m2m_dev);
-
-err_unregister_v4l2:
 	v4l2_device_unregister(&rkvdec->v4l2_dev);
 	return ret;
 }
@@ -1179,37 +1471,36 @@ static int rkvdec2_v4l2_init(struct rkvdec2_dev *rkvdec)
 static void rkvdec2_v4l2_cleanup(struct rkvdec2_dev *rkvdec)
 {
 	media_device_unregister(&rkvdec->mdev);
-	v4l2_m2m_unregister_media_controller(rkvdec->m2m_dev);
+	v4l2_m2m_unregister_media_controller(rkvdec->cores[0]->m2m_dev);
 	video_unregister_device(&rkvdec->vdev);
 	media_device_cleanup(&rkvdec->mdev);
-	v4l2_m2m_release(rkvdec->m2m_dev);
 	v4l2_device_unregister(&rkvdec->v4l2_dev);
 }
 
-static void rkvdec2_iommu_restore(struct rkvdec2_dev *rkvdec)
+static void rkvdec2_iommu_restore(struct rkvdec2_core *core)
 {
-	if (rkvdec->iommu_domain && rkvdec->empty_domain) {
+	if (core->iommu_domain && core->empty_domain) {
 		/* To rewrite mapping into the attached IOMMU core, attach a new empty domain that
 		 * will program an empty table, then attach the default domain again to reprogram
 		 * all cached mappings.
 		 * This is safely done in this interrupt handler to make sure no memory get mapped
 		 * through the IOMMU while the empty domain is attached.
 		 */
-		iommu_attach_device(rkvdec->empty_domain, rkvdec->dev);
-		iommu_detach_device(rkvdec->empty_domain, rkvdec->dev);
-		iommu_attach_device(rkvdec->iommu_domain, rkvdec->dev);
+		iommu_attach_device(core->empty_domain, core->dev);
+		iommu_detach_device(core->empty_domain, core->dev);
+		iommu_attach_device(core->iommu_domain, core->dev);
 	}
 }
 
 static irqreturn_t rkvdec2_irq_handler(int irq, void *priv)
 {
-	struct rkvdec2_dev *rkvdec = priv;
-	struct rkvdec2_ctx *ctx = v4l2_m2m_get_curr_priv(rkvdec->m2m_dev);
+	struct rkvdec2_core *core = priv;
+	struct rkvdec2_ctx *ctx = v4l2_m2m_get_curr_priv(core->m2m_dev);
 	enum vb2_buffer_state state;
 	bool need_reset;
 	u32 status;
 
-	status = readl(rkvdec->regs + RKVDEC2_REG_STA_INT);
+	status = readl(core->regs + RKVDEC2_REG_STA_INT);
 	state = (status & STA_INT_DEC_RDY_STA) ?
 		VB2_BUF_STATE_DONE : VB2_BUF_STATE_ERROR;
 
@@ -1217,31 +1508,71 @@ static irqreturn_t rkvdec2_irq_handler(int irq, void *priv)
 			      (status & STA_INT_SOFTRESET_RDY);
 
 	/* Clear interrupt status */
-	writel(0, rkvdec->regs + RKVDEC2_REG_STA_INT);
+	writel(0, core->regs + RKVDEC2_REG_STA_INT);
 
 	if (need_reset)
-		rkvdec2_iommu_restore(rkvdec);
+		rkvdec2_iommu_restore(core);
+
+	if (cancel_delayed_work(&core->watchdog_work)) {
+		u64 ns = ktime_get_ns() - core->frame_start_ns;
 
-	if (cancel_delayed_work(&rkvdec->watchdog_work))
-		rkvdec2_job_finish(ctx, state);
+		core->busy_ns += ns;
+		trace_rkvdec2_frame_done(ctx, ns, state != VB2_BUF_STATE_DONE);
+
+		if (!rkvdec2_job_continue(ctx, state))
+			rkvdec2_job_finish(ctx, state);
+	}
 
 	return IRQ_HANDLED;
 }
 
 static void rkvdec2_watchdog_func(struct work_struct *work)
 {
-	struct rkvdec2_dev *rkvdec = container_of(to_delayed_work(work), struct rkvdec2_dev,
+	struct rkvdec2_core *core = container_of(to_delayed_work(work), struct rkvdec2_core,
 			      watchdog_work);
-	struct rkvdec2_ctx *ctx = v4l2_m2m_get_curr_priv(rkvdec->m2m_dev);
+	struct rkvdec2_ctx *ctx = v4l2_m2m_get_curr_priv(core->m2m_dev);
 
 	if (ctx) {
-		dev_err(rkvdec->dev, "Frame processing timed out!\n");
-		writel(RKVDEC2_REG_DEC_IRQ_DISABLE, rkvdec->regs + RKVDEC2_REG_IMPORTANT_EN);
-		writel(0, rkvdec->regs + RKVDEC2_REG_DEC_E);
+		u64 ns = ktime_get_ns() - core->frame_start_ns;
+
+		dev_err(core->dev, "Frame processing timed out!\n");
+		core->busy_ns += ns;
+		trace_rkvdec2_frame_done(ctx, ns, true);
+		writel(RKVDEC2_REG_DEC_IRQ_DISABLE, core->regs + RKVDEC2_REG_IMPORTANT_EN);
+		writel(0, core->regs + RKVDEC2_REG_DEC_E);
 		rkvdec2_job_finish(ctx, VB2_BUF_STATE_ERROR);
 	}
 }
 
+/*
+ * Load of a core, for userspace picking the least loaded decoder: the number
+ * of contexts assigned to it and the total time it spent decoding.
+ */
+static ssize_t contexts_show(struct device *dev, struct device_attribute *attr,
+			     char *buf)
+{
+	struct rkvdec2_core *core = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%d\n", atomic_read(&core->num_ctxs));
+}
+static DEVICE_ATTR_RO(contexts);
+
+static ssize_t busy_ns_show(struct device *dev, struct device_attribute *attr,
+			    char *buf)
+{
+	struct rkvdec2_core *core = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%llu\n", READ_ONCE(core->busy_ns));
+}
+static DEVICE_ATTR_RO(busy_ns);
+
+static struct attribute *rkvdec2_attrs[] = {
+	&dev_attr_contexts.attr,
+	&dev_attr_busy_ns.attr,
+	NULL
+};
+ATTRIBUTE_GROUPS(rkvdec2);
+
 static const struct of_device_id of_rkvdec2_match[] = {
 	{ .compatible = "rockchip,rk3588-vdec" },
 	{ /* sentinel */ }
@@ -1249,110 +1580,180 @@ static const struct of_device_id of_rkvdec2_match[] = {
 MODULE_DEVICE_TABLE(of, of_rkvdec2_match);
 
 /*
- * Some SoCs, like RK3588 have multiple identical vdpu34x cores, but the
- * kernel is currently missing support for multi-core handling. Exposing
+ * Some SoCs, like RK3588 have multiple identical vdpu34x cores. Exposing
  * separate devices for each core to userspace is bad, since that does
- * not allow scheduling tasks properly (and creates ABI). With this workaround
- * the driver will only probe for the first core and early exit for the other
- * cores. Once the driver gains multi-core support, the same technique
- * can be used to cluster all cores together in one linux device.
+ * not allow scheduling tasks properly (and creates ABI). Instead, every
+ * core probes its own hardware resources, and the first compatible node
+ * found from the root node, the main core, clusters all of them behind a
+ * single video device.
  */
-static int rkvdec2_disable_multicore(struct rkvdec2_dev *rkvdec)
+static bool rkvdec2_is_main_core(struct device *dev, const char *compatible)
 {
-	const char *compatible;
 	struct device_node *node;
-	int ret;
-
-	/* Intentionally ignores the fallback strings */
-	ret = of_property_read_string(rkvdec->dev->of_node, "compatible", &compatible);
-	if (ret)
-		return ret;
 
-	/* first compatible node found from the root node is considered the main core */
 	node = of_find_compatible_node(NULL, NULL, compatible);
-	if (!node)
-		return -EINVAL; /* broken DT? */
+	of_node_put(node);
+
+	return node == dev->of_node;
+}
 
-	if (rkvdec->dev->of_node != node) {
-		dev_info(rkvdec->dev, "missing multi-core support, ignoring this instance\n");
-		return -ENODEV;
+static int rkvdec2_add_core(struct rkvdec2_dev *rkvdec, struct device_node *node)
+{
+	struct platform_device *pdev;
+	struct rkvdec2_core *core;
+	struct device_link *link;
+
+	if (rkvdec->num_cores == RKVDEC2_MAX_CORES) {
+		dev_warn(rkvdec->dev, "too many cores, ignoring %pOF\n", node);
+		return 0;
 	}
 
+	pdev = of_find_device_by_node(node);
+	if (!pdev)
+		return -EPROBE_DEFER;
+
+	/* The drvdata is only set once the core is fully probed */
+	core = platform_get_drvdata(pdev);
+	if (!core) {
+		put_device(&pdev->dev);
+		return -EPROBE_DEFER;
+	}
+
+	/* Make sure the main core goes away before any of the other cores */
+	link = device_link_add(rkvdec->dev, &pdev->dev,
+			       DL_FLAG_AUTOREMOVE_CONSUMER);
+	put_device(&pdev->dev);
+	if (!link) {
+		dev_err(rkvdec->dev, "Could not link to %pOF\n", node);
+		return -EINVAL;
+	}
+
+	rkvdec->cores[rkvdec->num_cores++] = core;
+
 	return 0;
 }
 
-static int rkvdec2_probe(struct platform_device *pdev)
+static int rkvdec2_main_init(struct rkvdec2_core *core, const char *compatible)
 {
 	struct rkvdec2_dev *rkvdec;
-	unsigned int dma_bit_mask = 40;
-	int ret, irq;
+	struct device_node *node;
+	int ret;
 
-	rkvdec = devm_kzalloc(&pdev->dev, sizeof(*rkvdec), GFP_KERNEL);
+	rkvdec = devm_kzalloc(core->dev, sizeof(*rkvdec), GFP_KERNEL);
 	if (!rkvdec)
 		return -ENOMEM;
 
-	platform_set_drvdata(pdev, rkvdec);
-	rkvdec->dev = &pdev->dev;
+	rkvdec->dev = core->dev;
+	rkvdec->cores[0] = core;
+	rkvdec->num_cores = 1;
+	mutex_init(&rkvdec->vdev_lock);
+
+	for_each_compatible_node(node, NULL, compatible) {
+		if (node == core->dev->of_node || !of_device_is_available(node))
+			continue;
+
+		ret = rkvdec2_add_core(rkvdec, node);
+		if (ret) {
+			of_node_put(node);
+			return ret;
+		}
+	}
 
-	ret = rkvdec2_disable_multicore(rkvdec);
+	ret = rkvdec2_v4l2_init(rkvdec);
 	if (ret)
 		return ret;
 
-	mutex_init(&rkvdec->vdev_lock);
-	INIT_DELAYED_WORK(&rkvdec->watchdog_work, rkvdec2_watchdog_func);
+	core->rkvdec = rkvdec;
+	dev_info(core->dev, "using %u decoder core(s)\n", rkvdec->num_cores);
 
-	ret = devm_clk_bulk_get_all_enabled(&pdev->dev, &rkvdec->clocks);
+	return 0;
+}
+
+static int rkvdec2_probe(struct platform_device *pdev)
+{
+	struct rkvdec2_core *core;
+	unsigned int dma_bit_mask = 40;
+	const char *compatible;
+	int ret, irq;
+
+	/* Intentionally ignores the fallback strings */
+	ret = of_property_read_string(pdev->dev.of_node, "compatible", &compatible);
+	if (ret)
+		return ret;
+
+	core = devm_kzalloc(&pdev->dev, sizeof(*core), GFP_KERNEL);
+	if (!core)
+		return -ENOMEM;
+
+	core->dev = &pdev->dev;
+	atomic_set(&core->num_ctxs, 0);
+	INIT_DELAYED_WORK(&core->watchdog_work, rkvdec2_watchdog_func);
+	mutex_init(&core->rcb_lock);
+
+	ret = devm_clk_bulk_get_all_enabled(&pdev->dev, &core->clocks);
 	if (ret < 0)
 		return ret;
 
-	rkvdec->clk_count = ret;
-	rkvdec->axi_clk = devm_clk_get(&pdev->dev, "axi");
+	core->clk_count = ret;
+	core->axi_clk = devm_clk_get(&pdev->dev, "axi");
+
+	core->regs = devm_platform_ioremap_resource_byname(pdev, "function");
+	if (IS_ERR(core->regs))
+		return PTR_ERR(core->regs);
 
-	rkvdec->regs = devm_platform_ioremap_resource_byname(pdev, "function");
-	if (IS_ERR(rkvdec->regs))
-		return PTR_ERR(rkvdec->regs);
+	core->m2m_dev = v4l2_m2m_init(&rkvdec2_m2m_ops);
+	if (IS_ERR(core->m2m_dev)) {
+		dev_err(&pdev->dev, "Failed to init mem2mem device\n");
+		return PTR_ERR(core->m2m_dev);
+	}
 
 	irq = platform_get_irq(pdev, 0);
-	if (irq <= 0)
-		return -ENXIO;
+	if (irq <= 0) {
+		ret = -ENXIO;
+		goto err_release_m2m;
+	}
 
 	ret = devm_request_threaded_irq(&pdev->dev, irq, NULL,
 					rkvdec2_irq_handler, IRQF_ONESHOT,
-					dev_name(&pdev->dev), rkvdec);
+					dev_name(&pdev->dev), core);
 	if (ret) {
 		dev_err(&pdev->dev, "Could not request vdec2 IRQ\n");
-		return ret;
+		goto err_release_m2m;
 	}
 
-	rkvdec->iommu_domain = iommu_get_domain_for_dev(&pdev->dev);
-	if (!rkvdec->iommu_domain) {
+	core->iommu_domain = iommu_get_domain_for_dev(&pdev->dev);
+	if (!core->iommu_domain) {
 		/* Without iommu, only the lower 32 bits of ram can be used */
 		vb2_dma_contig_set_max_seg_size(&pdev->dev, U32_MAX);
 		dev_info(&pdev->dev, "No IOMMU domain found\n");
 	} else {
-		rkvdec->empty_domain = iommu_paging_domain_alloc(rkvdec->dev);
+		core->empty_domain = iommu_paging_domain_alloc(core->dev);
 
-		if (!rkvdec->empty_domain)
-			dev_warn(rkvdec->dev, "cannot alloc new empty domain\n");
+		if (!core->empty_domain)
+			dev_warn(core->dev, "cannot alloc new empty domain\n");
 	}
 
 	ret = dma_set_coherent_mask(&pdev->dev, DMA_BIT_MASK(dma_bit_mask));
 	if (ret) {
 		dev_err(&pdev->dev, "Could not set DMA coherent mask.\n");
-		return ret;
+		goto err_free_domain;
 	}
 
-	rkvdec->sram_pool = of_gen_pool_get(pdev->dev.of_node, "sram", 0);
-	if (!rkvdec->sram_pool)
+	core->sram_pool = of_gen_pool_get(pdev->dev.of_node, "sram", 0);
+	if (!core->sram_pool)
 		dev_info(&pdev->dev, "No sram node, RCB will be stored in RAM\n");
 
 	pm_runtime_set_autosuspend_delay(&pdev->dev, 100);
 	pm_runtime_use_autosuspend(&pdev->dev);
 	pm_runtime_enable(&pdev->dev);
 
-	ret = rkvdec2_v4l2_init(rkvdec);
-	if (ret)
-		goto err_disable_runtime_pm;
+	platform_set_drvdata(pdev, core);
+
+	if (rkvdec2_is_main_core(&pdev->dev, compatible)) {
+		ret = rkvdec2_main_init(core, compatible);
+		if (ret)
+			goto err_disable_runtime_pm;
+	}
 
 	return 0;
 
@@ -1360,44 +1761,54 @@ static int rkvdec2_probe(struct platform_device *pdev)
 	pm_runtime_dont_use_autosuspend(&pdev->dev);
 	pm_runtime_disable(&pdev->dev);
 
-	if (rkvdec->sram_pool)
-		gen_pool_destroy(rkvdec->sram_pool);
+	if (core->sram_pool)
+		gen_pool_destroy(core->sram_pool);
+
+err_free_domain:
+	if (core->empty_domain)
+		iommu_domain_free(core->empty_domain);
+
+err_release_m2m:
+	v4l2_m2m_release(core->m2m_dev);
 
 	return ret;
 }
 
 static void rkvdec2_remove(struct platform_device *pdev)
 {
-	struct rkvdec2_dev *rkvdec = platform_get_drvdata(pdev);
+	struct rkvdec2_core *core = platform_get_drvdata(pdev);
+
+	if (core->rkvdec)
+		rkvdec2_v4l2_cleanup(core->rkvdec);
 
-	cancel_delayed_work_sync(&rkvdec->watchdog_work);
+	cancel_delayed_work_sync(&core->watchdog_work);
 
-	rkvdec2_v4l2_cleanup(rkvdec);
+	v4l2_m2m_release(core->m2m_dev);
 	pm_runtime_disable(&pdev->dev);
 	pm_runtime_dont_use_autosuspend(&pdev->dev);
 
-	if (rkvdec->sram_pool)
-		gen_pool_destroy(rkvdec->sram_pool);
+	if (core->sram_pool)
+		gen_pool_destroy(core->sram_pool);
 
-	if (rkvdec->empty_domain)
-		iommu_domain_free(rkvdec->empty_domain);
+	if (core->empty_domain)
+		iommu_domain_free(core->empty_domain);
 }
 
 #ifdef CONFIG_PM
 static int rkvdec2_runtime_resume(struct device *dev)
 {
-	struct rkvdec2_dev *rkvdec = dev_get_drvdata(dev);
+	struct rkvdec2_core *core = dev_get_drvdata(dev);
 
-	return clk_bulk_prepare_enable(rkvdec->clk_count,
-				       rkvdec->clocks);
+	return clk_bulk_prepare_enable(core->clk_count,
+				       core->clocks);
 }
 
 static int rkvdec2_runtime_suspend(struct device *dev)
 {
-	struct rkvdec2_dev *rkvdec = dev_get_drvdata(dev);
+	struct rkvdec2_core *core = dev_get_drvdata(dev);
 
-	clk_bulk_disable_unprepare(rkvdec->clk_count,
-				   rkvdec->clocks);
+	clk_bulk_disable_unprepare(core->clk_count,
+				   core->clocks);
 	return 0;
 }
 #endif
@@ -1415,6 +1826,7 @@ static struct platform_driver rkvdec2_driver = {
 		   .name = "rkvdec2",
 		   .of_match_table = of_rkvdec2_match,
 		   .pm = &rkvdec2_pm_ops,
+		   .dev_groups = rkvdec2_groups,
 	},
 };
 module_platform_driver(rkvdec2_driver);
@@ -25,6 +25,7 @@
 #include "rkvdec2-regs.h"
 
 #define RKVDEC2_RCB_COUNT	10
+#define RKVDEC2_MAX_CORES	2
 
 struct rkvdec2_ctx;
 
@@ -105,21 +106,39 @@ struct rkvdec2_coded_fmt_desc {
 	u32 subsystem_flags;
 };
 
-struct rkvdec2_dev {
-	struct v4l2_device v4l2_dev;
-	struct media_device mdev;
-	struct video_device vdev;
-	struct v4l2_m2m_dev *m2m_dev;
+/*
+ * One instance of the decoder hardware. Each core has its own registers,
+ * interrupt, clocks, IOMMU and SRAM, and runs the jobs of the contexts
+ * assigned to it through its own m2m device.
+ */
+struct rkvdec2_core {
 	struct device *dev;
+	struct v4l2_m2m_dev *m2m_dev;
 	struct clk_bulk_data *clocks;
 	unsigned int clk_count;
 	struct clk *axi_clk;
 	void __iomem *regs;
 	struct gen_pool *sram_pool;
-	struct mutex vdev_lock; /* serializes ioctls */
 	struct delayed_work watchdog_work;
 	struct iommu_domain *iommu_domain;
 	struct iommu_domain *empty_domain;
+	atomic_t num_ctxs;
+	u64 frame_start_ns;
+	u64 busy_ns;
+	struct mutex rcb_lock; /* protects rcb_pixels */
+	u64 rcb_pixels;
+	/* Only set on the main core */
+	struct rkvdec2_dev *rkvdec;
+};
+
+struct rkvdec2_dev {
+	struct v4l2_device v4l2_dev;
+	struct media_device mdev;
+	struct video_device vdev;
+	struct device *dev;
+	struct mutex vdev_lock; /* serializes ioctls */
+	struct rkvdec2_core *cores[RKVDEC2_MAX_CORES];
+	unsigned int num_cores;
 };
 
 struct rkvdec2_ctx {
@@ -130,9 +149,14 @@ struct rkvdec2_ctx {
 	enum rkvdec2_image_fmt image_fmt;
 	struct v4l2_ctrl_handler ctrl_hdl;
 	struct rkvdec2_dev *dev;
+	struct rkvdec2_core *core;
 	struct rkvdec2_aux_buf rcb_bufs[RKVDEC2_RCB_COUNT];
+	u32 rcb_width;
+	u32 rcb_height;
+	size_t rcb_sram_size;
 
 	u32 colmv_offset;
+	unsigned int batch_count;
 
 	void *priv;
 };
@@ -142,9 +166,12 @@ static inline struct rkvdec2_ctx *fh_to_rkvdec2_ctx(struct v4l2_fh *fh)
 	return container_of(fh, struct rkvdec2_ctx, fh);
 }
 
+void rkvdec2_config_output(struct rkvdec2_ctx *ctx,
+			   struct rkvdec2_regs_common *common);
 void rkvdec2_run_preamble(struct rkvdec2_ctx *ctx, struct rkvdec2_run *run);
 void rkvdec2_run_postamble(struct rkvdec2_ctx *ctx, struct rkvdec2_run *run);
 
 extern const struct rkvdec2_coded_fmt_ops rkvdec2_h264_fmt_ops;
+extern const struct rkvdec2_coded_fmt_ops rkvdec2_hevc_fmt_ops;
 
 #endif /* RKVDEC_H_ */
@@ -15,6 +15,7 @@
 #include <linux/gpio/consumer.h>
 #include <linux/hdmi.h>
 #include <linux/interrupt.h>
+#include <linux/iommu.h>
 #include <linux/irq.h>
 #include <linux/mfd/syscon.h>
 #include <linux/math64.h>
@@ -27,6 +28,7 @@
 #include <linux/property.h>
 #include <linux/regmap.h>
 #include <linux/reset.h>
+#include <linux/snps_hdmirx.h>
 #include <linux/v4l2-dv-timings.h>
 #include <linux/workqueue.h>
 
@@ -41,6 +43,8 @@
 #include <media/videobuf2-dma-contig.h>
 #include <media/videobuf2-v4l2.h>
 
+#include <sound/hdmi-codec.h>
+
 #include "snps_hdmirx.h"
 #include "snps_hdmirx_cec.h"
 
@@ -49,6 +53,9 @@
 #define HDMIRX_PLANE_Y					0
 #define HDMIRX_PLANE_CBCR				1
 #define FILTER_FRAME_CNT				6
+#define SIGNAL_LOCK_TIMEOUT_MS				3000
+/* A few frame times, even at 24 Hz */
+#define SIGNAL_RELOCK_TIMEOUT_MS			150
 
 static int debug;
 module_param(debug, int, 0644);
@@ -116,6 +123,7 @@ struct hdmirx_stream {
 	wait_queue_head_t wq_stopped;
 	u32 frame_idx;
 	u32 line_flag_int_cnt;
+	u32 line_flag;
 	u32 irq_stat;
 };
 
@@ -132,6 +140,9 @@ struct snps_hdmirx_dev {
 	struct delayed_work delayed_work_hotplug;
 	struct delayed_work delayed_work_res_change;
 	struct hdmirx_cec *cec;
+	struct platform_device *audio_pdev;
+	hdmi_codec_plugged_cb audio_plugged_cb;
+	struct device *audio_codec_dev;
 	struct mutex stream_lock; /* to lock video stream capture */
 	struct mutex work_lock; /* to lock the critical section of hotplug event */
 	struct reset_control_bulk_data resets[HDMIRX_NUM_RST];
@@ -155,6 +166,8 @@ struct snps_hdmirx_dev {
 	u32 edid_blocks_written;
 	u32 cur_fmt_fourcc;
 	u32 color_depth;
+	u32 audio_fs;
+	u32 audio_channels;
 	spinlock_t rst_lock; /* to lock register access */
 	u8 edid[EDID_NUM_BLOCKS_MAX * EDID_BLOCK_SIZE];
 };
@@ -215,6 +228,9 @@ static int hdmirx_subscribe_event(struct v4l2_fh *fh,
 		return v4l2_src_change_event_subscribe(fh, sub);
 	case V4L2_EVENT_CTRL:
 		return v4l2_ctrl_subscribe_event(fh, sub);
+	case V4L2_EVENT_SNPS_HDMIRX_PARTIAL_FRAME:
+	case V4L2_EVENT_SNPS_HDMIRX_AUDIO_START:
+		return v4l2_event_subscribe(fh, sub, 2, NULL);
 	default:
 		break;
 	}
@@ -613,11 +629,22 @@ static void hdmirx_interrupts_setup(struct snps_hdmirx_dev *hdmirx_dev, bool en)
 	enable_irq(hdmirx_dev->hdmi_irq);
 }
 
+static void hdmirx_audio_plugged(struct snps_hdmirx_dev *hdmirx_dev,
+				 bool plugged)
+{
+	if (hdmirx_dev->audio_plugged_cb)
+		hdmirx_dev->audio_plugged_cb(hdmirx_dev->audio_codec_dev,
+					     plugged);
+}
+
 static void hdmirx_plugout(struct snps_hdmirx_dev *hdmirx_dev)
 {
 	if (!hdmirx_dev->plugged)
 		return;
 
+	hdmirx_audio_plugged(hdmirx_dev, false);
+	hdmirx_update_bits(hdmirx_dev, AUDIO_PROC_CONFIG0, I2S_EN, 0);
+
 	hdmirx_update_bits(hdmirx_dev, SCDC_CONFIG, POWERPROVIDED, 0);
 	hdmirx_interrupts_setup(hdmirx_dev, false);
 	hdmirx_update_bits(hdmirx_dev, DMA_CONFIG6, HDMIRX_DMA_EN, 0);
@@ -1435,6 +1462,30 @@ static int hdmirx_queue_setup(struct vb2_queue *queue,
 	return 0;
 }
 
+static int hdmirx_buf_prepare(struct vb2_buffer *vb)
+{
+	struct hdmirx_stream *stream = vb2_get_drv_priv(vb->vb2_queue);
+	struct v4l2_device *v4l2_dev = &stream->hdmirx_dev->v4l2_dev;
+	const struct v4l2_format_info *out_finfo = stream->out_finfo;
+	dma_addr_t addr;
+	unsigned int i;
+
+	/*
+	 * Imported buffers must fit in the 32bit DMA window, the contiguity
+	 * itself is already checked by vb2-dma-contig when mapping them.
+	 */
+	for (i = 0; i < out_finfo->mem_planes; i++) {
+		addr = vb2_dma_contig_plane_dma_addr(vb, i);
+		if (upper_32_bits(addr + vb2_plane_size(vb, i) - 1)) {
+			v4l2_err(v4l2_dev, "%s: plane %u at %pad is out of reach\n",
+				 __func__, i, &addr);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
 /*
  * The vb2_buffer are stored in hdmirx_buffer, in order to unify
  * mplane buffer and none-mplane buffer.
@@ -1537,7 +1588,7 @@ static int hdmirx_start_streaming(struct vb2_queue *queue, unsigned int count)
 	struct v4l2_dv_timings timings = hdmirx_dev->timings;
 	struct v4l2_bt_timings *bt = &timings.bt;
 	unsigned long lock_flags = 0;
-	int line_flag;
+	int line_flag = 0;
 
 	mutex_lock(&hdmirx_dev->stream_lock);
 	stream->frame_idx = 0;
@@ -1586,6 +1637,7 @@ static int hdmirx_start_streaming(struct vb2_queue *queue, unsigned int count)
 	} else {
 		v4l2_err(v4l2_dev, "invalid BT timing height=%d\n", bt->height);
 	}
+	stream->line_flag = line_flag;
 
 	hdmirx_writel(hdmirx_dev, DMA_CONFIG5, 0xffffffff);
 	hdmirx_writel(hdmirx_dev, CED_DYN_CONTROL, 0x1);
@@ -1614,6 +1666,7 @@ static int hdmirx_start_streaming(struct vb2_queue *queue, unsigned int count)
 /* vb2 queue */
 static const struct vb2_ops hdmirx_vb2_ops = {
 	.queue_setup = hdmirx_queue_setup,
+	.buf_prepare = hdmirx_buf_prepare,
 	.buf_queue = hdmirx_buf_queue,
 	.stop_streaming = hdmirx_stop_streaming,
 	.start_streaming = hdmirx_start_streaming,
@@ -1977,6 +2030,32 @@ static void dma_idle_int_handler(struct snps_hdmirx_dev *hdmirx_dev,
 	*handled = true;
 }
 
+/*
+ * The line flag fires once the top half of a progressive frame has been
+ * received. Tell the consumers sharing the buffer, so that they can start
+ * processing it while the bottom half is still arriving.
+ */
+static void hdmirx_partial_frame_event(struct hdmirx_stream *stream,
+				       struct v4l2_bt_timings *bt)
+{
+	struct v4l2_event_snps_hdmirx_partial_frame *partial;
+	struct v4l2_event ev = {
+		.type = V4L2_EVENT_SNPS_HDMIRX_PARTIAL_FRAME,
+	};
+
+	if (bt->interlaced == V4L2_DV_INTERLACED || !stream->curr_buf ||
+	    !stream->line_flag)
+		return;
+
+	partial = (struct v4l2_event_snps_hdmirx_partial_frame *)ev.u.data;
+	partial->index = stream->curr_buf->vb.vb2_buf.index;
+	partial->sequence = stream->frame_idx;
+	partial->lines = stream->line_flag;
+	partial->height = bt->height;
+
+	v4l2_event_queue(&stream->vdev, &ev);
+}
+
 static void line_flag_int_handler(struct snps_hdmirx_dev *hdmirx_dev,
 				  bool *handled)
 {
@@ -1999,6 +2078,8 @@ static void line_flag_int_handler(struct snps_hdmirx_dev *hdmirx_dev,
 	if (stream->line_flag_int_cnt <= FILTER_FRAME_CNT)
 		goto LINE_FLAG_OUT;
 
+	hdmirx_partial_frame_event(stream, bt);
+
 	if (bt->interlaced != V4L2_DV_INTERLACED ||
 	    !(stream->line_flag_int_cnt % 2)) {
 		if (!stream->next_buf) {
@@ -2078,13 +2159,19 @@ static irqreturn_t hdmirx_dma_irq_handler(int irq, void *dev_id)
 	return IRQ_HANDLED;
 }
 
-static int hdmirx_wait_signal_lock(struct snps_hdmirx_dev *hdmirx_dev)
+static int hdmirx_wait_signal_lock(struct snps_hdmirx_dev *hdmirx_dev,
+				   u32 timeout_ms)
 {
 	struct v4l2_device *v4l2_dev = &hdmirx_dev->v4l2_dev;
 	u32 mu_status, scdc_status, dma_st10, cmu_st;
 	u32 i;
 
-	for (i = 0; i < 300; i++) {
+	/*
+	 * Poll every millisecond for up to timeout_ms, only checking the
+	 * debounced 5V detection, which takes several milliseconds, now and
+	 * then.
+	 */
+	for (i = 0; i < timeout_ms; i++) {
 		mu_status = hdmirx_readl(hdmirx_dev, MAINUNIT_STATUS);
 		scdc_status = hdmirx_readl(hdmirx_dev, SCDC_REGBANK_STATUS3);
 		dma_st10 = hdmirx_readl(hdmirx_dev, DMA_STATUS10);
@@ -2095,16 +2182,17 @@ static int hdmirx_wait_signal_lock(struct snps_hdmirx_dev *hdmirx_dev)
 		    (cmu_st & TMDSQPCLK_LOCKED_ST))
 			break;
 
-		if (!tx_5v_power_present(hdmirx_dev)) {
+		if (!(i % 50) && !tx_5v_power_present(hdmirx_dev)) {
 			v4l2_dbg(1, debug, v4l2_dev,
 				 "%s: HDMI pull out, return\n", __func__);
 			return -1;
 		}
 
 		hdmirx_tmds_clk_ratio_config(hdmirx_dev);
+		usleep_range(1000, 1100);
 	}
 
-	if (i == 300) {
+	if (i == timeout_ms) {
 		v4l2_err(v4l2_dev, "%s: signal not lock, tmds_clk_ratio:%d\n",
 			 __func__, hdmirx_dev->tmds_clk_ratio);
 		v4l2_err(v4l2_dev, "%s: mu_st:%#x, scdc_st:%#x, dma_st10:%#x\n",
@@ -2145,6 +2233,7 @@ static void hdmirx_plugin(struct snps_hdmirx_dev *hdmirx_dev)
 	hdmirx_interrupts_setup(hdmirx_dev, true);
 
 	hdmirx_dev->plugged = true;
+	hdmirx_audio_plugged(hdmirx_dev, true);
 }
 
 static void hdmirx_delayed_work_hotplug(struct work_struct *work)
@@ -2169,6 +2258,27 @@ static void hdmirx_delayed_work_hotplug(struct work_struct *work)
 	mutex_unlock(&hdmirx_dev->work_lock);
 }
 
+/*
+ * A mode switch of the source that keeps the TMDS link up, i.e. changes
+ * only the timings or the colour space, doesn't need the controller and
+ * the PHY to be reprogrammed: waiting for the video to lock again and
+ * updating the DMA setup is enough.
+ */
+static bool hdmirx_tmds_link_kept(struct snps_hdmirx_dev *hdmirx_dev)
+{
+	u32 mu_status, cmu_st, scdc_st;
+	bool tmds_clk_ratio;
+
+	mu_status = hdmirx_readl(hdmirx_dev, MAINUNIT_STATUS);
+	cmu_st = hdmirx_readl(hdmirx_dev, CMU_STATUS);
+	scdc_st = hdmirx_readl(hdmirx_dev, SCDC_REGBANK_STATUS1);
+	tmds_clk_ratio = (scdc_st & SCDC_TMDSBITCLKRATIO) > 0;
+
+	return hdmirx_dev->plugged && (mu_status & TMDSVALID_STABLE_ST) &&
+	       (cmu_st & TMDSQPCLK_LOCKED_ST) &&
+	       tmds_clk_ratio == hdmirx_dev->tmds_clk_ratio;
+}
+
 static void hdmirx_delayed_work_res_change(struct work_struct *work)
 {
 	struct snps_hdmirx_dev *hdmirx_dev;
@@ -2183,12 +2293,25 @@ static void hdmirx_delayed_work_res_change(struct work_struct *work)
 		 __func__, plugin);
 	if (plugin) {
 		hdmirx_interrupts_setup(hdmirx_dev, false);
+
+		if (hdmirx_tmds_link_kept(hdmirx_dev) &&
+		    !hdmirx_wait_signal_lock(hdmirx_dev,
+					     SIGNAL_RELOCK_TIMEOUT_MS)) {
+			v4l2_dbg(1, debug, &hdmirx_dev->v4l2_dev,
+				 "%s: TMDS link kept, skip controller reinit\n",
+				 __func__);
+			hdmirx_dma_config(hdmirx_dev);
+			hdmirx_interrupts_setup(hdmirx_dev, true);
+			goto out;
+		}
+
 		hdmirx_submodule_init(hdmirx_dev);
 		hdmirx_update_bits(hdmirx_dev, SCDC_CONFIG, POWERPROVIDED,
 				   POWERPROVIDED);
 		hdmirx_phy_config(hdmirx_dev);
 
-		if (hdmirx_wait_signal_lock(hdmirx_dev)) {
+		if (hdmirx_wait_signal_lock(hdmirx_dev,
+					    SIGNAL_LOCK_TIMEOUT_MS)) {
 			hdmirx_plugout(hdmirx_dev);
 			queue_delayed_work(system_unbound_wq,
 					   &hdmirx_dev->delayed_work_hotplug,
@@ -2198,6 +2321,7 @@ static void hdmirx_delayed_work_res_change(struct work_struct *work)
 			hdmirx_interrupts_setup(hdmirx_dev, true);
 		}
 	}
+out:
 	mutex_unlock(&hdmirx_dev->work_lock);
 }
 
@@ -2272,6 +2396,13 @@ static int hdmirx_parse_dt(struct snps_hdmirx_dev *hdmirx_dev)
 	if (!device_property_read_bool(dev, "hpd-is-active-low"))
 		hdmirx_dev->hpd_trigger_level_high = true;
 
+	/*
+	 * Behind an IOMMU the capture buffers only need to be contiguous in
+	 * the IOVA space, so they can come from regular system memory.
+	 */
+	if (device_iommu_mapped(dev))
+		return 0;
+
 	ret = of_reserved_mem_device_init(dev);
 	if (ret) {
 		dev_warn(dev, "no reserved memory for HDMIRX, use default CMA\n");
@@ -2569,6 +2700,207 @@ static int hdmirx_register_cec(struct snps_hdmirx_dev *hdmirx_dev,
 	return 0;
 }
 
+static const unsigned int hdmirx_audio_rates[] = {
+	32000, 44100, 48000, 88200, 96000, 176400, 192000,
+};
+
+/*
+ * The source regenerates its audio clock as fs = f_tmds * N / (128 * CTS),
+ * N and CTS being sent in the ACR packets. Returns 0 if no audio is
+ * received or if the measured rate isn't a standard one.
+ */
+static u32 hdmirx_audio_fs(struct snps_hdmirx_dev *hdmirx_dev)
+{
+	u32 pb3_0, pb7_4, cts, n, fs;
+	u64 tmds_clk;
+	unsigned int i;
+
+	pb3_0 = hdmirx_readl(hdmirx_dev, PKTDEC_ACR_PB3_0);
+	pb7_4 = hdmirx_readl(hdmirx_dev, PKTDEC_ACR_PB7_4);
+
+	/* CTS is carried in PB1-PB3 and N in PB4-PB6, MSB first */
+	cts = ((pb3_0 >> 8) & 0xf) << 16 | ((pb3_0 >> 16) & 0xff) << 8 |
+	      (pb3_0 >> 24);
+	n = (pb7_4 & 0xf) << 16 | ((pb7_4 >> 8) & 0xff) << 8 |
+	    ((pb7_4 >> 16) & 0xff);
+	if (!cts || !n)
+		return 0;
+
+	tmds_clk = (u64)hdmirx_readl(hdmirx_dev, CMU_TMDSQPCLK_FREQ) * 4 * 1000;
+	fs = div_u64(tmds_clk * n, 128 * cts);
+
+	/* The TMDS clock measurement is only accurate to about 1% */
+	for (i = 0; i < ARRAY_SIZE(hdmirx_audio_rates); i++)
+		if (abs((int)(fs - hdmirx_audio_rates[i])) <=
+		    hdmirx_audio_rates[i] / 100)
+			return hdmirx_audio_rates[i];
+
+	return 0;
+}
+
+static void hdmirx_audio_start_event(struct snps_hdmirx_dev *hdmirx_dev)
+{
+	struct v4l2_event_snps_hdmirx_audio_start *start;
+	struct v4l2_event ev = {
+		.type = V4L2_EVENT_SNPS_HDMIRX_AUDIO_START,
+	};
+
+	start = (struct v4l2_event_snps_hdmirx_audio_start *)ev.u.data;
+	start->sequence = READ_ONCE(hdmirx_dev->stream.frame_idx);
+	start->rate = hdmirx_dev->audio_fs;
+	start->channels = hdmirx_dev->audio_channels;
+
+	v4l2_event_queue(&hdmirx_dev->stream.vdev, &ev);
+}
+
+static int hdmirx_audio_startup(struct device *dev, void *data)
+{
+	struct snps_hdmirx_dev *hdmirx_dev = data;
+	int ret = 0;
+
+	mutex_lock(&hdmirx_dev->work_lock);
+	if (!hdmirx_dev->plugged || !hdmirx_audio_fs(hdmirx_dev))
+		ret = -ENODEV;
+	mutex_unlock(&hdmirx_dev->work_lock);
+
+	return ret;
+}
+
+static int hdmirx_audio_hw_params(struct device *dev, void *data,
+				  struct hdmi_codec_daifmt *fmt,
+				  struct hdmi_codec_params *hparms)
+{
+	struct snps_hdmirx_dev *hdmirx_dev = data;
+	struct v4l2_device *v4l2_dev = &hdmirx_dev->v4l2_dev;
+	int ret = 0;
+	u32 fs;
+
+	if (fmt->fmt != HDMI_I2S)
+		return -EINVAL;
+
+	mutex_lock(&hdmirx_dev->work_lock);
+	if (!hdmirx_dev->plugged) {
+		ret = -ENODEV;
+		goto out;
+	}
+
+	/* The receiver can't resample, the source dictates the rate */
+	fs = hdmirx_audio_fs(hdmirx_dev);
+	if (hparms->sample_rate != fs) {
+		v4l2_dbg(1, debug, v4l2_dev, "%s: rate %d, source sends %u\n",
+			 __func__, hparms->sample_rate, fs);
+		ret = -EINVAL;
+		goto out;
+	}
+
+	hdmirx_dev->audio_fs = fs;
+	hdmirx_dev->audio_channels = hparms->channels;
+
+	hdmirx_update_bits(hdmirx_dev, AUDIO_FIFO_THR_PASS,
+			   AFIFO_THR_LOW_QST_MASK | AFIFO_THR_HIGH_QST_MASK,
+			   AFIFO_THR_LOW_QST(0x20) | AFIFO_THR_HIGH_QST(0x160));
+	hdmirx_update_bits(hdmirx_dev, AUDIO_FIFO_MUTE_THR,
+			   AFIFO_THR_MUTE_LOW_QST_MASK |
+			   AFIFO_THR_MUTE_HIGH_QST_MASK,
+			   AFIFO_THR_MUTE_LOW_QST(0x8) |
+			   AFIFO_THR_MUTE_HIGH_QST(0x1a0));
+	hdmirx_writel(hdmirx_dev, AUDIO_MUTE_CONFIG,
+		      AFIFO_THR_PASS_DEMUTEMASK_N | AVMUTE_DEMUTEMASK_N |
+		      AFIFO_THR_MUTE_LOW_MUTEMASK_N |
+		      AFIFO_THR_MUTE_HIGH_MUTEMASK_N | AVMUTE_MUTEMASK_N);
+	hdmirx_writel(hdmirx_dev, AUDIO_FIFO_CONTROL, AFIFO_INIT_P);
+	hdmirx_update_bits(hdmirx_dev, AUDIO_FIFO_CONFIG, AFIFO_FILL_RESTART,
+			   AFIFO_FILL_RESTART);
+
+out:
+	mutex_unlock(&hdmirx_dev->work_lock);
+
+	return ret;
+}
+
+static int hdmirx_audio_mute_stream(struct device *dev, void *data,
+				    bool enable, int direction)
+{
+	struct snps_hdmirx_dev *hdmirx_dev = data;
+
+	if (direction != SNDRV_PCM_STREAM_CAPTURE)
+		return 0;
+
+	mutex_lock(&hdmirx_dev->work_lock);
+	if (enable) {
+		hdmirx_update_bits(hdmirx_dev, AUDIO_PROC_CONFIG0, I2S_EN, 0);
+	} else if (hdmirx_dev->plugged) {
+		hdmirx_update_bits(hdmirx_dev, AUDIO_PROC_CONFIG0, I2S_EN,
+				   I2S_EN);
+		hdmirx_audio_start_event(hdmirx_dev);
+	}
+	mutex_unlock(&hdmirx_dev->work_lock);
+
+	return 0;
+}
+
+static void hdmirx_audio_shutdown(struct device *dev, void *data)
+{
+	struct snps_hdmirx_dev *hdmirx_dev = data;
+
+	mutex_lock(&hdmirx_dev->work_lock);
+	hdmirx_update_bits(hdmirx_dev, AUDIO_PROC_CONFIG0, I2S_EN, 0);
+	mutex_unlock(&hdmirx_dev->work_lock);
+}
+
+static int hdmirx_audio_hook_plugged_cb(struct device *dev, void *data,
+					hdmi_codec_plugged_cb fn,
+					struct device *codec_dev)
+{
+	struct snps_hdmirx_dev *hdmirx_dev = data;
+
+	mutex_lock(&hdmirx_dev->work_lock);
+	hdmirx_dev->audio_plugged_cb = fn;
+	hdmirx_dev->audio_codec_dev = codec_dev;
+	hdmirx_audio_plugged(hdmirx_dev, hdmirx_dev->plugged);
+	mutex_unlock(&hdmirx_dev->work_lock);
+
+	return 0;
+}
+
+static const struct hdmi_codec_ops hdmirx_audio_codec_ops = {
+	.audio_startup = hdmirx_audio_startup,
+	.hw_params = hdmirx_audio_hw_params,
+	.mute_stream = hdmirx_audio_mute_stream,
+	.audio_shutdown = hdmirx_audio_shutdown,
+	.hook_plugged_cb = hdmirx_audio_hook_plugged_cb,
+};
+
+/*
+ * The received audio leaves the controller on an I2S link wired to one of
+ * the SoC I2S controllers, the sound card ties both together.
+ */
+static int hdmirx_register_audio(struct snps_hdmirx_dev *hdmirx_dev)
+{
+	struct device *dev = hdmirx_dev->dev;
+	struct hdmi_codec_pdata codec_data = {
+		.ops = &hdmirx_audio_codec_ops,
+		.i2s = 1,
+		.no_i2s_playback = 1,
+		.max_i2s_channels = 2,
+		.data = hdmirx_dev,
+	};
+	struct platform_device_info pdevinfo = {
+		.parent = dev,
+		.id = PLATFORM_DEVID_AUTO,
+		.name = HDMI_CODEC_DRV_NAME,
+		.data = &codec_data,
+		.size_data = sizeof(codec_data),
+	};
+
+	hdmirx_dev->audio_pdev = platform_device_register_full(&pdevinfo);
+	if (IS_ERR(hdmirx_dev->audio_pdev))
+		return dev_err_probe(dev, PTR_ERR(hdmirx_dev->audio_pdev),
+				     "failed to register audio codec\n");
+
+	return 0;
+}
+
 static int hdmirx_probe(struct platform_device *pdev)
 {
 	struct snps_hdmirx_dev *hdmirx_dev;
@@ -2583,8 +2915,9 @@ static int hdmirx_probe(struct platform_device *pdev)
 		return -ENOMEM;
 
 	/*
-	 * RK3588 HDMIRX SoC integration doesn't use IOMMU and can
-	 * address only first 32bit of the physical address space.
+	 * The HDMIRX DMA address registers are 32bit wide. Without an IOMMU,
+	 * as on RK3588, it can address only first 32bit of the physical
+	 * address space; with one the same limit applies to the IOVA space.
 	 */
 	ret = dma_set_mask_and_coherent(dev, DMA_BIT_MASK(32));
 	if (ret)
@@ -2672,6 +3005,10 @@ static int hdmirx_probe(struct platform_device *pdev)
 	if (ret)
 		goto err_unreg_video_dev;
 
+	ret = hdmirx_register_audio(hdmirx_dev);
+	if (ret)
+		goto err_unreg_cec;
+
 	hdmirx_load_default_edid(hdmirx_dev);
 
 	hdmirx_enable_irq(dev);
@@ -2685,6 +3022,8 @@ static int hdmirx_probe(struct platform_device *pdev)
 
 	return 0;
 
+err_unreg_cec:
+	snps_hdmirx_cec_unregister(hdmirx_dev->cec);
 err_unreg_video_dev:
 	vb2_video_unregister_device(&hdmirx_dev->stream.vdev);
 err_unreg_v4l2_dev:
@@ -2705,6 +3044,12 @@ static void hdmirx_remove(struct platform_device *pdev)
 	v4l2_debugfs_if_free(hdmirx_dev->infoframes);
 	debugfs_remove_recursive(hdmirx_dev->debugfs_dir);
 
+	/* the hotplug work must not call into the codec once it is gone */
+	mutex_lock(&hdmirx_dev->work_lock);
+	hdmirx_dev->audio_plugged_cb = NULL;
+	hdmirx_dev->audio_codec_dev = NULL;
+	mutex_unlock(&hdmirx_dev->work_lock);
+	platform_device_unregister(hdmirx_dev->audio_pdev);
 	snps_hdmirx_cec_unregister(hdmirx_dev->cec);
 
 	hdmirx_disable_irq(dev);
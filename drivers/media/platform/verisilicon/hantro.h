@@ -41,6 +41,8 @@ struct hantro_postproc_ops;
 #define HANTRO_AV1_DECODER	BIT(21)
 #define HANTRO_DECODERS		0xffff0000
 
+#define HANTRO_MAX_CORES	4
+
 /**
  * struct hantro_irq - irq handler and name
  *
@@ -191,6 +193,16 @@ hantro_vdev_to_func(struct video_device *vdev)
  *			shared with interrupt handlers.
  * @variant:		Hardware variant-specific parameters.
  * @watchdog_work:	Delayed work for hardware timeout handling.
+ * @main_core:		Core owning the video devices, NULL for a core that
+ *			hasn't been collected by the main core yet.
+ * @cores:		Cores clustered behind the video devices, the main
+ *			core first. Only valid on the main core.
+ * @num_cores:		Number of entries in @cores.
+ * @num_ctxs:		Number of contexts running their jobs on this core.
+ * @aux_pool:		Auxiliary buffers released by the contexts of this
+ *			core.
+ * @run_start_ns:	Time the current job was started on the hardware.
+ * @busy_ns:		Total time spent running jobs on this core.
  */
 struct hantro_dev {
 	struct v4l2_device v4l2_dev;
@@ -211,12 +223,21 @@ struct hantro_dev {
 	spinlock_t irqlock;
 	const struct hantro_variant *variant;
 	struct delayed_work watchdog_work;
+
+	struct hantro_dev *main_core;
+	struct hantro_dev *cores[HANTRO_MAX_CORES];
+	unsigned int num_cores;
+	atomic_t num_ctxs;
+	struct hantro_aux_pool aux_pool;
+	u64 run_start_ns;
+	u64 busy_ns;
 };
 
 /**
  * struct hantro_ctx - Context (instance) private data.
  *
- * @dev:		VPU driver data to which the context belongs.
+ * @dev:		VPU driver data of the core the jobs of the context
+ *			run on.
  * @fh:			V4L2 file handler.
  * @is_encoder:		Decoder or encoder context?
  *
@@ -243,6 +264,7 @@ struct hantro_dev {
  * @hevc_dec:		HEVC-decoding context.
  * @vp9_dec:		VP9-decoding context.
  * @av1_dec:		AV1-decoding context.
+ * @jpeg_enc:		JPEG-encoding context.
  */
 struct hantro_ctx {
 	struct hantro_dev *dev;
@@ -274,6 +296,7 @@ struct hantro_ctx {
 		struct hantro_hevc_dec_hw_ctx hevc_dec;
 		struct hantro_vp9_dec_hw_ctx vp9_dec;
 		struct hantro_av1_dec_hw_ctx av1_dec;
+		struct hantro_jpeg_enc_hw_ctx jpeg_enc;
 	};
 };
 
@@ -500,6 +523,7 @@ void hantro_postproc_disable(struct hantro_ctx *ctx);
 void hantro_postproc_enable(struct hantro_ctx *ctx);
 int hantro_postproc_init(struct hantro_ctx *ctx);
 void hantro_postproc_free(struct hantro_ctx *ctx);
+void hantro_postproc_put_dec_buf(struct hantro_ctx *ctx, int index);
 int hanto_postproc_enum_framesizes(struct hantro_ctx *ctx,
 				   struct v4l2_frmsizeenum *fsize);
 
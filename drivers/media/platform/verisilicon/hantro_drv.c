@@ -13,6 +13,7 @@
 #include <linux/clk.h>
 #include <linux/module.h>
 #include <linux/of.h>
+#include <linux/of_platform.h>
 #include <linux/platform_device.h>
 #include <linux/pm.h>
 #include <linux/pm_runtime.h>
@@ -89,6 +90,8 @@ static void hantro_job_finish(struct hantro_dev *vpu,
 			      struct hantro_ctx *ctx,
 			      enum vb2_buffer_state result)
 {
+	vpu->busy_ns += ktime_get_ns() - vpu->run_start_ns;
+
 	pm_runtime_mark_last_busy(vpu->dev);
 	pm_runtime_put_autosuspend(vpu->dev);
 
@@ -186,6 +189,7 @@ static void device_run(void *priv)
 
 	v4l2_m2m_buf_copy_metadata(src, dst, true);
 
+	ctx->dev->run_start_ns = ktime_get_ns();
 	if (ctx->codec_ops->run(ctx))
 		goto err_cancel_job;
 
@@ -220,8 +224,8 @@ queue_init(void *priv, struct vb2_queue *src_vq, struct vb2_queue *dst_vq)
 			    DMA_ATTR_NO_KERNEL_MAPPING;
 	src_vq->buf_struct_size = sizeof(struct v4l2_m2m_buffer);
 	src_vq->timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_COPY;
-	src_vq->lock = &ctx->dev->vpu_mutex;
-	src_vq->dev = ctx->dev->v4l2_dev.dev;
+	src_vq->lock = &ctx->dev->main_core->vpu_mutex;
+	src_vq->dev = ctx->dev->dev;
 	src_vq->supports_requests = true;
 
 	ret = vb2_queue_init(src_vq);
@@ -246,8 +250,8 @@ queue_init(void *priv, struct vb2_queue *src_vq, struct vb2_queue *dst_vq)
 	dst_vq->ops = &hantro_queue_ops;
 	dst_vq->buf_struct_size = sizeof(struct hantro_decoded_buffer);
 	dst_vq->timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_COPY;
-	dst_vq->lock = &ctx->dev->vpu_mutex;
-	dst_vq->dev = ctx->dev->v4l2_dev.dev;
+	dst_vq->lock = &ctx->dev->main_core->vpu_mutex;
+	dst_vq->dev = ctx->dev->dev;
 
 	return vb2_queue_init(dst_vq);
 }
@@ -619,6 +623,32 @@ static int hantro_ctrls_setup(struct hantro_dev *vpu,
 	return v4l2_ctrl_handler_setup(&ctx->ctrl_handler);
 }
 
+/*
+ * A context stays on the same core for its whole lifetime: its buffers are
+ * only mapped in the IOMMU of that core. Contexts are spread over the cores
+ * when they are opened, so that independent streams run in parallel.
+ */
+static struct hantro_dev *hantro_get_core(struct hantro_dev *vpu)
+{
+	struct hantro_dev *core = vpu->cores[0];
+	unsigned int i;
+
+	for (i = 1; i < vpu->num_cores; i++) {
+		if (atomic_read(&vpu->cores[i]->num_ctxs) <
+		    atomic_read(&core->num_ctxs))
+			core = vpu->cores[i];
+	}
+
+	atomic_inc(&core->num_ctxs);
+
+	return core;
+}
+
+static void hantro_put_core(struct hantro_dev *core)
+{
+	atomic_dec(&core->num_ctxs);
+}
+
 /*
  * V4L2 file operations.
  */
@@ -644,7 +674,7 @@ static int hantro_open(struct file *filp)
 	if (!ctx)
 		return -ENOMEM;
 
-	ctx->dev = vpu;
+	ctx->dev = hantro_get_core(vpu);
 	if (func->id == MEDIA_ENT_F_PROC_VIDEO_ENCODER) {
 		allowed_codecs = vpu->variant->codec & HANTRO_ENCODERS;
 		ctx->is_encoder = true;
@@ -656,7 +686,7 @@ static int hantro_open(struct file *filp)
 		goto err_ctx_free;
 	}
 
-	ctx->fh.m2m_ctx = v4l2_m2m_ctx_init(vpu->m2m_dev, ctx, queue_init);
+	ctx->fh.m2m_ctx = v4l2_m2m_ctx_init(ctx->dev->m2m_dev, ctx, queue_init);
 	if (IS_ERR(ctx->fh.m2m_ctx)) {
 		ret = PTR_ERR(ctx->fh.m2m_ctx);
 		goto err_ctx_free;
@@ -681,6 +711,7 @@ static int hantro_open(struct file *filp)
 	v4l2_fh_del(&ctx->fh);
 	v4l2_fh_exit(&ctx->fh);
 err_ctx_free:
+	hantro_put_core(ctx->dev);
 	kfree(ctx);
 	return ret;
 }
@@ -698,6 +729,7 @@ static int hantro_release(struct file *filp)
 	v4l2_fh_del(&ctx->fh);
 	v4l2_fh_exit(&ctx->fh);
 	v4l2_ctrl_handler_free(&ctx->ctrl_handler);
+	hantro_put_core(ctx->dev);
 	kfree(ctx);
 
 	return 0;
@@ -994,29 +1026,27 @@ static const struct media_device_ops hantro_m2m_media_ops = {
 };
 
 /*
- * Some SoCs, like RK3588 have multiple identical Hantro cores, but the
- * kernel is currently missing support for multi-core handling. Exposing
+ * Some SoCs, like RK3588 have multiple identical Hantro cores. Exposing
  * separate devices for each core to userspace is bad, since that does
- * not allow scheduling tasks properly (and creates ABI). With this workaround
- * the driver will only probe for the first core and early exit for the other
- * cores. Once the driver gains multi-core support, the same technique
- * for detecting the main core can be used to cluster all cores together.
+ * not allow scheduling tasks properly (and creates ABI). Instead, every
+ * core probes its own hardware resources and m2m device, and the first
+ * compatible and available node found, the main core, clusters all of
+ * them behind its video devices.
  */
-static int hantro_disable_multicore(struct hantro_dev *vpu)
+static int hantro_is_main_core(struct hantro_dev *vpu, const char **compatible)
 {
 	struct device_node *node = NULL;
-	const char *compatible;
 	bool is_main_core;
 	int ret;
 
 	/* Intentionally ignores the fallback strings */
-	ret = of_property_read_string(vpu->dev->of_node, "compatible", &compatible);
+	ret = of_property_read_string(vpu->dev->of_node, "compatible", compatible);
 	if (ret)
 		return ret;
 
 	/* The first compatible and available node found is considered the main core */
 	do {
-		node = of_find_compatible_node(node, NULL, compatible);
+		node = of_find_compatible_node(node, NULL, *compatible);
 		if (of_device_is_available(node))
 			break;
 	} while (node);
@@ -1028,18 +1058,78 @@ static int hantro_disable_multicore(struct hantro_dev *vpu)
 
 	of_node_put(node);
 
-	if (!is_main_core) {
-		dev_info(vpu->dev, "missing multi-core support, ignoring this instance\n");
-		return -ENODEV;
+	return is_main_core;
+}
+
+static int hantro_add_core(struct hantro_dev *vpu, struct device_node *node)
+{
+	struct platform_device *pdev;
+	struct hantro_dev *core;
+	struct device_link *link;
+
+	if (vpu->num_cores == HANTRO_MAX_CORES) {
+		dev_warn(vpu->dev, "too many cores, ignoring %pOF\n", node);
+		return 0;
+	}
+
+	pdev = of_find_device_by_node(node);
+	if (!pdev)
+		return -EPROBE_DEFER;
+
+	/* The drvdata is only set once the core is fully probed */
+	core = platform_get_drvdata(pdev);
+	if (!core) {
+		put_device(&pdev->dev);
+		return -EPROBE_DEFER;
 	}
 
+	/* Make sure the main core goes away before any of the other cores */
+	link = device_link_add(vpu->dev, &pdev->dev,
+			       DL_FLAG_AUTOREMOVE_CONSUMER);
+	put_device(&pdev->dev);
+	if (!link) {
+		dev_err(vpu->dev, "Could not link to %pOF\n", node);
+		return -EINVAL;
+	}
+
+	core->main_core = vpu;
+	vpu->cores[vpu->num_cores++] = core;
+
+	return 0;
+}
+
+static int hantro_add_cores(struct hantro_dev *vpu, const char *compatible)
+{
+	struct device_node *node;
+	int ret;
+
+	vpu->main_core = vpu;
+	vpu->cores[0] = vpu;
+	vpu->num_cores = 1;
+
+	for_each_compatible_node(node, NULL, compatible) {
+		if (node == vpu->dev->of_node || !of_device_is_available(node))
+			continue;
+
+		ret = hantro_add_core(vpu, node);
+		if (ret) {
+			of_node_put(node);
+			return ret;
+		}
+	}
+
+	if (vpu->num_cores > 1)
+		dev_info(vpu->dev, "clustering %u cores\n", vpu->num_cores);
+
 	return 0;
 }
 
 static int hantro_probe(struct platform_device *pdev)
 {
 	const struct of_device_id *match;
+	const char *compatible;
 	struct hantro_dev *vpu;
+	bool is_main_core;
 	int num_bases;
 	int i, ret;
 
@@ -1052,12 +1142,17 @@ static int hantro_probe(struct platform_device *pdev)
 	mutex_init(&vpu->vpu_mutex);
 	spin_lock_init(&vpu->irqlock);
 
+	ret = hantro_aux_pool_init(vpu);
+	if (ret)
+		return ret;
+
 	match = of_match_node(of_hantro_match, pdev->dev.of_node);
 	vpu->variant = match->data;
 
-	ret = hantro_disable_multicore(vpu);
-	if (ret)
+	ret = hantro_is_main_core(vpu, &compatible);
+	if (ret < 0)
 		return ret;
+	is_main_core = ret;
 
 	/*
 	 * Support for nxp,imx8mq-vpu is kept for backwards compatibility
@@ -1180,20 +1275,30 @@ static int hantro_probe(struct platform_device *pdev)
 		goto err_rst_assert;
 	}
 
+	vpu->m2m_dev = v4l2_m2m_init(&vpu_m2m_ops);
+	if (IS_ERR(vpu->m2m_dev)) {
+		dev_err(&pdev->dev, "Failed to init mem2mem device\n");
+		ret = PTR_ERR(vpu->m2m_dev);
+		goto err_clk_unprepare;
+	}
+
+	/* The other cores only run the jobs handed to them by the main core */
+	if (!is_main_core) {
+		platform_set_drvdata(pdev, vpu);
+		return 0;
+	}
+
+	ret = hantro_add_cores(vpu, compatible);
+	if (ret)
+		goto err_m2m_rel;
+
 	ret = v4l2_device_register(&pdev->dev, &vpu->v4l2_dev);
 	if (ret) {
 		dev_err(&pdev->dev, "Failed to register v4l2 device\n");
-		goto err_clk_unprepare;
+		goto err_m2m_rel;
 	}
 	platform_set_drvdata(pdev, vpu);
 
-	vpu->m2m_dev = v4l2_m2m_init(&vpu_m2m_ops);
-	if (IS_ERR(vpu->m2m_dev)) {
-		v4l2_err(&vpu->v4l2_dev, "Failed to init mem2mem device\n");
-		ret = PTR_ERR(vpu->m2m_dev);
-		goto err_v4l2_unreg;
-	}
-
 	vpu->mdev.dev = vpu->dev;
 	strscpy(vpu->mdev.model, DRIVER_NAME, sizeof(vpu->mdev.model));
 	media_device_init(&vpu->mdev);
@@ -1203,7 +1308,7 @@ static int hantro_probe(struct platform_device *pdev)
 	ret = hantro_add_enc_func(vpu);
 	if (ret) {
 		dev_err(&pdev->dev, "Failed to register encoder\n");
-		goto err_m2m_rel;
+		goto err_mdev_cleanup;
 	}
 
 	ret = hantro_add_dec_func(vpu);
@@ -1224,11 +1329,12 @@ static int hantro_probe(struct platform_device *pdev)
 	hantro_remove_dec_func(vpu);
 err_rm_enc_func:
 	hantro_remove_enc_func(vpu);
-err_m2m_rel:
+err_mdev_cleanup:
 	media_device_cleanup(&vpu->mdev);
-	v4l2_m2m_release(vpu->m2m_dev);
-err_v4l2_unreg:
 	v4l2_device_unregister(&vpu->v4l2_dev);
+	platform_set_drvdata(pdev, NULL);
+err_m2m_rel:
+	v4l2_m2m_release(vpu->m2m_dev);
 err_clk_unprepare:
 	clk_bulk_unprepare(vpu->variant->num_clocks, vpu->clocks);
 err_rst_assert:
@@ -1243,14 +1349,16 @@ static void hantro_remove(struct platform_device *pdev)
 {
 	struct hantro_dev *vpu = platform_get_drvdata(pdev);
 
-	v4l2_info(&vpu->v4l2_dev, "Removing %s\n", pdev->name);
+	dev_info(vpu->dev, "Removing %s\n", pdev->name);
 
-	media_device_unregister(&vpu->mdev);
-	hantro_remove_dec_func(vpu);
-	hantro_remove_enc_func(vpu);
-	media_device_cleanup(&vpu->mdev);
+	if (vpu->main_core == vpu) {
+		media_device_unregister(&vpu->mdev);
+		hantro_remove_dec_func(vpu);
+		hantro_remove_enc_func(vpu);
+		media_device_cleanup(&vpu->mdev);
+		v4l2_device_unregister(&vpu->v4l2_dev);
+	}
 	v4l2_m2m_release(vpu->m2m_dev);
-	v4l2_device_unregister(&vpu->v4l2_dev);
 	clk_bulk_unprepare(vpu->variant->num_clocks, vpu->clocks);
 	reset_control_assert(vpu->resets);
 	pm_runtime_dont_use_autosuspend(vpu->dev);
@@ -1275,6 +1383,35 @@ static const struct dev_pm_ops hantro_pm_ops = {
 	SET_RUNTIME_PM_OPS(NULL, hantro_runtime_resume, NULL)
 };
 
+/*
+ * Load of a core, for userspace picking the least loaded decoder: the number
+ * of contexts assigned to it and the total time it spent running jobs.
+ */
+static ssize_t contexts_show(struct device *dev, struct device_attribute *attr,
+			     char *buf)
+{
+	struct hantro_dev *vpu = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%d\n", atomic_read(&vpu->num_ctxs));
+}
+static DEVICE_ATTR_RO(contexts);
+
+static ssize_t busy_ns_show(struct device *dev, struct device_attribute *attr,
+			    char *buf)
+{
+	struct hantro_dev *vpu = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%llu\n", READ_ONCE(vpu->busy_ns));
+}
+static DEVICE_ATTR_RO(busy_ns);
+
+static struct attribute *hantro_attrs[] = {
+	&dev_attr_contexts.attr,
+	&dev_attr_busy_ns.attr,
+	NULL
+};
+ATTRIBUTE_GROUPS(hantro);
+
 static struct platform_driver hantro_driver = {
 	.probe = hantro_probe,
 	.remove = hantro_remove,
@@ -1282,6 +1419,7 @@ static struct platform_driver hantro_driver = {
 		   .name = DRIVER_NAME,
 		   .of_match_table = of_hantro_match,
 		   .pm = &hantro_pm_ops,
+		   .dev_groups = hantro_groups,
 	},
 };
 module_platform_driver(hantro_driver);
@@ -120,6 +120,7 @@ int hantro_h1_jpeg_enc_run(struct hantro_ctx *ctx)
 	jpeg_ctx.width = ctx->dst_fmt.width;
 	jpeg_ctx.height = ctx->dst_fmt.height;
 	jpeg_ctx.quality = ctx->jpeg_quality;
+	jpeg_ctx.cache = &ctx->jpeg_enc;
 	hantro_jpeg_header_assemble(&jpeg_ctx);
 
 	/* Switch to JPEG encoder mode before writing registers */
@@ -15,6 +15,7 @@
 #include <media/v4l2-vp9.h>
 #include <media/videobuf2-core.h>
 
+#include "hantro_jpeg.h"
 #include "rockchip_av1_entropymode.h"
 #include "rockchip_av1_filmgrain.h"
 
@@ -69,6 +70,21 @@ struct hantro_aux_buf {
 	unsigned long attrs;
 };
 
+/**
+ * struct hantro_aux_pool - cache of released auxiliary buffers
+ *
+ * @lock:	Protects @bufs and @bytes.
+ * @bufs:	Released buffers, the most recently released first.
+ * @bytes:	Total size of the buffers in @bufs.
+ * @shrinker:	Releases the buffers of @bufs under memory pressure.
+ */
+struct hantro_aux_pool {
+	struct mutex lock;
+	struct list_head bufs;
+	size_t bytes;
+	struct shrinker *shrinker;
+};
+
 /* Max. number of entries in the DPB (HW limitation). */
 #define HANTRO_H264_DPB_SIZE		16
 
@@ -345,9 +361,13 @@ struct hantro_av1_dec_hw_ctx {
  * struct hantro_postproc_ctx
  *
  * @dec_q:		References buffers, in decoder format.
+ * @on_demand:		The codec allocates @dec_q entries when they are
+ *			first needed, and releases them once they don't
+ *			hold a reference frame.
  */
 struct hantro_postproc_ctx {
 	struct hantro_aux_buf dec_q[MAX_POSTPROC_BUFFERS];
+	bool on_demand;
 };
 
 /**
@@ -426,6 +446,11 @@ extern const struct hantro_postproc_ops rockchip_vpu981_postproc_ops;
 
 extern const u32 hantro_vp8_dec_mc_filter[8][6];
 
+int hantro_aux_pool_init(struct hantro_dev *vpu);
+int hantro_aux_pool_alloc(struct hantro_dev *vpu, struct hantro_aux_buf *buf,
+			  size_t size, unsigned long attrs);
+void hantro_aux_pool_free(struct hantro_dev *vpu, struct hantro_aux_buf *buf);
+
 void hantro_watchdog(struct work_struct *work);
 void hantro_run(struct hantro_ctx *ctx);
 void hantro_irq_done(struct hantro_dev *vpu,
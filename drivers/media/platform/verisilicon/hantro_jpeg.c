@@ -226,8 +226,19 @@ static void jpeg_set_quality(struct hantro_jpeg_ctx *ctx)
 
 void hantro_jpeg_header_assemble(struct hantro_jpeg_ctx *ctx)
 {
+	struct hantro_jpeg_enc_hw_ctx *cache = ctx->cache;
 	char *buf = ctx->buffer;
 
+	if (cache && cache->quality == ctx->quality &&
+	    cache->width == ctx->width && cache->height == ctx->height) {
+		memcpy(buf, cache->header, JPEG_HEADER_SIZE);
+		memcpy(ctx->hw_luma_qtable, cache->hw_luma_qtable,
+		       JPEG_QUANT_SIZE);
+		memcpy(ctx->hw_chroma_qtable, cache->hw_chroma_qtable,
+		       JPEG_QUANT_SIZE);
+		return;
+	}
+
 	memcpy(buf, hantro_jpeg_header,
 	       sizeof(hantro_jpeg_header));
 
@@ -242,4 +253,15 @@ void hantro_jpeg_header_assemble(struct hantro_jpeg_ctx *ctx)
 	memcpy(buf + HUFF_CHROMA_AC_OFF, v4l2_jpeg_ref_table_chroma_ac_ht, V4L2_JPEG_REF_HT_AC_LEN);
 
 	jpeg_set_quality(ctx);
+
+	if (cache) {
+		cache->width = ctx->width;
+		cache->height = ctx->height;
+		cache->quality = ctx->quality;
+		memcpy(cache->header, buf, JPEG_HEADER_SIZE);
+		memcpy(cache->hw_luma_qtable, ctx->hw_luma_qtable,
+		       JPEG_QUANT_SIZE);
+		memcpy(cache->hw_chroma_qtable, ctx->hw_chroma_qtable,
+		       JPEG_QUANT_SIZE);
+	}
 }
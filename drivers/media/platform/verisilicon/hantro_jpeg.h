@@ -1,8 +1,24 @@
 /* SPDX-License-Identifier: GPL-2.0+ */
 
+#ifndef HANTRO_JPEG_H_
+#define HANTRO_JPEG_H_
+
 #define JPEG_HEADER_SIZE	624
 #define JPEG_QUANT_SIZE		64
 
+/*
+ * Last header built by a context. The header only depends on the frame size
+ * and the quality, which rarely change while streaming.
+ */
+struct hantro_jpeg_enc_hw_ctx {
+	int width;
+	int height;
+	int quality;
+	unsigned char header[JPEG_HEADER_SIZE];
+	unsigned char hw_luma_qtable[JPEG_QUANT_SIZE];
+	unsigned char hw_chroma_qtable[JPEG_QUANT_SIZE];
+};
+
 struct hantro_jpeg_ctx {
 	int width;
 	int height;
@@ -10,6 +26,9 @@ struct hantro_jpeg_ctx {
 	unsigned char *buffer;
 	unsigned char hw_luma_qtable[JPEG_QUANT_SIZE];
 	unsigned char hw_chroma_qtable[JPEG_QUANT_SIZE];
+	struct hantro_jpeg_enc_hw_ctx *cache;
 };
 
 void hantro_jpeg_header_assemble(struct hantro_jpeg_ctx *ctx);
+
+#endif
@@ -0,0 +1,196 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Hantro VPU auxiliary buffer pool
+ *
+ * Buffers released by a context are kept around per core, so that the
+ * next context needing a buffer of the same size doesn't go back to the
+ * DMA allocator. This covers the per-codec auxiliary buffers (motion
+ * vectors, tile edges, CDF and probability tables), which are otherwise
+ * reallocated on every STREAMON. Buffers without a kernel mapping, such as
+ * the post-processor shadow buffers, are freed instead, as they can't be
+ * cleared before being handed to another context.
+ *
+ * The pool is bounded in bytes rather than in buffers, as the buffers range
+ * from a few KiB to several MiB, and a shrinker gives the cached buffers
+ * back when the system runs short of memory.
+ */
+
+#include <linux/dma-mapping.h>
+#include <linux/list.h>
+#include <linux/module.h>
+#include <linux/shrinker.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
+
+#include "hantro.h"
+#include "hantro_hw.h"
+
+static unsigned long aux_pool_size = SZ_32M;
+module_param(aux_pool_size, ulong, 0644);
+MODULE_PARM_DESC(aux_pool_size,
+		 "Maximum size in bytes of the released auxiliary buffers cached per core");
+
+struct hantro_pool_buf {
+	struct list_head node;
+	struct hantro_aux_buf buf;
+};
+
+static void hantro_aux_pool_free_list(struct hantro_dev *vpu,
+				      struct list_head *bufs)
+{
+	struct hantro_pool_buf *entry, *tmp;
+
+	list_for_each_entry_safe(entry, tmp, bufs, node) {
+		list_del(&entry->node);
+		dma_free_attrs(vpu->dev, entry->buf.size, entry->buf.cpu,
+			       entry->buf.dma, entry->buf.attrs);
+		kfree(entry);
+	}
+}
+
+static unsigned long hantro_aux_pool_count(struct shrinker *shrinker,
+					   struct shrink_control *sc)
+{
+	struct hantro_dev *vpu = shrinker->private_data;
+	size_t bytes = READ_ONCE(vpu->aux_pool.bytes);
+
+	return bytes ? bytes >> PAGE_SHIFT : SHRINK_EMPTY;
+}
+
+static unsigned long hantro_aux_pool_scan(struct shrinker *shrinker,
+					  struct shrink_control *sc)
+{
+	struct hantro_dev *vpu = shrinker->private_data;
+	struct hantro_aux_pool *pool = &vpu->aux_pool;
+	struct hantro_pool_buf *entry, *tmp;
+	unsigned long freed = 0;
+	LIST_HEAD(bufs);
+
+	if (!mutex_trylock(&pool->lock))
+		return SHRINK_STOP;
+
+	/* Release the least recently used buffers first */
+	list_for_each_entry_safe_reverse(entry, tmp, &pool->bufs, node) {
+		if (freed >= sc->nr_to_scan)
+			break;
+		list_move(&entry->node, &bufs);
+		pool->bytes -= entry->buf.size;
+		freed += DIV_ROUND_UP(entry->buf.size, PAGE_SIZE);
+	}
+	mutex_unlock(&pool->lock);
+
+	hantro_aux_pool_free_list(vpu, &bufs);
+
+	return freed ?: SHRINK_STOP;
+}
+
+static void hantro_aux_pool_release(void *data)
+{
+	struct hantro_dev *vpu = data;
+	struct hantro_aux_pool *pool = &vpu->aux_pool;
+
+	shrinker_free(pool->shrinker);
+
+	hantro_aux_pool_free_list(vpu, &pool->bufs);
+	pool->bytes = 0;
+}
+
+int hantro_aux_pool_init(struct hantro_dev *vpu)
+{
+	struct hantro_aux_pool *pool = &vpu->aux_pool;
+
+	mutex_init(&pool->lock);
+	INIT_LIST_HEAD(&pool->bufs);
+	pool->bytes = 0;
+
+	pool->shrinker = shrinker_alloc(0, "hantro-aux-pool-%s",
+					dev_name(vpu->dev));
+	if (!pool->shrinker)
+		return -ENOMEM;
+
+	pool->shrinker->count_objects = hantro_aux_pool_count;
+	pool->shrinker->scan_objects = hantro_aux_pool_scan;
+	pool->shrinker->private_data = vpu;
+	shrinker_register(pool->shrinker);
+
+	return devm_add_action_or_reset(vpu->dev, hantro_aux_pool_release, vpu);
+}
+
+/*
+ * Get a buffer of at least @size bytes, the smallest cached one that fits
+ * or a newly allocated one. Cached buffers are zeroed before they are handed
+ * out, buffers without a kernel mapping are never cached.
+ */
+int hantro_aux_pool_alloc(struct hantro_dev *vpu, struct hantro_aux_buf *buf,
+			  size_t size, unsigned long attrs)
+{
+	struct hantro_aux_pool *pool = &vpu->aux_pool;
+	struct hantro_pool_buf *entry, *best = NULL;
+
+	mutex_lock(&pool->lock);
+	list_for_each_entry(entry, &pool->bufs, node) {
+		if (entry->buf.attrs != attrs || entry->buf.size < size)
+			continue;
+		/* Don't waste a large buffer on a small request */
+		if (entry->buf.size > 2 * size)
+			continue;
+		if (!best || entry->buf.size < best->buf.size)
+			best = entry;
+	}
+	if (best) {
+		list_del(&best->node);
+		pool->bytes -= best->buf.size;
+	}
+	mutex_unlock(&pool->lock);
+
+	if (best) {
+		*buf = best->buf;
+		kfree(best);
+		memset(buf->cpu, 0, buf->size);
+		return 0;
+	}
+
+	buf->cpu = dma_alloc_attrs(vpu->dev, size, &buf->dma, GFP_KERNEL, attrs);
+	if (!buf->cpu)
+		return -ENOMEM;
+	buf->size = size;
+	buf->attrs = attrs;
+
+	return 0;
+}
+
+void hantro_aux_pool_free(struct hantro_dev *vpu, struct hantro_aux_buf *buf)
+{
+	struct hantro_aux_pool *pool = &vpu->aux_pool;
+	struct hantro_pool_buf *entry = NULL;
+	bool cached = false;
+
+	if (!buf->cpu)
+		return;
+
+	/*
+	 * A buffer without a kernel mapping can't be cleared by the CPU, and
+	 * the next context must not see what the previous one left in it.
+	 */
+	if (!(buf->attrs & DMA_ATTR_NO_KERNEL_MAPPING))
+		entry = kmalloc(sizeof(*entry), GFP_KERNEL);
+	if (entry) {
+		entry->buf = *buf;
+
+		mutex_lock(&pool->lock);
+		if (pool->bytes + buf->size <= READ_ONCE(aux_pool_size)) {
+			list_add(&entry->node, &pool->bufs);
+			pool->bytes += buf->size;
+			cached = true;
+		}
+		mutex_unlock(&pool->lock);
+
+		if (!cached)
+			kfree(entry);
+	}
+
+	if (!cached)
+		dma_free_attrs(vpu->dev, buf->size, buf->cpu, buf->dma, buf->attrs);
+
+	buf->cpu = NULL;
+}
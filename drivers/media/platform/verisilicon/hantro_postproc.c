@@ -176,20 +176,14 @@ static int hantro_postproc_g2_enum_framesizes(struct hantro_ctx *ctx,
 
 void hantro_postproc_free(struct hantro_ctx *ctx)
 {
-	struct hantro_dev *vpu = ctx->dev;
 	struct v4l2_m2m_ctx *m2m_ctx = ctx->fh.m2m_ctx;
 	struct vb2_queue *queue = &m2m_ctx->cap_q_ctx.q;
 	unsigned int i;
 
-	for (i = 0; i < queue->max_num_buffers; ++i) {
-		struct hantro_aux_buf *priv = &ctx->postproc.dec_q[i];
+	for (i = 0; i < queue->max_num_buffers; ++i)
+		hantro_aux_pool_free(ctx->dev, &ctx->postproc.dec_q[i]);
 
-		if (priv->cpu) {
-			dma_free_attrs(vpu->dev, priv->size, priv->cpu,
-				       priv->dma, priv->attrs);
-			priv->cpu = NULL;
-		}
-	}
+	ctx->postproc.on_demand = false;
 }
 
 static unsigned int hantro_postproc_buffer_size(struct hantro_ctx *ctx)
@@ -219,7 +213,6 @@ static unsigned int hantro_postproc_buffer_size(struct hantro_ctx *ctx)
 
 static int hantro_postproc_alloc(struct hantro_ctx *ctx, int index)
 {
-	struct hantro_dev *vpu = ctx->dev;
 	struct hantro_aux_buf *priv = &ctx->postproc.dec_q[index];
 	unsigned int buf_size = hantro_postproc_buffer_size(ctx);
 
@@ -230,14 +223,8 @@ static int hantro_postproc_alloc(struct hantro_ctx *ctx, int index)
 	 * The buffers on this queue are meant as intermediate
 	 * buffers for the decoder, so no mapping is needed.
 	 */
-	priv->attrs = DMA_ATTR_NO_KERNEL_MAPPING;
-	priv->cpu = dma_alloc_attrs(vpu->dev, buf_size, &priv->dma,
-				    GFP_KERNEL, priv->attrs);
-	if (!priv->cpu)
-		return -ENOMEM;
-	priv->size = buf_size;
-
-	return 0;
+	return hantro_aux_pool_alloc(ctx->dev, priv, buf_size,
+				     DMA_ATTR_NO_KERNEL_MAPPING);
 }
 
 int hantro_postproc_init(struct hantro_ctx *ctx)
@@ -248,6 +235,10 @@ int hantro_postproc_init(struct hantro_ctx *ctx)
 	unsigned int i;
 	int ret;
 
+	/* The codec allocates the buffers as it needs them */
+	if (ctx->postproc.on_demand)
+		return 0;
+
 	for (i = 0; i < num_buffers; i++) {
 		ret = hantro_postproc_alloc(ctx, i);
 		if (ret)
@@ -262,14 +253,11 @@ hantro_postproc_get_dec_buf_addr(struct hantro_ctx *ctx, int index)
 {
 	struct hantro_aux_buf *priv = &ctx->postproc.dec_q[index];
 	unsigned int buf_size = hantro_postproc_buffer_size(ctx);
-	struct hantro_dev *vpu = ctx->dev;
 	int ret;
 
 	if (priv->size < buf_size && priv->cpu) {
 		/* buffer is too small, release it */
-		dma_free_attrs(vpu->dev, priv->size, priv->cpu,
-			       priv->dma, priv->attrs);
-		priv->cpu = NULL;
+		hantro_aux_pool_free(ctx->dev, priv);
 	}
 
 	if (!priv->cpu) {
@@ -285,6 +273,16 @@ hantro_postproc_get_dec_buf_addr(struct hantro_ctx *ctx, int index)
 	return priv->dma;
 }
 
+/*
+ * Give back the decoder buffer of a capture buffer that doesn't hold a
+ * reference frame anymore, it is allocated again if the capture buffer
+ * is used for a reference frame later.
+ */
+void hantro_postproc_put_dec_buf(struct hantro_ctx *ctx, int index)
+{
+	hantro_aux_pool_free(ctx->dev, &ctx->postproc.dec_q[index]);
+}
+
 static void hantro_postproc_g1_disable(struct hantro_ctx *ctx)
 {
 	struct hantro_dev *vpu = ctx->dev;
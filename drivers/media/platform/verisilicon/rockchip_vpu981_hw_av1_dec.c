@@ -5,6 +5,7 @@
  * Author: Benjamin Gaignard <benjamin.gaignard@collabora.com>
  */
 
+#include <linux/module.h>
 #include <media/v4l2-mem2mem.h>
 #include "hantro.h"
 #include "hantro_v4l2.h"
@@ -72,6 +73,11 @@
 		: AV1_DIV_ROUND_UP_POW2((_value_), (_n_)));		\
 })
 
+static bool av1_pp_direct;
+module_param(av1_pp_direct, bool, 0644);
+MODULE_PARM_DESC(av1_pp_direct,
+		 "Post-process AV1 frames that aren't references straight to the capture buffer");
+
 struct rockchip_av1_film_grain {
 	u8 scaling_lut_y[256];
 	u8 scaling_lut_cb[256];
@@ -178,8 +184,36 @@ static void rockchip_vpu981_av1_dec_frame_unref(struct hantro_ctx *ctx, int idx)
 {
 	struct hantro_av1_dec_hw_ctx *av1_dec = &ctx->av1_dec;
 
-	if (idx >= 0)
-		av1_dec->frame_refs[idx].used = false;
+	if (idx < 0)
+		return;
+
+	av1_dec->frame_refs[idx].used = false;
+
+	if (ctx->postproc.on_demand)
+		hantro_postproc_put_dec_buf(ctx,
+					    av1_dec->frame_refs[idx].vb2_ref->vb2_buf.index);
+}
+
+/*
+ * With the post-processor enabled the decoder writes a frame in the
+ * reference format to a separate buffer, which the post-processor reads
+ * back to produce the capture buffer. A frame that doesn't refresh any
+ * reference slot is never read back by the decoder, so skip the decoder
+ * output and only keep the post-processor one. Film grain frames keep the
+ * usual path.
+ */
+static bool rockchip_vpu981_av1_dec_pp_direct(struct hantro_ctx *ctx)
+{
+	struct hantro_av1_dec_ctrls *ctrls = &ctx->av1_dec.ctrls;
+
+	if (!ctx->postproc.on_demand ||
+	    !hantro_needs_postproc(ctx, ctx->vpu_dst_fmt))
+		return false;
+
+	if (ctrls->frame->refresh_frame_flags)
+		return false;
+
+	return !(ctrls->film_grain->flags & V4L2_AV1_FILM_GRAIN_FLAG_APPLY_GRAIN);
 }
 
 static void rockchip_vpu981_av1_dec_clean_refs(struct hantro_ctx *ctx)
@@ -223,32 +257,11 @@ static void rockchip_vpu981_av1_dec_tiles_free(struct hantro_ctx *ctx)
 	struct hantro_dev *vpu = ctx->dev;
 	struct hantro_av1_dec_hw_ctx *av1_dec = &ctx->av1_dec;
 
-	if (av1_dec->db_data_col.cpu)
-		dma_free_coherent(vpu->dev, av1_dec->db_data_col.size,
-				  av1_dec->db_data_col.cpu,
-				  av1_dec->db_data_col.dma);
-	av1_dec->db_data_col.cpu = NULL;
-
-	if (av1_dec->db_ctrl_col.cpu)
-		dma_free_coherent(vpu->dev, av1_dec->db_ctrl_col.size,
-				  av1_dec->db_ctrl_col.cpu,
-				  av1_dec->db_ctrl_col.dma);
-	av1_dec->db_ctrl_col.cpu = NULL;
-
-	if (av1_dec->cdef_col.cpu)
-		dma_free_coherent(vpu->dev, av1_dec->cdef_col.size,
-				  av1_dec->cdef_col.cpu, av1_dec->cdef_col.dma);
-	av1_dec->cdef_col.cpu = NULL;
-
-	if (av1_dec->sr_col.cpu)
-		dma_free_coherent(vpu->dev, av1_dec->sr_col.size,
-				  av1_dec->sr_col.cpu, av1_dec->sr_col.dma);
-	av1_dec->sr_col.cpu = NULL;
-
-	if (av1_dec->lr_col.cpu)
-		dma_free_coherent(vpu->dev, av1_dec->lr_col.size,
-				  av1_dec->lr_col.cpu, av1_dec->lr_col.dma);
-	av1_dec->lr_col.cpu = NULL;
+	hantro_aux_pool_free(vpu, &av1_dec->db_data_col);
+	hantro_aux_pool_free(vpu, &av1_dec->db_ctrl_col);
+	hantro_aux_pool_free(vpu, &av1_dec->cdef_col);
+	hantro_aux_pool_free(vpu, &av1_dec->sr_col);
+	hantro_aux_pool_free(vpu, &av1_dec->lr_col);
 }
 
 static int rockchip_vpu981_av1_dec_tiles_reallocate(struct hantro_ctx *ctx)
@@ -270,44 +283,24 @@ static int rockchip_vpu981_av1_dec_tiles_reallocate(struct hantro_ctx *ctx)
 	rockchip_vpu981_av1_dec_tiles_free(ctx);
 
 	size = ALIGN(height * 12 * ctx->bit_depth / 8, 128) * num_tile_cols;
-	av1_dec->db_data_col.cpu = dma_alloc_coherent(vpu->dev, size,
-						      &av1_dec->db_data_col.dma,
-						      GFP_KERNEL);
-	if (!av1_dec->db_data_col.cpu)
+	if (hantro_aux_pool_alloc(vpu, &av1_dec->db_data_col, size, 0))
 		goto buffer_allocation_error;
-	av1_dec->db_data_col.size = size;
 
 	size = ALIGN(height * 2 * 16 / 4, 128) * num_tile_cols;
-	av1_dec->db_ctrl_col.cpu = dma_alloc_coherent(vpu->dev, size,
-						      &av1_dec->db_ctrl_col.dma,
-						      GFP_KERNEL);
-	if (!av1_dec->db_ctrl_col.cpu)
+	if (hantro_aux_pool_alloc(vpu, &av1_dec->db_ctrl_col, size, 0))
 		goto buffer_allocation_error;
-	av1_dec->db_ctrl_col.size = size;
 
 	size = ALIGN(height_in_sb * 44 * ctx->bit_depth * 16 / 8, 128) * num_tile_cols;
-	av1_dec->cdef_col.cpu = dma_alloc_coherent(vpu->dev, size,
-						   &av1_dec->cdef_col.dma,
-						   GFP_KERNEL);
-	if (!av1_dec->cdef_col.cpu)
+	if (hantro_aux_pool_alloc(vpu, &av1_dec->cdef_col, size, 0))
 		goto buffer_allocation_error;
-	av1_dec->cdef_col.size = size;
 
 	size = ALIGN(height_in_sb * (3040 + 1280), 128) * num_tile_cols;
-	av1_dec->sr_col.cpu = dma_alloc_coherent(vpu->dev, size,
-						 &av1_dec->sr_col.dma,
-						 GFP_KERNEL);
-	if (!av1_dec->sr_col.cpu)
+	if (hantro_aux_pool_alloc(vpu, &av1_dec->sr_col, size, 0))
 		goto buffer_allocation_error;
-	av1_dec->sr_col.size = size;
 
 	size = ALIGN(stripe_num * 1536 * ctx->bit_depth / 8, 128) * num_tile_cols;
-	av1_dec->lr_col.cpu = dma_alloc_coherent(vpu->dev, size,
-						 &av1_dec->lr_col.dma,
-						 GFP_KERNEL);
-	if (!av1_dec->lr_col.cpu)
+	if (hantro_aux_pool_alloc(vpu, &av1_dec->lr_col, size, 0))
 		goto buffer_allocation_error;
-	av1_dec->lr_col.size = size;
 
 	av1_dec->num_tile_cols_allocated = num_tile_cols;
 	return 0;
@@ -322,39 +315,12 @@ void rockchip_vpu981_av1_dec_exit(struct hantro_ctx *ctx)
 	struct hantro_dev *vpu = ctx->dev;
 	struct hantro_av1_dec_hw_ctx *av1_dec = &ctx->av1_dec;
 
-	if (av1_dec->global_model.cpu)
-		dma_free_coherent(vpu->dev, av1_dec->global_model.size,
-				  av1_dec->global_model.cpu,
-				  av1_dec->global_model.dma);
-	av1_dec->global_model.cpu = NULL;
-
-	if (av1_dec->tile_info.cpu)
-		dma_free_coherent(vpu->dev, av1_dec->tile_info.size,
-				  av1_dec->tile_info.cpu,
-				  av1_dec->tile_info.dma);
-	av1_dec->tile_info.cpu = NULL;
-
-	if (av1_dec->film_grain.cpu)
-		dma_free_coherent(vpu->dev, av1_dec->film_grain.size,
-				  av1_dec->film_grain.cpu,
-				  av1_dec->film_grain.dma);
-	av1_dec->film_grain.cpu = NULL;
-
-	if (av1_dec->prob_tbl.cpu)
-		dma_free_coherent(vpu->dev, av1_dec->prob_tbl.size,
-				  av1_dec->prob_tbl.cpu, av1_dec->prob_tbl.dma);
-	av1_dec->prob_tbl.cpu = NULL;
-
-	if (av1_dec->prob_tbl_out.cpu)
-		dma_free_coherent(vpu->dev, av1_dec->prob_tbl_out.size,
-				  av1_dec->prob_tbl_out.cpu,
-				  av1_dec->prob_tbl_out.dma);
-	av1_dec->prob_tbl_out.cpu = NULL;
-
-	if (av1_dec->tile_buf.cpu)
-		dma_free_coherent(vpu->dev, av1_dec->tile_buf.size,
-				  av1_dec->tile_buf.cpu, av1_dec->tile_buf.dma);
-	av1_dec->tile_buf.cpu = NULL;
+	hantro_aux_pool_free(vpu, &av1_dec->global_model);
+	hantro_aux_pool_free(vpu, &av1_dec->tile_info);
+	hantro_aux_pool_free(vpu, &av1_dec->film_grain);
+	hantro_aux_pool_free(vpu, &av1_dec->prob_tbl);
+	hantro_aux_pool_free(vpu, &av1_dec->prob_tbl_out);
+	hantro_aux_pool_free(vpu, &av1_dec->tile_buf);
 
 	rockchip_vpu981_av1_dec_tiles_free(ctx);
 }
@@ -366,55 +332,36 @@ int rockchip_vpu981_av1_dec_init(struct hantro_ctx *ctx)
 
 	memset(av1_dec, 0, sizeof(*av1_dec));
 
-	av1_dec->global_model.cpu = dma_alloc_coherent(vpu->dev, GLOBAL_MODEL_SIZE,
-						       &av1_dec->global_model.dma,
-						       GFP_KERNEL);
-	if (!av1_dec->global_model.cpu)
+	if (hantro_aux_pool_alloc(vpu, &av1_dec->global_model, GLOBAL_MODEL_SIZE, 0))
 		return -ENOMEM;
-	av1_dec->global_model.size = GLOBAL_MODEL_SIZE;
 
-	av1_dec->tile_info.cpu = dma_alloc_coherent(vpu->dev, AV1_MAX_TILES,
-						    &av1_dec->tile_info.dma,
-						    GFP_KERNEL);
-	if (!av1_dec->tile_info.cpu)
+	if (hantro_aux_pool_alloc(vpu, &av1_dec->tile_info, AV1_MAX_TILES, 0))
 		return -ENOMEM;
-	av1_dec->tile_info.size = AV1_MAX_TILES;
 
-	av1_dec->film_grain.cpu = dma_alloc_coherent(vpu->dev,
-						     ALIGN(sizeof(struct rockchip_av1_film_grain), 2048),
-						     &av1_dec->film_grain.dma,
-						     GFP_KERNEL);
-	if (!av1_dec->film_grain.cpu)
+	if (hantro_aux_pool_alloc(vpu, &av1_dec->film_grain,
+				  ALIGN(sizeof(struct rockchip_av1_film_grain), 2048), 0))
 		return -ENOMEM;
-	av1_dec->film_grain.size = ALIGN(sizeof(struct rockchip_av1_film_grain), 2048);
 
-	av1_dec->prob_tbl.cpu = dma_alloc_coherent(vpu->dev,
-						   ALIGN(sizeof(struct av1cdfs), 2048),
-						   &av1_dec->prob_tbl.dma,
-						   GFP_KERNEL);
-	if (!av1_dec->prob_tbl.cpu)
+	if (hantro_aux_pool_alloc(vpu, &av1_dec->prob_tbl,
+				  ALIGN(sizeof(struct av1cdfs), 2048), 0))
 		return -ENOMEM;
-	av1_dec->prob_tbl.size = ALIGN(sizeof(struct av1cdfs), 2048);
 
-	av1_dec->prob_tbl_out.cpu = dma_alloc_coherent(vpu->dev,
-						       ALIGN(sizeof(struct av1cdfs), 2048),
-						       &av1_dec->prob_tbl_out.dma,
-						       GFP_KERNEL);
-	if (!av1_dec->prob_tbl_out.cpu)
+	if (hantro_aux_pool_alloc(vpu, &av1_dec->prob_tbl_out,
+				  ALIGN(sizeof(struct av1cdfs), 2048), 0))
 		return -ENOMEM;
-	av1_dec->prob_tbl_out.size = ALIGN(sizeof(struct av1cdfs), 2048);
 	av1_dec->cdfs = &av1_dec->default_cdfs;
 	av1_dec->cdfs_ndvc = &av1_dec->default_cdfs_ndvc;
 
 	rockchip_av1_set_default_cdfs(av1_dec->cdfs, av1_dec->cdfs_ndvc);
 
-	av1_dec->tile_buf.cpu = dma_alloc_coherent(vpu->dev,
-						   AV1_TILE_SIZE,
-						   &av1_dec->tile_buf.dma,
-						   GFP_KERNEL);
-	if (!av1_dec->tile_buf.cpu)
+	if (hantro_aux_pool_alloc(vpu, &av1_dec->tile_buf, AV1_TILE_SIZE, 0))
 		return -ENOMEM;
-	av1_dec->tile_buf.size = AV1_TILE_SIZE;
+
+	/*
+	 * Only allocate decoder buffers for the capture buffers that end up
+	 * holding reference frames.
+	 */
+	ctx->postproc.on_demand = av1_pp_direct;
 
 	return 0;
 }
@@ -2083,12 +2030,22 @@ rockchip_vpu981_av1_dec_set_output_buffer(struct hantro_ctx *ctx)
 
 	vb2_dst = av1_dec->frame_refs[av1_dec->current_frame_index].vb2_ref;
 	dst = vb2_to_hantro_decoded_buf(&vb2_dst->vb2_buf);
+
+	dst->av1.chroma_offset = cr_offset;
+	dst->av1.mv_offset = mv_offset;
+
+	if (rockchip_vpu981_av1_dec_pp_direct(ctx)) {
+		hantro_reg_write(vpu, &av1_dec_out_dis, 1);
+		hantro_reg_write(vpu, &av1_write_mvs_e, 0);
+		return;
+	}
+
 	luma_addr = hantro_get_dec_buf_addr(ctx, &dst->base.vb.vb2_buf);
 	chroma_addr = luma_addr + cr_offset;
 	mv_addr = luma_addr + mv_offset;
 
-	dst->av1.chroma_offset = cr_offset;
-	dst->av1.mv_offset = mv_offset;
+	hantro_reg_write(vpu, &av1_dec_out_dis, 0);
+	hantro_reg_write(vpu, &av1_write_mvs_e, 1);
 
 	hantro_write_addr(vpu, AV1_TILE_OUT_LU, luma_addr);
 	hantro_write_addr(vpu, AV1_TILE_OUT_CH, chroma_addr);
@@ -2130,7 +2087,6 @@ int rockchip_vpu981_av1_dec_run(struct hantro_ctx *ctx)
 
 	hantro_reg_write(vpu, &av1_dec_mode, AV1_DEC_MODE);
 	hantro_reg_write(vpu, &av1_dec_out_ec_byte_word, 0);
-	hantro_reg_write(vpu, &av1_write_mvs_e, 1);
 	hantro_reg_write(vpu, &av1_dec_out_ec_bypass, 1);
 	hantro_reg_write(vpu, &av1_dec_clk_gate_e, 1);
 
@@ -10,3 +10,6 @@ EXPORT_TRACEPOINT_SYMBOL_GPL(vb2_v4l2_buf_done);
 EXPORT_TRACEPOINT_SYMBOL_GPL(vb2_v4l2_buf_queue);
 EXPORT_TRACEPOINT_SYMBOL_GPL(vb2_v4l2_dqbuf);
 EXPORT_TRACEPOINT_SYMBOL_GPL(vb2_v4l2_qbuf);
+EXPORT_TRACEPOINT_SYMBOL_GPL(v4l2_m2m_job_queue);
+EXPORT_TRACEPOINT_SYMBOL_GPL(v4l2_m2m_job_run);
+EXPORT_TRACEPOINT_SYMBOL_GPL(v4l2_m2m_job_finish);
@@ -604,6 +604,7 @@ static int rkcanfd_handle_state_error_int(struct rkcanfd_priv *priv)
 static int
 rkcanfd_handle_rx_fifo_overflow_int(struct rkcanfd_priv *priv)
 {
+	struct rkcanfd_stats *rkcanfd_stats = &priv->stats;
 	struct net_device_stats *stats = &priv->ndev->stats;
 	struct can_berr_counter bec;
 	struct can_frame *cf = NULL;
@@ -614,6 +615,10 @@ rkcanfd_handle_rx_fifo_overflow_int(struct rkcanfd_priv *priv)
 	stats->rx_over_errors++;
 	stats->rx_errors++;
 
+	u64_stats_update_begin(&rkcanfd_stats->syncp);
+	u64_stats_inc(&rkcanfd_stats->rx_fifo_overflow_errors);
+	u64_stats_update_end(&rkcanfd_stats->syncp);
+
 	netdev_dbg(priv->ndev, "RX-FIFO overflow\n");
 
 	skb = rkcanfd_alloc_can_err_skb(priv, &cf, &timestamp);
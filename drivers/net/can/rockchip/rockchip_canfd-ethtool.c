@@ -11,11 +11,13 @@
 enum rkcanfd_stats_type {
 	RKCANFD_STATS_TYPE_RX_FIFO_EMPTY_ERRORS,
 	RKCANFD_STATS_TYPE_TX_EXTENDED_AS_STANDARD_ERRORS,
+	RKCANFD_STATS_TYPE_RX_FIFO_OVERFLOW_ERRORS,
 };
 
 static const char rkcanfd_stats_strings[][ETH_GSTRING_LEN] = {
 	[RKCANFD_STATS_TYPE_RX_FIFO_EMPTY_ERRORS] = "rx_fifo_empty_errors",
 	[RKCANFD_STATS_TYPE_TX_EXTENDED_AS_STANDARD_ERRORS] = "tx_extended_as_standard_errors",
+	[RKCANFD_STATS_TYPE_RX_FIFO_OVERFLOW_ERRORS] = "rx_fifo_overflow_errors",
 };
 
 static void
@@ -55,6 +57,8 @@ rkcanfd_ethtool_get_ethtool_stats(struct net_device *ndev,
 			u64_stats_read(&rkcanfd_stats->rx_fifo_empty_errors);
 		data[RKCANFD_STATS_TYPE_TX_EXTENDED_AS_STANDARD_ERRORS] =
 			u64_stats_read(&rkcanfd_stats->tx_extended_as_standard_errors);
+		data[RKCANFD_STATS_TYPE_RX_FIFO_OVERFLOW_ERRORS] =
+			u64_stats_read(&rkcanfd_stats->rx_fifo_overflow_errors);
 	} while (u64_stats_fetch_retry(&rkcanfd_stats->syncp, start));
 }
 
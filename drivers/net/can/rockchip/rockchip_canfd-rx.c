@@ -289,10 +289,17 @@ int rkcanfd_handle_rx_int(struct rkcanfd_priv *priv)
 	unsigned int len;
 	int err;
 
+	/* Drain all frames the FIFO reported in one go and only then
+	 * re-read RX_FIFO_CNT, instead of paying for one register read
+	 * per frame. Erratum 5 (count too high) is taken care of in
+	 * rkcanfd_handle_rx_int_one().
+	 */
 	while ((len = rkcanfd_rx_fifo_get_len(priv))) {
-		err = rkcanfd_handle_rx_int_one(priv);
-		if (err)
-			return err;
+		while (len--) {
+			err = rkcanfd_handle_rx_int_one(priv);
+			if (err)
+				return err;
+		}
 	}
 
 	return 0;
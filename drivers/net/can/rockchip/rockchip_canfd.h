@@ -455,6 +455,8 @@ struct rkcanfd_stats {
 
 	/* Erratum 6 */
 	u64_stats_t tx_extended_as_standard_errors;
+
+	u64_stats_t rx_fifo_overflow_errors;
 };
 
 struct rkcanfd_priv {
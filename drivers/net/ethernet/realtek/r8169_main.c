@@ -29,8 +29,13 @@
 #include <linux/prefetch.h>
 #include <linux/ipv6.h>
 #include <linux/unaligned.h>
+#include <linux/bpf.h>
+#include <linux/bpf_trace.h>
+#include <linux/dim.h>
 #include <net/ip6_checksum.h>
 #include <net/netdev_queues.h>
+#include <net/page_pool/helpers.h>
+#include <net/xdp.h>
 
 #include "r8169.h"
 #include "r8169_firmware.h"
@@ -66,6 +71,7 @@
 
 #define R8169_REGS_SIZE		256
 #define R8169_RX_BUF_SIZE	(SZ_16K - 1)
+#define R8169_RX_HEADROOM	XDP_PACKET_HEADROOM
 #define NUM_TX_DESC	256	/* Number of Tx descriptor registers */
 #define NUM_RX_DESC	256	/* Number of Rx descriptor registers */
 #define R8169_TX_RING_BYTES	(NUM_TX_DESC * sizeof(struct TxDesc))
@@ -571,6 +577,7 @@ struct RxDesc {
 
 struct ring_info {
 	struct sk_buff	*skb;
+	struct xdp_frame *xdpf;
 	u32		len;
 };
 
@@ -654,6 +661,11 @@ struct rtl8169_private {
 	dma_addr_t TxPhyAddr;
 	dma_addr_t RxPhyAddr;
 	struct page *Rx_databuff[NUM_RX_DESC];	/* Rx data buffers */
+	struct page_pool *page_pool;
+	struct xdp_rxq_info xdp_rxq;
+	struct bpf_prog *xdp_prog;
+	unsigned int rx_buf_order;
+	u32 rx_buf_sz;
 	struct ring_info tx_skb[NUM_TX_DESC];	/* Tx data buffers */
 	u16 cp_cmd;
 	u16 tx_lpi_timer;
@@ -668,6 +680,13 @@ struct rtl8169_private {
 
 	raw_spinlock_t mac_ocp_lock;
 	struct mutex led_lock;	/* serialize LED ctrl RMW access */
+	struct mutex coalesce_lock;	/* serialize IntrMitigate RMW access */
+
+	struct dim rx_dim;
+	u64 rx_dim_packets;
+	u64 rx_dim_bytes;
+	u16 rx_dim_events;
+	bool rx_dim_enabled;
 
 	unsigned supports_gmii:1;
 	unsigned aspm_manageable:1;
@@ -1973,6 +1992,8 @@ static int rtl_get_coalesce(struct net_device *dev,
 	c_fr = FIELD_GET(RTL_COALESCE_RX_FRAMES, intrmit);
 	ec->rx_max_coalesced_frames = (c_us || c_fr) ? c_fr * 4 : 1;
 
+	ec->use_adaptive_rx_coalesce = tp->rx_dim_enabled;
+
 	return 0;
 }
 
@@ -2048,6 +2069,9 @@ static int rtl_set_coalesce(struct net_device *dev,
 	units = DIV_ROUND_UP(ec->rx_coalesce_usecs * 1000U, scale);
 	w |= FIELD_PREP(RTL_COALESCE_RX_USECS, units);
 
+	mutex_lock(&tp->coalesce_lock);
+
+	tp->rx_dim_enabled = ec->use_adaptive_rx_coalesce;
 	RTL_W16(tp, IntrMitigate, w);
 
 	/* Meaning of PktCntrDisable bit changed from RTL8168e-vl */
@@ -2063,9 +2087,53 @@ static int rtl_set_coalesce(struct net_device *dev,
 	RTL_W16(tp, CPlusCmd, tp->cp_cmd);
 	rtl_pci_commit(tp);
 
+	mutex_unlock(&tp->coalesce_lock);
+
 	return 0;
 }
 
+/* net_dim only tunes the Rx timer, the frame limits and the timer scale
+ * stay as configured with ethtool.
+ */
+static void rtl_rx_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct rtl8169_private *tp = container_of(dim, struct rtl8169_private,
+						  rx_dim);
+	const struct rtl_coalesce_info *ci;
+	struct dim_cq_moder moder;
+	u32 scale, units;
+	u16 w;
+
+	moder = net_dim_get_rx_moderation(dim->mode, dim->profile_ix);
+
+	mutex_lock(&tp->coalesce_lock);
+
+	ci = rtl_coalesce_info(tp);
+	if (tp->rx_dim_enabled && !IS_ERR(ci)) {
+		scale = ci->scale_nsecs[tp->cp_cmd & INTT_MASK];
+		units = clamp(DIV_ROUND_UP(moder.usec * 1000U, scale), 1U,
+			      RTL_COALESCE_T_MAX);
+
+		w = RTL_R16(tp, IntrMitigate) & ~RTL_COALESCE_RX_USECS;
+		w |= FIELD_PREP(RTL_COALESCE_RX_USECS, units);
+		RTL_W16(tp, IntrMitigate, w);
+	}
+
+	mutex_unlock(&tp->coalesce_lock);
+
+	dim->state = DIM_START_MEASURE;
+}
+
+static void rtl_rx_dim_update(struct rtl8169_private *tp)
+{
+	struct dim_sample sample = {};
+
+	dim_update_sample(++tp->rx_dim_events, tp->rx_dim_packets,
+			  tp->rx_dim_bytes, &sample);
+	net_dim(&tp->rx_dim, &sample);
+}
+
 static void rtl_set_eee_txidle_timer(struct rtl8169_private *tp)
 {
 	unsigned int timer_val = READ_ONCE(tp->dev->mtu) + ETH_HLEN + 0x20;
@@ -2239,7 +2307,8 @@ static void rtl8169_get_eth_ctrl_stats(struct net_device *dev,
 
 static const struct ethtool_ops rtl8169_ethtool_ops = {
 	.supported_coalesce_params = ETHTOOL_COALESCE_USECS |
-				     ETHTOOL_COALESCE_MAX_FRAMES,
+				     ETHTOOL_COALESCE_MAX_FRAMES |
+				     ETHTOOL_COALESCE_USE_ADAPTIVE_RX,
 	.get_drvinfo		= rtl8169_get_drvinfo,
 	.get_regs_len		= rtl8169_get_regs_len,
 	.get_link		= ethtool_op_get_link,
@@ -4005,49 +4074,53 @@ static void rtl_hw_start(struct  rtl8169_private *tp)
 	rtl_irq_enable(tp);
 }
 
-static int rtl8169_change_mtu(struct net_device *dev, int new_mtu)
+static unsigned int rtl_rx_buf_order(unsigned int mtu)
 {
-	struct rtl8169_private *tp = netdev_priv(dev);
-
-	WRITE_ONCE(dev->mtu, new_mtu);
-	netdev_update_features(dev);
-	rtl_jumbo_config(tp);
-	rtl_set_eee_txidle_timer(tp);
+	/* Every Rx buffer is turned into an skb head in place, so it has to
+	 * hold the headroom and the skb_shared_info on top of the frame.
+	 */
+	return get_order(R8169_RX_HEADROOM +
+			 SKB_DATA_ALIGN(mtu + VLAN_ETH_HLEN + ETH_FCS_LEN) +
+			 SKB_DATA_ALIGN(sizeof(struct skb_shared_info)));
+}
 
-	return 0;
+static u32 rtl_rx_buf_size(unsigned int order)
+{
+	/* The descriptor length field is 14 bits wide. */
+	return min_t(u32, R8169_RX_BUF_SIZE,
+		     (PAGE_SIZE << order) - R8169_RX_HEADROOM -
+		     SKB_DATA_ALIGN(sizeof(struct skb_shared_info)));
 }
 
-static void rtl8169_mark_to_asic(struct RxDesc *desc)
+static void rtl8169_mark_to_asic(struct RxDesc *desc, u32 rx_buf_sz)
 {
 	u32 eor = le32_to_cpu(desc->opts1) & RingEnd;
 
 	desc->opts2 = 0;
 	/* Force memory writes to complete before releasing descriptor */
 	dma_wmb();
-	WRITE_ONCE(desc->opts1, cpu_to_le32(DescOwn | eor | R8169_RX_BUF_SIZE));
+	WRITE_ONCE(desc->opts1, cpu_to_le32(DescOwn | eor | rx_buf_sz));
+}
+
+static void rtl8169_set_rx_data(struct rtl8169_private *tp,
+				struct RxDesc *desc, struct page *data)
+{
+	dma_addr_t mapping = page_pool_get_dma_addr(data) + R8169_RX_HEADROOM;
+
+	desc->addr = cpu_to_le64(mapping);
+	rtl8169_mark_to_asic(desc, tp->rx_buf_sz);
 }
 
 static struct page *rtl8169_alloc_rx_data(struct rtl8169_private *tp,
 					  struct RxDesc *desc)
 {
-	struct device *d = tp_to_dev(tp);
-	int node = dev_to_node(d);
-	dma_addr_t mapping;
 	struct page *data;
 
-	data = alloc_pages_node(node, GFP_KERNEL, get_order(R8169_RX_BUF_SIZE));
+	data = page_pool_alloc_pages(tp->page_pool, GFP_KERNEL);
 	if (!data)
 		return NULL;
 
-	mapping = dma_map_page(d, data, 0, R8169_RX_BUF_SIZE, DMA_FROM_DEVICE);
-	if (unlikely(dma_mapping_error(d, mapping))) {
-		netdev_err(tp->dev, "Failed to map RX DMA!\n");
-		__free_pages(data, get_order(R8169_RX_BUF_SIZE));
-		return NULL;
-	}
-
-	desc->addr = cpu_to_le64(mapping);
-	rtl8169_mark_to_asic(desc);
+	rtl8169_set_rx_data(tp, desc, data);
 
 	return data;
 }
@@ -4057,14 +4130,16 @@ static void rtl8169_rx_clear(struct rtl8169_private *tp)
 	int i;
 
 	for (i = 0; i < NUM_RX_DESC && tp->Rx_databuff[i]; i++) {
-		dma_unmap_page(tp_to_dev(tp),
-			       le64_to_cpu(tp->RxDescArray[i].addr),
-			       R8169_RX_BUF_SIZE, DMA_FROM_DEVICE);
-		__free_pages(tp->Rx_databuff[i], get_order(R8169_RX_BUF_SIZE));
+		page_pool_put_full_page(tp->page_pool, tp->Rx_databuff[i],
+					false);
 		tp->Rx_databuff[i] = NULL;
 		tp->RxDescArray[i].addr = 0;
 		tp->RxDescArray[i].opts1 = 0;
 	}
+
+	xdp_unreg_mem_model(&tp->xdp_rxq.mem);
+	page_pool_destroy(tp->page_pool);
+	tp->page_pool = NULL;
 }
 
 static int rtl8169_rx_fill(struct rtl8169_private *tp)
@@ -4088,13 +4163,66 @@ static int rtl8169_rx_fill(struct rtl8169_private *tp)
 	return 0;
 }
 
+static struct page_pool *rtl8169_create_page_pool(struct rtl8169_private *tp,
+						   unsigned int order,
+						   struct xdp_mem_info *mem)
+{
+	struct page_pool_params pp_params = {
+		.flags		= PP_FLAG_DMA_MAP | PP_FLAG_DMA_SYNC_DEV,
+		.order		= order,
+		.pool_size	= NUM_RX_DESC,
+		.nid		= dev_to_node(tp_to_dev(tp)),
+		.dev		= tp_to_dev(tp),
+		.napi		= &tp->napi,
+		.netdev		= tp->dev,
+		.dma_dir	= DMA_FROM_DEVICE,
+		.offset		= R8169_RX_HEADROOM,
+		.max_len	= rtl_rx_buf_size(order),
+	};
+	struct page_pool *pool;
+	int ret;
+
+	pool = page_pool_create(&pp_params);
+	if (IS_ERR(pool))
+		return pool;
+
+	ret = xdp_reg_mem_model(mem, MEM_TYPE_PAGE_POOL, pool);
+	if (ret) {
+		page_pool_destroy(pool);
+		return ERR_PTR(ret);
+	}
+
+	return pool;
+}
+
+static void rtl8169_set_page_pool(struct rtl8169_private *tp,
+				  struct page_pool *pool,
+				  const struct xdp_mem_info *mem,
+				  unsigned int order)
+{
+	tp->page_pool = pool;
+	tp->xdp_rxq.mem = *mem;
+	tp->rx_buf_order = order;
+	tp->rx_buf_sz = rtl_rx_buf_size(order);
+}
+
 static int rtl8169_init_ring(struct rtl8169_private *tp)
 {
+	unsigned int order = rtl_rx_buf_order(READ_ONCE(tp->dev->mtu));
+	struct xdp_mem_info mem;
+	struct page_pool *pool;
+
 	rtl8169_init_ring_indexes(tp);
 
 	memset(tp->tx_skb, 0, sizeof(tp->tx_skb));
 	memset(tp->Rx_databuff, 0, sizeof(tp->Rx_databuff));
 
+	pool = rtl8169_create_page_pool(tp, order, &mem);
+	if (IS_ERR(pool))
+		return PTR_ERR(pool);
+
+	rtl8169_set_page_pool(tp, pool, &mem, order);
+
 	return rtl8169_rx_fill(tp);
 }
 
@@ -4120,11 +4248,14 @@ static void rtl8169_tx_clear_range(struct rtl8169_private *tp, u32 start,
 		unsigned int len = tx_skb->len;
 
 		if (len) {
+			struct xdp_frame *xdpf = tx_skb->xdpf;
 			struct sk_buff *skb = tx_skb->skb;
 
 			rtl8169_unmap_tx_skb(tp, entry);
 			if (skb)
 				dev_consume_skb_any(skb);
+			else if (xdpf)
+				xdp_return_frame(xdpf);
 		}
 	}
 }
@@ -4181,7 +4312,7 @@ static void rtl_reset_work(struct rtl8169_private *tp)
 	rtl8169_cleanup(tp);
 
 	for (i = 0; i < NUM_RX_DESC; i++)
-		rtl8169_mark_to_asic(tp->RxDescArray + i);
+		rtl8169_mark_to_asic(tp->RxDescArray + i, tp->rx_buf_sz);
 
 	napi_enable(&tp->napi);
 	rtl_hw_start(tp);
@@ -4575,16 +4706,103 @@ static void rtl8169_pcierr_interrupt(struct net_device *dev)
 	rtl_schedule_task(tp, RTL_FLAG_TASK_RESET_PENDING);
 }
 
+/* Called with the Tx queue lock held */
+static int rtl8169_xdp_xmit_frame(struct rtl8169_private *tp,
+				  struct xdp_frame *xdpf)
+{
+	unsigned int entry = tp->cur_tx % NUM_TX_DESC;
+	struct TxDesc *txd = tp->TxDescArray + entry;
+	const u32 opts[2] = { 0, 0 };
+
+	if (unlikely(!rtl_tx_slots_avail(tp)))
+		return -EBUSY;
+
+	if (unlikely(rtl8169_tx_map(tp, opts, xdpf->len, xdpf->data, entry,
+				    false)))
+		return -ENOMEM;
+
+	tp->tx_skb[entry].xdpf = xdpf;
+
+	/* Force memory writes to complete before releasing descriptor */
+	dma_wmb();
+
+	txd->opts1 |= cpu_to_le32(DescOwn | FirstFrag | LastFrag);
+
+	/* rtl_tx needs to see descriptor changes before updated tp->cur_tx */
+	smp_wmb();
+
+	WRITE_ONCE(tp->cur_tx, tp->cur_tx + 1);
+
+	return 0;
+}
+
+static int rtl8169_xdp_xmit_back(struct rtl8169_private *tp,
+				 struct xdp_buff *xdp)
+{
+	struct netdev_queue *txq = netdev_get_tx_queue(tp->dev, 0);
+	struct xdp_frame *xdpf = xdp_convert_buff_to_frame(xdp);
+	int ret;
+
+	if (unlikely(!xdpf))
+		return -EOVERFLOW;
+
+	/* The Tx ring is shared with the stack */
+	__netif_tx_lock(txq, smp_processor_id());
+	txq_trans_cond_update(txq);
+	ret = rtl8169_xdp_xmit_frame(tp, xdpf);
+	netif_subqueue_maybe_stop(tp->dev, 0, rtl_tx_slots_avail(tp),
+				  R8169_TX_STOP_THRS, R8169_TX_START_THRS);
+	__netif_tx_unlock(txq);
+
+	return ret;
+}
+
+static int rtl8169_xdp_xmit(struct net_device *dev, int num_frames,
+			    struct xdp_frame **frames, u32 flags)
+{
+	struct rtl8169_private *tp = netdev_priv(dev);
+	struct netdev_queue *txq;
+	int i;
+
+	if (unlikely(flags & ~XDP_XMIT_FLAGS_MASK))
+		return -EINVAL;
+
+	if (unlikely(!netif_running(dev)))
+		return -ENETDOWN;
+
+	txq = netdev_get_tx_queue(dev, 0);
+
+	__netif_tx_lock(txq, smp_processor_id());
+	txq_trans_cond_update(txq);
+
+	for (i = 0; i < num_frames; i++) {
+		if (rtl8169_xdp_xmit_frame(tp, frames[i]))
+			break;
+	}
+
+	netif_subqueue_maybe_stop(dev, 0, rtl_tx_slots_avail(tp),
+				  R8169_TX_STOP_THRS, R8169_TX_START_THRS);
+
+	if (flags & XDP_XMIT_FLUSH)
+		rtl8169_doorbell(tp);
+
+	__netif_tx_unlock(txq);
+
+	return i;
+}
+
 static void rtl_tx(struct net_device *dev, struct rtl8169_private *tp,
 		   int budget)
 {
 	unsigned int dirty_tx, bytes_compl = 0, pkts_compl = 0;
+	unsigned int xdp_bytes = 0, xdp_pkts = 0;
 	struct sk_buff *skb;
 
 	dirty_tx = tp->dirty_tx;
 
 	while (READ_ONCE(tp->cur_tx) != dirty_tx) {
 		unsigned int entry = dirty_tx % NUM_TX_DESC;
+		struct xdp_frame *xdpf;
 		u32 status;
 
 		status = le32_to_cpu(READ_ONCE(tp->TxDescArray[entry].opts1));
@@ -4592,18 +4810,25 @@ static void rtl_tx(struct net_device *dev, struct rtl8169_private *tp,
 			break;
 
 		skb = tp->tx_skb[entry].skb;
+		xdpf = tp->tx_skb[entry].xdpf;
 		rtl8169_unmap_tx_skb(tp, entry);
 
 		if (skb) {
 			pkts_compl++;
 			bytes_compl += skb->len;
 			napi_consume_skb(skb, budget);
+		} else if (xdpf) {
+			xdp_pkts++;
+			xdp_bytes += xdpf->len;
+			xdp_return_frame(xdpf);
 		}
 		dirty_tx++;
 	}
 
 	if (tp->dirty_tx != dirty_tx) {
-		dev_sw_netstats_tx_add(dev, pkts_compl, bytes_compl);
+		/* XDP frames bypass BQL, only account them in the stats */
+		dev_sw_netstats_tx_add(dev, pkts_compl + xdp_pkts,
+				       bytes_compl + xdp_bytes);
 		WRITE_ONCE(tp->dirty_tx, dirty_tx);
 
 		netif_subqueue_completed_wake(dev, 0, pkts_compl, bytes_compl,
@@ -4637,17 +4862,52 @@ static inline void rtl8169_rx_csum(struct sk_buff *skb, u32 opts1)
 		skb_checksum_none_assert(skb);
 }
 
+static u32 rtl8169_run_xdp(struct rtl8169_private *tp, struct bpf_prog *prog,
+			   struct xdp_buff *xdp, struct page *data)
+{
+	struct net_device *dev = tp->dev;
+	u32 act;
+
+	act = bpf_prog_run_xdp(prog, xdp);
+	switch (act) {
+	case XDP_PASS:
+		return act;
+	case XDP_TX:
+		if (unlikely(rtl8169_xdp_xmit_back(tp, xdp)))
+			goto out_failure;
+		return act;
+	case XDP_REDIRECT:
+		if (unlikely(xdp_do_redirect(dev, xdp, prog)))
+			goto out_failure;
+		return act;
+	default:
+		bpf_warn_invalid_xdp_action(dev, prog, act);
+		fallthrough;
+	case XDP_ABORTED:
+out_failure:
+		trace_xdp_exception(dev, prog, act);
+		fallthrough;
+	case XDP_DROP:
+		page_pool_recycle_direct(tp->page_pool, data);
+		dev->stats.rx_dropped++;
+		return XDP_DROP;
+	}
+}
+
 static int rtl_rx(struct net_device *dev, struct rtl8169_private *tp, int budget)
 {
-	struct device *d = tp_to_dev(tp);
+	struct bpf_prog *xdp_prog = READ_ONCE(tp->xdp_prog);
+	unsigned int rx_packets = 0, rx_bytes = 0;
+	bool xdp_tx = false, xdp_redirect = false;
 	int count;
 
 	for (count = 0; count < budget; count++, tp->cur_rx++) {
 		unsigned int pkt_size, entry = tp->cur_rx % NUM_RX_DESC;
 		struct RxDesc *desc = tp->RxDescArray + entry;
+		unsigned int headroom = R8169_RX_HEADROOM, metasize = 0;
+		struct page *data, *new_data;
 		struct sk_buff *skb;
-		const void *rx_buf;
-		dma_addr_t addr;
+		void *rx_buf;
 		u32 status;
 
 		status = le32_to_cpu(READ_ONCE(desc->opts1));
@@ -4689,21 +4949,62 @@ static int rtl_rx(struct net_device *dev, struct rtl8169_private *tp, int budget
 			goto release_descriptor;
 		}
 
-		skb = napi_alloc_skb(&tp->napi, pkt_size);
-		if (unlikely(!skb)) {
+		/* The filled buffer is handed up the stack as is, so get its
+		 * replacement first. If that fails, drop the frame and give
+		 * the old buffer back to the chip.
+		 */
+		new_data = page_pool_dev_alloc_pages(tp->page_pool);
+		if (unlikely(!new_data)) {
 			dev->stats.rx_dropped++;
 			goto release_descriptor;
 		}
 
-		addr = le64_to_cpu(desc->addr);
-		rx_buf = page_address(tp->Rx_databuff[entry]);
+		data = tp->Rx_databuff[entry];
+		rx_buf = page_address(data);
+
+		page_pool_dma_sync_for_cpu(tp->page_pool, data, 0, pkt_size);
+		prefetch(rx_buf + R8169_RX_HEADROOM);
+
+		if (xdp_prog) {
+			struct xdp_buff xdp;
+			u32 act;
+
+			xdp_init_buff(&xdp, PAGE_SIZE << tp->rx_buf_order,
+				      &tp->xdp_rxq);
+			xdp_prepare_buff(&xdp, rx_buf, R8169_RX_HEADROOM,
+					 pkt_size, true);
+
+			act = rtl8169_run_xdp(tp, xdp_prog, &xdp, data);
+			if (act != XDP_PASS) {
+				if (act == XDP_TX)
+					xdp_tx = true;
+				else if (act == XDP_REDIRECT)
+					xdp_redirect = true;
+				if (act != XDP_DROP) {
+					dev_sw_netstats_rx_add(dev, pkt_size);
+					rx_packets++;
+					rx_bytes += pkt_size;
+				}
+				goto refill_descriptor;
+			}
+
+			headroom = xdp.data - xdp.data_hard_start;
+			metasize = xdp.data - xdp.data_meta;
+			pkt_size = xdp.data_end - xdp.data;
+		}
+
+		skb = napi_build_skb(rx_buf, PAGE_SIZE << tp->rx_buf_order);
+		if (unlikely(!skb)) {
+			page_pool_recycle_direct(tp->page_pool, data);
+			dev->stats.rx_dropped++;
+			goto refill_descriptor;
+		}
 
-		dma_sync_single_for_cpu(d, addr, pkt_size, DMA_FROM_DEVICE);
-		prefetch(rx_buf);
-		skb_copy_to_linear_data(skb, rx_buf, pkt_size);
-		skb->tail += pkt_size;
-		skb->len = pkt_size;
-		dma_sync_single_for_device(d, addr, pkt_size, DMA_FROM_DEVICE);
+		skb_mark_for_recycle(skb);
+		skb_reserve(skb, headroom);
+		skb_put(skb, pkt_size);
+		if (metasize)
+			skb_metadata_set(skb, metasize);
 
 		rtl8169_rx_csum(skb, status);
 		skb->protocol = eth_type_trans(skb, dev);
@@ -4716,10 +5017,24 @@ static int rtl_rx(struct net_device *dev, struct rtl8169_private *tp, int budget
 		napi_gro_receive(&tp->napi, skb);
 
 		dev_sw_netstats_rx_add(dev, pkt_size);
+		rx_packets++;
+		rx_bytes += pkt_size;
+refill_descriptor:
+		tp->Rx_databuff[entry] = new_data;
+		rtl8169_set_rx_data(tp, desc, new_data);
+		continue;
 release_descriptor:
-		rtl8169_mark_to_asic(desc);
+		rtl8169_mark_to_asic(desc, tp->rx_buf_sz);
 	}
 
+	if (xdp_tx)
+		rtl8169_doorbell(tp);
+	if (xdp_redirect)
+		xdp_do_flush();
+
+	tp->rx_dim_packets += rx_packets;
+	tp->rx_dim_bytes += rx_bytes;
+
 	return count;
 }
 
@@ -4791,8 +5106,11 @@ static int rtl8169_poll(struct napi_struct *napi, int budget)
 
 	work_done = rtl_rx(dev, tp, budget);
 
-	if (work_done < budget && napi_complete_done(napi, work_done))
+	if (work_done < budget && napi_complete_done(napi, work_done)) {
+		if (tp->rx_dim_enabled)
+			rtl_rx_dim_update(tp);
 		rtl_irq_enable(tp);
+	}
 
 	return work_done;
 }
@@ -4848,6 +5166,7 @@ static void rtl8169_down(struct rtl8169_private *tp)
 	rtl_pci_commit(tp);
 
 	rtl8169_cleanup(tp);
+	cancel_work_sync(&tp->rx_dim.work);
 	rtl_disable_exit_l1(tp);
 	rtl_prepare_power_down(tp);
 
@@ -4871,6 +5190,118 @@ static void rtl8169_up(struct rtl8169_private *tp)
 	phy_start(tp->phydev);
 }
 
+static int rtl8169_change_rx_buf_order(struct rtl8169_private *tp,
+				       unsigned int order)
+{
+	struct net_device *dev = tp->dev;
+	struct xdp_mem_info mem;
+	struct page_pool *pool;
+	struct page **data;
+	int i, ret = -ENOMEM;
+
+	/* Allocate the new buffers up front, so that failing leaves the
+	 * running ring untouched.
+	 */
+	pool = rtl8169_create_page_pool(tp, order, &mem);
+	if (IS_ERR(pool))
+		return PTR_ERR(pool);
+
+	data = kcalloc(NUM_RX_DESC, sizeof(*data), GFP_KERNEL);
+	if (!data)
+		goto err_destroy_pool;
+
+	for (i = 0; i < NUM_RX_DESC; i++) {
+		data[i] = page_pool_alloc_pages(pool, GFP_KERNEL);
+		if (!data[i])
+			goto err_put_pages;
+	}
+
+	pm_runtime_get_sync(&tp->pci_dev->dev);
+
+	netif_stop_queue(dev);
+	rtl8169_down(tp);
+	rtl8169_rx_clear(tp);
+
+	rtl8169_set_page_pool(tp, pool, &mem, order);
+	for (i = 0; i < NUM_RX_DESC; i++) {
+		tp->Rx_databuff[i] = data[i];
+		rtl8169_set_rx_data(tp, tp->RxDescArray + i, data[i]);
+	}
+	tp->RxDescArray[NUM_RX_DESC - 1].opts1 |= cpu_to_le32(RingEnd);
+
+	rtl8169_up(tp);
+	netif_start_queue(dev);
+
+	pm_runtime_put_sync(&tp->pci_dev->dev);
+
+	kfree(data);
+
+	return 0;
+
+err_put_pages:
+	while (i--)
+		page_pool_put_full_page(pool, data[i], false);
+	kfree(data);
+err_destroy_pool:
+	xdp_unreg_mem_model(&mem);
+	page_pool_destroy(pool);
+	return ret;
+}
+
+static int rtl8169_change_mtu(struct net_device *dev, int new_mtu)
+{
+	struct rtl8169_private *tp = netdev_priv(dev);
+	unsigned int order = rtl_rx_buf_order(new_mtu);
+
+	if (order && READ_ONCE(tp->xdp_prog)) {
+		netdev_err(dev, "MTU %d too large for XDP\n", new_mtu);
+		return -EINVAL;
+	}
+
+	if (netif_running(dev) && order != tp->rx_buf_order) {
+		int ret = rtl8169_change_rx_buf_order(tp, order);
+
+		if (ret)
+			return ret;
+	}
+
+	WRITE_ONCE(dev->mtu, new_mtu);
+	netdev_update_features(dev);
+	rtl_jumbo_config(tp);
+	rtl_set_eee_txidle_timer(tp);
+
+	return 0;
+}
+
+static int rtl8169_xdp_setup(struct net_device *dev, struct bpf_prog *prog,
+			     struct netlink_ext_ack *extack)
+{
+	struct rtl8169_private *tp = netdev_priv(dev);
+	struct bpf_prog *old_prog;
+
+	/* XDP runs on a single page per frame */
+	if (prog && rtl_rx_buf_order(dev->mtu)) {
+		NL_SET_ERR_MSG_MOD(extack, "MTU too large for XDP");
+		return -EOPNOTSUPP;
+	}
+
+	old_prog = xchg(&tp->xdp_prog, prog);
+	if (old_prog)
+		bpf_prog_put(old_prog);
+
+	return 0;
+}
+
+static int rtl8169_bpf(struct net_device *dev, struct netdev_bpf *bpf)
+{
+	switch (bpf->command) {
+	case XDP_SETUP_PROG:
+		return rtl8169_xdp_setup(dev, bpf->prog, bpf->extack);
+	default:
+		return -EINVAL;
+	}
+}
+
 static int rtl8169_close(struct net_device *dev)
 {
 	struct rtl8169_private *tp = netdev_priv(dev);
@@ -4879,8 +5310,11 @@ static int rtl8169_close(struct net_device *dev)
 	pm_runtime_get_sync(&pdev->dev);
 
 	netif_stop_queue(dev);
+	netif_queue_set_napi(dev, 0, NETDEV_QUEUE_TYPE_RX, NULL);
+	netif_queue_set_napi(dev, 0, NETDEV_QUEUE_TYPE_TX, NULL);
 	rtl8169_down(tp);
 	rtl8169_rx_clear(tp);
+	xdp_rxq_info_unreg(&tp->xdp_rxq);
 
 	free_irq(tp->irq, tp);
 
@@ -4930,10 +5364,14 @@ static int rtl_open(struct net_device *dev)
 	if (!tp->RxDescArray)
 		goto err_free_tx_0;
 
-	retval = rtl8169_init_ring(tp);
+	retval = xdp_rxq_info_reg(&tp->xdp_rxq, dev, 0, tp->napi.napi_id);
 	if (retval < 0)
 		goto err_free_rx_1;
 
+	retval = rtl8169_init_ring(tp);
+	if (retval < 0)
+		goto err_unreg_rxq;
+
 	rtl_request_firmware(tp);
 
 	irqflags = pci_dev_msi_enabled(pdev) ? IRQF_NO_THREAD : IRQF_SHARED;
@@ -4946,6 +5384,8 @@ static int rtl_open(struct net_device *dev)
 		goto err_free_irq;
 
 	rtl8169_up(tp);
+	netif_queue_set_napi(dev, 0, NETDEV_QUEUE_TYPE_RX, &tp->napi);
+	netif_queue_set_napi(dev, 0, NETDEV_QUEUE_TYPE_TX, &tp->napi);
 	rtl8169_init_counter_offsets(tp);
 	netif_start_queue(dev);
 out:
@@ -4958,6 +5398,8 @@ static int rtl_open(struct net_device *dev)
 err_release_fw_2:
 	rtl_release_firmware(tp);
 	rtl8169_rx_clear(tp);
+err_unreg_rxq:
+	xdp_rxq_info_unreg(&tp->xdp_rxq);
 err_free_rx_1:
 	dma_free_coherent(&pdev->dev, R8169_RX_RING_BYTES, tp->RxDescArray,
 			  tp->RxPhyAddr);
@@ -5144,6 +5586,8 @@ static const struct net_device_ops rtl_netdev_ops = {
 	.ndo_set_mac_address	= rtl_set_mac_address,
 	.ndo_eth_ioctl		= phy_do_ioctl_running,
 	.ndo_set_rx_mode	= rtl_set_rx_mode,
+	.ndo_bpf		= rtl8169_bpf,
+	.ndo_xdp_xmit		= rtl8169_xdp_xmit,
 #ifdef CONFIG_NET_POLL_CONTROLLER
 	.ndo_poll_controller	= rtl8169_netpoll,
 #endif
@@ -5455,6 +5899,7 @@ static int rtl_init_one(struct pci_dev *pdev, const struct pci_device_id *ent)
 
 	raw_spin_lock_init(&tp->mac_ocp_lock);
 	mutex_init(&tp->led_lock);
+	mutex_init(&tp->coalesce_lock);
 
 	/* Get the *optional* external "ether_clk" used on some boards */
 	tp->clk = devm_clk_get_optional_enabled(&pdev->dev, "ether_clk");
@@ -5533,6 +5978,9 @@ static int rtl_init_one(struct pci_dev *pdev, const struct pci_device_id *ent)
 	dev->ethtool_ops = &rtl8169_ethtool_ops;
 
 	netif_napi_add(dev, &tp->napi, rtl8169_poll);
+	INIT_WORK(&tp->rx_dim.work, rtl_rx_dim_work);
+	tp->rx_dim.mode = DIM_CQ_PERIOD_MODE_START_FROM_EQE;
+	netif_napi_set_irq(&tp->napi, tp->irq);
 
 	dev->hw_features = NETIF_F_IP_CSUM | NETIF_F_RXCSUM |
 			   NETIF_F_HW_VLAN_CTAG_TX | NETIF_F_HW_VLAN_CTAG_RX;
@@ -5578,6 +6026,9 @@ static int rtl_init_one(struct pci_dev *pdev, const struct pci_device_id *ent)
 
 	dev->pcpu_stat_type = NETDEV_PCPU_STAT_TSTATS;
 
+	dev->xdp_features = NETDEV_XDP_ACT_BASIC | NETDEV_XDP_ACT_REDIRECT |
+			    NETDEV_XDP_ACT_NDO_XMIT;
+
 	netdev_sw_irq_coalesce_default_on(dev);
 
 	/* configure chip for default features */
@@ -14,6 +14,7 @@
  */
 
 #include <linux/firmware.h>
+#include <net/page_pool/helpers.h>
 #include "regs.h"
 #include "rtl8xxxu.h"
 
@@ -57,6 +58,8 @@ MODULE_PARM_DESC(dma_agg_pages, "Set DMA aggregation pages (range 1-127, 0 to di
 #define USB_VENDOR_ID_REALTEK		0x0bda
 #define RTL8XXXU_RX_URBS		32
 #define RTL8XXXU_RX_URB_PENDING_WATER	8
+#define RTL8XXXU_RX_COPYBREAK		256
+#define RTL8XXXU_RX_HDR_LEN		128
 #define RTL8XXXU_TX_URBS		64
 #define RTL8XXXU_TX_URB_LOW_WATER	25
 #define RTL8XXXU_TX_URB_HIGH_WATER	32
@@ -5854,45 +5857,58 @@ void jaguar2_rx_parse_phystats(struct rtl8xxxu_priv *priv,
 	}
 }
 
+static void rtl8xxxu_free_rx_urb(struct rtl8xxxu_rx_urb *rx_urb)
+{
+	struct rtl8xxxu_priv *priv = rx_urb->hw->priv;
+
+	if (rx_urb->page)
+		page_pool_put_full_page(priv->rx_pool, rx_urb->page, false);
+	usb_free_urb(&rx_urb->urb);
+}
+
 static void rtl8xxxu_free_rx_resources(struct rtl8xxxu_priv *priv)
 {
 	struct rtl8xxxu_rx_urb *rx_urb, *tmp;
+	struct list_head local;
 	unsigned long flags;
 
+	INIT_LIST_HEAD(&local);
+
 	spin_lock_irqsave(&priv->rx_urb_lock, flags);
 
-	list_for_each_entry_safe(rx_urb, tmp,
-				 &priv->rx_urb_pending_list, list) {
-		list_del(&rx_urb->list);
-		priv->rx_urb_pending_count--;
-		usb_free_urb(&rx_urb->urb);
-	}
+	list_splice_init(&priv->rx_urb_pending_list, &local);
+	priv->rx_urb_pending_count = 0;
 
 	spin_unlock_irqrestore(&priv->rx_urb_lock, flags);
+
+	/* Pages go back to the pool with the BHs enabled, not under the lock */
+	list_for_each_entry_safe(rx_urb, tmp, &local, list) {
+		list_del(&rx_urb->list);
+		rtl8xxxu_free_rx_urb(rx_urb);
+	}
 }
 
 static void rtl8xxxu_queue_rx_urb(struct rtl8xxxu_priv *priv,
 				  struct rtl8xxxu_rx_urb *rx_urb)
 {
-	struct sk_buff *skb;
 	unsigned long flags;
+	bool shutdown;
 	int pending = 0;
 
 	spin_lock_irqsave(&priv->rx_urb_lock, flags);
 
-	if (!priv->shutdown) {
+	shutdown = priv->shutdown;
+	if (!shutdown) {
 		list_add_tail(&rx_urb->list, &priv->rx_urb_pending_list);
 		priv->rx_urb_pending_count++;
 		pending = priv->rx_urb_pending_count;
-	} else {
-		skb = (struct sk_buff *)rx_urb->urb.context;
-		dev_kfree_skb_irq(skb);
-		usb_free_urb(&rx_urb->urb);
 	}
 
 	spin_unlock_irqrestore(&priv->rx_urb_lock, flags);
 
-	if (pending > RTL8XXXU_RX_URB_PENDING_WATER)
+	if (shutdown)
+		rtl8xxxu_free_rx_urb(rx_urb);
+	else if (pending > RTL8XXXU_RX_URB_PENDING_WATER)
 		schedule_work(&priv->rx_urb_wq);
 }
 
@@ -5901,7 +5917,6 @@ static void rtl8xxxu_rx_urb_work(struct work_struct *work)
 	struct rtl8xxxu_priv *priv;
 	struct rtl8xxxu_rx_urb *rx_urb, *tmp;
 	struct list_head local;
-	struct sk_buff *skb;
 	unsigned long flags;
 	int ret;
 
@@ -5933,9 +5948,7 @@ static void rtl8xxxu_rx_urb_work(struct work_struct *work)
 		default:
 			dev_warn(&priv->udev->dev,
 				 "failed to requeue urb with error %i\n", ret);
-			skb = (struct sk_buff *)rx_urb->urb.context;
-			dev_kfree_skb(skb);
-			usb_free_urb(&rx_urb->urb);
+			rtl8xxxu_free_rx_urb(rx_urb);
 		}
 	}
 }
@@ -6354,30 +6367,78 @@ static void rtl8xxxu_rx_update_rssi(struct rtl8xxxu_priv *priv,
 	rtl8xxxu_iterate_vifs_atomic(priv, rtl8xxxu_rx_update_rssi_iter, &data);
 }
 
-int rtl8xxxu_parse_rxdesc16(struct rtl8xxxu_priv *priv, struct sk_buff *skb)
+/*
+ * Build the skb for one frame of an RX URB. Short frames, and frames the
+ * caller asks to be copied, go entirely into the linear area. Otherwise only
+ * the start of the frame is copied so the 802.11 header is linear, and the
+ * rest is attached as a fragment of the URB buffer, which goes back to the
+ * page pool once all frames built from it have been freed.
+ *
+ * Each frame built from the buffer is charged its slot in it. The frame that
+ * ends the transfer is charged the rest of the buffer too, even when it is
+ * copied, so the truesize of the frames adds up to the buffer they keep alive.
+ */
+static struct sk_buff *rtl8xxxu_rx_build_skb(struct rtl8xxxu_rx_urb *rx_urb,
+					     u8 *frame, u8 *data, int len,
+					     int pkt_offset, bool last,
+					     bool copy)
+{
+	struct urb *urb = &rx_urb->urb;
+	struct page *page = rx_urb->page;
+	u8 *end = (u8 *)urb->transfer_buffer + urb->transfer_buffer_length;
+	struct sk_buff *skb;
+	int hdr_len = len;
+	int truesize;
+
+	if (!copy && len > RTL8XXXU_RX_COPYBREAK)
+		hdr_len = RTL8XXXU_RX_HDR_LEN;
+
+	skb = dev_alloc_skb(hdr_len);
+	if (!skb)
+		return NULL;
+
+	skb_put_data(skb, data, hdr_len);
+	if (len > hdr_len) {
+		truesize = last ? end - frame : pkt_offset;
+
+		page_pool_ref_page(page);
+		skb_add_rx_frag(skb, 0, page,
+				data + hdr_len - (u8 *)page_address(page),
+				len - hdr_len, truesize);
+		skb_mark_for_recycle(skb);
+	} else if (last) {
+		skb->truesize += end - frame;
+	}
+
+	return skb;
+}
+
+int rtl8xxxu_parse_rxdesc16(struct rtl8xxxu_priv *priv,
+			    struct rtl8xxxu_rx_urb *rx_urb)
 {
 	struct ieee80211_hw *hw = priv->hw;
 	struct ieee80211_rx_status *rx_status;
 	struct rtl8xxxu_rxdesc16 *rx_desc;
 	struct rtl8723au_phy_stats *phy_stats;
-	struct sk_buff *next_skb = NULL;
+	struct sk_buff *skb;
 	__le32 *_rx_desc_le;
 	u32 *_rx_desc;
+	u8 *buf, *data;
 	int drvinfo_sz, desc_shift;
 	int i, pkt_cnt, pkt_len, urb_len, pkt_offset;
+	bool last;
 
-	urb_len = skb->len;
+	buf = rx_urb->urb.transfer_buffer;
+	urb_len = rx_urb->urb.actual_length;
 	pkt_cnt = 0;
 
-	if (urb_len < sizeof(struct rtl8xxxu_rxdesc16)) {
-		kfree_skb(skb);
+	if (urb_len < sizeof(struct rtl8xxxu_rxdesc16))
 		return RX_TYPE_ERROR;
-	}
 
-	do {
-		rx_desc = (struct rtl8xxxu_rxdesc16 *)skb->data;
-		_rx_desc_le = (__le32 *)skb->data;
-		_rx_desc = (u32 *)skb->data;
+	while (urb_len >= sizeof(struct rtl8xxxu_rxdesc16)) {
+		rx_desc = (struct rtl8xxxu_rxdesc16 *)buf;
+		_rx_desc_le = (__le32 *)buf;
+		_rx_desc = (u32 *)buf;
 
 		for (i = 0;
 		     i < (sizeof(struct rtl8xxxu_rxdesc16) / sizeof(u32)); i++)
@@ -6396,32 +6457,42 @@ int rtl8xxxu_parse_rxdesc16(struct rtl8xxxu_priv *priv, struct sk_buff *skb)
 		pkt_offset = roundup(pkt_len + drvinfo_sz + desc_shift +
 				     sizeof(struct rtl8xxxu_rxdesc16), 128);
 
-		/*
-		 * Only clone the skb if there's enough data at the end to
-		 * at least cover the rx descriptor
-		 */
-		if (pkt_cnt > 1 &&
-		    urb_len >= (pkt_offset + sizeof(struct rtl8xxxu_rxdesc16)))
-			next_skb = skb_clone(skb, GFP_ATOMIC);
-
-		rx_status = IEEE80211_SKB_RXCB(skb);
-		memset(rx_status, 0, sizeof(struct ieee80211_rx_status));
-
-		skb_pull(skb, sizeof(struct rtl8xxxu_rxdesc16));
-
 		if (rx_desc->rpt_sel) {
+			/*
+			 * The C2H handlers look at the rx descriptor in
+			 * front of skb->data, so copy it along.
+			 */
+			skb = rtl8xxxu_rx_build_skb(rx_urb, buf, buf,
+						    min(urb_len, pkt_offset),
+						    pkt_offset, false, true);
+			if (!skb)
+				goto next;
+
+			skb_pull(skb, sizeof(struct rtl8xxxu_rxdesc16));
 			skb_queue_tail(&priv->c2hcmd_queue, skb);
 			schedule_work(&priv->c2hcmd_work);
 		} else {
 			struct ieee80211_hdr *hdr;
 
-			phy_stats = (struct rtl8723au_phy_stats *)skb->data;
+			phy_stats = (struct rtl8723au_phy_stats *)
+				(buf + sizeof(struct rtl8xxxu_rxdesc16));
+			data = (u8 *)phy_stats + drvinfo_sz + desc_shift;
+			pkt_len = min_t(int, pkt_len, buf + urb_len - data);
+			if (pkt_len <= 0)
+				break;
 
-			skb_pull(skb, drvinfo_sz + desc_shift);
+			hdr = (struct ieee80211_hdr *)data;
+			last = pkt_cnt <= 1 ||
+			       urb_len < pkt_offset + sizeof(*rx_desc);
+			skb = rtl8xxxu_rx_build_skb(rx_urb, buf, data, pkt_len,
+						    pkt_offset, last,
+						    ieee80211_is_mgmt(hdr->frame_control));
+			if (!skb)
+				goto next;
 
-			skb_trim(skb, pkt_len);
+			rx_status = IEEE80211_SKB_RXCB(skb);
+			memset(rx_status, 0, sizeof(struct ieee80211_rx_status));
 
-			hdr = (struct ieee80211_hdr *)skb->data;
 			if (rx_desc->phy_stats) {
 				priv->fops->parse_phystats(
 					priv, rx_status, phy_stats,
@@ -6458,42 +6529,45 @@ int rtl8xxxu_parse_rxdesc16(struct rtl8xxxu_priv *priv, struct sk_buff *skb)
 			ieee80211_rx_irqsafe(hw, skb);
 		}
 
-		skb = next_skb;
-		if (skb)
-			skb_pull(next_skb, pkt_offset);
+next:
+		/*
+		 * Only move on if there's enough data at the end to at
+		 * least cover the rx descriptor
+		 */
+		if (--pkt_cnt <= 0 || urb_len < pkt_offset)
+			break;
 
-		pkt_cnt--;
+		buf += pkt_offset;
 		urb_len -= pkt_offset;
-		next_skb = NULL;
-	} while (skb && pkt_cnt > 0 &&
-		 urb_len >= sizeof(struct rtl8xxxu_rxdesc16));
+	}
 
 	return RX_TYPE_DATA_PKT;
 }
 
-int rtl8xxxu_parse_rxdesc24(struct rtl8xxxu_priv *priv, struct sk_buff *skb)
+int rtl8xxxu_parse_rxdesc24(struct rtl8xxxu_priv *priv,
+			    struct rtl8xxxu_rx_urb *rx_urb)
 {
 	struct ieee80211_hw *hw = priv->hw;
 	struct ieee80211_rx_status *rx_status;
 	struct rtl8xxxu_rxdesc24 *rx_desc;
 	struct rtl8723au_phy_stats *phy_stats;
-	struct sk_buff *next_skb = NULL;
+	struct sk_buff *skb;
 	__le32 *_rx_desc_le;
 	u32 *_rx_desc;
+	u8 *buf, *data;
 	int drvinfo_sz, desc_shift;
 	int i, pkt_len, urb_len, pkt_offset;
 
-	urb_len = skb->len;
+	buf = rx_urb->urb.transfer_buffer;
+	urb_len = rx_urb->urb.actual_length;
 
-	if (urb_len < sizeof(struct rtl8xxxu_rxdesc24)) {
-		kfree_skb(skb);
+	if (urb_len < sizeof(struct rtl8xxxu_rxdesc24))
 		return RX_TYPE_ERROR;
-	}
 
-	do {
-		rx_desc = (struct rtl8xxxu_rxdesc24 *)skb->data;
-		_rx_desc_le = (__le32 *)skb->data;
-		_rx_desc = (u32 *)skb->data;
+	while (urb_len >= sizeof(struct rtl8xxxu_rxdesc24)) {
+		rx_desc = (struct rtl8xxxu_rxdesc24 *)buf;
+		_rx_desc_le = (__le32 *)buf;
+		_rx_desc = (u32 *)buf;
 
 		for (i = 0; i < (sizeof(struct rtl8xxxu_rxdesc24) / sizeof(u32)); i++)
 			_rx_desc[i] = le32_to_cpu(_rx_desc_le[i]);
@@ -6505,30 +6579,32 @@ int rtl8xxxu_parse_rxdesc24(struct rtl8xxxu_priv *priv, struct sk_buff *skb)
 		pkt_offset = roundup(pkt_len + drvinfo_sz + desc_shift +
 				     sizeof(struct rtl8xxxu_rxdesc24), 8);
 
-		/*
-		 * Only clone the skb if there's enough data at the end to
-		 * at least cover the rx descriptor
-		 */
-		if (urb_len >= (pkt_offset + sizeof(struct rtl8xxxu_rxdesc24)))
-			next_skb = skb_clone(skb, GFP_ATOMIC);
-
-		rx_status = IEEE80211_SKB_RXCB(skb);
-		memset(rx_status, 0, sizeof(struct ieee80211_rx_status));
-
-		skb_pull(skb, sizeof(struct rtl8xxxu_rxdesc24));
-
-		phy_stats = (struct rtl8723au_phy_stats *)skb->data;
-
-		skb_pull(skb, drvinfo_sz + desc_shift);
-
-		skb_trim(skb, pkt_len);
+		phy_stats = (struct rtl8723au_phy_stats *)
+			(buf + sizeof(struct rtl8xxxu_rxdesc24));
+		data = (u8 *)phy_stats + drvinfo_sz + desc_shift;
+		pkt_len = min_t(int, pkt_len, buf + urb_len - data);
+		if (pkt_len <= 0)
+			break;
 
 		if (rx_desc->rpt_sel) {
 			struct device *dev = &priv->udev->dev;
 			dev_dbg(dev, "%s: C2H packet\n", __func__);
-			rtl8723bu_handle_c2h(priv, skb);
+			skb = rtl8xxxu_rx_build_skb(rx_urb, buf, data, pkt_len,
+						    pkt_offset, false, true);
+			if (skb)
+				rtl8723bu_handle_c2h(priv, skb);
 		} else {
-			struct ieee80211_hdr *hdr = (struct ieee80211_hdr *)skb->data;
+			struct ieee80211_hdr *hdr = (struct ieee80211_hdr *)data;
+			bool last = urb_len < pkt_offset + sizeof(*rx_desc);
+
+			skb = rtl8xxxu_rx_build_skb(rx_urb, buf, data, pkt_len,
+						    pkt_offset, last,
+						    ieee80211_is_mgmt(hdr->frame_control));
+			if (!skb)
+				goto next;
+
+			rx_status = IEEE80211_SKB_RXCB(skb);
+			memset(rx_status, 0, sizeof(struct ieee80211_rx_status));
 
 			if (rx_desc->phy_stats) {
 				priv->fops->parse_phystats(priv, rx_status, phy_stats,
@@ -6564,13 +6640,17 @@ int rtl8xxxu_parse_rxdesc24(struct rtl8xxxu_priv *priv, struct sk_buff *skb)
 			ieee80211_rx_irqsafe(hw, skb);
 		}
 
-		skb = next_skb;
-		if (skb)
-			skb_pull(next_skb, pkt_offset);
+next:
+		/*
+		 * Only move on if there's enough data at the end to at
+		 * least cover the rx descriptor
+		 */
+		if (urb_len < pkt_offset)
+			break;
 
+		buf += pkt_offset;
 		urb_len -= pkt_offset;
-		next_skb = NULL;
-	} while (skb && urb_len >= sizeof(struct rtl8xxxu_rxdesc24));
+	}
 
 	return RX_TYPE_DATA_PKT;
 }
@@ -6581,16 +6661,11 @@ static void rtl8xxxu_rx_complete(struct urb *urb)
 		container_of(urb, struct rtl8xxxu_rx_urb, urb);
 	struct ieee80211_hw *hw = rx_urb->hw;
 	struct rtl8xxxu_priv *priv = hw->priv;
-	struct sk_buff *skb = (struct sk_buff *)urb->context;
 	struct device *dev = &priv->udev->dev;
 
-	skb_put(skb, urb->actual_length);
-
 	if (urb->status == 0) {
-		priv->fops->parse_rx_desc(priv, skb);
+		priv->fops->parse_rx_desc(priv, rx_urb);
 
-		skb = NULL;
-		rx_urb->urb.context = NULL;
 		rtl8xxxu_queue_rx_urb(priv, rx_urb);
 	} else {
 		dev_dbg(dev, "%s: status %i\n",	__func__, urb->status);
@@ -6599,34 +6674,52 @@ static void rtl8xxxu_rx_complete(struct urb *urb)
 	return;
 
 cleanup:
-	usb_free_urb(urb);
-	dev_kfree_skb(skb);
+	rtl8xxxu_free_rx_urb(rx_urb);
 }
 
-static int rtl8xxxu_submit_rx_urb(struct rtl8xxxu_priv *priv,
-				  struct rtl8xxxu_rx_urb *rx_urb)
+static int rtl8xxxu_rx_buf_size(struct rtl8xxxu_priv *priv)
 {
 	struct rtl8xxxu_fileops *fops = priv->fops;
-	struct sk_buff *skb;
-	int skb_size;
-	int ret, rx_desc_sz;
 
-	rx_desc_sz = fops->rx_desc_size;
+	if (priv->rx_buf_aggregation && fops->rx_agg_buf_size)
+		return fops->rx_agg_buf_size + fops->rx_desc_size +
+		       sizeof(struct rtl8723au_phy_stats);
 
-	if (priv->rx_buf_aggregation && fops->rx_agg_buf_size) {
-		skb_size = fops->rx_agg_buf_size;
-		skb_size += (rx_desc_sz + sizeof(struct rtl8723au_phy_stats));
-	} else {
-		skb_size = IEEE80211_MAX_FRAME_LEN;
+	return IEEE80211_MAX_FRAME_LEN;
+}
+
+static int rtl8xxxu_submit_rx_urb(struct rtl8xxxu_priv *priv,
+				  struct rtl8xxxu_rx_urb *rx_urb)
+{
+	int buf_size = rtl8xxxu_rx_buf_size(priv);
+	unsigned int offset;
+	int ret;
+	u8 *buf;
+
+	/*
+	 * The frames built from the previous transfer hold their own
+	 * references to its buffer.
+	 */
+	if (rx_urb->page) {
+		page_pool_put_full_page(priv->rx_pool, rx_urb->page, false);
+		rx_urb->page = NULL;
 	}
 
-	skb = __netdev_alloc_skb(NULL, skb_size, GFP_KERNEL);
-	if (!skb)
+	/*
+	 * The URBs are submitted from both rtl8xxxu_start() and the RX work,
+	 * and page pool allocations must not run concurrently.
+	 */
+	spin_lock_bh(&priv->rx_pool_lock);
+	rx_urb->page = page_pool_dev_alloc_frag(priv->rx_pool, &offset,
+						buf_size);
+	spin_unlock_bh(&priv->rx_pool_lock);
+	if (!rx_urb->page)
 		return -ENOMEM;
 
-	memset(skb->data, 0, rx_desc_sz);
-	usb_fill_bulk_urb(&rx_urb->urb, priv->udev, priv->pipe_in, skb->data,
-			  skb_size, rtl8xxxu_rx_complete, skb);
+	buf = (u8 *)page_address(rx_urb->page) + offset;
+	memset(buf, 0, priv->fops->rx_desc_size);
+	usb_fill_bulk_urb(&rx_urb->urb, priv->udev, priv->pipe_in, buf,
+			  buf_size, rtl8xxxu_rx_complete, rx_urb);
 	usb_anchor_urb(&rx_urb->urb, &priv->rx_anchor);
 	ret = usb_submit_urb(&rx_urb->urb, GFP_ATOMIC);
 	if (ret)
@@ -7440,9 +7533,13 @@ static void rtl8xxxu_watchdog_callback(struct work_struct *work)
 static int rtl8xxxu_start(struct ieee80211_hw *hw)
 {
 	struct rtl8xxxu_priv *priv = hw->priv;
+	struct page_pool_params pp_params = {
+		.pool_size = RTL8XXXU_RX_URBS,
+		.nid = NUMA_NO_NODE,
+		.dev = &priv->udev->dev,
+	};
 	struct rtl8xxxu_rx_urb *rx_urb;
 	struct rtl8xxxu_tx_urb *tx_urb;
-	struct sk_buff *skb;
 	unsigned long flags;
 	int ret, i;
 
@@ -7476,6 +7573,14 @@ static int rtl8xxxu_start(struct ieee80211_hw *hw)
 
 	priv->tx_stopped = false;
 
+	pp_params.order = get_order(rtl8xxxu_rx_buf_size(priv));
+	priv->rx_pool = page_pool_create(&pp_params);
+	if (IS_ERR(priv->rx_pool)) {
+		ret = PTR_ERR(priv->rx_pool);
+		priv->rx_pool = NULL;
+		goto error_out;
+	}
+
 	spin_lock_irqsave(&priv->rx_urb_lock, flags);
 	priv->shutdown = false;
 	spin_unlock_irqrestore(&priv->rx_urb_lock, flags);
@@ -7483,23 +7588,22 @@ static int rtl8xxxu_start(struct ieee80211_hw *hw)
 	for (i = 0; i < RTL8XXXU_RX_URBS; i++) {
 		rx_urb = kmalloc(sizeof(struct rtl8xxxu_rx_urb), GFP_KERNEL);
 		if (!rx_urb) {
-			if (!i)
+			if (!i) {
 				ret = -ENOMEM;
+				page_pool_destroy(priv->rx_pool);
+				priv->rx_pool = NULL;
+			}
 
 			goto error_out;
 		}
 		usb_init_urb(&rx_urb->urb);
 		INIT_LIST_HEAD(&rx_urb->list);
 		rx_urb->hw = hw;
+		rx_urb->page = NULL;
 
 		ret = rtl8xxxu_submit_rx_urb(priv, rx_urb);
-		if (ret) {
-			if (ret != -ENOMEM) {
-				skb = (struct sk_buff *)rx_urb->urb.context;
-				dev_kfree_skb(skb);
-			}
+		if (ret)
 			rtl8xxxu_queue_rx_urb(priv, rx_urb);
-		}
 	}
 
 	schedule_delayed_work(&priv->ra_watchdog, 2 * HZ);
@@ -7540,6 +7644,7 @@ static void rtl8xxxu_stop(struct ieee80211_hw *hw, bool suspend)
 	priv->shutdown = true;
 	spin_unlock_irqrestore(&priv->rx_urb_lock, flags);
 
+	cancel_work_sync(&priv->rx_urb_wq);
 	usb_kill_anchored_urbs(&priv->rx_anchor);
 	usb_kill_anchored_urbs(&priv->tx_anchor);
 	if (priv->usb_interrupts)
@@ -7561,6 +7666,9 @@ static void rtl8xxxu_stop(struct ieee80211_hw *hw, bool suspend)
 
 	rtl8xxxu_free_rx_resources(priv);
 	rtl8xxxu_free_tx_resources(priv);
+
+	page_pool_destroy(priv->rx_pool);
+	priv->rx_pool = NULL;
 }
 
 static int rtl8xxxu_sta_add(struct ieee80211_hw *hw,
@@ -7851,6 +7959,7 @@ static int rtl8xxxu_probe(struct usb_interface *interface,
 	spin_lock_init(&priv->tx_urb_lock);
 	INIT_LIST_HEAD(&priv->rx_urb_pending_list);
 	spin_lock_init(&priv->rx_urb_lock);
+	spin_lock_init(&priv->rx_pool_lock);
 	INIT_WORK(&priv->rx_urb_wq, rtl8xxxu_rx_urb_work);
 	INIT_DELAYED_WORK(&priv->ra_watchdog, rtl8xxxu_watchdog_callback);
 	INIT_DELAYED_WORK(&priv->update_beacon_work, rtl8xxxu_update_beacon_work_callback);
@@ -1804,6 +1804,9 @@ struct rtl8xxxu_priv {
 	int rx_urb_pending_count;
 	bool shutdown;
 	struct work_struct rx_urb_wq;
+	struct page_pool *rx_pool;
+	/* Serializes the allocations from rx_pool */
+	spinlock_t rx_pool_lock;
 
 	u8 mac_addr[ETH_ALEN];
 	char chip_name[8];
@@ -1945,6 +1948,7 @@ struct rtl8xxxu_rx_urb {
 	struct urb urb;
 	struct ieee80211_hw *hw;
 	struct list_head list;
+	struct page *page;
 };
 
 struct rtl8xxxu_tx_urb {
@@ -1968,7 +1972,8 @@ struct rtl8xxxu_fileops {
 	void (*phy_lc_calibrate) (struct rtl8xxxu_priv *priv);
 	void (*phy_iq_calibrate) (struct rtl8xxxu_priv *priv);
 	void (*config_channel) (struct ieee80211_hw *hw);
-	int (*parse_rx_desc) (struct rtl8xxxu_priv *priv, struct sk_buff *skb);
+	int (*parse_rx_desc) (struct rtl8xxxu_priv *priv,
+			      struct rtl8xxxu_rx_urb *rx_urb);
 	void (*parse_phystats) (struct rtl8xxxu_priv *priv,
 				struct ieee80211_rx_status *rx_status,
 				struct rtl8723au_phy_stats *phy_stats,
@@ -2122,8 +2127,10 @@ void rtl8xxxu_gen1_enable_rf(struct rtl8xxxu_priv *priv);
 void rtl8xxxu_gen1_disable_rf(struct rtl8xxxu_priv *priv);
 void rtl8xxxu_gen2_disable_rf(struct rtl8xxxu_priv *priv);
 void rtl8xxxu_init_burst(struct rtl8xxxu_priv *priv);
-int rtl8xxxu_parse_rxdesc16(struct rtl8xxxu_priv *priv, struct sk_buff *skb);
-int rtl8xxxu_parse_rxdesc24(struct rtl8xxxu_priv *priv, struct sk_buff *skb);
+int rtl8xxxu_parse_rxdesc16(struct rtl8xxxu_priv *priv,
+			    struct rtl8xxxu_rx_urb *rx_urb);
+int rtl8xxxu_parse_rxdesc24(struct rtl8xxxu_priv *priv,
+			    struct rtl8xxxu_rx_urb *rx_urb);
 void rtl8723au_rx_parse_phystats(struct rtl8xxxu_priv *priv,
 				 struct ieee80211_rx_status *rx_status,
 				 struct rtl8723au_phy_stats *phy_stats,
@@ -22,6 +22,7 @@
 #include <linux/pci.h>
 #include <linux/suspend.h>
 #include <linux/t10-pi.h>
+#include <linux/topology.h>
 #include <linux/types.h>
 #include <linux/io-64-nonatomic-lo-hi.h>
 #include <linux/io-64-nonatomic-hi-lo.h>
@@ -105,6 +106,11 @@ static bool noacpi;
 module_param(noacpi, bool, 0444);
 MODULE_PARM_DESC(noacpi, "disable acpi bios quirks");
 
+static bool cluster_queues;
+module_param(cluster_queues, bool, 0444);
+MODULE_PARM_DESC(cluster_queues,
+	"group I/O queues and their interrupts by CPU cluster");
+
 struct nvme_dev;
 struct nvme_queue;
 
@@ -134,6 +140,7 @@ struct nvme_dev {
 	unsigned long bar_mapped_size;
 	struct mutex shutdown_lock;
 	bool subsystem;
+	bool cluster_queues;
 	u64 cmb_size;
 	bool cmb_use_sqes;
 	u32 cmbsz;
@@ -441,6 +448,86 @@ static int queue_irq_offset(struct nvme_dev *dev)
 	return 0;
 }
 
+/*
+ * Split the queues of @map between the CPU clusters in proportion to their
+ * size, so that a CPU only ever submits to and gets completions from queues
+ * owned by its own cluster.  The interrupts are not managed in this mode,
+ * so point each of them at the CPUs mapped to its queue.
+ */
+static bool nvme_pci_map_cluster_queues(struct nvme_dev *dev,
+		struct blk_mq_queue_map *map, int offset)
+{
+	struct pci_dev *pdev = to_pci_dev(dev->dev);
+	unsigned int nr_clusters = 0, cpus_left = num_possible_cpus();
+	unsigned int queues_left = map->nr_queues, qbase = 0;
+	cpumask_var_t done, mask;
+	unsigned int cpu, i, n;
+	bool ret = false;
+	int err;
+
+	if (!zalloc_cpumask_var(&done, GFP_KERNEL))
+		return false;
+	if (!zalloc_cpumask_var(&mask, GFP_KERNEL))
+		goto free_done;
+
+	for_each_possible_cpu(cpu) {
+		if (cpumask_test_cpu(cpu, done))
+			continue;
+		cpumask_or(done, done, topology_cluster_cpumask(cpu));
+		nr_clusters++;
+	}
+	if (nr_clusters < 2 || nr_clusters > map->nr_queues)
+		goto free_mask;
+
+	cpumask_clear(done);
+	for_each_possible_cpu(cpu) {
+		const struct cpumask *cluster = topology_cluster_cpumask(cpu);
+		unsigned int weight, nr;
+
+		if (cpumask_test_cpu(cpu, done))
+			continue;
+		cpumask_and(mask, cluster, cpu_possible_mask);
+		cpumask_or(done, done, mask);
+		weight = cpumask_weight(mask);
+
+		/* leave at least one queue for each remaining cluster */
+		nr = queues_left * weight / cpus_left;
+		nr_clusters--;
+		nr = clamp(nr, 1U, queues_left - nr_clusters);
+		if (!nr_clusters)
+			nr = queues_left;
+
+		n = 0;
+		for_each_cpu(i, mask)
+			map->mq_map[i] = map->queue_offset + qbase + n++ % nr;
+
+		for (n = 0; n < nr; n++) {
+			cpumask_clear(mask);
+			for_each_cpu_and(i, cluster, cpu_possible_mask)
+				if (map->mq_map[i] == map->queue_offset + qbase + n)
+					cpumask_set_cpu(i, mask);
+			err = irq_set_affinity(pci_irq_vector(pdev,
+						offset + qbase + n), mask);
+			if (err) {
+				dev_warn(dev->ctrl.device,
+					 "failed to steer queue interrupt to its cluster: %d\n",
+					 err);
+				goto free_mask;
+			}
+		}
+
+		qbase += nr;
+		queues_left -= nr;
+		cpus_left -= weight;
+	}
+	ret = true;
+free_mask:
+	free_cpumask_var(mask);
+free_done:
+	free_cpumask_var(done);
+	return ret;
+}
+
 static void nvme_pci_map_queues(struct blk_mq_tag_set *set)
 {
 	struct nvme_dev *dev = to_nvme_dev(set->driver_data);
@@ -461,7 +548,10 @@ static void nvme_pci_map_queues(struct blk_mq_tag_set *set)
 		 * affinity), so use the regular blk-mq cpu mapping
 		 */
 		map->queue_offset = qoff;
-		if (i != HCTX_TYPE_POLL && offset)
+		if (i != HCTX_TYPE_POLL && offset && dev->cluster_queues) {
+			if (!nvme_pci_map_cluster_queues(dev, map, offset))
+				blk_mq_map_queues(map);
+		} else if (i != HCTX_TYPE_POLL && offset)
 			blk_mq_map_hw_queues(map, dev->dev, offset);
 		else
 			blk_mq_map_queues(map);
@@ -2322,6 +2412,25 @@ static ssize_t hmb_store(struct device *dev, struct device_attribute *attr,
 }
 static DEVICE_ATTR_RW(hmb);
 
+static ssize_t hmb_size_show(struct device *dev, struct device_attribute *attr,
+			     char *buf)
+{
+	struct nvme_dev *ndev = to_nvme_dev(dev_get_drvdata(dev));
+
+	return sysfs_emit(buf, "%llu\n",
+			  ndev->nr_host_mem_descs ? ndev->host_mem_size : 0);
+}
+static DEVICE_ATTR_RO(hmb_size);
+
+static ssize_t hmb_segments_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	struct nvme_dev *ndev = to_nvme_dev(dev_get_drvdata(dev));
+
+	return sysfs_emit(buf, "%u\n", ndev->nr_host_mem_descs);
+}
+static DEVICE_ATTR_RO(hmb_segments);
+
 static umode_t nvme_pci_attrs_are_visible(struct kobject *kobj,
 		struct attribute *a, int n)
 {
@@ -2335,7 +2444,9 @@ static umode_t nvme_pci_attrs_are_visible(struct kobject *kobj,
 	    	if (!dev->cmbsz)
 			return 0;
 	}
-	if (a == &dev_attr_hmb.attr && !ctrl->hmpre)
+	if ((a == &dev_attr_hmb.attr ||
+	     a == &dev_attr_hmb_size.attr ||
+	     a == &dev_attr_hmb_segments.attr) && !ctrl->hmpre)
 		return 0;
 
 	return a->mode;
@@ -2346,6 +2457,8 @@ static struct attribute *nvme_pci_attrs[] = {
 	&dev_attr_cmbloc.attr,
 	&dev_attr_cmbsz.attr,
 	&dev_attr_hmb.attr,
+	&dev_attr_hmb_size.attr,
+	&dev_attr_hmb_segments.attr,
 	NULL,
 };
 
@@ -2413,6 +2526,7 @@ static int nvme_setup_irqs(struct nvme_dev *dev, unsigned int nr_io_queues)
 	};
 	unsigned int irq_queues, poll_queues;
 	unsigned int flags = PCI_IRQ_ALL_TYPES | PCI_IRQ_AFFINITY;
+	int nr_vecs;
 
 	/*
 	 * Poll queues don't need interrupts, but we need at least one I/O queue
@@ -2438,8 +2552,22 @@ static int nvme_setup_irqs(struct nvme_dev *dev, unsigned int nr_io_queues)
 		irq_queues += (nr_io_queues - poll_queues);
 	if (dev->ctrl.quirks & NVME_QUIRK_BROKEN_MSI)
 		flags &= ~PCI_IRQ_MSI;
-	return pci_alloc_irq_vectors_affinity(pdev, 1, irq_queues, flags,
-					      &affd);
+
+	/*
+	 * Managed interrupts are spread by the irq core and can't follow the
+	 * cluster mapping, so fall back to unmanaged ones and size the queue
+	 * sets ourselves.
+	 */
+	dev->cluster_queues = cluster_queues;
+	if (!dev->cluster_queues)
+		return pci_alloc_irq_vectors_affinity(pdev, 1, irq_queues,
+						      flags, &affd);
+
+	nr_vecs = pci_alloc_irq_vectors(pdev, 1, irq_queues,
+					flags & ~PCI_IRQ_AFFINITY);
+	if (nr_vecs > 0)
+		nvme_calc_irq_sets(&affd, nr_vecs - 1);
+	return nr_vecs;
 }
 
 static unsigned int nvme_max_io_queues(struct nvme_dev *dev)
@@ -15,6 +15,7 @@
 #include <linux/err.h>
 #include <linux/device.h>
 #include <linux/export.h>
+#include <linux/nvmem-consumer.h>
 #include <linux/pm_domain.h>
 #include <linux/regulator/consumer.h>
 #include <linux/slab.h>
@@ -2676,6 +2677,45 @@ int devm_pm_opp_set_config(struct device *dev, struct dev_pm_opp_config *config)
 }
 EXPORT_SYMBOL_GPL(devm_pm_opp_set_config);
 
+/**
+ * devm_pm_opp_set_supported_hw_nvmem() - Set supported hardware from nvmem.
+ * @dev: Device for which supported hardware is being set.
+ * @cell_id: Name of the nvmem cell holding the hardware version.
+ *
+ * Read the hardware version, a speed bin for example, from the @cell_id
+ * nvmem cell of @dev and only enable the OPPs whose opp-supported-hw has
+ * the bit of that version set. All the OPPs are kept if @dev has no such
+ * cell. This is a resource-managed helper around
+ * devm_pm_opp_set_supported_hw().
+ *
+ * Return: 0 on success and errorno otherwise.
+ */
+int devm_pm_opp_set_supported_hw_nvmem(struct device *dev, const char *cell_id)
+{
+	u32 version, supported_hw;
+	int ret;
+
+	ret = nvmem_cell_read_variable_le_u32(dev, cell_id, &version);
+	if (ret == -ENOENT || ret == -EOPNOTSUPP)
+		return 0;
+	if (ret) {
+		dev_err(dev, "%s: Cannot read %s (%d)\n", __func__, cell_id, ret);
+		return ret;
+	}
+
+	if (version >= 32) {
+		dev_err(dev, "%s: Invalid %s %u\n", __func__, cell_id, version);
+		return -EINVAL;
+	}
+
+	dev_dbg(dev, "%s: Using %s = %u\n", __func__, cell_id, version);
+
+	supported_hw = BIT(version);
+
+	return devm_pm_opp_set_supported_hw(dev, &supported_hw, 1);
+}
+EXPORT_SYMBOL_GPL(devm_pm_opp_set_supported_hw_nvmem);
+
 /**
  * dev_pm_opp_xlate_required_opp() - Find required OPP for @src_table OPP.
  * @src_table: OPP table which has @dst_table as one of its required OPP table.
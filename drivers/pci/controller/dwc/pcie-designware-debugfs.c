@@ -131,13 +131,14 @@ static const u32 err_inj_type_mask[] = {
  *				   supported in DWC RAS DES
  * @name: Name of the error counter
  * @group_no: Group number that the event belongs to. The value can range
- *	      from 0 to 4
+ *	      from 0 to 5
  * @event_no: Event number of the particular event. The value ranges are:
  *		Group 0: 0 - 10
  *		Group 1: 5 - 13
  *		Group 2: 0 - 7
  *		Group 3: 0 - 5
  *		Group 4: 0 - 1
+ *		Group 5: 0 - 8
  */
 struct dwc_pcie_event_counter {
 	const char *name;
@@ -181,6 +182,11 @@ static const struct dwc_pcie_event_counter event_list[] = {
 	{"completion_timeout", 0x3, 0x5},
 	{"ebuf_skp_add", 0x4, 0x0},
 	{"ebuf_skp_del", 0x4, 0x1},
+	{"tx_l0s_entry", 0x5, 0x2},
+	{"rx_l0s_entry", 0x5, 0x3},
+	{"aspm_l1_entry", 0x5, 0x5},
+	{"l1_1_entry", 0x5, 0x7},
+	{"l1_2_entry", 0x5, 0x8},
 };
 
 static ssize_t lane_detect_read(struct file *file, char __user *buf,
@@ -8,6 +8,7 @@
  * Author: Simon Xue <xxm@rock-chips.com>
  */
 
+#include <linux/bitfield.h>
 #include <linux/clk.h>
 #include <linux/gpio/consumer.h>
 #include <linux/irqchip/chained_irq.h>
@@ -42,6 +43,9 @@
 #define PCIE_CLIENT_INTR_STATUS_MISC	0x10
 #define PCIE_CLIENT_INTR_MASK_MISC	0x24
 #define PCIE_CLIENT_POWER		0x2c
+#define PCIE_CLKREQ_READY		HIWORD_UPDATE_BIT(BIT(0))
+#define PCIE_CLKREQ_NOT_READY		HIWORD_UPDATE(BIT(0), 0)
+#define PCIE_CLKREQ_PULL_DOWN		HIWORD_UPDATE(GENMASK(13, 12), BIT(12))
 #define PCIE_CLIENT_MSG_GEN		0x34
 #define PME_READY_ENTER_L23		BIT(3)
 #define PME_TURN_OFF			(BIT(4) | BIT(20))
@@ -72,6 +76,9 @@ struct rockchip_pcie {
 	struct regulator *vpcie3v3;
 	struct irq_domain *irq_domain;
 	u32 intx;
+	bool supports_clkreq;
+	u32 l1ss_cmrt_us;
+	u32 l1ss_t_power_on_us;
 	const struct rockchip_pcie_of_data *data;
 };
 
@@ -214,6 +221,80 @@ static void rockchip_pcie_enable_l0s(struct dw_pcie *pci)
 	}
 }
 
+/* Encode a T_POWER_ON time using the smallest scale that can represent it */
+static u32 rockchip_pcie_encode_t_power_on(u32 us)
+{
+	static const u32 scale_us[] = { 2, 10, 100 };
+	u32 scale, val = 0;
+
+	for (scale = 0; scale < ARRAY_SIZE(scale_us); scale++) {
+		val = DIV_ROUND_UP(us, scale_us[scale]);
+		if (val <= FIELD_MAX(PCI_L1SS_CAP_P_PWR_ON_VALUE))
+			break;
+	}
+
+	if (scale == ARRAY_SIZE(scale_us)) {
+		scale--;
+		val = FIELD_MAX(PCI_L1SS_CAP_P_PWR_ON_VALUE);
+	}
+
+	return FIELD_PREP(PCI_L1SS_CAP_P_PWR_ON_SCALE, scale) |
+	       FIELD_PREP(PCI_L1SS_CAP_P_PWR_ON_VALUE, val);
+}
+
+static void rockchip_pcie_configure_l1ss(struct dw_pcie *pci)
+{
+	struct rockchip_pcie *rockchip = to_rockchip_pcie(pci);
+	u32 cap, l1subcap;
+
+	cap = dw_pcie_find_ext_capability(pci, PCI_EXT_CAP_ID_L1SS);
+	if (!cap)
+		return;
+
+	l1subcap = dw_pcie_readl_dbi(pci, cap + PCI_L1SS_CAP);
+
+	if (!rockchip->supports_clkreq) {
+		/*
+		 * Without CLKREQ# routed to the slot the refclk can't be gated,
+		 * and the link would never come back from L1.2. Keep the refclk
+		 * running and hide L1SS so that the ASPM core leaves it alone.
+		 */
+		rockchip_pcie_writel_apb(rockchip,
+					 PCIE_CLKREQ_PULL_DOWN | PCIE_CLKREQ_NOT_READY,
+					 PCIE_CLIENT_POWER);
+
+		l1subcap &= ~(PCI_L1SS_CAP_L1_PM_SS |
+			      PCI_L1SS_CAP_ASPM_L1_1 | PCI_L1SS_CAP_ASPM_L1_2 |
+			      PCI_L1SS_CAP_PCIPM_L1_1 | PCI_L1SS_CAP_PCIPM_L1_2);
+	} else {
+		/* Let the controller gate the refclk in L1.x */
+		rockchip_pcie_writel_apb(rockchip, PCIE_CLKREQ_READY,
+					 PCIE_CLIENT_POWER);
+
+		/*
+		 * The ASPM core computes LTR_L1.2_THRESHOLD from the
+		 * Common_Mode_Restore_Time and T_POWER_ON advertised here, so
+		 * these are what trades L1.2 residency against exit latency.
+		 */
+		if (rockchip->l1ss_cmrt_us) {
+			l1subcap &= ~PCI_L1SS_CAP_CM_RESTORE_TIME;
+			l1subcap |= FIELD_PREP(PCI_L1SS_CAP_CM_RESTORE_TIME,
+					       min_t(u32, rockchip->l1ss_cmrt_us,
+						     FIELD_MAX(PCI_L1SS_CAP_CM_RESTORE_TIME)));
+		}
+
+		if (rockchip->l1ss_t_power_on_us) {
+			l1subcap &= ~(PCI_L1SS_CAP_P_PWR_ON_SCALE |
+				      PCI_L1SS_CAP_P_PWR_ON_VALUE);
+			l1subcap |= rockchip_pcie_encode_t_power_on(rockchip->l1ss_t_power_on_us);
+		}
+	}
+
+	dw_pcie_dbi_ro_wr_en(pci);
+	dw_pcie_writel_dbi(pci, cap + PCI_L1SS_CAP, l1subcap);
+	dw_pcie_dbi_ro_wr_dis(pci);
+}
+
 static int rockchip_pcie_start_link(struct dw_pcie *pci)
 {
 	struct rockchip_pcie *rockchip = to_rockchip_pcie(pci);
@@ -245,6 +326,18 @@ static void rockchip_pcie_stop_link(struct dw_pcie *pci)
 	rockchip_pcie_disable_ltssm(rockchip);
 }
 
+/*
+ * The eDMA registers sit right after the unrolled iATU ones in the DBI space,
+ * but the DT only describes the DBI region, so the core can't find them on
+ * its own. The channel interrupts are the "dma0".."dmaN" platform IRQs, which
+ * the core picks up by itself; without them the eDMA is simply left unused.
+ */
+static void rockchip_pcie_edma_init(struct dw_pcie *pci)
+{
+	if (!pci->edma.reg_base)
+		pci->edma.reg_base = pci->atu_base + DEFAULT_DBI_DMA_OFFSET;
+}
+
 static int rockchip_pcie_host_init(struct dw_pcie_rp *pp)
 {
 	struct dw_pcie *pci = to_dw_pcie_from_pp(pp);
@@ -256,6 +349,16 @@ static int rockchip_pcie_host_init(struct dw_pcie_rp *pp)
 	if (irq < 0)
 		return irq;
 
+	/*
+	 * MSIs are meant to be translated by the GIC ITS, which lets every
+	 * vector have its own affinity. The DW MSI controller the core falls
+	 * back to funnels all of them into a single interrupt.
+	 */
+	if (pci_msi_enabled() &&
+	    !of_property_present(dev->of_node, "msi-map") &&
+	    !of_property_present(dev->of_node, "msi-parent"))
+		dev_warn(dev, "no msi-map, all MSIs will share one interrupt\n");
+
 	ret = rockchip_pcie_init_irq_domain(rockchip);
 	if (ret < 0)
 		dev_err(dev, "failed to init irq domain\n");
@@ -264,6 +367,8 @@ static int rockchip_pcie_host_init(struct dw_pcie_rp *pp)
 					 rockchip);
 
 	rockchip_pcie_enable_l0s(pci);
+	rockchip_pcie_configure_l1ss(pci);
+	rockchip_pcie_edma_init(pci);
 
 	return 0;
 }
@@ -333,12 +438,18 @@ static void rockchip_pcie_ep_hide_broken_ats_cap_rk3588(struct dw_pcie_ep *ep)
 		dev_err(dev, "failed to hide ATS capability\n");
 }
 
+static void rockchip_pcie_ep_pre_init(struct dw_pcie_ep *ep)
+{
+	rockchip_pcie_edma_init(to_dw_pcie_from_ep(ep));
+}
+
 static void rockchip_pcie_ep_init(struct dw_pcie_ep *ep)
 {
 	struct dw_pcie *pci = to_dw_pcie_from_ep(ep);
 	enum pci_barno bar;
 
 	rockchip_pcie_enable_l0s(pci);
+	rockchip_pcie_configure_l1ss(pci);
 	rockchip_pcie_ep_hide_broken_ats_cap_rk3588(ep);
 
 	for (bar = 0; bar < PCI_STD_NUM_BARS; bar++)
@@ -409,6 +520,7 @@ rockchip_pcie_get_features(struct dw_pcie_ep *ep)
 }
 
 static const struct dw_pcie_ep_ops rockchip_pcie_ep_ops = {
+	.pre_init = rockchip_pcie_ep_pre_init,
 	.init = rockchip_pcie_ep_init,
 	.raise_irq = rockchip_pcie_raise_irq,
 	.get_features = rockchip_pcie_get_features,
@@ -451,6 +563,13 @@ static int rockchip_pcie_resource_get(struct platform_device *pdev,
 		return dev_err_probe(&pdev->dev, PTR_ERR(rockchip->rst),
 				     "failed to get reset lines\n");
 
+	rockchip->supports_clkreq = of_property_read_bool(pdev->dev.of_node,
+							  "supports-clkreq");
+	of_property_read_u32(pdev->dev.of_node, "rockchip,aspm-cmrt-us",
+			     &rockchip->l1ss_cmrt_us);
+	of_property_read_u32(pdev->dev.of_node, "rockchip,aspm-t-power-on-us",
+			     &rockchip->l1ss_t_power_on_us);
+
 	return 0;
 }
 
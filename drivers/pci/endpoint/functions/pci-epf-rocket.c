@@ -0,0 +1,951 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Endpoint function exposing the Rockchip NPU to a PCIe host
+ *
+ * The host interface is described in include/linux/pci-epf-rocket.h.
+ *
+ * The buffers are moved with the DMA controller of the endpoint, the
+ * descriptors and jobs are small enough to go through the outbound window.
+ */
+
+#include <drm/drm_gem.h>
+#include <drm/drm_prime.h>
+#include <drm/rocket_accel.h>
+#include <drm/rocket_client.h>
+#include <linux/dma-buf.h>
+#include <linux/dma-fence.h>
+#include <linux/dma-resv.h>
+#include <linux/dmaengine.h>
+#include <linux/io.h>
+#include <linux/log2.h>
+#include <linux/module.h>
+#include <linux/overflow.h>
+#include <linux/slab.h>
+#include <linux/pci_ids.h>
+#include <linux/sizes.h>
+#include <linux/xarray.h>
+
+#include <linux/pci-epc.h>
+#include <linux/pci-epf.h>
+#include <linux/pci-epf-rocket.h>
+#include <linux/pci_regs.h>
+
+#define TIMEOUT_MS			5000
+
+static struct workqueue_struct *kpcirocket_workqueue;
+
+struct pci_epf_rocket_bo {
+	struct drm_gem_object	*obj;
+	struct dma_buf		*dmabuf;
+	struct dma_buf_attachment *attach;
+	struct sg_table		*sgt;
+};
+
+struct pci_epf_rocket {
+	void			*reg;
+	struct pci_epf		*epf;
+	enum pci_barno		reg_bar;
+	size_t			msix_table_offset;
+	struct delayed_work	cmd_handler;
+	struct dma_chan		*dma_chan_tx;
+	struct dma_chan		*dma_chan_rx;
+	struct dma_chan		*transfer_chan;
+	dma_cookie_t		transfer_cookie;
+	enum dma_status		transfer_status;
+	struct completion	transfer_complete;
+	const struct pci_epc_features *epc_features;
+
+	struct rocket_client	*client;
+	/* Buffers created by the host, indexed by their handle */
+	struct xarray		bos;
+
+	bool			enabled;
+	u64			ring_addr;
+	u32			ring_entries;
+	u32			ring_head;
+};
+
+static struct pci_epf_header rocket_header = {
+	.vendorid	= PCI_ANY_ID,
+	.deviceid	= PCI_ANY_ID,
+	.baseclass_code = PCI_BASE_CLASS_ACCELERATOR,
+	.interrupt_pin	= PCI_INTERRUPT_INTA,
+};
+
+/* Copy between a kernel buffer and host memory through the outbound window */
+static int pci_epf_rocket_host_copy(struct pci_epf_rocket *epf_rocket, void *buf,
+				    u64 host_addr, size_t size, bool to_host)
+{
+	struct pci_epf *epf = epf_rocket->epf;
+	struct pci_epc *epc = epf->epc;
+	struct pci_epc_map map;
+	int ret;
+
+	while (size) {
+		ret = pci_epc_mem_map(epc, epf->func_no, epf->vfunc_no,
+				      host_addr, size, &map);
+		if (ret)
+			return ret;
+
+		if (to_host)
+			memcpy_toio(map.virt_addr, buf, map.pci_size);
+		else
+			memcpy_fromio(buf, map.virt_addr, map.pci_size);
+
+		pci_epc_mem_unmap(epc, epf->func_no, epf->vfunc_no, &map);
+
+		size -= map.pci_size;
+		host_addr += map.pci_size;
+		buf += map.pci_size;
+	}
+
+	return 0;
+}
+
+static void pci_epf_rocket_dma_callback(void *param)
+{
+	struct pci_epf_rocket *epf_rocket = param;
+	struct dma_tx_state state;
+
+	epf_rocket->transfer_status =
+		dmaengine_tx_status(epf_rocket->transfer_chan,
+				    epf_rocket->transfer_cookie, &state);
+	if (epf_rocket->transfer_status == DMA_COMPLETE ||
+	    epf_rocket->transfer_status == DMA_ERROR)
+		complete(&epf_rocket->transfer_complete);
+}
+
+/*
+ * Move part of a buffer from or to the host. The buffer is scattered in
+ * the address space of the DMA controller: queue one transfer per segment
+ * and only wait for the last one.
+ */
+static int pci_epf_rocket_bo_transfer(struct pci_epf_rocket *epf_rocket,
+				      struct pci_epf_rocket_bo *bo, u64 offset,
+				      u64 host_addr, u64 size,
+				      enum dma_transfer_direction dir)
+{
+	struct dma_chan *chan = (dir == DMA_MEM_TO_DEV) ?
+				 epf_rocket->dma_chan_tx : epf_rocket->dma_chan_rx;
+	struct dma_slave_config sconf = { .direction = dir };
+	struct device *dev = &epf_rocket->epf->dev;
+	struct dma_async_tx_descriptor *tx;
+	dma_cookie_t cookie = 0;
+	struct scatterlist *sg;
+	unsigned int i;
+	int ret = 0;
+
+	if (offset > bo->obj->size || size > bo->obj->size - offset)
+		return -EINVAL;
+
+	if (!size)
+		return 0;
+
+	reinit_completion(&epf_rocket->transfer_complete);
+	epf_rocket->transfer_chan = chan;
+
+	for_each_sgtable_dma_sg(bo->sgt, sg, i) {
+		enum dma_ctrl_flags flags = DMA_CTRL_ACK;
+		dma_addr_t addr = sg_dma_address(sg);
+		u64 len = sg_dma_len(sg);
+		bool last;
+
+		if (offset >= len) {
+			offset -= len;
+			continue;
+		}
+
+		addr += offset;
+		len = min(len - offset, size);
+		offset = 0;
+		last = len == size;
+
+		if (dir == DMA_MEM_TO_DEV)
+			sconf.dst_addr = host_addr;
+		else
+			sconf.src_addr = host_addr;
+
+		if (dmaengine_slave_config(chan, &sconf)) {
+			dev_err(dev, "DMA slave config fail\n");
+			ret = -EIO;
+			goto terminate;
+		}
+
+		if (last)
+			flags |= DMA_PREP_INTERRUPT;
+
+		tx = dmaengine_prep_slave_single(chan, addr, len, dir, flags);
+		if (!tx) {
+			dev_err(dev, "Failed to prepare DMA transfer\n");
+			ret = -EIO;
+			goto terminate;
+		}
+
+		if (last) {
+			tx->callback = pci_epf_rocket_dma_callback;
+			tx->callback_param = epf_rocket;
+		}
+
+		cookie = dmaengine_submit(tx);
+		ret = dma_submit_error(cookie);
+		if (ret) {
+			dev_err(dev, "Failed to do DMA tx_submit %d\n", ret);
+			goto terminate;
+		}
+
+		host_addr += len;
+		size -= len;
+		if (last)
+			break;
+	}
+
+	epf_rocket->transfer_cookie = cookie;
+	dma_async_issue_pending(chan);
+
+	if (!wait_for_completion_timeout(&epf_rocket->transfer_complete,
+					 msecs_to_jiffies(TIMEOUT_MS))) {
+		dev_err(dev, "DMA transfer timed out\n");
+		ret = -ETIMEDOUT;
+	} else if (epf_rocket->transfer_status == DMA_ERROR) {
+		dev_err(dev, "DMA transfer failed\n");
+		ret = -EIO;
+	}
+
+terminate:
+	dmaengine_terminate_sync(chan);
+
+	return ret;
+}
+
+/*
+ * Wait for the jobs using a buffer: the ones writing it with
+ * DMA_RESV_USAGE_WRITE, all of them with DMA_RESV_USAGE_READ.
+ */
+static int pci_epf_rocket_bo_wait(struct pci_epf_rocket_bo *bo,
+				  enum dma_resv_usage usage)
+{
+	long ret;
+
+	ret = dma_resv_wait_timeout(bo->obj->resv, usage, false,
+				    msecs_to_jiffies(TIMEOUT_MS));
+	if (ret <= 0)
+		return ret ? ret : -ETIMEDOUT;
+
+	return 0;
+}
+
+static void pci_epf_rocket_bo_free(struct pci_epf_rocket_bo *bo)
+{
+	if (!IS_ERR_OR_NULL(bo->sgt))
+		dma_buf_unmap_attachment_unlocked(bo->attach, bo->sgt, DMA_BIDIRECTIONAL);
+	if (!IS_ERR_OR_NULL(bo->attach))
+		dma_buf_detach(bo->dmabuf, bo->attach);
+	if (!IS_ERR_OR_NULL(bo->dmabuf))
+		dma_buf_put(bo->dmabuf);
+	drm_gem_object_put(bo->obj);
+	kfree(bo);
+}
+
+static int pci_epf_rocket_bo_create(struct pci_epf_rocket *epf_rocket,
+				    struct pci_epf_rocket_desc *desc)
+{
+	struct device *dma_dev = epf_rocket->dma_chan_tx->device->dev;
+	u64 size = le64_to_cpu(desc->size);
+	struct pci_epf_rocket_bo *bo;
+	dma_addr_t dma_addr;
+	u32 handle;
+	int ret;
+
+	if (!size || size > PCI_EPF_ROCKET_MAX_BO_SIZE)
+		return -EINVAL;
+
+	bo = kzalloc(sizeof(*bo), GFP_KERNEL);
+	if (!bo)
+		return -ENOMEM;
+
+	bo->obj = rocket_client_create_bo(epf_rocket->client, size, &dma_addr);
+	if (IS_ERR(bo->obj)) {
+		ret = PTR_ERR(bo->obj);
+		kfree(bo);
+		return ret;
+	}
+
+	/* Map the buffer for the DMA controller through a dma-buf */
+	bo->dmabuf = drm_gem_prime_export(bo->obj, O_RDWR);
+	if (IS_ERR(bo->dmabuf)) {
+		ret = PTR_ERR(bo->dmabuf);
+		goto err_free;
+	}
+
+	bo->attach = dma_buf_attach(bo->dmabuf, dma_dev);
+	if (IS_ERR(bo->attach)) {
+		ret = PTR_ERR(bo->attach);
+		goto err_free;
+	}
+
+	bo->sgt = dma_buf_map_attachment_unlocked(bo->attach, DMA_BIDIRECTIONAL);
+	if (IS_ERR(bo->sgt)) {
+		ret = PTR_ERR(bo->sgt);
+		goto err_free;
+	}
+
+	ret = xa_alloc(&epf_rocket->bos, &handle, bo, xa_limit_32b, GFP_KERNEL);
+	if (ret)
+		goto err_free;
+
+	desc->handle = cpu_to_le32(handle);
+	desc->dma_addr = cpu_to_le64(dma_addr);
+
+	return 0;
+
+err_free:
+	pci_epf_rocket_bo_free(bo);
+
+	return ret;
+}
+
+static int pci_epf_rocket_bo_destroy(struct pci_epf_rocket *epf_rocket,
+				     struct pci_epf_rocket_desc *desc)
+{
+	u32 handle = le32_to_cpu(desc->handle);
+	struct pci_epf_rocket_bo *bo;
+	int ret;
+
+	bo = xa_load(&epf_rocket->bos, handle);
+	if (!bo)
+		return -ENOENT;
+
+	ret = pci_epf_rocket_bo_wait(bo, DMA_RESV_USAGE_READ);
+	if (ret)
+		return ret;
+
+	xa_erase(&epf_rocket->bos, handle);
+	pci_epf_rocket_bo_free(bo);
+
+	return 0;
+}
+
+static int pci_epf_rocket_bo_copy(struct pci_epf_rocket *epf_rocket,
+				  struct pci_epf_rocket_desc *desc,
+				  enum dma_transfer_direction dir)
+{
+	struct pci_epf_rocket_bo *bo;
+	int ret;
+
+	bo = xa_load(&epf_rocket->bos, le32_to_cpu(desc->handle));
+	if (!bo)
+		return -ENOENT;
+
+	/* Reading a buffer only needs the jobs writing it to be done */
+	ret = pci_epf_rocket_bo_wait(bo, dir == DMA_MEM_TO_DEV ?
+				     DMA_RESV_USAGE_WRITE : DMA_RESV_USAGE_READ);
+	if (ret)
+		return ret;
+
+	return pci_epf_rocket_bo_transfer(epf_rocket, bo,
+					  le64_to_cpu(desc->offset),
+					  le64_to_cpu(desc->host_addr),
+					  le64_to_cpu(desc->size), dir);
+}
+
+static int pci_epf_rocket_submit(struct pci_epf_rocket *epf_rocket,
+				 struct pci_epf_rocket_desc *desc)
+{
+	u64 size = le64_to_cpu(desc->size);
+	struct pci_epf_rocket_task *htasks;
+	struct drm_gem_object **bos = NULL;
+	struct drm_rocket_task *tasks = NULL;
+	struct pci_epf_rocket_job *job;
+	u32 task_count, in_count, out_count, i;
+	struct dma_fence *fence;
+	size_t needed;
+	__le32 *handles;
+	void *buf;
+	int ret;
+
+	if (size < sizeof(*job) || size > PCI_EPF_ROCKET_MAX_JOB_SIZE)
+		return -EINVAL;
+
+	buf = kmalloc(size, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	ret = pci_epf_rocket_host_copy(epf_rocket, buf, le64_to_cpu(desc->host_addr),
+				       size, false);
+	if (ret)
+		goto out_free;
+
+	job = buf;
+	task_count = le32_to_cpu(job->task_count);
+	in_count = le32_to_cpu(job->in_bo_count);
+	out_count = le32_to_cpu(job->out_bo_count);
+
+	needed = size_add(size_add(sizeof(*job), array_size(task_count, sizeof(*htasks))),
+			  array_size(size_add(in_count, out_count), sizeof(*handles)));
+	if (!task_count || needed > size) {
+		ret = -EINVAL;
+		goto out_free;
+	}
+
+	htasks = buf + sizeof(*job);
+	handles = (__le32 *)(htasks + task_count);
+
+	tasks = kcalloc(task_count, sizeof(*tasks), GFP_KERNEL);
+	bos = kcalloc(in_count + out_count, sizeof(*bos), GFP_KERNEL);
+	if (!tasks || (in_count + out_count && !bos)) {
+		ret = -ENOMEM;
+		goto out_free;
+	}
+
+	for (i = 0; i < task_count; i++) {
+		tasks[i].regcmd = le64_to_cpu(htasks[i].regcmd);
+		tasks[i].regcmd_count = le32_to_cpu(htasks[i].regcmd_count);
+	}
+
+	for (i = 0; i < in_count + out_count; i++) {
+		struct pci_epf_rocket_bo *bo;
+
+		bo = xa_load(&epf_rocket->bos, le32_to_cpu(handles[i]));
+		if (!bo) {
+			ret = -ENOENT;
+			goto out_free;
+		}
+		bos[i] = bo->obj;
+	}
+
+	fence = rocket_client_submit(epf_rocket->client, tasks, task_count,
+				     bos, in_count, bos + in_count, out_count);
+	if (IS_ERR(fence)) {
+		ret = PTR_ERR(fence);
+		goto out_free;
+	}
+
+	/*
+	 * Jobs can run on any core, in any order: the transfers wait on the
+	 * fences the job added to the reservation objects of its buffers.
+	 */
+	dma_fence_put(fence);
+
+out_free:
+	kfree(bos);
+	kfree(tasks);
+	kfree(buf);
+
+	return ret;
+}
+
+static void pci_epf_rocket_raise_irq(struct pci_epf_rocket *epf_rocket)
+{
+	struct pci_epf_rocket_reg *reg = epf_rocket->reg;
+	struct pci_epf *epf = epf_rocket->epf;
+	struct device *dev = &epf->dev;
+	struct pci_epc *epc = epf->epc;
+	u32 irq_number = le32_to_cpu(READ_ONCE(reg->irq_number));
+	u32 irq_type = le32_to_cpu(READ_ONCE(reg->irq_type));
+	int count;
+
+	switch (irq_type) {
+	case PCI_EPF_ROCKET_IRQ_TYPE_INTX:
+		pci_epc_raise_irq(epc, epf->func_no, epf->vfunc_no,
+				  PCI_IRQ_INTX, 0);
+		break;
+	case PCI_EPF_ROCKET_IRQ_TYPE_MSI:
+		count = pci_epc_get_msi(epc, epf->func_no, epf->vfunc_no);
+		if (irq_number > count || count <= 0) {
+			dev_err(dev, "Invalid MSI IRQ number %d / %d\n",
+				irq_number, count);
+			return;
+		}
+		pci_epc_raise_irq(epc, epf->func_no, epf->vfunc_no,
+				  PCI_IRQ_MSI, irq_number);
+		break;
+	case PCI_EPF_ROCKET_IRQ_TYPE_MSIX:
+		count = pci_epc_get_msix(epc, epf->func_no, epf->vfunc_no);
+		if (irq_number > count || count <= 0) {
+			dev_err(dev, "Invalid MSI-X IRQ number %d / %d\n",
+				irq_number, count);
+			return;
+		}
+		pci_epc_raise_irq(epc, epf->func_no, epf->vfunc_no,
+				  PCI_IRQ_MSIX, irq_number);
+		break;
+	default:
+		dev_err(dev, "Failed to raise IRQ, unknown type\n");
+		break;
+	}
+}
+
+static void pci_epf_rocket_process_desc(struct pci_epf_rocket *epf_rocket, u32 slot)
+{
+	u64 addr = epf_rocket->ring_addr + slot * sizeof(struct pci_epf_rocket_desc);
+	struct device *dev = &epf_rocket->epf->dev;
+	struct pci_epf_rocket_desc desc;
+	__le32 status = cpu_to_le32(PCI_EPF_ROCKET_DESC_DONE);
+	int ret;
+
+	ret = pci_epf_rocket_host_copy(epf_rocket, &desc, addr, sizeof(desc), false);
+	if (ret) {
+		dev_err(dev, "Failed to read descriptor %u\n", slot);
+		return;
+	}
+
+	switch (le32_to_cpu(desc.opcode)) {
+	case PCI_EPF_ROCKET_OP_BO_CREATE:
+		ret = pci_epf_rocket_bo_create(epf_rocket, &desc);
+		break;
+	case PCI_EPF_ROCKET_OP_BO_DESTROY:
+		ret = pci_epf_rocket_bo_destroy(epf_rocket, &desc);
+		break;
+	case PCI_EPF_ROCKET_OP_BO_WRITE:
+		ret = pci_epf_rocket_bo_copy(epf_rocket, &desc, DMA_DEV_TO_MEM);
+		break;
+	case PCI_EPF_ROCKET_OP_BO_READ:
+		ret = pci_epf_rocket_bo_copy(epf_rocket, &desc, DMA_MEM_TO_DEV);
+		break;
+	case PCI_EPF_ROCKET_OP_SUBMIT:
+		ret = pci_epf_rocket_submit(epf_rocket, &desc);
+		break;
+	default:
+		ret = -EOPNOTSUPP;
+		break;
+	}
+
+	desc.result = cpu_to_le32(ret);
+	desc.status = 0;
+
+	/* The host can only look at the results once DESC_DONE is set */
+	if (pci_epf_rocket_host_copy(epf_rocket, &desc, addr, sizeof(desc), true) ||
+	    pci_epf_rocket_host_copy(epf_rocket, &status,
+				     addr + offsetof(struct pci_epf_rocket_desc, status),
+				     sizeof(status), true)) {
+		dev_err(dev, "Failed to complete descriptor %u\n", slot);
+		return;
+	}
+
+	if (le32_to_cpu(desc.flags) & PCI_EPF_ROCKET_DESC_FLAG_IRQ)
+		pci_epf_rocket_raise_irq(epf_rocket);
+}
+
+/* Drop everything the host created, back to the state after probe */
+static void pci_epf_rocket_reset(struct pci_epf_rocket *epf_rocket)
+{
+	struct pci_epf_rocket_bo *bo;
+	unsigned long handle;
+
+	/* The jobs keep references to their buffers, no need to wait for them */
+	xa_for_each(&epf_rocket->bos, handle, bo) {
+		xa_erase(&epf_rocket->bos, handle);
+		pci_epf_rocket_bo_free(bo);
+	}
+
+	epf_rocket->enabled = false;
+	epf_rocket->ring_head = 0;
+}
+
+static bool pci_epf_rocket_enable(struct pci_epf_rocket *epf_rocket)
+{
+	struct pci_epf_rocket_reg *reg = epf_rocket->reg;
+	u32 entries = le32_to_cpu(READ_ONCE(reg->ring_entries));
+
+	if (!is_power_of_2(entries) || entries > PCI_EPF_ROCKET_MAX_RING_ENTRIES) {
+		dev_err(&epf_rocket->epf->dev, "Invalid ring size %u\n", entries);
+		return false;
+	}
+
+	epf_rocket->ring_addr = le64_to_cpu(READ_ONCE(reg->ring_addr));
+	epf_rocket->ring_entries = entries;
+	epf_rocket->ring_head = 0;
+	epf_rocket->enabled = true;
+
+	WRITE_ONCE(reg->ring_head, 0);
+	WRITE_ONCE(reg->status, cpu_to_le32(PCI_EPF_ROCKET_STATUS_READY));
+
+	return true;
+}
+
+static void pci_epf_rocket_cmd_handler(struct work_struct *work)
+{
+	struct pci_epf_rocket *epf_rocket = container_of(work, struct pci_epf_rocket,
+							 cmd_handler.work);
+	struct pci_epf_rocket_reg *reg = epf_rocket->reg;
+	bool busy = false;
+	u32 tail;
+
+	if (!(le32_to_cpu(READ_ONCE(reg->control)) & PCI_EPF_ROCKET_CONTROL_ENABLE)) {
+		if (epf_rocket->enabled) {
+			pci_epf_rocket_reset(epf_rocket);
+			WRITE_ONCE(reg->status, 0);
+		}
+		goto reset_handler;
+	}
+
+	if (!epf_rocket->enabled) {
+		if (le32_to_cpu(READ_ONCE(reg->status)) & PCI_EPF_ROCKET_STATUS_ERROR)
+			goto reset_handler;
+
+		if (!pci_epf_rocket_enable(epf_rocket)) {
+			WRITE_ONCE(reg->status, cpu_to_le32(PCI_EPF_ROCKET_STATUS_ERROR));
+			goto reset_handler;
+		}
+	}
+
+	tail = le32_to_cpu(READ_ONCE(reg->ring_tail));
+	if (tail - epf_rocket->ring_head > epf_rocket->ring_entries) {
+		dev_err(&epf_rocket->epf->dev, "Invalid ring tail %u\n", tail);
+		pci_epf_rocket_reset(epf_rocket);
+		WRITE_ONCE(reg->status, cpu_to_le32(PCI_EPF_ROCKET_STATUS_ERROR));
+		goto reset_handler;
+	}
+
+	while (epf_rocket->ring_head != tail) {
+		pci_epf_rocket_process_desc(epf_rocket, epf_rocket->ring_head &
+					    (epf_rocket->ring_entries - 1));
+		epf_rocket->ring_head++;
+		WRITE_ONCE(reg->ring_head, cpu_to_le32(epf_rocket->ring_head));
+		busy = true;
+	}
+
+reset_handler:
+	/* Look at the doorbell again right away while descriptors keep coming */
+	queue_delayed_work(kpcirocket_workqueue, &epf_rocket->cmd_handler,
+			   busy ? 0 : msecs_to_jiffies(1));
+}
+
+struct epf_dma_filter {
+	struct device *dev;
+	u32 dma_mask;
+};
+
+static bool epf_dma_filter_fn(struct dma_chan *chan, void *node)
+{
+	struct epf_dma_filter *filter = node;
+	struct dma_slave_caps caps;
+
+	memset(&caps, 0, sizeof(caps));
+	dma_get_slave_caps(chan, &caps);
+
+	return chan->device->dev == filter->dev
+		&& (filter->dma_mask & caps.directions);
+}
+
+/*
+ * Only the DMA controller embedded in the endpoint controller, such as the
+ * DesignWare eDMA, can reach host memory: there is no generic fallback.
+ */
+static int pci_epf_rocket_init_dma_chan(struct pci_epf_rocket *epf_rocket)
+{
+	struct pci_epf *epf = epf_rocket->epf;
+	struct device *dev = &epf->dev;
+	struct epf_dma_filter filter;
+	dma_cap_mask_t mask;
+
+	filter.dev = epf->epc->dev.parent;
+	dma_cap_zero(mask);
+	dma_cap_set(DMA_SLAVE, mask);
+
+	filter.dma_mask = BIT(DMA_DEV_TO_MEM);
+	epf_rocket->dma_chan_rx = dma_request_channel(mask, epf_dma_filter_fn, &filter);
+	if (!epf_rocket->dma_chan_rx) {
+		dev_err(dev, "Failed to get private DMA rx channel\n");
+		return -ENODEV;
+	}
+
+	filter.dma_mask = BIT(DMA_MEM_TO_DEV);
+	epf_rocket->dma_chan_tx = dma_request_channel(mask, epf_dma_filter_fn, &filter);
+	if (!epf_rocket->dma_chan_tx) {
+		dev_err(dev, "Failed to get private DMA tx channel\n");
+		dma_release_channel(epf_rocket->dma_chan_rx);
+		epf_rocket->dma_chan_rx = NULL;
+		return -ENODEV;
+	}
+
+	init_completion(&epf_rocket->transfer_complete);
+
+	return 0;
+}
+
+static void pci_epf_rocket_clean_dma_chan(struct pci_epf_rocket *epf_rocket)
+{
+	if (epf_rocket->dma_chan_tx) {
+		dma_release_channel(epf_rocket->dma_chan_tx);
+		epf_rocket->dma_chan_tx = NULL;
+	}
+
+	if (epf_rocket->dma_chan_rx) {
+		dma_release_channel(epf_rocket->dma_chan_rx);
+		epf_rocket->dma_chan_rx = NULL;
+	}
+}
+
+static int pci_epf_rocket_epc_init(struct pci_epf *epf)
+{
+	struct pci_epf_rocket *epf_rocket = epf_get_drvdata(epf);
+	const struct pci_epc_features *epc_features = epf_rocket->epc_features;
+	struct pci_epf_rocket_reg *reg = epf_rocket->reg;
+	struct pci_epf_header *header = epf->header;
+	struct pci_epc *epc = epf->epc;
+	struct device *dev = &epf->dev;
+	int ret;
+
+	ret = pci_epf_rocket_init_dma_chan(epf_rocket);
+	if (ret)
+		return ret;
+
+	if (epf->vfunc_no <= 1) {
+		ret = pci_epc_write_header(epc, epf->func_no, epf->vfunc_no, header);
+		if (ret) {
+			dev_err(dev, "Configuration header write failed\n");
+			goto err_clean_dma;
+		}
+	}
+
+	reg->magic = cpu_to_le32(PCI_EPF_ROCKET_MAGIC);
+	reg->version = cpu_to_le32(PCI_EPF_ROCKET_VERSION);
+
+	ret = pci_epc_set_bar(epc, epf->func_no, epf->vfunc_no,
+			      &epf->bar[epf_rocket->reg_bar]);
+	if (ret) {
+		dev_err(dev, "Failed to set BAR%d\n", epf_rocket->reg_bar);
+		goto err_clean_dma;
+	}
+
+	if (epc_features->msi_capable) {
+		ret = pci_epc_set_msi(epc, epf->func_no, epf->vfunc_no,
+				      epf->msi_interrupts);
+		if (ret) {
+			dev_err(dev, "MSI configuration failed\n");
+			goto err_clear_bar;
+		}
+	}
+
+	if (epc_features->msix_capable) {
+		ret = pci_epc_set_msix(epc, epf->func_no, epf->vfunc_no,
+				       epf->msix_interrupts,
+				       epf_rocket->reg_bar,
+				       epf_rocket->msix_table_offset);
+		if (ret) {
+			dev_err(dev, "MSI-X configuration failed\n");
+			goto err_clear_bar;
+		}
+	}
+
+	if (!epc_features->linkup_notifier)
+		queue_work(kpcirocket_workqueue, &epf_rocket->cmd_handler.work);
+
+	return 0;
+
+err_clear_bar:
+	pci_epc_clear_bar(epc, epf->func_no, epf->vfunc_no,
+			  &epf->bar[epf_rocket->reg_bar]);
+err_clean_dma:
+	pci_epf_rocket_clean_dma_chan(epf_rocket);
+
+	return ret;
+}
+
+static void pci_epf_rocket_epc_deinit(struct pci_epf *epf)
+{
+	struct pci_epf_rocket *epf_rocket = epf_get_drvdata(epf);
+
+	cancel_delayed_work_sync(&epf_rocket->cmd_handler);
+	pci_epf_rocket_reset(epf_rocket);
+	pci_epf_rocket_clean_dma_chan(epf_rocket);
+	pci_epc_clear_bar(epf->epc, epf->func_no, epf->vfunc_no,
+			  &epf->bar[epf_rocket->reg_bar]);
+}
+
+static int pci_epf_rocket_link_up(struct pci_epf *epf)
+{
+	struct pci_epf_rocket *epf_rocket = epf_get_drvdata(epf);
+
+	queue_delayed_work(kpcirocket_workqueue, &epf_rocket->cmd_handler,
+			   msecs_to_jiffies(1));
+
+	return 0;
+}
+
+static int pci_epf_rocket_link_down(struct pci_epf *epf)
+{
+	struct pci_epf_rocket *epf_rocket = epf_get_drvdata(epf);
+
+	cancel_delayed_work_sync(&epf_rocket->cmd_handler);
+	pci_epf_rocket_reset(epf_rocket);
+
+	return 0;
+}
+
+static const struct pci_epc_event_ops pci_epf_rocket_event_ops = {
+	.epc_init = pci_epf_rocket_epc_init,
+	.epc_deinit = pci_epf_rocket_epc_deinit,
+	.link_up = pci_epf_rocket_link_up,
+	.link_down = pci_epf_rocket_link_down,
+};
+
+static int pci_epf_rocket_alloc_space(struct pci_epf *epf)
+{
+	struct pci_epf_rocket *epf_rocket = epf_get_drvdata(epf);
+	const struct pci_epc_features *epc_features = epf_rocket->epc_features;
+	size_t reg_bar_size, msix_table_size = 0, pba_size = 0;
+	void *base;
+
+	reg_bar_size = ALIGN(sizeof(struct pci_epf_rocket_reg), 128);
+
+	if (epc_features->msix_capable) {
+		msix_table_size = PCI_MSIX_ENTRY_SIZE * epf->msix_interrupts;
+		epf_rocket->msix_table_offset = reg_bar_size;
+		/* Align to QWORD or 8 Bytes */
+		pba_size = ALIGN(DIV_ROUND_UP(epf->msix_interrupts, 8), 8);
+	}
+
+	base = pci_epf_alloc_space(epf, reg_bar_size + msix_table_size + pba_size,
+				   epf_rocket->reg_bar, epc_features,
+				   PRIMARY_INTERFACE);
+	if (!base) {
+		dev_err(&epf->dev, "Failed to allocated register space\n");
+		return -ENOMEM;
+	}
+	epf_rocket->reg = base;
+
+	return 0;
+}
+
+static int pci_epf_rocket_bind(struct pci_epf *epf)
+{
+	struct pci_epf_rocket *epf_rocket = epf_get_drvdata(epf);
+	const struct pci_epc_features *epc_features;
+	struct pci_epc *epc = epf->epc;
+	enum pci_barno reg_bar;
+	int ret;
+
+	if (WARN_ON_ONCE(!epc))
+		return -EINVAL;
+
+	epc_features = pci_epc_get_features(epc, epf->func_no, epf->vfunc_no);
+	if (!epc_features) {
+		dev_err(&epf->dev, "epc_features not implemented\n");
+		return -EOPNOTSUPP;
+	}
+
+	reg_bar = pci_epc_get_first_free_bar(epc_features);
+	if (reg_bar < 0)
+		return -EINVAL;
+
+	epf_rocket->reg_bar = reg_bar;
+	epf_rocket->epc_features = epc_features;
+
+	/*
+	 * bind() runs from configfs, which can't retry: report a missing
+	 * NPU driver as a missing device rather than -EPROBE_DEFER.
+	 */
+	epf_rocket->client = rocket_client_open();
+	if (IS_ERR(epf_rocket->client)) {
+		ret = PTR_ERR(epf_rocket->client);
+		epf_rocket->client = NULL;
+		if (ret == -EPROBE_DEFER)
+			ret = -ENODEV;
+		dev_err(&epf->dev, "Failed to open the NPU: %d\n", ret);
+		return ret;
+	}
+
+	ret = pci_epf_rocket_alloc_space(epf);
+	if (ret) {
+		rocket_client_close(epf_rocket->client);
+		epf_rocket->client = NULL;
+	}
+
+	return ret;
+}
+
+static void pci_epf_rocket_unbind(struct pci_epf *epf)
+{
+	struct pci_epf_rocket *epf_rocket = epf_get_drvdata(epf);
+	struct pci_epc *epc = epf->epc;
+
+	cancel_delayed_work_sync(&epf_rocket->cmd_handler);
+	pci_epf_rocket_reset(epf_rocket);
+	if (epc->init_complete) {
+		pci_epf_rocket_clean_dma_chan(epf_rocket);
+		pci_epc_clear_bar(epc, epf->func_no, epf->vfunc_no,
+				  &epf->bar[epf_rocket->reg_bar]);
+	}
+	pci_epf_free_space(epf, epf_rocket->reg, epf_rocket->reg_bar,
+			   PRIMARY_INTERFACE);
+	epf_rocket->reg = NULL;
+
+	rocket_client_close(epf_rocket->client);
+	epf_rocket->client = NULL;
+}
+
+static const struct pci_epf_device_id pci_epf_rocket_ids[] = {
+	{
+		.name = "pci_epf_rocket",
+	},
+	{},
+};
+
+static int pci_epf_rocket_probe(struct pci_epf *epf,
+				const struct pci_epf_device_id *id)
+{
+	struct pci_epf_rocket *epf_rocket;
+	struct device *dev = &epf->dev;
+
+	epf_rocket = devm_kzalloc(dev, sizeof(*epf_rocket), GFP_KERNEL);
+	if (!epf_rocket)
+		return -ENOMEM;
+
+	epf->header = &rocket_header;
+	epf_rocket->epf = epf;
+	xa_init_flags(&epf_rocket->bos, XA_FLAGS_ALLOC1);
+
+	INIT_DELAYED_WORK(&epf_rocket->cmd_handler, pci_epf_rocket_cmd_handler);
+
+	epf->event_ops = &pci_epf_rocket_event_ops;
+
+	epf_set_drvdata(epf, epf_rocket);
+	return 0;
+}
+
+static const struct pci_epf_ops ops = {
+	.unbind	= pci_epf_rocket_unbind,
+	.bind	= pci_epf_rocket_bind,
+};
+
+static struct pci_epf_driver rocket_driver = {
+	.driver.name	= "pci_epf_rocket",
+	.probe		= pci_epf_rocket_probe,
+	.id_table	= pci_epf_rocket_ids,
+	.ops		= &ops,
+	.owner		= THIS_MODULE,
+};
+
+static int __init pci_epf_rocket_init(void)
+{
+	int ret;
+
+	kpcirocket_workqueue = alloc_workqueue("kpcirocket",
+					       WQ_MEM_RECLAIM | WQ_HIGHPRI, 0);
+	if (!kpcirocket_workqueue) {
+		pr_err("Failed to allocate the kpcirocket work queue\n");
+		return -ENOMEM;
+	}
+
+	ret = pci_epf_register_driver(&rocket_driver);
+	if (ret) {
+		destroy_workqueue(kpcirocket_workqueue);
+		pr_err("Failed to register pci epf rocket driver --> %d\n", ret);
+		return ret;
+	}
+
+	return 0;
+}
+module_init(pci_epf_rocket_init);
+
+static void __exit pci_epf_rocket_exit(void)
+{
+	pci_epf_unregister_driver(&rocket_driver);
+	destroy_workqueue(kpcirocket_workqueue);
+}
+module_exit(pci_epf_rocket_exit);
+
+MODULE_DESCRIPTION("PCI EPF driver exposing the Rockchip NPU");
+MODULE_LICENSE("GPL");
@@ -411,6 +411,7 @@ enum rk_hdptx_reset {
 };
 
 #define MAX_HDPTX_PHY_NUM	2
+#define HDPTX_ROPLL_CACHE_SIZE	4
 
 struct rk_hdptx_phy_cfg {
 	unsigned int num_phys;
@@ -436,6 +437,11 @@ struct rk_hdptx_phy {
 	struct clk_hw hw;
 	unsigned long rate;
 
+	/* calculated ROPLL configs for rates missing from ropll_tmds_cfg */
+	spinlock_t ropll_cache_lock;
+	struct ropll_config ropll_cache[HDPTX_ROPLL_CACHE_SIZE];
+	unsigned int ropll_cache_next;
+
 	atomic_t usage_count;
 
 	/* used for dp mode */
@@ -1007,35 +1013,80 @@ static bool rk_hdptx_phy_clk_pll_calc(unsigned int data_rate,
 	return true;
 }
 
-static int rk_hdptx_ropll_tmds_cmn_config(struct rk_hdptx_phy *hdptx,
-					  unsigned int rate)
+static bool rk_hdptx_ropll_cache_find(struct rk_hdptx_phy *hdptx,
+				      unsigned int rate,
+				      struct ropll_config *cfg)
 {
-	const struct ropll_config *cfg = NULL;
-	struct ropll_config rc = {0};
+	bool found = false;
 	int i;
 
-	hdptx->rate = rate * 100;
-
-	for (i = 0; i < ARRAY_SIZE(ropll_tmds_cfg); i++)
-		if (rate == ropll_tmds_cfg[i].bit_rate) {
-			cfg = &ropll_tmds_cfg[i];
+	spin_lock(&hdptx->ropll_cache_lock);
+	for (i = 0; i < HDPTX_ROPLL_CACHE_SIZE; i++) {
+		if (hdptx->ropll_cache[i].bit_rate == rate) {
+			if (cfg)
+				*cfg = hdptx->ropll_cache[i];
+			found = true;
 			break;
 		}
+	}
+	spin_unlock(&hdptx->ropll_cache_lock);
+
+	return found;
+}
+
+static const struct ropll_config *
+rk_hdptx_ropll_tmds_cfg_get(struct rk_hdptx_phy *hdptx, unsigned int rate,
+			    struct ropll_config *rc)
+{
+	const struct ropll_config *cfg = rc;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(ropll_tmds_cfg); i++)
+		if (rate == ropll_tmds_cfg[i].bit_rate)
+			return &ropll_tmds_cfg[i];
+
+	if (rk_hdptx_ropll_cache_find(hdptx, rate, rc))
+		return rc;
+
+	memset(rc, 0, sizeof(*rc));
+	if (!rk_hdptx_phy_clk_pll_calc(rate, rc))
+		return NULL;
 
+	rc->bit_rate = rate;
+
+	dev_warn(hdptx->dev,
+		"there is no suitable config for rate %u, using calculated config instead:\n",
+		rate);
+	dev_warn(hdptx->dev,
+		"bit_rate=%u, mdiv=%u, mdiv_afc=%u, pdiv=%u, refdiv=%u, sdiv=%u, iqdiv_rstn=%u, ref_clk_sel=%u, sdm_en=%u, sdm_rstn=%u, sdc_frac_en=%u, sdc_rstn=%u, sdm_clk_div=%u, sdm_deno=%u, sdm_num_sign=%u, sdm_num=%u, sdc_n=%u, sdc_num=%u, sdc_deno=%u, sdc_ndiv_rstn=%u, ssc_en=%u, ssc_fm_dev=%u, ssc_fm_freq=%u, ssc_clk_div_sel=%u, ana_cpp_ctrl=%u, ana_lpf_c_sel=%u, cd_tx_ser_rate_sel=%u\n",
+		cfg->bit_rate, cfg->pms_mdiv, cfg->pms_mdiv_afc, cfg->pms_pdiv, cfg->pms_refdiv, cfg->pms_sdiv, cfg->pms_iqdiv_rstn, cfg->ref_clk_sel, cfg->sdm_en, cfg->sdm_rstn, cfg->sdc_frac_en, cfg->sdc_rstn, cfg->sdm_clk_div, cfg->sdm_deno, cfg->sdm_num_sign, cfg->sdm_num, cfg->sdc_n, cfg->sdc_num, cfg->sdc_deno, cfg->sdc_ndiv_rstn, cfg->ssc_en, cfg->ssc_fm_dev, cfg->ssc_fm_freq, cfg->ssc_clk_div_sel, cfg->ana_cpp_ctrl, cfg->ana_lpf_c_sel, cfg->cd_tx_ser_rate_sel);
+
+	/*
+	 * Keep the result, so switching back and forth between modes does
+	 * not recalculate, nor warn, every time.
+	 */
+	spin_lock(&hdptx->ropll_cache_lock);
+	hdptx->ropll_cache[hdptx->ropll_cache_next] = *rc;
+	hdptx->ropll_cache_next = (hdptx->ropll_cache_next + 1) %
+				  HDPTX_ROPLL_CACHE_SIZE;
+	spin_unlock(&hdptx->ropll_cache_lock);
+
+	return rc;
+}
+
+static int rk_hdptx_ropll_tmds_cmn_config(struct rk_hdptx_phy *hdptx,
+					  unsigned int rate)
+{
+	const struct ropll_config *cfg;
+	struct ropll_config rc;
+
+	hdptx->rate = rate * 100;
+
+	cfg = rk_hdptx_ropll_tmds_cfg_get(hdptx, rate, &rc);
 	if (!cfg) {
-		if (rk_hdptx_phy_clk_pll_calc(rate, &rc)) {
-			cfg = &rc;
-			dev_warn(hdptx->dev,
-				"there is no suitable config for rate %u, using calculated config instead:\n",
-				rate);
-			dev_warn(hdptx->dev,
-				"bit_rate=%u, mdiv=%u, mdiv_afc=%u, pdiv=%u, refdiv=%u, sdiv=%u, iqdiv_rstn=%u, ref_clk_sel=%u, sdm_en=%u, sdm_rstn=%u, sdc_frac_en=%u, sdc_rstn=%u, sdm_clk_div=%u, sdm_deno=%u, sdm_num_sign=%u, sdm_num=%u, sdc_n=%u, sdc_num=%u, sdc_deno=%u, sdc_ndiv_rstn=%u, ssc_en=%u, ssc_fm_dev=%u, ssc_fm_freq=%u, ssc_clk_div_sel=%u, ana_cpp_ctrl=%u, ana_lpf_c_sel=%u, cd_tx_ser_rate_sel=%u\n",
-				cfg->bit_rate, cfg->pms_mdiv, cfg->pms_mdiv_afc, cfg->pms_pdiv, cfg->pms_refdiv, cfg->pms_sdiv, cfg->pms_iqdiv_rstn, cfg->ref_clk_sel, cfg->sdm_en, cfg->sdm_rstn, cfg->sdc_frac_en, cfg->sdc_rstn, cfg->sdm_clk_div, cfg->sdm_deno, cfg->sdm_num_sign, cfg->sdm_num, cfg->sdc_n, cfg->sdc_num, cfg->sdc_deno, cfg->sdc_ndiv_rstn, cfg->ssc_en, cfg->ssc_fm_dev, cfg->ssc_fm_freq, cfg->ssc_clk_div_sel, cfg->ana_cpp_ctrl, cfg->ana_lpf_c_sel, cfg->cd_tx_ser_rate_sel);
-		} else {
-			dev_err(hdptx->dev, "%s: cannot find or calculate PLL config for rate %u\n",
-				__func__, rate);
-			return -EINVAL;
-		}
+		dev_err(hdptx->dev, "%s: cannot find or calculate PLL config for rate %u\n",
+			__func__, rate);
+		return -EINVAL;
 	}
 
 	dev_dbg(hdptx->dev, "mdiv=%u, sdiv=%u, sdm_en=%u, k_sign=%u, k=%u, lc=%u\n",
@@ -1863,6 +1914,7 @@ static long rk_hdptx_phy_clk_round_rate(struct clk_hw *hw, unsigned long rate,
 			break;
 
 	if (i == ARRAY_SIZE(ropll_tmds_cfg) &&
+	    !rk_hdptx_ropll_cache_find(to_rk_hdptx_phy(hw), bit_rate, NULL) &&
 	    !rk_hdptx_phy_clk_pll_calc(bit_rate, NULL))
 		return -EINVAL;
 
@@ -1949,6 +2001,7 @@ static int rk_hdptx_phy_probe(struct platform_device *pdev)
 		return -ENOMEM;
 
 	hdptx->dev = dev;
+	spin_lock_init(&hdptx->ropll_cache_lock);
 
 	regs = devm_platform_get_and_ioremap_resource(pdev, 0, &res);
 	if (IS_ERR(regs))
@@ -843,10 +843,16 @@ static int rockchip_pm_add_one_domain(struct rockchip_pmu *pmu,
 	pd->genpd.power_on = rockchip_pd_power_on;
 	pd->genpd.attach_dev = rockchip_pd_attach_dev;
 	pd->genpd.detach_dev = rockchip_pd_detach_dev;
-	pd->genpd.flags = GENPD_FLAG_PM_CLK;
+	pd->genpd.flags = GENPD_FLAG_PM_CLK | GENPD_FLAG_MIN_RESIDENCY;
 	if (pd_info->active_wakeup)
 		pd->genpd.flags |= GENPD_FLAG_ACTIVE_WAKEUP;
-	pm_genpd_init(&pd->genpd, NULL,
+	/*
+	 * With a governor attached genpd measures the on/off latency of each
+	 * domain, which for domains with QoS registers includes the QoS save
+	 * and restore, and takes it into account together with the device
+	 * resume latency constraints and next wakeup hints.
+	 */
+	pm_genpd_init(&pd->genpd, &simple_qos_governor,
 		      !rockchip_pmu_domain_is_on(pd) ||
 		      (pd->info->mem_status_mask && !rockchip_pmu_domain_is_mem_on(pd)));
 
@@ -41,8 +41,59 @@ static struct dtpm_node __initdata rk3399_hierarchy[] = {
 	[9] = { /* sentinel */ }
 };
 
+/*
+ * The NPU cores are listed so that they get capped along with the CPUs and
+ * the GPU as soon as they provide a devfreq device with an energy model,
+ * DT nodes without one are skipped by the devfreq DTPM.
+ */
+static struct dtpm_node __initdata rk3588_hierarchy[] = {
+	[0] = { .name = "rk3588",
+		.type = DTPM_NODE_VIRTUAL },
+	[1] = { .name = "package",
+		.type = DTPM_NODE_VIRTUAL,
+		.parent = &rk3588_hierarchy[0] },
+	[2] = { .name = "/cpus/cpu@0",
+		.type = DTPM_NODE_DT,
+		.parent = &rk3588_hierarchy[1] },
+	[3] = { .name = "/cpus/cpu@100",
+		.type = DTPM_NODE_DT,
+		.parent = &rk3588_hierarchy[1] },
+	[4] = { .name = "/cpus/cpu@200",
+		.type = DTPM_NODE_DT,
+		.parent = &rk3588_hierarchy[1] },
+	[5] = { .name = "/cpus/cpu@300",
+		.type = DTPM_NODE_DT,
+		.parent = &rk3588_hierarchy[1] },
+	[6] = { .name = "/cpus/cpu@400",
+		.type = DTPM_NODE_DT,
+		.parent = &rk3588_hierarchy[1] },
+	[7] = { .name = "/cpus/cpu@500",
+		.type = DTPM_NODE_DT,
+		.parent = &rk3588_hierarchy[1] },
+	[8] = { .name = "/cpus/cpu@600",
+		.type = DTPM_NODE_DT,
+		.parent = &rk3588_hierarchy[1] },
+	[9] = { .name = "/cpus/cpu@700",
+		.type = DTPM_NODE_DT,
+		.parent = &rk3588_hierarchy[1] },
+	[10] = { .name = "/gpu@fb000000",
+		.type = DTPM_NODE_DT,
+		.parent = &rk3588_hierarchy[1] },
+	[11] = { .name = "/npu@fdab0000",
+		.type = DTPM_NODE_DT,
+		.parent = &rk3588_hierarchy[1] },
+	[12] = { .name = "/npu@fdac0000",
+		.type = DTPM_NODE_DT,
+		.parent = &rk3588_hierarchy[1] },
+	[13] = { .name = "/npu@fdad0000",
+		.type = DTPM_NODE_DT,
+		.parent = &rk3588_hierarchy[1] },
+	[14] = { /* sentinel */ }
+};
+
 static struct of_device_id __initdata rockchip_dtpm_match_table[] = {
         { .compatible = "rockchip,rk3399", .data = rk3399_hierarchy },
+        { .compatible = "rockchip,rk3588", .data = rk3588_hierarchy },
         {},
 };
 
@@ -58,7 +109,7 @@ static void __exit rockchip_dtpm_exit(void)
 }
 module_exit(rockchip_dtpm_exit);
 
-MODULE_SOFTDEP("pre: panfrost cpufreq-dt");
+MODULE_SOFTDEP("pre: panfrost panthor cpufreq-dt");
 MODULE_DESCRIPTION("Rockchip DTPM driver");
 MODULE_LICENSE("GPL");
 MODULE_ALIAS("platform:dtpm");
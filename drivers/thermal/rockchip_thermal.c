@@ -73,7 +73,7 @@ struct chip_tsadc_table {
  * @tshut_mode: the hardware-controlled shutdown mode (0:CRU 1:GPIO)
  * @tshut_polarity: the hardware-controlled active polarity (0:LOW 1:HIGH)
  * @initialize: SoC special initialize tsadc controller method
- * @irq_ack: clear the interrupt
+ * @irq_ack: clear the interrupt, returns the mask of the alarmed channels
  * @control: enable/disable method for the tsadc controller
  * @get_temp: get the temperature
  * @set_alarm_temp: set the high temperature interrupt
@@ -94,7 +94,7 @@ struct rockchip_tsadc_chip {
 	/* Chip-wide methods */
 	void (*initialize)(struct regmap *grf,
 			   void __iomem *reg, enum tshut_polarity p);
-	void (*irq_ack)(void __iomem *reg);
+	u32 (*irq_ack)(void __iomem *reg);
 	void (*control)(void __iomem *reg, bool on);
 
 	/* Per-sensor methods */
@@ -204,6 +204,8 @@ struct rockchip_thermal_data {
 #define TSADCV2_INT_PD_CLEAR_MASK		~BIT(8)
 #define TSADCV3_INT_PD_CLEAR_MASK		~BIT(16)
 #define TSADCV4_INT_PD_CLEAR_MASK		0xffffffff
+#define TSADCV2_INT_PD_HT_MASK			GENMASK(3, 0)
+#define TSADCV4_INT_PD_HT_MASK			GENMASK(15, 0)
 
 #define TSADCV2_DATA_MASK			0xfff
 #define TSADCV3_DATA_MASK			0x3ff
@@ -835,31 +837,37 @@ static void rk_tsadcv8_initialize(struct regmap *grf, void __iomem *regs,
 			       regs + TSADCV2_AUTO_CON);
 }
 
-static void rk_tsadcv2_irq_ack(void __iomem *regs)
+static u32 rk_tsadcv2_irq_ack(void __iomem *regs)
 {
 	u32 val;
 
 	val = readl_relaxed(regs + TSADCV2_INT_PD);
 	writel_relaxed(val & TSADCV2_INT_PD_CLEAR_MASK, regs + TSADCV2_INT_PD);
+
+	return val & TSADCV2_INT_PD_HT_MASK;
 }
 
-static void rk_tsadcv3_irq_ack(void __iomem *regs)
+static u32 rk_tsadcv3_irq_ack(void __iomem *regs)
 {
 	u32 val;
 
 	val = readl_relaxed(regs + TSADCV2_INT_PD);
 	writel_relaxed(val & TSADCV3_INT_PD_CLEAR_MASK, regs + TSADCV2_INT_PD);
+
+	return val & TSADCV2_INT_PD_HT_MASK;
 }
 
-static void rk_tsadcv4_irq_ack(void __iomem *regs)
+static u32 rk_tsadcv4_irq_ack(void __iomem *regs)
 {
-	u32 val;
+	u32 val, pending;
 
-	val = readl_relaxed(regs + TSADCV3_INT_PD);
-	writel_relaxed(val & TSADCV4_INT_PD_CLEAR_MASK, regs + TSADCV3_INT_PD);
+	pending = readl_relaxed(regs + TSADCV3_INT_PD);
+	writel_relaxed(pending & TSADCV4_INT_PD_CLEAR_MASK, regs + TSADCV3_INT_PD);
 	val = readl_relaxed(regs + TSADCV3_HSHUT_PD);
 	writel_relaxed(val & TSADCV3_INT_PD_CLEAR_MASK,
 		       regs + TSADCV3_HSHUT_PD);
+
+	return pending & TSADCV4_INT_PD_HT_MASK;
 }
 
 static void rk_tsadcv2_control(void __iomem *regs, bool enable)
@@ -1364,15 +1372,28 @@ rockchip_thermal_toggle_sensor(struct rockchip_thermal_sensor *sensor, bool on)
 static irqreturn_t rockchip_thermal_alarm_irq_thread(int irq, void *dev)
 {
 	struct rockchip_thermal_data *thermal = dev;
+	struct rockchip_thermal_sensor *sensor;
+	u32 pending;
 	int i;
 
-	dev_dbg(&thermal->pdev->dev, "thermal alarm\n");
+	pending = thermal->chip->irq_ack(thermal->regs);
 
-	thermal->chip->irq_ack(thermal->regs);
+	dev_dbg(&thermal->pdev->dev, "thermal alarm, pending %#x\n", pending);
 
-	for (i = 0; i < thermal->chip->chn_num; i++)
-		thermal_zone_device_update(thermal->sensors[i].tzd,
+	/*
+	 * Only re-evaluate the zones whose alarm fired, so that the cooling
+	 * devices bound to a hot cluster are throttled without waiting for
+	 * every other zone to be read and evaluated. If the controller didn't
+	 * tell which channel fired, fall back to updating them all.
+	 */
+	for (i = 0; i < thermal->chip->chn_num; i++) {
+		sensor = &thermal->sensors[i];
+		if (pending && !(pending & BIT(sensor->id)))
+			continue;
+
+		thermal_zone_device_update(sensor->tzd,
 					   THERMAL_EVENT_UNSPECIFIED);
+	}
 
 	return IRQ_HANDLED;
 }
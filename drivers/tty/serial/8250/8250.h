@@ -48,9 +48,20 @@ struct uart_8250_dma {
 	size_t			rx_size;
 	size_t			tx_size;
 
+	/*
+	 * Cyclic RX: read position in rx_buf, and the timer pushing data the
+	 * DMA engine has written but no interrupt has reported yet.
+	 */
+	size_t			rx_pos;
+	struct hrtimer		rx_timer;
+	u64			rx_poll_ns;
+	struct uart_8250_port	*rx_port;
+
 	unsigned char		tx_running;
 	unsigned char		tx_err;
 	unsigned char		rx_running;
+	unsigned char		rx_cyclic;	/* set by the port driver */
+	unsigned char		rx_resume;	/* rxchan supports resume */
 };
 
 struct old_serial_port {
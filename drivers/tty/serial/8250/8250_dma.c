@@ -11,6 +11,14 @@
 
 #include "8250.h"
 
+/*
+ * In cyclic RX mode, poll the ring every DMA_RX_POLL_CHARS character times,
+ * backing off up to DMA_RX_POLL_BACKOFF times that while the line is idle.
+ */
+#define DMA_RX_POLL_CHARS	64
+#define DMA_RX_POLL_BACKOFF	16
+#define DMA_RX_POLL_MIN_NS	(100 * NSEC_PER_USEC)
+
 static void __dma_tx_complete(void *param)
 {
 	struct uart_8250_port	*p = param;
@@ -83,6 +91,118 @@ static void dma_rx_complete(void *param)
 	uart_port_unlock_irqrestore(&p->port, flags);
 }
 
+static u64 dma_rx_poll_base(struct uart_8250_port *p)
+{
+	u64 frame_time = READ_ONCE(p->port.frame_time);
+
+	return max_t(u64, frame_time * DMA_RX_POLL_CHARS, DMA_RX_POLL_MIN_NS);
+}
+
+/* Push whatever the DMA engine wrote to the ring since the last call. */
+static unsigned int __dma_rx_cyclic_push(struct uart_8250_port *p)
+{
+	struct uart_8250_dma	*dma = p->dma;
+	struct tty_port		*tty_port = &p->port.state->port;
+	struct dma_tx_state	state;
+	unsigned int		count = 0;
+	size_t			pos;
+
+	dmaengine_tx_status(dma->rxchan, dma->rx_cookie, &state);
+	pos = dma->rx_size - state.residue;
+	if (pos >= dma->rx_size)
+		pos = 0;
+
+	if (pos < dma->rx_pos) {
+		count = dma->rx_size - dma->rx_pos;
+		tty_insert_flip_string(tty_port, dma->rx_buf + dma->rx_pos,
+				       count);
+		dma->rx_pos = 0;
+	}
+
+	if (pos > dma->rx_pos) {
+		tty_insert_flip_string(tty_port, dma->rx_buf + dma->rx_pos,
+				       pos - dma->rx_pos);
+		count += pos - dma->rx_pos;
+		dma->rx_pos = pos;
+	}
+
+	if (count) {
+		p->port.icount.rx += count;
+		tty_flip_buffer_push(tty_port);
+	}
+
+	return count;
+}
+
+static void dma_rx_cyclic_complete(void *param)
+{
+	struct uart_8250_port *p = param;
+	unsigned long flags;
+
+	uart_port_lock_irqsave(&p->port, &flags);
+	if (p->dma->rx_running)
+		__dma_rx_cyclic_push(p);
+	uart_port_unlock_irqrestore(&p->port, flags);
+}
+
+/*
+ * The DMA engine only reports full periods, and the UART raises no RX
+ * timeout once the DMA has emptied its FIFO, so partial periods have to be
+ * picked up by polling.
+ */
+static enum hrtimer_restart dma_rx_cyclic_timer(struct hrtimer *t)
+{
+	struct uart_8250_dma *dma = container_of(t, struct uart_8250_dma, rx_timer);
+	struct uart_8250_port *p = dma->rx_port;
+	enum hrtimer_restart ret = HRTIMER_NORESTART;
+	unsigned long flags;
+	u64 base;
+
+	uart_port_lock_irqsave(&p->port, &flags);
+	if (dma->rx_running) {
+		base = dma_rx_poll_base(p);
+		if (__dma_rx_cyclic_push(p))
+			dma->rx_poll_ns = base;
+		else
+			dma->rx_poll_ns = min(dma->rx_poll_ns * 2,
+					      base * DMA_RX_POLL_BACKOFF);
+
+		hrtimer_forward_now(t, ns_to_ktime(dma->rx_poll_ns));
+		ret = HRTIMER_RESTART;
+	}
+	uart_port_unlock_irqrestore(&p->port, flags);
+
+	return ret;
+}
+
+static int serial8250_rx_dma_cyclic(struct uart_8250_port *p)
+{
+	struct uart_8250_dma		*dma = p->dma;
+	struct dma_async_tx_descriptor	*desc;
+
+	desc = dmaengine_prep_dma_cyclic(dma->rxchan, dma->rx_addr,
+					 dma->rx_size, dma->rx_size / 2,
+					 DMA_DEV_TO_MEM,
+					 DMA_PREP_INTERRUPT | DMA_CTRL_ACK);
+	if (!desc)
+		return -EBUSY;
+
+	dma->rx_running = 1;
+	dma->rx_pos = 0;
+	desc->callback = dma_rx_cyclic_complete;
+	desc->callback_param = p;
+
+	dma->rx_cookie = dmaengine_submit(desc);
+
+	dma_async_issue_pending(dma->rxchan);
+
+	dma->rx_poll_ns = dma_rx_poll_base(p);
+	hrtimer_start(&dma->rx_timer, ns_to_ktime(dma->rx_poll_ns),
+		      HRTIMER_MODE_REL);
+
+	return 0;
+}
+
 int serial8250_tx_dma(struct uart_8250_port *p)
 {
 	struct uart_8250_dma		*dma = p->dma;
@@ -175,6 +295,9 @@ int serial8250_rx_dma(struct uart_8250_port *p)
 
 	serial8250_do_prepare_rx_dma(p);
 
+	if (dma->rx_cyclic)
+		return serial8250_rx_dma_cyclic(p);
+
 	desc = dmaengine_prep_slave_single(dma->rxchan, dma->rx_addr,
 					   dma->rx_size, DMA_DEV_TO_MEM,
 					   DMA_PREP_INTERRUPT | DMA_CTRL_ACK);
@@ -196,7 +319,25 @@ void serial8250_rx_dma_flush(struct uart_8250_port *p)
 {
 	struct uart_8250_dma *dma = p->dma;
 
-	if (dma->rx_running) {
+	if (dma->rx_running && dma->rx_cyclic) {
+		/*
+		 * The bytes left below the DMA burst size are read from the
+		 * FIFO with the ring paused, so they can't be reordered with
+		 * what the DMA engine picks up. Keep the ring running if the
+		 * DMA engine can resume it. Otherwise stop it, the next RX
+		 * interrupt starts a new one once the FIFO has been drained.
+		 */
+		if (!dmaengine_pause(dma->rxchan) && dma->rx_resume) {
+			__dma_rx_cyclic_push(p);
+			serial8250_rx_chars(p, serial_lsr_in(p));
+			if (!dmaengine_resume(dma->rxchan))
+				return;
+		}
+
+		__dma_rx_cyclic_push(p);
+		dmaengine_terminate_async(dma->rxchan);
+		dma->rx_running = 0;
+	} else if (dma->rx_running) {
 		dmaengine_pause(dma->rxchan);
 		__dma_rx_complete(p);
 		dmaengine_terminate_async(dma->rxchan);
@@ -246,6 +387,16 @@ int serial8250_request_dma(struct uart_8250_port *p)
 
 	dmaengine_slave_config(dma->rxchan, &dma->rxconf);
 
+	if (dma->rx_cyclic && !dma_has_cap(DMA_CYCLIC, dma->rxchan->device->cap_mask))
+		dma->rx_cyclic = 0;
+	/* Without resume, e.g. on PL330, the ring is restarted on RX timeouts */
+	dma->rx_resume = caps.cmd_resume;
+	if (dma->rx_cyclic) {
+		hrtimer_setup(&dma->rx_timer, dma_rx_cyclic_timer,
+			      CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+		dma->rx_port = p;
+	}
+
 	/* Get a channel for TX */
 	dma->txchan = dma_request_slave_channel_compat(mask,
 						       dma->fn, dma->tx_param,
@@ -307,7 +458,15 @@ void serial8250_release_dma(struct uart_8250_port *p)
 	if (!dma)
 		return;
 
-	/* Release RX resources */
+	/* Release RX resources, stop the timer before it can see a stale ring */
+	if (dma->rx_cyclic) {
+		unsigned long flags;
+
+		uart_port_lock_irqsave(&p->port, &flags);
+		dma->rx_running = 0;
+		uart_port_unlock_irqrestore(&p->port, flags);
+		hrtimer_cancel(&dma->rx_timer);
+	}
 	dmaengine_terminate_sync(dma->rxchan);
 	dma_free_coherent(dma->rxchan->device->dev, dma->rx_size, dma->rx_buf,
 			  dma->rx_addr);
@@ -662,6 +662,12 @@ static int dw8250_probe(struct platform_device *pdev)
 	if (p->fifosize) {
 		data->data.dma.rxconf.src_maxburst = p->fifosize / 4;
 		data->data.dma.txconf.dst_maxburst = p->fifosize / 4;
+		/*
+		 * Keep RX DMA running across bursts rather than restarting it
+		 * on every RX interrupt. Ports where the UART is the flow
+		 * controller need a block size per transfer, so can't.
+		 */
+		data->data.dma.rx_cyclic = !data->data.dma.rxconf.device_fc;
 		up->dma = &data->data.dma;
 	}
 
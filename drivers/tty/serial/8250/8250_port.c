@@ -1899,7 +1899,8 @@ static bool handle_rx_dma(struct uart_8250_port *up, unsigned int iir)
 	case UART_IIR_RLSI:
 	case UART_IIR_RX_TIMEOUT:
 		serial8250_rx_dma_flush(up);
-		return true;
+		/* A cyclic flush drains the FIFO itself, with the DMA paused. */
+		return !up->dma->rx_cyclic || !up->dma->rx_running;
 	}
 	return up->dma->rx_dma(up);
 }
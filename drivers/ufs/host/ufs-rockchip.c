@@ -6,7 +6,9 @@
  */
 
 #include <linux/clk.h>
+#include <linux/cpumask.h>
 #include <linux/gpio.h>
+#include <linux/interrupt.h>
 #include <linux/mfd/syscon.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
@@ -181,6 +183,38 @@ static int ufs_rockchip_common_init(struct ufs_hba *hba)
 	return 0;
 }
 
+/*
+ * IRQ 0 is the legacy UFSHCI interrupt, the optional following ones are the
+ * per completion queue interrupts. Without them, MCQ completions are still
+ * reported through the legacy interrupt.
+ */
+static void ufs_rockchip_mcq_init_irq(struct ufs_hba *hba)
+{
+	struct ufs_rockchip_host *host = ufshcd_get_variant(hba);
+	struct platform_device *pdev = to_platform_device(hba->dev);
+	int i, irq, nr;
+
+	nr = platform_irq_count(pdev) - 1;
+	if (nr <= 0)
+		return;
+
+	nr = min(nr, UFS_ROCKCHIP_MAX_Q_NR);
+	for (i = 0; i < nr; i++) {
+		irq = platform_get_irq(pdev, i + 1);
+		if (irq < 0)
+			return;
+
+		host->mcq_intr[i].hba = hba;
+		host->mcq_intr[i].irq = irq;
+		host->mcq_intr[i].qid = i;
+	}
+
+	host->mcq_nr_intr = nr;
+
+	/* Completions are reported on the per-queue interrupts only */
+	hba->quirks |= UFSHCD_QUIRK_MCQ_BROKEN_INTR;
+}
+
 static int ufs_rockchip_rk3576_init(struct ufs_hba *hba)
 {
 	struct device *dev = hba->dev;
@@ -196,6 +230,8 @@ static int ufs_rockchip_rk3576_init(struct ufs_hba *hba)
 	hba->caps |= UFSHCD_CAP_CLK_SCALING;
 	/* Enable WriteBooster */
 	hba->caps |= UFSHCD_CAP_WB_EN;
+	/* Enable the standard UFSHCI inline crypto engine, if advertised */
+	hba->caps |= UFSHCD_CAP_CRYPTO;
 
 	/* Set the default desired pm level in case no users set via sysfs */
 	ufs_rockchip_set_pm_lvl(hba);
@@ -204,6 +240,8 @@ static int ufs_rockchip_rk3576_init(struct ufs_hba *hba)
 	if (ret)
 		return dev_err_probe(dev, ret, "ufs common init fail\n");
 
+	ufs_rockchip_mcq_init_irq(hba);
+
 	return 0;
 }
 
@@ -220,12 +258,150 @@ static int ufs_rockchip_device_reset(struct ufs_hba *hba)
 	return 0;
 }
 
+static int ufs_rockchip_get_hba_mac(struct ufs_hba *hba)
+{
+	return UFS_ROCKCHIP_MAX_SUPP_MAC;
+}
+
+static int ufs_rockchip_mcq_config_resource(struct ufs_hba *hba)
+{
+	hba->mcq_base = hba->mmio_base + ufshcd_mcq_queue_cfg_addr(hba);
+
+	return 0;
+}
+
+static int ufs_rockchip_op_runtime_config(struct ufs_hba *hba)
+{
+	static const u32 dao_regs[OPR_MAX] = {
+		[OPR_SQD] = REG_SQDAO,
+		[OPR_SQIS] = REG_SQISAO,
+		[OPR_CQD] = REG_CQDAO,
+		[OPR_CQIS] = REG_CQISAO,
+	};
+	struct ufshcd_mcq_opr_info_t *opr;
+	u32 next;
+	int i;
+
+	/*
+	 * The operation and runtime registers of each queue are located by
+	 * the DAO registers of its configuration block, so derive the stride
+	 * from the first two queues instead of hardcoding the layout.
+	 */
+	for (i = 0; i < OPR_MAX; i++) {
+		opr = &hba->mcq_opr[i];
+		opr->offset = ufsmcq_readl(hba, ufshcd_mcq_cfg_offset(dao_regs[i], 0));
+		if (hba->nr_hw_queues > 1) {
+			next = ufsmcq_readl(hba, ufshcd_mcq_cfg_offset(dao_regs[i], 1));
+			opr->stride = next - opr->offset;
+		}
+		opr->base = hba->mmio_base + opr->offset;
+	}
+
+	return 0;
+}
+
+static irqreturn_t ufs_rockchip_mcq_intr(int irq, void *data)
+{
+	struct ufs_rockchip_mcq_intr *mcq_intr = data;
+	struct ufs_hba *hba = mcq_intr->hba;
+	u32 events;
+
+	events = ufshcd_mcq_read_cqis(hba, mcq_intr->qid);
+	if (!events)
+		return IRQ_NONE;
+
+	ufshcd_mcq_write_cqis(hba, events, mcq_intr->qid);
+
+	if (events & UFSHCD_MCQ_CQIS_TAIL_ENT_PUSH_STS)
+		ufshcd_mcq_poll_cqe_lock(hba, &hba->uhq[mcq_intr->qid]);
+
+	return IRQ_HANDLED;
+}
+
+static void ufs_rockchip_clear_irq_hint(void *data)
+{
+	struct ufs_rockchip_mcq_intr *mcq_intr = data;
+
+	irq_update_affinity_hint(mcq_intr->irq, NULL);
+}
+
+static int ufs_rockchip_config_esi(struct ufs_hba *hba)
+{
+	struct ufs_rockchip_host *host = ufshcd_get_variant(hba);
+	struct ufs_rockchip_mcq_intr *mcq_intr;
+	int i, nr, ret;
+
+	if (!host->mcq_nr_intr)
+		return -EOPNOTSUPP;
+
+	if (host->mcq_intr_requested)
+		return 0;
+
+	/* Poll queues come last and don't need an interrupt */
+	nr = hba->nr_hw_queues - hba->nr_queues[HCTX_TYPE_POLL];
+	if (nr > host->mcq_nr_intr) {
+		dev_warn(hba->dev, "%d MCQ interrupts for %d queues\n",
+			 host->mcq_nr_intr, nr);
+		ret = -EINVAL;
+		goto err_legacy_intr;
+	}
+
+	for (i = 0; i < nr; i++) {
+		mcq_intr = &host->mcq_intr[i];
+		ret = devm_request_irq(hba->dev, mcq_intr->irq,
+				       ufs_rockchip_mcq_intr, 0,
+				       dev_name(hba->dev), mcq_intr);
+		if (ret) {
+			dev_err(hba->dev, "failed to request MCQ irq %d: %d\n",
+				mcq_intr->irq, ret);
+			goto err_free_intr;
+		}
+
+		/*
+		 * blk-mq spreads the CPUs evenly over the hardware queues,
+		 * keep the completion interrupt on a CPU submitting to it.
+		 */
+		irq_set_affinity_and_hint(mcq_intr->irq,
+					  cpumask_of(cpumask_local_spread(i, NUMA_NO_NODE)));
+
+		/* Runs before the devm free_irq(), which wants the hint gone */
+		ret = devm_add_action_or_reset(hba->dev,
+					       ufs_rockchip_clear_irq_hint,
+					       mcq_intr);
+		if (ret) {
+			devm_free_irq(hba->dev, mcq_intr->irq, mcq_intr);
+			goto err_free_intr;
+		}
+	}
+
+	host->mcq_intr_requested = true;
+
+	return 0;
+
+err_free_intr:
+	/* Don't leave them held, the next reset would get -EBUSY */
+	while (i--) {
+		mcq_intr = &host->mcq_intr[i];
+		devm_release_action(hba->dev, ufs_rockchip_clear_irq_hint,
+				    mcq_intr);
+		devm_free_irq(hba->dev, mcq_intr->irq, mcq_intr);
+	}
+err_legacy_intr:
+	/* Let the legacy interrupt handle the completions instead */
+	hba->quirks &= ~UFSHCD_QUIRK_MCQ_BROKEN_INTR;
+	return ret;
+}
+
 static const struct ufs_hba_variant_ops ufs_hba_rk3576_vops = {
 	.name = "rk3576",
 	.init = ufs_rockchip_rk3576_init,
 	.device_reset = ufs_rockchip_device_reset,
 	.hce_enable_notify = ufs_rockchip_hce_enable_notify,
 	.phy_initialization = ufs_rockchip_rk3576_phy_init,
+	.get_hba_mac = ufs_rockchip_get_hba_mac,
+	.mcq_config_resource = ufs_rockchip_mcq_config_resource,
+	.op_runtime_config = ufs_rockchip_op_runtime_config,
+	.config_esi = ufs_rockchip_config_esi,
 };
 
 static const struct of_device_id ufs_rockchip_of_match[] = {
@@ -64,6 +64,15 @@
 #define MIB_T_DBG_CPORT_TX_ENDIAN       0xc022
 #define MIB_T_DBG_CPORT_RX_ENDIAN       0xc023
 
+#define UFS_ROCKCHIP_MAX_SUPP_MAC       64
+#define UFS_ROCKCHIP_MAX_Q_NR           8
+
+struct ufs_rockchip_mcq_intr {
+	struct ufs_hba *hba;
+	int irq;
+	int qid;
+};
+
 struct ufs_rockchip_host {
 	struct ufs_hba *hba;
 	void __iomem *ufs_phy_ctrl;
@@ -74,6 +83,9 @@ struct ufs_rockchip_host {
 	struct clk *ref_out_clk;
 	struct clk_bulk_data *clks;
 	uint64_t caps;
+	int mcq_nr_intr;
+	bool mcq_intr_requested;
+	struct ufs_rockchip_mcq_intr mcq_intr[UFS_ROCKCHIP_MAX_Q_NR];
 };
 
 #define ufs_sys_writel(base, val, reg)                                    \
@@ -1699,6 +1699,7 @@ static void dwc3_get_properties(struct dwc3 *dwc)
 	u8			tx_thr_num_pkt_prd = 0;
 	u8			tx_max_burst_prd = 0;
 	u8			tx_fifo_resize_max_num;
+	u32			imod_interval_ns = 0;
 
 	/* default to highest possible threshold */
 	lpm_nyet_threshold = 0xf;
@@ -1826,6 +1827,10 @@ static void dwc3_get_properties(struct dwc3 *dwc)
 				 &dwc->fladj);
 	device_property_read_u32(dev, "snps,ref-clock-period-ns",
 				 &dwc->ref_clk_per);
+	device_property_read_u32(dev, "snps,imod-interval-ns",
+				 &imod_interval_ns);
+	dwc->imod_interval = min_t(u32, DIV_ROUND_UP(imod_interval_ns, 250),
+				   DWC3_DEV_IMOD_INTERVAL_MASK);
 
 	dwc->dis_metastability_quirk = device_property_read_bool(dev,
 				"snps,dis_metastability_quirk");
@@ -1868,7 +1873,8 @@ static void dwc3_check_params(struct dwc3 *dwc)
 		DWC3_GHWPARAMS3_SSPHY_IFC(dwc->hwparams.hwparams3);
 
 	/*
-	 * Enable IMOD for all supporting controllers.
+	 * Enable IMOD for all supporting controllers, using the interval
+	 * from "snps,imod-interval-ns" if one was given.
 	 *
 	 * Particularly, DWC_usb3 v3.00a must enable this feature for
 	 * the following reason:
@@ -1879,7 +1885,9 @@ static void dwc3_check_params(struct dwc3 *dwc)
 	 * allows us to work around this issue. Enable it for the
 	 * affected version.
 	 */
-	if (dwc3_has_imod((dwc)))
+	if (!dwc3_has_imod(dwc))
+		dwc->imod_interval = 0;
+	else if (!dwc->imod_interval)
 		dwc->imod_interval = 1;
 
 	/* Check the maximum_speed parameter */
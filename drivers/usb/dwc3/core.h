@@ -741,6 +741,8 @@ struct dwc3_event_buffer {
  *		isochronous START TRANSFER command failure workaround
  * @start_cmd_status: the status of testing START TRANSFER command with
  *		combo_num = 'b00
+ * @xfer_requests: number of requests given back on this endpoint
+ * @xfer_bytes: number of bytes transferred by the requests given back
  */
 struct dwc3_ep {
 	struct usb_ep		endpoint;
@@ -802,6 +804,9 @@ struct dwc3_ep {
 	/* For isochronous START TRANSFER workaround only */
 	u8			combo_num;
 	int			start_cmd_status;
+
+	u64			xfer_requests;
+	u64			xfer_bytes;
 };
 
 enum dwc3_phy {
@@ -678,6 +678,71 @@ static const struct file_operations dwc3_link_state_fops = {
 	.release		= single_release,
 };
 
+static int dwc3_imod_interval_show(struct seq_file *s, void *unused)
+{
+	struct dwc3		*dwc = s->private;
+
+	seq_printf(s, "%u\n", READ_ONCE(dwc->imod_interval) * 250);
+
+	return 0;
+}
+
+static int dwc3_imod_interval_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dwc3_imod_interval_show, inode->i_private);
+}
+
+static ssize_t dwc3_imod_interval_write(struct file *file,
+		const char __user *ubuf, size_t count, loff_t *ppos)
+{
+	struct seq_file		*s = file->private_data;
+	struct dwc3		*dwc = s->private;
+	unsigned long		flags;
+	u32			interval;
+	u32			reg;
+	int			ret;
+
+	if (!dwc3_has_imod(dwc))
+		return -EOPNOTSUPP;
+
+	ret = kstrtou32_from_user(ubuf, count, 0, &interval);
+	if (ret)
+		return ret;
+
+	interval = DIV_ROUND_UP(interval, 250);
+	if (interval > DWC3_DEV_IMOD_INTERVAL_MASK)
+		return -EINVAL;
+
+	/* DWC_usb3 v3.00a relies on IMOD, see dwc3_check_params() */
+	if (!interval && DWC3_VER_IS(DWC3, 300A))
+		return -EINVAL;
+
+	ret = pm_runtime_resume_and_get(dwc->dev);
+	if (ret < 0)
+		return ret;
+
+	spin_lock_irqsave(&dwc->lock, flags);
+	dwc->imod_interval = interval;
+
+	/* Otherwise this is picked up by the next gadget start */
+	reg = dwc3_readl(dwc->regs, DWC3_GSTS);
+	if (DWC3_GSTS_CURMOD(reg) == DWC3_GSTS_CURMOD_DEVICE)
+		dwc3_writel(dwc->regs, DWC3_DEV_IMOD(0), interval);
+	spin_unlock_irqrestore(&dwc->lock, flags);
+
+	pm_runtime_put_sync(dwc->dev);
+
+	return count;
+}
+
+static const struct file_operations dwc3_imod_interval_fops = {
+	.open			= dwc3_imod_interval_open,
+	.write			= dwc3_imod_interval_write,
+	.read			= seq_read,
+	.llseek			= seq_lseek,
+	.release		= single_release,
+};
+
 struct dwc3_ep_file_map {
 	const char name[25];
 	const struct file_operations *const fops;
@@ -886,6 +951,20 @@ static int dwc3_transfer_type_show(struct seq_file *s, void *unused)
 	return 0;
 }
 
+static int dwc3_transfer_stats_show(struct seq_file *s, void *unused)
+{
+	struct dwc3_ep		*dep = s->private;
+	struct dwc3		*dwc = dep->dwc;
+	unsigned long		flags;
+
+	spin_lock_irqsave(&dwc->lock, flags);
+	seq_printf(s, "requests: %llu\n", dep->xfer_requests);
+	seq_printf(s, "bytes: %llu\n", dep->xfer_bytes);
+	spin_unlock_irqrestore(&dwc->lock, flags);
+
+	return 0;
+}
+
 static int dwc3_trb_ring_show(struct seq_file *s, void *unused)
 {
 	struct dwc3_ep		*dep = s->private;
@@ -970,6 +1049,7 @@ DEFINE_SHOW_ATTRIBUTE(dwc3_rx_info_queue);
 DEFINE_SHOW_ATTRIBUTE(dwc3_descriptor_fetch_queue);
 DEFINE_SHOW_ATTRIBUTE(dwc3_event_queue);
 DEFINE_SHOW_ATTRIBUTE(dwc3_transfer_type);
+DEFINE_SHOW_ATTRIBUTE(dwc3_transfer_stats);
 DEFINE_SHOW_ATTRIBUTE(dwc3_trb_ring);
 DEFINE_SHOW_ATTRIBUTE(dwc3_ep_info_register);
 
@@ -982,6 +1062,7 @@ static const struct dwc3_ep_file_map dwc3_ep_file_map[] = {
 	{ "descriptor_fetch_queue", &dwc3_descriptor_fetch_queue_fops, },
 	{ "event_queue", &dwc3_event_queue_fops, },
 	{ "transfer_type", &dwc3_transfer_type_fops, },
+	{ "transfer_stats", &dwc3_transfer_stats_fops, },
 	{ "trb_ring", &dwc3_trb_ring_fops, },
 	{ "GDBGEPINFO", &dwc3_ep_info_register_fops, },
 };
@@ -1035,6 +1116,8 @@ void dwc3_debugfs_init(struct dwc3 *dwc)
 				&dwc3_testmode_fops);
 		debugfs_create_file("link_state", 0644, root, dwc,
 				    &dwc3_link_state_fops);
+		debugfs_create_file("imod_interval", 0644, root, dwc,
+				    &dwc3_imod_interval_fops);
 	}
 }
 
@@ -73,6 +73,7 @@ struct f_ncm {
 	struct sk_buff			*skb_tx_data;
 	struct sk_buff			*skb_tx_ndp;
 	u16				ndp_dgram_count;
+	u16				ndp_dgram_max;
 	struct hrtimer			task_timer;
 };
 
@@ -92,14 +93,23 @@ static inline struct f_ncm *func_to_ncm(struct usb_function *f)
 #define NTB_DEFAULT_IN_SIZE	16384
 #define NTB_OUT_SIZE		16384
 
+/*
+ * At SuperSpeed and above the per-transfer overhead of 16K NTBs adds up, so
+ * let the host negotiate bigger ones there. Stay below the 64K NTB16 block
+ * length limit and keep the per-NTB atomic allocations reasonable.
+ */
+#define NTB_SS_MAX_SIZE		32768
+
 /* Allocation for storing the NDP, 32 should suffice for a
  * 16k packet. This allows a maximum of 32 * 507 Byte packets to
  * be transmitted in a single 16kB skb, though when sending full size
  * packets this limit will be plenty.
  * Smaller packets are not likely to be trying to maximize the
  * throughput and will be mstly sending smaller infrequent frames.
+ * Bigger NTBs get proportionally more entries.
  */
 #define TX_MAX_NUM_DPE		32
+#define TX_BYTES_PER_DPE	(NTB_DEFAULT_IN_SIZE / TX_MAX_NUM_DPE)
 
 /* Delay for the transmit to wait before sending an unfilled NTB frame. */
 #define TX_TIMEOUT_NSECS	300000
@@ -515,6 +525,20 @@ static inline unsigned get_ncm(__le16 **p, unsigned size)
 
 /*-------------------------------------------------------------------------*/
 
+static u32 ncm_ntb_in_max(struct usb_gadget *gadget)
+{
+	if (gadget->speed >= USB_SPEED_SUPER)
+		return NTB_SS_MAX_SIZE;
+	return le32_to_cpu(ntb_parameters.dwNtbInMaxSize);
+}
+
+static u32 ncm_ntb_out_max(struct usb_gadget *gadget)
+{
+	if (gadget->speed >= USB_SPEED_SUPER)
+		return NTB_SS_MAX_SIZE;
+	return le32_to_cpu(ntb_parameters.dwNtbOutMaxSize);
+}
+
 static inline void ncm_reset_values(struct f_ncm *ncm)
 {
 	ncm->parser_opts = &ndp16_opts;
@@ -660,7 +684,7 @@ static void ncm_ep0out_complete(struct usb_ep *ep, struct usb_request *req)
 
 	in_size = get_unaligned_le32(req->buf);
 	if (in_size < USB_CDC_NCM_NTB_MIN_IN_SIZE ||
-	    in_size > le32_to_cpu(ntb_parameters.dwNtbInMaxSize)) {
+	    in_size > ncm_ntb_in_max(cdev->gadget)) {
 		DBG(cdev, "Got wrong INPUT SIZE (%d) from host\n", in_size);
 		goto invalid;
 	}
@@ -718,14 +742,19 @@ static int ncm_setup(struct usb_function *f, const struct usb_ctrlrequest *ctrl)
 
 	case ((USB_DIR_IN | USB_TYPE_CLASS | USB_RECIP_INTERFACE) << 8)
 		| USB_CDC_GET_NTB_PARAMETERS:
+	{
+		struct usb_cdc_ncm_ntb_parameters params = ntb_parameters;
 
 		if (w_length == 0 || w_value != 0 || w_index != ncm->ctrl_id)
 			goto invalid;
-		value = w_length > sizeof ntb_parameters ?
-			sizeof ntb_parameters : w_length;
-		memcpy(req->buf, &ntb_parameters, value);
+		params.dwNtbInMaxSize = cpu_to_le32(ncm_ntb_in_max(cdev->gadget));
+		params.dwNtbOutMaxSize = cpu_to_le32(ncm_ntb_out_max(cdev->gadget));
+		value = w_length > sizeof params ?
+			sizeof params : w_length;
+		memcpy(req->buf, &params, value);
 		VDBG(cdev, "Host asked NTB parameters\n");
 		break;
+	}
 
 	case ((USB_DIR_IN | USB_TYPE_CLASS | USB_RECIP_INTERFACE) << 8)
 		| USB_CDC_GET_NTB_INPUT_SIZE:
@@ -913,6 +942,7 @@ static int ncm_set_alt(struct usb_function *f, unsigned intf, unsigned alt)
 			ncm->port.is_zlp_ok =
 				gadget_is_zlp_supported(cdev->gadget);
 			ncm->port.cdc_filter = DEFAULT_FILTER;
+			ncm->port.fixed_out_len = ncm_ntb_out_max(cdev->gadget);
 			DBG(cdev, "activate ncm\n");
 			net = gether_connect(&ncm->port);
 			if (IS_ERR(net))
@@ -1038,7 +1068,7 @@ static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 		 * NOTE: Assume maximum align for speed of calculation.
 		 */
 		if (ncm->skb_tx_data
-		    && (ncm->ndp_dgram_count >= TX_MAX_NUM_DPE
+		    && (ncm->ndp_dgram_count >= ncm->ndp_dgram_max
 		    || (ncm->skb_tx_data->len +
 		    div + rem + skb->len +
 		    ncm->skb_tx_ndp->len + ndp_align + (2 * dgram_idx_len))
@@ -1070,9 +1100,11 @@ static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 			 * TX_MAX_NUM_DPE should easily suffice for a
 			 * 16k packet.
 			 */
+			ncm->ndp_dgram_max = max_t(u16, TX_MAX_NUM_DPE,
+						   max_size / TX_BYTES_PER_DPE);
 			ncm->skb_tx_ndp = alloc_skb((int)(opts->ndp_size
 						    + opts->dpe_size
-						    * TX_MAX_NUM_DPE),
+						    * ncm->ndp_dgram_max),
 						    GFP_ATOMIC);
 			if (!ncm->skb_tx_ndp)
 				goto err;
@@ -1113,6 +1145,19 @@ static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 		dev_consume_skb_any(skb);
 		skb = NULL;
 
+		/*
+		 * Only hold datagrams back while earlier NTBs are still in
+		 * flight: their completion is what lets the next NTB go out,
+		 * so waiting for more data costs nothing. With the IN
+		 * endpoint idle, send right away instead of waiting for the
+		 * timer.
+		 */
+		if (!skb2 && !gether_tx_pending(port)) {
+			skb2 = package_for_tx(ncm);
+			if (!skb2)
+				goto err;
+		}
+
 	} else if (ncm->skb_tx_data) {
 		/* If we get here ncm_wrap_ntb() was called with NULL skb,
 		 * because eth_start_xmit() was called with NULL skb by
@@ -1175,7 +1220,7 @@ static int ncm_unwrap_ntb(struct gether *port,
 	unsigned	block_len;
 	struct sk_buff	*skb2;
 	int		ret = -EINVAL;
-	unsigned	ntb_max = le32_to_cpu(ntb_parameters.dwNtbOutMaxSize);
+	unsigned	ntb_max = port->fixed_out_len;
 	unsigned	frame_max;
 	const struct ndp_parser_opts *opts = ncm->parser_opts;
 	unsigned	crc_len = ncm->is_crc ? sizeof(uint32_t) : 0;
@@ -1078,6 +1078,17 @@ void gether_resume(struct gether *link)
 }
 EXPORT_SYMBOL_GPL(gether_resume);
 
+unsigned int gether_tx_pending(struct gether *link)
+{
+	struct eth_dev *dev = link->ioport;
+
+	if (!dev)
+		return 0;
+
+	return atomic_read(&dev->tx_qlen);
+}
+EXPORT_SYMBOL_GPL(gether_tx_pending);
+
 /*
  * gether_cleanup - remove Ethernet-over-USB device
  * Context: may sleep
@@ -262,6 +262,15 @@ void gether_cleanup(struct eth_dev *dev);
 void gether_suspend(struct gether *link);
 void gether_resume(struct gether *link);
 
+/**
+ * gether_tx_pending - count IN transfers not yet completed
+ * @link: the USB link
+ *
+ * Framing functions that aggregate frames use this to tell whether the
+ * IN endpoint is idle, in which case there's no point in holding data back.
+ */
+unsigned int gether_tx_pending(struct gether *link);
+
 /* connect/disconnect is handled by individual functions */
 struct net_device *gether_connect(struct gether *);
 void gether_disconnect(struct gether *);
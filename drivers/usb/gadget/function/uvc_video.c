@@ -130,6 +130,81 @@ uvc_video_encode_bulk(struct usb_request *req, struct uvc_video *video,
 		video->payload_size = 0;
 }
 
+static void
+uvc_video_encode_bulk_sg(struct usb_request *req, struct uvc_video *video,
+		struct uvc_buffer *buf)
+{
+	unsigned int pending = buf->bytesused - video->queue.buf_used;
+	struct uvc_request *ureq = req->context;
+	struct scatterlist *sg = ureq->sgt.sgl;
+	unsigned int len = video->req_size;
+	unsigned int header_len = 0;
+	unsigned int sg_left, part;
+	unsigned int nsgs = 0;
+
+	sg_init_table(sg, ureq->sgt.nents);
+
+	/* Add a header at the beginning of the payload. */
+	if (video->payload_size == 0) {
+		header_len = uvc_video_encode_header(video, buf, ureq->header,
+						     len);
+		sg_set_buf(sg, ureq->header, header_len);
+		sg = sg_next(sg);
+		nsgs++;
+
+		video->payload_size += header_len;
+		len -= header_len;
+	}
+
+	/* Point the remaining sgs at the video data instead of copying it. */
+	len = min3(len, video->max_payload_size - video->payload_size, pending);
+	req->length = header_len + len;
+
+	while (len && buf->sg && nsgs < ureq->sgt.nents) {
+		sg_left = buf->sg->length - buf->offset;
+		part = min_t(unsigned int, len, sg_left);
+
+		sg_set_page(sg, sg_page(buf->sg), part,
+			    buf->sg->offset + buf->offset);
+
+		if (part == sg_left) {
+			buf->offset = 0;
+			buf->sg = sg_next(buf->sg);
+		} else {
+			buf->offset += part;
+		}
+		len -= part;
+
+		sg = sg_next(sg);
+		nsgs++;
+	}
+
+	/* Assign the video data with header. */
+	req->buf = NULL;
+	req->sg	= ureq->sgt.sgl;
+	req->num_sgs = nsgs;
+
+	req->length -= len;
+	video->payload_size += req->length - header_len;
+	video->queue.buf_used += req->length - header_len;
+	req->zero = video->payload_size == video->max_payload_size;
+
+	if (buf->bytesused == video->queue.buf_used || !buf->sg) {
+		video->queue.buf_used = 0;
+		buf->state = UVC_BUF_STATE_DONE;
+		buf->offset = 0;
+		list_del(&buf->queue);
+		video->fid ^= UVC_STREAM_FID;
+		ureq->last_buf = buf;
+
+		video->payload_size = 0;
+	}
+
+	if (video->payload_size == video->max_payload_size ||
+	    video->queue.flags & UVC_QUEUE_DROP_INCOMPLETE)
+		video->payload_size = 0;
+}
+
 static void
 uvc_video_encode_isoc_sg(struct usb_request *req, struct uvc_video *video,
 		struct uvc_buffer *buf)
@@ -784,7 +859,8 @@ int uvcg_video_enable(struct uvc_video *video)
 		return ret;
 
 	if (video->max_payload_size) {
-		video->encode = uvc_video_encode_bulk;
+		video->encode = video->queue.use_sg ?
+			uvc_video_encode_bulk_sg : uvc_video_encode_bulk;
 		video->payload_size = 0;
 	} else
 		video->encode = video->queue.use_sg ?
@@ -15,8 +15,30 @@ static unsigned int z_erofs_zstd_nstrms, z_erofs_zstd_avail_strms;
 static struct z_erofs_zstd *z_erofs_zstd_head;
 static DECLARE_WAIT_QUEUE_HEAD(z_erofs_zstd_wq);
 
+/*
+ * Each CPU caches the last stream it released so that the common case
+ * neither takes `z_erofs_zstd_lock` nor bounces the list head between CPUs.
+ * The cached streams still belong to the pool and are flushed back to the
+ * global list whenever all streams need to be isolated.
+ */
+static struct z_erofs_zstd * __percpu *z_erofs_zstd_pcpu;
+static bool z_erofs_zstd_draining;
+
 module_param_named(zstd_streams, z_erofs_zstd_nstrms, uint, 0444);
 
+static struct z_erofs_zstd *z_erofs_zstd_steal_pcpu(void)
+{
+	struct z_erofs_zstd *strm;
+	unsigned int cpu;
+
+	for_each_possible_cpu(cpu) {
+		strm = xchg(per_cpu_ptr(z_erofs_zstd_pcpu, cpu), NULL);
+		if (strm)
+			return strm;
+	}
+	return NULL;
+}
+
 static struct z_erofs_zstd *z_erofs_isolate_strms(bool all)
 {
 	struct z_erofs_zstd *strm;
@@ -26,7 +48,11 @@ static struct z_erofs_zstd *z_erofs_isolate_strms(bool all)
 	strm = z_erofs_zstd_head;
 	if (!strm) {
 		spin_unlock(&z_erofs_zstd_lock);
-		wait_event(z_erofs_zstd_wq, READ_ONCE(z_erofs_zstd_head));
+		/* idle streams may still be cached on other CPUs */
+		wait_event(z_erofs_zstd_wq, READ_ONCE(z_erofs_zstd_head) ||
+			   (!all && (strm = z_erofs_zstd_steal_pcpu())));
+		if (strm)
+			return strm;
 		goto again;
 	}
 	z_erofs_zstd_head = all ? NULL : strm->next;
@@ -34,8 +60,58 @@ static struct z_erofs_zstd *z_erofs_isolate_strms(bool all)
 	return strm;
 }
 
+static void z_erofs_zstd_push_strm(struct z_erofs_zstd *strm)
+{
+	spin_lock(&z_erofs_zstd_lock);
+	strm->next = z_erofs_zstd_head;
+	z_erofs_zstd_head = strm;
+	spin_unlock(&z_erofs_zstd_lock);
+	wake_up(&z_erofs_zstd_wq);
+}
+
+static struct z_erofs_zstd *z_erofs_zstd_get_strm(void)
+{
+	struct z_erofs_zstd *strm = this_cpu_xchg(*z_erofs_zstd_pcpu, NULL);
+
+	return strm ?: z_erofs_isolate_strms(false);
+}
+
+static void z_erofs_zstd_put_strm(struct z_erofs_zstd *strm)
+{
+	if (READ_ONCE(z_erofs_zstd_draining) ||
+	    this_cpu_cmpxchg(*z_erofs_zstd_pcpu, NULL, strm)) {
+		z_erofs_zstd_push_strm(strm);
+		return;
+	}
+	/*
+	 * Don't leave the stream cached if someone started waiting for or
+	 * isolating streams meanwhile.  Pairs with the barrier in wait_event()
+	 * and the one in z_erofs_zstd_drain_pcpu().
+	 */
+	smp_mb();
+	if (READ_ONCE(z_erofs_zstd_draining) ||
+	    waitqueue_active(&z_erofs_zstd_wq)) {
+		strm = this_cpu_xchg(*z_erofs_zstd_pcpu, NULL);
+		if (strm)
+			z_erofs_zstd_push_strm(strm);
+	}
+}
+
+/* flush all per-CPU cached streams back to the global list */
+static void z_erofs_zstd_drain_pcpu(void)
+{
+	struct z_erofs_zstd *strm;
+
+	WRITE_ONCE(z_erofs_zstd_draining, true);
+	smp_mb();
+	while ((strm = z_erofs_zstd_steal_pcpu()))
+		z_erofs_zstd_push_strm(strm);
+}
+
 static void z_erofs_zstd_exit(void)
 {
+	if (z_erofs_zstd_pcpu)
+		z_erofs_zstd_drain_pcpu();
 	while (z_erofs_zstd_avail_strms) {
 		struct z_erofs_zstd *strm, *n;
 
@@ -47,6 +123,8 @@ static void z_erofs_zstd_exit(void)
 			--z_erofs_zstd_avail_strms;
 		}
 	}
+	free_percpu(z_erofs_zstd_pcpu);
+	z_erofs_zstd_pcpu = NULL;
 }
 
 static int __init z_erofs_zstd_init(void)
@@ -55,6 +133,10 @@ static int __init z_erofs_zstd_init(void)
 	if (!z_erofs_zstd_nstrms)
 		z_erofs_zstd_nstrms = num_possible_cpus();
 
+	z_erofs_zstd_pcpu = alloc_percpu(struct z_erofs_zstd *);
+	if (!z_erofs_zstd_pcpu)
+		return -ENOMEM;
+
 	for (; z_erofs_zstd_avail_strms < z_erofs_zstd_nstrms;
 	     ++z_erofs_zstd_avail_strms) {
 		struct z_erofs_zstd *strm;
@@ -100,6 +182,7 @@ static int z_erofs_load_zstd_config(struct super_block *sb,
 	}
 
 	/* 1. collect/isolate all streams for the following check */
+	z_erofs_zstd_drain_pcpu();
 	while (z_erofs_zstd_avail_strms) {
 		struct z_erofs_zstd *n;
 
@@ -128,6 +211,7 @@ static int z_erofs_load_zstd_config(struct super_block *sb,
 	z_erofs_zstd_head = head;
 	spin_unlock(&z_erofs_zstd_lock);
 	z_erofs_zstd_avail_strms = z_erofs_zstd_nstrms;
+	WRITE_ONCE(z_erofs_zstd_draining, false);
 	wake_up_all(&z_erofs_zstd_wq);
 	if (!strm)
 		z_erofs_zstd_max_dictsize = dict_size;
@@ -156,7 +240,7 @@ static int z_erofs_zstd_decompress(struct z_erofs_decompress_req *rq,
 	}
 
 	/* 2. get an available ZSTD context */
-	strm = z_erofs_isolate_strms(false);
+	strm = z_erofs_zstd_get_strm();
 
 	/* 3. multi-call decompress */
 	stream = zstd_init_dstream(z_erofs_zstd_max_dictsize, strm->wksp, strm->wkspsz);
@@ -201,12 +285,8 @@ static int z_erofs_zstd_decompress(struct z_erofs_decompress_req *rq,
 		kunmap_local(dctx.kout);
 failed_zinit:
 	kunmap_local(dctx.kin);
-	/* 4. push back ZSTD stream context to the global list */
-	spin_lock(&z_erofs_zstd_lock);
-	strm->next = z_erofs_zstd_head;
-	z_erofs_zstd_head = strm;
-	spin_unlock(&z_erofs_zstd_lock);
-	wake_up(&z_erofs_zstd_wq);
+	/* 4. cache ZSTD stream context on this CPU or push it back */
+	z_erofs_zstd_put_strm(strm);
 	return err;
 }
 
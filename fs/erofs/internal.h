@@ -63,6 +63,8 @@ struct erofs_mount_opts {
 	unsigned int sync_decompress;
 	/* threshold for decompression synchronously */
 	unsigned int max_sync_decompress_pages;
+	/* move async decompression of queues this large (in KiB) to big CPUs */
+	unsigned int big_cpu_decompress_kb;
 	unsigned int mount_opt;
 };
 
@@ -7,6 +7,7 @@
 #include "compress.h"
 #include <linux/psi.h>
 #include <linux/cpuhotplug.h>
+#include <linux/sched/topology.h>
 #include <trace/events/erofs.h>
 
 #define Z_EROFS_PCLUSTER_MAX_PAGES	(Z_EROFS_PCLUSTER_MAX_SIZE / PAGE_SIZE)
@@ -99,6 +100,8 @@ struct z_erofs_decompressqueue {
 		struct work_struct work;
 		struct kthread_work kthread_work;
 	} u;
+	/* compressed bytes read from the device for this queue */
+	unsigned int insize;
 	bool eio, sync;
 };
 
@@ -333,6 +336,47 @@ static int erofs_init_percpu_workers(void)
 	}
 	return 0;
 }
+
+static int z_erofs_last_big_cpu;
+
+/*
+ * On asymmetric CPU capacity systems, decompressing a large queue on the
+ * little core that happened to complete the I/O is much slower than moving
+ * it to a big core.  Distribute such queues round-robin across the online
+ * CPUs of the highest capacity if the current CPU is not one of them.
+ */
+static struct kthread_worker *z_erofs_pick_worker(
+				struct z_erofs_decompressqueue *io)
+{
+	struct erofs_sb_info *const sbi = EROFS_SB(io->sb);
+	unsigned int kb = READ_ONCE(sbi->opt.big_cpu_decompress_kb);
+	int cpu = raw_smp_processor_id();
+	unsigned long cap, best_cap;
+	struct kthread_worker *worker;
+	int i, best, start;
+
+	best = cpu;
+	best_cap = arch_scale_cpu_capacity(cpu);
+	if (kb && (io->insize >> 10) >= kb &&
+	    best_cap < SCHED_CAPACITY_SCALE) {
+		start = (READ_ONCE(z_erofs_last_big_cpu) + 1) % nr_cpu_ids;
+		for_each_cpu_wrap(i, cpu_online_mask, start) {
+			cap = arch_scale_cpu_capacity(i);
+			if (cap <= best_cap)
+				continue;
+			best = i;
+			best_cap = cap;
+			if (cap >= SCHED_CAPACITY_SCALE)
+				break;
+		}
+		WRITE_ONCE(z_erofs_last_big_cpu, best);
+	}
+
+	worker = rcu_dereference(z_erofs_pcpu_workers[best]);
+	if (!worker && best != cpu)
+		worker = rcu_dereference(z_erofs_pcpu_workers[cpu]);
+	return worker;
+}
 #else
 static inline void erofs_destroy_percpu_workers(void) {}
 static inline int erofs_init_percpu_workers(void) { return 0; }
@@ -1419,8 +1463,7 @@ static void z_erofs_decompress_kickoff(struct z_erofs_decompressqueue *io,
 		struct kthread_worker *worker;
 
 		rcu_read_lock();
-		worker = rcu_dereference(
-				z_erofs_pcpu_workers[raw_smp_processor_id()]);
+		worker = z_erofs_pick_worker(io);
 		if (!worker) {
 			INIT_WORK(&io->u.work, z_erofs_decompressqueue_work);
 			queue_work(z_erofs_workqueue, &io->u.work);
@@ -1565,6 +1608,7 @@ static struct z_erofs_decompressqueue *jobqueue_init(struct super_block *sb,
 		q = fgq;
 		init_completion(&fgq->u.done);
 		atomic_set(&fgq->pending_bios, 0);
+		q->insize = 0;
 		q->eio = false;
 		q->sync = true;
 	}
@@ -1721,9 +1765,10 @@ static void z_erofs_submit_queue(struct z_erofs_frontend *f,
 			bypass = false;
 		} while ((cur += bvec.bv_len) < end);
 
-		if (!bypass)
+		if (!bypass) {
 			qtail[JQ_SUBMIT] = &pcl->next;
-		else
+			q[JQ_SUBMIT]->insize += pcl->pclustersize;
+		} else
 			z_erofs_move_to_bypass_queue(pcl, next, qtail);
 	} while (next != Z_EROFS_PCLUSTER_TAIL);
 
@@ -26,6 +26,34 @@
 /*
  *  Allocation Bitmap Management Functions
  */
+static unsigned int exfat_bitmap_sector_bits(struct super_block *sb,
+		unsigned int map_i)
+{
+	unsigned int total_clus = EXFAT_DATA_CLUSTER_COUNT(EXFAT_SB(sb));
+	unsigned int bits_per_sector = sb->s_blocksize * BITS_PER_BYTE;
+
+	return min(total_clus - map_i * bits_per_sector, bits_per_sector);
+}
+
+static unsigned int exfat_count_free_in_sector(struct super_block *sb,
+		unsigned int map_i)
+{
+	struct exfat_sb_info *sbi = EXFAT_SB(sb);
+	unsigned int nbits = exfat_bitmap_sector_bits(sb, map_i);
+	unsigned int last_mask = nbits & (BITS_PER_LONG - 1);
+	unsigned long *bitmap = (void *)sbi->vol_amap[map_i]->b_data;
+	unsigned int i, used = 0;
+
+	for (i = 0; i < nbits / BITS_PER_LONG; i++)
+		used += hweight_long(bitmap[i]);
+
+	if (last_mask)
+		used += hweight_long(lel_to_cpu(((__le_long *)bitmap)[i]) &
+				     BITMAP_LAST_WORD_MASK(last_mask));
+
+	return nbits - used;
+}
+
 static int exfat_allocate_bitmap(struct super_block *sb,
 		struct exfat_dentry *ep)
 {
@@ -55,6 +83,14 @@ static int exfat_allocate_bitmap(struct super_block *sb,
 	if (!sbi->vol_amap)
 		return -ENOMEM;
 
+	sbi->vol_amap_free = kvcalloc(sbi->map_sectors, sizeof(unsigned int),
+				      GFP_KERNEL);
+	if (!sbi->vol_amap_free) {
+		kvfree(sbi->vol_amap);
+		sbi->vol_amap = NULL;
+		return -ENOMEM;
+	}
+
 	sector = exfat_cluster_to_sector(sbi, sbi->map_clu);
 	for (i = 0; i < sbi->map_sectors; i++) {
 		sbi->vol_amap[i] = sb_bread(sb, sector + i);
@@ -65,10 +101,13 @@ static int exfat_allocate_bitmap(struct super_block *sb,
 			while (j < i)
 				brelse(sbi->vol_amap[j++]);
 
+			kvfree(sbi->vol_amap_free);
+			sbi->vol_amap_free = NULL;
 			kvfree(sbi->vol_amap);
 			sbi->vol_amap = NULL;
 			return -EIO;
 		}
+		sbi->vol_amap_free[i] = exfat_count_free_in_sector(sb, i);
 	}
 
 	return 0;
@@ -119,6 +158,7 @@ void exfat_free_bitmap(struct exfat_sb_info *sbi)
 	for (i = 0; i < sbi->map_sectors; i++)
 		__brelse(sbi->vol_amap[i]);
 
+	kvfree(sbi->vol_amap_free);
 	kvfree(sbi->vol_amap);
 }
 
@@ -136,7 +176,8 @@ int exfat_set_bitmap(struct inode *inode, unsigned int clu, bool sync)
 	i = BITMAP_OFFSET_SECTOR_INDEX(sb, ent_idx);
 	b = BITMAP_OFFSET_BIT_IN_SECTOR(sb, ent_idx);
 
-	set_bit_le(b, sbi->vol_amap[i]->b_data);
+	if (!test_and_set_bit_le(b, sbi->vol_amap[i]->b_data))
+		sbi->vol_amap_free[i]--;
 	exfat_update_bh(sbi->vol_amap[i], sync);
 	return 0;
 }
@@ -159,6 +200,7 @@ int exfat_clear_bitmap(struct inode *inode, unsigned int clu, bool sync)
 		return -EIO;
 
 	clear_bit_le(b, sbi->vol_amap[i]->b_data);
+	sbi->vol_amap_free[i]++;
 
 	exfat_update_bh(sbi->vol_amap[i], sync);
 
@@ -187,6 +229,18 @@ unsigned int exfat_find_free_bitmap(struct super_block *sb, unsigned int clu)
 
 	for (i = EXFAT_FIRST_CLUSTER; i < sbi->num_clusters;
 	     i += BITS_PER_LONG) {
+		if (!map_b && !sbi->vol_amap_free[map_i]) {
+			/* skip the whole sector, it has no free cluster */
+			unsigned int skip = ALIGN(exfat_bitmap_sector_bits(sb, map_i),
+						  BITS_PER_LONG) - BITS_PER_LONG;
+
+			i += skip;
+			clu_base += skip;
+			map_b = sb->s_blocksize - sizeof(long);
+			clu_mask = 0;
+			goto next;
+		}
+
 		bitval = *(__le_long *)(sbi->vol_amap[map_i]->b_data + map_b);
 		if (clu_mask > 0) {
 			bitval |= cpu_to_lel(clu_mask);
@@ -198,6 +252,7 @@ unsigned int exfat_find_free_bitmap(struct super_block *sb, unsigned int clu)
 			if (clu_free < sbi->num_clusters)
 				return clu_free;
 		}
+next:
 		clu_base += BITS_PER_LONG;
 		map_b += sizeof(long);
 
@@ -217,28 +272,11 @@ unsigned int exfat_find_free_bitmap(struct super_block *sb, unsigned int clu)
 int exfat_count_used_clusters(struct super_block *sb, unsigned int *ret_count)
 {
 	struct exfat_sb_info *sbi = EXFAT_SB(sb);
-	unsigned int count = 0;
-	unsigned int i, map_i = 0, map_b = 0;
-	unsigned int total_clus = EXFAT_DATA_CLUSTER_COUNT(sbi);
-	unsigned int last_mask = total_clus & (BITS_PER_LONG - 1);
-	unsigned long *bitmap, clu_bits;
-
-	total_clus &= ~last_mask;
-	for (i = 0; i < total_clus; i += BITS_PER_LONG) {
-		bitmap = (void *)(sbi->vol_amap[map_i]->b_data + map_b);
-		count += hweight_long(*bitmap);
-		map_b += sizeof(long);
-		if (map_b >= (unsigned int)sb->s_blocksize) {
-			map_i++;
-			map_b = 0;
-		}
-	}
+	unsigned int count = EXFAT_DATA_CLUSTER_COUNT(sbi);
+	unsigned int i;
 
-	if (last_mask) {
-		bitmap = (void *)(sbi->vol_amap[map_i]->b_data + map_b);
-		clu_bits = lel_to_cpu(*(__le_long *)bitmap);
-		count += hweight_long(clu_bits & BITMAP_LAST_WORD_MASK(last_mask));
-	}
+	for (i = 0; i < sbi->map_sectors; i++)
+		count -= sbi->vol_amap_free[i];
 
 	*ret_count = count;
 	return 0;
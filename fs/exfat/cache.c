@@ -17,7 +17,13 @@
 #include "exfat_raw.h"
 #include "exfat_fs.h"
 
-#define EXFAT_MAX_CACHE		16
+/*
+ * The number of cache entries of an inode scales with its size, so seeks in
+ * large fragmented files don't fall back to walking the FAT chain.
+ */
+#define EXFAT_MIN_CACHE		16
+#define EXFAT_MAX_CACHE		512
+#define EXFAT_CACHE_CLU_SHIFT	8	/* one entry per 256 clusters */
 
 struct exfat_cache {
 	struct list_head cache_list;
@@ -71,6 +77,15 @@ static inline void exfat_cache_free(struct exfat_cache *cache)
 	kmem_cache_free(exfat_cachep, cache);
 }
 
+static unsigned int exfat_cache_limit(struct inode *inode)
+{
+	struct exfat_sb_info *sbi = EXFAT_SB(inode->i_sb);
+	loff_t nr_clus = EXFAT_B_TO_CLU_ROUND_UP(i_size_read(inode), sbi);
+
+	return clamp_t(loff_t, nr_clus >> EXFAT_CACHE_CLU_SHIFT,
+		       EXFAT_MIN_CACHE, EXFAT_MAX_CACHE);
+}
+
 static inline void exfat_cache_update_lru(struct inode *inode,
 		struct exfat_cache *cache)
 {
@@ -117,6 +132,20 @@ static unsigned int exfat_cache_lookup(struct inode *inode,
 	return offset;
 }
 
+/*
+ * Two extents can be merged if they map file clusters to disk clusters with
+ * the same offset, and overlap or touch each other.
+ */
+static inline bool exfat_cache_mergeable(struct exfat_cache *p,
+		struct exfat_cache_id *new)
+{
+	if (new->fcluster - p->fcluster != new->dcluster - p->dcluster)
+		return false;
+
+	return new->fcluster <= p->fcluster + p->nr_contig + 1 &&
+	       p->fcluster <= new->fcluster + new->nr_contig + 1;
+}
+
 static struct exfat_cache *exfat_cache_merge(struct inode *inode,
 		struct exfat_cache_id *new)
 {
@@ -124,10 +153,16 @@ static struct exfat_cache *exfat_cache_merge(struct inode *inode,
 	struct exfat_cache *p;
 
 	list_for_each_entry(p, &ei->cache_lru, cache_list) {
-		/* Find the same part as "new" in cluster-chain. */
-		if (p->fcluster == new->fcluster) {
-			if (new->nr_contig > p->nr_contig)
-				p->nr_contig = new->nr_contig;
+		/* Find a part of cluster-chain which "new" extends. */
+		if (exfat_cache_mergeable(p, new)) {
+			unsigned int end = max(p->fcluster + p->nr_contig,
+					       new->fcluster + new->nr_contig);
+
+			if (new->fcluster < p->fcluster) {
+				p->fcluster = new->fcluster;
+				p->dcluster = new->dcluster;
+			}
+			p->nr_contig = end - p->fcluster;
 			return p;
 		}
 	}
@@ -150,7 +185,7 @@ static void exfat_cache_add(struct inode *inode,
 
 	cache = exfat_cache_merge(inode, new);
 	if (cache == NULL) {
-		if (ei->nr_caches < EXFAT_MAX_CACHE) {
+		if (ei->nr_caches < exfat_cache_limit(inode)) {
 			ei->nr_caches++;
 			spin_unlock(&ei->cache_lru_lock);
 
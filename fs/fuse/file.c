@@ -1820,6 +1820,17 @@ static ssize_t fuse_splice_read(struct file *in, loff_t *ppos,
 		return filemap_splice_read(in, ppos, pipe, len, flags);
 }
 
+static int fuse_file_fadvise(struct file *file, loff_t offset, loff_t len,
+			     int advice)
+{
+	struct fuse_file *ff = file->private_data;
+
+	if (fuse_file_passthrough(ff))
+		return fuse_passthrough_fadvise(file, offset, len, advice);
+	else
+		return generic_fadvise(file, offset, len, advice);
+}
+
 static ssize_t fuse_splice_write(struct pipe_inode_info *pipe, struct file *out,
 				 loff_t *ppos, size_t len, unsigned int flags)
 {
@@ -3410,6 +3421,7 @@ static const struct file_operations fuse_file_operations = {
 	.compat_ioctl	= fuse_file_compat_ioctl,
 	.poll		= fuse_file_poll,
 	.fallocate	= fuse_file_fallocate,
+	.fadvise	= fuse_file_fadvise,
 	.copy_file_range = fuse_copy_file_range,
 };
 
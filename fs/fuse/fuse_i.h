@@ -1568,6 +1568,8 @@ ssize_t fuse_passthrough_splice_write(struct pipe_inode_info *pipe,
 				      struct file *out, loff_t *ppos,
 				      size_t len, unsigned int flags);
 ssize_t fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma);
+int fuse_passthrough_fadvise(struct file *file, loff_t offset, loff_t len,
+			     int advice);
 
 #ifdef CONFIG_SYSCTL
 extern int fuse_sysctl_register(void);
@@ -904,7 +904,7 @@ int attr_data_get_block(struct ntfs_inode *ni, CLST vcn, CLST clen, CLST *lcn,
 
 	/* Try to find in cache. */
 	down_read(&ni->file.run_lock);
-	if (!run_lookup_entry(run, vcn, lcn, len, NULL))
+	if (!run_lookup_entry_cached(run, vcn, lcn, len))
 		*len = 0;
 	up_read(&ni->file.run_lock);
 
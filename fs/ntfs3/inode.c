@@ -743,6 +743,37 @@ static int ntfs_read_folio(struct file *file, struct folio *folio)
 	return mpage_read_folio(folio, ntfs_get_block);
 }
 
+/*
+ * ntfs_readahead_load_runs - Load all runs of the readahead window.
+ *
+ * Fragmented files may describe their runs in many attribute segments.
+ * Loading them in the middle of mpage_readahead() stalls the bios already
+ * built on the MFT reads, so map the whole window before issuing any.
+ */
+static void ntfs_readahead_load_runs(struct ntfs_inode *ni, loff_t pos,
+				     size_t bytes)
+{
+	struct ntfs_sb_info *sbi = ni->mi.sbi;
+	struct runs_tree *run = &ni->file.run;
+	CLST vcn = pos >> sbi->cluster_bits;
+	CLST end = (pos + bytes - 1) >> sbi->cluster_bits;
+	bool mapped;
+
+	down_read(&ni->file.run_lock);
+	mapped = run_is_mapped_full(run, vcn, end);
+	up_read(&ni->file.run_lock);
+
+	if (mapped)
+		return;
+
+	/* Errors are reported by ntfs_get_block for the folios concerned. */
+	ni_lock(ni);
+	down_write(&ni->file.run_lock);
+	attr_load_runs_range(ni, ATTR_DATA, NULL, 0, run, pos, pos + bytes);
+	up_write(&ni->file.run_lock);
+	ni_unlock(ni);
+}
+
 static void ntfs_readahead(struct readahead_control *rac)
 {
 	struct address_space *mapping = rac->mapping;
@@ -770,6 +801,9 @@ static void ntfs_readahead(struct readahead_control *rac)
 		return;
 	}
 
+	if (readahead_length(rac))
+		ntfs_readahead_load_runs(ni, pos, readahead_length(rac));
+
 	mpage_readahead(rac, ntfs_get_block);
 }
 
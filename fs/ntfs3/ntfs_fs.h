@@ -118,6 +118,7 @@ struct runs_tree {
 	struct ntfs_run *runs;
 	size_t count; /* Currently used size a ntfs_run storage. */
 	size_t allocated; /* Currently allocated ntfs_run storage size. */
+	size_t hint; /* Index of the entry found by run_lookup_entry_cached. */
 };
 
 struct ntfs_buffers {
@@ -792,6 +793,8 @@ static inline void mi_get_ref(const struct mft_inode *mi, struct MFT_REF *ref)
 /* Globals from run.c */
 bool run_lookup_entry(const struct runs_tree *run, CLST vcn, CLST *lcn,
 		      CLST *len, size_t *index);
+bool run_lookup_entry_cached(struct runs_tree *run, CLST vcn, CLST *lcn,
+			     CLST *len);
 void run_truncate(struct runs_tree *run, CLST vcn);
 void run_truncate_head(struct runs_tree *run, CLST vcn);
 void run_truncate_around(struct runs_tree *run, CLST vcn);
@@ -923,6 +926,7 @@ static inline void run_init(struct runs_tree *run)
 	run->runs = NULL;
 	run->count = 0;
 	run->allocated = 0;
+	run->hint = 0;
 }
 
 static inline struct runs_tree *run_alloc(void)
@@ -222,6 +222,48 @@ bool run_lookup_entry(const struct runs_tree *run, CLST vcn, CLST *lcn,
 	return true;
 }
 
+/*
+ * run_lookup_entry_cached - Same as run_lookup_entry but starts from
+ * the entry found by the previous call.
+ *
+ * Large fragmented files are mostly read sequentially: the entry looked
+ * for is then the last one found or the next one, and the binary search
+ * over the whole runs_tree can be skipped.
+ * May be called under read lock, @run->hint is only a hint.
+ */
+bool run_lookup_entry_cached(struct runs_tree *run, CLST vcn, CLST *lcn,
+			     CLST *len)
+{
+	size_t hint = READ_ONCE(run->hint);
+	const struct ntfs_run *r;
+	size_t idx;
+	CLST gap;
+
+	/* Check the last entry found, then the next one. */
+	for (idx = hint; idx < run->count && idx <= hint + 1; idx++) {
+		r = run->runs + idx;
+		if (vcn < r->vcn)
+			break;
+
+		gap = vcn - r->vcn;
+		if (gap < r->len)
+			goto found;
+	}
+
+	if (!run_lookup_entry(run, vcn, lcn, len, &idx))
+		return false;
+
+	WRITE_ONCE(run->hint, idx);
+	return true;
+
+found:
+	*lcn = r->lcn == SPARSE_LCN ? SPARSE_LCN : (r->lcn + gap);
+	*len = r->len - gap;
+	if (idx != hint)
+		WRITE_ONCE(run->hint, idx);
+	return true;
+}
+
 /*
  * run_truncate_head - Decommit the range before vcn.
  */
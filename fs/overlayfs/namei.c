@@ -1042,7 +1042,7 @@ struct dentry *ovl_lookup(struct inode *dir, struct dentry *dentry,
 	char *upperredirect = NULL;
 	struct dentry *this;
 	unsigned int i;
-	int err;
+	int err, first_lower = -1;
 	bool uppermetacopy = false;
 	int metacopy_size = 0;
 	struct ovl_lookup_data d = {
@@ -1108,11 +1108,24 @@ struct dentry *ovl_lookup(struct inode *dir, struct dentry *dentry,
 		stack = ovl_stack_alloc(ofs->numlayer - 1);
 		if (!stack)
 			goto out_put_upper;
+
+		/*
+		 * An up to date merged listing of the parent tells which lower
+		 * layers hold the name, skip the ones above the topmost one, or
+		 * all of them if none does.  Not valid once a redirect changed
+		 * the name to look up.
+		 */
+		if (!d.redirect)
+			first_lower = ovl_dir_cache_lower_idx(dentry->d_parent,
+							      &d.name);
 	}
 
-	for (i = 0; !d.stop && i < ovl_numlower(poe); i++) {
+	for (i = 0; !d.stop && first_lower && i < ovl_numlower(poe); i++) {
 		struct ovl_path lower = ovl_lowerstack(poe)[i];
 
+		if (lower.layer->idx < first_lower)
+			continue;
+
 		if (!ovl_redirect_follow(ofs))
 			d.last = i == ovl_numlower(poe) - 1;
 		else if (d.is_dir || !ofs->numdatalayer)
@@ -15,9 +15,15 @@
 #include <linux/ratelimit.h>
 #include "overlayfs.h"
 
+static bool ovl_lookup_cache;
+module_param_named(lookup_cache, ovl_lookup_cache, bool, 0644);
+MODULE_PARM_DESC(lookup_cache,
+		 "Keep merged directory listings after close to speed up lookups");
+
 struct ovl_cache_entry {
 	unsigned int len;
 	unsigned int type;
+	int lower_idx;	/* topmost lower layer holding the name, 0 if none */
 	u64 real_ino;
 	u64 ino;
 	struct list_head l_node;
@@ -31,6 +37,7 @@ struct ovl_cache_entry {
 
 struct ovl_dir_cache {
 	long refcount;
+	bool merged;
 	u64 version;
 	struct list_head entries;
 	struct rb_root root;
@@ -46,6 +53,7 @@ struct ovl_readdir_data {
 	struct ovl_cache_entry *first_maybe_whiteout;
 	int count;
 	int err;
+	int layer_idx;
 	bool is_upper;
 	bool d_type_supported;
 	bool in_xwhiteouts_dir;
@@ -157,6 +165,7 @@ static struct ovl_cache_entry *ovl_cache_entry_new(struct ovl_readdir_data *rdd,
 	p->name[len] = '\0';
 	p->len = len;
 	p->type = d_type;
+	p->lower_idx = rdd->is_upper ? 0 : rdd->layer_idx;
 	p->real_ino = ino;
 	p->ino = ino;
 	/* Defer setting d_ino for upper entry to ovl_iterate() */
@@ -182,8 +191,12 @@ static bool ovl_cache_entry_add_rb(struct ovl_readdir_data *rdd,
 	struct rb_node *parent = NULL;
 	struct ovl_cache_entry *p;
 
-	if (ovl_cache_entry_find_link(name, len, &newp, &parent))
+	if (ovl_cache_entry_find_link(name, len, &newp, &parent)) {
+		p = ovl_cache_entry_from_node(parent);
+		if (!p->lower_idx && !rdd->is_upper)
+			p->lower_idx = rdd->layer_idx;
 		return true;
+	}
 
 	p = ovl_cache_entry_new(rdd, name, len, ino, d_type);
 	if (p == NULL) {
@@ -206,6 +219,8 @@ static bool ovl_fill_lowest(struct ovl_readdir_data *rdd,
 
 	p = ovl_cache_entry_find(rdd->root, name, namelen);
 	if (p) {
+		if (!p->lower_idx)
+			p->lower_idx = rdd->layer_idx;
 		list_move_tail(&p->l_node, &rdd->middle);
 	} else {
 		p = ovl_cache_entry_new(rdd, name, namelen, ino, d_type);
@@ -246,6 +261,11 @@ static void ovl_cache_put(struct ovl_dir_file *od, struct inode *inode)
 	WARN_ON(cache->refcount <= 0);
 	cache->refcount--;
 	if (!cache->refcount) {
+		/* Keep an up to date listing around for ovl_lookup() */
+		if (ovl_lookup_cache && ovl_dir_cache(inode) == cache &&
+		    ovl_inode_version_get(inode) == cache->version)
+			return;
+
 		if (ovl_dir_cache(inode) == cache)
 			ovl_set_dir_cache(inode, NULL);
 
@@ -362,6 +382,7 @@ static int ovl_dir_read_merged(struct dentry *dentry, struct list_head *list,
 	for (idx = 0; idx != -1; idx = next) {
 		next = ovl_path_next(idx, dentry, &realpath, &layer);
 		rdd.is_upper = ovl_dentry_upper(dentry) == realpath.dentry;
+		rdd.layer_idx = layer->idx;
 		rdd.in_xwhiteouts_dir = layer->has_xwhiteouts &&
 					ovl_dentry_has_xwhiteouts(dentry);
 
@@ -405,10 +426,12 @@ static struct ovl_dir_cache *ovl_cache_get(struct dentry *dentry)
 
 	cache = ovl_dir_cache(inode);
 	if (cache && ovl_inode_version_get(inode) == cache->version) {
-		WARN_ON(!cache->refcount);
 		cache->refcount++;
 		return cache;
 	}
+	/* A stale cache is freed here if it was only kept for lookups */
+	if (cache && !cache->refcount)
+		ovl_dir_cache_free(inode);
 	ovl_set_dir_cache(d_inode(dentry), NULL);
 
 	cache = kzalloc(sizeof(struct ovl_dir_cache), GFP_KERNEL);
@@ -416,6 +439,7 @@ static struct ovl_dir_cache *ovl_cache_get(struct dentry *dentry)
 		return ERR_PTR(-ENOMEM);
 
 	cache->refcount = 1;
+	cache->merged = true;
 	INIT_LIST_HEAD(&cache->entries);
 	cache->root = RB_ROOT;
 
@@ -747,6 +771,25 @@ static int ovl_iterate_real(struct file *file, struct dir_context *ctx)
 }
 
 
+/*
+ * Return the index of the topmost lower layer of @dir holding @name, 0 if no
+ * lower layer does, or -1 if there is no up to date merged listing of @dir to
+ * tell.  Caller must hold the inode lock of @dir.
+ */
+int ovl_dir_cache_lower_idx(struct dentry *dir, const struct qstr *name)
+{
+	struct inode *inode = d_inode(dir);
+	struct ovl_dir_cache *cache = ovl_dir_cache(inode);
+	struct ovl_cache_entry *p;
+
+	if (!cache || !cache->merged ||
+	    ovl_inode_version_get(inode) != cache->version)
+		return -1;
+
+	p = ovl_cache_entry_find(&cache->root, name->name, name->len);
+	return p ? p->lower_idx : 0;
+}
+
 static int ovl_iterate(struct file *file, struct dir_context *ctx)
 {
 	struct ovl_dir_file *od = file->private_data;
@@ -34,6 +34,7 @@
 #include <linux/string.h>
 #include <linux/pagemap.h>
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -563,6 +564,151 @@ static int squashfs_readahead_fragment(struct page **page,
 	return 1;
 }
 
+static int squashfs_readahead_block(struct inode *inode, struct page **pages,
+	unsigned int nr_pages, u64 block, int bsize, unsigned int expected,
+	loff_t start)
+{
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	loff_t file_end = i_size_read(inode) >> msblk->block_log;
+	struct squashfs_page_actor *actor;
+	struct page *last_page;
+	int res, i, err = 0;
+
+	actor = squashfs_page_actor_init_special(msblk, pages, nr_pages,
+						expected, start);
+	if (!actor) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	res = squashfs_read_data(inode->i_sb, block, bsize, NULL, actor);
+
+	last_page = squashfs_page_actor_free(actor);
+
+	if (res == expected && !IS_ERR(last_page)) {
+		int bytes;
+
+		/* Last page (if present) may have trailing bytes not filled */
+		bytes = res % PAGE_SIZE;
+		if (start >> msblk->block_log == file_end && bytes && last_page)
+			memzero_page(last_page, bytes,
+				     PAGE_SIZE - bytes);
+
+		for (i = 0; i < nr_pages; i++) {
+			flush_dcache_page(pages[i]);
+			SetPageUptodate(pages[i]);
+		}
+	}
+
+out:
+	for (i = 0; i < nr_pages; i++) {
+		unlock_page(pages[i]);
+		put_page(pages[i]);
+	}
+	return err;
+}
+
+#ifdef CONFIG_SQUASHFS_READAHEAD_ASYNC
+/*
+ * Decompress the blocks of a readahead window in parallel.  Every block
+ * but the first is handed to an unbound workqueue, and the first block is
+ * decompressed by the reader itself once the others have been queued.  The
+ * pages stay locked until their block is done, which also pins the inode
+ * and the superblock for the work item.
+ */
+struct squashfs_readahead_work {
+	struct work_struct work;
+	struct inode *inode;
+	u64 block;
+	int bsize;
+	unsigned int expected;
+	unsigned int nr_pages;
+	loff_t start;
+	struct page *pages[];
+};
+
+static struct workqueue_struct *squashfs_readahead_wq;
+
+static void squashfs_readahead_work_fn(struct work_struct *work)
+{
+	struct squashfs_readahead_work *rw = container_of(work,
+				struct squashfs_readahead_work, work);
+
+	squashfs_readahead_block(rw->inode, rw->pages, rw->nr_pages,
+				 rw->block, rw->bsize, rw->expected, rw->start);
+	kfree(rw);
+}
+
+static struct squashfs_readahead_work *squashfs_readahead_defer(
+	struct inode *inode, struct page **pages, unsigned int nr_pages,
+	u64 block, int bsize, unsigned int expected, loff_t start)
+{
+	struct squashfs_readahead_work *rw;
+
+	if (!squashfs_readahead_wq)
+		return NULL;
+
+	rw = kmalloc(struct_size(rw, pages, nr_pages), GFP_KERNEL |
+		     __GFP_NOWARN);
+	if (!rw)
+		return NULL;
+
+	INIT_WORK(&rw->work, squashfs_readahead_work_fn);
+	rw->inode = inode;
+	rw->block = block;
+	rw->bsize = bsize;
+	rw->expected = expected;
+	rw->nr_pages = nr_pages;
+	rw->start = start;
+	memcpy(rw->pages, pages, nr_pages * sizeof(*pages));
+	return rw;
+}
+
+static void squashfs_readahead_queue(struct squashfs_readahead_work *rw)
+{
+	queue_work(squashfs_readahead_wq, &rw->work);
+}
+
+static void squashfs_readahead_run(struct squashfs_readahead_work *rw)
+{
+	squashfs_readahead_work_fn(&rw->work);
+}
+
+int __init squashfs_readahead_init(void)
+{
+	/* WQ_SYSFS allows confining the workers to the big cores */
+	squashfs_readahead_wq = alloc_workqueue("squashfs_ra",
+			WQ_UNBOUND | WQ_MEM_RECLAIM | WQ_SYSFS, 0);
+	return squashfs_readahead_wq ? 0 : -ENOMEM;
+}
+
+void squashfs_readahead_exit(void)
+{
+	destroy_workqueue(squashfs_readahead_wq);
+}
+#else
+struct squashfs_readahead_work;
+
+static inline struct squashfs_readahead_work *squashfs_readahead_defer(
+	struct inode *inode, struct page **pages, unsigned int nr_pages,
+	u64 block, int bsize, unsigned int expected, loff_t start)
+{
+	return NULL;
+}
+
+static inline void squashfs_readahead_queue(struct squashfs_readahead_work *rw) {}
+static inline void squashfs_readahead_run(struct squashfs_readahead_work *rw) {}
+
+int __init squashfs_readahead_init(void)
+{
+	return 0;
+}
+
+void squashfs_readahead_exit(void)
+{
+}
+#endif
+
 static void squashfs_readahead(struct readahead_control *ractl)
 {
 	struct inode *inode = ractl->mapping->host;
@@ -571,7 +717,7 @@ static void squashfs_readahead(struct readahead_control *ractl)
 	unsigned short shift = msblk->block_log - PAGE_SHIFT;
 	loff_t start = readahead_pos(ractl) & ~mask;
 	size_t len = readahead_length(ractl) + readahead_pos(ractl) - start;
-	struct squashfs_page_actor *actor;
+	struct squashfs_readahead_work *first = NULL, *rw;
 	unsigned int nr_pages = 0;
 	struct page **pages;
 	int i;
@@ -588,7 +734,6 @@ static void squashfs_readahead(struct readahead_control *ractl)
 		int res, bsize;
 		u64 block = 0;
 		unsigned int expected;
-		struct page *last_page;
 
 		expected = start >> msblk->block_log == file_end ?
 			   (i_size_read(inode) & (msblk->block_size - 1)) :
@@ -616,46 +761,30 @@ static void squashfs_readahead(struct readahead_control *ractl)
 		if (bsize == 0)
 			goto skip_pages;
 
-		actor = squashfs_page_actor_init_special(msblk, pages, nr_pages,
-							expected, start);
-		if (!actor)
-			goto skip_pages;
-
-		res = squashfs_read_data(inode->i_sb, block, bsize, NULL, actor);
-
-		last_page = squashfs_page_actor_free(actor);
-
-		if (res == expected && !IS_ERR(last_page)) {
-			int bytes;
-
-			/* Last page (if present) may have trailing bytes not filled */
-			bytes = res % PAGE_SIZE;
-			if (start >> msblk->block_log == file_end && bytes && last_page)
-				memzero_page(last_page, bytes,
-					     PAGE_SIZE - bytes);
-
-			for (i = 0; i < nr_pages; i++) {
-				flush_dcache_page(pages[i]);
-				SetPageUptodate(pages[i]);
-			}
-		}
-
-		for (i = 0; i < nr_pages; i++) {
-			unlock_page(pages[i]);
-			put_page(pages[i]);
+		rw = squashfs_readahead_defer(inode, pages, nr_pages, block,
+					      bsize, expected, start);
+		if (rw) {
+			if (!first)
+				first = rw;
+			else
+				squashfs_readahead_queue(rw);
+		} else if (squashfs_readahead_block(inode, pages, nr_pages,
+					block, bsize, expected, start)) {
+			goto out;
 		}
 
 		start += readahead_batch_length(ractl);
 	}
-
-	kfree(pages);
-	return;
+	goto out;
 
 skip_pages:
 	for (i = 0; i < nr_pages; i++) {
 		unlock_page(pages[i]);
 		put_page(pages[i]);
 	}
+out:
+	if (first)
+		squashfs_readahead_run(first);
 	kfree(pages);
 }
 
@@ -75,6 +75,8 @@ extern __le64 *squashfs_read_fragment_index_table(struct super_block *,
 /* file.c */
 void squashfs_copy_cache(struct folio *, struct squashfs_cache_entry *,
 		size_t bytes, size_t offset);
+int squashfs_readahead_init(void);
+void squashfs_readahead_exit(void);
 
 /* file_xxx.c */
 int squashfs_readpage_block(struct folio *, u64 block, int bsize, int expected);
@@ -84,6 +84,8 @@ const struct fsverity_hash_alg *fsverity_get_hash_alg(const struct inode *inode,
 	if (WARN_ON_ONCE(alg->block_size != crypto_shash_blocksize(tfm)))
 		goto err_free_tfm;
 
+	alg->mb_max_msgs = crypto_shash_mb_max_msgs(tfm);
+
 	pr_info("%s using implementation \"%s\"\n",
 		alg->name, crypto_shash_driver_name(tfm));
 
@@ -197,6 +199,45 @@ int fsverity_hash_block(const struct merkle_tree_params *params,
 	return err;
 }
 
+/**
+ * fsverity_hash_2_blocks() - hash two data blocks at once
+ * @params: the Merkle tree's parameters
+ * @inode: inode for which the hashing is being done
+ * @data1: virtual address of the first block to hash
+ * @data2: virtual address of the second block to hash
+ * @out1: output digest for @data1, size 'params->digest_size' bytes
+ * @out2: output digest for @data2, size 'params->digest_size' bytes
+ *
+ * Like fsverity_hash_block(), but lets the hash algorithm interleave the two
+ * computations.  Only to be used if params->hash_alg->mb_max_msgs >= 2.
+ *
+ * Return: 0 on success, -errno on failure
+ */
+int fsverity_hash_2_blocks(const struct merkle_tree_params *params,
+			   const struct inode *inode, const void *data1,
+			   const void *data2, u8 *out1, u8 *out2)
+{
+	SHASH_DESC_ON_STACK(desc, params->hash_alg->tfm);
+	const u8 *data[2] = { data1, data2 };
+	u8 *outs[2] = { out1, out2 };
+	int err;
+
+	desc->tfm = params->hash_alg->tfm;
+
+	if (params->hashstate)
+		err = crypto_shash_import(desc, params->hashstate);
+	else
+		err = crypto_shash_init(desc);
+	if (err) {
+		fsverity_err(inode, "Error %d initializing hash state", err);
+		return err;
+	}
+	err = crypto_shash_finup_mb(desc, data, params->block_size, outs, 2);
+	if (err)
+		fsverity_err(inode, "Error %d computing block hashes", err);
+	return err;
+}
+
 /**
  * fsverity_hash_buffer() - hash some data
  * @alg: the hash algorithm to use
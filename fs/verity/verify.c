@@ -86,11 +86,14 @@ static bool is_hash_block_verified(struct fsverity_info *vi, struct page *hpage,
  * only ascend the tree until an already-verified hash block is seen, and then
  * verify the path to that block.
  *
+ * If @data_hash is not NULL, it is the already computed hash of @data.
+ *
  * Return: %true if the data block is valid, else %false.
  */
 static bool
 verify_data_block(struct inode *inode, struct fsverity_info *vi,
-		  const void *data, u64 data_pos, unsigned long max_ra_pages)
+		  const void *data, const u8 *data_hash, u64 data_pos,
+		  unsigned long max_ra_pages)
 {
 	const struct merkle_tree_params *params = &vi->tree_params;
 	const unsigned int hsize = params->digest_size;
@@ -115,8 +118,11 @@ verify_data_block(struct inode *inode, struct fsverity_info *vi,
 	 */
 	u64 hidx = data_pos >> params->log_blocksize;
 
-	/* Up to 1 + FS_VERITY_MAX_LEVELS pages may be mapped at once */
-	BUILD_BUG_ON(1 + FS_VERITY_MAX_LEVELS > KM_MAX_IDX);
+	/*
+	 * Up to 2 + FS_VERITY_MAX_LEVELS pages may be mapped at once, the
+	 * data pages of verify_2_data_blocks() included.
+	 */
+	BUILD_BUG_ON(2 + FS_VERITY_MAX_LEVELS > KM_MAX_IDX);
 
 	if (unlikely(data_pos >= inode->i_size)) {
 		/*
@@ -222,7 +228,9 @@ verify_data_block(struct inode *inode, struct fsverity_info *vi,
 	}
 
 	/* Finally, verify the data block. */
-	if (fsverity_hash_block(params, inode, data, real_hash) != 0)
+	if (data_hash)
+		memcpy(real_hash, data_hash, hsize);
+	else if (fsverity_hash_block(params, inode, data, real_hash) != 0)
 		goto error;
 	if (memcmp(want_hash, real_hash, hsize) != 0)
 		goto corrupted;
@@ -242,6 +250,37 @@ verify_data_block(struct inode *inode, struct fsverity_info *vi,
 	return false;
 }
 
+/*
+ * Verify two consecutive data blocks of @data_folio, hashing them together so
+ * that hash algorithms with multibuffer support can interleave the work.
+ */
+static bool
+verify_2_data_blocks(struct inode *inode, struct fsverity_info *vi,
+		     struct folio *data_folio, size_t offset, u64 pos,
+		     unsigned long max_ra_pages)
+{
+	const struct merkle_tree_params *params = &vi->tree_params;
+	u8 hash1[FS_VERITY_MAX_DIGEST_SIZE];
+	u8 hash2[FS_VERITY_MAX_DIGEST_SIZE];
+	void *data1, *data2;
+	bool valid;
+
+	data1 = kmap_local_folio(data_folio, offset);
+	data2 = kmap_local_folio(data_folio, offset + params->block_size);
+
+	valid = fsverity_hash_2_blocks(params, inode, data1, data2,
+				       hash1, hash2) == 0 &&
+		verify_data_block(inode, vi, data1, hash1, pos + offset,
+				  max_ra_pages) &&
+		verify_data_block(inode, vi, data2, hash2,
+				  pos + offset + params->block_size,
+				  max_ra_pages);
+
+	kunmap_local(data2);
+	kunmap_local(data1);
+	return valid;
+}
+
 static bool
 verify_data_blocks(struct folio *data_folio, size_t len, size_t offset,
 		   unsigned long max_ra_pages)
@@ -260,8 +299,19 @@ verify_data_blocks(struct folio *data_folio, size_t len, size_t offset,
 		void *data;
 		bool valid;
 
+		if (len >= 2 * block_size &&
+		    vi->tree_params.hash_alg->mb_max_msgs >= 2) {
+			valid = verify_2_data_blocks(inode, vi, data_folio,
+						     offset, pos, max_ra_pages);
+			if (!valid)
+				return false;
+			offset += 2 * block_size;
+			len -= 2 * block_size;
+			continue;
+		}
+
 		data = kmap_local_folio(data_folio, offset);
-		valid = verify_data_block(inode, vi, data, pos + offset,
+		valid = verify_data_block(inode, vi, data, NULL, pos + offset,
 					  max_ra_pages);
 		kunmap_local(data);
 		if (!valid)
@@ -182,6 +182,14 @@ struct shash_desc {
  * @update: see struct ahash_alg
  * @final: see struct ahash_alg
  * @finup: see struct ahash_alg
+ * @finup_mb: **[optional]** Multibuffer hashing support.  Finish calculating
+ *	      the digests of multiple messages, interleaving the instructions
+ *	      to potentially achieve better performance than hashing each
+ *	      message individually.  The starting state is given in @desc and
+ *	      is shared by all the messages, which all have the same length.
+ *	      Called only with 2 <= num_msgs <= @mb_max_msgs.  The
+ *	      implementation must handle any input, falling back to hashing
+ *	      the messages one by one where its fast path does not apply.
  * @digest: see struct ahash_alg
  * @export: see struct ahash_alg
  * @import: see struct ahash_alg
@@ -201,6 +209,8 @@ struct shash_desc {
  * @descsize: Size of the operational state for the message digest. This state
  * 	      size is the memory size that needs to be allocated for
  *	      shash_desc.__ctx
+ * @mb_max_msgs: Maximum supported value of num_msgs argument to @finup_mb.
+ *		 Zero (the default) means @finup_mb is not implemented.
  * @halg: see struct hash_alg_common
  * @HASH_ALG_COMMON: see struct hash_alg_common
  */
@@ -211,6 +221,9 @@ struct shash_alg {
 	int (*final)(struct shash_desc *desc, u8 *out);
 	int (*finup)(struct shash_desc *desc, const u8 *data,
 		     unsigned int len, u8 *out);
+	int (*finup_mb)(struct shash_desc *desc, const u8 * const data[],
+			unsigned int len, u8 * const outs[],
+			unsigned int num_msgs);
 	int (*digest)(struct shash_desc *desc, const u8 *data,
 		      unsigned int len, u8 *out);
 	int (*export)(struct shash_desc *desc, void *out);
@@ -222,6 +235,7 @@ struct shash_alg {
 	int (*clone_tfm)(struct crypto_shash *dst, struct crypto_shash *src);
 
 	unsigned int descsize;
+	unsigned int mb_max_msgs;
 
 	union {
 		struct HASH_ALG_COMMON;
@@ -788,6 +802,20 @@ static inline unsigned int crypto_shash_statesize(struct crypto_shash *tfm)
 	return crypto_shash_alg(tfm)->statesize;
 }
 
+/**
+ * crypto_shash_mb_max_msgs() - get max multibuffer interleaving factor
+ * @tfm: hash transformation object
+ *
+ * Return the maximum number of messages that can be hashed in parallel
+ * using crypto_shash_finup_mb().
+ *
+ * Return: maximum number of messages, at least 1
+ */
+static inline unsigned int crypto_shash_mb_max_msgs(struct crypto_shash *tfm)
+{
+	return crypto_shash_alg(tfm)->mb_max_msgs ?: 1;
+}
+
 static inline u32 crypto_shash_get_flags(struct crypto_shash *tfm)
 {
 	return crypto_tfm_get_flags(crypto_shash_tfm(tfm));
@@ -980,6 +1008,40 @@ int crypto_shash_final(struct shash_desc *desc, u8 *out);
 int crypto_shash_finup(struct shash_desc *desc, const u8 *data,
 		       unsigned int len, u8 *out);
 
+/**
+ * crypto_shash_finup_mb() - multibuffer message hashing
+ * @desc: the starting state that is forked for each message.  It contains the
+ *	  state after hashing a (possibly-empty) common prefix of the messages.
+ * @data: the data of each message (not including any common prefix from @desc)
+ * @len: length of each data buffer in bytes
+ * @outs: output buffer for each message digest
+ * @num_msgs: number of messages, i.e. the number of entries in @data and @outs.
+ *	      This can't be more than crypto_shash_mb_max_msgs().
+ *
+ * This function provides support for hashing multiple messages with the
+ * instructions interleaved, if supported by the algorithm.  This can
+ * significantly improve performance, depending on the CPU and algorithm.
+ * The state in @desc is undefined afterwards.
+ *
+ * Context: Any context.
+ * Return: 0 on success; a negative errno value on failure.
+ */
+static inline int crypto_shash_finup_mb(struct shash_desc *desc,
+					const u8 * const data[],
+					unsigned int len, u8 * const outs[],
+					unsigned int num_msgs)
+{
+	struct crypto_shash *tfm = desc->tfm;
+
+	if (num_msgs == 1)
+		return crypto_shash_finup(desc, data[0], len, outs[0]);
+	if (num_msgs > crypto_shash_mb_max_msgs(tfm))
+		return -EINVAL;
+
+	return crypto_shash_alg(tfm)->finup_mb(desc, data, len, outs,
+					       num_msgs);
+}
+
 static inline void shash_desc_zero(struct shash_desc *desc)
 {
 	memzero_explicit(desc,
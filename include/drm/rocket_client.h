@@ -0,0 +1,30 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+#ifndef __DRM_ROCKET_CLIENT_H__
+#define __DRM_ROCKET_CLIENT_H__
+
+#include <linux/types.h>
+
+struct dma_fence;
+struct drm_gem_object;
+struct drm_rocket_task;
+struct rocket_client;
+
+/*
+ * In-kernel access to the Rockchip NPU, for drivers forwarding inference
+ * jobs on behalf of another agent. A client is a context of its own, like
+ * an open file of the accel node: its jobs are scheduled and accounted
+ * separately from the ones of userspace.
+ */
+struct rocket_client *rocket_client_open(void);
+void rocket_client_close(struct rocket_client *client);
+
+struct drm_gem_object *rocket_client_create_bo(struct rocket_client *client, size_t size,
+					       dma_addr_t *dma_address);
+
+struct dma_fence *rocket_client_submit(struct rocket_client *client,
+				       const struct drm_rocket_task *tasks, u32 task_count,
+				       struct drm_gem_object **in_bos, u32 in_bo_count,
+				       struct drm_gem_object **out_bos, u32 out_bo_count);
+
+#endif
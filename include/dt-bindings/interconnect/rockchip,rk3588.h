@@ -0,0 +1,32 @@
+/* SPDX-License-Identifier: (GPL-2.0-only OR BSD-2-Clause) */
+/*
+ * Interconnect node IDs for the Rockchip RK3588 DMC and NoC.
+ */
+
+#ifndef __DT_BINDINGS_INTERCONNECT_ROCKCHIP_RK3588_H
+#define __DT_BINDINGS_INTERCONNECT_ROCKCHIP_RK3588_H
+
+/* DMC (rockchip,rk3588-dmc) */
+#define RK3588_ICC_DMC_MASTER		0
+#define RK3588_ICC_DMC_DDR		1
+
+/* NoC (rockchip,rk3588-noc) */
+#define RK3588_ICC_NOC_DDR		2
+#define RK3588_ICC_MASTER_VOP		3
+#define RK3588_ICC_MASTER_GPU		4
+#define RK3588_ICC_MASTER_NPU		5
+#define RK3588_ICC_MASTER_VDEC		6
+#define RK3588_ICC_MASTER_VENC		7
+#define RK3588_ICC_MASTER_ISP		8
+#define RK3588_ICC_MASTER_VICAP		9
+#define RK3588_ICC_MASTER_RGA		10
+#define RK3588_ICC_MASTER_JPEG		11
+#define RK3588_ICC_MASTER_HDMIRX	12
+
+/* Tags, used to select the priority given to a master's guaranteed bandwidth */
+#define RK3588_ICC_TAG_PRIO_LOW		0
+#define RK3588_ICC_TAG_PRIO_MEDIUM	1
+#define RK3588_ICC_TAG_PRIO_HIGH	2
+#define RK3588_ICC_TAG_PRIO_URGENT	3
+
+#endif /* __DT_BINDINGS_INTERCONNECT_ROCKCHIP_RK3588_H */
@@ -145,6 +145,7 @@ enum damos_action {
  *
  * @DAMOS_QUOTA_USER_INPUT:	User-input value.
  * @DAMOS_QUOTA_SOME_MEM_PSI_US:	System level some memory PSI in us.
+ * @DAMOS_QUOTA_SWAP_USED_BP:	Used swap space ratio in bp (1/10,000).
  * @NR_DAMOS_QUOTA_GOAL_METRICS:	Number of DAMOS quota goal metrics.
  *
  * Metrics equal to larger than @NR_DAMOS_QUOTA_GOAL_METRICS are unsupported.
@@ -152,6 +153,7 @@ enum damos_action {
 enum damos_quota_goal_metric {
 	DAMOS_QUOTA_USER_INPUT,
 	DAMOS_QUOTA_SOME_MEM_PSI_US,
+	DAMOS_QUOTA_SWAP_USED_BP,
 	NR_DAMOS_QUOTA_GOAL_METRICS,
 };
 
@@ -304,6 +306,8 @@ struct damos_watermarks {
  * @sz_ops_filter_passed:
  *		Total bytes that passed ops layer-handled DAMOS filters.
  * @qt_exceeds: Total number of times the quota of the scheme has exceeded.
+ * @nr_snapshots:
+ *		Total number of times the scheme has been applied to all regions.
  *
  * "Tried an action to a region" in this context means the DAMOS core logic
  * determined the region as eligible to apply the action.  The access pattern
@@ -321,6 +325,15 @@ struct damos_watermarks {
  * failed at applying the action.  If the action is &DAMOS_PAGEOUT and all
  * pages of the region are already paged out, the region will be failed at
  * applying the action.
+ *
+ * "Applied to all regions" means one walk of the scheme over the regions of
+ * every target, which happens once per &struct damos->apply_interval_us while
+ * the scheme is activated.  Because the other counters are accumulated over
+ * such walks, dividing their change by the change of @nr_snapshots gives the
+ * average per walk.  For example, a &DAMOS_STAT scheme with a
+ * &DAMOS_FILTER_TYPE_MEMCG filter and an access pattern for cold memory tells
+ * how much cold memory the memcg has on average, without the cost of
+ * collecting the tried regions.
  */
 struct damos_stat {
 	unsigned long nr_tried;
@@ -329,6 +342,7 @@ struct damos_stat {
 	unsigned long sz_applied;
 	unsigned long sz_ops_filter_passed;
 	unsigned long qt_exceeds;
+	unsigned long nr_snapshots;
 };
 
 /**
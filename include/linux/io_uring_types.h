@@ -415,6 +415,7 @@ struct io_ring_ctx {
 
 	/* io-wq management, e.g. thread count */
 	u32				iowq_limits[2];
+	u32				iowq_policy;
 
 	struct callback_head		poll_wq_task_work;
 	struct list_head		defer_list;
@@ -15,6 +15,15 @@
 #define DMA_MAP_TO_DEVICE       1
 #define DMA_MAP_FROM_DEVICE     2
 
+#define DMA_MAP_SINGLE_MODE     0 /* dma_map_single() of one contiguous buffer */
+#define DMA_MAP_SG_MODE         1 /* dma_map_sgtable() with one page per entry */
+
+/*
+ * Latency histograms in 100ns units: bucket 0 counts 0, bucket n counts
+ * [2^(n-1), 2^n), the last bucket everything above.
+ */
+#define DMA_MAP_HIST_BUCKETS    16
+
 struct map_benchmark {
 	__u64 avg_map_100ns; /* average map latency in 100ns */
 	__u64 map_stddev; /* standard deviation of map latency */
@@ -27,5 +36,10 @@ struct map_benchmark {
 	__u32 dma_dir; /* DMA data direction */
 	__u32 dma_trans_ns; /* time for DMA transmission in ns */
 	__u32 granule;  /* how many PAGE_SIZE will do map/unmap once a time */
+	__u32 dma_mode; /* DMA_MAP_SINGLE_MODE or DMA_MAP_SG_MODE */
+	__u64 bounced; /* how many maps were bounced through swiotlb */
+	__u64 avg_bounce_map_100ns; /* average map latency of those */
+	__u64 map_hist[DMA_MAP_HIST_BUCKETS];
+	__u64 unmap_hist[DMA_MAP_HIST_BUCKETS];
 };
 #endif /* _KERNEL_DMA_BENCHMARK_H */
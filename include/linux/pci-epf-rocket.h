@@ -0,0 +1,162 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Host interface of the PCI endpoint function exposing the Rockchip NPU
+ *
+ * The host drives the NPU through a ring of descriptors that lives in its
+ * own memory. The register BAR, the first free BAR of the endpoint, holds
+ * a struct pci_epf_rocket_reg: the location of the ring and the doorbell.
+ * All the fields of the registers, descriptors and jobs are little endian.
+ *
+ * To start, the host checks MAGIC and VERSION, fills RING_ADDR and
+ * RING_ENTRIES, picks an interrupt with IRQ_TYPE and IRQ_NUMBER, then sets
+ * PCI_EPF_ROCKET_CONTROL_ENABLE in CONTROL. The endpoint answers with
+ * PCI_EPF_ROCKET_STATUS_READY, or PCI_EPF_ROCKET_STATUS_ERROR if the ring
+ * is invalid. Clearing CONTROL_ENABLE destroys all the buffers and resets
+ * the ring, STATUS then reads back as 0.
+ *
+ * The host writes the index of the next free descriptor to RING_TAIL, the
+ * endpoint reports the index of the next descriptor it is going to process
+ * in RING_HEAD. Both indexes are free running, the ring slot is the index
+ * modulo RING_ENTRIES.
+ *
+ * Descriptors are processed in order. Each one has its RESULT, 0 or a
+ * negative errno, and for BO_CREATE its HANDLE and DMA_ADDR fields written
+ * back before PCI_EPF_ROCKET_DESC_DONE is set in its STATUS. It raises an
+ * interrupt if PCI_EPF_ROCKET_DESC_FLAG_IRQ is set in FLAGS:
+ *
+ * - BO_CREATE: allocate a SIZE bytes buffer the NPU can access at DMA_ADDR.
+ *   SIZE is at most PCI_EPF_ROCKET_MAX_BO_SIZE.
+ * - BO_DESTROY: release buffer HANDLE.
+ * - BO_WRITE: copy SIZE bytes from HOST_ADDR at OFFSET in buffer HANDLE.
+ * - BO_READ: copy SIZE bytes at OFFSET in buffer HANDLE to HOST_ADDR.
+ * - SUBMIT: queue the job described by the SIZE bytes at HOST_ADDR, at most
+ *   PCI_EPF_ROCKET_MAX_JOB_SIZE. See struct pci_epf_rocket_job.
+ *
+ * SUBMIT completes as soon as the job is queued. BO_READ waits for the jobs
+ * writing the buffer, BO_WRITE and BO_DESTROY for all the jobs using it, so
+ * a job can run while the host prepares the next one.
+ */
+
+#ifndef __LINUX_PCI_EPF_ROCKET_H
+#define __LINUX_PCI_EPF_ROCKET_H
+
+#include <linux/bits.h>
+#include <linux/sizes.h>
+#include <linux/types.h>
+
+#define PCI_EPF_ROCKET_MAGIC		0x4e4e4b52	/* "RKNN" */
+#define PCI_EPF_ROCKET_VERSION		1
+
+#define PCI_EPF_ROCKET_IRQ_TYPE_INTX	0
+#define PCI_EPF_ROCKET_IRQ_TYPE_MSI	1
+#define PCI_EPF_ROCKET_IRQ_TYPE_MSIX	2
+
+#define PCI_EPF_ROCKET_CONTROL_ENABLE	BIT(0)
+
+#define PCI_EPF_ROCKET_STATUS_READY	BIT(0)
+#define PCI_EPF_ROCKET_STATUS_ERROR	BIT(1)
+
+#define PCI_EPF_ROCKET_OP_BO_CREATE	1
+#define PCI_EPF_ROCKET_OP_BO_DESTROY	2
+#define PCI_EPF_ROCKET_OP_BO_WRITE	3
+#define PCI_EPF_ROCKET_OP_BO_READ	4
+#define PCI_EPF_ROCKET_OP_SUBMIT	5
+
+#define PCI_EPF_ROCKET_DESC_FLAG_IRQ	BIT(0)
+
+#define PCI_EPF_ROCKET_DESC_DONE	BIT(0)
+
+#define PCI_EPF_ROCKET_MAX_RING_ENTRIES	1024
+#define PCI_EPF_ROCKET_MAX_JOB_SIZE	SZ_64K
+#define PCI_EPF_ROCKET_MAX_BO_SIZE	SZ_256M
+
+/**
+ * struct pci_epf_rocket_reg - Registers, at the start of the register BAR
+ * @magic: PCI_EPF_ROCKET_MAGIC, read-only
+ * @version: PCI_EPF_ROCKET_VERSION, read-only
+ * @control: PCI_EPF_ROCKET_CONTROL_* bits, written by the host
+ * @status: PCI_EPF_ROCKET_STATUS_* bits, written by the endpoint
+ * @ring_addr: Host address of the descriptor ring
+ * @ring_entries: Number of descriptors in the ring, a power of 2 up to
+ *		  PCI_EPF_ROCKET_MAX_RING_ENTRIES
+ * @ring_tail: Index of the next free descriptor, written by the host
+ * @ring_head: Index of the next descriptor to process, written by the
+ *	       endpoint
+ * @irq_type: PCI_EPF_ROCKET_IRQ_TYPE_* interrupt raised for the descriptors
+ * @irq_number: MSI or MSI-X vector raised for the descriptors
+ */
+struct pci_epf_rocket_reg {
+	__le32 magic;
+	__le32 version;
+	__le32 control;
+	__le32 status;
+	__le64 ring_addr;
+	__le32 ring_entries;
+	__le32 ring_tail;
+	__le32 ring_head;
+	__le32 irq_type;
+	__le32 irq_number;
+} __packed;
+
+/**
+ * struct pci_epf_rocket_desc - Descriptor of the ring, 64 bytes
+ * @opcode: PCI_EPF_ROCKET_OP_*
+ * @flags: PCI_EPF_ROCKET_DESC_FLAG_* bits
+ * @handle: Buffer handle, returned by BO_CREATE
+ * @status: Cleared by the host, PCI_EPF_ROCKET_DESC_DONE is set by the
+ *	    endpoint once the descriptor is processed
+ * @host_addr: Host address of the data to copy, or of the job
+ * @offset: Offset in the buffer of the data to copy
+ * @size: Size in bytes of the buffer, of the data to copy, or of the job
+ * @dma_addr: NPU address of the buffer, returned by BO_CREATE
+ * @result: 0 on success, a negative errno otherwise
+ * @reserved0: Must be zero
+ * @reserved1: Must be zero
+ */
+struct pci_epf_rocket_desc {
+	__le32 opcode;
+	__le32 flags;
+	__le32 handle;
+	__le32 status;
+	__le64 host_addr;
+	__le64 offset;
+	__le64 size;
+	__le64 dma_addr;
+	__le32 result;
+	__le32 reserved0;
+	__le64 reserved1;
+} __packed;
+
+/**
+ * struct pci_epf_rocket_task - Task of a job
+ * @regcmd: NPU address of the register commands of the task
+ * @regcmd_count: Number of register commands
+ * @reserved: Must be zero
+ */
+struct pci_epf_rocket_task {
+	__le64 regcmd;
+	__le32 regcmd_count;
+	__le32 reserved;
+} __packed;
+
+/**
+ * struct pci_epf_rocket_job - Header of a job
+ * @task_count: Number of tasks, at least one
+ * @in_bo_count: Number of buffers the job reads
+ * @out_bo_count: Number of buffers the job writes
+ * @reserved: Must be zero
+ *
+ * The header is followed by @task_count struct pci_epf_rocket_task, then by
+ * the __le32 handles of the @in_bo_count buffers read and of the
+ * @out_bo_count buffers written by the job. The buffers holding the
+ * register commands must be listed as read too, so that the transfers to
+ * them wait for the job.
+ */
+struct pci_epf_rocket_job {
+	__le32 task_count;
+	__le32 in_bo_count;
+	__le32 out_bo_count;
+	__le32 reserved;
+} __packed;
+
+#endif /* __LINUX_PCI_EPF_ROCKET_H */
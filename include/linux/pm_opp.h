@@ -183,6 +183,7 @@ int dev_pm_opp_unregister_notifier(struct device *dev, struct notifier_block *nb
 int dev_pm_opp_set_config(struct device *dev, struct dev_pm_opp_config *config);
 int devm_pm_opp_set_config(struct device *dev, struct dev_pm_opp_config *config);
 void dev_pm_opp_clear_config(int token);
+int devm_pm_opp_set_supported_hw_nvmem(struct device *dev, const char *cell_id);
 int dev_pm_opp_config_clks_simple(struct device *dev,
 		struct opp_table *opp_table, struct dev_pm_opp *opp, void *data,
 		bool scaling_down);
@@ -403,6 +404,12 @@ static inline int devm_pm_opp_set_config(struct device *dev, struct dev_pm_opp_c
 
 static inline void dev_pm_opp_clear_config(int token) {}
 
+static inline int devm_pm_opp_set_supported_hw_nvmem(struct device *dev,
+						     const char *cell_id)
+{
+	return 0;
+}
+
 static inline int dev_pm_opp_config_clks_simple(struct device *dev,
 		struct opp_table *opp_table, struct dev_pm_opp *opp, void *data,
 		bool scaling_down)
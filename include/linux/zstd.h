@@ -346,6 +346,43 @@ zstd_dctx *zstd_init_dctx(void *workspace, size_t workspace_size);
 size_t zstd_decompress_dctx(zstd_dctx *dctx, void *dst, size_t dst_capacity,
 	const void *src, size_t src_size);
 
+/**
+ * zstd_reserve_shared_dctx() - take a reference on the shared dctx pool
+ *
+ * The shared pool holds one decompression context per possible CPU and is
+ * meant for users that would otherwise each keep their own per-CPU contexts.
+ * The contexts are allocated by the first reservation and freed when the
+ * last reservation is released.  May sleep.
+ *
+ * Return:        0 on success or -ENOMEM.
+ */
+int zstd_reserve_shared_dctx(void);
+
+/**
+ * zstd_release_shared_dctx() - drop a reference on the shared dctx pool
+ *
+ * Must be paired with a successful zstd_reserve_shared_dctx().  May sleep.
+ */
+void zstd_release_shared_dctx(void);
+
+/**
+ * zstd_decompress_shared_dctx() - decompress src into dst using a shared dctx
+ * @dst:          The buffer to decompress src into.
+ * @dst_capacity: The size of the destination buffer. Must be at least as large
+ *                as the decompressed size.
+ * @src:          The zstd compressed data to decompress.
+ * @src_size:     The exact size of the data to decompress.
+ *
+ * Same as zstd_decompress_dctx(), but uses the context of the current CPU
+ * from the shared pool.  The caller must hold a reservation and be in a
+ * context that may sleep.
+ *
+ * Return:        The decompressed size or an error, which can be checked using
+ *                zstd_is_error().
+ */
+size_t zstd_decompress_shared_dctx(void *dst, size_t dst_capacity,
+	const void *src, size_t src_size);
+
 /**
  * struct zstd_ddict - Decompression dictionary.
  * See zstd_lib.h.
@@ -582,6 +582,9 @@ struct vb2_buf_ops {
  *		     for backward compatibility.
  * @queued_list: list of buffers currently queued from userspace
  * @queued_count: number of buffers queued and ready for streaming.
+ * @dmabuf_cache: dma-buf attachments kept mapped after userspace queued a
+ *		different dma-buf for their buffer, most recently used first
+ * @dmabuf_cache_len: number of entries on @dmabuf_cache
  * @owned_by_drv_count: number of buffers owned by the driver
  * @done_list:	list of buffers ready to be dequeued to userspace
  * @done_lock:	lock to protect done_list list
@@ -653,6 +656,9 @@ struct vb2_queue {
 	struct list_head		queued_list;
 	unsigned int			queued_count;
 
+	struct list_head		dmabuf_cache;
+	unsigned int			dmabuf_cache_len;
+
 	atomic_t			owned_by_drv_count;
 	struct list_head		done_list;
 	spinlock_t			done_lock;
@@ -6,6 +6,7 @@
 #define _TRACE_V4L2_H
 
 #include <linux/tracepoint.h>
+#include <media/v4l2-mem2mem.h>
 #include <media/videobuf2-v4l2.h>
 
 /* Enums require being exported to userspace, for user tool parsing */
@@ -262,6 +263,36 @@ DEFINE_EVENT(vb2_v4l2_event_class, vb2_v4l2_qbuf,
 	TP_ARGS(q, vb)
 );
 
+DECLARE_EVENT_CLASS(v4l2_m2m_job_class,
+	TP_PROTO(struct v4l2_m2m_ctx *m2m_ctx),
+	TP_ARGS(m2m_ctx),
+
+	TP_STRUCT__entry(
+		__field(const void *, ctx)
+	),
+
+	TP_fast_assign(
+		__entry->ctx = m2m_ctx;
+	),
+
+	TP_printk("ctx = %p", __entry->ctx)
+);
+
+DEFINE_EVENT(v4l2_m2m_job_class, v4l2_m2m_job_queue,
+	TP_PROTO(struct v4l2_m2m_ctx *m2m_ctx),
+	TP_ARGS(m2m_ctx)
+);
+
+DEFINE_EVENT(v4l2_m2m_job_class, v4l2_m2m_job_run,
+	TP_PROTO(struct v4l2_m2m_ctx *m2m_ctx),
+	TP_ARGS(m2m_ctx)
+);
+
+DEFINE_EVENT(v4l2_m2m_job_class, v4l2_m2m_job_finish,
+	TP_PROTO(struct v4l2_m2m_ctx *m2m_ctx),
+	TP_ARGS(m2m_ctx)
+);
+
 #endif /* if !defined(_TRACE_V4L2_H) || defined(TRACE_HEADER_MULTI_READ) */
 
 /* This part must be outside protection */
@@ -0,0 +1,197 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (C) 2023 Collabora ltd. */
+#ifndef _PANTHOR_DRM_H_
+#define _PANTHOR_DRM_H_
+
+#include "drm.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/*
+ * Only the BO madvise and performance counter interfaces are listed here.
+ * The rest of the Panthor uAPI (DEV_QUERY through TILER_HEAP_DESTROY, the
+ * argument structures and DRM_IOCTL_PANTHOR()) isn't part of this tree.
+ */
+
+/**
+ * DOC: IOCTL IDs
+ *
+ * enum drm_panthor_ioctl_id - IOCTL IDs
+ *
+ * Place new ioctls at the end, don't re-order, don't replace or remove entries.
+ *
+ * These IDs are not meant to be used directly. Use the DRM_IOCTL_PANTHOR_xxx
+ * definitions instead.
+ */
+enum drm_panthor_ioctl_id {
+	/* DRM_PANTHOR_DEV_QUERY (0) to DRM_PANTHOR_TILER_HEAP_DESTROY (12). */
+
+	/**
+	 * @DRM_PANTHOR_BO_MADVISE: Tell the kernel whether the content of a
+	 * buffer object can be discarded under memory pressure.
+	 */
+	DRM_PANTHOR_BO_MADVISE = 13,
+
+	/**
+	 * @DRM_PANTHOR_PERFCNT_ENABLE: Enable or disable GPU performance
+	 * counter sampling.
+	 */
+	DRM_PANTHOR_PERFCNT_ENABLE,
+
+	/**
+	 * @DRM_PANTHOR_PERFCNT_DUMP: Sample the GPU performance counters and
+	 * retrieve pending samples.
+	 */
+	DRM_PANTHOR_PERFCNT_DUMP,
+};
+
+/**
+ * enum drm_panthor_bo_madv - Buffer object memory advice
+ */
+enum drm_panthor_bo_madv {
+	/**
+	 * @DRM_PANTHOR_BO_MADV_WILLNEED: The buffer object content must be
+	 * preserved. This is the default state for new buffer objects.
+	 */
+	DRM_PANTHOR_BO_MADV_WILLNEED = 0,
+
+	/**
+	 * @DRM_PANTHOR_BO_MADV_DONTNEED: The buffer object content can be
+	 * discarded by the kernel under memory pressure.
+	 *
+	 * When the content is discarded, the buffer object is also unmapped
+	 * from all the VMs it was bound to, once it's idle. Any GPU or CPU
+	 * access to a discarded buffer object faults.
+	 */
+	DRM_PANTHOR_BO_MADV_DONTNEED = 1,
+};
+
+/**
+ * struct drm_panthor_bo_madvise - Arguments passed to DRM_IOCTL_PANTHOR_BO_MADVISE
+ */
+struct drm_panthor_bo_madvise {
+	/** @handle: Handle of the buffer object. */
+	__u32 handle;
+
+	/** @madv: One of the enum drm_panthor_bo_madv values. */
+	__u32 madv;
+
+	/**
+	 * @retained: Returned by the kernel. Zero if the buffer object content
+	 * was discarded, in which case it must be destroyed and re-created.
+	 */
+	__u32 retained;
+
+	/** @pad: MBZ. */
+	__u32 pad;
+};
+
+/**
+ * struct drm_panthor_perfcnt_enable - Arguments passed to DRM_IOCTL_PANTHOR_PERFCNT_ENABLE
+ *
+ * Performance counters are global to the GPU, and only one file can have them
+ * enabled at a time. Enabling them requires CAP_PERFMON or CAP_SYS_ADMIN.
+ *
+ * While counters are enabled, the GPU is kept powered.
+ */
+struct drm_panthor_perfcnt_enable {
+	/** @enable: 1 to enable counters, 0 to disable them. */
+	__u32 enable;
+
+	/**
+	 * @counter_set: Counter set to sample.
+	 *
+	 * 0 is the primary set, 1 the secondary set and 2 the tertiary set.
+	 * Ignored when @enable is 0.
+	 */
+	__u32 counter_set;
+
+	/**
+	 * @ring_size: Number of samples the kernel-side ring buffer can hold.
+	 *
+	 * Must be a power of two, not bigger than 128. Zero picks a default
+	 * size. Ignored when @enable is 0.
+	 */
+	__u32 ring_size;
+
+	/**
+	 * @sample_size: Size of a sample, in bytes.
+	 *
+	 * Returned by the kernel when counters are enabled. Samples are raw
+	 * counter dumps whose block layout is defined by the GPU
+	 * configuration reported by DRM_PANTHOR_DEV_QUERY_GPU_INFO.
+	 */
+	__u32 sample_size;
+};
+
+/**
+ * enum drm_panthor_perfcnt_dump_flags - Flags passed to DRM_IOCTL_PANTHOR_PERFCNT_DUMP
+ */
+enum drm_panthor_perfcnt_dump_flags {
+	/**
+	 * @DRM_PANTHOR_PERFCNT_DUMP_NO_SAMPLE: Don't take a new sample, only
+	 * retrieve the samples that are already pending.
+	 */
+	DRM_PANTHOR_PERFCNT_DUMP_NO_SAMPLE = 1 << 0,
+};
+
+/**
+ * enum drm_panthor_perfcnt_status - Status flags returned by DRM_IOCTL_PANTHOR_PERFCNT_DUMP
+ */
+enum drm_panthor_perfcnt_status {
+	/**
+	 * @DRM_PANTHOR_PERFCNT_STATUS_LOST: Samples were lost since the
+	 * previous dump, because the ring buffer overflowed or the GPU was
+	 * reset.
+	 */
+	DRM_PANTHOR_PERFCNT_STATUS_LOST = 1 << 0,
+};
+
+/**
+ * struct drm_panthor_perfcnt_dump - Arguments passed to DRM_IOCTL_PANTHOR_PERFCNT_DUMP
+ *
+ * Takes a new sample, unless DRM_PANTHOR_PERFCNT_DUMP_NO_SAMPLE is passed,
+ * and copies as many pending samples as @buf_size allows, oldest first.
+ * Samples that don't fit stay pending until the next dump.
+ */
+struct drm_panthor_perfcnt_dump {
+	/** @buf_ptr: User pointer to the buffer samples are copied to. */
+	__u64 buf_ptr;
+
+	/**
+	 * @buf_size: Size of the buffer pointed by @buf_ptr.
+	 *
+	 * Must be at least drm_panthor_perfcnt_enable::sample_size.
+	 */
+	__u32 buf_size;
+
+	/** @flags: Combination of drm_panthor_perfcnt_dump_flags flags. */
+	__u32 flags;
+
+	/** @sample_count: Returned by the kernel. Number of samples copied. */
+	__u32 sample_count;
+
+	/**
+	 * @status: Returned by the kernel. Combination of
+	 * drm_panthor_perfcnt_status flags.
+	 */
+	__u32 status;
+};
+
+enum {
+	/* DRM_IOCTL_PANTHOR_DEV_QUERY to DRM_IOCTL_PANTHOR_TILER_HEAP_DESTROY. */
+	DRM_IOCTL_PANTHOR_BO_MADVISE =
+		DRM_IOCTL_PANTHOR(WR, BO_MADVISE, bo_madvise),
+	DRM_IOCTL_PANTHOR_PERFCNT_ENABLE =
+		DRM_IOCTL_PANTHOR(WR, PERFCNT_ENABLE, perfcnt_enable),
+	DRM_IOCTL_PANTHOR_PERFCNT_DUMP =
+		DRM_IOCTL_PANTHOR(WR, PERFCNT_DUMP, perfcnt_dump),
+};
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* _PANTHOR_DRM_H_ */
@@ -0,0 +1,211 @@
+/* SPDX-License-Identifier: MIT */
+/*
+ * Copyright © 2024 Tomeu Vizoso
+ */
+#ifndef __DRM_UAPI_ROCKET_ACCEL_H__
+#define __DRM_UAPI_ROCKET_ACCEL_H__
+
+#include "drm.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define DRM_ROCKET_CREATE_BO			0x00
+#define DRM_ROCKET_SUBMIT			0x01
+#define DRM_ROCKET_PREP_BO			0x02
+#define DRM_ROCKET_FINI_BO			0x03
+#define DRM_ROCKET_SET_PRIORITY			0x04
+#define DRM_ROCKET_GET_BO_INFO			0x05
+
+#define DRM_IOCTL_ROCKET_CREATE_BO		DRM_IOWR(DRM_COMMAND_BASE + DRM_ROCKET_CREATE_BO, struct drm_rocket_create_bo)
+#define DRM_IOCTL_ROCKET_SUBMIT			DRM_IOW(DRM_COMMAND_BASE + DRM_ROCKET_SUBMIT, struct drm_rocket_submit)
+#define DRM_IOCTL_ROCKET_PREP_BO		DRM_IOW(DRM_COMMAND_BASE + DRM_ROCKET_PREP_BO, struct drm_rocket_prep_bo)
+#define DRM_IOCTL_ROCKET_FINI_BO		DRM_IOW(DRM_COMMAND_BASE + DRM_ROCKET_FINI_BO, struct drm_rocket_fini_bo)
+#define DRM_IOCTL_ROCKET_SET_PRIORITY		DRM_IOW(DRM_COMMAND_BASE + DRM_ROCKET_SET_PRIORITY, struct drm_rocket_set_priority)
+#define DRM_IOCTL_ROCKET_GET_BO_INFO		DRM_IOWR(DRM_COMMAND_BASE + DRM_ROCKET_GET_BO_INFO, struct drm_rocket_get_bo_info)
+
+/*
+ * The BO is only meant to be accessed by the NPU, or by the CPU through a
+ * write-combined mapping. No CPU cache maintenance is ever done for it, so
+ * DRM_IOCTL_ROCKET_PREP_BO only waits for the NPU to be done with it and
+ * DRM_IOCTL_ROCKET_FINI_BO does nothing.
+ */
+#define ROCKET_BO_WC		(1 << 0)
+
+/**
+ * struct drm_rocket_create_bo - ioctl argument for creating Rocket BOs.
+ *
+ */
+struct drm_rocket_create_bo {
+	/** Input: Size of the requested BO. */
+	__u32 size;
+
+	/** Output: GEM handle for the BO. */
+	__u32 handle;
+
+	/**
+	 * Output: DMA address for the BO in the NPU address space.  This address
+	 * is private to the DRM fd and is valid for the lifetime of the GEM
+	 * handle.
+	 */
+	__u64 dma_address;
+
+	/** Output: Offset into the drm node to use for subsequent mmap call. */
+	__u64 offset;
+
+	/** Input: Mask of ROCKET_BO_x flags. */
+	__u32 flags;
+
+	/** Reserved, must be zero. */
+	__u32 pad;
+};
+
+#define ROCKET_PREP_READ        0x01
+#define ROCKET_PREP_WRITE       0x02
+
+/**
+ * struct drm_rocket_prep_bo - ioctl argument for starting CPU ownership of the BO.
+ *
+ * Takes care of waiting for any NPU jobs that might still use the NPU and performs cache
+ * synchronization.
+ */
+struct drm_rocket_prep_bo {
+	/** Input: GEM handle of the buffer object. */
+	__u32 handle;
+
+	/** Input: mask of ROCKET_PREP_x, direction of the access. */
+	__u32 op;
+
+	/** Input: Amount of time to wait for NPU jobs. */
+	__s64 timeout_ns;
+};
+
+/**
+ * struct drm_rocket_fini_bo - ioctl argument for finishing CPU ownership of the BO.
+ *
+ * Synchronize caches for NPU access.
+ */
+struct drm_rocket_fini_bo {
+	/** Input: GEM handle of the buffer object. */
+	__u32 handle;
+
+	/** Reserved, must be zero. */
+	__u32 flags;
+};
+
+/**
+ * struct drm_rocket_task - A task to be run on the NPU
+ *
+ * A task is the smallest unit of work that can be run on the NPU.
+ */
+struct drm_rocket_task {
+	/** Input: DMA address to NPU mapping of register command buffer */
+	__u64 regcmd;
+
+	/** Input: Number of commands in the register command buffer */
+	__u32 regcmd_count;
+};
+
+/**
+ * struct drm_rocket_job - A job to be run on the NPU
+ *
+ * The kernel will schedule the execution of this job taking into account its
+ * dependencies with other jobs. All tasks in the same job will be executed
+ * sequentially on the same core, to benefit from memory residency in SRAM.
+ */
+struct drm_rocket_job {
+	/** Input: Pointer to an array of struct drm_rocket_task. */
+	__u64 tasks;
+
+	/** Input: Pointer to a u32 array of the BOs that are read by the job. */
+	__u64 in_bo_handles;
+
+	/** Input: Pointer to a u32 array of the BOs that are written to by the job. */
+	__u64 out_bo_handles;
+
+	/** Input: Number of tasks passed in. */
+	__u32 task_count;
+
+	/** Input: Number of input BO handles passed in (size is that times 4). */
+	__u32 in_bo_handle_count;
+
+	/** Input: Number of output BO handles passed in (size is that times 4). */
+	__u32 out_bo_handle_count;
+};
+
+/**
+ * struct drm_rocket_submit - ioctl argument for submitting commands to the NPU.
+ *
+ * The kernel will schedule the execution of these jobs in dependency order.
+ */
+struct drm_rocket_submit {
+	/** Input: Pointer to an array of struct drm_rocket_job. */
+	__u64 jobs;
+
+	/** Input: Number of jobs passed in. */
+	__u32 job_count;
+};
+
+/**
+ * enum drm_rocket_priority - Scheduling priority of the jobs of a DRM fd
+ */
+enum drm_rocket_priority {
+	/** @ROCKET_PRIORITY_LOW: Low priority, for batch work. */
+	ROCKET_PRIORITY_LOW = 0,
+
+	/** @ROCKET_PRIORITY_MEDIUM: Medium priority, the default. */
+	ROCKET_PRIORITY_MEDIUM,
+
+	/**
+	 * @ROCKET_PRIORITY_HIGH: High priority.
+	 *
+	 * Requires CAP_SYS_NICE or DRM_MASTER. Jobs with this priority take
+	 * over a core running a job of a lower priority at its next task
+	 * boundary.
+	 */
+	ROCKET_PRIORITY_HIGH,
+};
+
+/**
+ * struct drm_rocket_set_priority - ioctl argument for setting the priority
+ * of the jobs submitted through a DRM fd.
+ *
+ * Must be called before the first job is submitted, -EBUSY is returned
+ * otherwise.
+ */
+struct drm_rocket_set_priority {
+	/** Input: One of enum drm_rocket_priority. */
+	__u32 priority;
+
+	/** Reserved, must be zero. */
+	__u32 pad;
+};
+
+/**
+ * struct drm_rocket_get_bo_info - ioctl argument for querying a BO.
+ *
+ * Mostly useful for BOs imported from a dma-buf with
+ * DRM_IOCTL_PRIME_FD_TO_HANDLE, which don't go through
+ * DRM_IOCTL_ROCKET_CREATE_BO. Imported buffers must be contiguous in the
+ * NPU address space, the import fails with -EINVAL otherwise.
+ */
+struct drm_rocket_get_bo_info {
+	/** Input: GEM handle of the BO. */
+	__u32 handle;
+
+	/** Reserved, must be zero. */
+	__u32 pad;
+
+	/** Output: DMA address of the BO in the NPU address space. */
+	__u64 dma_address;
+
+	/** Output: Offset into the drm node to use for subsequent mmap call. */
+	__u64 offset;
+};
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* __DRM_UAPI_ROCKET_ACCEL_H__ */
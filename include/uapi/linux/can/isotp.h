@@ -67,6 +67,11 @@
 
 #define CAN_ISOTP_LL_OPTS	5	/* pass struct can_isotp_ll_options */
 
+#define CAN_ISOTP_TX_BURST	6	/* pass __u32 value in frames      */
+					/* max. consecutive frames queued  */
+					/* at once when the receiver does  */
+					/* not request a STmin separation  */
+
 struct can_isotp_options {
 
 	__u32 flags;		/* set flags for isotp behaviour.	*/
@@ -166,6 +171,15 @@ struct can_isotp_ll_options {
 #define CAN_ISOTP_DEFAULT_LL_TX_DL	CAN_MAX_DLEN
 #define CAN_ISOTP_DEFAULT_LL_TX_FLAGS	0
 
+/*
+ * Queueing several consecutive frames at once avoids waiting for the local
+ * echo of each frame before sending the next one. The value should not
+ * exceed the tx queue length of the CAN interface, it is limited to 15 to
+ * keep the sequence numbers of the frames in flight distinct.
+ */
+#define CAN_ISOTP_DEFAULT_TX_BURST	1
+#define CAN_ISOTP_MAX_TX_BURST		15
+
 /*
  * The CAN_ISOTP_DEFAULT_FRAME_TXTIME has become a non-zero value as
  * it only makes sense for isotp implementation tests to run without
@@ -654,6 +654,9 @@ enum io_uring_register_op {
 
 	IORING_REGISTER_MEM_REGION		= 34,
 
+	/* set io-wq worker placement policy */
+	IORING_REGISTER_IOWQ_POLICY		= 35,
+
 	/* this goes last */
 	IORING_REGISTER_LAST,
 
@@ -667,6 +670,23 @@ enum io_wq_type {
 	IO_WQ_UNBOUND,
 };
 
+/*
+ * io-wq worker placement, for IORING_REGISTER_IOWQ_POLICY.
+ *
+ * CAPACITY: on systems with CPUs of different capacities, run bound
+ * workers on the CPUs above the lowest capacity and unbound workers on the
+ * lowest capacity ones, within the io-wq affinity.
+ */
+enum io_uring_iowq_policy {
+	IORING_IOWQ_POLICY_DEFAULT,
+	IORING_IOWQ_POLICY_CAPACITY,
+};
+
+struct io_uring_iowq_policy_reg {
+	__u32	policy;
+	__u32	__resv[3];
+};
+
 /* deprecated, see struct io_uring_rsrc_update */
 struct io_uring_files_update {
 	__u32 offset;
@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: ((GPL-2.0+ WITH Linux-syscall-note) OR MIT) */
+/*
+ * Synopsys DesignWare HDMI RX controller userspace API
+ */
+
+#ifndef _UAPI_SNPS_HDMIRX_H
+#define _UAPI_SNPS_HDMIRX_H
+
+#include <linux/types.h>
+#include <linux/videodev2.h>
+
+/*
+ * Sent while a progressive frame is being captured, once its first lines
+ * have been written to the buffer. Lets a consumer sharing the buffer
+ * start processing the top of the frame before the capture completes.
+ */
+#define V4L2_EVENT_SNPS_HDMIRX_PARTIAL_FRAME	(V4L2_EVENT_PRIVATE_START + 0x1)
+
+/**
+ * struct v4l2_event_snps_hdmirx_partial_frame - partial frame event payload
+ *
+ * @index:	index of the buffer being captured
+ * @sequence:	sequence number the buffer gets if the frame completes
+ * @lines:	number of lines written to the buffer so far
+ * @height:	height of the frame
+ */
+struct v4l2_event_snps_hdmirx_partial_frame {
+	__u32 index;
+	__u32 sequence;
+	__u32 lines;
+	__u32 height;
+};
+
+/*
+ * Sent when the audio capture path starts delivering samples to the I2S
+ * interface. The event timestamp and the ALSA trigger timestamp both use
+ * CLOCK_MONOTONIC, which lets a consumer line up the first audio period
+ * with the video frame carrying @sequence.
+ */
+#define V4L2_EVENT_SNPS_HDMIRX_AUDIO_START	(V4L2_EVENT_PRIVATE_START + 0x2)
+
+/**
+ * struct v4l2_event_snps_hdmirx_audio_start - audio start event payload
+ *
+ * @sequence:	sequence number of the video frame being captured
+ * @rate:	audio sample rate in Hz, measured from the ACR packets
+ * @channels:	number of audio channels
+ */
+struct v4l2_event_snps_hdmirx_audio_start {
+	__u32 sequence;
+	__u32 rate;
+	__u32 channels;
+};
+
+#endif /* _UAPI_SNPS_HDMIRX_H */
@@ -11,9 +11,12 @@
 
 #include "io_uring.h"
 #include "sqpoll.h"
+#include "tctx.h"
 #include "fdinfo.h"
 #include "cancel.h"
 #include "rsrc.h"
+#include "kbuf.h"
+#include "napi.h"
 
 #ifdef CONFIG_PROC_FS
 static __cold int io_uring_show_cred(struct seq_file *m, unsigned int id,
@@ -58,6 +61,7 @@ static __cold void common_tracking_show_fdinfo(struct io_ring_ctx *ctx,
 		seq_puts(m, "napi_prefer_busy_poll:\ttrue\n");
 	else
 		seq_puts(m, "napi_prefer_busy_poll:\tfalse\n");
+	io_napi_show_fdinfo(ctx, m);
 }
 
 static __cold void napi_show_fdinfo(struct io_ring_ctx *ctx,
@@ -86,6 +90,24 @@ static inline void napi_show_fdinfo(struct io_ring_ctx *ctx,
 }
 #endif
 
+static __cold void io_uring_show_iowq(struct io_ring_ctx *ctx,
+				       struct seq_file *m)
+{
+	struct io_tctx_node *node;
+
+	seq_printf(m, "IoWqPolicy:\t%s\n",
+		   ctx->iowq_policy == IORING_IOWQ_POLICY_CAPACITY ?
+		   "capacity" : "default");
+	list_for_each_entry(node, &ctx->tctx_list, ctx_node) {
+		struct io_uring_task *tctx = node->task->io_uring;
+
+		if (!tctx || !tctx->io_wq)
+			continue;
+		seq_printf(m, "IoWq:\t%d\n", task_pid_nr(node->task));
+		io_wq_show_fdinfo(tctx->io_wq, m);
+	}
+}
+
 static void __io_uring_show_fdinfo(struct io_ring_ctx *ctx, struct seq_file *m)
 {
 	struct io_overflow_cqe *ocqe;
@@ -214,6 +236,7 @@ static void __io_uring_show_fdinfo(struct io_ring_ctx *ctx, struct seq_file *m)
 		else
 			seq_printf(m, "%5u: <none>\n", i);
 	}
+	io_kbuf_show_fdinfo(ctx, m);
 	if (!xa_empty(&ctx->personalities)) {
 		unsigned long index;
 		const struct cred *cred;
@@ -243,6 +266,7 @@ static void __io_uring_show_fdinfo(struct io_ring_ctx *ctx, struct seq_file *m)
 
 	}
 	spin_unlock(&ctx->completion_lock);
+	io_uring_show_iowq(ctx, m);
 	napi_show_fdinfo(ctx, m);
 }
 
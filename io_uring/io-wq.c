@@ -17,6 +17,8 @@
 #include <linux/task_work.h>
 #include <linux/audit.h>
 #include <linux/mmu_context.h>
+#include <linux/sched/topology.h>
+#include <linux/seq_file.h>
 #include <uapi/linux/io_uring.h>
 
 #include "io-wq.h"
@@ -85,6 +87,9 @@ struct io_wq_acct {
 	unsigned max_workers;
 	atomic_t nr_running;
 
+	/* workers created since the io_wq was set up, for fdinfo */
+	unsigned nr_created;
+
 	/**
 	 * The list of free workers.  Protected by #workers_lock
 	 * (write) and RCU (read).
@@ -100,6 +105,12 @@ struct io_wq_acct {
 	raw_spinlock_t lock;
 	struct io_wq_work_list work_list;
 	unsigned long flags;
+
+	/*
+	 * CPUs the workers of this acct run on, wq->cpu_mask narrowed down
+	 * by the placement policy.
+	 */
+	cpumask_var_t cpu_mask;
 };
 
 enum {
@@ -133,6 +144,7 @@ struct io_wq {
 	struct io_wq_work *hash_tail[IO_WQ_NR_HASH_BUCKETS];
 
 	cpumask_var_t cpu_mask;
+	unsigned int policy;
 };
 
 static enum cpuhp_state io_wq_online;
@@ -695,7 +707,7 @@ static int io_wq_worker(void *data)
 		if (!ret) {
 			last_timeout = true;
 			exit_mask = !cpumask_test_cpu(raw_smp_processor_id(),
-							wq->cpu_mask);
+							acct->cpu_mask);
 		}
 	}
 
@@ -747,12 +759,13 @@ static void io_init_new_worker(struct io_wq *wq, struct io_wq_acct *acct, struct
 {
 	tsk->worker_private = worker;
 	worker->task = tsk;
-	set_cpus_allowed_ptr(tsk, wq->cpu_mask);
+	set_cpus_allowed_ptr(tsk, acct->cpu_mask);
 
 	raw_spin_lock(&acct->workers_lock);
 	hlist_nulls_add_head_rcu(&worker->nulls_node, &acct->free_list);
 	list_add_tail_rcu(&worker->all_list, &acct->all_list);
 	set_bit(IO_WORKER_F_FREE, &worker->flags);
+	acct->nr_created++;
 	raw_spin_unlock(&acct->workers_lock);
 	wake_up_new_task(tsk);
 }
@@ -1190,6 +1203,56 @@ static int io_wq_hash_wake(struct wait_queue_entry *wait, unsigned mode,
 	return 1;
 }
 
+/*
+ * On asymmetric systems, split @src between the CPUs of the lowest capacity
+ * and the others. Bound work is on regular files and block devices, and
+ * keeps the CPU busy copying and checksumming data: place it on the faster
+ * CPUs. Unbound work mostly sleeps waiting on sockets, pipes and the like,
+ * the slower CPUs are good enough for that. Returns false if all the CPUs
+ * of @src have the same capacity.
+ */
+static bool io_wq_capacity_mask(const struct cpumask *src, struct cpumask *dst,
+				bool bound)
+{
+	unsigned long min_cap = ULONG_MAX, max_cap = 0;
+	int cpu;
+
+	for_each_cpu(cpu, src) {
+		unsigned long cap = arch_scale_cpu_capacity(cpu);
+
+		min_cap = min(min_cap, cap);
+		max_cap = max(max_cap, cap);
+	}
+
+	if (min_cap >= max_cap)
+		return false;
+
+	cpumask_clear(dst);
+	for_each_cpu(cpu, src) {
+		if ((arch_scale_cpu_capacity(cpu) > min_cap) == bound)
+			cpumask_set_cpu(cpu, dst);
+	}
+	return true;
+}
+
+/*
+ * Derive the worker masks from wq->cpu_mask. Running workers keep their
+ * affinity, like for IORING_REGISTER_IOWQ_AFF they exit on idle timeout if
+ * they ended up outside of their new mask, and get replaced as needed.
+ */
+static void io_wq_update_acct_masks(struct io_wq *wq)
+{
+	for (int i = 0; i < IO_WQ_ACCT_NR; i++) {
+		struct io_wq_acct *acct = &wq->acct[i];
+
+		if (wq->policy == IORING_IOWQ_POLICY_CAPACITY &&
+		    io_wq_capacity_mask(wq->cpu_mask, acct->cpu_mask,
+					i == IO_WQ_ACCT_BOUND))
+			continue;
+		cpumask_copy(acct->cpu_mask, wq->cpu_mask);
+	}
+}
+
 struct io_wq *io_wq_create(unsigned bounded, struct io_wq_data *data)
 {
 	int ret, i;
@@ -1222,6 +1285,8 @@ struct io_wq *io_wq_create(unsigned bounded, struct io_wq_data *data)
 	for (i = 0; i < IO_WQ_ACCT_NR; i++) {
 		struct io_wq_acct *acct = &wq->acct[i];
 
+		if (!alloc_cpumask_var(&acct->cpu_mask, GFP_KERNEL))
+			goto err;
 		atomic_set(&acct->nr_running, 0);
 
 		raw_spin_lock_init(&acct->workers_lock);
@@ -1231,6 +1296,7 @@ struct io_wq *io_wq_create(unsigned bounded, struct io_wq_data *data)
 		INIT_WQ_LIST(&acct->work_list);
 		raw_spin_lock_init(&acct->lock);
 	}
+	io_wq_update_acct_masks(wq);
 
 	wq->task = get_task_struct(data->task);
 	atomic_set(&wq->worker_refs, 1);
@@ -1242,6 +1308,8 @@ struct io_wq *io_wq_create(unsigned bounded, struct io_wq_data *data)
 	return wq;
 err:
 	io_wq_put_hash(data->hash);
+	for (i = 0; i < IO_WQ_ACCT_NR; i++)
+		free_cpumask_var(wq->acct[i].cpu_mask);
 	free_cpumask_var(wq->cpu_mask);
 	kfree(wq);
 	return ERR_PTR(ret);
@@ -1310,6 +1378,8 @@ static void io_wq_destroy(struct io_wq *wq)
 
 	cpuhp_state_remove_instance_nocalls(io_wq_online, &wq->cpuhp_node);
 	io_wq_cancel_pending_work(wq, &match);
+	for (int i = 0; i < IO_WQ_ACCT_NR; i++)
+		free_cpumask_var(wq->acct[i].cpu_mask);
 	free_cpumask_var(wq->cpu_mask);
 	io_wq_put_hash(wq->hash);
 	kfree(wq);
@@ -1349,6 +1419,7 @@ static int __io_wq_cpu_online(struct io_wq *wq, unsigned int cpu, bool online)
 	rcu_read_lock();
 	io_wq_for_each_worker(wq, io_wq_worker_affinity, &od);
 	rcu_read_unlock();
+	io_wq_update_acct_masks(wq);
 	return 0;
 }
 
@@ -1387,6 +1458,8 @@ int io_wq_cpu_affinity(struct io_uring_task *tctx, cpumask_var_t mask)
 	} else {
 		cpumask_copy(tctx->io_wq->cpu_mask, allowed_mask);
 	}
+	if (!ret)
+		io_wq_update_acct_masks(tctx->io_wq);
 	rcu_read_unlock();
 
 	free_cpumask_var(allowed_mask);
@@ -1433,6 +1506,56 @@ int io_wq_max_workers(struct io_wq *wq, int *new_count)
 	return 0;
 }
 
+int io_wq_set_policy(struct io_wq *wq, unsigned int policy)
+{
+	if (policy > IORING_IOWQ_POLICY_CAPACITY)
+		return -EINVAL;
+
+	wq->policy = policy;
+	io_wq_update_acct_masks(wq);
+	return 0;
+}
+
+#ifdef CONFIG_PROC_FS
+void io_wq_show_fdinfo(struct io_wq *wq, struct seq_file *m)
+{
+	static const char * const names[IO_WQ_ACCT_NR] = {
+		[IO_WQ_ACCT_BOUND]	= "Bound",
+		[IO_WQ_ACCT_UNBOUND]	= "Unbound",
+	};
+
+	for (int i = 0; i < IO_WQ_ACCT_NR; i++) {
+		struct io_wq_acct *acct = &wq->acct[i];
+		struct io_wq_work_node *node, *prev;
+		unsigned int nr_free = 0, nr_pending = 0;
+		unsigned int nr_workers, max_workers, nr_created;
+		struct hlist_nulls_node *n;
+		struct io_worker *worker;
+
+		rcu_read_lock();
+		hlist_nulls_for_each_entry_rcu(worker, n, &acct->free_list, nulls_node)
+			nr_free++;
+		rcu_read_unlock();
+
+		raw_spin_lock(&acct->workers_lock);
+		nr_workers = acct->nr_workers;
+		max_workers = acct->max_workers;
+		nr_created = acct->nr_created;
+		raw_spin_unlock(&acct->workers_lock);
+
+		raw_spin_lock(&acct->lock);
+		wq_list_for_each(node, prev, &acct->work_list)
+			nr_pending++;
+		raw_spin_unlock(&acct->lock);
+
+		seq_printf(m, "  %s:	workers:%u/%u, running:%d, free:%u, pending:%u, created:%u, cpus:%*pbl\n",
+			   names[i], nr_workers, max_workers,
+			   atomic_read(&acct->nr_running), nr_free, nr_pending,
+			   nr_created, cpumask_pr_args(acct->cpu_mask));
+	}
+}
+#endif
+
 static __init int io_wq_init(void)
 {
 	int ret;
@@ -7,6 +7,7 @@
 #include <linux/slab.h>
 #include <linux/namei.h>
 #include <linux/poll.h>
+#include <linux/seq_file.h>
 #include <linux/vmalloc.h>
 #include <linux/io_uring.h>
 
@@ -41,11 +42,13 @@ static bool io_kbuf_inc_commit(struct io_buffer_list *bl, int len)
 		buf = io_ring_head_to_buf(bl->buf_ring, bl->head, bl->mask);
 		this_len = min_t(int, len, buf->len);
 		buf->len -= this_len;
+		bl->bytes_committed += this_len;
 		if (buf->len) {
 			buf->addr += this_len;
 			return false;
 		}
 		bl->head++;
+		bl->nr_committed++;
 		len -= this_len;
 	}
 	return true;
@@ -64,6 +67,8 @@ bool io_kbuf_commit(struct io_kiocb *req,
 	if (bl->flags & IOBL_INC)
 		return io_kbuf_inc_commit(bl, len);
 	bl->head += nr;
+	bl->nr_committed += nr;
+	bl->bytes_committed += len;
 	return true;
 }
 
@@ -133,6 +138,7 @@ static void __user *io_provided_buffer_select(struct io_kiocb *req, size_t *len,
 		req->buf_index = kbuf->bid;
 		return u64_to_user_ptr(kbuf->addr);
 	}
+	bl->nr_enobufs++;
 	return NULL;
 }
 
@@ -161,8 +167,10 @@ static void __user *io_ring_buffer_select(struct io_kiocb *req, size_t *len,
 	void __user *ret;
 
 	tail = smp_load_acquire(&br->tail);
-	if (unlikely(tail == head))
+	if (unlikely(tail == head)) {
+		bl->nr_enobufs++;
 		return NULL;
+	}
 
 	if (head + 1 == tail)
 		req->flags |= REQ_F_BL_EMPTY;
@@ -227,8 +235,10 @@ static int io_ring_buffers_peek(struct io_kiocb *req, struct buf_sel_arg *arg,
 	tail = smp_load_acquire(&br->tail);
 	head = bl->head;
 	nr_avail = min_t(__u16, tail - head, UIO_MAXIOV);
-	if (unlikely(!nr_avail))
+	if (unlikely(!nr_avail)) {
+		bl->nr_enobufs++;
 		return -ENOBUFS;
+	}
 
 	buf = io_ring_head_to_buf(br, head, bl->mask);
 	if (arg->max_len) {
@@ -738,3 +748,27 @@ struct io_mapped_region *io_pbuf_get_region(struct io_ring_ctx *ctx,
 		return NULL;
 	return &bl->region;
 }
+
+void io_kbuf_show_fdinfo(struct io_ring_ctx *ctx, struct seq_file *m)
+{
+	struct io_buffer_list *bl;
+	unsigned long index;
+
+	lockdep_assert_held(&ctx->uring_lock);
+
+	seq_puts(m, "BufGroups:\n");
+	xa_for_each(&ctx->io_bl_xa, index, bl) {
+		u64 avg = 0;
+
+		if (bl->nr_committed)
+			avg = div64_u64(bl->bytes_committed, bl->nr_committed);
+		seq_printf(m, "%5u: %s enobufs=%llu", bl->bgid,
+			   bl->flags & IOBL_BUF_RING ? "ring" : "legacy",
+			   bl->nr_enobufs);
+		if (bl->flags & IOBL_BUF_RING)
+			seq_printf(m, " entries=%u bufs=%llu bytes=%llu avg_fill=%llu",
+				   bl->nr_entries, bl->nr_committed,
+				   bl->bytes_committed, avg);
+		seq_putc(m, '\n');
+	}
+}
@@ -5,6 +5,8 @@
 #include <uapi/linux/io_uring.h>
 #include <linux/io_uring_types.h>
 
+struct seq_file;
+
 enum {
 	/* ring mapped provided buffers */
 	IOBL_BUF_RING	= 1,
@@ -31,6 +33,11 @@ struct io_buffer_list {
 
 	__u16 flags;
 
+	/* statistics, protected by ->uring_lock like the rest of this */
+	u64 nr_enobufs;
+	u64 nr_committed;
+	u64 bytes_committed;
+
 	struct io_mapped_region region;
 };
 
@@ -73,6 +80,7 @@ int io_provide_buffers(struct io_kiocb *req, unsigned int issue_flags);
 int io_register_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg);
 int io_unregister_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg);
 int io_register_pbuf_status(struct io_ring_ctx *ctx, void __user *arg);
+void io_kbuf_show_fdinfo(struct io_ring_ctx *ctx, struct seq_file *m);
 
 bool io_kbuf_recycle_legacy(struct io_kiocb *req, unsigned issue_flags);
 void io_kbuf_drop_legacy(struct io_kiocb *req);
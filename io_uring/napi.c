@@ -1,5 +1,7 @@
 // SPDX-License-Identifier: GPL-2.0
 
+#include <linux/seq_file.h>
+
 #include "io_uring.h"
 #include "napi.h"
 
@@ -8,6 +10,9 @@
 /* Timeout for cleanout of stale entries. */
 #define NAPI_TIMEOUT		(60 * SEC_CONVERSION)
 
+/* Max number of busy poll passes an idle entry gets skipped for. */
+#define NAPI_MAX_BACKOFF	16U
+
 struct io_napi_entry {
 	unsigned int		napi_id;
 	struct list_head	list;
@@ -15,6 +20,18 @@ struct io_napi_entry {
 	unsigned long		timeout;
 	struct hlist_node	node;
 
+	/*
+	 * Busy poll statistics, only counting the polls done with no
+	 * work pending. An entry whose poll produced no new work gets
+	 * skipped for an exponentially growing number of passes, reset
+	 * as soon as a poll hits again. Updates are racy
+	 * between concurrent pollers, which is fine for a heuristic.
+	 */
+	unsigned long		polls;
+	unsigned long		hits;
+	unsigned int		backoff;
+	unsigned int		skip;
+
 	struct rcu_head		rcu;
 };
 
@@ -63,6 +80,10 @@ int __io_napi_add_id(struct io_ring_ctx *ctx, unsigned int napi_id)
 
 	e->napi_id = napi_id;
 	e->timeout = jiffies + NAPI_TIMEOUT;
+	e->polls = 0;
+	e->hits = 0;
+	e->backoff = 0;
+	e->skip = 0;
 
 	/*
 	 * guard(spinlock) is not used to manually unlock it before calling
@@ -157,6 +178,49 @@ static bool io_napi_busy_loop_should_end(void *data,
 	return false;
 }
 
+/*
+ * Busy poll a single entry. A NULL @loop_end means the entry is polled once
+ * per pass over the list, in which case entries that keep coming up empty
+ * are skipped for a while.
+ */
+static void io_napi_entry_busy_loop(struct io_ring_ctx *ctx,
+				    struct io_napi_entry *e,
+				    bool (*loop_end)(void *, unsigned long),
+				    void *loop_end_arg)
+{
+	unsigned int backoff;
+	bool had_work;
+
+	if (!loop_end && READ_ONCE(e->skip)) {
+		WRITE_ONCE(e->skip, e->skip - 1);
+		return;
+	}
+
+	had_work = io_task_work_pending(ctx);
+	napi_busy_loop_rcu(e->napi_id, loop_end, loop_end_arg,
+			   ctx->napi_prefer_busy_poll, BUSY_POLL_BUDGET);
+
+	/*
+	 * Work left pending by an earlier entry hides whether this one
+	 * produced any, so only score the entry when it polled with no
+	 * work pending.
+	 */
+	if (had_work)
+		return;
+
+	WRITE_ONCE(e->polls, e->polls + 1);
+
+	if (io_task_work_pending(ctx)) {
+		WRITE_ONCE(e->hits, e->hits + 1);
+		WRITE_ONCE(e->backoff, 0);
+	} else if (!loop_end) {
+		backoff = min(max(2 * READ_ONCE(e->backoff), 1U),
+			      NAPI_MAX_BACKOFF);
+		WRITE_ONCE(e->backoff, backoff);
+		WRITE_ONCE(e->skip, backoff);
+	}
+}
+
 /*
  * never report stale entries
  */
@@ -167,8 +231,7 @@ static bool static_tracking_do_busy_loop(struct io_ring_ctx *ctx,
 	struct io_napi_entry *e;
 
 	list_for_each_entry_rcu(e, &ctx->napi_list, list)
-		napi_busy_loop_rcu(e->napi_id, loop_end, loop_end_arg,
-				   ctx->napi_prefer_busy_poll, BUSY_POLL_BUDGET);
+		io_napi_entry_busy_loop(ctx, e, loop_end, loop_end_arg);
 	return false;
 }
 
@@ -181,8 +244,7 @@ dynamic_tracking_do_busy_loop(struct io_ring_ctx *ctx,
 	bool is_stale = false;
 
 	list_for_each_entry_rcu(e, &ctx->napi_list, list) {
-		napi_busy_loop_rcu(e->napi_id, loop_end, loop_end_arg,
-				   ctx->napi_prefer_busy_poll, BUSY_POLL_BUDGET);
+		io_napi_entry_busy_loop(ctx, e, loop_end, loop_end_arg);
 
 		if (time_after(jiffies, READ_ONCE(e->timeout)))
 			is_stale = true;
@@ -393,4 +455,21 @@ int io_napi_sqpoll_busy_poll(struct io_ring_ctx *ctx)
 	return 1;
 }
 
+/*
+ * io_napi_show_fdinfo() - Show per napi id busy poll statistics
+ * @ctx: pointer to io-uring context structure
+ * @m: seq_file to print to
+ */
+void io_napi_show_fdinfo(struct io_ring_ctx *ctx, struct seq_file *m)
+{
+	struct io_napi_entry *e;
+
+	seq_puts(m, "napi ids:\n");
+	guard(rcu)();
+	list_for_each_entry_rcu(e, &ctx->napi_list, list)
+		seq_printf(m, "%5u: polls=%lu hits=%lu backoff=%u\n",
+			   e->napi_id, READ_ONCE(e->polls),
+			   READ_ONCE(e->hits), READ_ONCE(e->backoff));
+}
+
 #endif
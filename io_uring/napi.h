@@ -7,6 +7,8 @@
 #include <linux/io_uring.h>
 #include <net/busy_poll.h>
 
+struct seq_file;
+
 #ifdef CONFIG_NET_RX_BUSY_POLL
 
 void io_napi_init(struct io_ring_ctx *ctx);
@@ -19,6 +21,7 @@ int __io_napi_add_id(struct io_ring_ctx *ctx, unsigned int napi_id);
 
 void __io_napi_busy_loop(struct io_ring_ctx *ctx, struct io_wait_queue *iowq);
 int io_napi_sqpoll_busy_poll(struct io_ring_ctx *ctx);
+void io_napi_show_fdinfo(struct io_ring_ctx *ctx, struct seq_file *m);
 
 static inline bool io_napi(struct io_ring_ctx *ctx)
 {
@@ -254,6 +254,57 @@ static __cold int io_unregister_iowq_aff(struct io_ring_ctx *ctx)
 	return __io_register_iowq_aff(ctx, NULL);
 }
 
+static __cold int io_register_iowq_policy(struct io_ring_ctx *ctx,
+					  void __user *arg)
+	__must_hold(&ctx->uring_lock)
+{
+	struct io_uring_iowq_policy_reg reg;
+	struct io_tctx_node *node;
+	struct io_uring_task *tctx;
+	struct io_sq_data *sqd;
+	int ret = 0;
+
+	if (copy_from_user(&reg, arg, sizeof(reg)))
+		return -EFAULT;
+	if (memchr_inv(&reg.__resv, 0, sizeof(reg.__resv)))
+		return -EINVAL;
+	if (reg.policy > IORING_IOWQ_POLICY_CAPACITY)
+		return -EINVAL;
+
+	ctx->iowq_policy = reg.policy;
+
+	if (!(ctx->flags & IORING_SETUP_SQPOLL)) {
+		/* propagate to all registered users, new ones pick it up */
+		list_for_each_entry(node, &ctx->tctx_list, ctx_node) {
+			tctx = node->task->io_uring;
+			if (WARN_ON_ONCE(!tctx->io_wq))
+				continue;
+			(void)io_wq_set_policy(tctx->io_wq, reg.policy);
+		}
+		return 0;
+	}
+
+	/* only the SQPOLL task creates requests, see max_workers */
+	sqd = ctx->sq_data;
+	if (!sqd)
+		return 0;
+
+	refcount_inc(&sqd->refs);
+	mutex_unlock(&ctx->uring_lock);
+	mutex_lock(&sqd->lock);
+	mutex_lock(&ctx->uring_lock);
+	if (sqd->thread) {
+		tctx = sqd->thread->io_uring;
+		if (tctx && tctx->io_wq)
+			ret = io_wq_set_policy(tctx->io_wq, reg.policy);
+	}
+	mutex_unlock(&ctx->uring_lock);
+	mutex_unlock(&sqd->lock);
+	io_put_sq_data(sqd);
+	mutex_lock(&ctx->uring_lock);
+	return ret;
+}
+
 static __cold int io_register_iowq_max_workers(struct io_ring_ctx *ctx,
 					       void __user *arg)
 	__must_hold(&ctx->uring_lock)
@@ -754,6 +805,12 @@ static int __io_uring_register(struct io_ring_ctx *ctx, unsigned opcode,
 			break;
 		ret = io_register_iowq_max_workers(ctx, arg);
 		break;
+	case IORING_REGISTER_IOWQ_POLICY:
+		ret = -EINVAL;
+		if (!arg || nr_args != 1)
+			break;
+		ret = io_register_iowq_policy(ctx, arg);
+		break;
 	case IORING_REGISTER_RING_FDS:
 		ret = io_ringfd_register(ctx, arg, nr_args);
 		break;
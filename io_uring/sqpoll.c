@@ -325,6 +325,9 @@ static int io_sq_thread(void *data)
 			if (sqt_spin) {
 				io_sq_update_worktime(sqd, &start);
 				timeout = jiffies + sqd->sq_thread_idle;
+			} else {
+				/* idle spin waiting for new SQEs */
+				cpu_relax();
 			}
 			if (unlikely(need_resched())) {
 				mutex_unlock(&sqd->lock);
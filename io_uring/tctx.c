@@ -123,6 +123,11 @@ int __io_uring_add_tctx_node(struct io_ring_ctx *ctx)
 			if (ret)
 				return ret;
 		}
+		if (ctx->iowq_policy) {
+			ret = io_wq_set_policy(tctx->io_wq, ctx->iowq_policy);
+			if (ret)
+				return ret;
+		}
 	}
 	if (!xa_load(&tctx->xa, (unsigned long)ctx)) {
 		node = kmalloc(sizeof(*node), GFP_KERNEL);
@@ -409,6 +409,11 @@ int io_register_zcrx_ifq(struct io_ring_ctx *ctx,
 		goto err;
 	get_device(ifq->dev);
 
+	/*
+	 * The queue has to be restartable with a memory provider and has to
+	 * split headers. net_iovs are not readable by the stack, so headers
+	 * must land in host memory. Drivers without that are refused here.
+	 */
 	mp_param.mp_ops = &io_uring_pp_zc_ops;
 	mp_param.mp_priv = ifq;
 	ret = net_mp_open_rxq(ifq->netdev, reg.if_rxq, &mp_param);
@@ -45,6 +45,12 @@
 #include <linux/dma-map-ops.h>
 #include <linux/cma.h>
 #include <linux/nospec.h>
+#include <linux/bitmap.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/timekeeping.h>
 
 #ifdef CONFIG_CMA_SIZE_MBYTES
 #define CMA_SIZE_MBYTES CONFIG_CMA_SIZE_MBYTES
@@ -90,6 +96,61 @@ static int __init early_cma(char *p)
 }
 early_param("cma", early_cma);
 
+/* Allocation latency buckets: < 100us, < 1ms, < 10ms, < 100ms, more */
+#define DMA_CMA_NR_LATENCY	5
+
+/*
+ * Per area state: allocation statistics, and for the areas declared
+ * exclusive in the device tree, the pages taken out of the area at boot
+ * and handed out to its devices without going through CMA again.
+ */
+struct dma_contiguous_area {
+	struct cma		*cma;
+	bool			exclusive;
+
+	/* exclusive areas, set once at boot */
+	struct page		*pages;
+	unsigned long		nr_pages;
+	unsigned long		*bitmap;
+	spinlock_t		lock;
+
+	atomic_long_t		nr_allocs;
+	atomic_long_t		nr_fails;
+	atomic64_t		total_ns;
+	u64			max_ns;
+	atomic_long_t		latency[DMA_CMA_NR_LATENCY];
+};
+
+static struct dma_contiguous_area dma_contiguous_areas[MAX_CMA_AREAS];
+static unsigned int dma_contiguous_nr_areas;
+
+static struct dma_contiguous_area * __init dma_contiguous_add_area(struct cma *cma)
+{
+	struct dma_contiguous_area *area;
+
+	if (dma_contiguous_nr_areas == ARRAY_SIZE(dma_contiguous_areas))
+		return NULL;
+
+	area = &dma_contiguous_areas[dma_contiguous_nr_areas++];
+	area->cma = cma;
+	spin_lock_init(&area->lock);
+	return area;
+}
+
+static struct dma_contiguous_area *dma_contiguous_find_area(struct cma *cma)
+{
+	unsigned int i;
+
+	if (!cma)
+		return NULL;
+
+	for (i = 0; i < dma_contiguous_nr_areas; i++) {
+		if (dma_contiguous_areas[i].cma == cma)
+			return &dma_contiguous_areas[i];
+	}
+	return NULL;
+}
+
 #ifdef CONFIG_DMA_NUMA_CMA
 
 static struct cma *dma_contiguous_numa_area[MAX_NUMNODES];
@@ -179,6 +240,8 @@ static void __init dma_numa_cma_reserve(void)
 			if (ret)
 				pr_warn("%s: reservation failed: err %d, node %d", __func__,
 					ret, nid);
+			else
+				dma_contiguous_add_area(*cma);
 		}
 
 		if (numa_cma_size[nid]) {
@@ -190,6 +253,8 @@ static void __init dma_numa_cma_reserve(void)
 			if (ret)
 				pr_warn("%s: reservation failed: err %d, node %d", __func__,
 					ret, nid);
+			else
+				dma_contiguous_add_area(*cma);
 		}
 	}
 }
@@ -284,9 +349,194 @@ int __init dma_contiguous_reserve_area(phys_addr_t size, phys_addr_t base,
 	/* Architecture specific contiguous memory fixup. */
 	dma_contiguous_early_fixup(cma_get_base(*res_cma),
 				cma_get_size(*res_cma));
+	dma_contiguous_add_area(*res_cma);
+
+	return 0;
+}
+
+static struct page *
+dma_contiguous_alloc_exclusive(struct dma_contiguous_area *area,
+			       struct page *pages, unsigned long count,
+			       unsigned int align)
+{
+	unsigned long mask = (1UL << align) - 1;
+	unsigned long offset = page_to_pfn(pages) & mask;
+	unsigned long start;
+
+	spin_lock(&area->lock);
+	start = bitmap_find_next_zero_area_off(area->bitmap, area->nr_pages, 0,
+					       count, mask, offset);
+	if (start >= area->nr_pages) {
+		spin_unlock(&area->lock);
+		return NULL;
+	}
+	bitmap_set(area->bitmap, start, count);
+	spin_unlock(&area->lock);
+
+	return nth_page(pages, start);
+}
+
+static void dma_contiguous_account(struct dma_contiguous_area *area,
+				   struct page *page, u64 ns)
+{
+	static const u64 limits[DMA_CMA_NR_LATENCY - 1] = {
+		100 * NSEC_PER_USEC, NSEC_PER_MSEC,
+		10 * NSEC_PER_MSEC, 100 * NSEC_PER_MSEC,
+	};
+	int i;
+
+	if (!page) {
+		atomic_long_inc(&area->nr_fails);
+		return;
+	}
+
+	atomic_long_inc(&area->nr_allocs);
+	atomic64_add(ns, &area->total_ns);
+	/* racy, but good enough for statistics */
+	if (ns > data_race(area->max_ns))
+		WRITE_ONCE(area->max_ns, ns);
+
+	for (i = 0; i < ARRAY_SIZE(limits); i++) {
+		if (ns < limits[i])
+			break;
+	}
+	atomic_long_inc(&area->latency[i]);
+}
+
+static struct page *dma_contiguous_alloc(struct cma *cma, unsigned long count,
+					 unsigned int align, bool no_warn)
+{
+	struct dma_contiguous_area *area = dma_contiguous_find_area(cma);
+	struct page *pages = area ? smp_load_acquire(&area->pages) : NULL;
+	u64 start = ktime_get_ns();
+	struct page *page;
+
+	if (pages)
+		page = dma_contiguous_alloc_exclusive(area, pages, count, align);
+	else
+		page = cma_alloc(cma, count, align, no_warn);
+
+	if (area)
+		dma_contiguous_account(area, page, ktime_get_ns() - start);
+	return page;
+}
+
+static bool dma_contiguous_release(struct cma *cma, const struct page *page,
+				   unsigned long count)
+{
+	struct dma_contiguous_area *area = dma_contiguous_find_area(cma);
+	struct page *pages = area ? smp_load_acquire(&area->pages) : NULL;
+	unsigned long pfn, base;
+
+	if (!pages)
+		return cma_release(cma, page, count);
+
+	pfn = page_to_pfn(page);
+	base = page_to_pfn(pages);
+	if (pfn < base || pfn >= base + area->nr_pages)
+		return false;
+	if (WARN_ON(pfn + count > base + area->nr_pages))
+		return false;
+
+	spin_lock(&area->lock);
+	bitmap_clear(area->bitmap, pfn - base, count);
+	spin_unlock(&area->lock);
+	return true;
+}
+
+/*
+ * Take the exclusive areas out of CMA while memory is still mostly free, so
+ * that their devices never wait for page migration. Runs after the CMA areas
+ * got activated, and before most devices probe.
+ */
+static int __init dma_contiguous_take_exclusive_areas(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < dma_contiguous_nr_areas; i++) {
+		struct dma_contiguous_area *area = &dma_contiguous_areas[i];
+		unsigned long nr_pages;
+		struct page *pages;
+
+		if (!area->exclusive)
+			continue;
+
+		nr_pages = cma_get_size(area->cma) >> PAGE_SHIFT;
+		area->bitmap = bitmap_zalloc(nr_pages, GFP_KERNEL);
+		if (!area->bitmap)
+			goto fail;
+
+		pages = cma_alloc(area->cma, nr_pages, 0, false);
+		if (!pages) {
+			bitmap_free(area->bitmap);
+			area->bitmap = NULL;
+			goto fail;
+		}
+
+		area->nr_pages = nr_pages;
+		smp_store_release(&area->pages, pages);
+		continue;
+fail:
+		pr_warn("%s: unable to take exclusive area, falling back to CMA\n",
+			cma_get_name(area->cma));
+	}
 
 	return 0;
 }
+postcore_initcall(dma_contiguous_take_exclusive_areas);
+
+#ifdef CONFIG_DEBUG_FS
+static int dma_contiguous_stats_show(struct seq_file *s, void *unused)
+{
+	static const char * const buckets[DMA_CMA_NR_LATENCY] = {
+		"<100us", "<1ms", "<10ms", "<100ms", ">=100ms",
+	};
+	struct dma_contiguous_area *area = s->private;
+	long nr_allocs = atomic_long_read(&area->nr_allocs);
+	struct page *pages = smp_load_acquire(&area->pages);
+	int i;
+
+	seq_printf(s, "allocs: %ld\n", nr_allocs);
+	seq_printf(s, "fails: %ld\n", atomic_long_read(&area->nr_fails));
+	seq_printf(s, "avg_latency_us: %llu\n",
+		   nr_allocs ? div_u64(atomic64_read(&area->total_ns), nr_allocs) /
+			       NSEC_PER_USEC : 0);
+	seq_printf(s, "max_latency_us: %llu\n",
+		   div_u64(READ_ONCE(area->max_ns), NSEC_PER_USEC));
+	seq_puts(s, "latency:");
+	for (i = 0; i < DMA_CMA_NR_LATENCY; i++)
+		seq_printf(s, " %s:%ld", buckets[i], atomic_long_read(&area->latency[i]));
+	seq_putc(s, '\n');
+
+	if (pages) {
+		unsigned long used;
+
+		spin_lock(&area->lock);
+		used = bitmap_weight(area->bitmap, area->nr_pages);
+		spin_unlock(&area->lock);
+		seq_printf(s, "exclusive: %lu/%lu pages used\n", used, area->nr_pages);
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(dma_contiguous_stats);
+
+static int __init dma_contiguous_debugfs_init(void)
+{
+	struct dentry *root = debugfs_create_dir("dma_contiguous", NULL);
+	unsigned int i;
+
+	for (i = 0; i < dma_contiguous_nr_areas; i++) {
+		struct dma_contiguous_area *area = &dma_contiguous_areas[i];
+
+		debugfs_create_file(cma_get_name(area->cma), 0444, root, area,
+				    &dma_contiguous_stats_fops);
+	}
+
+	return 0;
+}
+late_initcall(dma_contiguous_debugfs_init);
+#endif /* CONFIG_DEBUG_FS */
 
 /**
  * dma_alloc_from_contiguous() - allocate pages from contiguous area
@@ -306,7 +556,7 @@ struct page *dma_alloc_from_contiguous(struct device *dev, size_t count,
 	if (align > CONFIG_CMA_ALIGNMENT)
 		align = CONFIG_CMA_ALIGNMENT;
 
-	return cma_alloc(dev_get_cma_area(dev), count, align, no_warn);
+	return dma_contiguous_alloc(dev_get_cma_area(dev), count, align, no_warn);
 }
 
 /**
@@ -322,14 +572,15 @@ struct page *dma_alloc_from_contiguous(struct device *dev, size_t count,
 bool dma_release_from_contiguous(struct device *dev, struct page *pages,
 				 int count)
 {
-	return cma_release(dev_get_cma_area(dev), pages, count);
+	return dma_contiguous_release(dev_get_cma_area(dev), pages, count);
 }
 
 static struct page *cma_alloc_aligned(struct cma *cma, size_t size, gfp_t gfp)
 {
 	unsigned int align = min(get_order(size), CONFIG_CMA_ALIGNMENT);
 
-	return cma_alloc(cma, size >> PAGE_SHIFT, align, gfp & __GFP_NOWARN);
+	return dma_contiguous_alloc(cma, size >> PAGE_SHIFT, align,
+				    gfp & __GFP_NOWARN);
 }
 
 /**
@@ -403,7 +654,7 @@ void dma_free_contiguous(struct device *dev, struct page *page, size_t size)
 
 	/* if dev has its own cma, free page from there */
 	if (dev->cma_area) {
-		if (cma_release(dev->cma_area, page, count))
+		if (dma_contiguous_release(dev->cma_area, page, count))
 			return;
 	} else {
 		/*
@@ -417,7 +668,7 @@ void dma_free_contiguous(struct device *dev, struct page *page, size_t size)
 					page, count))
 			return;
 #endif
-		if (cma_release(dma_contiguous_default_area, page, count))
+		if (dma_contiguous_release(dma_contiguous_default_area, page, count))
 			return;
 	}
 
@@ -457,6 +708,8 @@ static int __init rmem_cma_setup(struct reserved_mem *rmem)
 {
 	unsigned long node = rmem->fdt_node;
 	bool default_cma = of_get_flat_dt_prop(node, "linux,cma-default", NULL);
+	bool exclusive = of_get_flat_dt_prop(node, "linux,cma-exclusive", NULL);
+	struct dma_contiguous_area *area;
 	struct cma *cma;
 	int err;
 
@@ -475,6 +728,13 @@ static int __init rmem_cma_setup(struct reserved_mem *rmem)
 		return -EINVAL;
 	}
 
+	/* the default area also serves cma_alloc() users outside of DMA */
+	if (exclusive && default_cma) {
+		pr_warn("Reserved memory: %s: default CMA area can't be exclusive\n",
+			rmem->name);
+		exclusive = false;
+	}
+
 	err = cma_init_reserved_mem(rmem->base, rmem->size, 0, rmem->name, &cma);
 	if (err) {
 		pr_err("Reserved memory: unable to setup CMA region\n");
@@ -486,6 +746,10 @@ static int __init rmem_cma_setup(struct reserved_mem *rmem)
 	if (default_cma)
 		dma_contiguous_default_area = cma;
 
+	area = dma_contiguous_add_area(cma);
+	if (area)
+		area->exclusive = exclusive;
+
 	rmem->ops = &rmem_cma_ops;
 	rmem->priv = cma;
 
@@ -8,6 +8,8 @@
 #include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/device.h>
+#include <linux/dma-direct.h>
+#include <linux/dma-map-ops.h>
 #include <linux/dma-mapping.h>
 #include <linux/kernel.h>
 #include <linux/kthread.h>
@@ -16,9 +18,20 @@
 #include <linux/module.h>
 #include <linux/pci.h>
 #include <linux/platform_device.h>
+#include <linux/scatterlist.h>
 #include <linux/slab.h>
+#include <linux/swiotlb.h>
 #include <linux/timekeeping.h>
 
+/*
+ * Binaries built before dma_mode and the results after granule were added
+ * pass the original, smaller struct map_benchmark.  _IOWR() encodes its size,
+ * so they issue a different command.
+ */
+#define MAP_BENCHMARK_V1_SIZE	offsetof(struct map_benchmark, bounced)
+#define DMA_MAP_BENCHMARK_V1	_IOC(_IOC_READ | _IOC_WRITE, 'd', 1, \
+				     MAP_BENCHMARK_V1_SIZE)
+
 struct map_benchmark_data {
 	struct map_benchmark bparam;
 	struct device *dev;
@@ -28,26 +41,94 @@ struct map_benchmark_data {
 	atomic64_t sum_unmap_100ns;
 	atomic64_t sum_sq_map;
 	atomic64_t sum_sq_unmap;
+	atomic64_t sum_bounce_map_100ns;
+	atomic64_t bounced;
+	atomic64_t map_hist[DMA_MAP_HIST_BUCKETS];
+	atomic64_t unmap_hist[DMA_MAP_HIST_BUCKETS];
 	atomic64_t loops;
 };
 
+/*
+ * Only direct mappings are checked, with an IOMMU the DMA address says
+ * nothing about the physical address behind it.
+ */
+static bool map_benchmark_bounced(struct device *dev, dma_addr_t dma_addr)
+{
+	if (use_dma_iommu(dev) || get_dma_ops(dev))
+		return false;
+
+	return is_swiotlb_buffer(dev, dma_to_phys(dev, dma_addr));
+}
+
+static void map_benchmark_free_sgt(struct sg_table *sgt)
+{
+	struct scatterlist *sg;
+	int i;
+
+	for_each_sgtable_sg(sgt, sg, i)
+		if (sg_page(sg))
+			__free_page(sg_page(sg));
+	sg_free_table(sgt);
+}
+
+/* One page per entry, so the table has as many entries as the granule */
+static int map_benchmark_alloc_sgt(struct sg_table *sgt, int npages)
+{
+	struct scatterlist *sg;
+	int i, ret;
+
+	ret = sg_alloc_table(sgt, npages, GFP_KERNEL);
+	if (ret)
+		return ret;
+
+	for_each_sgtable_sg(sgt, sg, i) {
+		struct page *page = alloc_page(GFP_KERNEL);
+
+		if (!page) {
+			map_benchmark_free_sgt(sgt);
+			return -ENOMEM;
+		}
+		sg_set_page(sg, page, PAGE_SIZE, 0);
+	}
+
+	return 0;
+}
+
+static void map_benchmark_hist_add(atomic64_t *hist, u64 val_100ns)
+{
+	unsigned int bucket = min(fls64(val_100ns), DMA_MAP_HIST_BUCKETS - 1);
+
+	atomic64_inc(&hist[bucket]);
+}
+
 static int map_benchmark_thread(void *data)
 {
-	void *buf;
+	void *buf = NULL;
 	dma_addr_t dma_addr;
 	struct map_benchmark_data *map = data;
+	bool sg_mode = map->bparam.dma_mode == DMA_MAP_SG_MODE;
 	int npages = map->bparam.granule;
 	u64 size = npages * PAGE_SIZE;
+	struct sg_table sgt = { };
+	struct scatterlist *sg;
 	int ret = 0;
+	int i;
 
-	buf = alloc_pages_exact(size, GFP_KERNEL);
-	if (!buf)
-		return -ENOMEM;
+	if (sg_mode) {
+		ret = map_benchmark_alloc_sgt(&sgt, npages);
+		if (ret)
+			return ret;
+	} else {
+		buf = alloc_pages_exact(size, GFP_KERNEL);
+		if (!buf)
+			return -ENOMEM;
+	}
 
 	while (!kthread_should_stop())  {
 		u64 map_100ns, unmap_100ns, map_sq, unmap_sq;
 		ktime_t map_stime, map_etime, unmap_stime, unmap_etime;
 		ktime_t map_delta, unmap_delta;
+		bool bounced;
 
 		/*
 		 * for a non-coherent device, if we don't stain them in the
@@ -55,25 +136,46 @@ static int map_benchmark_thread(void *data)
 		 * overhead of BIDIRECTIONAL or TO_DEVICE mappings;
 		 * 66 means evertything goes well! 66 is lucky.
 		 */
-		if (map->dir != DMA_FROM_DEVICE)
-			memset(buf, 0x66, size);
+		if (map->dir != DMA_FROM_DEVICE) {
+			if (sg_mode) {
+				for_each_sgtable_sg(&sgt, sg, i)
+					memset(sg_virt(sg), 0x66, sg->length);
+			} else {
+				memset(buf, 0x66, size);
+			}
+		}
 
 		map_stime = ktime_get();
-		dma_addr = dma_map_single(map->dev, buf, size, map->dir);
-		if (unlikely(dma_mapping_error(map->dev, dma_addr))) {
-			pr_err("dma_map_single failed on %s\n",
-				dev_name(map->dev));
-			ret = -ENOMEM;
-			goto out;
+		if (sg_mode) {
+			ret = dma_map_sgtable(map->dev, &sgt, map->dir, 0);
+			if (unlikely(ret)) {
+				pr_err("dma_map_sgtable failed on %s\n",
+					dev_name(map->dev));
+				goto out;
+			}
+			dma_addr = sg_dma_address(sgt.sgl);
+		} else {
+			dma_addr = dma_map_single(map->dev, buf, size, map->dir);
+			if (unlikely(dma_mapping_error(map->dev, dma_addr))) {
+				pr_err("dma_map_single failed on %s\n",
+					dev_name(map->dev));
+				ret = -ENOMEM;
+				goto out;
+			}
 		}
 		map_etime = ktime_get();
 		map_delta = ktime_sub(map_etime, map_stime);
 
+		bounced = map_benchmark_bounced(map->dev, dma_addr);
+
 		/* Pretend DMA is transmitting */
 		ndelay(map->bparam.dma_trans_ns);
 
 		unmap_stime = ktime_get();
-		dma_unmap_single(map->dev, dma_addr, size, map->dir);
+		if (sg_mode)
+			dma_unmap_sgtable(map->dev, &sgt, map->dir, 0);
+		else
+			dma_unmap_single(map->dev, dma_addr, size, map->dir);
 		unmap_etime = ktime_get();
 		unmap_delta = ktime_sub(unmap_etime, unmap_stime);
 
@@ -88,6 +190,12 @@ static int map_benchmark_thread(void *data)
 		atomic64_add(unmap_100ns, &map->sum_unmap_100ns);
 		atomic64_add(map_sq, &map->sum_sq_map);
 		atomic64_add(unmap_sq, &map->sum_sq_unmap);
+		if (bounced) {
+			atomic64_add(map_100ns, &map->sum_bounce_map_100ns);
+			atomic64_inc(&map->bounced);
+		}
+		map_benchmark_hist_add(map->map_hist, map_100ns);
+		map_benchmark_hist_add(map->unmap_hist, unmap_100ns);
 		atomic64_inc(&map->loops);
 
 		/*
@@ -108,7 +216,10 @@ static int map_benchmark_thread(void *data)
 	}
 
 out:
-	free_pages_exact(buf, size);
+	if (sg_mode)
+		map_benchmark_free_sgt(&sgt);
+	else
+		free_pages_exact(buf, size);
 	return ret;
 }
 
@@ -147,6 +258,12 @@ static int do_map_benchmark(struct map_benchmark_data *map)
 	atomic64_set(&map->sum_unmap_100ns, 0);
 	atomic64_set(&map->sum_sq_map, 0);
 	atomic64_set(&map->sum_sq_unmap, 0);
+	atomic64_set(&map->sum_bounce_map_100ns, 0);
+	atomic64_set(&map->bounced, 0);
+	for (i = 0; i < DMA_MAP_HIST_BUCKETS; i++) {
+		atomic64_set(&map->map_hist[i], 0);
+		atomic64_set(&map->unmap_hist[i], 0);
+	}
 	atomic64_set(&map->loops, 0);
 
 	for (i = 0; i < threads; i++) {
@@ -188,6 +305,18 @@ static int do_map_benchmark(struct map_benchmark_data *map)
 				map->bparam.avg_unmap_100ns;
 		map->bparam.map_stddev = int_sqrt64(map_variance);
 		map->bparam.unmap_stddev = int_sqrt64(unmap_variance);
+
+		/* share and latency of the maps which were bounced */
+		map->bparam.bounced = atomic64_read(&map->bounced);
+		if (map->bparam.bounced)
+			map->bparam.avg_bounce_map_100ns =
+				div64_u64(atomic64_read(&map->sum_bounce_map_100ns),
+					  map->bparam.bounced);
+	}
+
+	for (i = 0; i < DMA_MAP_HIST_BUCKETS; i++) {
+		map->bparam.map_hist[i] = atomic64_read(&map->map_hist[i]);
+		map->bparam.unmap_hist[i] = atomic64_read(&map->unmap_hist[i]);
 	}
 
 out:
@@ -201,14 +330,23 @@ static long map_benchmark_ioctl(struct file *file, unsigned int cmd,
 {
 	struct map_benchmark_data *map = file->private_data;
 	void __user *argp = (void __user *)arg;
+	size_t size = sizeof(map->bparam);
 	u64 old_dma_mask;
 	int ret;
 
-	if (copy_from_user(&map->bparam, argp, sizeof(map->bparam)))
+	if (cmd == DMA_MAP_BENCHMARK_V1)
+		size = MAP_BENCHMARK_V1_SIZE;
+
+	memset(&map->bparam, 0, sizeof(map->bparam));
+	if (copy_from_user(&map->bparam, argp, size))
 		return -EFAULT;
+	/* dma_mode was padding in the v1 layout, don't take it from there */
+	if (cmd == DMA_MAP_BENCHMARK_V1)
+		map->bparam.dma_mode = DMA_MAP_SINGLE_MODE;
 
 	switch (cmd) {
 	case DMA_MAP_BENCHMARK:
+	case DMA_MAP_BENCHMARK_V1:
 		if (map->bparam.threads == 0 ||
 		    map->bparam.threads > DMA_MAP_MAX_THREADS) {
 			pr_err("invalid thread number\n");
@@ -238,6 +376,12 @@ static long map_benchmark_ioctl(struct file *file, unsigned int cmd,
 			return -EINVAL;
 		}
 
+		if (map->bparam.dma_mode != DMA_MAP_SINGLE_MODE &&
+		    map->bparam.dma_mode != DMA_MAP_SG_MODE) {
+			pr_err("invalid map mode\n");
+			return -EINVAL;
+		}
+
 		switch (map->bparam.dma_dir) {
 		case DMA_MAP_BIDIRECTIONAL:
 			map->dir = DMA_BIDIRECTIONAL;
@@ -280,7 +424,7 @@ static long map_benchmark_ioctl(struct file *file, unsigned int cmd,
 		return -EINVAL;
 	}
 
-	if (copy_to_user(argp, &map->bparam, sizeof(map->bparam)))
+	if (copy_to_user(argp, &map->bparam, size))
 		return -EFAULT;
 
 	return ret;
@@ -19,6 +19,7 @@
 #include <linux/sched/rt.h>
 #include <linux/sched/task.h>
 #include <linux/sched/isolation.h>
+#include <linux/sched/topology.h>
 #include <uapi/linux/sched/types.h>
 #include <linux/task_work.h>
 
@@ -222,6 +223,39 @@ static inline void irq_validate_effective_affinity(struct irq_data *data) { }
 
 static DEFINE_PER_CPU(struct cpumask, __tmp_mask);
 
+/*
+ * On systems with asymmetric CPU capacities, optionally steer interrupts
+ * which have no user supplied affinity to the biggest CPUs of their
+ * affinity mask, so that completion handling does not end up on the
+ * slowest cores.
+ */
+static bool irq_affinity_capacity __read_mostly;
+
+static int __init irq_affinity_capacity_setup(char *str)
+{
+	irq_affinity_capacity = true;
+	return 1;
+}
+__setup("irqaffinity_capacity", irq_affinity_capacity_setup);
+
+/*
+ * Reduce @mask, which must only contain online CPUs, to the CPUs with the
+ * highest capacity in it. A mask with uniform capacities is left alone.
+ */
+static void irq_capacity_reduce_mask(struct cpumask *mask)
+{
+	unsigned long max_cap = 0;
+	unsigned int cpu;
+
+	for_each_cpu(cpu, mask)
+		max_cap = max(max_cap, arch_scale_cpu_capacity(cpu));
+
+	for_each_cpu(cpu, mask) {
+		if (arch_scale_cpu_capacity(cpu) < max_cap)
+			cpumask_clear_cpu(cpu, mask);
+	}
+}
+
 int irq_do_set_affinity(struct irq_data *data, const struct cpumask *mask,
 			bool force)
 {
@@ -268,6 +302,19 @@ int irq_do_set_affinity(struct irq_data *data, const struct cpumask *mask,
 		prog_mask = mask;
 	}
 
+	/*
+	 * The spreading of managed interrupts does not know about CPU
+	 * capacities. Target only the biggest online CPUs of the mask, the
+	 * full mask is still stored so that hotplug can pick the next best
+	 * CPUs.
+	 */
+	if (irq_affinity_capacity && irqd_affinity_is_managed(data)) {
+		cpumask_and(tmp_mask, prog_mask, cpu_online_mask);
+		irq_capacity_reduce_mask(tmp_mask);
+		if (!cpumask_empty(tmp_mask))
+			prog_mask = tmp_mask;
+	}
+
 	/*
 	 * Make sure we only provide online CPUs to the irqchip,
 	 * unless we are being asked to force the affinity (in which
@@ -630,6 +677,16 @@ int irq_setup_affinity(struct irq_desc *desc)
 		if (cpumask_intersects(&mask, nodemask))
 			cpumask_and(&mask, &mask, nodemask);
 	}
+
+	/*
+	 * Managed interrupts are handled in irq_do_set_affinity() without
+	 * changing the stored mask, a user supplied affinity is kept as is.
+	 */
+	if (irq_affinity_capacity &&
+	    !irqd_affinity_is_managed(&desc->irq_data) &&
+	    !irqd_has_set(&desc->irq_data, IRQD_AFFINITY_SET))
+		irq_capacity_reduce_mask(&mask);
+
 	ret = irq_do_set_affinity(&desc->irq_data, &mask, false);
 	raw_spin_unlock(&mask_lock);
 	return ret;
@@ -47,6 +47,15 @@ LOCK_EVENT(lock_use_node2)	/* # of locking ops that use 2nd percpu node */
 LOCK_EVENT(lock_use_node3)	/* # of locking ops that use 3rd percpu node */
 LOCK_EVENT(lock_use_node4)	/* # of locking ops that use 4th percpu node */
 LOCK_EVENT(lock_no_node)	/* # of locking ops w/o using percpu node    */
+
+#ifdef CONFIG_CLUSTER_AWARE_SPINLOCKS
+/*
+ * Locking events for the cluster aware (CNA) qspinlock.
+ */
+LOCK_EVENT(lock_cna_defer)	/* # of waiters moved to the secondary queue */
+LOCK_EVENT(lock_cna_intra)	/* # of hand-offs skipping remote waiters    */
+LOCK_EVENT(lock_cna_flush)	/* # of secondary queue flushes on threshold */
+#endif /* CONFIG_CLUSTER_AWARE_SPINLOCKS */
 #endif /* CONFIG_QUEUED_SPINLOCKS */
 
 /*
@@ -19,6 +19,7 @@
 #include <linux/mutex.h>
 #include <linux/rwsem.h>
 #include <linux/smp.h>
+#include <linux/topology.h>
 #include <linux/interrupt.h>
 #include <linux/sched.h>
 #include <uapi/linux/sched/types.h>
@@ -115,10 +116,12 @@ static struct task_struct **reader_tasks;
 static bool lock_is_write_held;
 static atomic_t lock_is_read_held;
 static unsigned long last_lock_release;
+static int last_lock_cluster = -1;
 
 struct lock_stress_stats {
 	long n_lock_fail;
 	long n_lock_acquired;
+	long n_lock_cross_cluster;
 };
 
 struct call_rcu_chain {
@@ -890,6 +893,31 @@ static struct lock_torture_ops percpu_rwsem_lock_ops = {
 	.name		= "percpu_rwsem_lock"
 };
 
+/*
+ * CPU cluster, as used by the cluster aware qspinlock: the cluster level
+ * of the topology if there is one, the package otherwise.
+ */
+static int lock_torture_cpu_cluster(int cpu)
+{
+	int cluster = topology_cluster_id(cpu);
+
+	return cluster >= 0 ? cluster : topology_physical_package_id(cpu);
+}
+
+/*
+ * Count the write acquisitions that moved the lock to another cluster
+ * than the one of the previous writer, which is what cluster aware lock
+ * hand-off tries to reduce.  Called with the write lock held.
+ */
+static void lock_torture_track_cluster(struct lock_stress_stats *lwsp)
+{
+	int cluster = lock_torture_cpu_cluster(raw_smp_processor_id());
+
+	if (last_lock_cluster >= 0 && cluster != last_lock_cluster)
+		lwsp->n_lock_cross_cluster++;
+	last_lock_cluster = cluster;
+}
+
 /*
  * Lock torture writer kthread.  Repeatedly acquires and releases
  * the lock, checking for duplicate acquisitions.
@@ -944,6 +972,7 @@ static int lock_torture_writer(void *arg)
 					  __func__, j1 - j);
 			}
 			lwsp->n_lock_acquired++;
+			lock_torture_track_cluster(lwsp);
 
 			cxt.cur_ops->write_delay(&rand);
 
@@ -1005,7 +1034,7 @@ static void __torture_print_stats(char *page,
 	bool fail = false;
 	int i, n_stress;
 	long max = 0, min = statp ? data_race(statp[0].n_lock_acquired) : 0;
-	long long sum = 0;
+	long long sum = 0, cross = 0;
 
 	n_stress = write ? cxt.nrealwriters_stress : cxt.nrealreaders_stress;
 	for (i = 0; i < n_stress; i++) {
@@ -1013,6 +1042,7 @@ static void __torture_print_stats(char *page,
 			fail = true;
 		cur = data_race(statp[i].n_lock_acquired);
 		sum += cur;
+		cross += data_race(statp[i].n_lock_cross_cluster);
 		if (max < cur)
 			max = cur;
 		if (min > cur)
@@ -1024,6 +1054,9 @@ static void __torture_print_stats(char *page,
 			sum, max, min,
 			!onoff_interval && max / 2 > min ? "???" : "",
 			fail, fail ? "!!!" : "");
+	if (write)
+		page += sprintf(page, "Writes:  Cross-cluster hand-offs: %lld (%lld%%)\n",
+				cross, sum ? cross * 100 / sum : 0);
 	if (fail)
 		atomic_inc(&cxt.n_lock_torture_errors);
 }
@@ -1289,6 +1322,7 @@ static int __init lock_torture_init(void)
 	/* Initialize the statistics so that each run gets its own numbers. */
 	if (nwriters_stress) {
 		lock_is_write_held = false;
+		last_lock_cluster = -1;
 		cxt.lwsa = kmalloc_array(cxt.nrealwriters_stress,
 					 sizeof(*cxt.lwsa),
 					 GFP_KERNEL);
@@ -1301,6 +1335,7 @@ static int __init lock_torture_init(void)
 		for (i = 0; i < cxt.nrealwriters_stress; i++) {
 			cxt.lwsa[i].n_lock_fail = 0;
 			cxt.lwsa[i].n_lock_acquired = 0;
+			cxt.lwsa[i].n_lock_cross_cluster = 0;
 		}
 	}
 
@@ -1333,6 +1368,7 @@ static int __init lock_torture_init(void)
 			for (i = 0; i < cxt.nrealreaders_stress; i++) {
 				cxt.lrsa[i].n_lock_fail = 0;
 				cxt.lrsa[i].n_lock_acquired = 0;
+				cxt.lrsa[i].n_lock_cross_cluster = 0;
 			}
 		}
 	}
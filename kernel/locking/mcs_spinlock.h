@@ -37,6 +37,15 @@
 	smp_store_release((l), 1)
 #endif
 
+#ifndef arch_mcs_lock_handoff
+/*
+ * Like arch_mcs_spin_unlock_contended(), for lock variants that pass
+ * information to the next waiter through @l. @val must not be 0.
+ */
+#define arch_mcs_lock_handoff(l, val)					\
+	smp_store_release((l), (val))
+#endif
+
 /*
  * Note: the smp_load_acquire/smp_store_release pair is not
  * sufficient to form a full memory barrier across
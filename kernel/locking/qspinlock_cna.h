@@ -0,0 +1,363 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _GEN_CNA_LOCK_SLOWPATH
+#error "do not include this file"
+#endif
+
+#include <linux/jump_label.h>
+#include <linux/sched/clock.h>
+#include <linux/topology.h>
+
+/*
+ * Implement a cluster aware version of MCS (aka CNA, or compact NUMA-aware
+ * lock), as described in "Compact NUMA-Aware Locks" by Dice and Kogan,
+ * with CPU clusters in place of NUMA nodes: on systems like RK3588, where
+ * CPU clusters only share the last level cache, handing a lock over to a
+ * waiter of another cluster moves the lock and the data it protects across
+ * clusters every time.
+ *
+ * In CNA, spinning threads are organized in two queues, a primary queue for
+ * threads running on the same cluster as the current lock holder, and a
+ * secondary queue for threads running on other clusters. Schematically, it
+ * looks like this:
+ *
+ *    cna_node
+ *   +----------+     +--------+         +--------+
+ *   |mcs:next  | --> |mcs:next| --> ... |mcs:next| --> NULL  [Primary queue]
+ *   |mcs:locked| -.  +--------+         +--------+
+ *   +----------+  |
+ *                 `----------------------.
+ *                                        v
+ *                 +--------+         +--------+
+ *                 |mcs:next| --> ... |mcs:next|            [Secondary queue]
+ *                 +--------+         +--------+
+ *                     ^                    |
+ *                     `--------------------'
+ *
+ * N.B. locked := 1 if secondary queue is absent. Otherwise, it contains the
+ * encoded pointer to the tail of the secondary queue, which is organized as a
+ * circular list.
+ *
+ * After acquiring the MCS lock and before acquiring the spinlock, the MCS lock
+ * holder checks whether the next waiter in the primary queue (if exists) is
+ * running on the same cluster. If it is not, that waiter is detached from the
+ * main queue and moved into the tail of the secondary queue. This way, we
+ * gradually filter the primary queue, leaving only waiters running on the same
+ * preferred cluster.
+ *
+ * The secondary queue is spliced back in front of the primary queue when the
+ * latter runs out of waiters, or once the lock has stayed within the same
+ * cluster for longer than the fairness window (cluster_spinlock_threshold=,
+ * in milliseconds) since a remote waiter was first deferred.
+ */
+
+#define FLUSH_SECONDARY_QUEUE	1
+
+struct cna_node {
+	struct mcs_spinlock	mcs;
+	int			cluster;
+	u32			encoded_tail;	/* self */
+	u64			start_time;
+};
+
+static ulong cna_threshold_ns __ro_after_init = NSEC_PER_MSEC;
+
+static int __init cna_threshold_setup(char *str)
+{
+	unsigned int ms;
+
+	if (kstrtouint(str, 0, &ms) || !ms)
+		return -EINVAL;
+
+	cna_threshold_ns = ms * NSEC_PER_MSEC;
+	return 0;
+}
+early_param("cluster_spinlock_threshold", cna_threshold_setup);
+
+/*
+ * Clusters are described by the cluster level of the topology when there
+ * is one, by the package otherwise: device trees usually describe the CPU
+ * clusters of Arm SoCs as the top level of their cpu-map.
+ */
+static __always_inline int cna_cpu_cluster(int cpu)
+{
+	int cluster = topology_cluster_id(cpu);
+
+	return cluster >= 0 ? cluster : topology_physical_package_id(cpu);
+}
+
+static void __init cna_init_nodes_per_cpu(unsigned int cpu)
+{
+	struct mcs_spinlock *base = per_cpu_ptr(&qnodes[0].mcs, cpu);
+	int i;
+
+	for (i = 0; i < _Q_MAX_NODES; i++) {
+		struct cna_node *cn = (struct cna_node *)grab_mcs_node(base, i);
+
+		cn->encoded_tail = encode_tail(cpu, i);
+		/*
+		 * make sure @encoded_tail is not confused with other valid
+		 * values for @locked (0 or 1)
+		 */
+		WARN_ON(cn->encoded_tail <= 1);
+	}
+}
+
+static void __init cna_init_nodes(void)
+{
+	unsigned int cpu;
+
+	/*
+	 * struct cna_node must fit into the space reserved for it in
+	 * struct qnode.
+	 */
+	BUILD_BUG_ON(sizeof(struct cna_node) > sizeof(struct qnode));
+
+	for_each_possible_cpu(cpu)
+		cna_init_nodes_per_cpu(cpu);
+}
+
+static __always_inline void cna_init_node(struct mcs_spinlock *node)
+{
+	struct cna_node *cn = (struct cna_node *)node;
+
+	cn->cluster = cna_cpu_cluster(smp_processor_id());
+	cn->start_time = 0;
+}
+
+/*
+ * cna_splice_head -- splice the entire secondary queue onto the head of the
+ * primary queue.
+ *
+ * Returns the new primary head node or NULL on failure.
+ */
+static struct mcs_spinlock *
+cna_splice_head(struct qspinlock *lock, u32 val,
+		struct mcs_spinlock *node, struct mcs_spinlock *next)
+{
+	struct mcs_spinlock *head_2nd, *tail_2nd;
+	u32 new;
+
+	tail_2nd = decode_tail(node->locked, qnodes);
+	head_2nd = tail_2nd->next;
+
+	if (next) {
+		/*
+		 * If the primary queue is not empty, the primary tail doesn't
+		 * need to change and we can simply link the secondary tail to
+		 * the old primary head.
+		 */
+		tail_2nd->next = next;
+	} else {
+		/*
+		 * When the primary queue is empty, the secondary tail becomes
+		 * the primary tail.
+		 */
+
+		/*
+		 * Speculatively break the secondary queue's circular link such
+		 * that when the secondary tail becomes the primary tail it all
+		 * works out.
+		 */
+		tail_2nd->next = NULL;
+
+		/*
+		 * tail_2nd->next = NULL;	old = xchg_tail(lock, tail);
+		 *				prev = decode_tail(old);
+		 * try_cmpxchg_release(...);	WRITE_ONCE(prev->next, node);
+		 *
+		 * If the following cmpxchg() succeeds, our stores will not
+		 * collide.
+		 */
+		new = ((struct cna_node *)tail_2nd)->encoded_tail |
+			_Q_LOCKED_VAL;
+		if (!atomic_try_cmpxchg_release(&lock->val, &val, new)) {
+			/* Restore the secondary queue's circular link. */
+			tail_2nd->next = head_2nd;
+			return NULL;
+		}
+	}
+
+	/* The primary queue head now is what was the secondary queue head. */
+	return head_2nd;
+}
+
+static __always_inline bool cna_try_clear_tail(struct qspinlock *lock, u32 val,
+					       struct mcs_spinlock *node)
+{
+	/*
+	 * We're here because the primary queue is empty; check the secondary
+	 * queue for remote waiters.
+	 */
+	if (node->locked > 1) {
+		struct mcs_spinlock *next;
+
+		/*
+		 * When there are waiters on the secondary queue, try to move
+		 * them back onto the primary queue and let them rip.
+		 */
+		next = cna_splice_head(lock, val, node, NULL);
+		if (next) {
+			arch_mcs_lock_handoff(&next->locked, 1);
+			return true;
+		}
+
+		return false;
+	}
+
+	/* Both queues are empty. Do what MCS does. */
+	return __try_clear_tail(lock, val, node);
+}
+
+/*
+ * cna_splice_next -- splice the next node from the primary queue onto
+ * the secondary queue.
+ */
+static void cna_splice_next(struct mcs_spinlock *node,
+			    struct mcs_spinlock *next,
+			    struct mcs_spinlock *nnext)
+{
+	struct cna_node *cn = (struct cna_node *)node;
+
+	/* remove 'next' from the main queue */
+	node->next = nnext;
+
+	/* stick `next` on the secondary queue tail */
+	if (node->locked <= 1) { /* if secondary queue is empty */
+		/* create secondary queue */
+		next->next = next;
+		/* the fairness window starts with the first deferred waiter */
+		if (!cn->start_time)
+			cn->start_time = local_clock();
+	} else {
+		/* add to the tail of the secondary queue */
+		struct mcs_spinlock *tail_2nd = decode_tail(node->locked, qnodes);
+		struct mcs_spinlock *head_2nd = tail_2nd->next;
+
+		tail_2nd->next = next;
+		next->next = head_2nd;
+	}
+
+	node->locked = ((struct cna_node *)next)->encoded_tail;
+	lockevent_inc(lock_cna_defer);
+}
+
+/*
+ * cna_order_queue - check whether the next waiter in the main queue is on
+ * the same cluster as the lock holder; if not, and it has a waiter behind
+ * it in the main queue, move the former onto the secondary queue.
+ * Returns 1 if the next waiter runs on the same cluster; 0 otherwise.
+ */
+static int cna_order_queue(struct mcs_spinlock *node)
+{
+	struct mcs_spinlock *next = READ_ONCE(node->next);
+	struct cna_node *cn = (struct cna_node *)node;
+
+	if (!next)
+		return 0;
+
+	if (((struct cna_node *)next)->cluster != cn->cluster) {
+		struct mcs_spinlock *nnext = READ_ONCE(next->next);
+
+		if (nnext)
+			cna_splice_next(node, next, nnext);
+
+		return 0;
+	}
+	return 1;
+}
+
+static __always_inline bool cna_threshold_reached(struct cna_node *cn)
+{
+	return local_clock() - cn->start_time > cna_threshold_ns;
+}
+
+#define LOCK_IS_BUSY(lock) (atomic_read(&(lock)->val) & _Q_LOCKED_PENDING_MASK)
+
+/* Abuse the pv_wait_head_or_lock() hook to get some work done */
+static __always_inline u32 cna_wait_head_or_lock(struct qspinlock *lock,
+						 struct mcs_spinlock *node)
+{
+	struct cna_node *cn = (struct cna_node *)node;
+
+	if (node->locked <= 1 || !cna_threshold_reached(cn)) {
+		/*
+		 * Try and put the time otherwise spent spin waiting on
+		 * _Q_LOCKED_PENDING_MASK to use by sorting our lists.
+		 */
+		while (LOCK_IS_BUSY(lock) && !cna_order_queue(node))
+			cpu_relax();
+	} else {
+		cn->start_time = FLUSH_SECONDARY_QUEUE;
+	}
+
+	return 0; /* we lied; we didn't wait, go do so now */
+}
+
+static __always_inline void cna_lock_handoff(struct mcs_spinlock *node,
+					     struct mcs_spinlock *next)
+{
+	struct cna_node *cn = (struct cna_node *)node;
+	u32 val = 1;
+
+	if (cn->start_time != FLUSH_SECONDARY_QUEUE) {
+		if (node->locked > 1) {
+			val = node->locked;	/* preserve secondary queue */
+
+			/*
+			 * We have a local waiter; reload @next in case it was
+			 * changed by cna_order_queue().
+			 */
+			next = node->next;
+
+			/*
+			 * Pass over the cluster of the primary queue, to keep
+			 * the preference even if the next waiter runs
+			 * somewhere else, and the start of the fairness window.
+			 */
+			((struct cna_node *)next)->cluster = cn->cluster;
+			((struct cna_node *)next)->start_time = cn->start_time;
+			lockevent_inc(lock_cna_intra);
+		}
+	} else {
+		/*
+		 * We decided to flush the secondary queue;
+		 * this can only happen if that queue is not empty.
+		 */
+		WARN_ON(node->locked <= 1);
+		/*
+		 * Splice the secondary queue onto the primary queue and pass the lock
+		 * to the longest waiting remote waiter.
+		 */
+		next = cna_splice_head(NULL, 0, node, next);
+		lockevent_inc(lock_cna_flush);
+	}
+
+	arch_mcs_lock_handoff(&next->locked, val);
+}
+
+/*
+ * Both slowpaths must not be mixed on a lock, so the choice is made at boot
+ * before the secondary CPUs come up: cluster_spinlock=on enables CNA.
+ */
+static bool cna_enabled __initdata;
+
+static int __init cna_setup(char *str)
+{
+	return kstrtobool(str, &cna_enabled);
+}
+early_param("cluster_spinlock", cna_setup);
+
+static DEFINE_STATIC_KEY_FALSE(cna_spinlock_key);
+
+static int __init cna_configure_spin_lock_slowpath(void)
+{
+	if (!cna_enabled)
+		return 0;
+
+	cna_init_nodes();
+	static_branch_enable(&cna_spinlock_key);
+
+	pr_info("Enabling CNA spinlock\n");
+	return 0;
+}
+early_initcall(cna_configure_spin_lock_slowpath);
@@ -5,6 +5,9 @@
  * Copyright(C) 2022 linutronix GmbH
  */
 #include <linux/cpuhotplug.h>
+#include <linux/debugfs.h>
+#include <linux/sched/topology.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/smp.h>
 #include <linux/spinlock.h>
@@ -1278,6 +1281,16 @@ static bool tmigr_inactive_up(struct tmigr_group *group,
 			 */
 			if (!childstate.active) {
 				unsigned long new_migr_bit, active = newstate.active;
+				unsigned long lowcap;
+
+				/*
+				 * Prefer a child with low capacity CPUs, so
+				 * that remote expiry and the final wakeup of an
+				 * idle hierarchy do not hit the big CPUs.
+				 */
+				lowcap = active & READ_ONCE(group->lowcap_mask);
+				if (lowcap)
+					active = lowcap;
 
 				new_migr_bit = find_first_bit(&active, BIT_CNT);
 
@@ -1592,6 +1605,10 @@ static void tmigr_connect_child_parent(struct tmigr_group *child,
 		child->groupmask = BIT(parent->num_children++);
 	}
 
+	if (child->lowcap_mask)
+		WRITE_ONCE(parent->lowcap_mask,
+			   parent->lowcap_mask | child->groupmask);
+
 	/*
 	 * Make sure parent initialization is visible before publishing it to a
 	 * racing CPU entering/exiting idle. This RELEASE barrier enforces an
@@ -1642,6 +1659,26 @@ static void tmigr_connect_child_parent(struct tmigr_group *child,
 	WARN_ON(!tmigr_active_up(parent, child, &data) && parent->parent);
 }
 
+/*
+ * Mark the path from @cpu to the top level, when @cpu has less than the
+ * maximum CPU capacity. The capacity might still be renormalized later on,
+ * but the relation between big and little CPUs does not change.
+ */
+static void tmigr_mark_lowcap(unsigned int cpu)
+{
+	struct tmigr_cpu *tmc = per_cpu_ptr(&tmigr_cpu, cpu);
+	struct tmigr_group *group = tmc->tmgroup;
+	u8 childmask = tmc->groupmask;
+
+	if (arch_scale_cpu_capacity(cpu) >= SCHED_CAPACITY_SCALE)
+		return;
+
+	for (; group; group = group->parent) {
+		WRITE_ONCE(group->lowcap_mask, group->lowcap_mask | childmask);
+		childmask = group->groupmask;
+	}
+}
+
 static int tmigr_setup_groups(unsigned int cpu, unsigned int node)
 {
 	struct tmigr_group *group, *child, **stack;
@@ -1746,6 +1783,9 @@ static int tmigr_setup_groups(unsigned int cpu, unsigned int node)
 
 	kfree(stack);
 
+	if (!err)
+		tmigr_mark_lowcap(cpu);
+
 	return err;
 }
 
@@ -1861,3 +1901,44 @@ static int __init tmigr_init(void)
 	return ret;
 }
 early_initcall(tmigr_init);
+
+#ifdef CONFIG_DEBUG_FS
+static int tmigr_debugfs_show(struct seq_file *m, void *unused)
+{
+	struct tmigr_group *group;
+	unsigned int lvl;
+
+	mutex_lock(&tmigr_mutex);
+
+	for (lvl = 0; lvl < tmigr_hierarchy_levels; lvl++) {
+		list_for_each_entry(group, &tmigr_level_list[lvl], list) {
+			union tmigr_state state;
+
+			state.state = atomic_read(&group->migr_state);
+
+			seq_printf(m, "lvl %u node %d children %u active %02x migrator %02x lowcap %02x next_expiry %llu\n",
+				   lvl, group->numa_node, group->num_children,
+				   state.active, state.migrator,
+				   READ_ONCE(group->lowcap_mask),
+				   READ_ONCE(group->next_expiry));
+		}
+	}
+
+	mutex_unlock(&tmigr_mutex);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(tmigr_debugfs);
+
+static int __init tmigr_debugfs_init(void)
+{
+	if (!tmigr_level_list)
+		return 0;
+
+	debugfs_create_file("timer_migration", 0444, NULL, NULL,
+			    &tmigr_debugfs_fops);
+
+	return 0;
+}
+late_initcall(tmigr_debugfs_init);
+#endif
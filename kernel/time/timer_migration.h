@@ -53,6 +53,10 @@ struct tmigr_event {
  *			only
  * @groupmask:		mask of the group in the parent group; is set during
  *			setup and will never change; can be read lockless
+ * @lowcap_mask:	mask of the children containing CPUs with less than the
+ *			maximum capacity; these are preferred when a new
+ *			migrator is chosen; set during setup and only read as a
+ *			hint
  * @list:		List head that is added to the per level
  *			tmigr_level_list; is required during setup when a
  *			new group needs to be connected to the existing
@@ -69,6 +73,7 @@ struct tmigr_group {
 	int			numa_node;
 	unsigned int		num_children;
 	u8			groupmask;
+	u8			lowcap_mask;
 	struct list_head	list;
 };
 
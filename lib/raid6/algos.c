@@ -18,6 +18,10 @@
 #else
 #include <linux/module.h>
 #include <linux/gfp.h>
+#include <linux/cpu.h>
+#include <linux/percpu.h>
+#include <linux/sched/topology.h>
+#include <linux/workqueue.h>
 /* In .bss so it's zeroed */
 const char raid6_empty_zero_page[PAGE_SIZE] __attribute__((aligned(256)));
 EXPORT_SYMBOL(raid6_empty_zero_page);
@@ -198,8 +202,6 @@ static inline const struct raid6_calls *raid6_choose_gen(
 		goto out;
 	}
 
-	raid6_call = *best;
-
 	if (!IS_ENABLED(CONFIG_RAID6_PQ_BENCHMARK)) {
 		pr_info("raid6: skipped pq benchmark and selected %s\n",
 			best->name);
@@ -235,6 +237,121 @@ static inline const struct raid6_calls *raid6_choose_gen(
 	return best;
 }
 
+#if defined(__KERNEL__) && defined(CONFIG_SMP)
+/*
+ * On asymmetric systems the boot CPU is usually a little core, and the
+ * routine set that wins there is not necessarily the best one on the big
+ * cores. Benchmark once per CPU capacity and, if the clusters disagree,
+ * dispatch through a per-CPU pointer. Any routine set is correct on any
+ * CPU, so migrating between the lookup and the call is harmless.
+ */
+static DEFINE_PER_CPU_READ_MOSTLY(const struct raid6_calls *, raid6_cpu_calls);
+
+static void raid6_percpu_gen_syndrome(int disks, size_t bytes, void **ptrs)
+{
+	this_cpu_read(raid6_cpu_calls)->gen_syndrome(disks, bytes, ptrs);
+}
+
+static void raid6_percpu_xor_syndrome(int disks, int start, int stop,
+				      size_t bytes, void **ptrs)
+{
+	this_cpu_read(raid6_cpu_calls)->xor_syndrome(disks, start, stop,
+						     bytes, ptrs);
+}
+
+static const struct raid6_calls raid6_percpu_calls = {
+	.gen_syndrome	= raid6_percpu_gen_syndrome,
+	.xor_syndrome	= raid6_percpu_xor_syndrome,
+	.name		= "percpu",
+};
+
+struct raid6_gen_bench {
+	void *(*dptrs)[RAID6_TEST_DISKS];
+	int disks;
+};
+
+static long raid6_choose_gen_fn(void *data)
+{
+	struct raid6_gen_bench *bench = data;
+
+	return (long)raid6_choose_gen(bench->dptrs, bench->disks);
+}
+
+static const struct raid6_calls *raid6_choose_gen_percpu(
+	void *(*const dptrs)[RAID6_TEST_DISKS], const int disks)
+{
+	struct raid6_gen_bench bench = { .dptrs = dptrs, .disks = disks };
+	const struct raid6_calls *best, *first = NULL;
+	bool differ = false, have_xor = true;
+	unsigned long cap;
+	int cpu, other;
+
+	cpus_read_lock();
+	for_each_online_cpu(cpu) {
+		cap = arch_scale_cpu_capacity(cpu);
+
+		/* Only the first online CPU of each capacity is benchmarked */
+		for_each_online_cpu(other)
+			if (other == cpu || arch_scale_cpu_capacity(other) == cap)
+				break;
+		if (other != cpu)
+			continue;
+
+		pr_info("raid6: benchmarking on CPU%d (capacity %lu)\n",
+			cpu, cap);
+		best = (const struct raid6_calls *)
+			work_on_cpu(cpu, raid6_choose_gen_fn, &bench);
+		if (!best) {
+			first = NULL;
+			break;
+		}
+
+		if (!first)
+			first = best;
+		differ |= best != first;
+		have_xor &= !!best->xor_syndrome;
+
+		for_each_possible_cpu(other)
+			if (arch_scale_cpu_capacity(other) == cap)
+				per_cpu(raid6_cpu_calls, other) = best;
+	}
+	cpus_read_unlock();
+
+	if (!first)
+		return NULL;
+
+	/* CPUs of a capacity that was not online at boot */
+	for_each_possible_cpu(other)
+		if (!per_cpu(raid6_cpu_calls, other))
+			per_cpu(raid6_cpu_calls, other) = first;
+
+	if (differ && have_xor) {
+		raid6_call = raid6_percpu_calls;
+		pr_info("raid6: using per-CPU algorithm selection\n");
+	} else {
+		raid6_call = *first;
+	}
+
+	return first;
+}
+#endif
+
+static const struct raid6_calls *raid6_select_gen(
+	void *(*const dptrs)[RAID6_TEST_DISKS], const int disks)
+{
+	const struct raid6_calls *best;
+
+#if defined(__KERNEL__) && defined(CONFIG_SMP)
+	if (IS_ENABLED(CONFIG_RAID6_PQ_BENCHMARK))
+		return raid6_choose_gen_percpu(dptrs, disks);
+#endif
+
+	best = raid6_choose_gen(dptrs, disks);
+	if (best)
+		raid6_call = *best;
+
+	return best;
+}
 
 /* Try to pick the best algorithm */
 /* This code uses the gfmul table as convenient data set to abuse */
@@ -270,7 +387,7 @@ int __init raid6_select_algo(void)
 		memcpy(p, raid6_gfmul, (disks - 2) * PAGE_SIZE % 65536);
 
 	/* select raid gen_syndrome function */
-	gen_best = raid6_choose_gen(&dptrs, disks);
+	gen_best = raid6_select_gen(&dptrs, disks);
 
 	/* select raid recover functions */
 	rec_best = raid6_choose_recov();
@@ -4,6 +4,10 @@
  */
 
 #include <kunit/test.h>
+#include <linux/cpu.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/workqueue.h>
 #include <asm/checksum.h>
 #include <net/ip6_checksum.h>
 
@@ -15,6 +19,11 @@
 #define IPv4_MAX_WORDS 15
 #define NUM_IPv6_TESTS 200
 #define NUM_IP_FAST_CSUM_TESTS 181
+#define BENCH_BUFLEN 16384
+
+static bool benchmark;
+module_param(benchmark, bool, 0444);
+MODULE_PARM_DESC(benchmark, "Report csum_partial() throughput on each CPU");
 
 /* Values for a little endian CPU. Byte swap each half on big endian CPU. */
 static const u32 random_init_sum = 0x2847aab;
@@ -619,12 +628,73 @@ static void test_csum_ipv6_magic(struct kunit *test)
 	}
 }
 
+struct csum_benchmark_data {
+	struct kunit *test;
+	const u8 *buf;
+	int cpu;
+};
+
+static long csum_benchmark_cpu(void *arg)
+{
+	static const int lens_to_test[] = {
+		20, 64, 128, 255, 256, 512, 1500, 4096, BENCH_BUFLEN,
+	};
+	struct csum_benchmark_data *data = arg;
+	/* Keep the sums from being optimized out, as in crc_benchmark() */
+	volatile __wsum sum = 0;
+	int i, j, num_iters;
+	u64 t;
+
+	for (i = 0; i < ARRAY_SIZE(lens_to_test); i++) {
+		num_iters = 10000000 / (lens_to_test[i] + 128);
+		preempt_disable();
+		t = ktime_get_ns();
+		for (j = 0; j < num_iters; j++)
+			sum = csum_partial(data->buf, lens_to_test[i], sum);
+		t = ktime_get_ns() - t;
+		preempt_enable();
+		kunit_info(data->test, "cpu%d len=%d: %llu MB/s\n", data->cpu,
+			   lens_to_test[i],
+			   div64_u64((u64)lens_to_test[i] * num_iters * 1000,
+				     max_t(u64, t, 1)));
+	}
+
+	return 0;
+}
+
+/*
+ * Run on every online CPU in turn, so that the different core types of an
+ * asymmetric system are each measured.
+ */
+static void test_csum_benchmark(struct kunit *test)
+{
+	struct csum_benchmark_data data = { .test = test };
+	u8 *buf;
+	int cpu;
+
+	if (!benchmark)
+		kunit_skip(test, "not enabled");
+
+	buf = kunit_kmalloc(test, BENCH_BUFLEN, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, buf);
+	memset(buf, 0xa5, BENCH_BUFLEN);
+	data.buf = buf;
+
+	cpus_read_lock();
+	for_each_online_cpu(cpu) {
+		data.cpu = cpu;
+		work_on_cpu(cpu, csum_benchmark_cpu, &data);
+	}
+	cpus_read_unlock();
+}
+
 static struct kunit_case __refdata checksum_test_cases[] = {
 	KUNIT_CASE(test_csum_fixed_random_inputs),
 	KUNIT_CASE(test_csum_all_carry_inputs),
 	KUNIT_CASE(test_csum_no_carry_inputs),
 	KUNIT_CASE(test_ip_fast_csum),
 	KUNIT_CASE(test_csum_ipv6_magic),
+	KUNIT_CASE(test_csum_benchmark),
 	{}
 };
 
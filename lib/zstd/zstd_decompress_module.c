@@ -11,7 +11,10 @@
 
 #include <linux/kernel.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
 #include <linux/string.h>
+#include <linux/vmalloc.h>
 #include <linux/zstd.h>
 
 #include "common/zstd_deps.h"
@@ -95,6 +98,85 @@ size_t zstd_decompress_using_ddict(zstd_dctx *dctx,
 }
 EXPORT_SYMBOL(zstd_decompress_using_ddict);
 
+struct zstd_shared_dctx {
+	struct mutex lock;
+	zstd_dctx *dctx;
+	void *workspace;
+};
+
+static DEFINE_MUTEX(zstd_shared_dctx_mutex);
+static unsigned int zstd_shared_dctx_users;
+static struct zstd_shared_dctx __percpu *zstd_shared_dctxs;
+
+static void zstd_free_shared_dctxs(void)
+{
+	unsigned int cpu;
+
+	for_each_possible_cpu(cpu)
+		vfree(per_cpu_ptr(zstd_shared_dctxs, cpu)->workspace);
+	free_percpu(zstd_shared_dctxs);
+	zstd_shared_dctxs = NULL;
+}
+
+int zstd_reserve_shared_dctx(void)
+{
+	size_t size = zstd_dctx_workspace_bound();
+	struct zstd_shared_dctx *sd;
+	unsigned int cpu;
+	int ret = 0;
+
+	mutex_lock(&zstd_shared_dctx_mutex);
+	if (zstd_shared_dctx_users)
+		goto out;
+
+	zstd_shared_dctxs = alloc_percpu(struct zstd_shared_dctx);
+	if (!zstd_shared_dctxs) {
+		ret = -ENOMEM;
+		goto unlock;
+	}
+	for_each_possible_cpu(cpu) {
+		sd = per_cpu_ptr(zstd_shared_dctxs, cpu);
+		mutex_init(&sd->lock);
+		sd->workspace = vzalloc(size);
+		sd->dctx = zstd_init_dctx(sd->workspace, size);
+		if (!sd->dctx) {
+			zstd_free_shared_dctxs();
+			ret = -ENOMEM;
+			goto unlock;
+		}
+	}
+out:
+	zstd_shared_dctx_users++;
+unlock:
+	mutex_unlock(&zstd_shared_dctx_mutex);
+	return ret;
+}
+EXPORT_SYMBOL(zstd_reserve_shared_dctx);
+
+void zstd_release_shared_dctx(void)
+{
+	mutex_lock(&zstd_shared_dctx_mutex);
+	if (!WARN_ON_ONCE(!zstd_shared_dctx_users) &&
+	    !--zstd_shared_dctx_users)
+		zstd_free_shared_dctxs();
+	mutex_unlock(&zstd_shared_dctx_mutex);
+}
+EXPORT_SYMBOL(zstd_release_shared_dctx);
+
+size_t zstd_decompress_shared_dctx(void *dst, size_t dst_capacity,
+	const void *src, size_t src_size)
+{
+	struct zstd_shared_dctx *sd = raw_cpu_ptr(zstd_shared_dctxs);
+	size_t ret;
+
+	/* the task may migrate, the mutex keeps the context exclusive */
+	mutex_lock(&sd->lock);
+	ret = ZSTD_decompressDCtx(sd->dctx, dst, dst_capacity, src, src_size);
+	mutex_unlock(&sd->lock);
+	return ret;
+}
+EXPORT_SYMBOL(zstd_decompress_shared_dctx);
+
 size_t zstd_dstream_workspace_bound(size_t max_window_size)
 {
 	return ZSTD_estimateDStreamSize(max_window_size);
@@ -15,6 +15,7 @@
 #include <linux/slab.h>
 #include <linux/string.h>
 #include <linux/string_choices.h>
+#include <linux/swap.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/damon.h>
@@ -1889,6 +1890,20 @@ static inline u64 damos_get_some_mem_psi_total(void)
 
 #endif	/* CONFIG_PSI */
 
+/*
+ * Swap used ratio in bp.  With a swap device that is backed by zram, this is
+ * the share of the compressed pool capacity that is in use.  Without any swap
+ * the goal is meaningless, so report it as just achieved.
+ */
+static unsigned long damos_get_swap_used_bp(struct damos_quota_goal *goal)
+{
+	long total = total_swap_pages;
+
+	if (total <= 0)
+		return goal->target_value;
+	return mult_frac(total - get_nr_swap_pages(), 10000, total);
+}
+
 static void damos_set_quota_goal_current_value(struct damos_quota_goal *goal)
 {
 	u64 now_psi_total;
@@ -1902,6 +1917,9 @@ static void damos_set_quota_goal_current_value(struct damos_quota_goal *goal)
 		goal->current_value = now_psi_total - goal->last_psi_total;
 		goal->last_psi_total = now_psi_total;
 		break;
+	case DAMOS_QUOTA_SWAP_USED_BP:
+		goal->current_value = damos_get_swap_used_bp(goal);
+		break;
 	default:
 		break;
 	}
@@ -2044,6 +2062,8 @@ static void kdamond_apply_schemes(struct damon_ctx *c)
 		if (c->passed_sample_intervals < s->next_apply_sis)
 			continue;
 		damos_walk_complete(c, s);
+		if (s->wmarks.activated)
+			s->stat.nr_snapshots++;
 		s->next_apply_sis = c->passed_sample_intervals +
 			(s->apply_interval_us ? s->apply_interval_us :
 			 c->attrs.aggr_interval) / sample_interval;
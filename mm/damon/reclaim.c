@@ -77,6 +77,23 @@ DEFINE_DAMON_MODULES_DAMOS_QUOTAS(damon_reclaim_quota);
 static unsigned long quota_mem_pressure_us __read_mostly;
 module_param(quota_mem_pressure_us, ulong, 0600);
 
+/*
+ * Desired ratio of used swap space in bp (1/10,000).
+ *
+ * While keeping the caps that set by other quotas, DAMON_RECLAIM automatically
+ * increases and decreases the effective level of the quota aiming this ratio
+ * of the system swap space to be used.  This is mainly useful for systems
+ * swapping to zram, where the swap space is the compressed pool, to page out
+ * cold memory early up to a chosen pool occupancy instead of waiting for
+ * direct reclaim.  When set together with ``quota_mem_pressure_us``, the least
+ * aggressive of the two goals is used, so memory pressure keeps throttling
+ * reclaim.  Value zero means disabling this auto-tuning feature.
+ *
+ * Disabled by default.
+ */
+static unsigned long quota_swap_used_bp __read_mostly;
+module_param(quota_swap_used_bp, ulong, 0600);
+
 /*
  * User-specifiable feedback for auto-tuning of the effective quota.
  *
@@ -212,6 +229,14 @@ static int damon_reclaim_apply_parameters(void)
 		damos_add_quota_goal(&scheme->quota, goal);
 	}
 
+	if (quota_swap_used_bp) {
+		goal = damos_new_quota_goal(DAMOS_QUOTA_SWAP_USED_BP,
+				quota_swap_used_bp);
+		if (!goal)
+			goto out;
+		damos_add_quota_goal(&scheme->quota, goal);
+	}
+
 	if (quota_autotune_feedback) {
 		goal = damos_new_quota_goal(DAMOS_QUOTA_USER_INPUT, 10000);
 		if (!goal)
@@ -162,6 +162,7 @@ struct isotp_sock {
 	u32 frame_txtime;
 	u32 force_tx_stmin;
 	u32 force_rx_stmin;
+	u32 tx_burst;
 	u32 cfecho; /* consecutive frame echo tag */
 	struct tpcon rx, tx;
 	struct list_head notifier;
@@ -758,24 +759,46 @@ static void isotp_fill_dataframe(struct canfd_frame *cf, struct isotp_sock *so,
 		cf->data[0] = so->opt.ext_address;
 }
 
-static void isotp_send_cframe(struct isotp_sock *so)
+/* Several consecutive frames may only be queued at once when the receiver
+ * does not require a separation time between them.
+ */
+static unsigned int isotp_tx_burst_frames(struct isotp_sock *so)
+{
+	unsigned int frames = so->tx_burst;
+	unsigned int space = so->tx.ll_dl - N_PCI_SZ -
+			     ((so->opt.flags & CAN_ISOTP_EXTEND_ADDR) ? 1 : 0);
+
+	if (frames <= 1)
+		return 1;
+
+	if (so->opt.flags & CAN_ISOTP_FORCE_TXSTMIN) {
+		if (so->force_tx_stmin)
+			return 1;
+	} else if (isotp_bc_flags(so) != CAN_ISOTP_CF_BROADCAST &&
+		   so->txfc.stmin) {
+		return 1;
+	}
+
+	/* do not run over the block size */
+	if (so->txfc.bs)
+		frames = min_t(unsigned int, frames, so->txfc.bs - so->tx.bs);
+
+	return min_t(unsigned int, frames,
+		     DIV_ROUND_UP(so->tx.len - so->tx.idx, space));
+}
+
+static int isotp_send_one_cframe(struct isotp_sock *so, struct net_device *dev,
+				 bool last)
 {
 	struct sock *sk = &so->sk;
 	struct sk_buff *skb;
-	struct net_device *dev;
 	struct canfd_frame *cf;
 	int can_send_ret;
 	int ae = (so->opt.flags & CAN_ISOTP_EXTEND_ADDR) ? 1 : 0;
 
-	dev = dev_get_by_index(sock_net(sk), so->ifindex);
-	if (!dev)
-		return;
-
 	skb = alloc_skb(so->ll.mtu + sizeof(struct can_skb_priv), GFP_ATOMIC);
-	if (!skb) {
-		dev_put(dev);
-		return;
-	}
+	if (!skb)
+		return -ENOMEM;
 
 	can_skb_reserve(skb);
 	can_skb_prv(skb)->ifindex = dev->ifindex;
@@ -797,12 +820,11 @@ static void isotp_send_cframe(struct isotp_sock *so)
 	skb->dev = dev;
 	can_skb_set_owner(skb, sk);
 
-	/* cfecho should have been zero'ed by init/isotp_rcv_echo() */
-	if (so->cfecho)
-		pr_notice_once("can-isotp: cfecho is %08X != 0\n", so->cfecho);
-
-	/* set consecutive frame echo tag */
-	so->cfecho = *(u32 *)cf->data;
+	/* set consecutive frame echo tag, only the last frame of a burst
+	 * is waited for in isotp_rcv_echo()
+	 */
+	if (last)
+		so->cfecho = *(u32 *)cf->data;
 
 	/* send frame with local echo enabled */
 	can_send_ret = can_send(skb, 1);
@@ -812,6 +834,29 @@ static void isotp_send_cframe(struct isotp_sock *so)
 		if (can_send_ret == -ENOBUFS)
 			pr_notice_once("can-isotp: tx queue is full\n");
 	}
+
+	return can_send_ret;
+}
+
+static void isotp_send_cframe(struct isotp_sock *so)
+{
+	struct net_device *dev;
+	unsigned int frames;
+
+	dev = dev_get_by_index(sock_net(&so->sk), so->ifindex);
+	if (!dev)
+		return;
+
+	/* cfecho should have been zero'ed by init/isotp_rcv_echo() */
+	if (so->cfecho)
+		pr_notice_once("can-isotp: cfecho is %08X != 0\n", so->cfecho);
+
+	for (frames = isotp_tx_burst_frames(so); frames; frames--) {
+		/* a lost frame is reported by the echo timeout */
+		if (isotp_send_one_cframe(so, dev, frames == 1))
+			break;
+	}
+
 	dev_put(dev);
 }
 
@@ -1435,6 +1480,23 @@ static int isotp_setsockopt_locked(struct socket *sock, int level, int optname,
 			return -EFAULT;
 		break;
 
+	case CAN_ISOTP_TX_BURST:
+		if (optlen == sizeof(u32)) {
+			u32 burst;
+
+			if (copy_from_sockptr(&burst, optval, optlen))
+				return -EFAULT;
+
+			/* SN must differ within a burst for the echo tag */
+			if (!burst || burst > CAN_ISOTP_MAX_TX_BURST)
+				return -EINVAL;
+
+			so->tx_burst = burst;
+		} else {
+			return -EINVAL;
+		}
+		break;
+
 	case CAN_ISOTP_LL_OPTS:
 		if (optlen == sizeof(struct can_isotp_ll_options)) {
 			struct can_isotp_ll_options ll;
@@ -1521,6 +1583,11 @@ static int isotp_getsockopt(struct socket *sock, int level, int optname,
 		val = &so->force_rx_stmin;
 		break;
 
+	case CAN_ISOTP_TX_BURST:
+		len = min_t(int, len, sizeof(u32));
+		val = &so->tx_burst;
+		break;
+
 	case CAN_ISOTP_LL_OPTS:
 		len = min_t(int, len, sizeof(struct can_isotp_ll_options));
 		val = &so->ll;
@@ -1623,6 +1690,7 @@ static int isotp_init(struct sock *sk)
 	so->ll.mtu = CAN_ISOTP_DEFAULT_LL_MTU;
 	so->ll.tx_dl = CAN_ISOTP_DEFAULT_LL_TX_DL;
 	so->ll.tx_flags = CAN_ISOTP_DEFAULT_LL_TX_FLAGS;
+	so->tx_burst = CAN_ISOTP_DEFAULT_TX_BURST;
 
 	/* set ll_dl for tx path to similar place as for rx */
 	so->tx.ll_dl = so->ll.tx_dl;
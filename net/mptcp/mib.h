@@ -80,6 +80,7 @@ enum linux_mptcp_mib_field {
 	MPTCP_MIB_RCVWNDCONFLICT,	/* Conflict with while updating msk rcv wnd */
 	MPTCP_MIB_CURRESTAB,		/* Current established MPTCP connections */
 	MPTCP_MIB_BLACKHOLE,		/* A blackhole has been detected */
+	MPTCP_MIB_REDUNDANTSEGS,	/* Segments duplicated on a second subflow by the scheduler */
 	__MPTCP_MIB_MAX
 };
 
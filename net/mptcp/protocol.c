@@ -1397,6 +1397,84 @@ struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk)
 	return ssk;
 }
 
+/* latency aware variant of the above, picking the subflow with the smaller
+ * estimated delivery time for the next burst: the time needed to flush the
+ * queued data plus the burst itself at the current pacing rate, plus half the
+ * smoothed RTT. Slow or long queued paths are thus avoided as long as a
+ * better one has room, while bulk transfers still spread on all subflows.
+ * If @second is not NULL, it's filled with the runner-up non backup subflow,
+ * if any.
+ */
+struct sock *mptcp_subflow_get_send_latency(struct mptcp_sock *msk,
+					    struct sock **second)
+{
+	struct subflow_send_info send_info[SSK_MODE_MAX], next;
+	struct mptcp_subflow_context *subflow;
+	struct sock *sk = (struct sock *)msk;
+	int i, nr_active = 0;
+	unsigned long rate;
+	u32 burst, wmem;
+	struct sock *ssk;
+	u64 delay;
+	long tout = 0;
+
+	for (i = 0; i < SSK_MODE_MAX; ++i) {
+		send_info[i].ssk = NULL;
+		send_info[i].linger_time = -1;
+	}
+	next.ssk = NULL;
+	next.linger_time = -1;
+
+	burst = min_t(int, MPTCP_SEND_BURST_SIZE, mptcp_wnd_end(msk) - msk->snd_nxt);
+
+	mptcp_for_each_subflow(msk, subflow) {
+		bool backup = subflow->backup || subflow->request_bkup;
+
+		trace_mptcp_subflow_get_send(subflow);
+		ssk =  mptcp_subflow_tcp_sock(subflow);
+		if (!mptcp_subflow_active(subflow))
+			continue;
+
+		tout = max(tout, mptcp_timeout_from_subflow(subflow));
+		nr_active += !backup;
+		if (!sk_stream_memory_free(ssk))
+			continue;
+
+		rate = READ_ONCE(ssk->sk_pacing_rate);
+		if (!rate)
+			continue;
+
+		/* srtt_us is stored left shifted by 3, we want half of it */
+		wmem = READ_ONCE(ssk->sk_wmem_queued);
+		delay = div64_ul((u64)(wmem + burst) * USEC_PER_SEC, rate) +
+			(READ_ONCE(tcp_sk(ssk)->srtt_us) >> 4);
+		if (delay < send_info[backup].linger_time) {
+			if (!backup)
+				next = send_info[backup];
+			send_info[backup].ssk = ssk;
+			send_info[backup].linger_time = delay;
+		} else if (!backup && delay < next.linger_time) {
+			next.ssk = ssk;
+			next.linger_time = delay;
+		}
+	}
+	__mptcp_set_timeout(sk, tout);
+
+	/* pick the best backup if no other subflow is active */
+	if (!nr_active)
+		send_info[SSK_MODE_ACTIVE].ssk = send_info[SSK_MODE_BACKUP].ssk;
+
+	ssk = send_info[SSK_MODE_ACTIVE].ssk;
+	if (!ssk)
+		return NULL;
+
+	if (second)
+		*second = next.ssk;
+	if (burst)
+		msk->snd_burst = burst;
+	return ssk;
+}
+
 static void mptcp_push_release(struct sock *ssk, struct mptcp_sendmsg_info *info)
 {
 	tcp_push(ssk, 0, info->mss_now, tcp_sk(ssk)->nonagle, info->size_goal);
@@ -1483,6 +1561,40 @@ static int __subflow_push_pending(struct sock *sk, struct sock *ssk,
 	return err;
 }
 
+/* send again on @ssk the data pushed on another subflow in the current
+ * round, starting at @dfrag, offset @sent, up to the current send head
+ */
+static int __subflow_push_redundant(struct sock *sk, struct sock *ssk,
+				    struct mptcp_data_frag *dfrag, u32 sent,
+				    struct mptcp_sendmsg_info *info)
+{
+	struct mptcp_data_frag *end = mptcp_send_head(sk);
+	struct mptcp_sock *msk = mptcp_sk(sk);
+	int ret, copied = 0;
+
+	list_for_each_entry_from(dfrag, &msk->rtx_queue, list) {
+		info->sent = sent;
+		info->limit = dfrag->already_sent;
+		while (info->sent < info->limit) {
+			ret = mptcp_sendmsg_frag(sk, ssk, dfrag, info);
+			if (ret <= 0)
+				return copied;
+
+			MPTCP_INC_STATS(sock_net(sk), MPTCP_MIB_REDUNDANTSEGS);
+			info->sent += ret;
+			copied += ret;
+		}
+
+		if (dfrag == end)
+			break;
+		sent = 0;
+	}
+
+	if (copied)
+		WRITE_ONCE(msk->allow_infinite_fallback, false);
+	return copied;
+}
+
 void __mptcp_push_pending(struct sock *sk, unsigned int flags)
 {
 	struct sock *prev_ssk = NULL, *ssk = NULL;
@@ -1494,7 +1606,9 @@ void __mptcp_push_pending(struct sock *sk, unsigned int flags)
 	int push_count = 1;
 
 	while (mptcp_send_head(sk) && (push_count > 0)) {
+		struct mptcp_data_frag *dfrag, *red_dfrag = NULL;
 		struct mptcp_subflow_context *subflow;
+		u32 red_sent = 0;
 		int ret = 0;
 
 		if (mptcp_sched_get_send(msk))
@@ -1522,9 +1636,23 @@ void __mptcp_push_pending(struct sock *sk, unsigned int flags)
 					lock_sock(ssk);
 				}
 
+				/* the scheduler asked to duplicate this round
+				 * on all the scheduled subflows: the first one
+				 * sends new data, the others copy it
+				 */
+				if (red_dfrag) {
+					__subflow_push_redundant(sk, ssk, red_dfrag,
+								 red_sent, &info);
+					continue;
+				}
+
 				push_count++;
 
+				dfrag = mptcp_send_head(sk);
+				red_sent = dfrag ? dfrag->already_sent : 0;
 				ret = __subflow_push_pending(sk, ssk, &info);
+				if (ret > 0 && msk->sched_redundant)
+					red_dfrag = dfrag;
 				if (ret <= 0) {
 					if (ret != -EAGAIN ||
 					    (1 << ssk->sk_state) &
@@ -2730,6 +2858,7 @@ static void __mptcp_init_sock(struct sock *sk)
 	WRITE_ONCE(msk->csum_enabled, mptcp_is_checksum_enabled(sock_net(sk)));
 	WRITE_ONCE(msk->allow_infinite_fallback, true);
 	msk->recovery = false;
+	msk->sched_redundant = 0;
 	msk->subflow_id = 1;
 	msk->last_data_sent = tcp_jiffies32;
 	msk->last_data_recv = tcp_jiffies32;
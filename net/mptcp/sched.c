@@ -49,6 +49,42 @@ static struct mptcp_sched_ops mptcp_sched_default = {
 	.owner		= THIS_MODULE,
 };
 
+/* Writes up to this size, issued while all the previous data has been
+ * acked, are considered latency critical and sent on two subflows.
+ */
+#define MPTCP_SCHED_REDUNDANT_MAX	2048
+
+static int mptcp_sched_latency_get_send(struct mptcp_sock *msk,
+					struct mptcp_sched_data *data)
+{
+	struct sock *ssk, *second = NULL;
+	bool redundant;
+
+	ssk = mptcp_subflow_get_send_latency(msk, &second);
+	if (!ssk)
+		return -EINVAL;
+
+	mptcp_subflow_set_scheduled(mptcp_subflow_ctx(ssk), true);
+
+	/* with csum enabled the retransmitted data must match the original
+	 * mapping, keep things simple and avoid duplicating in such case
+	 */
+	redundant = second && !READ_ONCE(msk->csum_enabled) &&
+		    READ_ONCE(msk->snd_una) == msk->snd_nxt &&
+		    msk->write_seq - msk->snd_nxt <= MPTCP_SCHED_REDUNDANT_MAX;
+	if (redundant)
+		mptcp_subflow_set_scheduled(mptcp_subflow_ctx(second), true);
+	msk->sched_redundant = redundant;
+	return 0;
+}
+
+static struct mptcp_sched_ops mptcp_sched_latency = {
+	.get_send	= mptcp_sched_latency_get_send,
+	.get_retrans	= mptcp_sched_default_get_retrans,
+	.name		= "latency",
+	.owner		= THIS_MODULE,
+};
+
 /* Must be called with rcu read lock held */
 struct mptcp_sched_ops *mptcp_sched_find(const char *name)
 {
@@ -103,7 +139,7 @@ int mptcp_register_scheduler(struct mptcp_sched_ops *sched)
 
 void mptcp_unregister_scheduler(struct mptcp_sched_ops *sched)
 {
-	if (sched == &mptcp_sched_default)
+	if (sched == &mptcp_sched_default || sched == &mptcp_sched_latency)
 		return;
 
 	spin_lock(&mptcp_sched_list_lock);
@@ -114,6 +150,7 @@ void mptcp_unregister_scheduler(struct mptcp_sched_ops *sched)
 void mptcp_sched_init(void)
 {
 	mptcp_register_scheduler(&mptcp_sched_default);
+	mptcp_register_scheduler(&mptcp_sched_latency);
 }
 
 int mptcp_init_sched(struct mptcp_sock *msk,
@@ -612,7 +612,6 @@ static int prb_calc_retire_blk_tmo(struct packet_sock *po,
 				int blk_size_in_bytes)
 {
 	struct net_device *dev;
-	unsigned int mbits, div;
 	struct ethtool_link_ksettings ecmd;
 	int err;
 
@@ -634,15 +633,13 @@ static int prb_calc_retire_blk_tmo(struct packet_sock *po,
 	    ecmd.base.speed == SPEED_UNKNOWN)
 		return DEFAULT_PRB_RETIRE_TOV;
 
-	div = ecmd.base.speed / 1000;
-	mbits = (blk_size_in_bytes * 8) / (1024 * 1024);
-
-	if (div)
-		mbits /= div;
-
-	if (div)
-		return mbits + 1;
-	return mbits;
+	/* Time in ms to fill a block at line rate, rounded up. Don't round
+	 * the speed down to Gbit/s, on 2.5G links that made the timeout 25%
+	 * too long. The result lands in the unsigned short retire_blk_tov.
+	 */
+	return min_t(u64, DIV_ROUND_UP_ULL((u64)blk_size_in_bytes * 8,
+					   (u64)ecmd.base.speed * 1000),
+		     USHRT_MAX);
 }
 
 static void prb_init_ft_ops(struct tpacket_kbdq_core *p1,
@@ -0,0 +1,333 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * accel.c
+ *
+ * accel: Benchmark job submission and fence signalling latency of DRM
+ * scheduler based devices.
+ *
+ * Jobs are empty, so they go through the whole submission path (ioctl,
+ * dependency tracking, drm_sched entity, run_job, fence signalling) without
+ * touching the hardware, which makes the numbers a measure of the software
+ * overhead only.
+ */
+#include "../perf.h"
+#include "../util/util.h"
+#include <subcmd/parse-options.h>
+#include "../builtin.h"
+#include "bench.h"
+#include <linux/kernel.h>
+#include <linux/time64.h>
+
+#include <drm/drm.h>
+#include <drm/panthor_drm.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOOPS_DEFAULT		10000
+#define RENDER_NODE_MIN		128
+#define RENDER_NODE_MAX		191
+
+static int loops = LOOPS_DEFAULT;
+static const char *device;
+
+static const struct option options[] = {
+	OPT_INTEGER('l', "loop",	&loops,		"Specify number of loops"),
+	OPT_STRING('d', "device",	&device,	"path",
+		   "DRM render node to use (default: first panthor node)"),
+	OPT_END()
+};
+
+static const char * const bench_accel_usage[] = {
+	"perf bench accel panthor <options>",
+	NULL
+};
+
+struct panthor_ctx {
+	int fd;
+	__u32 vm_id;
+	__u32 group_handle;
+	__u32 syncobj;
+};
+
+static u64 now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static int accel_ioctl(int fd, unsigned long request, void *arg)
+{
+	int ret;
+
+	do {
+		ret = ioctl(fd, request, arg);
+	} while (ret == -1 && (errno == EINTR || errno == EAGAIN));
+
+	return ret;
+}
+
+static bool is_driver(int fd, const char *driver)
+{
+	struct drm_version version = { 0 };
+	char name[32] = { 0 };
+
+	version.name = name;
+	version.name_len = sizeof(name) - 1;
+	if (accel_ioctl(fd, DRM_IOCTL_VERSION, &version))
+		return false;
+
+	return !strcmp(name, driver);
+}
+
+static int open_device(const char *driver)
+{
+	char path[32];
+	int fd, i;
+
+	if (device) {
+		fd = open(device, O_RDWR | O_CLOEXEC);
+		if (fd < 0)
+			return -errno;
+		if (!is_driver(fd, driver)) {
+			close(fd);
+			return -ENODEV;
+		}
+		return fd;
+	}
+
+	for (i = RENDER_NODE_MIN; i <= RENDER_NODE_MAX; i++) {
+		snprintf(path, sizeof(path), "/dev/dri/renderD%d", i);
+		fd = open(path, O_RDWR | O_CLOEXEC);
+		if (fd < 0)
+			continue;
+		if (is_driver(fd, driver))
+			return fd;
+		close(fd);
+	}
+
+	return -ENODEV;
+}
+
+static int panthor_init(struct panthor_ctx *ctx)
+{
+	struct drm_panthor_gpu_info gpu_info = { 0 };
+	struct drm_panthor_dev_query query = {
+		.type = DRM_PANTHOR_DEV_QUERY_GPU_INFO,
+		.size = sizeof(gpu_info),
+		.pointer = (__u64)(uintptr_t)&gpu_info,
+	};
+	struct drm_panthor_vm_create vm_create = { 0 };
+	struct drm_panthor_queue_create queue = {
+		.priority = 0,
+		.ringbuf_size = 4096,
+	};
+	struct drm_panthor_group_create group_create = {
+		.queues = DRM_PANTHOR_OBJ_ARRAY(1, &queue),
+		.max_compute_cores = 1,
+		.max_fragment_cores = 1,
+		.max_tiler_cores = 1,
+		.priority = PANTHOR_GROUP_PRIORITY_MEDIUM,
+	};
+	struct drm_syncobj_create syncobj_create = { 0 };
+	int ret;
+
+	ctx->fd = open_device("panthor");
+	if (ctx->fd < 0) {
+		fprintf(stderr, "No panthor render node found: %s\n", strerror(-ctx->fd));
+		return ctx->fd;
+	}
+
+	if (accel_ioctl(ctx->fd, DRM_IOCTL_PANTHOR_DEV_QUERY, &query))
+		goto err;
+
+	if (accel_ioctl(ctx->fd, DRM_IOCTL_PANTHOR_VM_CREATE, &vm_create))
+		goto err;
+	ctx->vm_id = vm_create.id;
+
+	group_create.compute_core_mask = gpu_info.shader_present;
+	group_create.fragment_core_mask = gpu_info.shader_present;
+	group_create.tiler_core_mask = gpu_info.tiler_present;
+	group_create.vm_id = ctx->vm_id;
+	if (accel_ioctl(ctx->fd, DRM_IOCTL_PANTHOR_GROUP_CREATE, &group_create))
+		goto err;
+	ctx->group_handle = group_create.group_handle;
+
+	if (accel_ioctl(ctx->fd, DRM_IOCTL_SYNCOBJ_CREATE, &syncobj_create))
+		goto err;
+	ctx->syncobj = syncobj_create.handle;
+
+	return 0;
+
+err:
+	ret = -errno;
+	fprintf(stderr, "panthor setup failed: %s\n", strerror(-ret));
+	close(ctx->fd);
+	return ret;
+}
+
+static void panthor_fini(struct panthor_ctx *ctx)
+{
+	struct drm_syncobj_destroy syncobj_destroy = { .handle = ctx->syncobj };
+	struct drm_panthor_group_destroy group_destroy = {
+		.group_handle = ctx->group_handle,
+	};
+	struct drm_panthor_vm_destroy vm_destroy = { .id = ctx->vm_id };
+
+	accel_ioctl(ctx->fd, DRM_IOCTL_SYNCOBJ_DESTROY, &syncobj_destroy);
+	accel_ioctl(ctx->fd, DRM_IOCTL_PANTHOR_GROUP_DESTROY, &group_destroy);
+	accel_ioctl(ctx->fd, DRM_IOCTL_PANTHOR_VM_DESTROY, &vm_destroy);
+	close(ctx->fd);
+}
+
+/* Submit an empty job signalling ctx->syncobj once it's done. */
+static int panthor_submit_nop(struct panthor_ctx *ctx)
+{
+	struct drm_panthor_sync_op sync = {
+		.flags = DRM_PANTHOR_SYNC_OP_SIGNAL |
+			 DRM_PANTHOR_SYNC_OP_HANDLE_TYPE_SYNCOBJ,
+		.handle = ctx->syncobj,
+	};
+	struct drm_panthor_queue_submit qsubmit = {
+		.queue_index = 0,
+		.syncs = DRM_PANTHOR_OBJ_ARRAY(1, &sync),
+	};
+	struct drm_panthor_group_submit submit = {
+		.group_handle = ctx->group_handle,
+		.queue_submits = DRM_PANTHOR_OBJ_ARRAY(1, &qsubmit),
+	};
+
+	return accel_ioctl(ctx->fd, DRM_IOCTL_PANTHOR_GROUP_SUBMIT, &submit);
+}
+
+static int wait_syncobj(struct panthor_ctx *ctx)
+{
+	struct drm_syncobj_wait wait = {
+		.handles = (__u64)(uintptr_t)&ctx->syncobj,
+		.timeout_nsec = INT64_MAX,
+		.count_handles = 1,
+	};
+
+	return accel_ioctl(ctx->fd, DRM_IOCTL_SYNCOBJ_WAIT, &wait);
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void print_percentiles(const char *name, u64 *samples, int nr)
+{
+	qsort(samples, nr, sizeof(*samples), cmp_u64);
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf(" %-16s p50: %8.3f usecs  p90: %8.3f usecs  p99: %8.3f usecs  max: %8.3f usecs\n",
+		       name,
+		       samples[nr / 2] / (double)NSEC_PER_USEC,
+		       samples[nr * 90 / 100] / (double)NSEC_PER_USEC,
+		       samples[nr * 99 / 100] / (double)NSEC_PER_USEC,
+		       samples[nr - 1] / (double)NSEC_PER_USEC);
+		break;
+	case BENCH_FORMAT_SIMPLE:
+		printf("%s %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 "\n",
+		       name, samples[nr / 2], samples[nr * 90 / 100],
+		       samples[nr * 99 / 100], samples[nr - 1]);
+		break;
+	default:
+		break;
+	}
+}
+
+int bench_accel_panthor(int argc, const char **argv)
+{
+	struct panthor_ctx ctx;
+	u64 *submit_lat, *fence_lat;
+	u64 start, end;
+	int i, ret;
+
+	argc = parse_options(argc, argv, options, bench_accel_usage, 0);
+	if (loops <= 0)
+		usage_with_options(bench_accel_usage, options);
+
+	submit_lat = calloc(loops, sizeof(*submit_lat));
+	fence_lat = calloc(loops, sizeof(*fence_lat));
+	if (!submit_lat || !fence_lat) {
+		ret = -ENOMEM;
+		goto out_free;
+	}
+
+	ret = panthor_init(&ctx);
+	if (ret)
+		goto out_free;
+
+	/* Round trip: submit, then wait for the job fence to signal. */
+	for (i = 0; i < loops; i++) {
+		u64 t0, t1, t2;
+
+		t0 = now_ns();
+		ret = panthor_submit_nop(&ctx);
+		t1 = now_ns();
+		if (!ret)
+			ret = wait_syncobj(&ctx);
+		t2 = now_ns();
+		if (ret) {
+			fprintf(stderr, "submission failed: %s\n", strerror(errno));
+			goto out_fini;
+		}
+
+		submit_lat[i] = t1 - t0;
+		fence_lat[i] = t2 - t0;
+	}
+
+	/* Throughput: queue all jobs back to back, wait for the last one. */
+	start = now_ns();
+	for (i = 0; i < loops; i++) {
+		ret = panthor_submit_nop(&ctx);
+		if (ret) {
+			fprintf(stderr, "submission failed: %s\n", strerror(errno));
+			goto out_fini;
+		}
+	}
+	ret = wait_syncobj(&ctx);
+	end = now_ns();
+	if (ret) {
+		fprintf(stderr, "fence wait failed: %s\n", strerror(errno));
+		goto out_fini;
+	}
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf("# Submitted %d empty jobs per pass\n\n", loops);
+		printf(" %14lf jobs/sec\n",
+		       loops / ((double)(end - start) / NSEC_PER_SEC));
+		break;
+	case BENCH_FORMAT_SIMPLE:
+		printf("%lf\n", loops / ((double)(end - start) / NSEC_PER_SEC));
+		break;
+	default:
+		break;
+	}
+
+	print_percentiles("submit ioctl", submit_lat, loops);
+	print_percentiles("fence signalled", fence_lat, loops);
+
+out_fini:
+	panthor_fini(&ctx);
+out_free:
+	free(fence_lat);
+	free(submit_lat);
+	return ret ? EXIT_FAILURE : 0;
+}
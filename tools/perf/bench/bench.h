@@ -49,6 +49,10 @@ int bench_uprobe_trace_printk(int argc, const char **argv);
 int bench_uprobe_empty_ret(int argc, const char **argv);
 int bench_uprobe_trace_printk_ret(int argc, const char **argv);
 int bench_pmu_scan(int argc, const char **argv);
+int bench_accel_panthor(int argc, const char **argv);
+int bench_dmabuf_heap(int argc, const char **argv);
+int bench_dmabuf_sync(int argc, const char **argv);
+int bench_dmabuf_import(int argc, const char **argv);
 
 #define BENCH_FORMAT_DEFAULT_STR	"default"
 #define BENCH_FORMAT_DEFAULT		0
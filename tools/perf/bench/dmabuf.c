@@ -0,0 +1,472 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * dmabuf.c
+ *
+ * dmabuf: Benchmarks for dma-buf allocation, sharing and CPU access
+ * synchronisation.
+ *
+ *  heap   - DMA_HEAP_IOCTL_ALLOC latency for each heap and buffer size
+ *  sync   - DMA_BUF_IOCTL_SYNC begin/end cost on a CPU mapped dma-buf
+ *  import - dma-buf export/import round trips (udmabuf, PRIME import)
+ */
+#include "../perf.h"
+#include "../util/util.h"
+#include <subcmd/parse-options.h>
+#include "../builtin.h"
+#include "bench.h"
+#include <linux/kernel.h>
+#include <linux/time64.h>
+
+#include <drm/drm.h>
+#include <linux/dma-buf.h>
+#include <linux/dma-heap.h>
+#include <linux/udmabuf.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOOPS_DEFAULT		1000
+#define DMA_HEAP_DIR		"/dev/dma_heap"
+#define RENDER_NODE_MIN		128
+#define RENDER_NODE_MAX		191
+
+static int loops = LOOPS_DEFAULT;
+static const char *heap_name;
+static const char *device;
+static const char *size_str = "1M";
+
+static const struct option options[] = {
+	OPT_INTEGER('l', "loop",	&loops,		"Specify number of loops"),
+	OPT_STRING('H', "heap",		&heap_name,	"name",
+		   "dma-heap to allocate from (default: all heaps, or system)"),
+	OPT_STRING('s', "size",		&size_str,	"size",
+		   "Buffer size for the sync and import benchmarks (default: 1M)"),
+	OPT_STRING('d', "device",	&device,	"path",
+		   "DRM render node to import into (default: first render node)"),
+	OPT_END()
+};
+
+static const char * const bench_dmabuf_usage[] = {
+	"perf bench dmabuf <heap|sync|import> <options>",
+	NULL
+};
+
+/* Allocation sizes swept by the heap benchmark. */
+static const size_t heap_sizes[] = {
+	4096, 65536, 1 << 20, 8 << 20,
+};
+
+static u64 now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void print_stats(const char *name, u64 *samples, int nr)
+{
+	u64 total = 0;
+	int i;
+
+	for (i = 0; i < nr; i++)
+		total += samples[i];
+
+	qsort(samples, nr, sizeof(*samples), cmp_u64);
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf(" %-28s avg: %10.3f usecs  p50: %10.3f usecs  p99: %10.3f usecs\n",
+		       name,
+		       total / (double)nr / NSEC_PER_USEC,
+		       samples[nr / 2] / (double)NSEC_PER_USEC,
+		       samples[nr * 99 / 100] / (double)NSEC_PER_USEC);
+		break;
+	case BENCH_FORMAT_SIMPLE:
+		printf("%s %" PRIu64 " %" PRIu64 " %" PRIu64 "\n", name,
+		       total / nr, samples[nr / 2], samples[nr * 99 / 100]);
+		break;
+	default:
+		break;
+	}
+}
+
+static int parse_args(int argc, const char **argv, size_t *size)
+{
+	char *end;
+
+	argc = parse_options(argc, argv, options, bench_dmabuf_usage, 0);
+	if (loops <= 0)
+		usage_with_options(bench_dmabuf_usage, options);
+
+	*size = strtoull(size_str, &end, 0);
+	switch (*end) {
+	case 'G': case 'g':
+		*size <<= 10;
+		fallthrough;
+	case 'M': case 'm':
+		*size <<= 10;
+		fallthrough;
+	case 'K': case 'k':
+		*size <<= 10;
+		break;
+	case '\0':
+		break;
+	default:
+		*size = 0;
+		break;
+	}
+
+	if (!*size) {
+		fprintf(stderr, "Invalid size: %s\n", size_str);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int heap_open(const char *name)
+{
+	char path[PATH_MAX];
+	int fd;
+
+	snprintf(path, sizeof(path), DMA_HEAP_DIR "/%s", name);
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+		return -errno;
+	}
+
+	return fd;
+}
+
+static int heap_alloc(int heap_fd, size_t size)
+{
+	struct dma_heap_allocation_data data = {
+		.len = size,
+		.fd_flags = O_RDWR | O_CLOEXEC,
+	};
+
+	if (ioctl(heap_fd, DMA_HEAP_IOCTL_ALLOC, &data))
+		return -errno;
+
+	return data.fd;
+}
+
+static int bench_heap_one(const char *name, u64 *samples)
+{
+	unsigned int s;
+	int heap_fd, i, ret = 0;
+
+	heap_fd = heap_open(name);
+	if (heap_fd < 0)
+		return heap_fd;
+
+	for (s = 0; s < ARRAY_SIZE(heap_sizes); s++) {
+		char label[64];
+
+		for (i = 0; i < loops; i++) {
+			u64 t0 = now_ns();
+			int fd = heap_alloc(heap_fd, heap_sizes[s]);
+
+			samples[i] = now_ns() - t0;
+			if (fd < 0) {
+				fprintf(stderr, "%s: allocating %zu bytes failed: %s\n",
+					name, heap_sizes[s], strerror(-fd));
+				ret = fd;
+				goto out_close;
+			}
+			close(fd);
+		}
+
+		snprintf(label, sizeof(label), "%s/%zuK", name, heap_sizes[s] >> 10);
+		print_stats(label, samples, loops);
+	}
+
+out_close:
+	close(heap_fd);
+	return ret;
+}
+
+int bench_dmabuf_heap(int argc, const char **argv)
+{
+	struct dirent *dent;
+	u64 *samples;
+	size_t size;
+	DIR *dir;
+	int ret;
+
+	ret = parse_args(argc, argv, &size);
+	if (ret)
+		return EXIT_FAILURE;
+
+	samples = calloc(loops, sizeof(*samples));
+	if (!samples)
+		return EXIT_FAILURE;
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# Allocating and releasing %d buffers per heap and size\n\n", loops);
+
+	if (heap_name) {
+		ret = bench_heap_one(heap_name, samples);
+		goto out_free;
+	}
+
+	dir = opendir(DMA_HEAP_DIR);
+	if (!dir) {
+		fprintf(stderr, "Failed to open " DMA_HEAP_DIR ": %s\n", strerror(errno));
+		ret = -errno;
+		goto out_free;
+	}
+
+	while ((dent = readdir(dir)) != NULL) {
+		if (dent->d_name[0] == '.')
+			continue;
+
+		/* Keep going, a failing heap (e.g. too small CMA) shouldn't hide the others. */
+		if (bench_heap_one(dent->d_name, samples))
+			ret = -EIO;
+	}
+	closedir(dir);
+
+out_free:
+	free(samples);
+	return ret ? EXIT_FAILURE : 0;
+}
+
+int bench_dmabuf_sync(int argc, const char **argv)
+{
+	static const struct {
+		const char *name;
+		__u64 flags;
+	} modes[] = {
+		{ "sync read",		DMA_BUF_SYNC_READ },
+		{ "sync write",		DMA_BUF_SYNC_WRITE },
+		{ "sync read/write",	DMA_BUF_SYNC_RW },
+	};
+	u64 *samples;
+	unsigned int m;
+	size_t size;
+	int heap_fd, buf_fd, i, ret;
+	void *map;
+
+	ret = parse_args(argc, argv, &size);
+	if (ret)
+		return EXIT_FAILURE;
+
+	samples = calloc(loops, sizeof(*samples));
+	if (!samples)
+		return EXIT_FAILURE;
+
+	ret = heap_fd = heap_open(heap_name ?: "system");
+	if (heap_fd < 0)
+		goto out_free;
+
+	ret = buf_fd = heap_alloc(heap_fd, size);
+	if (buf_fd < 0) {
+		fprintf(stderr, "Allocating %zu bytes failed: %s\n", size, strerror(-buf_fd));
+		goto out_close_heap;
+	}
+
+	map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, buf_fd, 0);
+	if (map == MAP_FAILED) {
+		ret = -errno;
+		fprintf(stderr, "mmap failed: %s\n", strerror(errno));
+		goto out_close_buf;
+	}
+
+	/* Fault all pages in, so the sync cost isn't mixed with page faults. */
+	memset(map, 0, size);
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# %d DMA_BUF_IOCTL_SYNC start/end pairs on a %zuK %s buffer\n\n",
+		       loops, size >> 10, heap_name ?: "system");
+
+	ret = 0;
+	for (m = 0; m < ARRAY_SIZE(modes); m++) {
+		for (i = 0; i < loops; i++) {
+			struct dma_buf_sync sync = {
+				.flags = DMA_BUF_SYNC_START | modes[m].flags,
+			};
+			u64 t0 = now_ns();
+
+			if (ioctl(buf_fd, DMA_BUF_IOCTL_SYNC, &sync))
+				ret = -errno;
+			sync.flags = DMA_BUF_SYNC_END | modes[m].flags;
+			if (ioctl(buf_fd, DMA_BUF_IOCTL_SYNC, &sync))
+				ret = -errno;
+			samples[i] = now_ns() - t0;
+
+			if (ret) {
+				fprintf(stderr, "DMA_BUF_IOCTL_SYNC failed: %s\n", strerror(-ret));
+				goto out_unmap;
+			}
+		}
+		print_stats(modes[m].name, samples, loops);
+	}
+
+out_unmap:
+	munmap(map, size);
+out_close_buf:
+	close(buf_fd);
+out_close_heap:
+	close(heap_fd);
+out_free:
+	free(samples);
+	return ret < 0 ? EXIT_FAILURE : 0;
+}
+
+static int open_render_node(void)
+{
+	char path[32];
+	int fd, i;
+
+	if (device)
+		return open(device, O_RDWR | O_CLOEXEC);
+
+	for (i = RENDER_NODE_MIN; i <= RENDER_NODE_MAX; i++) {
+		snprintf(path, sizeof(path), "/dev/dri/renderD%d", i);
+		fd = open(path, O_RDWR | O_CLOEXEC);
+		if (fd >= 0)
+			return fd;
+	}
+
+	errno = ENODEV;
+	return -1;
+}
+
+/* memfd -> udmabuf export, the exporter side of the zero-copy path. */
+static int bench_udmabuf(size_t size, u64 *samples)
+{
+	int dev_fd, memfd, i, ret = 0;
+
+	dev_fd = open("/dev/udmabuf", O_RDWR | O_CLOEXEC);
+	if (dev_fd < 0) {
+		fprintf(stderr, "Skipping udmabuf: %s\n", strerror(errno));
+		return 0;
+	}
+
+	memfd = memfd_create("perf-bench-dmabuf", MFD_ALLOW_SEALING);
+	if (memfd < 0 || ftruncate(memfd, size) ||
+	    fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK)) {
+		ret = -errno;
+		fprintf(stderr, "memfd setup failed: %s\n", strerror(errno));
+		goto out_close;
+	}
+
+	for (i = 0; i < loops; i++) {
+		struct udmabuf_create create = {
+			.memfd = memfd,
+			.flags = UDMABUF_FLAGS_CLOEXEC,
+			.size = size,
+		};
+		u64 t0 = now_ns();
+		int fd = ioctl(dev_fd, UDMABUF_CREATE, &create);
+
+		if (fd < 0) {
+			ret = -errno;
+			fprintf(stderr, "UDMABUF_CREATE failed: %s\n", strerror(errno));
+			goto out_close;
+		}
+		close(fd);
+		samples[i] = now_ns() - t0;
+	}
+	print_stats("udmabuf create/release", samples, loops);
+
+out_close:
+	if (memfd >= 0)
+		close(memfd);
+	close(dev_fd);
+	return ret;
+}
+
+/* dma-heap buffer -> DRM PRIME import, the importer side. */
+static int bench_prime_import(size_t size, u64 *samples)
+{
+	int heap_fd, buf_fd, drm_fd, i, ret = 0;
+
+	drm_fd = open_render_node();
+	if (drm_fd < 0) {
+		fprintf(stderr, "Skipping PRIME import: %s\n", strerror(errno));
+		return 0;
+	}
+
+	ret = heap_fd = heap_open(heap_name ?: "system");
+	if (heap_fd < 0)
+		goto out_close_drm;
+
+	ret = buf_fd = heap_alloc(heap_fd, size);
+	if (buf_fd < 0) {
+		fprintf(stderr, "Allocating %zu bytes failed: %s\n", size, strerror(-buf_fd));
+		goto out_close_heap;
+	}
+
+	ret = 0;
+	for (i = 0; i < loops; i++) {
+		struct drm_prime_handle prime = { .fd = buf_fd };
+		struct drm_gem_close gem_close = { 0 };
+		u64 t0 = now_ns();
+
+		if (ioctl(drm_fd, DRM_IOCTL_PRIME_FD_TO_HANDLE, &prime)) {
+			ret = -errno;
+			fprintf(stderr, "PRIME import failed: %s\n", strerror(errno));
+			goto out_close_buf;
+		}
+		gem_close.handle = prime.handle;
+		ioctl(drm_fd, DRM_IOCTL_GEM_CLOSE, &gem_close);
+		samples[i] = now_ns() - t0;
+	}
+	print_stats("PRIME import/close", samples, loops);
+
+out_close_buf:
+	close(buf_fd);
+out_close_heap:
+	close(heap_fd);
+out_close_drm:
+	close(drm_fd);
+	return ret;
+}
+
+int bench_dmabuf_import(int argc, const char **argv)
+{
+	u64 *samples;
+	size_t size;
+	int ret;
+
+	ret = parse_args(argc, argv, &size);
+	if (ret)
+		return EXIT_FAILURE;
+
+	samples = calloc(loops, sizeof(*samples));
+	if (!samples)
+		return EXIT_FAILURE;
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# %d export/import round trips of a %zuK buffer\n\n",
+		       loops, size >> 10);
+
+	ret = bench_udmabuf(size, samples);
+	if (!ret)
+		ret = bench_prime_import(size, samples);
+
+	free(samples);
+	return ret ? EXIT_FAILURE : 0;
+}
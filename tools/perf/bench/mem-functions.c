@@ -17,6 +17,8 @@
 #include "mem-memcpy-arch.h"
 #include "mem-memset-arch.h"
 
+#include <perf/cpumap.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -31,6 +33,7 @@
 static const char	*size_str	= "1MB";
 static const char	*function_str	= "all";
 static int		nr_loops	= 1;
+static const char	*cpu_list_str;
 static bool		use_cycles;
 static int		cycles_fd;
 
@@ -48,6 +51,9 @@ static const struct option options[] = {
 	OPT_BOOLEAN('c', "cycles", &use_cycles,
 		    "Use a cycles event instead of gettimeofday() to measure performance"),
 
+	OPT_STRING('C', "cpu", &cpu_list_str, "cpu",
+		    "Pin the benchmark to a CPU list, e.g. one cluster of a big.LITTLE system"),
+
 	OPT_END()
 };
 
@@ -173,6 +179,41 @@ static void __bench_mem_function(struct bench_mem_info *info, int r_idx, size_t
 	goto out_free;
 }
 
+static int pin_cpus(const char *str)
+{
+	struct perf_cpu_map *cpus = perf_cpu_map__new(str);
+	struct perf_cpu cpu;
+	cpu_set_t *cpuset;
+	size_t size;
+	int idx, nrcpus, ret;
+
+	if (!cpus) {
+		fprintf(stderr, "Invalid CPU list: %s\n", str);
+		return -EINVAL;
+	}
+
+	nrcpus = perf_cpu_map__max(cpus).cpu + 1;
+	cpuset = CPU_ALLOC(nrcpus);
+	if (!cpuset) {
+		perf_cpu_map__put(cpus);
+		return -ENOMEM;
+	}
+	size = CPU_ALLOC_SIZE(nrcpus);
+	CPU_ZERO_S(size, cpuset);
+	perf_cpu_map__for_each_cpu(cpu, idx, cpus)
+		CPU_SET_S(cpu.cpu, size, cpuset);
+
+	ret = sched_setaffinity(0, size, cpuset);
+	if (ret)
+		fprintf(stderr, "Failed to pin to CPUs %s: %s\n", str, strerror(errno));
+	else if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# Pinned to CPUs %s\n", str);
+
+	CPU_FREE(cpuset);
+	perf_cpu_map__put(cpus);
+	return ret;
+}
+
 static int bench_mem_common(int argc, const char **argv, struct bench_mem_info *info)
 {
 	int i;
@@ -181,6 +222,9 @@ static int bench_mem_common(int argc, const char **argv, struct bench_mem_info *
 
 	argc = parse_options(argc, argv, options, info->usage, 0);
 
+	if (cpu_list_str && pin_cpus(cpu_list_str))
+		return 1;
+
 	if (use_cycles) {
 		i = init_cycles();
 		if (i < 0) {
@@ -278,6 +322,12 @@ struct function memcpy_functions[] = {
 # define MEMCPY_FN(_fn, _name, _desc) {.name = _name, .desc = _desc, .fn.memcpy = _fn},
 # include "mem-memcpy-x86-64-asm-def.h"
 # undef MEMCPY_FN
+#endif
+
+#ifdef __aarch64__
+# define MEMCPY_FN(_fn, _name, _desc) {.name = _name, .desc = _desc, .fn.memcpy = _fn},
+# include "mem-memcpy-arm64-asm-def.h"
+# undef MEMCPY_FN
 #endif
 
 	{ .name = NULL, }
@@ -357,6 +407,12 @@ static const struct function memset_functions[] = {
 # define MEMSET_FN(_fn, _name, _desc) { .name = _name, .desc = _desc, .fn.memset = _fn },
 # include "mem-memset-x86-64-asm-def.h"
 # undef MEMSET_FN
+#endif
+
+#ifdef __aarch64__
+# define MEMSET_FN(_fn, _name, _desc) { .name = _name, .desc = _desc, .fn.memset = _fn },
+# include "mem-memset-arm64-asm-def.h"
+# undef MEMSET_FN
 #endif
 
 	{ .name = NULL, }
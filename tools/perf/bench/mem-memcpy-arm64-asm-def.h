@@ -0,0 +1,9 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+MEMCPY_FN(__memcpy,
+	"arm64-generic",
+	"ldp/stp based memcpy() in arch/arm64/lib/memcpy.S")
+
+MEMCPY_FN(memcpy_ldnp,
+	"arm64-ldnp",
+	"non-temporal ldnp/stnp copy of 64 byte blocks")
@@ -11,3 +11,13 @@
 
 #endif
 
+#ifdef __aarch64__
+
+#define MEMSET_FN(fn, name, desc)		\
+	void *fn(void *, int, size_t);
+
+#include "mem-memset-arm64-asm-def.h"
+
+#undef MEMSET_FN
+
+#endif
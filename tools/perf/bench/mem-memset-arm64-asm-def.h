@@ -0,0 +1,5 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+MEMSET_FN(__memset,
+	"arm64-generic",
+	"stp/dc zva based memset() in arch/arm64/lib/memset.S")
@@ -31,10 +31,13 @@ int main(int argc, char **argv)
 	int bits = 32, xdelay = 0, dir = DMA_MAP_BIDIRECTIONAL;
 	/* default granule 1 PAGESIZE */
 	int granule = 1;
+	/* default dma_map_single() */
+	int mode = DMA_MAP_SINGLE_MODE;
+	int i;
 
 	int cmd = DMA_MAP_BENCHMARK;
 
-	while ((opt = getopt(argc, argv, "t:s:n:b:d:x:g:")) != -1) {
+	while ((opt = getopt(argc, argv, "t:s:n:b:d:x:g:m:")) != -1) {
 		switch (opt) {
 		case 't':
 			threads = atoi(optarg);
@@ -57,6 +60,9 @@ int main(int argc, char **argv)
 		case 'g':
 			granule = atoi(optarg);
 			break;
+		case 'm':
+			mode = atoi(optarg);
+			break;
 		default:
 			return -1;
 		}
@@ -97,6 +103,11 @@ int main(int argc, char **argv)
 		exit(1);
 	}
 
+	if (mode != DMA_MAP_SINGLE_MODE && mode != DMA_MAP_SG_MODE) {
+		fprintf(stderr, "invalid map mode\n");
+		exit(1);
+	}
+
 	fd = open("/sys/kernel/debug/dma_map_benchmark", O_RDWR);
 	if (fd == -1) {
 		perror("open");
@@ -111,18 +122,30 @@ int main(int argc, char **argv)
 	map.dma_dir = dir;
 	map.dma_trans_ns = xdelay;
 	map.granule = granule;
+	map.dma_mode = mode;
 
 	if (ioctl(fd, cmd, &map)) {
 		perror("ioctl");
 		exit(1);
 	}
 
-	printf("dma mapping benchmark: threads:%d seconds:%d node:%d dir:%s granule: %d\n",
-			threads, seconds, node, dir[directions], granule);
+	printf("dma mapping benchmark: threads:%d seconds:%d node:%d dir:%s granule: %d mode:%s\n",
+			threads, seconds, node, dir[directions], granule,
+			mode == DMA_MAP_SG_MODE ? "SG" : "SINGLE");
 	printf("average map latency(us):%.1f standard deviation:%.1f\n",
 			map.avg_map_100ns/10.0, map.map_stddev/10.0);
 	printf("average unmap latency(us):%.1f standard deviation:%.1f\n",
 			map.avg_unmap_100ns/10.0, map.unmap_stddev/10.0);
+	if (map.bounced)
+		printf("bounced maps:%llu average bounced map latency(us):%.1f\n",
+				map.bounced, map.avg_bounce_map_100ns/10.0);
+
+	printf("latency histogram(us):        map      unmap\n");
+	for (i = 0; i < DMA_MAP_HIST_BUCKETS - 1; i++)
+		printf("  <  %9.1f: %10llu %10llu\n", (1ULL << i) / 10.0,
+				map.map_hist[i], map.unmap_hist[i]);
+	printf("  >= %9.1f: %10llu %10llu\n", (1ULL << i) / 20.0,
+			map.map_hist[i], map.unmap_hist[i]);
 
 	return 0;
 }
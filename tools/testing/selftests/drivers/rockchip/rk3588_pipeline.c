@@ -0,0 +1,1340 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Benchmark of the RK3588 media pipeline: frames go from a dma-buf heap
+ * through RGA (colour conversion and scaling) to a VOP2 plane, sharing
+ * the buffers with dma-buf only. For every stage the latency percentiles
+ * and the throughput are reported, along with the DDR bandwidth measured
+ * by the rockchip_ddr PMU over the run.
+ *
+ * The reference set is generated: a fixed pattern at 720p, 1080p and 2160p,
+ * so results are comparable from one run and one kernel to the next.
+ *
+ * The stateless H.264 decoders, rkvdec2 and hantro, are fed a fixed
+ * reference stream through the request API, along with the controls
+ * describing it. The stream is a single 720p IDR frame of I_PCM macroblocks
+ * without deblocking, so it is written out here next to its controls rather
+ * than parsed, and the decoded frame has to match its samples exactly.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+
+#include <linux/dma-buf.h>
+#include <linux/dma-heap.h>
+#include <linux/media.h>
+#include <linux/perf_event.h>
+#include <linux/videodev2.h>
+#include <drm/drm.h>
+#include <drm/drm_fourcc.h>
+#include <drm/drm_mode.h>
+
+#include "../../kselftest.h"
+
+#define NR_SRC_BUFS	4
+#define NR_DST_BUFS	3
+#define NR_DEC_BUFS	2
+#define MAX_CONNECTORS	16
+
+/* Size of the decoder reference stream, in pixels and in macroblocks */
+#define DEC_WIDTH	1280
+#define DEC_HEIGHT	720
+#define DEC_MB_WIDTH	(DEC_WIDTH / 16)
+#define DEC_MB_HEIGHT	(DEC_HEIGHT / 16)
+
+static const struct {
+	unsigned int width;
+	unsigned int height;
+} ref_sizes[] = {
+	{ 1280, 720 },
+	{ 1920, 1080 },
+	{ 3840, 2160 },
+};
+
+/* Drivers of the stateless H.264 decoders, each is a test of its own */
+static const char * const decoders[] = {
+	"rkvdec2",
+	"hantro-vpu",
+};
+
+static unsigned int nr_frames = 300;
+static const char *heap_name = "system";
+static int no_display;
+
+struct buffer {
+	int fd;
+	size_t size;
+	uint32_t fb_id;
+};
+
+struct stage {
+	const char *name;
+	uint64_t *lat;
+	unsigned int count;
+	uint64_t busy_ns;
+};
+
+struct display {
+	int fd;
+	uint32_t crtc_id;
+	uint32_t connector_id;
+	struct drm_mode_modeinfo mode;
+};
+
+struct ddr_pmu {
+	int read_fd;
+	int write_fd;
+};
+
+struct ref_stream {
+	struct v4l2_ctrl_h264_sps sps;
+	struct v4l2_ctrl_h264_pps pps;
+	struct v4l2_ctrl_h264_decode_params decode;
+	uint8_t *data;
+	size_t len;
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int xioctl(int fd, unsigned long req, void *arg)
+{
+	int ret;
+
+	do {
+		ret = ioctl(fd, req, arg);
+	} while (ret == -1 && (errno == EINTR || errno == EAGAIN));
+
+	return ret;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static uint64_t percentile(const struct stage *s, unsigned int pct)
+{
+	return s->lat[(s->count - 1) * pct / 100];
+}
+
+static void stage_report(struct stage *s, unsigned int width,
+			 unsigned int height)
+{
+	if (!s->count)
+		return;
+
+	qsort(s->lat, s->count, sizeof(*s->lat), cmp_u64);
+	/* a coarse clock can make a fast stage appear to take no time */
+	ksft_print_msg("%ux%u %-8s p50 %6.2f ms  p90 %6.2f ms  p99 %6.2f ms  max %6.2f ms  %7.1f fps\n",
+		       width, height, s->name,
+		       percentile(s, 50) / 1e6, percentile(s, 90) / 1e6,
+		       percentile(s, 99) / 1e6, s->lat[s->count - 1] / 1e6,
+		       s->busy_ns ? s->count * 1e9 / s->busy_ns : 0.0);
+}
+
+static void stage_add(struct stage *s, uint64_t ns)
+{
+	s->lat[s->count++] = ns;
+	s->busy_ns += ns;
+}
+
+/* dma-buf heap buffers */
+
+static int heap_open(void)
+{
+	char path[64];
+
+	snprintf(path, sizeof(path), "/dev/dma_heap/%s", heap_name);
+	return open(path, O_RDWR | O_CLOEXEC);
+}
+
+static int buffer_alloc(int heap_fd, struct buffer *buf, size_t size)
+{
+	struct dma_heap_allocation_data data = {
+		.len = size,
+		.fd_flags = O_RDWR | O_CLOEXEC,
+	};
+
+	if (xioctl(heap_fd, DMA_HEAP_IOCTL_ALLOC, &data))
+		return -errno;
+
+	buf->fd = data.fd;
+	buf->size = size;
+	buf->fb_id = 0;
+	return 0;
+}
+
+/* Fill an NV12 frame with a pattern that depends on its index only */
+static int buffer_fill_nv12(struct buffer *buf, unsigned int width,
+			    unsigned int height, unsigned int stride,
+			    unsigned int index)
+{
+	struct dma_buf_sync sync = { .flags = DMA_BUF_SYNC_START | DMA_BUF_SYNC_WRITE };
+	unsigned int x, y;
+	uint8_t *p;
+
+	p = mmap(NULL, buf->size, PROT_READ | PROT_WRITE, MAP_SHARED, buf->fd, 0);
+	if (p == MAP_FAILED)
+		return -errno;
+
+	xioctl(buf->fd, DMA_BUF_IOCTL_SYNC, &sync);
+
+	for (y = 0; y < height; y++)
+		for (x = 0; x < width; x++)
+			p[y * stride + x] = (x + y + index * 16) & 0xff;
+
+	for (y = 0; y < height / 2; y++)
+		for (x = 0; x < width; x += 2) {
+			uint8_t *uv = p + stride * height + y * stride + x;
+
+			uv[0] = (x * 255 / width) & 0xff;
+			uv[1] = (y * 2 * 255 / height) & 0xff;
+		}
+
+	sync.flags = DMA_BUF_SYNC_END | DMA_BUF_SYNC_WRITE;
+	xioctl(buf->fd, DMA_BUF_IOCTL_SYNC, &sync);
+	munmap(p, buf->size);
+
+	return 0;
+}
+
+static int buffer_write(struct buffer *buf, const void *data, size_t len)
+{
+	struct dma_buf_sync sync = { .flags = DMA_BUF_SYNC_START | DMA_BUF_SYNC_WRITE };
+	void *p;
+
+	p = mmap(NULL, buf->size, PROT_READ | PROT_WRITE, MAP_SHARED, buf->fd, 0);
+	if (p == MAP_FAILED)
+		return -errno;
+
+	xioctl(buf->fd, DMA_BUF_IOCTL_SYNC, &sync);
+	memcpy(p, data, len);
+	sync.flags = DMA_BUF_SYNC_END | DMA_BUF_SYNC_WRITE;
+	xioctl(buf->fd, DMA_BUF_IOCTL_SYNC, &sync);
+	munmap(p, buf->size);
+
+	return 0;
+}
+
+/* Reference H.264 stream */
+
+static uint8_t ref_luma(unsigned int x, unsigned int y)
+{
+	return 16 + (x * 3 + y * 5) % 220;
+}
+
+/* @c is 0 for Cb and 1 for Cr, no sample is ever zero */
+static uint8_t ref_chroma(unsigned int x, unsigned int y, unsigned int c)
+{
+	return 16 + (x * (c ? 7 : 2) + y * 3) % 224;
+}
+
+struct bitwriter {
+	uint8_t *buf;
+	size_t len;
+	unsigned int bits;	/* bits already used in buf[len] */
+};
+
+static void put_bits(struct bitwriter *bw, unsigned int n, uint32_t val)
+{
+	while (n--) {
+		if (!bw->bits)
+			bw->buf[bw->len] = 0;
+		bw->buf[bw->len] |= ((val >> n) & 1) << (7 - bw->bits);
+		if (++bw->bits == 8) {
+			bw->bits = 0;
+			bw->len++;
+		}
+	}
+}
+
+/* Exp-Golomb codes, ue(v) and se(v) */
+static void put_ue(struct bitwriter *bw, uint32_t val)
+{
+	unsigned int n = 0;
+
+	while ((val + 1) >> (n + 1))
+		n++;
+	put_bits(bw, n, 0);
+	put_bits(bw, n + 1, val + 1);
+}
+
+static void put_se(struct bitwriter *bw, int32_t val)
+{
+	put_ue(bw, val > 0 ? 2 * val - 1 : -2 * val);
+}
+
+static void put_align_zero(struct bitwriter *bw)
+{
+	while (bw->bits)
+		put_bits(bw, 1, 0);
+}
+
+/*
+ * Write the RBSP of a NAL unit to @out behind an Annex B start code and the
+ * NAL header, inserting the emulation prevention bytes.
+ */
+static size_t put_nal(uint8_t *out, uint8_t header, const uint8_t *rbsp,
+		      size_t len)
+{
+	unsigned int zeros = 0;
+	size_t i, n = 0;
+
+	out[n++] = 0;
+	out[n++] = 0;
+	out[n++] = 0;
+	out[n++] = 1;
+	out[n++] = header;
+
+	for (i = 0; i < len; i++) {
+		if (zeros == 2 && rbsp[i] <= 3) {
+			out[n++] = 3;
+			zeros = 0;
+		}
+		out[n++] = rbsp[i];
+		zeros = rbsp[i] ? 0 : zeros + 1;
+	}
+
+	return n;
+}
+
+/*
+ * Build the reference stream: one baseline profile IDR slice of I_PCM
+ * macroblocks, and the SPS, PPS and decode parameters describing it. The
+ * parameter sets only go to the decoders as controls, a stateless decoder
+ * gets nothing but the slices in its bitstream buffers.
+ */
+static int ref_stream_init(struct ref_stream *ref)
+{
+	/* 384 samples and at most 2 bytes of mb_type and alignment per MB */
+	size_t rbsp_size = DEC_MB_WIDTH * DEC_MB_HEIGHT * 386 + 16;
+	struct bitwriter bw = { 0 };
+	unsigned int mbx, mby, x, y, c;
+
+	memset(ref, 0, sizeof(*ref));
+
+	ref->sps.profile_idc = 66;
+	ref->sps.level_idc = 31;
+	ref->sps.chroma_format_idc = 1;
+	ref->sps.pic_order_cnt_type = 2;
+	ref->sps.max_num_ref_frames = 1;
+	ref->sps.pic_width_in_mbs_minus1 = DEC_MB_WIDTH - 1;
+	ref->sps.pic_height_in_map_units_minus1 = DEC_MB_HEIGHT - 1;
+	ref->sps.flags = V4L2_H264_SPS_FLAG_FRAME_MBS_ONLY |
+			 V4L2_H264_SPS_FLAG_DIRECT_8X8_INFERENCE;
+
+	ref->pps.flags = V4L2_H264_PPS_FLAG_DEBLOCKING_FILTER_CONTROL_PRESENT;
+
+	ref->decode.nal_ref_idc = 3;
+	/* no_output_of_prior_pics_flag and long_term_reference_flag */
+	ref->decode.dec_ref_pic_marking_bit_size = 2;
+	ref->decode.flags = V4L2_H264_DECODE_PARAM_FLAG_IDR_PIC;
+
+	bw.buf = malloc(rbsp_size);
+	/* worst case, an emulation prevention byte every two bytes */
+	ref->data = malloc(rbsp_size * 3 / 2 + 8);
+	if (!bw.buf || !ref->data) {
+		free(bw.buf);
+		free(ref->data);
+		return -ENOMEM;
+	}
+
+	/* slice_header() */
+	put_ue(&bw, 0);			/* first_mb_in_slice */
+	put_ue(&bw, 7);			/* slice_type, I for the whole picture */
+	put_ue(&bw, 0);			/* pic_parameter_set_id */
+	put_bits(&bw, 4, 0);		/* frame_num */
+	put_ue(&bw, 0);			/* idr_pic_id */
+	put_bits(&bw, 1, 0);		/* no_output_of_prior_pics_flag */
+	put_bits(&bw, 1, 0);		/* long_term_reference_flag */
+	put_se(&bw, 0);			/* slice_qp_delta */
+	put_ue(&bw, 1);			/* disable_deblocking_filter_idc */
+
+	/* slice_data() */
+	for (mby = 0; mby < DEC_MB_HEIGHT; mby++) {
+		for (mbx = 0; mbx < DEC_MB_WIDTH; mbx++) {
+			put_ue(&bw, 25);	/* mb_type I_PCM */
+			put_align_zero(&bw);	/* pcm_alignment_zero_bit */
+
+			for (y = 0; y < 16; y++)
+				for (x = 0; x < 16; x++)
+					put_bits(&bw, 8, ref_luma(mbx * 16 + x,
+								  mby * 16 + y));
+			for (c = 0; c < 2; c++)
+				for (y = 0; y < 8; y++)
+					for (x = 0; x < 8; x++)
+						put_bits(&bw, 8,
+							 ref_chroma(mbx * 8 + x,
+								    mby * 8 + y, c));
+		}
+	}
+
+	/* rbsp_slice_trailing_bits() */
+	put_bits(&bw, 1, 1);
+	put_align_zero(&bw);
+
+	/* nal_ref_idc 3, nal_unit_type 5 (IDR slice) */
+	ref->len = put_nal(ref->data, 0x65, bw.buf, bw.len);
+	free(bw.buf);
+
+	return 0;
+}
+
+/* rockchip_ddr PMU */
+
+static int read_sysfs_int(const char *path, int *val)
+{
+	FILE *f = fopen(path, "r");
+	int ret;
+
+	if (!f)
+		return -errno;
+
+	ret = fscanf(f, "%d", val) == 1 ? 0 : -EINVAL;
+	fclose(f);
+	return ret;
+}
+
+static int ddr_pmu_open_event(int type, int cpu, uint64_t config)
+{
+	struct perf_event_attr attr = {
+		.type = type,
+		.size = sizeof(attr),
+		.config = config,
+		.disabled = 1,
+	};
+
+	return syscall(__NR_perf_event_open, &attr, -1, cpu, -1, 0);
+}
+
+static int ddr_pmu_open(struct ddr_pmu *pmu)
+{
+	/* read-bytes and write-bytes, summed over all channels */
+	const uint64_t read_bytes = 0x1, write_bytes = 0x2;
+	int type, cpu;
+
+	pmu->read_fd = pmu->write_fd = -1;
+
+	if (read_sysfs_int("/sys/bus/event_source/devices/rockchip_ddr/type", &type) ||
+	    read_sysfs_int("/sys/bus/event_source/devices/rockchip_ddr/cpumask", &cpu))
+		return -ENODEV;
+
+	pmu->read_fd = ddr_pmu_open_event(type, cpu, read_bytes);
+	pmu->write_fd = ddr_pmu_open_event(type, cpu, write_bytes);
+	if (pmu->read_fd < 0 || pmu->write_fd < 0)
+		return -errno;
+
+	return 0;
+}
+
+static void ddr_pmu_start(struct ddr_pmu *pmu)
+{
+	if (pmu->read_fd < 0)
+		return;
+
+	ioctl(pmu->read_fd, PERF_EVENT_IOC_RESET, 0);
+	ioctl(pmu->write_fd, PERF_EVENT_IOC_RESET, 0);
+	ioctl(pmu->read_fd, PERF_EVENT_IOC_ENABLE, 0);
+	ioctl(pmu->write_fd, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+static void ddr_pmu_report(struct ddr_pmu *pmu, uint64_t ns,
+			   unsigned int width, unsigned int height)
+{
+	uint64_t rd = 0, wr = 0;
+
+	if (pmu->read_fd < 0)
+		return;
+
+	ioctl(pmu->read_fd, PERF_EVENT_IOC_DISABLE, 0);
+	ioctl(pmu->write_fd, PERF_EVENT_IOC_DISABLE, 0);
+	if (read(pmu->read_fd, &rd, sizeof(rd)) != sizeof(rd) ||
+	    read(pmu->write_fd, &wr, sizeof(wr)) != sizeof(wr))
+		return;
+
+	ksft_print_msg("%ux%u ddr      read %8.1f MB/s  write %8.1f MB/s\n",
+		       width, height, rd * 1e3 / ns, wr * 1e3 / ns);
+}
+
+/* RGA, through the V4L2 mem2mem interface */
+
+static int rga_open(void)
+{
+	struct v4l2_capability cap;
+	char path[32];
+	int i, fd;
+
+	for (i = 0; i < 64; i++) {
+		snprintf(path, sizeof(path), "/dev/video%d", i);
+		fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+		if (fd < 0)
+			continue;
+
+		if (!xioctl(fd, VIDIOC_QUERYCAP, &cap) &&
+		    !strcmp((const char *)cap.driver, "rockchip-rga"))
+			return fd;
+
+		close(fd);
+	}
+
+	return -ENODEV;
+}
+
+static int rga_set_format(int fd, enum v4l2_buf_type type, uint32_t fourcc,
+			  unsigned int width, unsigned int height,
+			  struct v4l2_pix_format_mplane *out)
+{
+	struct v4l2_format fmt = { .type = type };
+
+	fmt.fmt.pix_mp.width = width;
+	fmt.fmt.pix_mp.height = height;
+	fmt.fmt.pix_mp.pixelformat = fourcc;
+	fmt.fmt.pix_mp.num_planes = 1;
+
+	if (xioctl(fd, VIDIOC_S_FMT, &fmt))
+		return -errno;
+
+	if (fmt.fmt.pix_mp.width != width || fmt.fmt.pix_mp.height != height ||
+	    fmt.fmt.pix_mp.pixelformat != fourcc)
+		return -EINVAL;
+
+	*out = fmt.fmt.pix_mp;
+	return 0;
+}
+
+/* The queue helpers below are shared by RGA and the decoders */
+
+static int m2m_setup_queue(int fd, enum v4l2_buf_type type, unsigned int count)
+{
+	struct v4l2_requestbuffers req = {
+		.count = count,
+		.type = type,
+		.memory = V4L2_MEMORY_DMABUF,
+	};
+
+	if (xioctl(fd, VIDIOC_REQBUFS, &req))
+		return -errno;
+
+	return req.count == count ? 0 : -ENOMEM;
+}
+
+/* @request_fd is the request to queue the buffer to, or -1 for none */
+static int m2m_queue(int fd, enum v4l2_buf_type type, unsigned int index,
+		     struct buffer *buf, size_t bytesused, int request_fd)
+{
+	struct v4l2_plane plane = {
+		.m.fd = buf->fd,
+		.length = buf->size,
+		.bytesused = bytesused,
+	};
+	struct v4l2_buffer vbuf = {
+		.type = type,
+		.memory = V4L2_MEMORY_DMABUF,
+		.index = index,
+		.m.planes = &plane,
+		.length = 1,
+	};
+
+	if (request_fd >= 0) {
+		vbuf.flags = V4L2_BUF_FLAG_REQUEST_FD;
+		vbuf.request_fd = request_fd;
+	}
+
+	return xioctl(fd, VIDIOC_QBUF, &vbuf) ? -errno : 0;
+}
+
+static int m2m_dequeue(int fd, enum v4l2_buf_type type)
+{
+	struct v4l2_plane plane;
+	struct v4l2_buffer vbuf = {
+		.type = type,
+		.memory = V4L2_MEMORY_DMABUF,
+		.m.planes = &plane,
+		.length = 1,
+	};
+	struct pollfd pfd = { .fd = fd, .events = POLLIN | POLLOUT };
+
+	while (ioctl(fd, VIDIOC_DQBUF, &vbuf)) {
+		if (errno != EAGAIN)
+			return -errno;
+		if (poll(&pfd, 1, 1000) <= 0)
+			return -ETIMEDOUT;
+	}
+
+	return vbuf.flags & V4L2_BUF_FLAG_ERROR ? -EIO : 0;
+}
+
+static int m2m_stream(int fd, int on)
+{
+	int type;
+
+	type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+	if (xioctl(fd, on ? VIDIOC_STREAMON : VIDIOC_STREAMOFF, &type))
+		return -errno;
+
+	type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+	if (xioctl(fd, on ? VIDIOC_STREAMON : VIDIOC_STREAMOFF, &type))
+		return -errno;
+
+	return 0;
+}
+
+/* Stateless H.264 decoders, through the request API */
+
+static int video_supports(int fd, enum v4l2_buf_type type, uint32_t fourcc)
+{
+	struct v4l2_fmtdesc desc = { .type = type };
+
+	for (desc.index = 0; !xioctl(fd, VIDIOC_ENUM_FMT, &desc); desc.index++)
+		if (desc.pixelformat == fourcc)
+			return 1;
+
+	return 0;
+}
+
+static int decoder_open(const char *driver)
+{
+	struct v4l2_capability cap;
+	char path[32];
+	int i, fd;
+
+	for (i = 0; i < 64; i++) {
+		snprintf(path, sizeof(path), "/dev/video%d", i);
+		fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+		if (fd < 0)
+			continue;
+
+		/* hantro also registers encoders and other decoders */
+		if (!xioctl(fd, VIDIOC_QUERYCAP, &cap) &&
+		    !strcmp((const char *)cap.driver, driver) &&
+		    video_supports(fd, V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE,
+				   V4L2_PIX_FMT_H264_SLICE))
+			return fd;
+
+		close(fd);
+	}
+
+	return -ENODEV;
+}
+
+/* Find the media device whose topology has the video node @video_fd */
+static int media_open(int video_fd)
+{
+	struct media_v2_interface *intfs;
+	char path[32];
+	struct stat st;
+	unsigned int j;
+	int i, fd;
+
+	if (fstat(video_fd, &st))
+		return -errno;
+
+	for (i = 0; i < 64; i++) {
+		struct media_v2_topology topo = { 0 };
+		int found = 0;
+
+		snprintf(path, sizeof(path), "/dev/media%d", i);
+		fd = open(path, O_RDWR | O_CLOEXEC);
+		if (fd < 0)
+			continue;
+
+		if (xioctl(fd, MEDIA_IOC_G_TOPOLOGY, &topo) || !topo.num_interfaces) {
+			close(fd);
+			continue;
+		}
+
+		intfs = calloc(topo.num_interfaces, sizeof(*intfs));
+		topo.ptr_interfaces = (uintptr_t)intfs;
+		if (intfs && !xioctl(fd, MEDIA_IOC_G_TOPOLOGY, &topo)) {
+			for (j = 0; j < topo.num_interfaces; j++)
+				if (intfs[j].devnode.major == major(st.st_rdev) &&
+				    intfs[j].devnode.minor == minor(st.st_rdev))
+					found = 1;
+		}
+		free(intfs);
+
+		if (found)
+			return fd;
+		close(fd);
+	}
+
+	return -ENODEV;
+}
+
+static int decoder_set_format(int fd, size_t stream_len,
+			      struct v4l2_pix_format_mplane *out)
+{
+	struct v4l2_format fmt = { .type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE };
+
+	fmt.fmt.pix_mp.width = DEC_WIDTH;
+	fmt.fmt.pix_mp.height = DEC_HEIGHT;
+	fmt.fmt.pix_mp.pixelformat = V4L2_PIX_FMT_H264_SLICE;
+	fmt.fmt.pix_mp.num_planes = 1;
+	fmt.fmt.pix_mp.plane_fmt[0].sizeimage = stream_len;
+
+	if (xioctl(fd, VIDIOC_S_FMT, &fmt))
+		return -errno;
+
+	if (fmt.fmt.pix_mp.pixelformat != V4L2_PIX_FMT_H264_SLICE ||
+	    fmt.fmt.pix_mp.plane_fmt[0].sizeimage < stream_len)
+		return -EINVAL;
+
+	*out = fmt.fmt.pix_mp;
+	return 0;
+}
+
+/*
+ * The controls go with each request, so they are set the same way a player
+ * sets them. Outside of a request, @request_fd is -1 and the SPS alone is
+ * set, for the decoder to derive the decoded format from.
+ */
+static int decoder_set_controls(int fd, const struct ref_stream *ref,
+				int request_fd)
+{
+	struct v4l2_ext_control ctrls[] = {
+		{
+			.id = V4L2_CID_STATELESS_H264_SPS,
+			.size = sizeof(ref->sps),
+			.ptr = (void *)&ref->sps,
+		}, {
+			.id = V4L2_CID_STATELESS_H264_PPS,
+			.size = sizeof(ref->pps),
+			.ptr = (void *)&ref->pps,
+		}, {
+			.id = V4L2_CID_STATELESS_H264_DECODE_PARAMS,
+			.size = sizeof(ref->decode),
+			.ptr = (void *)&ref->decode,
+		},
+	};
+	struct v4l2_ext_controls ext = {
+		.which = V4L2_CTRL_WHICH_CUR_VAL,
+		.count = 1,
+		.controls = ctrls,
+	};
+
+	if (request_fd >= 0) {
+		ext.which = V4L2_CTRL_WHICH_REQUEST_VAL;
+		ext.count = ARRAY_SIZE(ctrls);
+		ext.request_fd = request_fd;
+	}
+
+	return xioctl(fd, VIDIOC_S_EXT_CTRLS, &ext) ? -errno : 0;
+}
+
+static int decoder_wait(int request_fd)
+{
+	struct pollfd pfd = { .fd = request_fd, .events = POLLPRI };
+
+	return poll(&pfd, 1, 1000) > 0 ? 0 : -ETIMEDOUT;
+}
+
+/* The decoded NV12 frame has to hold the PCM samples of the stream */
+static int decoder_check_frame(struct buffer *buf,
+			       const struct v4l2_pix_format_mplane *fmt)
+{
+	struct dma_buf_sync sync = { .flags = DMA_BUF_SYNC_START | DMA_BUF_SYNC_READ };
+	unsigned int stride = fmt->plane_fmt[0].bytesperline;
+	unsigned int x, y, c;
+	const uint8_t *p;
+	int ret = 0;
+
+	p = mmap(NULL, buf->size, PROT_READ, MAP_SHARED, buf->fd, 0);
+	if (p == MAP_FAILED)
+		return -errno;
+
+	xioctl(buf->fd, DMA_BUF_IOCTL_SYNC, &sync);
+
+	for (y = 0; y < DEC_HEIGHT && !ret; y++)
+		for (x = 0; x < DEC_WIDTH && !ret; x++)
+			if (p[y * stride + x] != ref_luma(x, y)) {
+				ksft_print_msg("luma differs at %u,%u\n", x, y);
+				ret = -EIO;
+			}
+
+	for (y = 0; y < DEC_HEIGHT / 2 && !ret; y++)
+		for (x = 0; x < DEC_WIDTH / 2 && !ret; x++)
+			for (c = 0; c < 2; c++) {
+				const uint8_t *uv = p + stride * fmt->height +
+						    y * stride + x * 2;
+
+				if (uv[c] != ref_chroma(x, y, c)) {
+					ksft_print_msg("chroma differs at %u,%u\n",
+						       x, y);
+					ret = -EIO;
+					break;
+				}
+			}
+
+	sync.flags = DMA_BUF_SYNC_END | DMA_BUF_SYNC_READ;
+	xioctl(buf->fd, DMA_BUF_IOCTL_SYNC, &sync);
+	munmap((void *)p, buf->size);
+
+	return ret;
+}
+
+/* VOP2, through KMS */
+
+static int drm_open_rockchip(void)
+{
+	char path[32], name[16];
+	int i, fd;
+
+	for (i = 0; i < 16; i++) {
+		struct drm_version version = {
+			.name = name,
+			.name_len = sizeof(name) - 1,
+		};
+
+		snprintf(path, sizeof(path), "/dev/dri/card%d", i);
+		fd = open(path, O_RDWR | O_CLOEXEC);
+		if (fd < 0)
+			continue;
+
+		memset(name, 0, sizeof(name));
+		if (!xioctl(fd, DRM_IOCTL_VERSION, &version) &&
+		    !strcmp(name, "rockchip"))
+			return fd;
+
+		close(fd);
+	}
+
+	return -ENODEV;
+}
+
+static int display_find_output(struct display *disp)
+{
+	uint32_t connectors[MAX_CONNECTORS], crtcs[MAX_CONNECTORS];
+	struct drm_mode_card_res res = { 0 };
+	unsigned int i;
+
+	if (xioctl(disp->fd, DRM_IOCTL_MODE_GETRESOURCES, &res))
+		return -errno;
+
+	if (res.count_connectors > MAX_CONNECTORS)
+		res.count_connectors = MAX_CONNECTORS;
+	if (res.count_crtcs > MAX_CONNECTORS)
+		res.count_crtcs = MAX_CONNECTORS;
+
+	res.connector_id_ptr = (uintptr_t)connectors;
+	res.crtc_id_ptr = (uintptr_t)crtcs;
+	res.count_fbs = res.count_encoders = 0;
+	if (xioctl(disp->fd, DRM_IOCTL_MODE_GETRESOURCES, &res))
+		return -errno;
+
+	for (i = 0; i < res.count_connectors; i++) {
+		struct drm_mode_get_connector conn = {
+			.connector_id = connectors[i],
+		};
+		struct drm_mode_modeinfo modes[64];
+		struct drm_mode_get_encoder enc = { 0 };
+		unsigned int m, c;
+
+		if (xioctl(disp->fd, DRM_IOCTL_MODE_GETCONNECTOR, &conn))
+			continue;
+		if (conn.connection != 1 || !conn.count_modes || !conn.encoder_id)
+			continue;
+
+		if (conn.count_modes > 64)
+			conn.count_modes = 64;
+		conn.modes_ptr = (uintptr_t)modes;
+		conn.count_props = conn.count_encoders = 0;
+		if (xioctl(disp->fd, DRM_IOCTL_MODE_GETCONNECTOR, &conn))
+			continue;
+
+		enc.encoder_id = conn.encoder_id;
+		if (xioctl(disp->fd, DRM_IOCTL_MODE_GETENCODER, &enc))
+			continue;
+
+		disp->mode = modes[0];
+		for (m = 0; m < conn.count_modes; m++) {
+			if (modes[m].type & DRM_MODE_TYPE_PREFERRED) {
+				disp->mode = modes[m];
+				break;
+			}
+		}
+
+		disp->connector_id = connectors[i];
+		disp->crtc_id = enc.crtc_id;
+		for (c = 0; !disp->crtc_id && c < res.count_crtcs; c++)
+			if (enc.possible_crtcs & (1 << c))
+				disp->crtc_id = crtcs[c];
+
+		if (disp->crtc_id)
+			return 0;
+	}
+
+	return -ENODEV;
+}
+
+static int display_add_fb(struct display *disp, struct buffer *buf,
+			  unsigned int pitch)
+{
+	struct drm_prime_handle prime = { .fd = buf->fd };
+	struct drm_mode_fb_cmd2 fb = {
+		.width = disp->mode.hdisplay,
+		.height = disp->mode.vdisplay,
+		.pixel_format = DRM_FORMAT_XRGB8888,
+	};
+	struct drm_gem_close gem_close = { 0 };
+	int ret = 0;
+
+	if (xioctl(disp->fd, DRM_IOCTL_PRIME_FD_TO_HANDLE, &prime))
+		return -errno;
+
+	fb.handles[0] = prime.handle;
+	fb.pitches[0] = pitch;
+	if (xioctl(disp->fd, DRM_IOCTL_MODE_ADDFB2, &fb))
+		ret = -errno;
+	else
+		buf->fb_id = fb.fb_id;
+
+	/* the framebuffer holds its own reference */
+	gem_close.handle = prime.handle;
+	xioctl(disp->fd, DRM_IOCTL_GEM_CLOSE, &gem_close);
+
+	return ret;
+}
+
+static int display_set_crtc(struct display *disp, struct buffer *buf)
+{
+	struct drm_mode_crtc crtc = {
+		.crtc_id = disp->crtc_id,
+		.fb_id = buf->fb_id,
+		.set_connectors_ptr = (uintptr_t)&disp->connector_id,
+		.count_connectors = 1,
+		.mode = disp->mode,
+		.mode_valid = 1,
+	};
+
+	return xioctl(disp->fd, DRM_IOCTL_MODE_SETCRTC, &crtc) ? -errno : 0;
+}
+
+static int display_flip(struct display *disp, struct buffer *buf)
+{
+	struct drm_mode_crtc_page_flip flip = {
+		.crtc_id = disp->crtc_id,
+		.fb_id = buf->fb_id,
+		.flags = DRM_MODE_PAGE_FLIP_EVENT,
+	};
+	struct pollfd pfd = { .fd = disp->fd, .events = POLLIN };
+	struct drm_event_vblank ev;
+
+	if (xioctl(disp->fd, DRM_IOCTL_MODE_PAGE_FLIP, &flip))
+		return -errno;
+
+	if (poll(&pfd, 1, 1000) <= 0)
+		return -ETIMEDOUT;
+
+	if (read(disp->fd, &ev, sizeof(ev)) != sizeof(ev) ||
+	    ev.base.type != DRM_EVENT_FLIP_COMPLETE)
+		return -EIO;
+
+	return 0;
+}
+
+static void display_rm_fb(struct display *disp, struct buffer *buf)
+{
+	if (buf->fb_id)
+		xioctl(disp->fd, DRM_IOCTL_MODE_RMFB, &buf->fb_id);
+	buf->fb_id = 0;
+}
+
+/*
+ * Run the reference frames of one size through the pipeline, one frame
+ * at a time, so that the latency of each stage is not hidden by queueing.
+ */
+static int run_size(int heap_fd, int rga_fd, struct display *disp,
+		    unsigned int width, unsigned int height)
+{
+	struct v4l2_pix_format_mplane src_fmt, dst_fmt;
+	struct buffer src[NR_SRC_BUFS] = {}, dst[NR_DST_BUFS] = {};
+	struct stage rga = { .name = "rga" }, flip = { .name = "display" };
+	struct stage total = { .name = "total" };
+	unsigned int dst_w = width, dst_h = height;
+	struct ddr_pmu ddr;
+	uint64_t start, t0, t1, t2;
+	unsigned int i;
+	int ret;
+
+	if (disp) {
+		dst_w = disp->mode.hdisplay;
+		dst_h = disp->mode.vdisplay;
+	}
+
+	rga.lat = calloc(nr_frames, sizeof(uint64_t));
+	flip.lat = calloc(nr_frames, sizeof(uint64_t));
+	total.lat = calloc(nr_frames, sizeof(uint64_t));
+	if (!rga.lat || !flip.lat || !total.lat)
+		return -ENOMEM;
+
+	ret = rga_set_format(rga_fd, V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE,
+			     V4L2_PIX_FMT_NV12, width, height, &src_fmt);
+	if (!ret)
+		ret = rga_set_format(rga_fd, V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE,
+				     V4L2_PIX_FMT_XBGR32, dst_w, dst_h, &dst_fmt);
+	if (ret) {
+		ksft_print_msg("%ux%u: RGA format setup failed: %s\n",
+			       width, height, strerror(-ret));
+		goto out_free;
+	}
+
+	for (i = 0; i < NR_SRC_BUFS; i++) {
+		ret = buffer_alloc(heap_fd, &src[i], src_fmt.plane_fmt[0].sizeimage);
+		if (!ret)
+			ret = buffer_fill_nv12(&src[i], width, height,
+					       src_fmt.plane_fmt[0].bytesperline, i);
+		if (ret)
+			goto out_free;
+	}
+
+	for (i = 0; i < NR_DST_BUFS; i++) {
+		ret = buffer_alloc(heap_fd, &dst[i], dst_fmt.plane_fmt[0].sizeimage);
+		if (!ret && disp)
+			ret = display_add_fb(disp, &dst[i],
+					     dst_fmt.plane_fmt[0].bytesperline);
+		if (ret)
+			goto out_free;
+	}
+
+	ret = m2m_setup_queue(rga_fd, V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE, NR_SRC_BUFS);
+	if (!ret)
+		ret = m2m_setup_queue(rga_fd, V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE,
+				      NR_DST_BUFS);
+	if (!ret)
+		ret = m2m_stream(rga_fd, 1);
+	if (!ret && disp)
+		ret = display_set_crtc(disp, &dst[0]);
+	if (ret) {
+		ksft_print_msg("%ux%u: pipeline setup failed: %s\n",
+			       width, height, strerror(-ret));
+		goto out_queues;
+	}
+
+	if (ddr_pmu_open(&ddr))
+		ksft_print_msg("rockchip_ddr PMU not available, no DDR bandwidth\n");
+
+	ddr_pmu_start(&ddr);
+	start = now_ns();
+
+	for (i = 0; i < nr_frames; i++) {
+		struct buffer *out = &dst[i % NR_DST_BUFS];
+
+		t0 = now_ns();
+		ret = m2m_queue(rga_fd, V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE,
+				i % NR_SRC_BUFS, &src[i % NR_SRC_BUFS],
+				src_fmt.plane_fmt[0].sizeimage, -1);
+		if (!ret)
+			ret = m2m_queue(rga_fd, V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE,
+					i % NR_DST_BUFS, out, 0, -1);
+		if (!ret)
+			ret = m2m_dequeue(rga_fd, V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE);
+		if (!ret)
+			ret = m2m_dequeue(rga_fd, V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE);
+		if (ret) {
+			ksft_print_msg("%ux%u: RGA frame %u failed: %s\n",
+				       width, height, i, strerror(-ret));
+			break;
+		}
+		t1 = now_ns();
+		stage_add(&rga, t1 - t0);
+
+		if (disp) {
+			ret = display_flip(disp, out);
+			if (ret) {
+				ksft_print_msg("%ux%u: flip %u failed: %s\n",
+					       width, height, i, strerror(-ret));
+				break;
+			}
+			t2 = now_ns();
+			stage_add(&flip, t2 - t1);
+		} else {
+			t2 = t1;
+		}
+		stage_add(&total, t2 - t0);
+	}
+
+	ddr_pmu_report(&ddr, now_ns() - start, width, height);
+	stage_report(&rga, width, height);
+	stage_report(&flip, width, height);
+	stage_report(&total, width, height);
+
+	if (ddr.read_fd >= 0)
+		close(ddr.read_fd);
+	if (ddr.write_fd >= 0)
+		close(ddr.write_fd);
+
+out_queues:
+	/* the next size can only set its formats once the queues are freed */
+	m2m_stream(rga_fd, 0);
+	m2m_setup_queue(rga_fd, V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE, 0);
+	m2m_setup_queue(rga_fd, V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE, 0);
+
+out_free:
+	/* buffers not allocated yet have a zero size */
+	for (i = 0; i < NR_DST_BUFS; i++) {
+		if (disp)
+			display_rm_fb(disp, &dst[i]);
+		if (dst[i].size)
+			close(dst[i].fd);
+	}
+	for (i = 0; i < NR_SRC_BUFS; i++)
+		if (src[i].size)
+			close(src[i].fd);
+
+	free(rga.lat);
+	free(flip.lat);
+	free(total.lat);
+	return ret;
+}
+
+/*
+ * Decode the reference stream with the decoder of @driver, one frame at a
+ * time as for the pipeline, and check the first decoded frame.
+ */
+static int run_decoder(int heap_fd, const char *driver,
+		       const struct ref_stream *ref)
+{
+	struct v4l2_format fmt = { .type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE };
+	struct v4l2_pix_format_mplane src_fmt = {}, cap_fmt;
+	struct buffer src = {}, dst[NR_DEC_BUFS] = {};
+	struct stage dec = { .name = driver };
+	int fd, media_fd, request_fd = -1;
+	unsigned int i;
+	int ret;
+
+	fd = decoder_open(driver);
+	if (fd < 0)
+		return -ENODEV;
+
+	media_fd = media_open(fd);
+	if (media_fd < 0) {
+		ksft_print_msg("%s: no media device\n", driver);
+		close(fd);
+		return -ENOENT;
+	}
+
+	dec.lat = calloc(nr_frames, sizeof(uint64_t));
+	if (!dec.lat) {
+		ret = -ENOMEM;
+		goto out_close;
+	}
+
+	ret = decoder_set_format(fd, ref->len, &src_fmt);
+	if (!ret)
+		ret = decoder_set_controls(fd, ref, -1);
+	if (!ret && xioctl(fd, VIDIOC_G_FMT, &fmt))
+		ret = -errno;
+	if (!ret && fmt.fmt.pix_mp.pixelformat != V4L2_PIX_FMT_NV12) {
+		fmt.fmt.pix_mp.pixelformat = V4L2_PIX_FMT_NV12;
+		if (xioctl(fd, VIDIOC_S_FMT, &fmt))
+			ret = -errno;
+		else if (fmt.fmt.pix_mp.pixelformat != V4L2_PIX_FMT_NV12)
+			ret = -EINVAL;
+	}
+	if (ret) {
+		ksft_print_msg("%s: format setup failed: %s\n", driver,
+			       strerror(-ret));
+		goto out_free;
+	}
+	cap_fmt = fmt.fmt.pix_mp;
+
+	ret = buffer_alloc(heap_fd, &src, src_fmt.plane_fmt[0].sizeimage);
+	if (!ret)
+		ret = buffer_write(&src, ref->data, ref->len);
+	for (i = 0; !ret && i < NR_DEC_BUFS; i++)
+		ret = buffer_alloc(heap_fd, &dst[i], cap_fmt.plane_fmt[0].sizeimage);
+	if (ret)
+		goto out_free;
+
+	if (xioctl(media_fd, MEDIA_IOC_REQUEST_ALLOC, &request_fd))
+		ret = -errno;
+	if (!ret)
+		ret = m2m_setup_queue(fd, V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE, 1);
+	if (!ret)
+		ret = m2m_setup_queue(fd, V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE,
+				      NR_DEC_BUFS);
+	if (!ret)
+		ret = m2m_stream(fd, 1);
+	if (ret) {
+		ksft_print_msg("%s: decoder setup failed: %s\n", driver,
+			       strerror(-ret));
+		goto out_queues;
+	}
+
+	for (i = 0; i < nr_frames; i++) {
+		struct buffer *out = &dst[i % NR_DEC_BUFS];
+		uint64_t t0, t1;
+
+		t0 = now_ns();
+		ret = decoder_set_controls(fd, ref, request_fd);
+		if (!ret)
+			ret = m2m_queue(fd, V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE, 0,
+					&src, ref->len, request_fd);
+		if (!ret)
+			ret = m2m_queue(fd, V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE,
+					i % NR_DEC_BUFS, out, 0, -1);
+		if (!ret && xioctl(request_fd, MEDIA_REQUEST_IOC_QUEUE, NULL))
+			ret = -errno;
+		if (!ret)
+			ret = decoder_wait(request_fd);
+		if (!ret)
+			ret = m2m_dequeue(fd, V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE);
+		if (!ret)
+			ret = m2m_dequeue(fd, V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE);
+		if (!ret && xioctl(request_fd, MEDIA_REQUEST_IOC_REINIT, NULL))
+			ret = -errno;
+		if (ret) {
+			ksft_print_msg("%s: frame %u failed: %s\n", driver, i,
+				       strerror(-ret));
+			break;
+		}
+		t1 = now_ns();
+		stage_add(&dec, t1 - t0);
+
+		if (!i) {
+			ret = decoder_check_frame(out, &cap_fmt);
+			if (ret)
+				break;
+		}
+	}
+
+	stage_report(&dec, DEC_WIDTH, DEC_HEIGHT);
+
+out_queues:
+	m2m_stream(fd, 0);
+	m2m_setup_queue(fd, V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE, 0);
+	m2m_setup_queue(fd, V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE, 0);
+	if (request_fd >= 0)
+		close(request_fd);
+
+out_free:
+	/* buffers not allocated yet have a zero size */
+	for (i = 0; i < NR_DEC_BUFS; i++)
+		if (dst[i].size)
+			close(dst[i].fd);
+	if (src.size)
+		close(src.fd);
+	free(dec.lat);
+
+out_close:
+	close(media_fd);
+	close(fd);
+	return ret;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-n frames] [-H heap] [-D]\n"
+		"  -n frames  frames per reference size (default %u)\n"
+		"  -H heap    dma-buf heap to allocate from (default %s)\n"
+		"  -D         do not display the frames\n",
+		prog, nr_frames, heap_name);
+}
+
+int main(int argc, char **argv)
+{
+	struct display disp = { .fd = -1 };
+	struct display *out = NULL;
+	int heap_fd, rga_fd, opt;
+	struct ref_stream ref;
+	unsigned int i;
+
+	while ((opt = getopt(argc, argv, "n:H:Dh")) != -1) {
+		switch (opt) {
+		case 'n':
+			nr_frames = strtoul(optarg, NULL, 0);
+			break;
+		case 'H':
+			heap_name = optarg;
+			break;
+		case 'D':
+			no_display = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : KSFT_FAIL;
+		}
+	}
+
+	ksft_print_header();
+
+	if (!nr_frames)
+		ksft_exit_fail_msg("need at least one frame\n");
+
+	heap_fd = heap_open();
+	if (heap_fd < 0)
+		ksft_exit_skip("no dma-buf heap %s\n", heap_name);
+
+	if (ref_stream_init(&ref))
+		ksft_exit_fail_msg("no memory for the reference stream\n");
+
+	rga_fd = rga_open();
+	if (rga_fd < 0)
+		ksft_print_msg("no rockchip-rga video device\n");
+
+	if (rga_fd >= 0 && !no_display) {
+		disp.fd = drm_open_rockchip();
+		if (disp.fd >= 0 && !display_find_output(&disp))
+			out = &disp;
+		else
+			ksft_print_msg("no connected rockchip display, RGA only\n");
+	}
+
+	ksft_set_plan(ARRAY_SIZE(ref_sizes) + ARRAY_SIZE(decoders));
+
+	for (i = 0; i < ARRAY_SIZE(ref_sizes); i++) {
+		int ret;
+
+		if (rga_fd < 0) {
+			ksft_test_result_skip("pipeline %ux%u\n",
+					      ref_sizes[i].width, ref_sizes[i].height);
+			continue;
+		}
+
+		ret = run_size(heap_fd, rga_fd, out, ref_sizes[i].width,
+			       ref_sizes[i].height);
+		ksft_test_result(!ret, "pipeline %ux%u\n",
+				 ref_sizes[i].width, ref_sizes[i].height);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(decoders); i++) {
+		int ret = run_decoder(heap_fd, decoders[i], &ref);
+
+		if (ret == -ENODEV)
+			ksft_test_result_skip("decode %s, no H.264 decoder\n",
+					      decoders[i]);
+		else
+			ksft_test_result(!ret, "decode %s\n", decoders[i]);
+	}
+
+	free(ref.data);
+	if (disp.fd >= 0)
+		close(disp.fd);
+	if (rga_fd >= 0)
+		close(rga_fd);
+	close(heap_fd);
+
+	ksft_finished();
+}